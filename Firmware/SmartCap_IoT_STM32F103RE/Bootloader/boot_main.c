@@ -0,0 +1,220 @@
+/**
+  ******************************************************************************
+  * @file    boot_main.c
+  * @brief   Bootloader: Install Staged OTA Image and Roll Back Unconfirmed Image
+  ******************************************************************************
+  * @description
+  * 位于 Flash 起始 16KB (MDK-ARM/Bootloader.uvprojx), 分区见 User/ota/ota_image.h。
+  * 上电后检查 OTA 状态页:
+  * 1. 暂存区有应用校验通过的新固件 (ready): 再次校验暂存区 CRC, 按页交换运行区和暂存区,
+  *    交换后校验运行区, 写 trial, 启动独立看门狗后跳转到新固件 (试运行)
+  * 2. 试运行期间复位而应用没有写 confirmed (看门狗超时/HardFault 后看门狗复位/掉电):
+  *    再交换一次恢复旧固件, 写 reverted
+  * 3. 其它情况直接跳转到运行区
+  * 每一步交换都记录在状态页, 断电后从第一个未完成的步骤继续。
+  * 只访问寄存器, 不使用 HAL 和中断, 运行在复位后的 HSI 8MHz 时钟。
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f1xx.h"
+#include "ota_image.h"
+#include <stddef.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define BOOT_IWDG_PRESCALER     6           /* LSI 40kHz / 256 */
+#define BOOT_IWDG_RELOAD        4095        /* 约 26 秒, 应用在默认任务中喂狗 */
+
+/* Private variables ---------------------------------------------------------*/
+static const OTA_State_t *const state = (const OTA_State_t *)OTA_STATE_ADDR;
+
+/* Private functions ---------------------------------------------------------*/
+
+static void Boot_FlashWait(void)
+{
+    while (FLASH->SR & FLASH_SR_BSY)
+        ;
+    FLASH->SR = FLASH_SR_EOP | FLASH_SR_PGERR | FLASH_SR_WRPRTERR;
+}
+
+static void Boot_FlashUnlock(void)
+{
+    if (FLASH->CR & FLASH_CR_LOCK)
+    {
+        FLASH->KEYR = FLASH_KEY1;
+        FLASH->KEYR = FLASH_KEY2;
+    }
+}
+
+static void Boot_FlashErase(uint32_t addr)
+{
+    FLASH->CR |= FLASH_CR_PER;
+    FLASH->AR = addr;
+    FLASH->CR |= FLASH_CR_STRT;
+    Boot_FlashWait();
+    FLASH->CR &= ~FLASH_CR_PER;
+}
+
+static void Boot_FlashProgram(const volatile uint16_t *addr, uint16_t half)
+{
+    FLASH->CR |= FLASH_CR_PG;
+    *(volatile uint16_t *)addr = half;
+    Boot_FlashWait();
+    FLASH->CR &= ~FLASH_CR_PG;
+}
+
+/**
+ * @brief  擦除 dst 页并复制 src 页 (0xFFFF 的半字不编程)
+ */
+static void Boot_CopyPage(uint32_t dst, uint32_t src)
+{
+    uint32_t i;
+    uint16_t half;
+
+    Boot_FlashErase(dst);
+    for (i = 0; i < OTA_PAGE_SIZE; i += 2)
+    {
+        half = *(const uint16_t *)(src + i);
+        if (half != 0xFFFF)
+            Boot_FlashProgram((const volatile uint16_t *)(dst + i), half);
+    }
+}
+
+/**
+ * @brief  交换运行区和暂存区的前 pages 页, 每页 3 步, 已记录的步骤跳过
+ * @param  step: 状态页中的进度项 (install_step 或 revert_step)
+ */
+static void Boot_Swap(const uint16_t *step, uint16_t pages)
+{
+    uint16_t i, s;
+    uint32_t a, b;
+
+    for (i = 0; i < pages; i++)
+    {
+        a = OTA_APP_ADDR + (uint32_t)i * OTA_PAGE_SIZE;
+        b = OTA_STAGING_ADDR + (uint32_t)i * OTA_PAGE_SIZE;
+        for (s = 0; s < 3; s++)
+        {
+            if (step[i * 3 + s] == OTA_FLAG_SET)
+                continue;
+            if (s == 0)
+                Boot_CopyPage(OTA_SCRATCH_ADDR, a);
+            else if (s == 1)
+                Boot_CopyPage(a, b);
+            else
+                Boot_CopyPage(b, OTA_SCRATCH_ADDR);
+            Boot_FlashProgram(&step[i * 3 + s], OTA_FLAG_SET);
+        }
+    }
+}
+
+/**
+ * @brief  运行区中最后一个非空页之后的页数
+ */
+static uint16_t Boot_UsedPages(void)
+{
+    const uint32_t *p = (const uint32_t *)(OTA_APP_ADDR + OTA_SLOT_SIZE);
+
+    while (p > (const uint32_t *)OTA_APP_ADDR && p[-1] == 0xFFFFFFFFUL)
+        p--;
+    return (uint16_t)(((uint32_t)p - OTA_APP_ADDR + OTA_PAGE_SIZE - 1) / OTA_PAGE_SIZE);
+}
+
+static uint8_t Boot_HeaderValid(const OTA_ImageHeader_t *img)
+{
+    return img->magic == OTA_IMAGE_MAGIC && img->size >= 8 && img->size <= OTA_SLOT_SIZE &&
+           img->header_crc == OTA_Crc32(0, (const uint8_t *)img, offsetof(OTA_ImageHeader_t, header_crc));
+}
+
+static uint8_t Boot_ImageValid(uint32_t addr, const OTA_ImageHeader_t *img)
+{
+    return OTA_Crc32(0, (const uint8_t *)addr, img->size) == img->crc32;
+}
+
+/**
+ * @brief  新固件试运行: 启动独立看门狗 (启动后不能停止, 直到下次复位)
+ */
+static void Boot_StartWatchdog(void)
+{
+    IWDG->KR = 0xCCCC;
+    IWDG->KR = 0x5555;
+    IWDG->PR = BOOT_IWDG_PRESCALER;
+    IWDG->RLR = BOOT_IWDG_RELOAD;
+    while (IWDG->SR != 0)
+        ;
+    IWDG->KR = 0xAAAA;
+}
+
+/**
+ * @brief  跳转到运行区的应用, 向量表无效时停在这里
+ */
+static void Boot_Jump(void)
+{
+    uint32_t sp = *(const uint32_t *)OTA_APP_ADDR;
+    uint32_t pc = *(const uint32_t *)(OTA_APP_ADDR + 4);
+
+    if (sp <= SRAM_BASE || sp > SRAM_BASE + 0x10000 ||
+        pc < OTA_APP_ADDR || pc >= OTA_APP_ADDR + OTA_SLOT_SIZE)
+    {
+        for (;;)
+            ;
+    }
+
+    FLASH->CR |= FLASH_CR_LOCK;
+    SCB->VTOR = OTA_APP_ADDR;
+    __set_MSP(sp);
+    ((void (*)(void))pc)();
+}
+
+/* Exported functions --------------------------------------------------------*/
+
+int main(void)
+{
+    const OTA_ImageHeader_t *img = &state->image;
+    uint16_t pages;
+
+    if (Boot_HeaderValid(img) && state->ready == OTA_FLAG_SET &&
+        state->trial != OTA_FLAG_SET && state->reverted != OTA_FLAG_SET)
+    {
+        Boot_FlashUnlock();
+
+        if (state->swap_pages == 0xFFFF)
+        {
+            if (!Boot_ImageValid(OTA_STAGING_ADDR, img))
+            {
+                /* 暂存区在应用校验之后被改写, 放弃这次更新 */
+                Boot_FlashErase(OTA_STATE_ADDR);
+                Boot_Jump();
+            }
+            /* 交换覆盖新固件和旧固件中较大的一个, 回滚时原样换回 */
+            pages = (uint16_t)((img->size + OTA_PAGE_SIZE - 1) / OTA_PAGE_SIZE);
+            if (Boot_UsedPages() > pages)
+                pages = Boot_UsedPages();
+            Boot_FlashProgram(&state->swap_pages, pages);
+        }
+
+        Boot_Swap(state->install_step, state->swap_pages);
+
+        if (Boot_ImageValid(OTA_APP_ADDR, img))
+        {
+            Boot_FlashProgram(&state->trial, OTA_FLAG_SET);
+            Boot_StartWatchdog();
+            Boot_Jump();
+        }
+
+        /* 交换后运行区校验失败 (编程出错), 恢复旧固件 */
+        Boot_Swap(state->revert_step, state->swap_pages);
+        Boot_FlashProgram(&state->reverted, OTA_FLAG_SET);
+    }
+    else if (Boot_HeaderValid(img) && state->trial == OTA_FLAG_SET &&
+             state->confirmed != OTA_FLAG_SET && state->reverted != OTA_FLAG_SET)
+    {
+        /* 新固件没有在试运行期间确认 */
+        Boot_FlashUnlock();
+        Boot_Swap(state->revert_step, state->swap_pages);
+        Boot_FlashProgram(&state->reverted, OTA_FLAG_SET);
+    }
+
+    Boot_Jump();
+    return 0;
+}
@@ -57,6 +57,7 @@ void TIM2_IRQHandler(void);
 void USART1_IRQHandler(void);
 void UART5_IRQHandler(void);
 /* USER CODE BEGIN EFP */
+void USART2_IRQHandler(void);
 
 /* USER CODE END EFP */
 
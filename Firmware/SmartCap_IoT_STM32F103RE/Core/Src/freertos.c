@@ -27,6 +27,8 @@
 /* USER CODE BEGIN Includes */
 
 #include "user_tasks.h"  // 用户任务实现
+#include "trace.h"       // 时间线记录中的队列名称
+#include "event_log.h"   // 任务创建失败记录
 
 /* USER CODE END Includes */
 
@@ -70,6 +72,34 @@ void Task_RG200U_Transmit(void const * argument);
 
 void MX_FREERTOS_Init(void); /* (MISRA C 2004 rule 8.1) */
 
+/* Hook prototypes */
+void configureTimerForRunTimeStats(void);
+unsigned long getRunTimeCounterValue(void);
+void vApplicationStackOverflowHook(xTaskHandle xTask, char *pcTaskName);
+
+/* USER CODE BEGIN 1 */
+/* Functions needed when configGENERATE_RUN_TIME_STATS is on */
+/* 实际实现在 rtos_stats.c */
+__weak void configureTimerForRunTimeStats(void)
+{
+
+}
+
+__weak unsigned long getRunTimeCounterValue(void)
+{
+return 0;
+}
+/* USER CODE END 1 */
+
+/* USER CODE BEGIN 4 */
+__weak void vApplicationStackOverflowHook(xTaskHandle xTask, char *pcTaskName)
+{
+   /* Run time stack overflow checking is performed if
+   configCHECK_FOR_STACK_OVERFLOW is defined to 1 or 2. This hook function is
+   called if a stack overflow is detected. */
+}
+/* USER CODE END 4 */
+
 /* GetIdleTaskMemory prototype (linked to static allocation support) */
 void vApplicationGetIdleTaskMemory( StaticTask_t **ppxIdleTaskTCBBuffer, StackType_t **ppxIdleTaskStackBuffer, uint32_t *pulIdleTaskStackSize );
 
@@ -119,11 +149,13 @@ void MX_FREERTOS_Init(void) {
 
   /* USER CODE BEGIN RTOS_QUEUES */
   /* add queues, ... */
+  Trace_NameQueue(Queue_RS485_To_RG200UHandle, "RS485_To_RG200U");
+  Trace_NameQueue(Queue_RG200U_To_RS485Handle, "RG200U_To_RS485");
   /* USER CODE END RTOS_QUEUES */
 
   /* Create the thread(s) */
   /* definition and creation of defaultTask */
-  osThreadDef(defaultTask, StartDefaultTask, osPriorityLow, 0, 128);
+  osThreadDef(defaultTask, StartDefaultTask, osPriorityLow, 0, 384);
   defaultTaskHandle = osThreadCreate(osThread(defaultTask), NULL);
 
   /* definition and creation of RS485_RxTask */
@@ -144,6 +176,15 @@ void MX_FREERTOS_Init(void) {
 
   /* USER CODE BEGIN RTOS_THREADS */
   /* add threads, ... */
+  /* 以上任务和队列从 configTOTAL_HEAP_SIZE 分配, 失败时记录下来 (此时日志尚未初始化, 先进入缓冲) */
+  if (Queue_RS485_To_RG200UHandle == NULL || Queue_RG200U_To_RS485Handle == NULL)
+    EVENT_LOG1(TASK_CREATE_FAILED, EventLog_Tag("msgq"));
+  if (defaultTaskHandle == NULL)
+    EVENT_LOG1(TASK_CREATE_FAILED, EventLog_Tag("dflt"));
+  if (RS485_RxTaskHandle == NULL || RS485_TxTaskHandle == NULL)
+    EVENT_LOG1(TASK_CREATE_FAILED, EventLog_Tag("r485"));
+  if (RG200U_RxTaskHandle == NULL || RG200U_TxTaskHandle == NULL)
+    EVENT_LOG1(TASK_CREATE_FAILED, EventLog_Tag("rg2u"));
   /* USER CODE END RTOS_THREADS */
 
 }
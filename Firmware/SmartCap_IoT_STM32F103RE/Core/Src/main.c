@@ -97,6 +97,7 @@ int main(void)
   MX_TIM2_Init();
   MX_USART1_UART_Init();
   MX_UART5_Init();
+  MX_USART2_UART_Init();
   /* USER CODE BEGIN 2 */
 
   User_main();
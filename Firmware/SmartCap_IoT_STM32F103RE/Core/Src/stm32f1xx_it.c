@@ -24,6 +24,8 @@
 /* USER CODE BEGIN Includes */
 #include "rg200u.h"
 #include "rs485.h"
+#include "console.h"
+#include "trace.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -184,11 +186,11 @@ void TIM1_UP_IRQHandler(void)
 void TIM2_IRQHandler(void)
 {
   /* USER CODE BEGIN TIM2_IRQn 0 */
-
+  TRACE_ISR_ENTER(TRACE_ISR_WIZ_TIM);
   /* USER CODE END TIM2_IRQn 0 */
   HAL_TIM_IRQHandler(&htim2);
   /* USER CODE BEGIN TIM2_IRQn 1 */
-
+  TRACE_ISR_EXIT(TRACE_ISR_WIZ_TIM);
   /* USER CODE END TIM2_IRQn 1 */
 }
 
@@ -198,11 +200,11 @@ void TIM2_IRQHandler(void)
 void USART1_IRQHandler(void)
 {
   /* USER CODE BEGIN USART1_IRQn 0 */
-
+  TRACE_ISR_ENTER(TRACE_ISR_RS485);
   /* USER CODE END USART1_IRQn 0 */
   HAL_UART_IRQHandler(&huart1);
   /* USER CODE BEGIN USART1_IRQn 1 */
-
+  TRACE_ISR_EXIT(TRACE_ISR_RS485);
   /* USER CODE END USART1_IRQn 1 */
 }
 
@@ -212,16 +214,27 @@ void USART1_IRQHandler(void)
 void UART5_IRQHandler(void)
 {
   /* USER CODE BEGIN UART5_IRQn 0 */
-
+  TRACE_ISR_ENTER(TRACE_ISR_MODEM);
   /* USER CODE END UART5_IRQn 0 */
   HAL_UART_IRQHandler(&huart5);
   /* USER CODE BEGIN UART5_IRQn 1 */
-
+  TRACE_ISR_EXIT(TRACE_ISR_MODEM);
   /* USER CODE END UART5_IRQn 1 */
 }
 
 /* USER CODE BEGIN 1 */
 
+/**
+ * @brief  USART2 中断: 调试串口收发由 console.c 直接处理, 不经过 HAL
+ * @note   .ioc 中 USART2 不生成 IRQ handler (NVIC 使能和优先级仍由 MX_USART2_UART_Init 设置)
+ */
+void USART2_IRQHandler(void)
+{
+    TRACE_ISR_ENTER(TRACE_ISR_CONSOLE);
+    Console_IRQHandler();
+    TRACE_ISR_EXIT(TRACE_ISR_CONSOLE);
+}
+
 /**
  * @brief  UART接收完成回调函数
  * @param  huart: UART句柄
@@ -0,0 +1,251 @@
+/**
+  ******************************************************************************
+  * @file    flash_sim.h
+  * @brief   Simulated STM32F103 Internal Flash with Power-Cut Injection
+  ******************************************************************************
+  * @description
+  * 被测代码按常量地址访问 Flash, 所以 512KB 映射到真实地址 0x08000000 (只读),
+  * 模拟器通过另一个可写映射 sim_flash 修改内容:
+  * - 应用经 HAL 擦写 (flash_if.c), 由本文件的 HAL_FLASHEx_Erase / HAL_FLASH_Program 执行
+  * - 引导程序直接写寄存器和半字: 半字写入只读映射触发 SIGSEGV, 记录地址后放行,
+  *   下一次访问 FLASH 寄存器 (等待 BSY) 时按编程规则生效; 擦除在置 STRT 后的下一次访问时执行
+  * - 与硬件相同, 非 0xFFFF 的半字只能编程为 0x0000, 否则内容不变并计入 sim_flash_errors;
+  *   未解锁时擦写同样计入 sim_flash_errors
+  * 断电: sim_flash_cut 为第 n 次擦写操作 (从 1 开始计), 该操作不完成 (擦除只擦掉前半页),
+  * longjmp 到 sim_flash_power, 测试从那里重新上电。sim_flash_log 记录每次操作的地址,
+  * 用于挑选断电点。
+  ******************************************************************************
+  */
+
+#ifndef __FLASH_SIM_H__
+#define __FLASH_SIM_H__
+
+#include <setjmp.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "stm32f1xx_hal.h"
+
+#define SIM_FLASH_BASE          0x08000000UL
+#define SIM_FLASH_SIZE          0x80000UL
+#define SIM_FLASH_PAGE          2048
+#define SIM_FLASH_PAGES         (SIM_FLASH_SIZE / SIM_FLASH_PAGE)
+#define SIM_FLASH_LOG_MAX       (1UL << 18)
+#define SIM_FLASH_LOG_ERASE     0x80000000UL    /* 记录中的擦除操作, 低位为页地址 */
+
+#ifndef MAP_FIXED_NOREPLACE
+#define MAP_FIXED_NOREPLACE     MAP_FIXED
+#endif
+
+static uint8_t *sim_flash;                      /* 可写映射, 偏移 0 对应 SIM_FLASH_BASE */
+static FLASH_TypeDef sim_flash_ctrl;
+static uint8_t sim_flash_unlocked;              /* HAL_FLASH_Unlock 之后 */
+static uint32_t sim_flash_ops;                  /* 上电以来的擦写次数 */
+static uint32_t sim_flash_cut;                  /* 在第几次擦写时断电, 0 为不断电 */
+static uint32_t sim_flash_errors;
+static uint32_t sim_flash_erases[SIM_FLASH_PAGES];
+static uint32_t sim_flash_log[SIM_FLASH_LOG_MAX];
+static jmp_buf sim_flash_power;
+
+static volatile uintptr_t sim_pending;          /* 引导程序写入的半字地址, 等待生效 */
+static volatile uint16_t sim_pending_old;
+static long sim_page_size;
+
+/* 访问计数, 到达断电点时返回 1 */
+static int sim_flash_op(uint32_t record)
+{
+    if (sim_flash_ops < SIM_FLASH_LOG_MAX)
+        sim_flash_log[sim_flash_ops] = record;
+    sim_flash_ops++;
+    return sim_flash_ops == sim_flash_cut;
+}
+
+static void sim_flash_erase_page(uint32_t addr)
+{
+    uint32_t off = addr - SIM_FLASH_BASE;
+
+    if (addr < SIM_FLASH_BASE || off >= SIM_FLASH_SIZE || (off % SIM_FLASH_PAGE) != 0)
+    {
+        sim_flash_errors++;
+        return;
+    }
+    if (sim_flash_op(SIM_FLASH_LOG_ERASE | addr))
+    {
+        memset(sim_flash + off, 0xFF, SIM_FLASH_PAGE / 2);
+        longjmp(sim_flash_power, 1);
+    }
+    memset(sim_flash + off, 0xFF, SIM_FLASH_PAGE);
+    sim_flash_erases[off / SIM_FLASH_PAGE]++;
+}
+
+static uint8_t sim_flash_program(uint32_t addr, uint16_t half)
+{
+    uint32_t off = addr - SIM_FLASH_BASE;
+    uint16_t *p = (uint16_t *)(sim_flash + off);
+
+    if (addr < SIM_FLASH_BASE || off >= SIM_FLASH_SIZE || (off & 1))
+    {
+        sim_flash_errors++;
+        return 0;
+    }
+    if (sim_flash_op(addr))
+        longjmp(sim_flash_power, 1);
+    if (*p != 0xFFFF && half != 0)
+    {
+        sim_flash_errors++;
+        return 0;
+    }
+    *p = half;
+    return 1;
+}
+
+/* 引导程序写只读映射: 放行这个页, 由 stub_flash_regs 检查后恢复 */
+static void sim_flash_segv(int sig, siginfo_t *si, void *uc)
+{
+    uintptr_t addr = (uintptr_t)si->si_addr;
+
+    (void)uc;
+    if (addr < SIM_FLASH_BASE || addr >= SIM_FLASH_BASE + SIM_FLASH_SIZE || sim_pending != 0)
+    {
+        signal(sig, SIG_DFL);
+        return;
+    }
+    sim_pending = addr & ~(uintptr_t)1;
+    sim_pending_old = *(uint16_t *)(sim_flash + (sim_pending - SIM_FLASH_BASE));
+    mprotect((void *)(addr & ~(uintptr_t)(sim_page_size - 1)), sim_page_size, PROT_READ | PROT_WRITE);
+}
+
+FLASH_TypeDef *stub_flash_regs(void)
+{
+    FLASH_TypeDef *r = &sim_flash_ctrl;
+    uintptr_t addr = sim_pending;
+    uint16_t half;
+
+    r->SR = 0;
+    if (r->KEYR == FLASH_KEY2)
+    {
+        r->CR &= ~FLASH_CR_LOCK;
+        r->KEYR = 0;
+    }
+    if (addr != 0)
+    {
+        half = *(volatile uint16_t *)addr;
+        *(uint16_t *)(sim_flash + (addr - SIM_FLASH_BASE)) = sim_pending_old;
+        mprotect((void *)(addr & ~(uintptr_t)(sim_page_size - 1)), sim_page_size, PROT_READ);
+        sim_pending = 0;
+        if ((r->CR & (FLASH_CR_PG | FLASH_CR_LOCK)) != FLASH_CR_PG)
+            sim_flash_errors++;
+        else if (!sim_flash_program((uint32_t)addr, half))
+            r->SR = FLASH_SR_PGERR;
+    }
+    if ((r->CR & FLASH_CR_PER) && (r->CR & FLASH_CR_STRT))
+    {
+        r->CR &= ~FLASH_CR_STRT;
+        if (r->CR & FLASH_CR_LOCK)
+            sim_flash_errors++;
+        else
+            sim_flash_erase_page(r->AR);
+    }
+    return r;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Unlock(void)
+{
+    sim_flash_unlocked = 1;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Lock(void)
+{
+    sim_flash_unlocked = 0;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef *erase, uint32_t *page_error)
+{
+    uint32_t i;
+
+    if (!sim_flash_unlocked || erase->TypeErase != FLASH_TYPEERASE_PAGES)
+    {
+        sim_flash_errors++;
+        return HAL_ERROR;
+    }
+    for (i = 0; i < erase->NbPages; i++)
+        sim_flash_erase_page(erase->PageAddress + i * SIM_FLASH_PAGE);
+    *page_error = 0xFFFFFFFFUL;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t type, uint32_t addr, uint64_t data)
+{
+    if (!sim_flash_unlocked || type != FLASH_TYPEPROGRAM_HALFWORD)
+    {
+        sim_flash_errors++;
+        return HAL_ERROR;
+    }
+    return sim_flash_program(addr, (uint16_t)data) ? HAL_OK : HAL_ERROR;
+}
+
+/* 建立映射, 每个测试程序调用一次 */
+static void sim_flash_init(void)
+{
+    struct sigaction sa;
+    int fd = memfd_create("flash", 0);
+
+    sim_page_size = sysconf(_SC_PAGESIZE);
+    if (fd < 0 || ftruncate(fd, SIM_FLASH_SIZE) != 0)
+    {
+        perror("flash_sim");
+        exit(2);
+    }
+    sim_flash = mmap(NULL, SIM_FLASH_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (sim_flash == MAP_FAILED ||
+        mmap((void *)SIM_FLASH_BASE, SIM_FLASH_SIZE, PROT_READ, MAP_SHARED | MAP_FIXED_NOREPLACE, fd, 0) !=
+            (void *)SIM_FLASH_BASE)
+    {
+        perror("flash_sim: mmap 0x08000000");
+        exit(2);
+    }
+    close(fd);
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_sigaction = sim_flash_segv;
+    sa.sa_flags = SA_SIGINFO | SA_NODEFER;
+    sigaction(SIGSEGV, &sa, NULL);
+
+    memset(sim_flash, 0xFF, SIM_FLASH_SIZE);
+}
+
+/* 上电: 控制器复位为上锁状态, cut 为本次上电后第几次擦写时断电 (0 不断电) */
+static void sim_flash_power_on(uint32_t cut)
+{
+    memset(&sim_flash_ctrl, 0, sizeof(sim_flash_ctrl));
+    sim_flash_ctrl.CR = FLASH_CR_LOCK;
+    sim_flash_unlocked = 0;
+    sim_flash_ops = 0;
+    sim_flash_cut = cut;
+}
+
+/* 整片擦除, 清除计数 */
+static void sim_flash_reset(void)
+{
+    memset(sim_flash, 0xFF, SIM_FLASH_SIZE);
+    memset(sim_flash_erases, 0, sizeof(sim_flash_erases));
+    sim_flash_errors = 0;
+    sim_flash_power_on(0);
+}
+
+static uint8_t sim_flash_log_is_erase(uint32_t i)
+{
+    return (sim_flash_log[i] & SIM_FLASH_LOG_ERASE) != 0;
+}
+
+static uint32_t sim_flash_log_addr(uint32_t i)
+{
+    return sim_flash_log[i] & ~SIM_FLASH_LOG_ERASE;
+}
+
+#endif /* __FLASH_SIM_H__ */
@@ -0,0 +1,39 @@
+/**
+  ******************************************************************************
+  * @file    FreeRTOS.h (host stub)
+  * @brief   FreeRTOS Types and Heap Queries
+  ******************************************************************************
+  * @description
+  * 配置与 Core/Inc/FreeRTOSConfig.h 一致的部分: 32 位 tick, 任务名 16 字节。
+  * stub_heap_free / stub_heap_min_free 为堆查询的返回值。
+  ******************************************************************************
+  */
+
+#ifndef __STUB_FREERTOS_H__
+#define __STUB_FREERTOS_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define configMAX_TASK_NAME_LEN         16
+#define configSTACK_DEPTH_TYPE          uint16_t
+
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+typedef uint32_t TickType_t;
+typedef uint32_t StackType_t;
+
+static __attribute__((unused)) size_t stub_heap_free = 0;
+static __attribute__((unused)) size_t stub_heap_min_free = 0;
+
+static inline size_t xPortGetFreeHeapSize(void)
+{
+    return stub_heap_free;
+}
+
+static inline size_t xPortGetMinimumEverFreeHeapSize(void)
+{
+    return stub_heap_min_free;
+}
+
+#endif /* __STUB_FREERTOS_H__ */
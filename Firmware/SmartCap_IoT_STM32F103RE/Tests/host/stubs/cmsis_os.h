@@ -0,0 +1,175 @@
+/**
+  ******************************************************************************
+  * @file    cmsis_os.h (host stub)
+  * @brief   CMSIS-RTOS v1 Subset for Host Unit Tests
+  ******************************************************************************
+  * @description
+  * 只提供被测模块用到的接口。每个测试程序是一个编译单元, 桩的状态用 static 变量,
+  * 测试直接读写:
+  * - stub_tick: osKernelSysTick 的返回值, osDelay 使其前进
+  * - stub_delay_hook: 非空时 osDelay 前进后调用, 测试在其中模拟等待期间运行的其它任务
+  * - stub_kernel_running: osKernelRunning 的返回值
+  * - stub_signals: osSignalSet 的累计调用次数
+  * - 互斥锁和信号量不计数, 等待总是立即成功 (单线程中没有竞争)
+  ******************************************************************************
+  */
+
+#ifndef __STUB_CMSIS_OS_H__
+#define __STUB_CMSIS_OS_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef enum {
+    osOK = 0,
+    osEventSignal = 0x08,
+    osEventMessage = 0x10,
+    osEventTimeout = 0x40,
+    osErrorResource = 0x81,
+    osErrorOS = 0xFF
+} osStatus;
+
+typedef enum {
+    osPriorityIdle = -3,
+    osPriorityLow = -2,
+    osPriorityBelowNormal = -1,
+    osPriorityNormal = 0,
+    osPriorityAboveNormal = 1,
+    osPriorityHigh = 2,
+    osPriorityRealtime = 3
+} osPriority;
+
+#define osWaitForever           0xFFFFFFFFU
+
+typedef void (*os_pthread)(void const *argument);
+typedef void *osThreadId;
+typedef void *osMutexId;
+typedef void *osSemaphoreId;
+typedef void *osMessageQId;
+typedef struct { uint32_t dummy[24]; } osStaticThreadDef_t;
+typedef struct { uint32_t dummy[20]; } osStaticMutexDef_t;
+typedef struct { uint32_t dummy[20]; } osStaticSemaphoreDef_t;
+
+typedef struct {
+    const char *name;
+    os_pthread pthread;
+    osPriority tpriority;
+    uint32_t instances;
+    uint32_t stacksize;
+    uint32_t *buffer;
+    osStaticThreadDef_t *controlblock;
+} osThreadDef_t;
+
+typedef struct {
+    uint32_t dummy;
+    osStaticMutexDef_t *controlblock;
+} osMutexDef_t;
+
+typedef struct {
+    uint32_t dummy;
+    osStaticSemaphoreDef_t *controlblock;
+} osSemaphoreDef_t;
+
+typedef struct {
+    osStatus status;
+    union { uint32_t v; void *p; int32_t signals; } value;
+} osEvent;
+
+#define osThreadDef(name, thread, priority, instances, stacksz) \
+    const osThreadDef_t os_thread_def_##name = { #name, (thread), (priority), (instances), (stacksz), NULL, NULL }
+#define osThreadStaticDef(name, thread, priority, instances, stacksz, buffer, control) \
+    const osThreadDef_t os_thread_def_##name = { #name, (thread), (priority), (instances), (stacksz), (buffer), (control) }
+#define osThread(name)          &os_thread_def_##name
+#define osMutexStaticDef(name, control) \
+    const osMutexDef_t os_mutex_def_##name = { 0, (control) }
+#define osMutex(name)           &os_mutex_def_##name
+
+#define STUB_UNUSED             __attribute__((unused))
+
+static STUB_UNUSED uint32_t stub_tick = 0;
+static STUB_UNUSED int stub_kernel_running = 0;
+static STUB_UNUSED uint32_t stub_signals = 0;
+static STUB_UNUSED uint8_t stub_thread;
+static STUB_UNUSED void (*stub_delay_hook)(uint32_t ms) = NULL;
+
+static inline uint32_t osKernelSysTick(void)
+{
+    return stub_tick;
+}
+
+static inline int32_t osKernelRunning(void)
+{
+    return stub_kernel_running;
+}
+
+static inline osStatus osDelay(uint32_t ms)
+{
+    stub_tick += ms;
+    if (stub_delay_hook != NULL)
+        stub_delay_hook(ms);
+    return osOK;
+}
+
+static inline osThreadId osThreadCreate(const osThreadDef_t *def, void *argument)
+{
+    (void)def;
+    (void)argument;
+    return &stub_thread;
+}
+
+static inline int32_t osSignalSet(osThreadId thread, int32_t signals)
+{
+    (void)thread;
+    (void)signals;
+    stub_signals++;
+    return 0;
+}
+
+static inline osEvent osSignalWait(int32_t signals, uint32_t millisec)
+{
+    osEvent ev;
+
+    (void)millisec;
+    ev.status = osEventSignal;
+    ev.value.signals = signals;
+    return ev;
+}
+
+static inline osMutexId osMutexCreate(const osMutexDef_t *def)
+{
+    return (osMutexId)def->controlblock;
+}
+
+static inline osStatus osMutexWait(osMutexId mutex, uint32_t millisec)
+{
+    (void)mutex;
+    (void)millisec;
+    return osOK;
+}
+
+static inline osStatus osMutexRelease(osMutexId mutex)
+{
+    (void)mutex;
+    return osOK;
+}
+
+static inline osSemaphoreId osSemaphoreCreate(const osSemaphoreDef_t *def, int32_t count)
+{
+    (void)count;
+    return (osSemaphoreId)def->controlblock;
+}
+
+static inline int32_t osSemaphoreWait(osSemaphoreId sem, uint32_t millisec)
+{
+    (void)sem;
+    (void)millisec;
+    return 1;
+}
+
+static inline osStatus osSemaphoreRelease(osSemaphoreId sem)
+{
+    (void)sem;
+    return osOK;
+}
+
+#endif /* __STUB_CMSIS_OS_H__ */
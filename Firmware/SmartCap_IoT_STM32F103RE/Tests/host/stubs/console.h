@@ -0,0 +1,28 @@
+/**
+  ******************************************************************************
+  * @file    console.h (host stub)
+  * @brief   Debug Console Output Discarded
+  ******************************************************************************
+  * @description
+  * 测试调试串口模块本身 (test_console.c) 时不使用本文件, 直接包含 console.c。
+  ******************************************************************************
+  */
+
+#ifndef __STUB_CONSOLE_H__
+#define __STUB_CONSOLE_H__
+
+#include <stdint.h>
+
+static inline uint8_t Console_Puts(const char *str)
+{
+    (void)str;
+    return 1;
+}
+
+static inline uint8_t Console_Printf(const char *fmt, ...)
+{
+    (void)fmt;
+    return 1;
+}
+
+#endif /* __STUB_CONSOLE_H__ */
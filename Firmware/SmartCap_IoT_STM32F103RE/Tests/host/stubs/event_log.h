@@ -0,0 +1,29 @@
+/**
+  ******************************************************************************
+  * @file    event_log.h (host stub)
+  * @brief   Event Log Macros Counted Instead of Recorded
+  ******************************************************************************
+  */
+
+#ifndef __STUB_EVENT_LOG_H__
+#define __STUB_EVENT_LOG_H__
+
+#include <stdint.h>
+
+static __attribute__((unused)) uint32_t stub_events = 0;
+
+#define EVENT_LOG0(id)                  (stub_events++)
+#define EVENT_LOG1(id, a)               ((void)(a), stub_events++)
+#define EVENT_LOG2(id, a, b)            ((void)(a), (void)(b), stub_events++)
+#define EVENT_LOG3(id, a, b, c)         ((void)(a), (void)(b), (void)(c), stub_events++)
+#define EVENT_LOG4(id, a, b, c, d)      ((void)(a), (void)(b), (void)(c), (void)(d), stub_events++)
+#define EVENT_LOG_IP(ip)                (((uint32_t)(ip)[0] << 24) | ((uint32_t)(ip)[1] << 16) | \
+                                         ((uint32_t)(ip)[2] << 8) | (uint32_t)(ip)[3])
+
+static inline uint32_t EventLog_Tag(const char *str)
+{
+    (void)str;
+    return 0;
+}
+
+#endif /* __STUB_EVENT_LOG_H__ */
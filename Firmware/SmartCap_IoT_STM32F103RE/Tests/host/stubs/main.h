@@ -0,0 +1,21 @@
+/**
+  ******************************************************************************
+  * @file    main.h (host stub)
+  * @brief   Replaces the CubeMX main.h and the HAL it pulls in
+  ******************************************************************************
+  * @description
+  * 模块头文件只需要寄存器和少量 HAL 类型 (见 stm32f1xx_hal.h), 它们声明的函数由测试实现。
+  ******************************************************************************
+  */
+
+#ifndef __STUB_MAIN_H__
+#define __STUB_MAIN_H__
+
+#include "stm32f1xx_hal.h"
+
+#define RELAY_K2_Pin            GPIO_PIN_3
+#define RELAY_K2_GPIO_Port      GPIOB
+#define RELAY_K1_Pin            GPIO_PIN_4
+#define RELAY_K1_GPIO_Port      GPIOB
+
+#endif /* __STUB_MAIN_H__ */
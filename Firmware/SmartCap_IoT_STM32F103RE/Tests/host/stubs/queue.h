@@ -0,0 +1,20 @@
+/**
+  ******************************************************************************
+  * @file    queue.h (host stub)
+  * @brief   FreeRTOS Queue Handle and Trace Number
+  ******************************************************************************
+  * @description
+  * vQueueSetQueueNumber 只有声明, 需要时由测试实现。
+  ******************************************************************************
+  */
+
+#ifndef __STUB_QUEUE_H__
+#define __STUB_QUEUE_H__
+
+#include "FreeRTOS.h"
+
+typedef void *QueueHandle_t;
+
+void vQueueSetQueueNumber(QueueHandle_t queue, UBaseType_t number);
+
+#endif /* __STUB_QUEUE_H__ */
@@ -0,0 +1,170 @@
+/**
+  ******************************************************************************
+  * @file    stm32f1xx.h (host stub)
+  * @brief   Cortex-M3 Intrinsics and Registers Used by the Modules Under Test
+  ******************************************************************************
+  * @description
+  * 主机上是单线程, 关中断只记录 PRIMASK 状态; LDREX/STREX 总是成功。
+  * DWT->CYCCNT、SysTick、USART2、BKP 和 RCC->CSR 寄存器为普通变量, 由测试设置和检查。
+  * FLASH 寄存器的每次访问经 stub_flash_regs (flash_sim.h), 由它执行引导程序置位的擦除/编程;
+  * __set_MSP 只有声明, 由测试实现 (引导程序跳转到应用前调用)。
+  * NVIC_SystemReset 只计数 (stub_resets)。
+  ******************************************************************************
+  */
+
+#ifndef __STUB_STM32F1XX_H__
+#define __STUB_STM32F1XX_H__
+
+#include <stdint.h>
+
+#define __INLINE                inline
+
+static __attribute__((unused)) uint32_t stub_primask = 0;
+
+static inline uint32_t __get_PRIMASK(void)
+{
+    return stub_primask;
+}
+
+static inline void __set_PRIMASK(uint32_t primask)
+{
+    stub_primask = primask;
+}
+
+static inline void __disable_irq(void)
+{
+    stub_primask = 1;
+}
+
+static inline void __enable_irq(void)
+{
+    stub_primask = 0;
+}
+
+static inline uint32_t __LDREXW(volatile uint32_t *addr)
+{
+    return *addr;
+}
+
+static inline uint32_t __STREXW(uint32_t value, volatile uint32_t *addr)
+{
+    *addr = value;
+    return 0;
+}
+
+static inline void __CLREX(void)
+{
+}
+
+static inline void __DMB(void)
+{
+}
+
+static __attribute__((unused)) uint32_t stub_resets = 0;
+
+static inline void NVIC_SystemReset(void)
+{
+    stub_resets++;
+}
+
+void __set_MSP(uint32_t msp);
+
+typedef struct {
+    volatile uint32_t CTRL;
+    volatile uint32_t CYCCNT;
+} DWT_Type;
+
+typedef struct {
+    volatile uint32_t DEMCR;
+} CoreDebug_Type;
+
+typedef struct {
+    volatile uint32_t KR;
+    volatile uint32_t PR;
+    volatile uint32_t RLR;
+    volatile uint32_t SR;
+} IWDG_TypeDef;
+
+typedef struct {
+    volatile uint32_t SR;
+    volatile uint32_t DR;
+    volatile uint32_t CR1;
+} USART_TypeDef;
+
+typedef struct {
+    volatile uint32_t ODR;
+} GPIO_TypeDef;
+
+typedef struct {
+    volatile uint32_t ACR;
+    volatile uint32_t KEYR;
+    volatile uint32_t OPTKEYR;
+    volatile uint32_t SR;
+    volatile uint32_t CR;
+    volatile uint32_t AR;
+} FLASH_TypeDef;
+
+typedef struct {
+    volatile uint32_t VTOR;
+} SCB_Type;
+
+typedef struct {
+    volatile uint32_t CTRL;
+    volatile uint32_t LOAD;
+    volatile uint32_t VAL;
+} SysTick_Type;
+
+typedef struct {
+    volatile uint32_t CSR;
+} RCC_TypeDef;
+
+typedef struct {
+    volatile uint32_t DR1;
+    volatile uint32_t DR2;
+    volatile uint32_t DR3;
+} BKP_TypeDef;
+
+static __attribute__((unused)) DWT_Type stub_dwt;
+static __attribute__((unused)) CoreDebug_Type stub_core_debug;
+static __attribute__((unused)) IWDG_TypeDef stub_iwdg;
+static __attribute__((unused)) USART_TypeDef stub_usart2;
+static __attribute__((unused)) USART_TypeDef stub_uart5;
+static __attribute__((unused)) GPIO_TypeDef stub_gpiob;
+static __attribute__((unused)) BKP_TypeDef stub_bkp;
+static __attribute__((unused)) RCC_TypeDef stub_rcc;
+static __attribute__((unused)) SCB_Type stub_scb;
+static __attribute__((unused)) SysTick_Type stub_systick;
+static __attribute__((unused)) uint32_t SystemCoreClock = 72000000;
+
+#define DWT                     (&stub_dwt)
+#define CoreDebug               (&stub_core_debug)
+#define IWDG                    (&stub_iwdg)
+#define USART2                  (&stub_usart2)
+#define UART5                   (&stub_uart5)
+#define GPIOB                   (&stub_gpiob)
+#define BKP                     (&stub_bkp)
+#define RCC                     (&stub_rcc)
+#define SCB                     (&stub_scb)
+#define SysTick                 (&stub_systick)
+#define FLASH                   (stub_flash_regs())
+#define SRAM_BASE               0x20000000UL
+#define DWT_CTRL_CYCCNTENA_Msk  1U
+#define CoreDebug_DEMCR_TRCENA_Msk (1U << 24)
+#define USART_SR_ORE            (1U << 3)
+#define USART_SR_RXNE           (1U << 5)
+#define USART_SR_TXE            (1U << 7)
+#define USART_CR1_TXEIE         (1U << 7)
+#define FLASH_SR_BSY            (1U << 0)
+#define FLASH_SR_PGERR          (1U << 2)
+#define FLASH_SR_WRPRTERR       (1U << 4)
+#define FLASH_SR_EOP            (1U << 5)
+#define FLASH_CR_PG             (1U << 0)
+#define FLASH_CR_PER            (1U << 1)
+#define FLASH_CR_STRT           (1U << 6)
+#define FLASH_CR_LOCK           (1U << 7)
+#define FLASH_KEY1              0x45670123UL
+#define FLASH_KEY2              0xCDEF89ABUL
+
+FLASH_TypeDef *stub_flash_regs(void);
+
+#endif /* __STUB_STM32F1XX_H__ */
@@ -0,0 +1,78 @@
+/**
+  ******************************************************************************
+  * @file    stm32f1xx_hal.h (host stub)
+  * @brief   HAL Types and Macros Used by the Modules Under Test
+  ******************************************************************************
+  * @description
+  * 时钟和备份域访问的宏为空操作, 寄存器见 stm32f1xx.h。
+  * Flash 擦写函数只有声明, 由 flash_sim.h 实现; UART/GPIO/HAL_GetTick/UID 同样只有声明, 由测试实现。
+  ******************************************************************************
+  */
+
+#ifndef __STUB_STM32F1XX_HAL_H__
+#define __STUB_STM32F1XX_HAL_H__
+
+#include "stm32f1xx.h"
+
+typedef enum {
+    HAL_OK = 0,
+    HAL_ERROR,
+    HAL_BUSY,
+    HAL_TIMEOUT
+} HAL_StatusTypeDef;
+
+typedef struct {
+    USART_TypeDef *Instance;
+} UART_HandleTypeDef;
+
+typedef enum {
+    GPIO_PIN_RESET = 0,
+    GPIO_PIN_SET
+} GPIO_PinState;
+
+typedef struct {
+    uint32_t TypeErase;
+    uint32_t Banks;
+    uint32_t PageAddress;
+    uint32_t NbPages;
+} FLASH_EraseInitTypeDef;
+
+#define FLASH_TYPEERASE_PAGES           0x00U
+#define FLASH_BANK_1                    1U
+#define FLASH_TYPEPROGRAM_HALFWORD      0x01U
+
+#define UART_IT_RXNE                    USART_SR_RXNE
+#define __HAL_UART_ENABLE_IT(h, it)     ((void)(h), (void)(it))
+#define __HAL_UART_FLUSH_DRREGISTER(h)  ((void)(h))
+
+#define GPIO_PIN_3                      ((uint16_t)0x0008)
+#define GPIO_PIN_4                      ((uint16_t)0x0010)
+
+#define __HAL_DBGMCU_FREEZE_IWDG()      ((void)0)
+#define __HAL_RCC_PWR_CLK_ENABLE()      ((void)0)
+#define __HAL_RCC_BKP_CLK_ENABLE()      ((void)0)
+#define __HAL_RCC_CLEAR_RESET_FLAGS()   (RCC->CSR &= 0x00FFFFFFU)
+
+static inline void HAL_PWR_EnableBkUpAccess(void)
+{
+}
+
+static inline void HAL_PWR_DisableBkUpAccess(void)
+{
+}
+
+uint32_t HAL_GetTick(void);
+uint32_t HAL_GetUIDw0(void);
+uint32_t HAL_GetUIDw1(void);
+uint32_t HAL_GetUIDw2(void);
+void HAL_GPIO_WritePin(GPIO_TypeDef *port, uint16_t pin, GPIO_PinState state);
+HAL_StatusTypeDef HAL_UART_Transmit(UART_HandleTypeDef *huart, uint8_t *data, uint16_t size, uint32_t timeout);
+HAL_StatusTypeDef HAL_UART_Receive_IT(UART_HandleTypeDef *huart, uint8_t *data, uint16_t size);
+HAL_StatusTypeDef HAL_UART_DeInit(UART_HandleTypeDef *huart);
+
+HAL_StatusTypeDef HAL_FLASH_Unlock(void);
+HAL_StatusTypeDef HAL_FLASH_Lock(void);
+HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef *erase, uint32_t *page_error);
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t type, uint32_t addr, uint64_t data);
+
+#endif /* __STUB_STM32F1XX_HAL_H__ */
@@ -0,0 +1,42 @@
+/**
+  ******************************************************************************
+  * @file    task.h (host stub)
+  * @brief   FreeRTOS 10.3.1 Task Status Types
+  ******************************************************************************
+  * @description
+  * uxTaskGetSystemState 只有声明, 需要时由测试实现。
+  ******************************************************************************
+  */
+
+#ifndef __STUB_TASK_H__
+#define __STUB_TASK_H__
+
+#include "FreeRTOS.h"
+
+typedef void *TaskHandle_t;
+
+typedef enum {
+    eRunning = 0,
+    eReady,
+    eBlocked,
+    eSuspended,
+    eDeleted,
+    eInvalid
+} eTaskState;
+
+typedef struct xTASK_STATUS {
+    TaskHandle_t xHandle;
+    const char *pcTaskName;
+    UBaseType_t xTaskNumber;
+    eTaskState eCurrentState;
+    UBaseType_t uxCurrentPriority;
+    UBaseType_t uxBasePriority;
+    uint32_t ulRunTimeCounter;
+    StackType_t *pxStackBase;
+    configSTACK_DEPTH_TYPE usStackHighWaterMark;
+} TaskStatus_t;
+
+UBaseType_t uxTaskGetSystemState(TaskStatus_t *const pxTaskStatusArray, const UBaseType_t uxArraySize,
+                                 uint32_t *const pulTotalRunTime);
+
+#endif /* __STUB_TASK_H__ */
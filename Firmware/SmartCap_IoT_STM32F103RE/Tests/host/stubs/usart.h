@@ -0,0 +1,18 @@
+/**
+  ******************************************************************************
+  * @file    usart.h (host stub)
+  * @brief   CubeMX UART Handles
+  ******************************************************************************
+  */
+
+#ifndef __STUB_USART_H__
+#define __STUB_USART_H__
+
+#include "main.h"
+
+static __attribute__((unused)) UART_HandleTypeDef huart2 = { USART2 };
+static __attribute__((unused)) UART_HandleTypeDef huart5 = { UART5 };
+
+void MX_UART5_Init(void);
+
+#endif /* __STUB_USART_H__ */
@@ -0,0 +1,72 @@
+/**
+  ******************************************************************************
+  * @file    test.h
+  * @brief   Minimal Host Unit Test Helpers
+  ******************************************************************************
+  * @description
+  * 主机 (PC) 上编译运行的单元测试, 不依赖测试框架:
+  * - 被测模块的 .c 文件直接 #include 到测试文件中, 测试可以访问 static 变量和函数
+  * - stubs/ 中的同名头文件代替 CMSIS-RTOS、HAL 等目标板接口
+  * - 每个测试文件是一个程序, main 中用 TEST_RUN 依次执行测试函数, 有失败时返回 1
+  ******************************************************************************
+  */
+
+#ifndef __TEST_H__
+#define __TEST_H__
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+static int test_failures = 0;
+static int test_checks = 0;
+static const char *test_current = "";
+
+/* 条件不成立时记录失败, 继续执行 */
+#define CHECK(cond) do { \
+    test_checks++; \
+    if (!(cond)) { \
+        test_failures++; \
+        printf("  FAIL %s:%d: %s: %s\n", __FILE__, __LINE__, test_current, #cond); \
+    } \
+} while (0)
+
+#define CHECK_EQ(a, b) do { \
+    long long _a = (long long)(a), _b = (long long)(b); \
+    test_checks++; \
+    if (_a != _b) { \
+        test_failures++; \
+        printf("  FAIL %s:%d: %s: %s == %lld, expected %lld\n", __FILE__, __LINE__, test_current, #a, _a, _b); \
+    } \
+} while (0)
+
+#define CHECK_MEM(a, b, n) do { \
+    test_checks++; \
+    if (memcmp((a), (b), (n)) != 0) { \
+        test_failures++; \
+        printf("  FAIL %s:%d: %s: %s differs from %s\n", __FILE__, __LINE__, test_current, #a, #b); \
+    } \
+} while (0)
+
+#define TEST_RUN(fn) do { \
+    test_current = #fn; \
+    fn(); \
+} while (0)
+
+/* 打印汇总, 作为 main 的返回值 */
+static int test_summary(const char *name)
+{
+    printf("%s: %d checks, %d failed\n", name, test_checks, test_failures);
+    return test_failures != 0;
+}
+
+/* 基准测试用: 单调时钟 (ns) */
+static inline unsigned long long test_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + (unsigned long long)ts.tv_nsec;
+}
+
+#endif /* __TEST_H__ */
@@ -0,0 +1,320 @@
+/**
+  ******************************************************************************
+  * @file    test_console.c
+  * @brief   Debug Console: TX Ring, Shell Input and Per-Message Cost
+  ******************************************************************************
+  * @description
+  * USART2 中断由测试调用 Console_IRQHandler 模拟: 置 TXE 取出一个发送字节,
+  * 置 RXNE 送入一个接收字节。status 等命令用到的其它模块由本文件给出固定的返回值。
+  * 最后的基准测试报告每条消息放入发送缓冲的主机耗时和中断发送每字节的耗时。
+  ******************************************************************************
+  */
+
+#include "test.h"
+#include "../../User/console/console.c"
+
+static char out[8192];
+static int out_len;
+
+/* console.c 的命令用到的其它模块 -------------------------------------------*/
+
+wiz_sup_state_t wiz_supervisor_get_state(void) { return WIZ_SUP_STATE_UP; }
+void wiz_supervisor_get_stats(wiz_sup_stats_t *stats) { memset(stats, 0, sizeof(*stats)); }
+Uplink_ID_t Uplink_Router_GetActive(void) { return UPLINK_ETH; }
+void Uplink_Router_GetStats(Uplink_Stats_t *stats) { memset(stats, 0, sizeof(*stats)); }
+uint64_t TimeSync_MonotonicMs(void) { return 12345; }
+uint8_t TimeSync_IsSynced(void) { return 1; }
+TCP_State_t RG200U_GetTCPState(void) { return (TCP_State_t)0; }
+void print_network_information(void) { Console_Puts("net\r\n"); }
+void wiz_sockbuf_get_stats(uint8_t sn, wiz_sockbuf_stats_t *stats) { memset(stats, 0, sizeof(*stats)); stats->tx_kb = 2; }
+uint16_t Metrics_FormatPrometheus(uint16_t *cursor, char *buf, uint16_t size) { return 0; }
+void FS_GetInfo(FS_Info_t *info) { memset(info, 0, sizeof(*info)); }
+int8_t FS_List(uint8_t *cursor, FS_Stat_t *st) { return FS_ERR_NOENT; }
+uint16_t OTA_StatusJson(char *buf, uint16_t size) { return 0; }
+uint8_t RtosStats_GetTasks(RtosStats_Task_t *tasks, uint8_t max) { return 0; }
+uint16_t RtosStats_CpuLoad(void) { return 0; }
+void Trace_SetMask(uint8_t mask) { }
+uint8_t Trace_GetMask(void) { return 0; }
+uint8_t Trace_Get(uint16_t *cursor, Trace_Event_t *event) { return 0; }
+const char *Trace_QueueName(uint8_t id) { return NULL; }
+const char *Trace_IsrName(uint8_t id) { return ""; }
+uint32_t Trace_Bench(void) { return 0; }
+
+/* USART2 ------------------------------------------------------------------*/
+
+/* 发送中断最多发出 max 个字节, 返回发出的字节数 */
+static int drain_n(int max)
+{
+    int n = 0;
+
+    while (n < max && (USART2->CR1 & USART_CR1_TXEIE))
+    {
+        uint16_t tail = tx_tail;
+
+        USART2->SR = USART_SR_TXE;
+        Console_IRQHandler();
+        if (tx_tail != tail)
+        {
+            if (out_len < (int)sizeof(out))
+                out[out_len++] = (char)USART2->DR;
+            n++;
+        }
+    }
+    USART2->SR = 0;
+    return n;
+}
+
+static int drain(void)
+{
+    return drain_n(0x7FFFFFFF);
+}
+
+static void type(const char *s)
+{
+    while (*s)
+    {
+        USART2->SR = USART_SR_RXNE;
+        USART2->DR = (uint8_t)*s++;
+        Console_IRQHandler();
+    }
+    USART2->SR = 0;
+}
+
+static int out_has(const char *s)
+{
+    out[out_len < (int)sizeof(out) ? out_len : (int)sizeof(out) - 1] = '\0';
+    return strstr(out, s) != NULL;
+}
+
+static int out_count(const char *s)
+{
+    const char *p = out;
+    int n = 0;
+
+    out[out_len < (int)sizeof(out) ? out_len : (int)sizeof(out) - 1] = '\0';
+    while ((p = strstr(p, s)) != NULL)
+    {
+        n++;
+        p += strlen(s);
+    }
+    return n;
+}
+
+/* 计数从 start 开始, 用于检查 16 位计数回绕 */
+static void reset(uint16_t start)
+{
+    tx_head = tx_tail = start;
+    rx_head = rx_tail = 0;
+    line_len = 0;
+    line_cr = 0;
+    memset(&console_stats, 0, sizeof(console_stats));
+    memset(USART2, 0, sizeof(*USART2));
+    stub_primask = 0;
+    out_len = 0;
+}
+
+/* 测试 ---------------------------------------------------------------------*/
+
+static void test_write_order(void)
+{
+    reset(0);
+    CHECK_EQ(Console_Puts("hello "), 1);
+    CHECK_EQ(Console_Printf("%d-%s", 42, "x"), 1);
+    CHECK_EQ(Console_Write("abcdef", 3), 1);
+    CHECK(USART2->CR1 & USART_CR1_TXEIE);
+    CHECK_EQ(drain(), 13);
+    CHECK_MEM(out, "hello 42-xabc", 13);
+    CHECK_EQ(console_stats.tx_bytes, 13);
+    CHECK_EQ(USART2->CR1 & USART_CR1_TXEIE, 0);
+
+    /* 关中断保护后恢复调用前的 PRIMASK */
+    stub_primask = 1;
+    Console_Puts("x");
+    CHECK_EQ(stub_primask, 1);
+    stub_primask = 0;
+    Console_Puts("x");
+    CHECK_EQ(stub_primask, 0);
+}
+
+/* 边写边发, 缓冲和 16 位计数都回绕, 发出的字节流不变 */
+static void test_ring_wrap(void)
+{
+    static char expect[8192];
+    char msg[100];
+    int exp_len = 0, i, j;
+
+    reset(0xFFF0 - 3 * CONSOLE_TX_SIZE / 4);
+    for (i = 0; i < 60; i++)
+    {
+        int len = 20 + (i * 37) % 80;
+
+        for (j = 0; j < len; j++)
+            msg[j] = (char)('A' + (i + j) % 26);
+        if (Console_Write(msg, (uint16_t)len))
+        {
+            memcpy(&expect[exp_len], msg, len);
+            exp_len += len;
+        }
+        drain_n(50);
+    }
+    drain();
+    CHECK((uint16_t)tx_head < 0x1000);  // 计数已回绕
+    CHECK_EQ(console_stats.tx_dropped, 0);
+    CHECK_EQ(out_len, exp_len);
+    CHECK_MEM(out, expect, exp_len);
+}
+
+/* 放不下的消息整条丢弃, 不会发出半条 */
+static void test_full_drops_whole(void)
+{
+    char big[CONSOLE_TX_SIZE];
+
+    reset(100);
+    memset(big, '.', sizeof(big));
+    CHECK_EQ(Console_Write(big, CONSOLE_TX_SIZE - 24), 1);
+    CHECK_EQ(Console_Puts("this message is too long\r\n"), 0);
+    CHECK_EQ(console_stats.tx_dropped, 1);
+    CHECK_EQ(Console_Puts("exactly 24 bytes fit.\r\n!"), 1);
+    CHECK_EQ(Console_Puts("!"), 0);
+    CHECK_EQ(console_stats.tx_dropped, 2);
+    CHECK_EQ(drain(), CONSOLE_TX_SIZE);
+    CHECK_MEM(&out[CONSOLE_TX_SIZE - 24], "exactly 24 bytes fit.\r\n!", 24);
+    CHECK_EQ(console_stats.tx_bytes, CONSOLE_TX_SIZE);
+
+    /* 发送缓冲空出后恢复 */
+    CHECK_EQ(Console_Puts("ok"), 1);
+}
+
+static void test_printf_truncate(void)
+{
+    char arg[200];
+
+    reset(0);
+    memset(arg, 'z', sizeof(arg) - 1);
+    arg[sizeof(arg) - 1] = '\0';
+    CHECK_EQ(Console_Printf("[%s]", arg), 1);
+    CHECK_EQ(drain(), CONSOLE_PRINTF_MAX - 1);
+    CHECK_EQ(out[0], '[');
+    CHECK_EQ(out[CONSOLE_PRINTF_MAX - 2], 'z');
+}
+
+static void test_shell(void)
+{
+    int i;
+
+    reset(0);
+    type("helq\bp\r\n");
+    Console_Poll();
+    drain();
+    CHECK(out_has("helq\b \bp\r\n"));
+    CHECK(out_has("help     list commands\r\n"));
+    CHECK(out_has("reboot   software reset\r\n"));
+    CHECK_EQ(out_count(CONSOLE_PROMPT), 1);  // "\r\n" 只算一次回车
+
+    out_len = 0;
+    type("  xyz  arg\r");
+    Console_Poll();
+    drain();
+    CHECK(out_has("unknown command 'xyz', try help\r\n"));
+
+    out_len = 0;
+    type("status\n");
+    Console_Poll();
+    drain();
+    CHECK(out_has("uptime    12 s, time synced\r\n"));
+    CHECK(out_has("uplink    ETH, failovers 0\r\n"));
+    CHECK(out_has("eth       UP,"));
+
+    /* 过长的行截断在 CONSOLE_LINE_MAX - 1, 空行只输出提示符 */
+    out_len = 0;
+    for (i = 0; i < 9; i++)
+    {
+        type("aaaaaaaa");
+        Console_Poll();
+    }
+    CHECK_EQ(line_len, CONSOLE_LINE_MAX - 1);
+    type("\r\r");
+    Console_Poll();
+    drain();
+    CHECK_EQ(out_count("unknown command"), 1);
+    CHECK_EQ(out_count(CONSOLE_PROMPT), 2);
+}
+
+static void test_rx_overrun(void)
+{
+    reset(0);
+    type("0123456789012345678901234567890123456789");
+    CHECK_EQ(console_stats.rx_overruns, 40 - CONSOLE_RX_SIZE);
+    Console_Poll();
+    drain();
+    CHECK_EQ(out_len, CONSOLE_RX_SIZE);
+    CHECK_MEM(out, "01234567890123456789012345678901", CONSOLE_RX_SIZE);
+}
+
+/* 基准测试 -----------------------------------------------------------------*/
+
+static void test_bench(void)
+{
+    const int iters = 1000000;
+    volatile uint32_t sink = 0;
+    unsigned long long t0, t_puts, t_write, t_printf, t_irq;
+    char line[64];
+    int i;
+
+    memset(line, '#', sizeof(line));
+    reset(0);
+
+    t0 = test_now_ns();
+    for (i = 0; i < iters; i++)
+    {
+        sink += Console_Puts("rs485: frame 12 bytes\r\n");
+        tx_tail = tx_head;
+    }
+    t_puts = test_now_ns() - t0;
+
+    t0 = test_now_ns();
+    for (i = 0; i < iters; i++)
+    {
+        sink += Console_Write(line, sizeof(line));
+        tx_tail = tx_head;
+    }
+    t_write = test_now_ns() - t0;
+
+    t0 = test_now_ns();
+    for (i = 0; i < iters; i++)
+    {
+        sink += Console_Printf("rs485: frame %u bytes, crc %04x\r\n", (unsigned)(i & 0xFF), (unsigned)i & 0xFFFF);
+        tx_tail = tx_head;
+    }
+    t_printf = test_now_ns() - t0;
+
+    /* 发送中断: 每次发一个字节 */
+    t0 = test_now_ns();
+    for (i = 0; i < iters / 1000; i++)
+    {
+        tx_tail = tx_head - 1000;
+        USART2->CR1 |= USART_CR1_TXEIE;
+        USART2->SR = USART_SR_TXE;
+        while (tx_tail != tx_head)
+            Console_IRQHandler();
+    }
+    t_irq = test_now_ns() - t0;
+
+    CHECK_EQ(sink, 3U * iters);
+    printf("  Console_Puts 23 B %5.1f ns, Console_Write 64 B %5.1f ns, Console_Printf 2 args %5.1f ns, "
+           "TX interrupt %4.1f ns/byte\n",
+           (double)t_puts / iters, (double)t_write / iters, (double)t_printf / iters,
+           (double)t_irq / (iters / 1000 * 1000));
+}
+
+int main(void)
+{
+    TEST_RUN(test_write_order);
+    TEST_RUN(test_ring_wrap);
+    TEST_RUN(test_full_drops_whole);
+    TEST_RUN(test_printf_truncate);
+    TEST_RUN(test_shell);
+    TEST_RUN(test_rx_overrun);
+    TEST_RUN(test_bench);
+    return test_summary("console");
+}
@@ -0,0 +1,647 @@
+/**
+  ******************************************************************************
+  * @file    test_event_log.c
+  * @brief   Event Log: RAM Ring Wrap, Flash File Rotation, Remote Pull, Power Cuts, Record Cost
+  ******************************************************************************
+  * @description
+  * 真实的 event_log.c 运行在 flash_fs.c 和模拟 Flash (flash_sim.h) 上, 使用真实的
+  * event_log.h (不用 stubs/event_log.h 的计数宏):
+  * - RAM 环形缓冲: 记录跨越缓冲末尾回绕, 缓冲满时整条丢弃并以 LOG_DROPPED 报告个数,
+  *   被抢占的写者 (已预留、头字未写) 之后的事件等它写完再取出
+  * - 文件轮换: 只保留最新的两个文件, 读取按时间顺序从较旧的文件开始
+  * - 远程读取 (/api/log 的 EventLog_Read): 按 HTTP 块大小分次读取, 期间继续写入和换文件,
+  *   拼接的结果总是完整的记录
+  * - 重启和断电: 已提交的事件不丢, 半条记录不输出, 之后继续写入
+  * - decode_event_log.py 还原的文本
+  * - 记录一个事件和写入文件的耗时 (主机上, 供比较)
+  ******************************************************************************
+  */
+
+#define __STUB_EVENT_LOG_H__            /* 使用真实的 event_log.h */
+#include "test.h"
+#include "flash_sim.h"
+#include "../../User/log/event_log.h"
+#include "../../User/fs/flash_if.c"
+#include "../../User/fs/flash_fs.c"
+#include "../../User/modbus/mb_crc.c"
+#include "../../User/user_main/metrics.c"
+#include "../../User/log/event_log.c"
+
+#define CHUNK                   64      /* WIZ_HTTP_CHUNK_MIN: /api/log 每次读取的最小缓冲 */
+#define PULL_MAX                (4 * EVENT_LOG_FILE_MAX)
+#define DECODER                 "../../User/log/decode_event_log.py"
+
+typedef struct {
+    uint16_t id;
+    uint8_t argc;
+    uint32_t tick;
+    uint32_t args[EVENT_LOG_ARGS_MAX];
+} rec_t;
+
+static uint8_t pulled[PULL_MAX];
+static rec_t recs[PULL_MAX / 6];
+static uint32_t nrecs;
+
+/* 重新挂载文件系统: RAM 状态全部丢失 */
+static void remount(void)
+{
+    sim_flash_power_on(0);
+    memset(fs_pages, 0, sizeof(fs_pages));
+    memset(fs_handles, 0, sizeof(fs_handles));
+    fs_relocations = 0;
+    fs_mounted = 0;
+    FS_Init();
+}
+
+/* 断电或复位后重新启动: 重新挂载文件系统并初始化日志 */
+static void reboot(void)
+{
+    memset((uint32_t *)log_ring, 0, sizeof(log_ring));
+    log_head = log_tail = 0;
+    log_level = EVENT_LOG_LEVEL_DEFAULT;
+    log_drops_seen = 0;
+    log_fd = -1;
+    log_gen = 0;
+    log_size = log_synced = log_prev_valid = 0;
+    log_pending_tick = 0;
+    log_urgent = 0;
+    memset((void *)Metrics_Slots, 0, sizeof(Metrics_Slots));
+
+    remount();
+    EventLog_Init();
+}
+
+/* 空的文件系统上第一次启动 */
+static void setup(void)
+{
+    sim_flash_reset();
+    stub_tick = 0;
+    remount();
+    CHECK_EQ(FS_Format(), FS_OK);
+    reboot();
+}
+
+/* 像 /api/log 一样从头读取, 每次 size 字节 */
+static uint32_t pull(uint16_t size)
+{
+    EventLog_Cursor_t cursor;
+    uint32_t len = 0;
+    int32_t n;
+
+    memset(&cursor, 0, sizeof(cursor));
+    while (len + size <= sizeof(pulled) && (n = EventLog_Read(&cursor, pulled + len, size)) > 0)
+        len += (uint32_t)n;
+    return len;
+}
+
+/* 解析为记录, 返回 1 表示正好是若干条完整的记录 */
+static uint8_t parse(const uint8_t *data, uint32_t len)
+{
+    uint32_t pos = 0, i;
+    uint16_t head;
+    rec_t *r;
+
+    nrecs = 0;
+    while (pos + 6 <= len)
+    {
+        r = &recs[nrecs];
+        head = (uint16_t)(data[pos] | (data[pos + 1] << 8));
+        r->id = head & 0xFFF;
+        r->argc = (uint8_t)(head >> 12);
+        if (r->argc > EVENT_LOG_ARGS_MAX || pos + 6 + 4 * r->argc > len)
+            return 0;
+        memcpy(&r->tick, data + pos + 2, 4);
+        for (i = 0; i < r->argc; i++)
+            memcpy(&r->args[i], data + pos + 6 + 4 * i, 4);
+        pos += 6 + 4 * r->argc;
+        nrecs++;
+    }
+    return pos == len;
+}
+
+/* 记录 seq 号事件, 参数个数按 seq 轮换 (0 个参数的事件无法编号, 用 4 个参数的代替) */
+static void record_seq(uint32_t seq)
+{
+    uint8_t argc = (uint8_t)(seq % 4 + 1);
+
+    EventLog_Record(EV_ETH_STATE, argc, seq, ~seq, seq * 3, seq ^ 0x5A5A5A5A);
+}
+
+/* 检查 r 是 record_seq 写入的事件, 返回其 seq, 否则返回 -1 */
+static int32_t seq_of(const rec_t *r)
+{
+    uint32_t seq = r->args[0];
+
+    if (r->id != EV_ETH_STATE || r->argc != seq % 4 + 1)
+        return -1;
+    if (r->argc > 1 && r->args[1] != ~seq)
+        return -1;
+    if (r->argc > 2 && r->args[2] != seq * 3)
+        return -1;
+    if (r->argc > 3 && r->args[3] != (seq ^ 0x5A5A5A5A))
+        return -1;
+    return (int32_t)seq;
+}
+
+/* 读出的 seq 事件是否从 first 开始连续到 last */
+static uint8_t seq_contiguous(int32_t first, int32_t last)
+{
+    int32_t next = first, s;
+    uint32_t i;
+
+    for (i = 0; i < nrecs; i++)
+    {
+        if (recs[i].id != EV_ETH_STATE)
+            continue;
+        s = seq_of(&recs[i]);
+        if (s != next)
+            return 0;
+        next++;
+    }
+    return next == last + 1;
+}
+
+static uint32_t count_id(uint16_t id)
+{
+    uint32_t i, n = 0;
+
+    for (i = 0; i < nrecs; i++)
+        n += recs[i].id == id;
+    return n;
+}
+
+static const rec_t *find_id(uint16_t id)
+{
+    uint32_t i;
+
+    for (i = 0; i < nrecs; i++)
+    {
+        if (recs[i].id == id)
+            return &recs[i];
+    }
+    return NULL;
+}
+
+/* 测试 ---------------------------------------------------------------------*/
+
+/* 第一次启动: 文件以 LOG_FILE 开头, 随后是 BOOT */
+static void test_boot(void)
+{
+    setup();
+    EventLog_Flush();
+    CHECK(parse(pulled, pull(CHUNK)));
+    CHECK(nrecs >= 2);
+    CHECK_EQ(recs[0].id, EV_LOG_FILE);
+    CHECK_EQ(recs[0].argc, 2);
+    CHECK_EQ(recs[0].args[1], EVENT_LOG_FORMAT);
+    CHECK_EQ(recs[nrecs - 1].id, EV_BOOT);
+}
+
+/* 事件跨越 RAM 缓冲末尾回绕多次, 取出的内容和顺序不变 */
+static void test_ring_wrap(void)
+{
+    uint32_t seq, words = 0;
+
+    setup();
+    for (seq = 0; seq < 240; seq++)
+    {
+        stub_tick = 1000 + seq;
+        record_seq(seq);
+        words += seq % 4 + 3;
+        if (seq % 9 == 8)
+            EventLog_Poll();
+    }
+    EventLog_Flush();
+    CHECK(words > 3 * EVENT_LOG_RING_WORDS);
+    CHECK_EQ(Metrics_Slots[METRIC_EVENT_LOG_DROPS], 0);
+    CHECK_EQ(log_head, log_tail);
+    CHECK_EQ(log_gen, 1);
+
+    CHECK(parse(pulled, pull(CHUNK)));
+    CHECK(seq_contiguous(0, 239));
+    CHECK_EQ(count_id(EV_LOG_DROPPED), 0);
+    CHECK_EQ(recs[nrecs - 1].tick, 1000 + 239);
+}
+
+/* 缓冲满时整条丢弃, 下次写入文件时以 LOG_DROPPED 报告个数, 之后恢复记录 */
+static void test_ring_full(void)
+{
+    uint32_t seq, accepted = 0, words = 0;
+    const rec_t *d;
+
+    setup();
+    EventLog_Flush();
+    for (seq = 0; seq < 200; seq++)
+    {
+        if (words + seq % 4 + 3 <= EVENT_LOG_RING_WORDS)
+        {
+            words += seq % 4 + 3;
+            accepted++;
+        }
+        else
+            words = EVENT_LOG_RING_WORDS + 1;   /* 之后都放不下 */
+        record_seq(seq);
+    }
+    CHECK_EQ(Metrics_Slots[METRIC_EVENT_LOG_DROPS], 200 - accepted);
+    record_seq(1000);                           /* 取出前仍放不下 */
+    EventLog_Flush();
+    record_seq(accepted);
+    EventLog_Flush();
+
+    CHECK(parse(pulled, pull(CHUNK)));
+    CHECK(seq_contiguous(0, (int32_t)accepted));
+    d = find_id(EV_LOG_DROPPED);
+    CHECK(d != NULL);
+    if (d != NULL)
+    {
+        CHECK_EQ(d->args[0], 200 - accepted + 1);
+        CHECK(d > find_id(EV_BOOT));
+        CHECK_EQ(seq_of(d - 1), (int32_t)accepted - 1);
+        CHECK_EQ(seq_of(d + 1), (int32_t)accepted);
+    }
+}
+
+/*
+ * 任务预留了空间但被中断抢占, 中断中记录的事件在它之后; 头字写好之前取不出任何一条,
+ * 写好之后两条按预留的顺序取出
+ */
+static void test_preempted_writer(void)
+{
+    uint32_t head;
+
+    setup();
+    EventLog_Flush();
+    head = log_head;
+    log_head = head + 3;                        /* 任务: 预留 1 个参数的事件 */
+    log_ring[(head + 1) & LOG_MASK] = 77;
+    log_ring[(head + 2) & LOG_MASK] = 1;
+    record_seq(0);                              /* 中断 */
+    EventLog_Poll();
+    CHECK_EQ(log_tail, head);
+
+    log_ring[head & LOG_MASK] = LOG_VALID | (1u << 12) | EV_LOG_LEVEL;
+    EventLog_Flush();
+    CHECK_EQ(log_tail, log_head);
+    CHECK(parse(pulled, pull(CHUNK)));
+    CHECK_EQ(recs[nrecs - 2].id, EV_LOG_LEVEL);
+    CHECK_EQ(recs[nrecs - 2].tick, 77);
+    CHECK_EQ(seq_of(&recs[nrecs - 1]), 0);
+}
+
+/* 低于设定级别的事件不占缓冲; 设定级别本身记录为 LOG_LEVEL */
+static void test_level(void)
+{
+    uint32_t head;
+
+    setup();
+    head = log_head;
+    EVENT_LOG1(MODEM_QIOPEN, 1);
+    CHECK_EQ(log_head, head);
+    EventLog_SetLevel(EVENT_LOG_DEBUG);
+    EVENT_LOG1(MODEM_QIOPEN, 2);
+    EventLog_SetLevel(EVENT_LOG_ERROR);
+    EVENT_LOG1(MODEM_QIOPEN, 3);
+    EVENT_LOG0(MQTT_SESSION_DROP);
+    EVENT_LOG1(STACK_OVERFLOW, EventLog_Tag("mqtt"));
+    EventLog_Flush();
+
+    CHECK(parse(pulled, pull(CHUNK)));
+    CHECK_EQ(count_id(EV_MODEM_QIOPEN), 1);
+    CHECK_EQ(find_id(EV_MODEM_QIOPEN)->args[0], 2);
+    CHECK_EQ(count_id(EV_LOG_LEVEL), 1);          /* 设为 ERROR 的那条本身是 INFO */
+    CHECK_EQ(count_id(EV_MQTT_SESSION_DROP), 0);
+    CHECK_EQ(count_id(EV_STACK_OVERFLOW), 1);
+    CHECK_EQ(recs[nrecs - 1].args[0], 'm' | ('q' << 8) | ('t' << 16) | ((uint32_t)'t' << 24));
+}
+
+/* 写满一个文件后换另一个, 只保留最新的两个; 读取从较旧的文件开始, 记录连续 */
+static void test_rotation(void)
+{
+    FS_Stat_t st;
+    uint32_t seq, i, files = 0;
+    int32_t first;
+
+    setup();
+    for (seq = 0; seq < 1500; seq++)
+    {
+        record_seq(seq);
+        if (seq % 10 == 9)
+            EventLog_Poll();
+    }
+    EventLog_Flush();
+    CHECK(log_gen >= 4);
+    CHECK_EQ(FS_Stat("event0.log", &st), FS_OK);
+    CHECK(st.size <= EVENT_LOG_FILE_MAX);
+    CHECK_EQ(FS_Stat("event1.log", &st), FS_OK);
+    CHECK(st.size <= EVENT_LOG_FILE_MAX);
+
+    CHECK(parse(pulled, pull(CHUNK)));
+    CHECK_EQ(recs[0].id, EV_LOG_FILE);
+    CHECK_EQ(recs[0].args[0], log_gen - 1);
+    for (i = 0; i < nrecs; i++)
+        files += recs[i].id == EV_LOG_FILE;
+    CHECK_EQ(files, 2);
+    first = seq_of(&recs[1]);
+    CHECK(first > 0);
+    CHECK(seq_contiguous(first, 1499));
+    CHECK(nrecs * 10 > 2 * EVENT_LOG_FILE_MAX / 2);
+}
+
+/*
+ * 远程读取期间继续写入: 读得慢时读取位置所在的文件可能被删除, 读取跳到仍存在的文件。
+ * 每次读取都只返回完整的记录, 拼接的结果仍可逐条解码, 事件不重复、不乱序
+ */
+static void test_pull_while_logging(void)
+{
+    static const uint16_t sizes[] = {CHUNK, 100, 256};
+    EventLog_Cursor_t cursor;
+    uint32_t seq, k, i, j, partial, skips, bad;
+    int32_t n, s, prev;
+
+    for (k = 0; k < sizeof(sizes) / sizeof(sizes[0]); k++)
+    {
+        setup();
+        for (seq = 0; seq < 300; seq++)
+        {
+            record_seq(seq);
+            if (seq % 10 == 9)
+                EventLog_Poll();
+        }
+        memset(&cursor, 0, sizeof(cursor));
+        partial = skips = bad = 0;
+        prev = -1;
+        for (i = 0; ; i++)
+        {
+            EventLog_Flush();
+            n = EventLog_Read(&cursor, pulled, sizes[k]);
+            if (n <= 0)
+                break;
+            partial += !parse(pulled, (uint32_t)n);
+            for (j = 0; j < nrecs; j++)
+            {
+                if (recs[j].id == EV_LOG_FILE || recs[j].id == EV_BOOT)
+                    continue;
+                s = seq_of(&recs[j]);
+                bad += s <= prev;
+                skips += s > prev + 1;
+                prev = s;
+            }
+            /* 前 200 次每读一块写入 i % 40 条: 有时慢于读取, 有时让读取位置所在的文件被删除 */
+            for (j = 0; i < 200 && j < i % 40; j++)
+            {
+                record_seq(seq++);
+                if (seq % 10 == 0)
+                    EventLog_Poll();
+            }
+        }
+        CHECK_EQ(partial, 0);
+        CHECK_EQ(bad, 0);
+        CHECK(skips > 0);
+        CHECK_EQ(prev, (int32_t)seq - 1);
+        printf("  pull %3u-byte chunks while logging: %lu events, %lu files, %lu skips over deleted files\n",
+               sizes[k], (unsigned long)seq, (unsigned long)log_gen, (unsigned long)skips);
+    }
+}
+
+/* 重启后继续追加到最新的文件, 以 BOOT 分隔, 时间戳重新从 0 开始 */
+static void test_reboot(void)
+{
+    uint32_t seq;
+    const rec_t *r;
+
+    setup();
+    for (seq = 0; seq < 20; seq++)
+        record_seq(seq);
+    EventLog_Flush();
+    record_seq(999);                            /* 未写入 Flash, 复位时丢失 */
+    stub_tick = 0;
+    reboot();
+    for (seq = 20; seq < 30; seq++)
+        record_seq(seq);
+    EventLog_Flush();
+
+    CHECK_EQ(log_gen, 1);
+    CHECK(parse(pulled, pull(CHUNK)));
+    CHECK_EQ(count_id(EV_LOG_FILE), 1);
+    CHECK_EQ(count_id(EV_BOOT), 2);
+    CHECK(seq_contiguous(0, 29));
+    r = find_id(EV_BOOT);
+    CHECK(r != NULL && seq_of(r + 1) == 0);
+    for (r = &recs[nrecs - 1]; r > recs && r->id != EV_BOOT; r--)
+        ;
+    CHECK_EQ(seq_of(r - 1), 19);
+    CHECK_EQ(seq_of(r + 1), 20);
+}
+
+/*
+ * 写日志时在每一次擦写断电: 重启后已提交 (Flush 返回) 的事件都在, 输出只含完整的记录,
+ * 之后写入的事件接在后面
+ */
+static void test_power_cut(void)
+{
+    static uint8_t start_flash[SIM_FLASH_SIZE];
+    static uint32_t start_erases[SIM_FLASH_PAGES];
+    volatile uint32_t committed, seq;
+    volatile uint32_t cuts = 0, rotations = 0;
+    uint32_t ops, cut, gen0;
+    int32_t s, last;
+    uint32_t i;
+
+    setup();
+    for (seq = 0; seq < 200; seq++)
+    {
+        record_seq(seq);
+        if (seq % 10 == 9)
+            EventLog_Poll();
+    }
+    EventLog_Flush();
+    gen0 = log_gen;
+    memcpy(start_flash, sim_flash, SIM_FLASH_SIZE);
+    memcpy(start_erases, sim_flash_erases, sizeof(start_erases));
+
+    /* 不断电时的擦写次数 */
+    sim_flash_power_on(0);
+    for (seq = 200; seq < 420; seq++)
+    {
+        record_seq(seq);
+        if (seq % 7 == 6)
+            EventLog_Flush();
+    }
+    EventLog_Flush();
+    ops = sim_flash_ops;
+    CHECK(log_gen > gen0);
+
+    for (cut = 1; cut <= ops; cut++)
+    {
+        memcpy(sim_flash, start_flash, SIM_FLASH_SIZE);
+        memcpy(sim_flash_erases, start_erases, sizeof(start_erases));
+        sim_flash_errors = 0;
+        reboot();
+        committed = 199;
+        sim_flash_power_on(cut);
+        if (!setjmp(sim_flash_power))
+        {
+            for (seq = 200; seq < 420; seq++)
+            {
+                record_seq(seq);
+                if (seq % 7 == 6)
+                {
+                    EventLog_Flush();
+                    committed = seq;
+                }
+            }
+            EventLog_Flush();
+            continue;                           /* 断电点在重启的挂载里, 不计 */
+        }
+        cuts++;
+        reboot();
+        rotations += log_gen > gen0 + 1;
+
+        CHECK(parse(pulled, pull(CHUNK)));
+        last = -1;
+        for (i = 0; i < nrecs; i++)
+        {
+            s = seq_of(&recs[i]);
+            if (s >= 0)
+            {
+                CHECK(s > last);
+                last = s;
+            }
+        }
+        CHECK(last >= (int32_t)committed);
+
+        record_seq(5000);
+        EventLog_Flush();
+        CHECK(parse(pulled, pull(CHUNK)));
+        CHECK_EQ(seq_of(&recs[nrecs - 1]), 5000);
+        CHECK_EQ(recs[nrecs - 2].id, EV_BOOT);
+        CHECK_EQ(sim_flash_errors, 0);
+    }
+    CHECK(cuts > 20);
+    printf("  power cut at each of %lu flash operations: %lu cuts, log file changed after %lu\n",
+           (unsigned long)ops, (unsigned long)cuts, (unsigned long)rotations);
+}
+
+/* decode_event_log.py 按 event_log_ids.h 还原文本 */
+static void test_decoder(void)
+{
+    static const uint8_t ip[4] = {192, 168, 1, 50};
+    static const uint8_t gw[4] = {192, 168, 1, 1};
+    static const char *const expect[] = {
+        "INFO  LOG_FILE             log file 1 (format 1)",
+        "INFO  BOOT                 boot, RCC_CSR reset flags 0x",
+        "INFO  ETH_ADDRESS          IP 192.168.1.50 gateway 192.168.1.1",
+        "ERROR OTA_FAILED           OTA failed (crc), 4096 bytes received",
+        "2026-10-18 08:00:00.000  INFO  TIME_STEP",
+        "2026-10-18 08:00:01.500  ERROR MODEM_CONNECT_FAIL   cellular TCP connect failed, +QIOPEN error 566 (Socket connect failed)",
+        "2026-10-18 08:00:02.000  WARN  LOG_DROPPED          3 events dropped, RAM ring full",
+    };
+    char line[256], out[2048];
+    uint32_t len, i, t0 = 1792310400;   /* 2026-10-18 08:00:00 UTC */
+    FILE *f;
+
+    setup();
+    stub_tick = 500;
+    EVENT_LOG2(ETH_ADDRESS, EVENT_LOG_IP(ip), EVENT_LOG_IP(gw));
+    EVENT_LOG2(OTA_FAILED, EventLog_Tag("crc"), 4096);
+    stub_tick = 1000;
+    EVENT_LOG3(TIME_STEP, t0, -250, 1);
+    stub_tick = 2500;
+    EVENT_LOG1(MODEM_CONNECT_FAIL, 566);
+    EventLog_Flush();
+    stub_tick = 3000;
+    Metrics_Slots[METRIC_EVENT_LOG_DROPS] += 3;
+    EventLog_Flush();
+
+    len = pull(CHUNK);
+    f = fopen("build/event_log.bin", "wb");
+    CHECK(f != NULL);
+    if (f == NULL)
+        return;
+    fwrite(pulled, 1, len, f);
+    fclose(f);
+
+    out[0] = '\0';
+    f = popen("python3 " DECODER " build/event_log.bin 2>&1", "r");
+    CHECK(f != NULL);
+    if (f == NULL)
+        return;
+    while (fgets(line, sizeof(line), f) != NULL && strlen(out) + strlen(line) < sizeof(out))
+        strcat(out, line);
+    CHECK_EQ(pclose(f), 0);
+    for (i = 0; i < sizeof(expect) / sizeof(expect[0]); i++)
+    {
+        if (strstr(out, expect[i]) == NULL)
+        {
+            CHECK(strstr(out, expect[i]) != NULL);
+            printf("  missing: %s\n%s", expect[i], out);
+        }
+    }
+    CHECK(strstr(out, "warning") == NULL);
+}
+
+/* 记录一个事件 (热路径) 和把事件写入文件的耗时 */
+static void test_bench(void)
+{
+    const uint32_t n = 2000000, batch = 32;
+    unsigned long long t0, rec1, rec4, off, drain;
+    uint32_t i, j;
+
+    setup();
+    t0 = test_now_ns();
+    for (i = 0; i < n; i += batch)
+    {
+        for (j = 0; j < batch; j++)
+            EVENT_LOG1(ETH_STATE, j);
+        log_tail = log_head;                    /* 只计记录, 不写入文件 */
+    }
+    rec1 = test_now_ns() - t0;
+
+    t0 = test_now_ns();
+    for (i = 0; i < n; i += batch)
+    {
+        for (j = 0; j < batch; j++)
+            EVENT_LOG3(OTA_BEGIN, j, i, 7);
+        log_tail = log_head;
+    }
+    rec4 = test_now_ns() - t0;
+
+    t0 = test_now_ns();
+    for (i = 0; i < n; i++)
+        EVENT_LOG1(MODEM_QIOPEN, i);            /* DEBUG, 低于默认级别 */
+    off = test_now_ns() - t0;
+    memset((uint32_t *)log_ring, 0, sizeof(log_ring));
+    CHECK_EQ(Metrics_Slots[METRIC_EVENT_LOG_DROPS], 0);
+
+    t0 = test_now_ns();
+    for (i = 0; i < 20000; i++)
+    {
+        EVENT_LOG1(ETH_STATE, i);
+        if (i % 10 == 9)
+            EventLog_Poll();
+    }
+    EventLog_Flush();
+    drain = test_now_ns() - t0;
+    CHECK_EQ(Metrics_Slots[METRIC_EVENT_LOG_DROPS], 0);
+
+    printf("  record: 1 arg %.1f ns, 3 args %.1f ns, filtered by level %.1f ns; "
+           "record + write to flash file %.2f us per event\n",
+           (double)rec1 / n, (double)rec4 / n, (double)off / n, (double)drain / 20000 / 1000);
+}
+
+int main(void)
+{
+    sim_flash_init();
+    TEST_RUN(test_boot);
+    TEST_RUN(test_ring_wrap);
+    TEST_RUN(test_ring_full);
+    TEST_RUN(test_preempted_writer);
+    TEST_RUN(test_level);
+    TEST_RUN(test_rotation);
+    TEST_RUN(test_pull_while_logging);
+    TEST_RUN(test_reboot);
+    TEST_RUN(test_power_cut);
+    TEST_RUN(test_decoder);
+    TEST_RUN(test_bench);
+    return test_summary("event_log");
+}
@@ -0,0 +1,499 @@
+/**
+  ******************************************************************************
+  * @file    test_flash_fs.c
+  * @brief   Flash File System: Power Cuts, Relocation Recovery, Erase Counts, Mount Time
+  ******************************************************************************
+  * @description
+  * flash_fs.c 和 flash_if.c 运行在 flash_sim.h 模拟的片内 Flash 上:
+  * - 一组操作 (新建/追加/替换/删除, 含跨页写入和静态磨损均衡的搬移) 在每一次擦写时断电,
+  *   重新挂载后每个文件是该操作之前或之后的内容 (追加可以只保留前一部分),
+  *   文件系统仍可写入, 再次挂载结果不变
+  * - 页头中的擦除次数与模拟器记录的实际擦除次数一致, 擦除中断电时最多多计一次
+  * - 挂载耗时 (主机上, 供比较)
+  ******************************************************************************
+  */
+
+#include "test.h"
+#include "flash_sim.h"
+#include "../../User/fs/flash_if.c"
+#include "../../User/fs/flash_fs.c"
+
+#define FS_PAGE_INDEX(p)        ((FS_PAGE_ADDR(p) - SIM_FLASH_BASE) / SIM_FLASH_PAGE)
+#define MODEL_FILES             6
+#define MODEL_SIZE              6000
+
+typedef enum {
+    OP_APPEND = 0,          /* 不存在时新建 */
+    OP_TRUNC,
+    OP_REMOVE
+} Op_t;
+
+typedef struct {
+    Op_t op;
+    const char *name;
+    uint16_t len;
+} Step_t;
+
+/* 文件内容的模型 */
+typedef struct {
+    const char *name;
+    uint8_t exists;
+    uint16_t len;
+    uint8_t data[MODEL_SIZE];
+} Model_File_t;
+
+/* cfg 和 empty 是冷数据, 空闲页预先磨损后搬移它们; empty 没有提交项 */
+static const Step_t script[] = {
+    { OP_APPEND, "cfg",   100 },
+    { OP_APPEND, "empty", 0 },
+    { OP_APPEND, "log",   700 },
+    { OP_APPEND, "log",   1500 },
+    { OP_TRUNC,  "cfg",   301 },
+    { OP_APPEND, "big",   4000 },
+    { OP_REMOVE, "log",   0 },
+    { OP_TRUNC,  "big",   2500 },
+    { OP_APPEND, "log",   33 },
+    { OP_TRUNC,  "empty", 0 },
+};
+#define STEPS                   (sizeof(script) / sizeof(script[0]))
+
+static Model_File_t model[STEPS + 1][MODEL_FILES];
+static uint8_t start_flash[SIM_FLASH_SIZE];
+static uint8_t buf[MODEL_SIZE];
+static uint32_t step_ops[STEPS + 1];    /* 第 k 步开始前累计的擦写次数 */
+static uint32_t relocations_seen;
+
+/* 第 n 个字节的内容, 同一文件的不同写入可区分 */
+static uint8_t pattern(const char *name, uint32_t seed, uint32_t n)
+{
+    return (uint8_t)(name[0] * 31 + seed * 7 + n * 13 + (n >> 8));
+}
+
+/* add: 没有时占用一个空位 */
+static Model_File_t *model_find(Model_File_t *m, const char *name, uint8_t add)
+{
+    uint8_t i;
+
+    for (i = 0; i < MODEL_FILES; i++)
+    {
+        if (m[i].name != NULL && strcmp(m[i].name, name) == 0)
+            return &m[i];
+    }
+    for (i = 0; add && i < MODEL_FILES; i++)
+    {
+        if (m[i].name == NULL)
+        {
+            m[i].name = name;
+            return &m[i];
+        }
+    }
+    return NULL;
+}
+
+/* 断电后重新上电挂载: RAM 状态全部丢失 */
+static void remount(void)
+{
+    sim_flash_power_on(0);
+    memset(fs_pages, 0, sizeof(fs_pages));
+    memset(fs_handles, 0, sizeof(fs_handles));
+    fs_relocations = 0;
+    fs_mounted = 0;
+    FS_Init();
+}
+
+/* 执行第 k 步, 数据的种子为步号 */
+static void run_step(uint32_t k)
+{
+    const Step_t *s = &script[k];
+    uint32_t i;
+    int8_t fd;
+
+    if (s->op == OP_REMOVE)
+    {
+        CHECK_EQ(FS_Remove(s->name), FS_OK);
+        return;
+    }
+    fd = FS_Open(s->name, s->op == OP_TRUNC ? FS_O_TRUNC : FS_O_APPEND);
+    CHECK(fd >= 0);
+    for (i = 0; i < s->len; i++)
+        buf[i] = pattern(s->name, k, i);
+    CHECK_EQ(FS_Write(fd, buf, s->len), s->len);
+    CHECK_EQ(FS_Close(fd), FS_OK);
+}
+
+/* 模型: model[k] 为前 k 步之后的内容 */
+static void build_model(void)
+{
+    Model_File_t *f;
+    uint32_t k, i;
+
+    memset(model, 0, sizeof(model));
+    for (k = 0; k < STEPS; k++)
+    {
+        memcpy(model[k + 1], model[k], sizeof(model[k]));
+        f = model_find(model[k + 1], script[k].name, 1);
+        if (script[k].op == OP_REMOVE)
+        {
+            f->exists = 0;
+            f->len = 0;
+            continue;
+        }
+        if (script[k].op == OP_TRUNC || !f->exists)
+            f->len = 0;
+        for (i = 0; i < script[k].len; i++)
+            f->data[f->len + i] = pattern(script[k].name, k, i);
+        f->len += script[k].len;
+        f->exists = 1;
+    }
+}
+
+/* 读出文件, 返回长度, 不存在时 -1 */
+static int32_t read_file(const char *name)
+{
+    int8_t fd = FS_Open(name, FS_O_READ);
+    int32_t n;
+
+    if (fd == FS_ERR_NOENT)
+        return -1;
+    CHECK(fd >= 0);
+    if (fd < 0)
+        return -1;
+    n = FS_Read(fd, buf, sizeof(buf));
+    CHECK_EQ(FS_Read(fd, buf + n, 1), 0);
+    FS_Close(fd);
+    return n;
+}
+
+static uint8_t same(const Model_File_t *m, int32_t n)
+{
+    if (n < 0)
+        return !m->exists;
+    return m->exists && (uint32_t)n == m->len && memcmp(buf, m->data, n) == 0;
+}
+
+/*
+ * 第 k 步中断电后的内容: 每个文件与第 k 步之前或之后一致;
+ * 追加时可以是之前的内容加上新数据的前一部分 (页写满时自动提交), 新建的文件可以为空
+ */
+static void check_state(uint32_t k)
+{
+    const Model_File_t *before, *after;
+    const Step_t *s = &script[k];
+    uint8_t cursor = 0, i, n_files = 0;
+    FS_Stat_t st;
+    int32_t n;
+    uint8_t ok;
+
+    for (i = 0; i < MODEL_FILES; i++)
+    {
+        after = &model[k + 1][i];
+        if (after->name == NULL)
+            continue;
+        before = &model[k][i];
+        n = read_file(after->name);
+        ok = same(before, n) || same(after, n);
+        if (!ok && s->op == OP_APPEND && strcmp(s->name, after->name) == 0 && n >= 0 &&
+            (uint32_t)n <= after->len && (uint32_t)n >= (before->exists ? before->len : 0))
+            ok = memcmp(buf, after->data, n) == 0;
+        if (!ok)
+            printf("  step %u (%s %s): file %s has %d bytes\n", (unsigned)k,
+                   s->op == OP_APPEND ? "append" : s->op == OP_TRUNC ? "trunc" : "remove",
+                   s->name, after->name, (int)n);
+        CHECK(ok);
+    }
+
+    /* 没有多出的文件 */
+    while (FS_List(&cursor, &st) == FS_OK)
+    {
+        n_files++;
+        CHECK(model_find(model[k + 1], st.name, 0) != NULL);
+    }
+    CHECK(n_files <= MODEL_FILES);
+}
+
+/* 擦除次数: 每页不少于实际擦除次数, 最多多一次 (擦除中断电) */
+static void check_erase_counts(uint32_t slack)
+{
+    uint8_t p;
+    uint32_t actual;
+
+    for (p = 0; p < FS_PAGES; p++)
+    {
+        actual = sim_flash_erases[FS_PAGE_INDEX(p)];
+        CHECK(fs_pages[p].erase_count >= actual);
+        CHECK(fs_pages[p].erase_count <= actual + slack);
+    }
+}
+
+/* 格式化后把空闲页的擦除次数改大, 使后面的分配触发静态磨损均衡 */
+static void prepare(void)
+{
+    uint8_t p;
+
+    sim_flash_reset();
+    remount();
+    CHECK_EQ(FS_Format(), FS_OK);
+    for (p = 4; p < FS_PAGES; p++)
+    {
+        *(uint32_t *)(sim_flash + (FS_PAGE_ADDR(p) - SIM_FLASH_BASE) + 4) = FS_WEAR_DELTA + 8;
+        sim_flash_erases[FS_PAGE_INDEX(p)] = FS_WEAR_DELTA + 8;
+    }
+    remount();
+    memcpy(start_flash, sim_flash, SIM_FLASH_SIZE);
+}
+
+/* 从准备好的状态上电, 执行全部步骤, cut 为第几次擦写时断电; 返回断电时所在的步, 未断电为 STEPS */
+static uint32_t run_script(uint32_t cut)
+{
+    static uint32_t erases[SIM_FLASH_PAGES];
+    volatile uint32_t k = 0;
+
+    memcpy(sim_flash, start_flash, SIM_FLASH_SIZE);
+    if (cut == 0)
+        memcpy(erases, sim_flash_erases, sizeof(erases));
+    else
+        memcpy(sim_flash_erases, erases, sizeof(erases));
+    remount();
+    sim_flash_power_on(cut);
+    if (setjmp(sim_flash_power))
+        return k;
+    for (k = 0; k < STEPS; k++)
+    {
+        if (cut == 0)
+            step_ops[k] = sim_flash_ops;
+        run_step(k);
+    }
+    if (cut == 0)
+    {
+        step_ops[STEPS] = sim_flash_ops;
+        relocations_seen = fs_relocations;
+    }
+    return STEPS;
+}
+
+/* 测试 ---------------------------------------------------------------------*/
+
+static void test_basic(void)
+{
+    FS_Info_t info;
+    uint32_t k;
+
+    build_model();
+    prepare();
+    CHECK_EQ(run_script(0), STEPS);
+    CHECK_EQ(sim_flash_errors, 0);
+    CHECK(relocations_seen >= 2);
+    check_state(STEPS - 1);
+    check_erase_counts(0);
+
+    /* 重新挂载后相同 */
+    remount();
+    check_state(STEPS - 1);
+    check_erase_counts(0);
+    FS_GetInfo(&info);
+    CHECK_EQ(info.pages, FS_PAGES);
+    CHECK_EQ(info.files, 4);
+    for (k = 0; k < STEPS; k++)
+        CHECK(step_ops[k + 1] > step_ops[k] || script[k].op == OP_REMOVE);
+}
+
+/* 追加 3 个字节后重新挂载, 文件是原内容加上这 3 个字节 */
+static void append_after_cut(const char *name)
+{
+    static uint8_t before[MODEL_SIZE];
+    int32_t n;
+    int8_t fd;
+
+    n = read_file(name);
+    if (n < 0)
+        n = 0;
+    memcpy(before, buf, n);
+    fd = FS_Open(name, FS_O_APPEND);
+    CHECK(fd >= 0);
+    CHECK_EQ(FS_Write(fd, "abc", 3), 3);
+    CHECK_EQ(FS_Close(fd), FS_OK);
+    remount();
+    CHECK_EQ(read_file(name), n + 3);
+    CHECK(memcmp(buf, before, n) == 0 && memcmp(buf + n, "abc", 3) == 0);
+    CHECK_EQ(sim_flash_errors, 0);
+}
+
+/* 每一次擦写时断电 */
+static void test_power_cut(void)
+{
+    uint32_t cut, k, total = step_ops[STEPS], runs = 0;
+    int8_t fd;
+
+    for (cut = 1; cut <= total; cut++)
+    {
+        k = run_script(cut);
+        CHECK(k < STEPS);
+        if (k >= STEPS)
+            break;
+        runs++;
+
+        remount();
+        check_state(k);
+        check_erase_counts(1);
+
+        /* 仍然可以写入, 再次挂载结果不变 */
+        fd = FS_Open("probe", FS_O_TRUNC);
+        CHECK(fd >= 0);
+        CHECK_EQ(FS_Write(fd, "probe", 5), 5);
+        CHECK_EQ(FS_Close(fd), FS_OK);
+        remount();
+        CHECK_EQ(read_file("probe"), 5);
+        CHECK_EQ(FS_Remove("probe"), FS_OK);
+        check_state(k);
+        CHECK_EQ(sim_flash_errors, 0);
+
+        /* 断电中的追加之后继续追加: 不能编程断电前写入但未提交的位置 */
+        if (script[k].op == OP_APPEND)
+            append_after_cut(script[k].name);
+        if (test_failures > 20)
+            break;
+    }
+    CHECK_EQ(runs, total);
+}
+
+/*
+ * 搬移空文件的第 0 块时在目标页写完 allocated、还没有写 committed 时断电:
+ * 两页提交项都为 0, 目标页编号更小先被扫描, 挂载必须保留文件 (保留的页补写 committed)
+ */
+static void test_relocate_empty_file(void)
+{
+    uint8_t f, last = FS_PAGES - 1;
+    int8_t fd;
+
+    sim_flash_reset();
+    remount();
+    CHECK_EQ(FS_Format(), FS_OK);
+    fd = FS_Open("e", FS_O_APPEND);
+    CHECK_EQ(FS_Close(fd), FS_OK);
+    f = FS_Lookup("e");
+    CHECK_EQ(fs_files[f].first, 0);
+
+    /* 先移到最后一页, 再手工完成搬回第 0 页的前一半 */
+    CHECK(FS_Relocate(0, last));
+    CHECK(FS_ErasePage(0));
+    CHECK(FS_WriteHeader(0, FS_HDR(last)->seq, 0, "e"));
+    CHECK(FS_HDR(0)->committed != FS_FLAG_SET);
+
+    remount();
+    CHECK_EQ(read_file("e"), 0);
+    f = FS_Lookup("e");
+    CHECK(f != FS_NONE);
+    if (f != FS_NONE)
+        CHECK_EQ(FS_HDR(fs_files[f].first)->committed, FS_FLAG_SET);
+
+    /* 再次挂载仍然存在 */
+    remount();
+    CHECK_EQ(read_file("e"), 0);
+    CHECK_EQ(sim_flash_errors, 0);
+}
+
+/*
+ * 擦除完成、页头未写时断电: 擦除次数从擦除次数页恢复为原值 + 1,
+ * 不按各页的最大值计 (第 0 页擦除 1 次, 其它页预先磨损到 40 次)
+ */
+static void test_erase_count_recovery(void)
+{
+    uint32_t before, i, cut = 0;
+
+    prepare();
+    before = fs_pages[0].erase_count;
+    CHECK(before < FS_WEAR_DELTA);
+
+    /* 先完整执行一次, 找到擦除之后的第一次编程 */
+    sim_flash_power_on(0);
+    CHECK(FS_ErasePage(0));
+    for (i = 0; i < sim_flash_ops && cut == 0; i++)
+    {
+        if (sim_flash_log_is_erase(i) && sim_flash_log_addr(i) == FS_PAGE_ADDR(0))
+            cut = i + 2;
+    }
+    CHECK(cut != 0);
+
+    memcpy(sim_flash, start_flash, SIM_FLASH_SIZE);
+    sim_flash_erases[FS_PAGE_INDEX(0)]--;
+    remount();
+    sim_flash_power_on(cut);
+    if (!setjmp(sim_flash_power))
+    {
+        FS_ErasePage(0);
+        CHECK(0);
+    }
+    CHECK(FS_HDR(0)->magic != FS_PAGE_MAGIC);
+    remount();
+    CHECK_EQ(fs_pages[0].erase_count, before + 1);
+    CHECK_EQ(fs_pages[0].erase_count, sim_flash_erases[FS_PAGE_INDEX(0)]);
+    CHECK_EQ(fs_pages[0].state, FS_PAGE_DIRTY);
+    CHECK_EQ(sim_flash_errors, 0);
+}
+
+/* 擦除次数页写满后擦除重来, 记录仍然有效 */
+static void test_wear_log_wrap(void)
+{
+    uint32_t i;
+    uint8_t p;
+
+    sim_flash_reset();
+    remount();
+    for (i = 0; i < FS_WEAR_SLOTS + 10; i++)
+        CHECK(FS_ErasePage((uint8_t)(i % FS_PAGES)));
+    CHECK_EQ(fs_wear_next, 10);
+    CHECK_EQ(sim_flash_erases[(FS_WEAR_ADDR - SIM_FLASH_BASE) / SIM_FLASH_PAGE], 2);
+    remount();
+    for (p = 0; p < FS_PAGES; p++)
+        CHECK_EQ(fs_pages[p].erase_count, sim_flash_erases[FS_PAGE_INDEX(p)]);
+    CHECK_EQ(fs_wear_next, 10);
+    CHECK_EQ(sim_flash_errors, 0);
+}
+
+/* 挂载耗时: 文件数达到上限且每页都有数据, 擦除次数页接近写满 */
+static void test_mount_bench(void)
+{
+    unsigned long long t0, t;
+    char name[8];
+    uint32_t i;
+    int8_t fd;
+    const uint32_t iters = 2000;
+
+    sim_flash_reset();
+    remount();
+    for (i = 0; i < FS_WEAR_SLOTS - 30; i++)
+        FS_ErasePage((uint8_t)(i % FS_PAGES));
+    for (i = 0; i < FS_MAX_FILES; i++)
+    {
+        snprintf(name, sizeof(name), "f%02u", (unsigned)i);
+        fd = FS_Open(name, FS_O_APPEND);
+        CHECK(fd >= 0);
+        memset(buf, (int)i, 700);
+        FS_Write(fd, buf, 700);
+        FS_Sync(fd);
+        FS_Write(fd, buf, 600);
+        FS_Close(fd);
+    }
+    remount();
+    CHECK_EQ(read_file("f07"), 1300);
+
+    t0 = test_now_ns();
+    for (i = 0; i < iters; i++)
+        FS_Mount();
+    t = test_now_ns() - t0;
+    printf("  mount: %u files, %u pages, %u wear records: %.1f us\n", (unsigned)FS_MAX_FILES,
+           (unsigned)FS_PAGES, (unsigned)fs_wear_next, (double)t / iters / 1000);
+    CHECK_EQ(read_file("f15"), 1300);
+}
+
+int main(void)
+{
+    sim_flash_init();
+    TEST_RUN(test_basic);
+    TEST_RUN(test_power_cut);
+    TEST_RUN(test_relocate_empty_file);
+    TEST_RUN(test_erase_count_recovery);
+    TEST_RUN(test_wear_log_wrap);
+    TEST_RUN(test_mount_bench);
+    return test_summary("flash_fs");
+}
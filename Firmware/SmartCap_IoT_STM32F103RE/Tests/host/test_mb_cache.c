@@ -0,0 +1,466 @@
+/**
+  ******************************************************************************
+  * @file    test_mb_cache.c
+  * @brief   Modbus Register Cache: Change Detection, Staleness, Synthetic Slaves
+  ******************************************************************************
+  * @description
+  * 直接驱动 mb_cache.c (网关中的调用点见 mb_gateway.c MB_CACHE_ENABLE 部分):
+  * - 变化检测: 首次全量上报, 之后只上报超过死区的寄存器, 连续的变化合并成一条记录,
+  *   超过 MB_REPORT_REGS_MAX 拆分; 死区与上次上报的值比较, 缓慢漂移最终也会上报
+  * - 缓存应答: 子区间命中, 超过最大年龄、轮询失败、异常应答后不再命中
+  * - 上报缓冲满时整条丢弃, 取出的记录完整且 CRC 正确
+  * 最后的仿真用三个合成从站 (设定值、带噪声的模拟量、计数器) 和周期读取的上游客户端,
+  * 报告缓存命中率、RS485 总线字节数 (透传对比缓存) 和上报字节数 (全量对比变化)。
+  ******************************************************************************
+  */
+
+#include "test.h"
+#include "../../User/modbus/mb_crc.c"
+#include "../../User/modbus/mb_cache.c"
+
+#define SIM_MS                  60000
+
+/* 合成从站的寄存器, 按区间下标 */
+static uint16_t slave_regs[3][64];
+
+/* 上报记录还原出的寄存器值 (平台侧) */
+static uint16_t cloud[MB_CACHE_REGS_MAX];
+static uint32_t records;
+
+static const MB_Cache_Range_t sim_ranges[] = {
+    {1, 0x03, 0x0000, 32, 1000, 0},     /* 设定值, 很少变化 */
+    {2, 0x04, 0x0000, 16, 500, 5},      /* 模拟量, 噪声 +-3, 缓慢上升 */
+    {3, 0x04, 0x0064, 40, 1000, 0},     /* 计数器, 两个寄存器每秒加一 */
+};
+
+static void reset(void)
+{
+    entry_num = 0;
+    poll_next = 0;
+    memset(regs, 0, sizeof(regs));
+    memset(last_reported, 0, sizeof(last_reported));
+    max_age_ms = MB_CACHE_MAX_AGE_MS;
+    report_head = report_tail = 0;
+    memset(&stats, 0, sizeof(stats));
+    memset(cloud, 0, sizeof(cloud));
+    records = 0;
+    stub_tick = 1000;
+}
+
+static void make_req(uint8_t *pdu, uint8_t func, uint16_t start, uint16_t count)
+{
+    pdu[0] = func;
+    pdu[1] = (uint8_t)(start >> 8);
+    pdu[2] = (uint8_t)start;
+    pdu[3] = (uint8_t)(count >> 8);
+    pdu[4] = (uint8_t)count;
+}
+
+/* 从站应答 PDU: 功能码 + 字节数 + 数据 */
+static uint8_t make_resp(uint8_t *resp, uint8_t func, const uint16_t *values, uint16_t count)
+{
+    uint16_t i;
+
+    resp[0] = func;
+    resp[1] = (uint8_t)(count * 2);
+    for (i = 0; i < count; i++)
+    {
+        resp[2 + i * 2] = (uint8_t)(values[i] >> 8);
+        resp[3 + i * 2] = (uint8_t)values[i];
+    }
+    return (uint8_t)(2 + count * 2);
+}
+
+static void update(uint8_t unit, uint8_t func, uint16_t start, const uint16_t *values, uint16_t count)
+{
+    uint8_t req[5], resp[256], len;
+
+    make_req(req, func, start, count);
+    len = make_resp(resp, func, values, count);
+    MB_Cache_Update(unit, req, resp, len);
+}
+
+/* 取出全部上报记录, 校验格式并写入 cloud; 返回本次取出的寄存器数 */
+static uint32_t drain(void)
+{
+    uint8_t rec[MB_REPORT_LEN_MAX];
+    uint16_t len, addr, i;
+    uint32_t n = 0;
+    uint8_t r;
+
+    while ((len = MB_Cache_TakeReport(rec)) > 0)
+    {
+        CHECK_EQ(rec[0], MB_REPORT_SYNC);
+        CHECK_EQ(rec[1], len);
+        CHECK_EQ(len, MB_REPORT_HDR_LEN + rec[6] * 2 + 2);
+        CHECK(rec[6] > 0 && rec[6] <= MB_REPORT_REGS_MAX);
+        CHECK(MB_CRC16_Check(rec, len));
+        addr = (uint16_t)((rec[4] << 8) | rec[5]);
+        for (r = 0; r < entry_num; r++)
+        {
+            if (entries[r].cfg.unit == rec[2] && entries[r].cfg.func == rec[3] &&
+                addr >= entries[r].cfg.start && addr + rec[6] <= entries[r].cfg.start + entries[r].cfg.count)
+                break;
+        }
+        CHECK(r < entry_num);
+        if (r == entry_num)
+            continue;
+        for (i = 0; i < rec[6]; i++)
+            cloud[entries[r].offset + addr - entries[r].cfg.start + i] = (uint16_t)((rec[7 + i * 2] << 8) | rec[8 + i * 2]);
+        n += rec[6];
+        records++;
+    }
+    return n;
+}
+
+/* 测试 ---------------------------------------------------------------------*/
+
+static void test_init(void)
+{
+    static const MB_Cache_Range_t bad[] = {
+        {1, 0x03, 0, 0, 1000, 0},           /* 数量为 0 */
+        {1, 0x03, 0, 126, 1000, 0},         /* 超过 125 */
+        {1, 0x06, 0, 4, 1000, 0},           /* 不是读功能码 */
+        {1, 0x03, 0, 120, 1000, 0},
+        {2, 0x03, 0, 10, 1000, 0},          /* 寄存器池不够 */
+        {3, 0x04, 0, 8, 1000, 0},
+    };
+
+    reset();
+    CHECK_EQ(MB_Cache_Init(bad, 6), 2);
+    CHECK_EQ(entries[0].cfg.count, 120);
+    CHECK_EQ(entries[1].cfg.unit, 3);
+    CHECK_EQ(entries[1].offset, 120);
+}
+
+/* 首次全量, 之后只报变化; 连续变化合并, 不连续的分成多条 */
+static void test_change_detection(void)
+{
+    static const MB_Cache_Range_t r = {1, 0x03, 0x0010, 30, 1000, 0};
+    uint16_t v[30];
+    uint8_t rec[MB_REPORT_LEN_MAX];
+    uint16_t i;
+
+    reset();
+    CHECK_EQ(MB_Cache_Init(&r, 1), 1);
+    for (i = 0; i < 30; i++)
+        v[i] = (uint16_t)(100 + i);
+
+    /* 首次: 30 个寄存器拆成 24 + 6 两条 */
+    update(1, 0x03, 0x0010, v, 30);
+    CHECK_EQ(drain(), 30);
+    CHECK_EQ(records, 2);
+    for (i = 0; i < 30; i++)
+        CHECK_EQ(cloud[i], v[i]);
+
+    /* 没有变化: 不上报 */
+    update(1, 0x03, 0x0010, v, 30);
+    CHECK_EQ(MB_Cache_TakeReport(rec), 0);
+
+    /* 寄存器 3,4,5 和 20 变化: 两条记录 */
+    v[3]++;
+    v[4]++;
+    v[5] += 1000;
+    v[20] = 0;
+    update(1, 0x03, 0x0010, v, 30);
+    CHECK_EQ(MB_Cache_TakeReport(rec), MB_REPORT_HDR_LEN + 3 * 2 + 2);
+    CHECK_EQ((rec[4] << 8) | rec[5], 0x0013);
+    CHECK_EQ(rec[6], 3);
+    CHECK_EQ((rec[11] << 8) | rec[12], v[5]);
+    CHECK_EQ(MB_Cache_TakeReport(rec), MB_REPORT_HDR_LEN + 1 * 2 + 2);
+    CHECK_EQ((rec[4] << 8) | rec[5], 0x0010 + 20);
+    CHECK_EQ(MB_Cache_TakeReport(rec), 0);
+
+    MB_Cache_Stats_t st;
+    MB_Cache_GetStats(&st);
+    CHECK_EQ(st.changes, 34);
+    CHECK_EQ(st.uplink_bytes_full, 3 * (2 * (MB_REPORT_HDR_LEN + 2) + 60));
+}
+
+/* 死区与上次上报的值比较: 噪声不上报, 缓慢漂移累计超过死区后上报; 回绕按差值计算 */
+static void test_deadband(void)
+{
+    static const MB_Cache_Range_t r = {2, 0x04, 0, 2, 500, 5};
+    uint16_t v[2] = {1000, 0};
+    uint32_t reports = 0;
+    uint16_t i;
+
+    reset();
+    MB_Cache_Init(&r, 1);
+    update(2, 0x04, 0, v, 2);
+    CHECK_EQ(drain(), 2);
+
+    /* 噪声 +-5 以内 */
+    for (i = 0; i < 20; i++)
+    {
+        v[0] = (uint16_t)(1000 + (i % 2 ? 5 : -5));
+        update(2, 0x04, 0, v, 2);
+    }
+    CHECK_EQ(drain(), 0);
+
+    /* 每次漂移 1: 第 6 次超过死区, 之后每 6 次上报一次 */
+    v[0] = 1000;
+    for (i = 1; i <= 18; i++)
+    {
+        v[0] = (uint16_t)(1000 + i);
+        update(2, 0x04, 0, v, 2);
+        reports += drain();
+    }
+    CHECK_EQ(reports, 3);
+    CHECK_EQ(cloud[0], 1018);
+
+    /* 0 -> 65535 的差值是 65535, 超过死区 */
+    v[1] = 65535;
+    update(2, 0x04, 0, v, 2);
+    CHECK_EQ(drain(), 1);
+    CHECK_EQ(cloud[1], 65535);
+}
+
+/* 子区间命中; 过期、异常应答、轮询失败后不再命中; 其它从站/功能码/越界不命中 */
+static void test_lookup(void)
+{
+    static const MB_Cache_Range_t r[] = {
+        {1, 0x03, 0x0100, 10, 1000, 0},
+        {1, 0x04, 0x0100, 10, 1000, 0},
+    };
+    uint16_t v[10];
+    uint8_t req[5], resp[256], exc[2] = {0x83, 0x02};
+    uint16_t i;
+    MB_Cache_Stats_t st;
+
+    reset();
+    MB_Cache_Init(r, 2);
+    make_req(req, 0x03, 0x0102, 3);
+    CHECK_EQ(MB_Cache_Lookup(1, req, 5, resp), 0);         /* 还没有数据 */
+
+    for (i = 0; i < 10; i++)
+        v[i] = (uint16_t)(0x1100 + i);
+    update(1, 0x03, 0x0100, v, 10);
+    CHECK_EQ(MB_Cache_Lookup(1, req, 5, resp), 8);
+    CHECK_EQ(resp[0], 0x03);
+    CHECK_EQ(resp[1], 6);
+    CHECK_EQ((resp[2] << 8) | resp[3], 0x1102);
+    CHECK_EQ((resp[6] << 8) | resp[7], 0x1104);
+
+    make_req(req, 0x03, 0x0100, 10);
+    CHECK_EQ(MB_Cache_Lookup(1, req, 5, resp), 22);
+    make_req(req, 0x03, 0x0108, 3);                         /* 越过区间末尾 */
+    CHECK_EQ(MB_Cache_Lookup(1, req, 5, resp), 0);
+    make_req(req, 0x03, 0x00FF, 2);                         /* 在区间之前 */
+    CHECK_EQ(MB_Cache_Lookup(1, req, 5, resp), 0);
+    make_req(req, 0x04, 0x0100, 2);                         /* 04 区间还没有数据 */
+    CHECK_EQ(MB_Cache_Lookup(1, req, 5, resp), 0);
+    make_req(req, 0x03, 0x0100, 2);
+    CHECK_EQ(MB_Cache_Lookup(2, req, 5, resp), 0);          /* 其它从站 */
+    CHECK_EQ(MB_Cache_Lookup(1, req, 4, resp), 0);          /* PDU 长度不对 */
+    make_req(req, 0x03, 0x0100, 0);
+    CHECK_EQ(MB_Cache_Lookup(1, req, 5, resp), 0);
+
+    /* 数据年龄: 等于上限仍命中, 超过后转发 */
+    make_req(req, 0x03, 0x0100, 2);
+    stub_tick += MB_CACHE_MAX_AGE_MS;
+    CHECK(MB_Cache_Lookup(1, req, 5, resp) > 0);
+    stub_tick++;
+    CHECK_EQ(MB_Cache_Lookup(1, req, 5, resp), 0);
+    MB_Cache_SetMaxAge(10000);
+    CHECK(MB_Cache_Lookup(1, req, 5, resp) > 0);
+
+    /* 异常应答使缓存失效, 下一次正常应答恢复 */
+    make_req(req, 0x03, 0x0100, 10);
+    MB_Cache_Update(1, req, exc, 2);
+    CHECK_EQ(MB_Cache_Lookup(1, req, 5, resp), 0);
+    update(1, 0x03, 0x0100, v, 10);
+    CHECK(MB_Cache_Lookup(1, req, 5, resp) > 0);
+
+    /* 轮询超时 */
+    MB_Cache_PollFailed(1, req);
+    CHECK_EQ(MB_Cache_Lookup(1, req, 5, resp), 0);
+
+    /* 与区间不完全一致的应答不更新缓存 */
+    make_req(req, 0x03, 0x0100, 5);
+    update(1, 0x03, 0x0100, v, 5);
+    CHECK_EQ(MB_Cache_Lookup(1, req, 5, resp), 0);
+
+    MB_Cache_GetStats(&st);
+    CHECK_EQ(st.hits, 5);
+    CHECK_EQ(st.poll_errors, 2);
+    CHECK_EQ(st.bus_bytes_saved, (8 + 5 + 6) + 2 * (8 + 5 + 20) + 2 * (8 + 5 + 4));
+}
+
+/* 按周期轮转轮询, 同时到期的区间依次返回 */
+static void test_poll_schedule(void)
+{
+    uint8_t unit, pdu[5];
+    uint32_t count[3] = {0}, t;
+
+    reset();
+    MB_Cache_Init(sim_ranges, 3);
+    for (t = 0; t < 10000; t++)
+    {
+        while (MB_Cache_NextPoll(&unit, pdu))
+        {
+            CHECK(unit >= 1 && unit <= 3);
+            count[unit - 1]++;
+            CHECK_EQ(pdu[0], sim_ranges[unit - 1].func);
+            CHECK_EQ((pdu[1] << 8) | pdu[2], sim_ranges[unit - 1].start);
+            CHECK_EQ((pdu[3] << 8) | pdu[4], sim_ranges[unit - 1].count);
+        }
+        stub_tick++;
+    }
+    CHECK_EQ(count[0], 10);
+    CHECK_EQ(count[1], 20);
+    CHECK_EQ(count[2], 10);
+}
+
+/* 上报缓冲满: 放不下的记录整条丢弃, 已有记录仍完整 */
+static void test_ring_full(void)
+{
+    static const MB_Cache_Range_t r = {1, 0x03, 0, 24, 1000, 0};
+    uint16_t v[24];
+    uint16_t i, n, fit;
+    MB_Cache_Stats_t st;
+
+    reset();
+    MB_Cache_Init(&r, 1);
+    fit = (MB_REPORT_RING_SIZE - 1) / MB_REPORT_LEN_MAX;
+    for (n = 0; n < fit + 3; n++)
+    {
+        for (i = 0; i < 24; i++)
+            v[i] = (uint16_t)(n * 100 + i + 1);
+        update(1, 0x03, 0, v, 24);
+    }
+    MB_Cache_GetStats(&st);
+    CHECK_EQ(st.report_dropped, 3);
+    CHECK_EQ(drain(), fit * 24);
+    CHECK_EQ(records, fit);
+    CHECK_EQ(cloud[0], (fit - 1) * 100 + 1);
+
+    /* 取空后可以继续写入 */
+    v[0]++;
+    update(1, 0x03, 0, v, 24);
+    CHECK_EQ(drain(), 1);
+}
+
+/*
+ * 合成从站仿真: 网关每 ms 取到期的轮询 (总线空闲时立即完成), 上游客户端周期读取;
+ * 未命中的读取转发给从站。结束时平台侧的值与从站的差不超过死区。
+ */
+static void test_synthetic_slaves(void)
+{
+    static const struct {
+        uint8_t unit;
+        uint8_t func;
+        uint16_t start;
+        uint16_t count;
+        uint16_t period_ms;
+    } reads[] = {
+        {1, 0x03, 0x0000, 10, 200},         /* HMI 刷新设定值 */
+        {2, 0x04, 0x0004, 4, 500},
+        {3, 0x04, 0x0064, 40, 1000},
+        {1, 0x03, 0x0040, 6, 2000},         /* 不在缓存区间内 */
+    };
+    uint8_t unit, pdu[5], resp[256], len, r, k;
+    uint32_t t, rng = 1, client_reads = 0;
+    uint32_t bus_transparent = 0, bus_cached = 0, hit_bytes = 0;
+    uint16_t i, noise;
+    MB_Cache_Stats_t st;
+
+    reset();
+    CHECK_EQ(MB_Cache_Init(sim_ranges, 3), 3);
+    memset(slave_regs, 0, sizeof(slave_regs));
+    for (i = 0; i < 32; i++)
+        slave_regs[0][i] = (uint16_t)(500 + i);
+
+    for (t = 0; t < SIM_MS; t++, stub_tick++)
+    {
+        /* 从站数据变化 */
+        if (t % 10000 == 0)
+            slave_regs[0][t / 10000 % 32] += 10;
+        if (t % 100 == 0)
+        {
+            for (i = 0; i < 16; i++)
+            {
+                rng = rng * 1103515245UL + 12345UL;
+                noise = (uint16_t)((rng >> 16) % 7);
+                slave_regs[1][i] = (uint16_t)(2000 + t / 1000 + noise - 3);
+            }
+        }
+        if (t % 1000 == 0)
+        {
+            slave_regs[2][0]++;
+            slave_regs[2][1] += 3;
+        }
+
+        /* 网关轮询 */
+        while (MB_Cache_NextPoll(&unit, pdu))
+        {
+            len = make_resp(resp, pdu[0], slave_regs[unit - 1], sim_ranges[unit - 1].count);
+            MB_Cache_Update(unit, pdu, resp, len);
+            bus_cached += 8 + 5 + sim_ranges[unit - 1].count * 2;
+        }
+        drain();
+
+        /* 上游读取 */
+        for (k = 0; k < sizeof(reads) / sizeof(reads[0]); k++)
+        {
+            if (t % reads[k].period_ms != 0)
+                continue;
+            client_reads++;
+            bus_transparent += 8 + 5 + reads[k].count * 2;
+            make_req(pdu, reads[k].func, reads[k].start, reads[k].count);
+            len = MB_Cache_Lookup(reads[k].unit, pdu, 5, resp);
+            if (len == 0)
+            {
+                bus_cached += 8 + 5 + reads[k].count * 2;
+                continue;
+            }
+            hit_bytes += 8 + 5 + reads[k].count * 2;
+            /* 命中的数据就是最近一次轮询的结果 */
+            for (r = 0; r < 3 && sim_ranges[r].unit != reads[k].unit; r++)
+                ;
+            for (i = 0; i < reads[k].count; i++)
+            {
+                uint16_t got = (uint16_t)((resp[2 + i * 2] << 8) | resp[3 + i * 2]);
+                CHECK_EQ(got, regs[entries[r].offset + reads[k].start - sim_ranges[r].start + i]);
+            }
+        }
+    }
+
+    /* 平台侧的值与最后一次轮询的差不超过死区 */
+    for (r = 0; r < 3; r++)
+    {
+        for (i = 0; i < sim_ranges[r].count; i++)
+        {
+            uint16_t a = cloud[entries[r].offset + i];
+            uint16_t b = regs[entries[r].offset + i];
+            CHECK((a >= b ? a - b : b - a) <= sim_ranges[r].deadband);
+        }
+    }
+
+    MB_Cache_GetStats(&st);
+    CHECK_EQ(st.hits + st.misses, client_reads);
+    CHECK_EQ(st.misses, SIM_MS / 2000);
+    CHECK_EQ(st.poll_errors, 0);
+    CHECK_EQ(st.report_dropped, 0);
+    CHECK(st.uplink_bytes_sent * 5 < st.uplink_bytes_full);
+    CHECK(bus_cached < bus_transparent);
+    CHECK_EQ(st.bus_bytes_saved, hit_bytes);
+
+    printf("  %u s, %lu client reads: hit rate %lu%%, RS485 %lu bytes transparent vs %lu cached, "
+           "uplink %lu bytes full vs %lu changes\n", SIM_MS / 1000, (unsigned long)client_reads,
+           (unsigned long)(st.hits * 100 / client_reads), (unsigned long)bus_transparent,
+           (unsigned long)bus_cached, (unsigned long)st.uplink_bytes_full,
+           (unsigned long)st.uplink_bytes_sent);
+}
+
+int main(void)
+{
+    TEST_RUN(test_init);
+    TEST_RUN(test_change_detection);
+    TEST_RUN(test_deadband);
+    TEST_RUN(test_lookup);
+    TEST_RUN(test_poll_schedule);
+    TEST_RUN(test_ring_full);
+    TEST_RUN(test_synthetic_slaves);
+    return test_summary("mb_cache");
+}
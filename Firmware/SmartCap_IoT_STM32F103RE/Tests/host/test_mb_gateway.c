@@ -0,0 +1,741 @@
+/**
+  ******************************************************************************
+  * @file    test_mb_gateway.c
+  * @brief   Modbus TCP <-> RTU Gateway Against a Simulated RTU Slave
+  ******************************************************************************
+  * @description
+  * W5500 socket、发送队列和 RS485 由本文件模拟:
+  * - 客户端数据写入 sock[].up, 网关经 recv 读取; 网关的应答经 wiz_txq_write 写入 sock[].down
+  * - RS485_SendByte 按波特率推进模拟时间 (发送是阻塞的), RS485_SetReceiveMode 时
+  *   从站解析请求, 经过应答延时后按波特率逐字节交给 MB_Gateway_RxByte
+  * - sim_step 模拟网关任务的一次循环 (osDelay(1)) 和 RS485 接收任务
+  *
+  * 最后的基准测试报告模拟时间下的事务/秒和每个请求的延迟 (客户端发出到收到应答),
+  * 以及网关代码在主机上每个事务消耗的 CPU 时间。
+  ******************************************************************************
+  */
+
+#include "test.h"
+#include "../../User/modbus/mb_crc.c"
+#include "../../User/modbus/mb_gateway.c"
+
+#define SIM_BUF                 4096
+#define SIM_TURNAROUND_US       2000    /* 从站收到请求到开始应答 */
+
+typedef struct {
+    uint8_t sr;                         /* Sn_SR */
+    uint8_t up[SIM_BUF];                /* 客户端 -> 网关, 尚未被 recv 读走 */
+    uint16_t up_len;
+    uint8_t down[SIM_BUF];              /* 网关 -> 客户端 */
+    uint16_t down_len;
+} sim_sock_t;
+
+typedef struct {
+    uint8_t alive;
+    uint8_t corrupt;                    /* 接下来 n 个应答的 CRC 出错 */
+} sim_slave_t;
+
+static sim_sock_t sock[8];
+static sim_slave_t slaves[248];
+
+static uint64_t sim_us;
+static uint32_t byte_us;
+
+static uint8_t bus_req[MB_RTU_BUF_SIZE];
+static uint16_t bus_req_len;
+static uint8_t bus_busy;
+static uint32_t bus_frames;
+static uint32_t bus_frame_ms[16];
+static uint32_t bus_stray;              /* 网关不接收的应答字节 */
+
+static uint8_t resp[MB_RTU_BUF_SIZE];
+static uint16_t resp_len, resp_pos;
+static uint64_t resp_start_us;
+
+static unsigned long long gw_ns;
+
+/* 模拟时间 ---------------------------------------------------------------*/
+
+/* osDelay 桩直接推进 stub_tick, 这里把微秒时间追上 */
+static void sim_sync(void)
+{
+    if ((uint64_t)stub_tick * 1000 > sim_us)
+        sim_us = (uint64_t)stub_tick * 1000;
+}
+
+static void sim_advance_us(uint32_t us)
+{
+    sim_sync();
+    sim_us += us;
+    stub_tick = (uint32_t)(sim_us / 1000);
+}
+
+/* W5500 / 发送队列 ---------------------------------------------------------*/
+
+uint8_t WIZCHIP_READ(uint32_t addr)
+{
+    uint8_t sn;
+
+    for (sn = 0; sn < 8; sn++)
+    {
+        if (addr == (uint32_t)Sn_SR(sn))
+            return sock[sn].sr;
+    }
+    return 0;
+}
+
+uint16_t getSn_RX_RSR(uint8_t sn)
+{
+    return sock[sn].up_len;
+}
+
+int32_t recv(uint8_t sn, uint8_t *buf, uint16_t len)
+{
+    sim_sock_t *s = &sock[sn];
+
+    if (len > s->up_len)
+        len = s->up_len;
+    memcpy(buf, s->up, len);
+    s->up_len -= len;
+    memmove(s->up, &s->up[len], s->up_len);
+    return len;
+}
+
+int8_t socket(uint8_t sn, uint8_t protocol, uint16_t port, uint8_t flag)
+{
+    sock[sn].sr = SOCK_INIT;
+    return (int8_t)sn;
+}
+
+int8_t listen(uint8_t sn)
+{
+    sock[sn].sr = SOCK_LISTEN;
+    return SOCK_OK;
+}
+
+int8_t close(uint8_t sn)
+{
+    sock[sn].sr = SOCK_CLOSED;
+    sock[sn].up_len = 0;
+    return SOCK_OK;
+}
+
+int8_t wiz_txq_open(uint8_t sn, uint8_t *buf, uint16_t size)
+{
+    return 0;
+}
+
+void wiz_txq_close(uint8_t sn)
+{
+}
+
+int32_t wiz_txq_write(uint8_t sn, const uint8_t *data, uint16_t len, uint32_t timeout_ms)
+{
+    sim_sock_t *s = &sock[sn];
+
+    if (s->sr != SOCK_ESTABLISHED)
+        return WIZ_TXQ_ERR_CLOSED;
+    if (s->down_len + len > SIM_BUF)
+        return WIZ_TXQ_ERR_TIMEOUT;
+    memcpy(&s->down[s->down_len], data, len);
+    s->down_len += len;
+    return len;
+}
+
+uint16_t wiz_txq_poll_socket(uint8_t sn)
+{
+    return 0;
+}
+
+wiz_sup_state_t wiz_supervisor_get_state(void)
+{
+    return WIZ_SUP_STATE_UP;
+}
+
+void Metrics_Observe(Metrics_Hist_t hist, uint32_t value)
+{
+}
+
+/* RS485 和模拟从站 --------------------------------------------------------*/
+
+/* 寄存器值: 高字节为从站地址, 低字节为寄存器地址 */
+static uint16_t slave_reg(uint8_t unit, uint16_t addr)
+{
+    return (uint16_t)((unit << 8) | (addr & 0xFF));
+}
+
+static void slave_handle(void)
+{
+    uint8_t unit = bus_req[0];
+    uint16_t start, count, i, crc;
+
+    if (bus_req_len < 4 || !MB_CRC16_Check(bus_req, bus_req_len))
+        return;
+    if (unit == 0 || !slaves[unit].alive)
+        return;
+
+    resp_len = 0;
+    resp[resp_len++] = unit;
+    switch (bus_req[1])
+    {
+    case 0x03:
+    case 0x04:
+        start = MB_Rd16(&bus_req[2]);
+        count = MB_Rd16(&bus_req[4]);
+        resp[resp_len++] = bus_req[1];
+        resp[resp_len++] = (uint8_t)(count * 2);
+        for (i = 0; i < count; i++)
+        {
+            resp[resp_len++] = (uint8_t)(slave_reg(unit, start + i) >> 8);
+            resp[resp_len++] = (uint8_t)slave_reg(unit, start + i);
+        }
+        break;
+
+    case 0x06:
+        memcpy(&resp[resp_len], &bus_req[1], 5);
+        resp_len += 5;
+        break;
+
+    default:
+        resp[resp_len++] = bus_req[1] | 0x80;
+        resp[resp_len++] = 0x01;
+        break;
+    }
+    crc = MB_CRC16(resp, resp_len);
+    resp[resp_len++] = (uint8_t)crc;
+    resp[resp_len++] = (uint8_t)(crc >> 8);
+    if (slaves[unit].corrupt > 0)
+    {
+        slaves[unit].corrupt--;
+        resp[resp_len - 1] ^= 0x01;
+    }
+    resp_pos = 0;
+    resp_start_us = sim_us + SIM_TURNAROUND_US;
+}
+
+void RS485_SetTransmitMode(void)
+{
+    bus_req_len = 0;
+}
+
+void RS485_SendByte(uint8_t data)
+{
+    if (bus_req_len < sizeof(bus_req))
+        bus_req[bus_req_len++] = data;
+    sim_advance_us(byte_us);
+}
+
+void RS485_SetReceiveMode(void)
+{
+    if (bus_frames < sizeof(bus_frame_ms) / sizeof(bus_frame_ms[0]))
+        bus_frame_ms[bus_frames] = stub_tick;
+    bus_frames++;
+    slave_handle();
+}
+
+uint8_t RS485_AcquireBus(uint32_t timeout_ms)
+{
+    if (bus_busy)
+        return 0;
+    bus_busy = 1;
+    return 1;
+}
+
+void RS485_ReleaseBus(void)
+{
+    bus_busy = 0;
+}
+
+/* 网关任务一次循环 + RS485 接收任务 */
+static void sim_step(void)
+{
+    unsigned long long t0 = test_now_ns();
+
+    sim_sync();
+    while (resp_pos < resp_len && resp_start_us + (uint64_t)resp_pos * byte_us <= sim_us)
+    {
+        if (!MB_Gateway_RxByte(resp[resp_pos]))
+            bus_stray++;
+        resp_pos++;
+    }
+    MB_TCP_Poll();
+    MB_RTU_Poll();
+    gw_ns += test_now_ns() - t0;
+    sim_advance_us(1000);
+}
+
+static void run_ms(uint32_t ms)
+{
+    while (ms--)
+        sim_step();
+}
+
+/* 客户端 -------------------------------------------------------------------*/
+
+static void client_send(uint8_t c, uint16_t tid, uint16_t proto, uint8_t unit,
+                        const uint8_t *pdu, uint8_t pdu_len)
+{
+    sim_sock_t *s = &sock[MB_TCP_SOCK_FIRST + c];
+    uint8_t *p = &s->up[s->up_len];
+
+    p[0] = (uint8_t)(tid >> 8);
+    p[1] = (uint8_t)tid;
+    p[2] = (uint8_t)(proto >> 8);
+    p[3] = (uint8_t)proto;
+    p[4] = 0;
+    p[5] = (uint8_t)(pdu_len + 1);
+    p[6] = unit;
+    memcpy(&p[MB_MBAP_LEN], pdu, pdu_len);
+    s->up_len += MB_MBAP_LEN + pdu_len;
+}
+
+static void client_read(uint8_t c, uint16_t tid, uint8_t unit, uint16_t start, uint16_t count)
+{
+    uint8_t pdu[5] = { 0x03, (uint8_t)(start >> 8), (uint8_t)start, (uint8_t)(count >> 8), (uint8_t)count };
+
+    client_send(c, tid, 0, unit, pdu, sizeof(pdu));
+}
+
+/* 取出一帧应答, 返回 PDU 长度, 0 表示没有 */
+static uint8_t client_take(uint8_t c, uint16_t *tid, uint8_t *unit, uint8_t *pdu)
+{
+    sim_sock_t *s = &sock[MB_TCP_SOCK_FIRST + c];
+    uint16_t flen;
+    uint8_t pdu_len;
+
+    if (s->down_len < MB_MBAP_LEN)
+        return 0;
+    CHECK_EQ(MB_Rd16(&s->down[2]), 0);
+    pdu_len = (uint8_t)(MB_Rd16(&s->down[4]) - 1);
+    flen = MB_MBAP_LEN + pdu_len;
+    CHECK(s->down_len >= flen);
+    *tid = MB_Rd16(&s->down[0]);
+    *unit = s->down[6];
+    memcpy(pdu, &s->down[MB_MBAP_LEN], pdu_len);
+    s->down_len -= flen;
+    memmove(s->down, &s->down[flen], s->down_len);
+    return pdu_len;
+}
+
+/* 检查 03 读应答的数据 */
+static int read_ok(uint8_t unit, const uint8_t *pdu, uint8_t pdu_len, uint16_t start, uint16_t count)
+{
+    uint16_t i;
+
+    if (pdu_len != 2 + count * 2 || pdu[0] != 0x03 || pdu[1] != count * 2)
+        return 0;
+    for (i = 0; i < count; i++)
+    {
+        if (MB_Rd16(&pdu[2 + i * 2]) != slave_reg(unit, start + i))
+            return 0;
+    }
+    return 1;
+}
+
+static void reset(uint32_t baud)
+{
+    uint8_t i;
+
+    memset(conns, 0, sizeof(conns));
+    memset(reqs, 0, sizeof(reqs));
+    memset(slave_q, 0, sizeof(slave_q));
+    memset(&stats, 0, sizeof(stats));
+    rr_next = 0;
+    rtu_state = RTU_IDLE;
+    rtu_req = -1;
+    rtu_retry = 0;
+    rtu_rx_len = 0;
+    rtu_listening = 0;
+
+    memset(sock, 0, sizeof(sock));
+    memset(slaves, 0, sizeof(slaves));
+    slaves[1].alive = slaves[2].alive = slaves[3].alive = 1;
+    bus_busy = 0;
+    bus_frames = 0;
+    bus_stray = 0;
+    resp_len = resp_pos = 0;
+    sim_us = 0;
+    stub_tick = 0;
+    byte_us = 10000000U / baud;  // 8N1, 10 位
+
+    /* 打开监听, 两个客户端连入 */
+    run_ms(1);
+    for (i = 0; i < MB_TCP_SOCK_NUM; i++)
+    {
+        CHECK_EQ(sock[MB_TCP_SOCK_FIRST + i].sr, SOCK_LISTEN);
+        sock[MB_TCP_SOCK_FIRST + i].sr = SOCK_ESTABLISHED;
+    }
+    run_ms(1);
+}
+
+/* 测试 ---------------------------------------------------------------------*/
+
+static uint16_t crc_bitwise(const uint8_t *p, uint16_t len)
+{
+    uint16_t crc = 0xFFFF;
+    uint8_t b;
+
+    while (len--)
+    {
+        crc ^= *p++;
+        for (b = 0; b < 8; b++)
+            crc = (crc & 1) ? (crc >> 1) ^ 0xA001 : crc >> 1;
+    }
+    return crc;
+}
+
+static void test_crc(void)
+{
+    uint8_t frame[8] = { 0x01, 0x03, 0x00, 0x00, 0x00, 0x0A, 0xC5, 0xCD };
+    uint8_t data[300];
+    uint16_t i, len;
+
+    CHECK_EQ(MB_CRC16(frame, 6), 0xCDC5);
+    CHECK_EQ(MB_CRC16_Check(frame, 8), 1);
+    frame[3] ^= 0x10;
+    CHECK_EQ(MB_CRC16_Check(frame, 8), 0);
+    CHECK_EQ(MB_CRC16_Check(frame, 2), 0);
+    CHECK_EQ(MB_CRC16(frame, 0), 0xFFFF);
+
+    for (i = 0; i < sizeof(data); i++)
+        data[i] = (uint8_t)(i * 131 + 7);
+    for (len = 0; len <= sizeof(data); len += 13)
+        CHECK_EQ(MB_CRC16(data, len), crc_bitwise(data, len));
+}
+
+static void test_single_request(void)
+{
+    static const uint8_t expect_rtu[8] = { 0x01, 0x03, 0x00, 0x10, 0x00, 0x02, 0xC5, 0xCE };
+    uint8_t pdu[MB_PDU_MAX], unit;
+    uint16_t tid;
+    uint8_t n;
+
+    reset(9600);
+    client_read(0, 0x1234, 1, 0x10, 2);
+    run_ms(100);
+
+    CHECK_EQ(bus_frames, 1);
+    CHECK_EQ(bus_req_len, 8);
+    CHECK_MEM(bus_req, expect_rtu, 8);
+
+    n = client_take(0, &tid, &unit, pdu);
+    CHECK_EQ(tid, 0x1234);
+    CHECK_EQ(unit, 1);
+    CHECK(read_ok(1, pdu, n, 0x10, 2));
+    CHECK_EQ(client_take(0, &tid, &unit, pdu), 0);
+    CHECK_EQ(stats.requests, 1);
+    CHECK_EQ(stats.responses, 1);
+    CHECK_EQ(bus_busy, 0);
+    CHECK_EQ(bus_stray, 0);
+    /* 请求 8 字节 + 应答 9 字节 (9600 每字节约 1ms) + 应答延时 2ms + 帧间隔 3ms */
+    CHECK(stats.latency_last_ms >= 20 && stats.latency_last_ms <= 30);
+}
+
+/* 一个 TCP 段里多个请求, 分到两个从站队列, 事务号各自对应 */
+static void test_pipeline(void)
+{
+    uint8_t pdu[MB_PDU_MAX], unit;
+    uint16_t tid;
+    uint8_t n;
+
+    reset(19200);
+    client_read(0, 10, 1, 0, 3);
+    client_read(0, 11, 2, 0, 3);
+    client_read(0, 12, 1, 5, 1);
+    run_ms(300);
+
+    CHECK_EQ(bus_frames, 3);
+    n = client_take(0, &tid, &unit, pdu);
+    CHECK_EQ(tid, 10);
+    CHECK(unit == 1 && read_ok(1, pdu, n, 0, 3));
+    n = client_take(0, &tid, &unit, pdu);
+    CHECK_EQ(tid, 11);
+    CHECK(unit == 2 && read_ok(2, pdu, n, 0, 3));
+    n = client_take(0, &tid, &unit, pdu);
+    CHECK_EQ(tid, 12);
+    CHECK(unit == 1 && read_ok(1, pdu, n, 5, 1));
+    CHECK_EQ(stats.responses, 3);
+}
+
+/* 请求跨两个 TCP 段到达 */
+static void test_split_segment(void)
+{
+    sim_sock_t *s = &sock[MB_TCP_SOCK_FIRST];
+    uint8_t pdu[MB_PDU_MAX], unit, tail[5];
+    uint16_t tid;
+
+    reset(115200);
+    client_read(0, 77, 2, 1, 1);
+    memcpy(tail, &s->up[7], 5);
+    s->up_len = 7;
+    run_ms(5);
+    CHECK_EQ(bus_frames, 0);
+    memcpy(&s->up[s->up_len], tail, 5);
+    s->up_len += 5;
+    run_ms(20);
+    CHECK_EQ(bus_frames, 1);
+    CHECK(read_ok(2, pdu, client_take(0, &tid, &unit, pdu), 1, 1));
+    CHECK_EQ(tid, 77);
+}
+
+/* 无应答的从站只阻塞自己的队列 */
+static void test_dead_slave(void)
+{
+    uint8_t pdu[MB_PDU_MAX], unit;
+    uint16_t tid;
+    uint8_t n;
+    uint32_t t_alive = 0;
+
+    reset(19200);
+    client_read(0, 1, 9, 0, 1);
+    client_read(0, 2, 9, 0, 1);
+    client_read(0, 3, 1, 0, 1);
+    while (stub_tick < 2000)
+    {
+        sim_step();
+        if (t_alive == 0 && sock[MB_TCP_SOCK_FIRST].down_len > 0)
+            t_alive = stub_tick;
+    }
+
+    n = client_take(0, &tid, &unit, pdu);
+    CHECK_EQ(tid, 1);
+    CHECK_EQ(n, 2);
+    CHECK(pdu[0] == 0x83 && pdu[1] == MB_EX_GW_TARGET_FAILED);
+    n = client_take(0, &tid, &unit, pdu);
+    CHECK_EQ(tid, 3);
+    CHECK(read_ok(1, pdu, n, 0, 1));
+    n = client_take(0, &tid, &unit, pdu);
+    CHECK_EQ(tid, 2);
+    CHECK(pdu[0] == 0x83 && pdu[1] == MB_EX_GW_TARGET_FAILED);
+
+    /* 第一个请求: 发送 + 超时, 重发 + 超时 */
+    CHECK(t_alive >= 2 * MB_RTU_TIMEOUT_MS && t_alive < 2 * MB_RTU_TIMEOUT_MS + 20);
+    CHECK_EQ(stats.timeouts, 4);
+    CHECK_EQ(stats.exceptions, 2);
+    CHECK_EQ(stats.responses, 1);
+    CHECK_EQ(bus_frames, 5);
+}
+
+static void test_queue_full(void)
+{
+    uint8_t pdu[MB_PDU_MAX], unit;
+    uint16_t tid;
+    uint8_t i;
+
+    /* 请求池 */
+    reset(9600);
+    for (i = 0; i <= MB_REQ_MAX; i++)
+        client_read(0, i, 9, 0, 1);
+    run_ms(1);
+    CHECK_EQ(client_take(0, &tid, &unit, pdu), 2);
+    CHECK_EQ(tid, MB_REQ_MAX);
+    CHECK(pdu[0] == 0x83 && pdu[1] == MB_EX_SLAVE_BUSY);
+    CHECK_EQ(stats.queue_full, 1);
+
+    /* 从站队列数 */
+    reset(9600);
+    for (i = 0; i <= MB_SLAVE_QUEUE_MAX; i++)
+        client_read(1, i, i + 1, 0, 1);
+    run_ms(1);
+    CHECK_EQ(client_take(1, &tid, &unit, pdu), 2);
+    CHECK_EQ(tid, MB_SLAVE_QUEUE_MAX);
+    CHECK_EQ(unit, MB_SLAVE_QUEUE_MAX + 1);
+    CHECK(pdu[0] == 0x83 && pdu[1] == MB_EX_SLAVE_BUSY);
+    CHECK_EQ(stats.queue_full, 1);
+}
+
+static void test_crc_retry(void)
+{
+    uint8_t pdu[MB_PDU_MAX], unit;
+    uint16_t tid;
+
+    reset(38400);
+    slaves[2].corrupt = 1;
+    client_read(0, 5, 2, 8, 4);
+    run_ms(100);
+    CHECK_EQ(bus_frames, 2);
+    CHECK_EQ(stats.crc_errors, 1);
+    CHECK(read_ok(2, pdu, client_take(0, &tid, &unit, pdu), 8, 4));
+    CHECK_EQ(tid, 5);
+
+    /* 两次都错: 异常应答 */
+    slaves[2].corrupt = 2;
+    client_read(0, 6, 2, 8, 4);
+    run_ms(100);
+    CHECK_EQ(stats.crc_errors, 3);
+    CHECK_EQ(client_take(0, &tid, &unit, pdu), 2);
+    CHECK(tid == 6 && pdu[1] == MB_EX_GW_TARGET_FAILED);
+}
+
+static void test_broadcast(void)
+{
+    static const uint8_t write[5] = { 0x06, 0x00, 0x01, 0x12, 0x34 };
+    uint8_t pdu[MB_PDU_MAX], unit;
+    uint16_t tid;
+
+    reset(19200);
+    client_send(0, 1, 0, 0, write, sizeof(write));
+    client_read(0, 2, 3, 0, 1);
+    run_ms(200);
+    CHECK_EQ(bus_frames, 2);
+    CHECK(bus_frame_ms[1] - bus_frame_ms[0] >= MB_RTU_BCAST_DELAY_MS);
+    CHECK(read_ok(3, pdu, client_take(0, &tid, &unit, pdu), 0, 1));
+    CHECK_EQ(tid, 2);
+    CHECK_EQ(client_take(0, &tid, &unit, pdu), 0);
+}
+
+/* 透传占用总线时网关等待 */
+static void test_bus_busy(void)
+{
+    uint8_t pdu[MB_PDU_MAX], unit;
+    uint16_t tid;
+
+    reset(19200);
+    bus_busy = 1;
+    client_read(0, 9, 1, 0, 1);
+    run_ms(50);
+    CHECK_EQ(bus_frames, 0);
+    bus_busy = 0;
+    run_ms(50);
+    CHECK_EQ(bus_frames, 1);
+    CHECK(read_ok(1, pdu, client_take(0, &tid, &unit, pdu), 0, 1));
+}
+
+/* 客户端断开后, 它的请求不再发到总线, 应答也不会发给新连接 */
+static void test_disconnect(void)
+{
+    uint8_t pdu[MB_PDU_MAX], unit;
+    uint16_t tid;
+
+    reset(19200);
+    client_read(0, 1, 9, 0, 1);
+    client_read(0, 2, 9, 0, 1);
+    run_ms(10);
+    CHECK_EQ(bus_frames, 1);
+    sock[MB_TCP_SOCK_FIRST].sr = SOCK_CLOSE_WAIT;
+    run_ms(2);
+    CHECK_EQ(sock[MB_TCP_SOCK_FIRST].sr, SOCK_LISTEN);
+    sock[MB_TCP_SOCK_FIRST].sr = SOCK_ESTABLISHED;
+    run_ms(1000);
+
+    CHECK_EQ(bus_frames, 2);  // 第一个请求和它的重发
+    CHECK_EQ(stats.tx_dropped, 1);
+    CHECK_EQ(client_take(0, &tid, &unit, pdu), 0);
+
+    client_read(0, 3, 1, 0, 1);
+    run_ms(50);
+    CHECK(read_ok(1, pdu, client_take(0, &tid, &unit, pdu), 0, 1));
+    CHECK_EQ(tid, 3);
+}
+
+/* 两个连接使用相同事务号 */
+static void test_two_clients(void)
+{
+    uint8_t pdu[MB_PDU_MAX], unit;
+    uint16_t tid;
+
+    reset(19200);
+    client_read(0, 7, 1, 0, 2);
+    client_read(1, 7, 2, 0, 2);
+    run_ms(100);
+    CHECK(read_ok(1, pdu, client_take(0, &tid, &unit, pdu), 0, 2));
+    CHECK_EQ(tid, 7);
+    CHECK(read_ok(2, pdu, client_take(1, &tid, &unit, pdu), 0, 2));
+    CHECK_EQ(tid, 7);
+}
+
+static void test_bad_mbap(void)
+{
+    uint8_t pdu[5] = { 0x03, 0x00, 0x00, 0x00, 0x01 };
+
+    reset(19200);
+    client_send(0, 1, 1, 1, pdu, sizeof(pdu));
+    run_ms(1);
+    CHECK_EQ(sock[MB_TCP_SOCK_FIRST].sr, SOCK_CLOSED);
+    CHECK_EQ(stats.requests, 0);
+    run_ms(50);
+    CHECK_EQ(bus_frames, 0);
+}
+
+/* 基准测试 -----------------------------------------------------------------*/
+
+#define BENCH_REGS              10
+
+/* 每个客户端保持 depth 个未完成请求, 轮流读 3 个从站 */
+static void bench(uint32_t baud, uint8_t depth, uint32_t total)
+{
+    uint32_t sent = 0, done = 0, errors = 0;
+    uint32_t outstanding[MB_TCP_SOCK_NUM] = { 0 };
+    uint32_t start_ms[65536 / 16];
+    unsigned long long lat_sum = 0;
+    uint32_t lat_max = 0, t0;
+    uint8_t pdu[MB_PDU_MAX], unit, c, n;
+    uint16_t tid;
+
+    reset(baud);
+    gw_ns = 0;
+    t0 = stub_tick;
+    while (done < total)
+    {
+        for (c = 0; c < MB_TCP_SOCK_NUM; c++)
+        {
+            while (outstanding[c] < depth && sent < total)
+            {
+                start_ms[sent] = stub_tick;
+                client_read(c, (uint16_t)sent, (uint8_t)(1 + sent % 3), (uint16_t)sent & 0xFF, BENCH_REGS);
+                outstanding[c]++;
+                sent++;
+            }
+        }
+        sim_step();
+        for (c = 0; c < MB_TCP_SOCK_NUM; c++)
+        {
+            while ((n = client_take(c, &tid, &unit, pdu)) > 0)
+            {
+                uint32_t lat = stub_tick - start_ms[tid];
+
+                if (unit != 1 + tid % 3 || !read_ok(unit, pdu, n, tid & 0xFF, BENCH_REGS))
+                    errors++;
+                lat_sum += lat;
+                if (lat > lat_max)
+                    lat_max = lat;
+                outstanding[c]--;
+                done++;
+            }
+        }
+    }
+    CHECK_EQ(errors, 0);
+    CHECK_EQ(stats.exceptions, 0);
+
+    printf("  %6u baud, %u clients x depth %u: %7.1f tx/s, latency mean %5.1f ms max %3u ms, "
+           "gateway %4.0f ns/tx on host\n",
+           (unsigned)baud, MB_TCP_SOCK_NUM, depth, total * 1000.0 / (stub_tick - t0),
+           (double)lat_sum / total, (unsigned)lat_max, (double)gw_ns / total);
+}
+
+static void test_bench(void)
+{
+    bench(9600, 1, 1000);
+    bench(9600, 4, 1000);
+    bench(19200, 1, 2000);
+    bench(115200, 1, 4000);
+    bench(115200, 4, 4000);
+}
+
+int main(void)
+{
+    TEST_RUN(test_crc);
+    TEST_RUN(test_single_request);
+    TEST_RUN(test_pipeline);
+    TEST_RUN(test_split_segment);
+    TEST_RUN(test_dead_slave);
+    TEST_RUN(test_queue_full);
+    TEST_RUN(test_crc_retry);
+    TEST_RUN(test_broadcast);
+    TEST_RUN(test_bus_busy);
+    TEST_RUN(test_disconnect);
+    TEST_RUN(test_two_clients);
+    TEST_RUN(test_bad_mbap);
+    TEST_RUN(test_bench);
+    return test_summary("mb_gateway");
+}
@@ -0,0 +1,547 @@
+/**
+  ******************************************************************************
+  * @file    test_metrics.c
+  * @brief   Metrics Registry: Update Semantics, Exposition Formats, Update Cost
+  ******************************************************************************
+  * @description
+  * 直接包含 metrics.c (LDREX/STREX 由 stm32f1xx.h 桩实现, 单线程下总是成功):
+  * - 计数器回绕、峰值仪表、直方图分桶边界和总和
+  * - Prometheus 文本: 按文本格式 0.0.4 逐行检查 (HELP/TYPE 在样本之前、名称合法且不重复、
+  *   counter 以 _total 结尾、直方图桶累计且 le 递增到 +Inf、_count 等于 +Inf 桶),
+  *   样本值与槽值一致; 各种输出缓冲大小下拼接结果相同
+  * - 二进制记录: 各种缓冲大小下解码 (LEB128 + CRC16) 还原全部槽值
+  * - 基准: 每种更新操作的耗时, 完整导出的耗时和长度
+  ******************************************************************************
+  */
+
+#include "test.h"
+#include "../../User/modbus/mb_crc.c"
+#include "../../User/user_main/metrics.c"
+#include <stdlib.h>
+#include <ctype.h>
+
+#define BENCH_ROUNDS            20000000
+#define EXPORT_ROUNDS           20000
+#define TEXT_MAX                16384
+
+static char text[TEXT_MAX];
+static char text_ref[TEXT_MAX];
+
+/* 所有槽清零 */
+static void setup(void)
+{
+    memset((void *)Metrics_Slots, 0, sizeof(Metrics_Slots));
+}
+
+/* 每个槽一个不同的值, 包括需要 5 字节 LEB128 的值 */
+static void fill_slots(uint32_t seed)
+{
+    uint16_t i;
+
+    for (i = 0; i < METRICS_SLOT_COUNT; i++)
+    {
+        seed = seed * 1103515245UL + 12345UL;
+        switch (i % 4)
+        {
+        case 0: Metrics_Slots[i] = seed >> 25; break;
+        case 1: Metrics_Slots[i] = seed >> 12; break;
+        case 2: Metrics_Slots[i] = 0xFFFFFFFFUL - (seed >> 20); break;
+        default: Metrics_Slots[i] = i; break;
+        }
+    }
+}
+
+/* 直方图各桶按桶号递增, 使累计值有意义 */
+static void fill_hists(void)
+{
+    uint8_t h, b;
+
+    for (h = 0; h < METRIC_HIST_COUNT; h++)
+    {
+        for (b = 0; b <= METRICS_HIST_BUCKETS; b++)
+            Metrics_Slots[METRICS_HIST_BASE(h) + b] = (uint32_t)(h + 1) * (b + 3);
+        Metrics_Slots[METRICS_HIST_SUM(h)] = 123456u + h;
+    }
+}
+
+/* 用 size 字节的缓冲完整导出 Prometheus 文本, 返回总长度 */
+static uint32_t export_text(uint16_t size, char *out, uint32_t *pieces)
+{
+    static char buf[1024];
+    uint16_t cursor = 0, n;
+    uint32_t len = 0, calls = 0;
+
+    for (;;)
+    {
+        n = Metrics_FormatPrometheus(&cursor, buf, size);
+        if (n == 0)
+            break;
+        CHECK(n < size);
+        if (len + n >= TEXT_MAX || ++calls > 10000)
+            break;
+        memcpy(&out[len], buf, n);
+        len += n;
+    }
+    out[len] = '\0';
+    if (pieces != NULL)
+        *pieces = calls;
+    return len;
+}
+
+/* Prometheus 文本格式检查 --------------------------------------------------*/
+
+#define FAMILY_MAX              64
+
+static struct
+{
+    char names[FAMILY_MAX][64];
+    uint32_t count;
+    uint32_t samples;
+    uint32_t values[METRICS_SLOT_COUNT];    /* 标量的样本值, 按出现顺序 */
+    uint32_t scalars;
+    uint32_t bucket[METRIC_HIST_COUNT][METRICS_HIST_BUCKETS + 1];
+    uint32_t sum[METRIC_HIST_COUNT];
+    uint32_t hist_count[METRIC_HIST_COUNT];
+    uint32_t hists;
+    uint32_t errors;
+} prom;
+
+static uint8_t valid_name(const char *s, size_t len)
+{
+    size_t i;
+
+    if (len == 0 || !(isalpha((unsigned char)s[0]) || s[0] == '_' || s[0] == ':'))
+        return 0;
+    for (i = 1; i < len; i++)
+    {
+        if (!(isalnum((unsigned char)s[i]) || s[i] == '_' || s[i] == ':'))
+            return 0;
+    }
+    return 1;
+}
+
+static uint8_t ends_with(const char *s, size_t len, const char *suffix)
+{
+    size_t n = strlen(suffix);
+    return len >= n && memcmp(&s[len - n], suffix, n) == 0;
+}
+
+#define PROM_FAIL(cond) do { if (!(cond)) { prom.errors++; CHECK(cond); return; } } while (0)
+
+/* 检查整个导出文本, 结果记在 prom */
+static void prom_check(const char *t)
+{
+    char family[64] = "", type[16] = "", name[96], le[16];
+    const char *line = t, *end, *sp;
+    uint32_t value, prev_cum = 0, i;
+    double prev_le = -1, le_v;
+    uint8_t expect_type = 0, h = 0, b = 0;
+    size_t len;
+
+    memset(&prom, 0, sizeof(prom));
+    while (*line != '\0')
+    {
+        end = strchr(line, '\n');
+        PROM_FAIL(end != NULL);
+        len = (size_t)(end - line);
+        PROM_FAIL(len > 0 && memchr(line, '\r', len) == NULL);
+
+        if (strncmp(line, "# HELP ", 7) == 0)
+        {
+            PROM_FAIL(!expect_type);
+            sp = memchr(line + 7, ' ', len - 7);
+            PROM_FAIL(sp != NULL && sp + 1 < end);
+            PROM_FAIL(valid_name(line + 7, (size_t)(sp - line - 7)));
+            PROM_FAIL((size_t)(sp - line - 7) < sizeof(family));
+            memcpy(family, line + 7, (size_t)(sp - line - 7));
+            family[sp - line - 7] = '\0';
+            for (i = 0; i < prom.count; i++)
+                PROM_FAIL(strcmp(prom.names[i], family) != 0);
+            PROM_FAIL(prom.count < FAMILY_MAX);
+            strcpy(prom.names[prom.count++], family);
+            expect_type = 1;
+        }
+        else if (strncmp(line, "# TYPE ", 7) == 0)
+        {
+            PROM_FAIL(expect_type);
+            PROM_FAIL(sscanf(line + 7, "%95s %15s", name, type) == 2);
+            PROM_FAIL(strcmp(name, family) == 0);
+            PROM_FAIL(strcmp(type, "counter") == 0 || strcmp(type, "gauge") == 0 ||
+                      strcmp(type, "histogram") == 0);
+            if (strcmp(type, "counter") == 0)
+                PROM_FAIL(ends_with(family, strlen(family), "_total"));
+            else
+                PROM_FAIL(!ends_with(family, strlen(family), "_total"));
+            expect_type = 0;
+            prev_le = -1;
+            prev_cum = 0;
+            b = 0;
+            if (strcmp(type, "histogram") == 0)
+            {
+                PROM_FAIL(prom.hists < METRIC_HIST_COUNT);
+                h = (uint8_t)prom.hists++;
+            }
+        }
+        else
+        {
+            PROM_FAIL(line[0] != '#' && !expect_type && family[0] != '\0');
+            sp = memchr(line, ' ', len);
+            PROM_FAIL(sp != NULL);
+            PROM_FAIL((size_t)(sp - line) < sizeof(name));
+            memcpy(name, line, (size_t)(sp - line));
+            name[sp - line] = '\0';
+            /* 值: 非负整数, 不超过 32 位 */
+            PROM_FAIL(sp + 1 < end && isdigit((unsigned char)sp[1]));
+            PROM_FAIL(strtoull(sp + 1, NULL, 10) <= 0xFFFFFFFFULL);
+            value = (uint32_t)strtoul(sp + 1, NULL, 10);
+            prom.samples++;
+
+            if (strcmp(type, "histogram") != 0)
+            {
+                PROM_FAIL(strcmp(name, family) == 0);
+                PROM_FAIL(prom.scalars < METRIC_SCALAR_COUNT);
+                prom.values[prom.scalars++] = value;
+            }
+            else if (strncmp(name, family, strlen(family)) == 0 &&
+                     sscanf(name + strlen(family), "_bucket{le=\"%15[^\"]\"}", le) == 1)
+            {
+                PROM_FAIL(ends_with(name, strlen(name), "\"}"));
+                PROM_FAIL(b <= METRICS_HIST_BUCKETS);
+                le_v = (strcmp(le, "+Inf") == 0) ? 1e300 : strtod(le, NULL);
+                PROM_FAIL(le_v > prev_le);
+                PROM_FAIL(value >= prev_cum);
+                PROM_FAIL((b == METRICS_HIST_BUCKETS) == (strcmp(le, "+Inf") == 0));
+                prev_le = le_v;
+                prev_cum = value;
+                prom.bucket[h][b++] = value;
+            }
+            else if (ends_with(name, strlen(name), "_sum"))
+            {
+                PROM_FAIL(strlen(name) == strlen(family) + 4 && b == METRICS_HIST_BUCKETS + 1);
+                prom.sum[h] = value;
+            }
+            else
+            {
+                PROM_FAIL(strlen(name) == strlen(family) + 6 && ends_with(name, strlen(name), "_count"));
+                PROM_FAIL(value == prev_cum);
+                prom.hist_count[h] = value;
+            }
+        }
+        line = end + 1;
+    }
+    PROM_FAIL(!expect_type);
+}
+
+/* 二进制记录解码 -----------------------------------------------------------*/
+
+/* 解码一条记录写入 out, 返回值个数, 格式错误返回 -1 */
+static int decode_record(const uint8_t *p, uint16_t len, uint8_t seq, uint32_t *out, uint8_t *seen)
+{
+    uint16_t crc, pos = METRICS_REPORT_HDR_LEN, i, first, n;
+    uint32_t v;
+    uint8_t shift;
+
+    if (len < METRICS_REPORT_HDR_LEN + 2 || p[0] != METRICS_REPORT_SYNC || p[1] != len ||
+        p[2] != METRICS_SCHEMA_VER || p[3] != seq)
+        return -1;
+    crc = MB_CRC16(p, len - 2);
+    if (p[len - 2] != (uint8_t)crc || p[len - 1] != (uint8_t)(crc >> 8))
+        return -1;
+    first = p[4];
+    n = p[5];
+    for (i = 0; i < n; i++)
+    {
+        v = 0;
+        shift = 0;
+        do {
+            if (pos >= len - 2 || shift > 28)
+                return -1;
+            v |= (uint32_t)(p[pos] & 0x7F) << shift;
+            shift += 7;
+        } while (p[pos++] & 0x80);
+        if (first + i >= METRICS_SLOT_COUNT || seen[first + i])
+            return -1;
+        out[first + i] = v;
+        seen[first + i] = 1;
+    }
+    return (pos == len - 2) ? (int)n : -1;
+}
+
+/* 测试 ---------------------------------------------------------------------*/
+
+/* 计数器按 32 位回绕; 峰值仪表只增不减; 槽号越界读为 0 */
+static void test_updates(void)
+{
+    setup();
+    Metrics_Inc(METRIC_AT_COMMANDS);
+    Metrics_Add(METRIC_AT_COMMANDS, 41);
+    CHECK_EQ(Metrics_GetSlot(METRIC_AT_COMMANDS), 42);
+    Metrics_Add(METRIC_UPQ_DROPS, 0xFFFFFFF0UL);
+    Metrics_Add(METRIC_UPQ_DROPS, 0x20);
+    CHECK_EQ(Metrics_GetSlot(METRIC_UPQ_DROPS), 0x10);
+
+    Metrics_SetWithPeak(METRIC_UPQ_DEPTH, METRIC_UPQ_PEAK, 100);
+    Metrics_SetWithPeak(METRIC_UPQ_DEPTH, METRIC_UPQ_PEAK, 30);
+    CHECK_EQ(Metrics_GetSlot(METRIC_UPQ_DEPTH), 30);
+    CHECK_EQ(Metrics_GetSlot(METRIC_UPQ_PEAK), 100);
+    Metrics_SetWithPeak(METRIC_UPQ_DEPTH, METRIC_UPQ_PEAK, 250);
+    CHECK_EQ(Metrics_GetSlot(METRIC_UPQ_PEAK), 250);
+    Metrics_Set(METRIC_MODEM_CSQ, 99);
+    CHECK_EQ(Metrics_GetSlot(METRIC_MODEM_CSQ), 99);
+
+    Metrics_Slots[METRICS_SLOT_COUNT - 1] = 7;
+    CHECK_EQ(Metrics_GetSlot(METRICS_SLOT_COUNT - 1), 7);
+    CHECK_EQ(Metrics_GetSlot(METRICS_SLOT_COUNT), 0);
+    CHECK_EQ(Metrics_GetSlot(0xFFFF), 0);
+}
+
+/* 直方图: 等于上限的值落在该桶, 超过最后一个上限的落在 +Inf 桶; 总和累计 */
+static void test_histogram(void)
+{
+    uint32_t sum = 0, i;
+    uint8_t b;
+
+    setup();
+    for (b = 0; b < METRICS_HIST_BUCKETS; b++)
+    {
+        Metrics_Observe(METRIC_HIST_AT_LATENCY, hist_bounds[b]);
+        Metrics_Observe(METRIC_HIST_AT_LATENCY, hist_bounds[b] + 1);
+        sum += 2 * hist_bounds[b] + 1;
+    }
+    Metrics_Observe(METRIC_HIST_AT_LATENCY, 0);
+    Metrics_Observe(METRIC_HIST_AT_LATENCY, 0xFFFFFFFFUL);
+    sum += 0xFFFFFFFFUL;
+
+    /* 0 和 5 在第一个桶; 上限 +1 落在下一个桶 */
+    CHECK_EQ(Metrics_Slots[METRICS_HIST_BASE(0)], 2);
+    for (b = 1; b < METRICS_HIST_BUCKETS; b++)
+        CHECK_EQ(Metrics_Slots[METRICS_HIST_BASE(0) + b], 2);
+    CHECK_EQ(Metrics_Slots[METRICS_HIST_BASE(0) + METRICS_HIST_BUCKETS], 2);
+    CHECK_EQ(Metrics_Slots[METRICS_HIST_SUM(0)], sum);
+    CHECK_EQ(Metrics_HistCumulative(0, METRICS_HIST_BUCKETS), 2 * METRICS_HIST_BUCKETS + 2);
+
+    /* 两个直方图互不影响, 也不影响标量 */
+    for (i = 0; i < METRIC_SCALAR_COUNT; i++)
+        CHECK_EQ(Metrics_Slots[i], 0);
+    for (i = 0; i < METRICS_HIST_SLOTS; i++)
+        CHECK_EQ(Metrics_Slots[METRICS_HIST_BASE(1) + i], 0);
+    Metrics_Observe(METRIC_HIST_MB_LATENCY, 75);
+    CHECK_EQ(Metrics_Slots[METRICS_HIST_BASE(1) + 4], 1);
+    CHECK_EQ(Metrics_Slots[METRICS_HIST_SUM(1)], 75);
+}
+
+/* Prometheus 文本格式, 样本值与槽值一致 */
+static void test_prometheus(void)
+{
+    uint32_t len, i, b;
+    uint8_t h;
+
+    setup();
+    fill_slots(1);
+    fill_hists();
+    len = export_text(1024, text, NULL);
+    CHECK(len > 0);
+    prom_check(text);
+    CHECK_EQ(prom.errors, 0);
+    CHECK_EQ(prom.count, METRIC_SCALAR_COUNT + METRIC_HIST_COUNT);
+    CHECK_EQ(prom.scalars, METRIC_SCALAR_COUNT);
+    CHECK_EQ(prom.hists, METRIC_HIST_COUNT);
+    CHECK_EQ(prom.samples, METRIC_SCALAR_COUNT + METRIC_HIST_COUNT * (METRICS_HIST_BUCKETS + 3));
+    for (i = 0; i < METRIC_SCALAR_COUNT; i++)
+        CHECK_EQ(prom.values[i], Metrics_Slots[i]);
+    for (h = 0; h < METRIC_HIST_COUNT; h++)
+    {
+        for (b = 0; b <= METRICS_HIST_BUCKETS; b++)
+            CHECK_EQ(prom.bucket[h][b], Metrics_HistCumulative(h, (uint8_t)b));
+        CHECK_EQ(prom.sum[h], Metrics_Slots[METRICS_HIST_SUM(h)]);
+        CHECK_EQ(prom.hist_count[h], prom.bucket[h][METRICS_HIST_BUCKETS]);
+    }
+    for (i = 0; i < prom.count; i++)
+        CHECK(strncmp(prom.names[i], METRICS_PREFIX, strlen(METRICS_PREFIX)) == 0);
+}
+
+/*
+ * 输出缓冲大小: 不小于 METRICS_PROM_PIECE_MAX 时拼接结果与一次输出相同;
+ * 所有值为最大值时每段仍不超过 METRICS_PROM_PIECE_MAX
+ */
+static void test_prometheus_chunking(void)
+{
+    uint32_t ref_len, len, pieces, max_piece = 0, i;
+    uint16_t size, cursor;
+    int n;
+
+    setup();
+    for (i = 0; i < METRICS_SLOT_COUNT; i++)
+        Metrics_Slots[i] = 0xFFFFFFFFUL;
+    for (cursor = 0; cursor < METRIC_SCALAR_COUNT + METRIC_HIST_COUNT * METRICS_HIST_LINES; cursor++)
+    {
+        n = Metrics_PromPiece(cursor, text, sizeof(text));
+        if ((uint32_t)n > max_piece)
+            max_piece = (uint32_t)n;
+    }
+    CHECK(max_piece < METRICS_PROM_PIECE_MAX);
+
+    fill_slots(7);
+    fill_hists();
+    ref_len = export_text(1024, text_ref, NULL);
+    for (size = METRICS_PROM_PIECE_MAX; size <= 1024; size += 13)
+    {
+        len = export_text(size, text, &pieces);
+        CHECK_EQ(len, ref_len);
+        CHECK(memcmp(text, text_ref, ref_len) == 0);
+        CHECK(pieces >= (ref_len + size - 1) / size);
+    }
+
+    /* 更小的缓冲: 放不下的段跳过, 不会卡住, 输出仍是完整的行 */
+    len = export_text(64, text, &pieces);
+    CHECK(len < ref_len);
+    CHECK(len == 0 || text[len - 1] == '\n');
+    CHECK(pieces <= METRIC_SCALAR_COUNT + METRIC_HIST_COUNT * METRICS_HIST_LINES);
+}
+
+/* 二进制记录: 各种缓冲大小下还原全部槽值; 缓冲太小时不输出 */
+static void test_binary(void)
+{
+    static uint8_t buf[300];
+    static uint32_t out[METRICS_SLOT_COUNT];
+    static uint8_t seen[METRICS_SLOT_COUNT];
+    uint16_t size, slot, len;
+    uint32_t records, i, bad;
+    int n;
+
+    setup();
+    fill_slots(3);
+    fill_hists();
+    for (size = METRICS_REPORT_LEN_MIN; size <= sizeof(buf); size++)
+    {
+        memset(out, 0, sizeof(out));
+        memset(seen, 0, sizeof(seen));
+        slot = 0;
+        records = 0;
+        bad = 0;
+        while ((len = Metrics_EncodeRecord(&slot, (uint8_t)size, buf, size)) > 0)
+        {
+            records++;
+            if (len > size || len > 255)
+                bad++;
+            n = decode_record(buf, len, (uint8_t)size, out, seen);
+            if (n <= 0)
+                bad++;
+            if (records > METRICS_SLOT_COUNT)
+                break;
+        }
+        CHECK_EQ(bad, 0);
+        CHECK_EQ(slot, METRICS_SLOT_COUNT);
+        for (i = 0, n = 0; i < METRICS_SLOT_COUNT; i++)
+            n += !seen[i] || out[i] != Metrics_Slots[i];
+        CHECK_EQ(n, 0);
+        /* 最小缓冲每条记录一个值 */
+        if (size == METRICS_REPORT_LEN_MIN)
+            CHECK_EQ(records, METRICS_SLOT_COUNT);
+    }
+
+    slot = 0;
+    CHECK_EQ(Metrics_EncodeRecord(&slot, 0, buf, METRICS_REPORT_LEN_MIN - 1), 0);
+    CHECK_EQ(slot, 0);
+    slot = METRICS_SLOT_COUNT;
+    CHECK_EQ(Metrics_EncodeRecord(&slot, 0, buf, sizeof(buf)), 0);
+
+    /* 全 0 时每个值 1 字节 */
+    setup();
+    slot = 0;
+    len = Metrics_EncodeRecord(&slot, 0, buf, sizeof(buf));
+    CHECK_EQ(slot, METRICS_SLOT_COUNT);
+    CHECK_EQ(len, METRICS_REPORT_HDR_LEN + METRICS_SLOT_COUNT + 2);
+}
+
+/* 基准 ---------------------------------------------------------------------*/
+
+static double bench_ns(unsigned long long t0, uint32_t rounds)
+{
+    return (double)(test_now_ns() - t0) / rounds;
+}
+
+static void test_bench(void)
+{
+    static uint8_t buf[256];
+    unsigned long long t0;
+    double inc_ns, add_ns, set_ns, peak_ns, obs_lo_ns, obs_hi_ns, prom_ns, bin_ns;
+    uint32_t i, prom_len = 0, bin_len = 0;
+    uint16_t cursor, slot, n;
+
+    setup();
+    t0 = test_now_ns();
+    for (i = 0; i < BENCH_ROUNDS; i++)
+        Metrics_Inc(METRIC_RS485_RX_BYTES);
+    inc_ns = bench_ns(t0, BENCH_ROUNDS);
+    CHECK_EQ(Metrics_Slots[METRIC_RS485_RX_BYTES], BENCH_ROUNDS);
+
+    t0 = test_now_ns();
+    for (i = 0; i < BENCH_ROUNDS; i++)
+        Metrics_Add(METRIC_RS485_TX_BYTES, i & 0xFF);
+    add_ns = bench_ns(t0, BENCH_ROUNDS);
+
+    t0 = test_now_ns();
+    for (i = 0; i < BENCH_ROUNDS; i++)
+        Metrics_Set(METRIC_HEAP_FREE, i);
+    set_ns = bench_ns(t0, BENCH_ROUNDS);
+
+    /* 深度在 0~255 间变化, 大部分调用不更新峰值 */
+    t0 = test_now_ns();
+    for (i = 0; i < BENCH_ROUNDS; i++)
+        Metrics_SetWithPeak(METRIC_UPQ_DEPTH, METRIC_UPQ_PEAK, (i * 7) & 0xFF);
+    peak_ns = bench_ns(t0, BENCH_ROUNDS);
+    CHECK_EQ(Metrics_Slots[METRIC_UPQ_PEAK], 0xFF);
+
+    /* 第一个桶 / +Inf 桶 (线性查找的两端) */
+    t0 = test_now_ns();
+    for (i = 0; i < BENCH_ROUNDS; i++)
+        Metrics_Observe(METRIC_HIST_MB_LATENCY, i & 3);
+    obs_lo_ns = bench_ns(t0, BENCH_ROUNDS);
+    t0 = test_now_ns();
+    for (i = 0; i < BENCH_ROUNDS; i++)
+        Metrics_Observe(METRIC_HIST_AT_LATENCY, 6000 + (i & 3));
+    obs_hi_ns = bench_ns(t0, BENCH_ROUNDS);
+    CHECK_EQ(Metrics_Slots[METRICS_HIST_BASE(METRIC_HIST_AT_LATENCY) + METRICS_HIST_BUCKETS], BENCH_ROUNDS);
+
+    /* 完整导出: 与 /metrics 相同的 256 字节块 */
+    fill_slots(11);
+    fill_hists();
+    t0 = test_now_ns();
+    for (i = 0; i < EXPORT_ROUNDS; i++)
+    {
+        cursor = 0;
+        prom_len = 0;
+        while ((n = Metrics_FormatPrometheus(&cursor, (char *)buf, sizeof(buf))) > 0)
+            prom_len += n;
+    }
+    prom_ns = bench_ns(t0, EXPORT_ROUNDS);
+    t0 = test_now_ns();
+    for (i = 0; i < EXPORT_ROUNDS; i++)
+    {
+        slot = 0;
+        bin_len = 0;
+        while ((n = Metrics_EncodeRecord(&slot, 0, buf, sizeof(buf))) > 0)
+            bin_len += n;
+    }
+    bin_ns = bench_ns(t0, EXPORT_ROUNDS);
+    CHECK(bin_len < prom_len);
+
+    printf("  update: inc %.2f ns, add %.2f ns, set %.2f ns, set+peak %.2f ns, "
+           "observe %.2f ns (first bucket) / %.2f ns (+Inf)\n",
+           inc_ns, add_ns, set_ns, peak_ns, obs_lo_ns, obs_hi_ns);
+    printf("  export %u slots: prometheus %lu bytes %.1f us, binary %lu bytes %.2f us\n",
+           (unsigned)METRICS_SLOT_COUNT, (unsigned long)prom_len, prom_ns / 1000.0,
+           (unsigned long)bin_len, bin_ns / 1000.0);
+}
+
+int main(void)
+{
+    TEST_RUN(test_updates);
+    TEST_RUN(test_histogram);
+    TEST_RUN(test_prometheus);
+    TEST_RUN(test_prometheus_chunking);
+    TEST_RUN(test_binary);
+    TEST_RUN(test_bench);
+    return test_summary("metrics");
+}
@@ -0,0 +1,499 @@
+/**
+  ******************************************************************************
+  * @file    test_mqtt_topic_trie.c
+  * @brief   MQTT Topic Trie: Wildcard Conformance, Churn and Dispatch Benchmark
+  ******************************************************************************
+  * @description
+  * - 一致性: MQTT 3.1.1 第 4.7 节的过滤器语法和匹配示例
+  * - 随机对比: 随机订阅/退订, 每次匹配的结果与按规范逐层比较的参考实现一致;
+  *   退订后把过滤器字符串覆盖掉, 检查树中没有节点仍指向它
+  * - 基准: 与原来逐个 messageHandlers[] 比较的分发方式对比每条 PUBLISH 的耗时
+  ******************************************************************************
+  */
+
+#include "test.h"
+#include <stdlib.h>
+#include "../../User/ioLibrary_Driver/Internet/MQTT/MQTTTopicTrie.c"
+
+typedef unsigned long long slot_mask_t;
+
+static MQTTTopicTrie trie;
+static int match_calls;
+
+static void collect(void *arg, int slot)
+{
+    *(slot_mask_t *)arg |= 1ULL << slot;
+    match_calls++;
+}
+
+static slot_mask_t match_cstr(const char *topic)
+{
+    MQTTString name = MQTTString_initializer;
+    slot_mask_t mask = 0;
+
+    name.cstring = (char *)topic;
+    match_calls = 0;
+    MQTTTopicTrie_match(&trie, &name, collect, &mask);
+    return mask;
+}
+
+/* PUBLISH 中的主题是不以 '\0' 结尾的 lenstring */
+static slot_mask_t match_len(const char *topic)
+{
+    static char buf[128];
+    MQTTString name = MQTTString_initializer;
+    slot_mask_t mask = 0;
+    int len = (int)strlen(topic);
+
+    memcpy(buf, topic, len);
+    memset(&buf[len], '/', sizeof(buf) - len);
+    name.lenstring.data = buf;
+    name.lenstring.len = len;
+    match_calls = 0;
+    MQTTTopicTrie_match(&trie, &name, collect, &mask);
+    return mask;
+}
+
+static int free_nodes(void)
+{
+    int n = 0;
+    unsigned char i;
+
+    for (i = trie.free; i != 0; i = trie.nodes[i].next)
+        n++;
+    return n;
+}
+
+/* 按规范逐层比较的参考实现 */
+static int ref_match(const char *f, const char *t)
+{
+    if (t[0] == '$' && (f[0] == '+' || f[0] == '#'))
+        return 0;
+    for (;;)
+    {
+        int fl = (int)strcspn(f, "/");
+        int tl = (int)strcspn(t, "/");
+
+        if (fl == 1 && f[0] == '#')
+            return 1;
+        if (!(fl == 1 && f[0] == '+') && (fl != tl || memcmp(f, t, fl) != 0))
+            return 0;
+        f += fl;
+        t += tl;
+        if (*f == '\0' && *t == '\0')
+            return 1;
+        if (*f == '\0')
+            return 0;
+        if (*t == '\0')
+            return strcmp(f, "/#") == 0;
+        f++;
+        t++;
+    }
+}
+
+/* 一致性 -------------------------------------------------------------------*/
+
+static void test_filter_syntax(void)
+{
+    static const char *const valid[] = {
+        "#", "+", "+/+", "/+", "a/#", "sport/tennis/player1", "sport/+/player1", "+/tennis/#",
+        "a//b", "/", "$SYS/#", "a/b/c/d/e/f/g/h",
+    };
+    static const char *const invalid[] = {
+        "", "sport/tennis#", "sport/tennis/#/ranking", "sport+", "a/+b", "a/#b", "#/a", "a/b+/c", "##",
+    };
+    unsigned i;
+
+    MQTTTopicTrie_init(&trie);
+    for (i = 0; i < sizeof(valid) / sizeof(valid[0]); i++)
+        CHECK_EQ(MQTTTopicTrie_add(&trie, valid[i]), i);
+    for (i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++)
+        CHECK_EQ(MQTTTopicTrie_add(&trie, invalid[i]), -1);
+
+    /* 已订阅的过滤器返回原来的槽位 (重连后重新订阅) */
+    CHECK_EQ(MQTTTopicTrie_add(&trie, "sport/+/player1"), 6);
+}
+
+typedef struct {
+    const char *filter;
+    const char *topic;
+    int match;
+} trie_case_t;
+
+static void test_conformance(void)
+{
+    /* MQTT 3.1.1 4.7.1 / 4.7.2 的示例, 以及空层级和大小写 */
+    static const trie_case_t cases[] = {
+        { "sport/tennis/player1/#", "sport/tennis/player1", 1 },
+        { "sport/tennis/player1/#", "sport/tennis/player1/ranking", 1 },
+        { "sport/tennis/player1/#", "sport/tennis/player1/score/wimbledon", 1 },
+        { "sport/tennis/player1/#", "sport/tennis/player2", 0 },
+        { "sport/#", "sport", 1 },
+        { "sport/#", "sports", 0 },
+        { "#", "sport/tennis", 1 },
+        { "#", "/", 1 },
+        { "sport/tennis/+", "sport/tennis/player1", 1 },
+        { "sport/tennis/+", "sport/tennis/player1/ranking", 0 },
+        { "sport/+", "sport", 0 },
+        { "sport/+", "sport/", 1 },
+        { "+/+", "/finance", 1 },
+        { "/+", "/finance", 1 },
+        { "+", "/finance", 0 },
+        { "+", "finance", 1 },
+        { "+/tennis/#", "sport/tennis", 1 },
+        { "+/tennis/#", "sport/tennis/x/y", 1 },
+        { "+/tennis/#", "sport/golf/x", 0 },
+        { "a//b", "a//b", 1 },
+        { "a/+/b", "a//b", 1 },
+        { "a/b", "a//b", 0 },
+        { "A/b", "a/b", 0 },
+        { "a/b/c", "a/b", 0 },
+        { "a/b", "a/b/c", 0 },
+        /* 4.7.2: 以通配符开头的过滤器不匹配 '$' 主题 */
+        { "#", "$SYS/broker/load", 0 },
+        { "+/broker/load", "$SYS/broker/load", 0 },
+        { "$SYS/#", "$SYS/broker/load", 1 },
+        { "$SYS/broker/+", "$SYS/broker/load", 1 },
+        { "$SYS", "$SYS", 1 },
+        { "+/$x", "a/$x", 1 },
+    };
+    unsigned i;
+
+    for (i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    {
+        slot_mask_t expect = cases[i].match ? 1 : 0;
+
+        MQTTTopicTrie_init(&trie);
+        CHECK_EQ(MQTTTopicTrie_add(&trie, cases[i].filter), 0);
+        CHECK_EQ(ref_match(cases[i].filter, cases[i].topic), cases[i].match);
+        if (match_cstr(cases[i].topic) != expect || match_len(cases[i].topic) != expect)
+        {
+            test_failures++;
+            printf("  FAIL %s: filter \"%s\" topic \"%s\" expected %d\n",
+                   test_current, cases[i].filter, cases[i].topic, cases[i].match);
+        }
+        test_checks++;
+    }
+}
+
+/* 同一主题匹配多个过滤器时每个槽位回调一次 */
+static void test_overlapping(void)
+{
+    static const char *const filters[] = { "#", "a/#", "a/+", "a/b", "+/b", "+/+/#", "a/b/#", "b/#" };
+    unsigned i;
+
+    MQTTTopicTrie_init(&trie);
+    for (i = 0; i < sizeof(filters) / sizeof(filters[0]); i++)
+        CHECK_EQ(MQTTTopicTrie_add(&trie, filters[i]), i);
+
+    /* a/b: #, a/#, a/+, a/b, +/b, +/+/#, a/b/# */
+    CHECK_EQ(match_cstr("a/b"), 0x7F);
+    CHECK_EQ(match_calls, 7);
+    /* a: #, a/# */
+    CHECK_EQ(match_cstr("a"), 0x03);
+    CHECK_EQ(match_calls, 2);
+    /* b/c/d: #, +/+/#, b/# */
+    CHECK_EQ(match_len("b/c/d"), 0xA1);
+    CHECK_EQ(match_calls, 3);
+}
+
+static void test_remove(void)
+{
+    static char f1[] = "plant/line1/+/temp";
+    static char f2[] = "plant/line1/#";
+    static char f3[] = "plant/line2/press";
+    int total = MAX_TOPIC_NODES - 1;
+
+    MQTTTopicTrie_init(&trie);
+    CHECK_EQ(free_nodes(), total);
+    CHECK_EQ(MQTTTopicTrie_add(&trie, f1), 0);
+    CHECK_EQ(MQTTTopicTrie_add(&trie, f2), 1);
+    CHECK_EQ(MQTTTopicTrie_add(&trie, f3), 2);
+    CHECK_EQ(free_nodes(), total - 7);  // plant, line1, +, temp, #, line2, press
+
+    CHECK_EQ(MQTTTopicTrie_remove(&trie, "plant/line1/+"), -1);  // 前缀不是订阅
+    CHECK_EQ(MQTTTopicTrie_remove(&trie, "plant/line9"), -1);
+
+    /* f1 的字符串被 "plant"、"line1" 两个共用节点引用, 退订后覆盖它 */
+    CHECK_EQ(MQTTTopicTrie_remove(&trie, f1), 0);
+    memset(f1, '?', sizeof(f1) - 1);
+    CHECK_EQ(free_nodes(), total - 5);
+    CHECK_EQ(match_cstr("plant/line1/x/temp"), 0x02);
+    CHECK_EQ(match_cstr("plant/line2/press"), 0x04);
+
+    /* 槽位复用 */
+    CHECK_EQ(MQTTTopicTrie_add(&trie, "plant/line3"), 0);
+    CHECK_EQ(MQTTTopicTrie_remove(&trie, f2), 1);
+    CHECK_EQ(MQTTTopicTrie_remove(&trie, f3), 2);
+    CHECK_EQ(MQTTTopicTrie_remove(&trie, "plant/line3"), 0);
+    CHECK_EQ(free_nodes(), total);
+    CHECK_EQ(match_cstr("plant/line3"), 0);
+}
+
+/* 槽位和节点池用完时返回 -1, 不改变已有订阅 */
+static void test_exhaustion(void)
+{
+    static char names[MAX_MESSAGE_HANDLERS + 1][16];
+    static char deep[MAX_TOPIC_NODES * 2 + 1];
+    int i, n;
+
+    MQTTTopicTrie_init(&trie);
+    for (i = 0; i <= MAX_MESSAGE_HANDLERS; i++)
+    {
+        snprintf(names[i], sizeof(names[i]), "dev/%d", i);
+        CHECK_EQ(MQTTTopicTrie_add(&trie, names[i]), (i < MAX_MESSAGE_HANDLERS) ? i : -1);
+    }
+    CHECK_EQ(match_cstr("dev/31"), 1ULL << 31);
+    CHECK_EQ(match_cstr("dev/32"), 0);
+
+    /* 层级数超过剩余节点 */
+    MQTTTopicTrie_init(&trie);
+    for (i = 0; i < MAX_TOPIC_NODES; i++)
+    {
+        deep[i * 2] = 'x';
+        deep[i * 2 + 1] = '/';
+    }
+    deep[MAX_TOPIC_NODES * 2 - 1] = '\0';
+    CHECK_EQ(MQTTTopicTrie_add(&trie, deep), -1);
+    CHECK_EQ(free_nodes(), MAX_TOPIC_NODES - 1);
+    deep[(MAX_TOPIC_NODES - 1) * 2 - 1] = '\0';  // 正好 MAX_TOPIC_NODES-1 层
+    CHECK_EQ(MQTTTopicTrie_add(&trie, deep), 0);
+    CHECK_EQ(free_nodes(), 0);
+    CHECK_EQ(MQTTTopicTrie_add(&trie, "y"), -1);
+    n = (int)strlen(deep);
+    CHECK_EQ(n, (MAX_TOPIC_NODES - 1) * 2 - 1);
+    CHECK_EQ(match_cstr(deep), 1);
+    CHECK_EQ(MQTTTopicTrie_remove(&trie, deep), 0);
+    CHECK_EQ(free_nodes(), MAX_TOPIC_NODES - 1);
+}
+
+/* 随机对比 -----------------------------------------------------------------*/
+
+#define FUZZ_BUFS               (MAX_MESSAGE_HANDLERS * 2)
+
+static char fuzz_buf[FUZZ_BUFS][40];
+static unsigned char fuzz_buf_used[FUZZ_BUFS];
+static int fuzz_slot_buf[MAX_MESSAGE_HANDLERS];
+
+static void rand_filter(char *out)
+{
+    static const char *const lv[] = { "a", "b", "cc", "", "+", "+", "#" };
+    int depth = 1 + rand() % 4, i;
+
+    out[0] = '\0';
+    if (rand() % 16 == 0)
+        strcat(out, "$s/");
+    for (i = 0; i < depth; i++)
+    {
+        const char *l = lv[rand() % 7];
+
+        if (l[0] == '#' && i != depth - 1)
+            l = "+";
+        strcat(out, l);
+        if (i != depth - 1)
+            strcat(out, "/");
+    }
+}
+
+static void rand_topic(char *out)
+{
+    static const char *const lv[] = { "a", "b", "cc", "" };
+    int depth = 1 + rand() % 5, i;
+
+    out[0] = '\0';
+    if (rand() % 8 == 0)
+        strcat(out, "$s/");
+    for (i = 0; i < depth; i++)
+    {
+        strcat(out, lv[rand() % 4]);
+        if (i != depth - 1)
+            strcat(out, "/");
+    }
+}
+
+static void test_random(void)
+{
+    char topic[40];
+    int round, b, slot, i, mismatches = 0;
+
+    srand(42);
+    MQTTTopicTrie_init(&trie);
+    memset(fuzz_buf_used, 0, sizeof(fuzz_buf_used));
+    for (i = 0; i < MAX_MESSAGE_HANDLERS; i++)
+        fuzz_slot_buf[i] = -1;
+
+    for (round = 0; round < 20000; round++)
+    {
+        slot_mask_t expect = 0, got;
+
+        if (rand() % 3 != 0)
+        {
+            for (b = 0; b < FUZZ_BUFS && fuzz_buf_used[b]; b++)
+                ;
+            rand_filter(fuzz_buf[b]);
+            slot = MQTTTopicTrie_add(&trie, fuzz_buf[b]);
+            if (slot >= 0 && fuzz_slot_buf[slot] < 0)
+            {
+                fuzz_slot_buf[slot] = b;
+                fuzz_buf_used[b] = 1;
+            }
+            else if (slot >= 0)
+            {
+                CHECK(strcmp(fuzz_buf[fuzz_slot_buf[slot]], fuzz_buf[b]) == 0);
+            }
+        }
+        else
+        {
+            slot = rand() % MAX_MESSAGE_HANDLERS;
+            if (fuzz_slot_buf[slot] >= 0)
+            {
+                b = fuzz_slot_buf[slot];
+                CHECK_EQ(MQTTTopicTrie_remove(&trie, fuzz_buf[b]), slot);
+                memset(fuzz_buf[b], '?', strlen(fuzz_buf[b]));
+                fuzz_buf_used[b] = 0;
+                fuzz_slot_buf[slot] = -1;
+            }
+        }
+
+        rand_topic(topic);
+        for (i = 0; i < MAX_MESSAGE_HANDLERS; i++)
+        {
+            if (fuzz_slot_buf[i] >= 0 && ref_match(fuzz_buf[fuzz_slot_buf[i]], topic))
+                expect |= 1ULL << i;
+        }
+        got = match_len(topic);
+        if (got != expect || match_calls != __builtin_popcountll(expect))
+        {
+            if (mismatches++ < 5)
+                printf("  FAIL %s: round %d topic \"%s\" got %llx expected %llx\n",
+                       test_current, round, topic, got, expect);
+        }
+    }
+    test_checks++;
+    if (mismatches != 0)
+        test_failures++;
+
+    /* 全部退订后节点池完整回收 */
+    for (i = 0; i < MAX_MESSAGE_HANDLERS; i++)
+    {
+        if (fuzz_slot_buf[i] >= 0)
+            CHECK_EQ(MQTTTopicTrie_remove(&trie, fuzz_buf[fuzz_slot_buf[i]]), i);
+    }
+    CHECK_EQ(free_nodes(), MAX_TOPIC_NODES - 1);
+}
+
+/* 基准测试 -----------------------------------------------------------------*/
+
+/* 原来的 deliverMessage 对每个 messageHandlers[] 项调用的匹配函数 */
+static char linear_is_topic_matched(char *topicFilter, MQTTString *topicName)
+{
+    char *curf = topicFilter;
+    char *curn = topicName->lenstring.data;
+    char *curn_end = curn + topicName->lenstring.len;
+
+    while (*curf && curn < curn_end)
+    {
+        if (*curn == '/' && *curf != '/')
+            break;
+        if (*curf != '+' && *curf != '#' && *curf != *curn)
+            break;
+        if (*curf == '+')
+        {
+            char *nextpos = curn + 1;
+            while (nextpos < curn_end && *nextpos != '/')
+                nextpos = ++curn + 1;
+        }
+        else if (*curf == '#')
+            curn = curn_end - 1;
+        curf++;
+        curn++;
+    };
+    return (curn == curn_end) && (*curf == '\0');
+}
+
+static int linear_equals(MQTTString *a, const char *b)
+{
+    int alen = a->lenstring.len;
+
+    return (int)strlen(b) == alen && memcmp(a->lenstring.data, b, alen) == 0;
+}
+
+static void bench_dispatch(int subs)
+{
+    static const char *const groups[] = { "cmd", "cfg", "ota", "rs485" };
+    static char filters[MAX_MESSAGE_HANDLERS][40];
+    static char topics[64][40];
+    MQTTString names[64];
+    volatile slot_mask_t sink = 0;
+    unsigned long long t0, t_trie, t_linear;
+    const int iters = 200000;
+    int i, j, k;
+
+    MQTTTopicTrie_init(&trie);
+    for (i = 0; i < subs; i++)
+    {
+        /* 一台设备的订阅: smartcap/<设备>/<类别>/<名称>, 少量通配符 */
+        if (i % 8 == 7)
+            snprintf(filters[i], sizeof(filters[i]), "smartcap/+/%s/#", groups[i % 4]);
+        else if (i % 8 == 3)
+            snprintf(filters[i], sizeof(filters[i]), "smartcap/dev1/%s/+/k%d", groups[i % 4], i);
+        else
+            snprintf(filters[i], sizeof(filters[i]), "smartcap/dev1/%s/k%d", groups[i % 4], i);
+        CHECK(MQTTTopicTrie_add(&trie, filters[i]) >= 0);
+    }
+    for (i = 0; i < 64; i++)
+    {
+        snprintf(topics[i], sizeof(topics[i]), "smartcap/dev%d/%s/k%d", 1 + (i % 5 == 0), groups[i % 4], i % (subs + 4));
+        names[i].cstring = NULL;
+        names[i].lenstring.data = topics[i];
+        names[i].lenstring.len = (int)strlen(topics[i]);
+    }
+
+    t0 = test_now_ns();
+    for (k = 0; k < iters; k++)
+    {
+        slot_mask_t mask = 0;
+
+        MQTTTopicTrie_match(&trie, &names[k & 63], collect, &mask);
+        sink ^= mask;
+    }
+    t_trie = test_now_ns() - t0;
+
+    t0 = test_now_ns();
+    for (k = 0; k < iters; k++)
+    {
+        slot_mask_t mask = 0;
+
+        for (j = 0; j < subs; j++)
+        {
+            if (linear_equals(&names[k & 63], filters[j]) ||
+                linear_is_topic_matched(filters[j], &names[k & 63]))
+                mask |= 1ULL << j;
+        }
+        sink ^= mask;
+    }
+    t_linear = test_now_ns() - t0;
+
+    printf("  %2d subscriptions: trie %5.0f ns/publish, linear scan %5.0f ns/publish\n",
+           subs, (double)t_trie / iters, (double)t_linear / iters);
+    (void)sink;
+}
+
+static void test_bench(void)
+{
+    bench_dispatch(5);
+    bench_dispatch(16);
+    bench_dispatch(MAX_MESSAGE_HANDLERS);
+}
+
+int main(void)
+{
+    TEST_RUN(test_filter_syntax);
+    TEST_RUN(test_conformance);
+    TEST_RUN(test_overlapping);
+    TEST_RUN(test_remove);
+    TEST_RUN(test_exhaustion);
+    TEST_RUN(test_random);
+    TEST_RUN(test_bench);
+    return test_summary("mqtt_topic_trie");
+}
@@ -0,0 +1,1357 @@
+/**
+  ******************************************************************************
+  * @file    test_mqtt_uplink.c
+  * @brief   MQTT Uplink: Broker Stand-In, Partial Packets, Failover, Throughput
+  ******************************************************************************
+  * @description
+  * 真实的 mqtt_uplink.c、MQTTClient.c 和 MQTTPacket 运行在模拟链路上, 测试充当代理:
+  * 链路按单程时延、带宽和发送窗口排队, 每次 recv 可以只返回 1 个或随机几个字节,
+  * 代理一侧用 MQTTPacket 的服务端函数解析 CONNECT/SUBSCRIBE/PUBLISH 并应答
+  * - 会话: CONNECT 的客户端标识、遗嘱和保活, 订阅下行主题, 发布保留的在线状态
+  * - 拆包: 代理的报文逐字节、随机拆分、跨多次轮询和多个报文合并在一次读取中到达,
+  *   下行消息内容和顺序不变, QoS1 消息都有 PUBACK
+  * - 发布: 各主题的 QoS, 超长内容和会话未建立时拒绝
+  * - 保活: 空闲时发 PINGREQ, 代理不应答时 (包括一直有 QoS1 消息在重发时) 断开并在退避后
+  *   重连; 代理拒绝连接时同样退避
+  * - 链路切换: 在新链路上立即重连, 未确认的 QoS1 消息带 DUP 重发, 不丢失
+  * - 发送窗口: PUBACK 乱序/重复/未知标识, 窗口满时拒绝; PUBACK 丢失后按 MQTT_INFLIGHT_RETRY_MS
+  *   以相同标识带 DUP 重发; 会话断开后窗口保留, CONNACK 后立即重发; 报文标识回绕不用 0
+  * - 窗口基准: 往返 80/150 ms 时窗口 1/2/4/8 的 QoS1 消息速率 (窗口 1 即逐条等待 PUBACK)
+  * - 长消息: 到 32 KB 的 PUBLISH 通过 256 字节的接收缓冲, 整块/逐字节/随机拆分到达, 内容按块
+  *   连续交付 (偏移、总长, 块在 read_buf 内), 每条消息只有一个 offset 0, PUBACK 在最后一块之后;
+  *   长的 rs485/down 逐块转发, 长的 cmd 丢弃, OTA 'D' 消息按镜像偏移连续写入;
+  *   主题放不下时断开会话, 主题刚好留出 1 字节时逐字节交付
+  * - 长消息基准: 消息全部到达后客户端处理每 KB 的主机耗时
+  * - 基准: 以太网和蜂窝链路上的最大消息速率、发布到代理收到的时延, 每条消息的主机耗时
+  ******************************************************************************
+  */
+
+#include "test.h"
+#include <stdlib.h>
+#include "wiz_sim.h"
+#include "../../User/ioLibrary_Driver/Ethernet/wizchip_conf.c"
+#include "../../User/ioLibrary_Driver/Ethernet/W5500/w5500.c"
+#include "../../User/ioLibrary_Driver/Ethernet/socket.c"
+#include "../../User/modbus/mb_crc.c"
+#include "../../User/user_main/metrics.c"
+#include "../../User/ioLibrary_Driver/Internet/MQTT/MQTTPacket/src/MQTTPacket.c"
+#include "../../User/ioLibrary_Driver/Internet/MQTT/MQTTPacket/src/MQTTConnectClient.c"
+#include "../../User/ioLibrary_Driver/Internet/MQTT/MQTTPacket/src/MQTTConnectServer.c"
+#include "../../User/ioLibrary_Driver/Internet/MQTT/MQTTPacket/src/MQTTSerializePublish.c"
+#undef min                              /* MQTTConnectServer.c 和这里各定义了一个不同的 min */
+#include "../../User/ioLibrary_Driver/Internet/MQTT/MQTTPacket/src/MQTTDeserializePublish.c"
+#include "../../User/ioLibrary_Driver/Internet/MQTT/MQTTPacket/src/MQTTSubscribeClient.c"
+#include "../../User/ioLibrary_Driver/Internet/MQTT/MQTTPacket/src/MQTTSubscribeServer.c"
+#include "../../User/ioLibrary_Driver/Internet/MQTT/MQTTPacket/src/MQTTUnsubscribeClient.c"
+#include "../../User/ioLibrary_Driver/Internet/MQTT/MQTTTopicTrie.c"
+#include "../../User/ioLibrary_Driver/Internet/MQTT/mqtt_interface.c"
+#include "../../User/ioLibrary_Driver/Internet/MQTT/MQTTClient.c"
+#include "../../User/mqtt/mqtt_uplink.c"
+
+#define PIPE_SIZE               65536
+#define BROKER_RX_SIZE          4096
+#define PUB_LOG                 256
+#define SUB_LOG                 16
+#define DOWN_LOG                8192
+#define SEQ_MAX                 (1 << 18)
+#define LAT_BUCKETS             2000
+
+#define UID_TOPIC               "smartcap/77777777/"
+
+/* 模拟链路 -----------------------------------------------------------------*/
+
+typedef struct
+{
+    uint32_t delay_ms;          /* 单程时延 */
+    uint32_t ns_per_byte;       /* 带宽 */
+    uint32_t window;            /* 发送侧可排队的字节 (TCP 窗口/模块缓冲) */
+    uint16_t chunk;             /* 每次 recv 最多返回的字节, 0=不限 */
+    uint8_t split_random;       /* 1: 每次 recv 返回 1..chunk 之间的随机字节数 */
+} link_cfg_t;
+
+typedef struct
+{
+    uint8_t data[PIPE_SIZE];
+    uint32_t at[PIPE_SIZE];     /* 每个字节到达对端的时刻 */
+    uint32_t head, tail;        /* 写入/读出计数 */
+    uint64_t free_ns;           /* 链路空闲的时刻, 按带宽排队 */
+} pipe_t;
+
+typedef struct
+{
+    link_cfg_t cfg;
+    uint8_t ready;
+    uint32_t resets;
+    pipe_t up, down;
+    /* 代理一侧的连接 */
+    uint8_t rx[BROKER_RX_SIZE];
+    uint32_t rx_len;
+    uint8_t connected;
+    uint32_t connects;
+} link_t;
+
+static link_t links[UPLINK_COUNT];
+static Uplink_ID_t active = UPLINK_ETH;
+
+static uint32_t pipe_used(const pipe_t *p)
+{
+    return p->head - p->tail;
+}
+
+static void pipe_put(pipe_t *p, const link_cfg_t *cfg, const uint8_t *d, uint32_t n)
+{
+    uint64_t now_ns = (uint64_t)stub_tick * 1000000ULL;
+    uint32_t i;
+
+    for (i = 0; i < n && pipe_used(p) < PIPE_SIZE; i++)
+    {
+        if (p->free_ns < now_ns)
+            p->free_ns = now_ns;
+        p->free_ns += cfg->ns_per_byte;
+        p->data[p->head % PIPE_SIZE] = d[i];
+        p->at[p->head % PIPE_SIZE] = (uint32_t)(p->free_ns / 1000000ULL) + cfg->delay_ms;
+        p->head++;
+    }
+}
+
+/* 已到达的字节数, 最多数到 max */
+static uint32_t pipe_arrived(const pipe_t *p, uint32_t max)
+{
+    uint32_t n = 0;
+
+    while (n < max && p->tail + n != p->head && (int32_t)(stub_tick - p->at[(p->tail + n) % PIPE_SIZE]) >= 0)
+        n++;
+    return n;
+}
+
+static uint32_t pipe_get(pipe_t *p, uint8_t *buf, uint32_t len)
+{
+    uint32_t n = pipe_arrived(p, len), i;
+
+    for (i = 0; i < n; i++)
+        buf[i] = p->data[(p->tail + i) % PIPE_SIZE];
+    p->tail += n;
+    return n;
+}
+
+static void pipe_clear(pipe_t *p)
+{
+    p->head = p->tail = 0;
+    p->free_ns = 0;
+}
+
+/* 代理 ---------------------------------------------------------------------*/
+
+typedef struct
+{
+    uint8_t link;
+    uint8_t qos, dup, retained;
+    uint16_t id;
+    uint32_t at;
+    char topic[64];
+    uint16_t len;
+    uint8_t payload[MQTT_BUF_SIZE];
+} pub_t;
+
+static struct
+{
+    uint8_t connack_rc;         /* CONNACK 返回码 */
+    uint8_t mute;               /* 1: 收下报文但不应答 */
+    uint8_t hold_acks;          /* 1: 不自动发 PUBACK, 由测试用 broker_puback 按需要的顺序发出 */
+    uint32_t drop_acks;         /* 丢弃接下来的几个 PUBACK */
+    uint32_t pingreqs;
+    uint32_t pubacks_in;        /* 客户端对下行 QoS1 消息的 PUBACK */
+    uint16_t puback_ids[64];
+    uint32_t publishes;         /* 收到的 PUBLISH (含重发) */
+    uint32_t dups;
+    uint32_t unexpected;        /* 未连接时收到 CONNECT 以外的报文, 或无法解析的报文 */
+    uint8_t version;            /* CONNECT 的协议级别 (MQTTDeserialize_connect 不填 MQTTVersion) */
+    MQTTPacket_connectData conn;
+    char client_id[32];
+    char will_topic[64];
+    char will_msg[16];
+    char subs[SUB_LOG][64];
+    int sub_qos[SUB_LOG];
+    uint32_t sub_count;
+    pub_t log[PUB_LOG];
+    uint32_t log_count;
+} broker;
+
+/* 基准: rs485/up 消息内容的前 4 字节为序号, 记录第一次到达的时延 */
+static uint32_t sent_at[SEQ_MAX];
+static uint8_t seen[SEQ_MAX];
+static uint32_t lat_hist[LAT_BUCKETS];
+static uint32_t seq_delivered, seq_duplicates;
+
+static void lenstring_copy(char *dst, size_t size, const MQTTString *s)
+{
+    size_t n = (s->cstring != NULL) ? strlen(s->cstring) : (size_t)s->lenstring.len;
+    const char *src = (s->cstring != NULL) ? s->cstring : s->lenstring.data;
+
+    if (n >= size)
+        n = size - 1;
+    memcpy(dst, src, n);
+    dst[n] = '\0';
+}
+
+static void broker_send(Uplink_ID_t id, const uint8_t *pkt, int len)
+{
+    if (len > 0 && links[id].ready)
+        pipe_put(&links[id].down, &links[id].cfg, pkt, (uint32_t)len);
+}
+
+static void broker_on_publish(Uplink_ID_t id, uint8_t *pkt, int len)
+{
+    unsigned char dup, retained;
+    unsigned short pid;
+    int qos, plen;
+    unsigned char *payload;
+    MQTTString topic = MQTTString_initializer;
+    uint8_t ack[4];
+    uint32_t seq;
+    pub_t *p;
+
+    if (MQTTDeserialize_publish(&dup, &qos, &retained, &pid, &topic, &payload, &plen, pkt, len) != 1)
+    {
+        broker.unexpected++;
+        return;
+    }
+    broker.publishes++;
+    broker.dups += dup;
+    if (broker.log_count < PUB_LOG)
+    {
+        p = &broker.log[broker.log_count];
+        p->link = id;
+        p->qos = (uint8_t)qos;
+        p->dup = dup;
+        p->retained = retained;
+        p->id = pid;
+        p->at = stub_tick;
+        lenstring_copy(p->topic, sizeof(p->topic), &topic);
+        p->len = (uint16_t)plen;
+        memcpy(p->payload, payload, (plen < MQTT_BUF_SIZE) ? plen : MQTT_BUF_SIZE);
+    }
+    broker.log_count++;
+
+    if (plen >= 4 && topic.lenstring.len == (int)strlen(UID_TOPIC "rs485/up") &&
+        memcmp(topic.lenstring.data, UID_TOPIC "rs485/up", topic.lenstring.len) == 0)
+    {
+        seq = ((uint32_t)payload[0] << 24) | ((uint32_t)payload[1] << 16) | ((uint32_t)payload[2] << 8) | payload[3];
+        if (seq < SEQ_MAX && !seen[seq])
+        {
+            seen[seq] = 1;
+            seq_delivered++;
+            lat_hist[(stub_tick - sent_at[seq] < LAT_BUCKETS) ? stub_tick - sent_at[seq] : LAT_BUCKETS - 1]++;
+        }
+        else
+            seq_duplicates++;
+    }
+
+    if (qos != 1 || broker.mute)
+        return;
+    if (broker.drop_acks > 0)
+        broker.drop_acks--;
+    else if (!broker.hold_acks)
+        broker_send(id, ack, MQTTSerialize_puback(ack, sizeof(ack), pid));
+}
+
+/* 代理发出一个 PUBACK (乱序、重复或未知的标识) */
+static void broker_puback(Uplink_ID_t id, uint16_t pid)
+{
+    uint8_t ack[4];
+
+    broker_send(id, ack, MQTTSerialize_puback(ack, sizeof(ack), pid));
+}
+
+static void broker_on_packet(Uplink_ID_t id, uint8_t *pkt, int len)
+{
+    link_t *l = &links[id];
+    uint8_t out[64];
+    MQTTString filters[4];
+    int qos[4], count, i;
+    unsigned char dup;
+    unsigned short pid;
+
+    if (!l->connected && (pkt[0] >> 4) != CONNECT)
+    {
+        broker.unexpected++;
+        return;
+    }
+    switch (pkt[0] >> 4)
+    {
+    case CONNECT:
+        memset(&broker.conn, 0, sizeof(broker.conn));
+        if (MQTTDeserialize_connect(&broker.conn, pkt, len) != 1)
+        {
+            broker.unexpected++;
+            return;
+        }
+        for (i = 1; pkt[i] & 0x80; i++)
+            ;
+        broker.version = pkt[i + 1 + 6];    /* 剩余长度之后: 协议名 "MQTT" (2+4 字节), 协议级别 */
+        lenstring_copy(broker.client_id, sizeof(broker.client_id), &broker.conn.clientID);
+        lenstring_copy(broker.will_topic, sizeof(broker.will_topic), &broker.conn.will.topicName);
+        lenstring_copy(broker.will_msg, sizeof(broker.will_msg), &broker.conn.will.message);
+        l->connects++;
+        if (broker.mute)
+            return;
+        l->connected = (broker.connack_rc == 0);
+        broker_send(id, out, MQTTSerialize_connack(out, sizeof(out), broker.connack_rc, 0));
+        break;
+
+    case SUBSCRIBE:
+        if (MQTTDeserialize_subscribe(&dup, &pid, 4, &count, filters, qos, pkt, len) != 1)
+        {
+            broker.unexpected++;
+            return;
+        }
+        for (i = 0; i < count && broker.sub_count < SUB_LOG; i++)
+        {
+            lenstring_copy(broker.subs[broker.sub_count], sizeof(broker.subs[0]), &filters[i]);
+            broker.sub_qos[broker.sub_count++] = qos[i];
+        }
+        if (!broker.mute)
+            broker_send(id, out, MQTTSerialize_suback(out, sizeof(out), pid, count, qos));
+        break;
+
+    case PUBLISH:
+        broker_on_publish(id, pkt, len);
+        break;
+
+    case PUBACK:
+        if (MQTTDeserialize_ack(&out[0], &dup, &pid, pkt, len) == 1 && broker.pubacks_in < 64)
+            broker.puback_ids[broker.pubacks_in] = pid;
+        broker.pubacks_in++;
+        break;
+
+    case PINGREQ:
+        broker.pingreqs++;
+        out[0] = PINGRESP << 4;
+        out[1] = 0;
+        if (!broker.mute)
+            broker_send(id, out, 2);
+        break;
+
+    default:
+        break;
+    }
+}
+
+/* 取出已到达的字节, 按固定头的剩余长度拆出完整报文 */
+static void broker_poll(void)
+{
+    uint8_t id;
+    link_t *l;
+    uint32_t rem, mult, i;
+
+    for (id = 0; id < UPLINK_COUNT; id++)
+    {
+        l = &links[id];
+        l->rx_len += pipe_get(&l->up, &l->rx[l->rx_len], BROKER_RX_SIZE - l->rx_len);
+        for (;;)
+        {
+            rem = 0;
+            mult = 1;
+            for (i = 1; i < l->rx_len && i <= 4; i++)
+            {
+                rem += (l->rx[i] & 127) * mult;
+                mult *= 128;
+                if ((l->rx[i] & 128) == 0)
+                    break;
+            }
+            if (i >= l->rx_len || i > 4 || l->rx_len < i + 1 + rem)
+                break;
+            broker_on_packet((Uplink_ID_t)id, l->rx, (int)(i + 1 + rem));
+            memmove(l->rx, &l->rx[i + 1 + rem], l->rx_len - (i + 1 + rem));
+            l->rx_len -= i + 1 + rem;
+        }
+    }
+}
+
+static void broker_publish(Uplink_ID_t id, const char *topic, const uint8_t *payload, int len, int qos, uint16_t pid)
+{
+    static uint8_t pkt[PIPE_SIZE];
+    MQTTString t = MQTTString_initializer;
+
+    t.cstring = (char *)topic;
+    broker_send(id, pkt, MQTTSerialize_publish(pkt, sizeof(pkt), 0, qos, 0, pid, t, (unsigned char *)payload, len));
+}
+
+/* 被测模块依赖的其它模块 ---------------------------------------------------*/
+
+static uint8_t link_ready(Uplink_ID_t id)
+{
+    return links[id].ready;
+}
+
+static int32_t link_send(Uplink_ID_t id, const uint8_t *data, uint16_t len)
+{
+    link_t *l = &links[id];
+    uint32_t room;
+
+    if (!l->ready)
+        return -1;
+    room = l->cfg.window - pipe_used(&l->up);
+    if (len > room)
+        len = (uint16_t)room;
+    pipe_put(&l->up, &l->cfg, data, len);
+    return len;
+}
+
+static int32_t link_recv(Uplink_ID_t id, uint8_t *buf, uint16_t len)
+{
+    link_t *l = &links[id];
+    uint16_t max = len;
+
+    if (l->cfg.chunk != 0 && max > l->cfg.chunk)
+        max = l->cfg.chunk;
+    if (l->cfg.split_random && max > 1)
+        max = (uint16_t)(1 + rand() % max);
+    return (int32_t)pipe_get(&l->down, buf, max);
+}
+
+/* 断开: 丢弃两个方向上未到达的数据, 代理一侧的连接随之结束, 之后的数据属于新连接 */
+static void link_reset(Uplink_ID_t id)
+{
+    link_t *l = &links[id];
+
+    l->resets++;
+    pipe_clear(&l->up);
+    pipe_clear(&l->down);
+    l->rx_len = 0;
+    l->connected = 0;
+}
+
+static uint8_t eth_ready(void) { return link_ready(UPLINK_ETH); }
+static int32_t eth_send(const uint8_t *d, uint16_t n) { return link_send(UPLINK_ETH, d, n); }
+static int32_t eth_recv(uint8_t *b, uint16_t n) { return link_recv(UPLINK_ETH, b, n); }
+static void eth_reset(void) { link_reset(UPLINK_ETH); }
+static uint8_t cell_ready(void) { return link_ready(UPLINK_CELL); }
+static int32_t cell_send(const uint8_t *d, uint16_t n) { return link_send(UPLINK_CELL, d, n); }
+static int32_t cell_recv(uint8_t *b, uint16_t n) { return link_recv(UPLINK_CELL, b, n); }
+static void cell_reset(void) { link_reset(UPLINK_CELL); }
+
+static const Uplink_Transport_t transports[UPLINK_COUNT] = {
+    {"eth", eth_ready, eth_send, eth_recv, NULL, eth_reset, NULL},
+    {"cell", cell_ready, cell_send, cell_recv, NULL, cell_reset, NULL},
+};
+
+Uplink_ID_t Uplink_Router_GetActive(void) { return active; }
+const Uplink_Transport_t *Uplink_Router_GetTransport(Uplink_ID_t id) { return &transports[id]; }
+void Uplink_Router_Poll(void) { broker_poll(); }
+
+uint32_t HAL_GetUIDw0(void) { return 0x11111111; }
+uint32_t HAL_GetUIDw1(void) { return 0x22222222; }
+uint32_t HAL_GetUIDw2(void) { return 0x44444444; }
+
+static char cmd_last[MQTT_BUF_SIZE + 1];
+static uint32_t cmd_count;
+
+void RG200U_ProcessCommand(const char *cmd, uint16_t len)
+{
+    memcpy(cmd_last, cmd, len);
+    cmd_last[len] = '\0';
+    cmd_count++;
+}
+
+#define OTA_IMAGE_MAX           32768
+
+static uint32_t ota_begins, ota_aborts, ota_writes, ota_bad_offset;
+static uint32_t ota_received;
+static uint8_t ota_image[OTA_IMAGE_MAX];
+
+int8_t OTA_Begin(const uint8_t *header, uint16_t len) { ota_begins++; return OTA_OK; }
+int8_t OTA_Abort(void) { ota_aborts++; return OTA_OK; }
+
+/* 与 ota.c 一样只接受从 received 开始的连续写入 */
+int8_t OTA_Write(uint32_t offset, const uint8_t *data, uint16_t len)
+{
+    ota_writes++;
+    if (offset != ota_received || offset + len > OTA_IMAGE_MAX)
+    {
+        ota_bad_offset++;
+        return OTA_ERR_OFFSET;
+    }
+    memcpy(&ota_image[offset], data, len);
+    ota_received += len;
+    return OTA_OK;
+}
+void OTA_GetStatus(OTA_Status_t *status) { memset(status, 0, sizeof(*status)); }
+uint16_t OTA_StatusJson(char *buf, uint16_t size) { return (uint16_t)snprintf(buf, size, "{\"phase\":\"idle\"}"); }
+
+static uint8_t down_data[DOWN_LOG];
+static uint32_t down_len, down_calls;
+
+static void on_down(const uint8_t *data, uint16_t len)
+{
+    if (down_len + len <= DOWN_LOG)
+        memcpy(&down_data[down_len], data, len);
+    down_len += len;
+    down_calls++;
+}
+
+static void wiz_sim_udp_out(uint8_t sn, const uint8_t ip[4], uint16_t port, const uint8_t *data, uint16_t len)
+{
+}
+
+/* 运行 ---------------------------------------------------------------------*/
+
+static void delay_hook(uint32_t ms)
+{
+    broker_poll();
+}
+
+static void sim_reset(const link_cfg_t *eth, const link_cfg_t *cell)
+{
+    memset(links, 0, sizeof(links));
+    memset(&broker, 0, sizeof(broker));
+    memset((void *)Metrics_Slots, 0, sizeof(Metrics_Slots));
+    links[UPLINK_ETH].cfg = *eth;
+    links[UPLINK_CELL].cfg = *cell;
+    links[UPLINK_ETH].ready = 1;
+    links[UPLINK_CELL].ready = 1;
+    active = UPLINK_ETH;
+    stub_tick = 1000;
+    stub_delay_hook = delay_hook;
+    down_len = down_calls = 0;
+    cmd_count = 0;
+    ota_begins = ota_aborts = ota_writes = ota_bad_offset = ota_received = 0;
+    srand(1);
+
+    session_state = MQTT_SESSION_DOWN;
+    session_link = UPLINK_NONE;
+    ota_prefix_len = 0;
+    ota_report = 0;
+    ota_seq = 0;
+    MQTT_Uplink_Init(on_down);
+}
+
+/* 每毫秒: 代理处理到达的数据, 上行发送任务轮询一次会话 */
+static void run_ms(uint32_t ms)
+{
+    while (ms--)
+    {
+        stub_tick++;
+        broker_poll();
+        MQTT_Uplink_Poll();
+    }
+}
+
+/* 至少轮询一次, 让会话先处理链路变化 */
+static int run_until_ready(uint32_t max_ms)
+{
+    do
+        run_ms(1);
+    while (--max_ms && !MQTT_Uplink_Ready());
+    return MQTT_Uplink_Ready();
+}
+
+static const pub_t *find_pub(const char *topic, uint32_t from)
+{
+    uint32_t i;
+
+    for (i = from; i < broker.log_count && i < PUB_LOG; i++)
+        if (strcmp(broker.log[i].topic, topic) == 0)
+            return &broker.log[i];
+    return NULL;
+}
+
+static const link_cfg_t lan = {1, 800, 2048, 0, 0};             /* 10 Mbit/s, RTT 2 ms */
+static const link_cfg_t lte = {60, 80000, 1460, 0, 0};          /* 100 kbit/s, RTT 120 ms */
+
+/* 测试 ---------------------------------------------------------------------*/
+
+static void test_session(void)
+{
+    const pub_t *p;
+
+    sim_reset(&lan, &lte);
+    CHECK(!MQTT_Uplink_Ready());
+    CHECK_EQ(MQTT_Uplink_Publish(MQTT_TOPIC_RS485_UP, (const uint8_t *)"x", 1), 0);
+    CHECK(run_until_ready(20));
+    CHECK_EQ(links[UPLINK_ETH].connects, 1);
+    CHECK_EQ(links[UPLINK_CELL].connects, 0);
+    CHECK(strcmp(broker.client_id, "smartcap-77777777") == 0);
+    CHECK_EQ(broker.version, 4);
+    CHECK_EQ(broker.conn.cleansession, 1);
+    CHECK_EQ(broker.conn.keepAliveInterval, MQTT_KEEPALIVE_S);
+    CHECK_EQ(broker.conn.willFlag, 1);
+    CHECK_EQ(broker.conn.will.retained, 1);
+    CHECK(strcmp(broker.will_topic, UID_TOPIC "status") == 0);
+    CHECK(strcmp(broker.will_msg, "offline") == 0);
+
+    run_ms(5);
+    CHECK_EQ(broker.sub_count, 3);
+    CHECK(strcmp(broker.subs[0], UID_TOPIC "rs485/down") == 0);
+    CHECK(strcmp(broker.subs[1], UID_TOPIC "cmd") == 0);
+    CHECK(strcmp(broker.subs[2], UID_TOPIC "ota") == 0);
+    CHECK_EQ(broker.sub_qos[0], 1);
+    CHECK_EQ(broker.sub_qos[1], 1);
+    CHECK_EQ(broker.sub_qos[2], 1);
+    p = find_pub(UID_TOPIC "status", 0);
+    CHECK(p != NULL && p->retained && p->qos == 0 && p->len == 6 && memcmp(p->payload, "online", 6) == 0);
+    CHECK_EQ(broker.unexpected, 0);
+    CHECK_EQ(Metrics_Slots[METRIC_MQTT_CONNECTS], 1);
+    CHECK_EQ(Metrics_Slots[METRIC_MQTT_SESSION_DROPS], 0);
+
+    /* 空闲 10 分钟: 连接保持, 每个保活周期一次 PINGREQ */
+    run_ms(600000);
+    CHECK(MQTT_Uplink_Ready());
+    CHECK(broker.pingreqs >= 9 && broker.pingreqs <= 10);
+    CHECK_EQ(links[UPLINK_ETH].connects, 1);
+}
+
+static void test_publish(void)
+{
+    static uint8_t big[MQTT_PAYLOAD_MAX + 1];
+    const pub_t *p;
+    uint32_t from;
+
+    sim_reset(&lan, &lte);
+    CHECK(run_until_ready(20));
+    run_ms(5);
+    from = broker.log_count;
+
+    CHECK_EQ(MQTT_Uplink_Publish(MQTT_TOPIC_RS485_UP, (const uint8_t *)"\x01\x03\x00\x00", 4), 1);
+    CHECK_EQ(MQTT_Uplink_Publish(MQTT_TOPIC_MODBUS, (const uint8_t *)"mb", 2), 1);
+    CHECK_EQ(MQTT_Uplink_Publish(MQTT_TOPIC_METRICS, (const uint8_t *)"m", 1), 1);
+    CHECK_EQ(client.inflight_count, 2);
+    run_ms(5);
+    CHECK_EQ(client.inflight_count, 0);
+
+    p = find_pub(UID_TOPIC "rs485/up", from);
+    CHECK(p != NULL && p->qos == 1 && !p->dup && p->len == 4 && memcmp(p->payload, "\x01\x03\x00\x00", 4) == 0);
+    p = find_pub(UID_TOPIC "modbus", from);
+    CHECK(p != NULL && p->qos == 1 && p->len == 2);
+    p = find_pub(UID_TOPIC "metrics", from);
+    CHECK(p != NULL && p->qos == 0 && p->len == 1);
+    CHECK_EQ(Metrics_Slots[METRIC_MQTT_TX_MSGS], 3);
+
+    /* 最长的内容放得下, 再长拒绝; 不存在的主题拒绝 */
+    memset(big, 'a', sizeof(big));
+    CHECK_EQ(MQTT_Uplink_Publish(MQTT_TOPIC_RS485_UP, big, MQTT_PAYLOAD_MAX), 1);
+    CHECK_EQ(MQTT_Uplink_Publish(MQTT_TOPIC_RS485_UP, big, MQTT_PAYLOAD_MAX + 1), 0);
+    CHECK_EQ(MQTT_Uplink_Publish(MQTT_TOPIC_COUNT, big, 1), 0);
+    run_ms(5);
+    p = find_pub(UID_TOPIC "rs485/up", from + 3);
+    CHECK(p != NULL && p->len == MQTT_PAYLOAD_MAX);
+    CHECK_EQ(broker.unexpected, 0);
+    CHECK(MQTT_Uplink_Ready());
+}
+
+/* 代理发出一组报文, 逐字节/随机拆分/合并到达, 下行内容与顺序不变 */
+static void partial_round(uint16_t chunk, uint8_t split_random, uint32_t gap_ms)
+{
+    link_cfg_t cfg = lan;
+    uint8_t expect[DOWN_LOG];
+    uint8_t payload[160];
+    uint8_t pkt[8];
+    uint32_t expect_len = 0, i, j, acks;
+    uint16_t pid = 100;
+
+    cfg.chunk = chunk;
+    cfg.split_random = split_random;
+    sim_reset(&cfg, &lte);
+    CHECK(run_until_ready(50));
+    run_ms(10);
+    acks = broker.pubacks_in;
+
+    for (i = 0; i < 40; i++)
+    {
+        uint16_t n = (uint16_t)(1 + (i * 37) % sizeof(payload));
+
+        for (j = 0; j < n; j++)
+            payload[j] = (uint8_t)(i * 7 + j);
+        memcpy(&expect[expect_len], payload, n);
+        expect_len += n;
+        broker_publish(UPLINK_ETH, UID_TOPIC "rs485/down", payload, n, (i % 3 == 0) ? 0 : 1, pid++);
+        if (i % 5 == 0)
+            broker_publish(UPLINK_ETH, UID_TOPIC "cmd", (const uint8_t *)"AT+CSQ", 6, 1, pid++);
+        if (i % 9 == 0)
+        {
+            pkt[0] = PINGRESP << 4;
+            pkt[1] = 0;
+            broker_send(UPLINK_ETH, pkt, 2);
+        }
+        if (gap_ms)
+            run_ms(gap_ms);
+    }
+    run_ms(200);
+
+    CHECK_EQ(down_len, expect_len);
+    CHECK_MEM(down_data, expect, expect_len);
+    CHECK_EQ(cmd_count, 8);
+    CHECK(strcmp(cmd_last, "AT+CSQ") == 0);
+    CHECK_EQ(broker.pubacks_in - acks, 26 + 8);
+    CHECK_EQ(Metrics_Slots[METRIC_MQTT_RX_MSGS], 48);
+    CHECK_EQ(Metrics_Slots[METRIC_MQTT_SESSION_DROPS], 0);
+    CHECK(MQTT_Uplink_Ready());
+}
+
+static void test_partial_packets(void)
+{
+    static const int cut[] = {0, 1, 2, 3, 40, 120};
+    MQTTString t = MQTTString_initializer;
+    uint8_t pkt[MQTT_BUF_SIZE];
+    uint8_t payload[150];
+    int len, k;
+
+    partial_round(0, 0, 0);             /* 全部报文在一次读取中到达 */
+    partial_round(0, 0, 1);
+    partial_round(1, 0, 0);             /* 逐字节 */
+    partial_round(7, 1, 0);             /* 随机拆分 */
+    partial_round(3, 1, 2);
+
+    /* 报文的各部分隔几次轮询才到达, 两个字节的剩余长度字段本身也被拆开 */
+    sim_reset(&lan, &lte);
+    CHECK(run_until_ready(50));
+    run_ms(10);
+    memset(payload, 0x5A, sizeof(payload));
+    t.cstring = UID_TOPIC "rs485/down";
+    len = MQTTSerialize_publish(pkt, sizeof(pkt), 0, 1, 0, 7, t, payload, sizeof(payload));
+    CHECK(len > 128 + 3 && (pkt[1] & 0x80));
+    for (k = 1; k < 6; k++)
+    {
+        broker_send(UPLINK_ETH, &pkt[cut[k - 1]], cut[k] - cut[k - 1]);
+        run_ms(3);
+        CHECK_EQ(down_len, 0);
+    }
+    broker_send(UPLINK_ETH, &pkt[120], len - 120);
+    run_ms(10);
+    CHECK_EQ(down_len, sizeof(payload));
+    CHECK_MEM(down_data, payload, sizeof(payload));
+    CHECK_EQ(broker.pubacks_in, 1);
+    CHECK_EQ(broker.puback_ids[0], 7);
+}
+
+/* 代理不应答 PINGREQ: 一个保活周期后断开, 退避后重连 */
+static void test_keepalive_loss(void)
+{
+    uint32_t t0;
+
+    sim_reset(&lan, &lte);
+    CHECK(run_until_ready(20));
+    run_ms(10);
+    broker.mute = 1;
+    t0 = stub_tick;
+    while (MQTT_Uplink_Ready() && stub_tick - t0 < 3 * MQTT_KEEPALIVE_S * 1000)
+        run_ms(1);
+    CHECK(!MQTT_Uplink_Ready());
+    CHECK(stub_tick - t0 >= 2 * MQTT_KEEPALIVE_S * 1000 - 100 && stub_tick - t0 <= 2 * MQTT_KEEPALIVE_S * 1000 + 100);
+    CHECK(broker.pingreqs >= 1);
+    CHECK_EQ(Metrics_Slots[METRIC_MQTT_SESSION_DROPS], 1);
+    CHECK_EQ(links[UPLINK_ETH].resets, 1);
+
+    broker.mute = 0;
+    t0 = stub_tick;
+    CHECK(run_until_ready(MQTT_RETRY_MS + 100));
+    CHECK(stub_tick - t0 >= MQTT_RETRY_MS);
+    CHECK_EQ(links[UPLINK_ETH].connects, 2);
+
+    /* 代理不再应答时还有 QoS1 消息在重发: 重发不能推迟 PINGRESP 的超时 */
+    run_ms(10);
+    broker.mute = 1;
+    t0 = stub_tick;
+    CHECK_EQ(MQTT_Uplink_Publish(MQTT_TOPIC_RS485_UP, (const uint8_t *)"lost", 4), 1);
+    while (MQTT_Uplink_Ready() && stub_tick - t0 < 10 * MQTT_KEEPALIVE_S * 1000)
+        run_ms(1);
+    CHECK(!MQTT_Uplink_Ready());
+    CHECK(stub_tick - t0 <= 2 * MQTT_KEEPALIVE_S * 1000 + 100);
+    CHECK(Metrics_Slots[METRIC_MQTT_RETRANSMITS] >= 2 * MQTT_KEEPALIVE_S * 1000 / MQTT_INFLIGHT_RETRY_MS - 2);
+    CHECK_EQ(Metrics_Slots[METRIC_MQTT_SESSION_DROPS], 2);
+}
+
+/* 代理拒绝连接 (未授权): CONNECT 超时后退避重试, 不会连续重发 */
+static void test_connack_refused(void)
+{
+    sim_reset(&lan, &lte);
+    broker.connack_rc = 5;
+    run_ms(MQTT_CMD_TIMEOUT_MS + MQTT_RETRY_MS + 50);
+    CHECK(!MQTT_Uplink_Ready());
+    CHECK_EQ(links[UPLINK_ETH].connects, 2);
+    CHECK_EQ(Metrics_Slots[METRIC_MQTT_CONNECTS], 2);
+    broker.connack_rc = 0;
+    CHECK(run_until_ready(MQTT_CMD_TIMEOUT_MS + MQTT_RETRY_MS + 50));
+    CHECK_EQ(links[UPLINK_ETH].connects, 3);
+}
+
+/* 以太网断开, 蜂窝接管: 立即在蜂窝上重连, 未确认的消息带 DUP 重发, 每条都到达 */
+static void test_failover(void)
+{
+    uint8_t payload[8];
+    uint32_t i, t0, from;
+    const pub_t *p;
+
+    sim_reset(&lan, &lte);
+    CHECK(run_until_ready(20));
+    run_ms(10);
+    memset(seen, 0, sizeof(seen));
+    seq_delivered = seq_duplicates = 0;
+
+    /* 以太网上的 PUBACK 不再返回, 然后链路失效 */
+    links[UPLINK_ETH].cfg.delay_ms = 500;
+    for (i = 0; i < MQTT_INFLIGHT_WINDOW; i++)
+    {
+        payload[0] = payload[1] = payload[2] = 0;
+        payload[3] = (uint8_t)i;
+        sent_at[i] = stub_tick;
+        CHECK_EQ(MQTT_Uplink_Publish(MQTT_TOPIC_RS485_UP, payload, sizeof(payload)), 1);
+    }
+    CHECK_EQ(MQTT_Uplink_Publish(MQTT_TOPIC_RS485_UP, payload, sizeof(payload)), 0);      /* 窗口已满 */
+    run_ms(5);
+    links[UPLINK_ETH].ready = 0;
+    active = UPLINK_CELL;
+    t0 = stub_tick;
+    from = broker.log_count;
+    CHECK(run_until_ready(1000));
+    CHECK_EQ(links[UPLINK_ETH].resets, 1);
+    CHECK_EQ(links[UPLINK_CELL].connects, 1);
+    CHECK(stub_tick - t0 <= 2 * lte.delay_ms + 20);     /* 一个往返, 没有退避 */
+    run_ms(500);
+
+    CHECK_EQ(seq_delivered, MQTT_INFLIGHT_WINDOW);
+    CHECK_EQ(client.inflight_count, 0);
+    for (i = 0; i < MQTT_INFLIGHT_WINDOW; i++)
+    {
+        p = find_pub(UID_TOPIC "rs485/up", from);
+        CHECK(p != NULL && p->link == UPLINK_CELL && p->dup);
+        from = (uint32_t)(p - broker.log) + 1;
+    }
+    CHECK_EQ(Metrics_Slots[METRIC_MQTT_RETRANSMITS], MQTT_INFLIGHT_WINDOW);
+    CHECK_EQ(Metrics_Slots[METRIC_MQTT_INFLIGHT], 0);
+    CHECK_EQ(broker.unexpected, 0);
+}
+
+/* PUBACK 乱序到达: 按报文标识释放, 窗口头部确认后才能放入新消息, 不重发 */
+static void test_window_out_of_order(void)
+{
+    uint8_t payload[4] = {0};
+    uint16_t ids[MQTT_INFLIGHT_WINDOW];
+    uint32_t i, from;
+
+    sim_reset(&lan, &lte);
+    CHECK(run_until_ready(20));
+    run_ms(10);
+    broker.hold_acks = 1;
+    from = broker.log_count;
+    for (i = 0; i < MQTT_INFLIGHT_WINDOW; i++)
+    {
+        payload[3] = (uint8_t)i;
+        CHECK_EQ(MQTT_Uplink_Publish(MQTT_TOPIC_RS485_UP, payload, sizeof(payload)), 1);
+    }
+    CHECK_EQ(MQTT_Uplink_Publish(MQTT_TOPIC_RS485_UP, payload, sizeof(payload)), 0);     /* WINDOW_FULL */
+    run_ms(10);
+    CHECK_EQ(broker.log_count - from, MQTT_INFLIGHT_WINDOW);
+    CHECK_EQ(Metrics_Slots[METRIC_MQTT_INFLIGHT], MQTT_INFLIGHT_WINDOW);
+    for (i = 0; i < MQTT_INFLIGHT_WINDOW; i++)
+        ids[i] = broker.log[from + i].id;
+
+    /* 先确认第 3 条和第 2 条: 头部仍未确认, 窗口不前进 */
+    broker_puback(UPLINK_ETH, ids[2]);
+    broker_puback(UPLINK_ETH, ids[1]);
+    run_ms(10);
+    CHECK_EQ(client.inflight_count, MQTT_INFLIGHT_WINDOW);
+    CHECK_EQ(MQTT_Uplink_Publish(MQTT_TOPIC_RS485_UP, payload, sizeof(payload)), 0);
+
+    /* 头部确认后连同已确认的第 2、3 条一起释放, 第 4 条仍在窗口中 */
+    broker_puback(UPLINK_ETH, ids[0]);
+    run_ms(10);
+    CHECK_EQ(client.inflight_count, 1);
+    CHECK_EQ(client.inflight[client.inflight_head].id, ids[3]);
+    broker.hold_acks = 0;
+    for (i = 0; i < MQTT_INFLIGHT_WINDOW - 1; i++)
+        CHECK_EQ(MQTT_Uplink_Publish(MQTT_TOPIC_RS485_UP, payload, sizeof(payload)), 1);
+    CHECK_EQ(MQTT_Uplink_Publish(MQTT_TOPIC_RS485_UP, payload, sizeof(payload)), 0);
+    run_ms(10);
+    CHECK_EQ(client.inflight_count, MQTT_INFLIGHT_WINDOW);     /* 后面的都已确认, 仍被第 4 条挡住 */
+
+    /* 重复和未知标识的 PUBACK 被忽略 */
+    broker_puback(UPLINK_ETH, ids[0]);
+    broker_puback(UPLINK_ETH, 0x7777);
+    run_ms(10);
+    CHECK_EQ(client.inflight_count, MQTT_INFLIGHT_WINDOW);
+    broker_puback(UPLINK_ETH, ids[3]);
+    run_ms(10);
+    CHECK_EQ(client.inflight_count, 0);
+    CHECK_EQ(client.retransmits, 0);
+    CHECK_EQ(broker.dups, 0);
+    CHECK(MQTT_Uplink_Ready());
+}
+
+/* PUBACK 丢失: MQTT_INFLIGHT_RETRY_MS 后以相同标识带 DUP 重发, 只重发未确认的那条 */
+static void test_retransmit(void)
+{
+    uint8_t payload[4] = {0};
+    uint32_t from, t0, i;
+    const pub_t *p;
+
+    sim_reset(&lan, &lte);
+    CHECK(run_until_ready(20));
+    run_ms(10);
+    from = broker.log_count;
+    broker.drop_acks = 1;
+    t0 = stub_tick;
+    for (i = 0; i < 3; i++)
+    {
+        payload[3] = (uint8_t)i;
+        CHECK_EQ(MQTT_Uplink_Publish(MQTT_TOPIC_RS485_UP, payload, sizeof(payload)), 1);
+    }
+    run_ms(MQTT_INFLIGHT_RETRY_MS - 10);
+    CHECK_EQ(client.inflight_count, 3);         /* 后两条已确认, 头部未确认 */
+    CHECK_EQ(broker.log_count - from, 3);
+    while (broker.log_count - from == 3 && stub_tick - t0 < 2 * MQTT_INFLIGHT_RETRY_MS)
+        run_ms(1);
+    CHECK(stub_tick - t0 >= MQTT_INFLIGHT_RETRY_MS && stub_tick - t0 <= MQTT_INFLIGHT_RETRY_MS + 5);
+    run_ms(10);
+    CHECK_EQ(broker.log_count - from, 4);
+    p = &broker.log[from + 3];
+    CHECK(p->dup && p->qos == 1 && p->id == broker.log[from].id && p->payload[3] == 0);
+    CHECK_EQ(client.inflight_count, 0);
+    CHECK_EQ(Metrics_Slots[METRIC_MQTT_RETRANSMITS], 1);
+
+    /* 重发的 PUBACK 也丢失: 每隔 MQTT_INFLIGHT_RETRY_MS 再发, 会话保持 */
+    broker.drop_acks = 3;
+    CHECK_EQ(MQTT_Uplink_Publish(MQTT_TOPIC_RS485_UP, payload, sizeof(payload)), 1);
+    run_ms(3 * MQTT_INFLIGHT_RETRY_MS + 10);
+    CHECK_EQ(broker.dups, 4);
+    CHECK_EQ(client.inflight_count, 0);
+    CHECK(MQTT_Uplink_Ready());
+}
+
+/* 会话断开后窗口保留: 重连 (CONNACK) 后立即带 DUP 重发, 不等重发间隔 */
+static void test_resend_on_reconnect(void)
+{
+    uint8_t payload[4] = {0};
+    uint32_t from, i, t0;
+
+    sim_reset(&lan, &lte);
+    CHECK(run_until_ready(20));
+    run_ms(10);
+    broker.mute = 1;
+    for (i = 0; i < 2; i++)
+    {
+        payload[3] = (uint8_t)i;
+        CHECK_EQ(MQTT_Uplink_Publish(MQTT_TOPIC_RS485_UP, payload, sizeof(payload)), 1);
+    }
+    run_ms(10);
+    links[UPLINK_ETH].ready = 0;
+    active = UPLINK_NONE;
+    run_ms(1);
+    CHECK(!MQTT_Uplink_Ready());
+    CHECK_EQ(client.inflight_count, 2);
+    CHECK_EQ(MQTT_Uplink_Publish(MQTT_TOPIC_RS485_UP, payload, sizeof(payload)), 0);
+
+    run_ms(MQTT_RETRY_MS);
+    broker.mute = 0;
+    links[UPLINK_ETH].ready = 1;
+    active = UPLINK_ETH;
+    from = broker.log_count;
+    t0 = stub_tick;
+    CHECK(run_until_ready(100));
+    run_ms(10);
+    CHECK(stub_tick - t0 < MQTT_INFLIGHT_RETRY_MS);
+    CHECK(broker.log_count - from >= 2);
+    CHECK(broker.log[from].dup && broker.log[from].payload[3] == 0);
+    CHECK(broker.log[from + 1].dup && broker.log[from + 1].payload[3] == 1);
+    CHECK_EQ(client.inflight_count, 0);
+}
+
+/* 报文标识从 65535 回到 1, 不使用 0 */
+static void test_packet_id_wrap(void)
+{
+    uint8_t payload[4] = {0};
+    uint32_t from, i;
+
+    sim_reset(&lan, &lte);
+    CHECK(run_until_ready(20));
+    run_ms(10);
+    client.next_packetid = MAX_PACKET_ID - 2;
+    from = broker.log_count;
+    for (i = 0; i < 6; i++)
+    {
+        CHECK_EQ(MQTT_Uplink_Publish(MQTT_TOPIC_RS485_UP, payload, sizeof(payload)), 1);
+        run_ms(3);
+    }
+    CHECK_EQ(broker.log[from + 0].id, 65534);
+    CHECK_EQ(broker.log[from + 1].id, 65535);
+    CHECK_EQ(broker.log[from + 2].id, 1);
+    CHECK_EQ(broker.log[from + 3].id, 2);
+    CHECK_EQ(client.inflight_count, 0);
+}
+
+/* 超过接收缓冲的 PUBLISH -------------------------------------------------*/
+
+#define STREAM_MAX              32768
+#define STREAM_TOPIC            "smartcap/77777777/cfg"
+
+static struct
+{
+    uint32_t chunks;
+    uint32_t starts;            /* offset 为 0 的块 */
+    uint32_t bad;               /* 偏移不连续、total 变化或块超出接收缓冲 */
+    uint32_t bytes;
+    uint32_t max_chunk;
+    size_t total;
+    uint8_t data[STREAM_MAX];
+} stream;
+
+static void on_stream(MessageData *md)
+{
+    const uint8_t *p = (const uint8_t *)md->message->payload;
+
+    stream.chunks++;
+    if (md->offset == 0)
+    {
+        stream.starts++;
+        stream.bytes = 0;
+        stream.total = md->total;
+    }
+    if (md->offset != stream.bytes || md->total != stream.total ||
+        p < read_buf || p + md->message->payloadlen > read_buf + sizeof(read_buf) ||
+        md->offset + md->message->payloadlen > STREAM_MAX)
+    {
+        stream.bad++;
+        return;
+    }
+    memcpy(&stream.data[md->offset], p, md->message->payloadlen);
+    stream.bytes += (uint32_t)md->message->payloadlen;
+    if (md->message->payloadlen > stream.max_chunk)
+        stream.max_chunk = (uint32_t)md->message->payloadlen;
+}
+
+static void stream_setup(const link_cfg_t *cfg)
+{
+    sim_reset(cfg, &lte);
+    CHECK(run_until_ready(50));
+    run_ms(10);
+    CHECK_EQ(MQTTSubscribeAsync(&client, STREAM_TOPIC, QOS1, on_stream), SUCCESSS);
+    run_ms(10);
+    memset(&stream, 0, sizeof(stream));
+}
+
+static void fill_pattern(uint8_t *buf, uint32_t len, uint32_t seed)
+{
+    uint32_t i;
+
+    for (i = 0; i < len; i++)
+        buf[i] = (uint8_t)((i * 131 + seed) ^ (i >> 8));
+}
+
+/* 多 KB 的消息通过 256 字节的接收缓冲: 主题先到 (不交给处理函数), 内容按块连续交付,
+ * QoS1 的 PUBACK 在最后一块之后才发; 之后的报文照常解析 */
+static void stream_round(uint16_t chunk, uint8_t split_random, uint32_t len, int qos)
+{
+    static uint8_t payload[STREAM_MAX];
+    link_cfg_t cfg = lan;
+    uint32_t acks;
+
+    cfg.chunk = chunk;
+    cfg.split_random = split_random;
+    stream_setup(&cfg);
+    fill_pattern(payload, len, len + chunk);
+    acks = broker.pubacks_in;
+
+    broker_publish(UPLINK_ETH, STREAM_TOPIC, payload, (int)len, qos, 321);
+    broker_publish(UPLINK_ETH, UID_TOPIC "rs485/down", (const uint8_t *)"tail", 4, 1, 322);
+    while (stream.bytes < len && down_len == 0 && stream.bad == 0 && stub_tick < 100000)
+    {
+        CHECK_EQ(broker.pubacks_in, acks);
+        run_ms(1);
+    }
+    run_ms(10);
+
+    CHECK_EQ(stream.bad, 0);
+    CHECK_EQ(stream.starts, 1);
+    CHECK_EQ(stream.total, len);
+    CHECK_EQ(stream.bytes, len);
+    CHECK_MEM(stream.data, payload, len);
+    CHECK(stream.max_chunk <= MQTT_BUF_SIZE - 3 - 2 - strlen(STREAM_TOPIC) - (qos ? 2 : 0));
+    CHECK_EQ(down_len, 4);
+    CHECK_EQ(broker.pubacks_in - acks, (qos ? 1 : 0) + 1);
+    if (qos)
+        CHECK_EQ(broker.puback_ids[acks], 321);
+    CHECK(MQTT_Uplink_Ready());
+}
+
+static void test_stream(void)
+{
+    uint32_t lens[] = {MQTT_BUF_SIZE - 20, MQTT_BUF_SIZE + 1, 1000, 4096, 20000, STREAM_MAX};
+    uint32_t i;
+
+    for (i = 0; i < sizeof(lens) / sizeof(lens[0]); i++)
+    {
+        stream_round(0, 0, lens[i], 1);
+        stream_round(1, 0, lens[i], 1);
+        stream_round(13, 1, lens[i], 1);
+        stream_round(0, 0, lens[i], 0);
+    }
+}
+
+/* 长的 rs485/down 逐块转发, 接收消息计数每条只加 1; 长的 cmd 丢弃但仍确认 */
+static void test_stream_topics(void)
+{
+    static uint8_t payload[3000];
+    uint32_t acks;
+
+    stream_setup(&lan);
+    fill_pattern(payload, sizeof(payload), 7);
+    broker_publish(UPLINK_ETH, UID_TOPIC "rs485/down", payload, sizeof(payload), 1, 11);
+    run_ms(20);
+    CHECK_EQ(down_len, sizeof(payload));
+    CHECK_MEM(down_data, payload, sizeof(payload));
+    CHECK(down_calls >= sizeof(payload) / MQTT_BUF_SIZE);
+    CHECK_EQ(Metrics_Slots[METRIC_MQTT_RX_MSGS], 1);
+
+    acks = broker.pubacks_in;
+    memset(payload, 'A', sizeof(payload));
+    broker_publish(UPLINK_ETH, UID_TOPIC "cmd", payload, 600, 1, 12);
+    run_ms(20);
+    CHECK_EQ(cmd_count, 0);
+    CHECK_EQ(broker.pubacks_in - acks, 1);
+    CHECK_EQ(Metrics_Slots[METRIC_MQTT_RX_MSGS], 2);
+    CHECK(MQTT_Uplink_Ready());
+}
+
+/* 长的 OTA 'D' 消息: 4 字节偏移可能被拆在两块之间, 每块按其在镜像中的位置写入 */
+static void test_stream_ota(void)
+{
+    static uint8_t image[8192];
+    static uint8_t msg[1 + 4 + 4096];
+    link_cfg_t cfg = lan;
+    uint32_t base, n, round;
+
+    for (round = 0; round < 3; round++)
+    {
+        cfg.chunk = (round == 0) ? 0 : (round == 1) ? 1 : 3;
+        cfg.split_random = (round == 2);
+        stream_setup(&cfg);
+        fill_pattern(image, sizeof(image), round);
+        for (base = 0; base < sizeof(image); base += n)
+        {
+            n = (sizeof(image) - base < 4096) ? sizeof(image) - base : 4096;
+            msg[0] = 'D';
+            msg[1] = (uint8_t)(base >> 24);
+            msg[2] = (uint8_t)(base >> 16);
+            msg[3] = (uint8_t)(base >> 8);
+            msg[4] = (uint8_t)base;
+            memcpy(&msg[5], &image[base], n);
+            broker_publish(UPLINK_ETH, UID_TOPIC "ota", msg, (int)(5 + n), 1, (uint16_t)(50 + base / 4096));
+            run_ms(100);
+        }
+        CHECK_EQ(ota_bad_offset, 0);
+        CHECK_EQ(ota_received, sizeof(image));
+        CHECK_MEM(ota_image, image, sizeof(image));
+        CHECK_EQ(Metrics_Slots[METRIC_MQTT_RX_MSGS], 2);
+        CHECK(MQTT_Uplink_Ready());
+    }
+}
+
+/* 主题太长, 接收缓冲放不下主题和一个内容字节: 无法继续解析, 断开会话后重连 */
+static void test_stream_topic_too_long(void)
+{
+    static char topic[MQTT_BUF_SIZE + 16];
+    static uint8_t payload[600];
+
+    stream_setup(&lan);
+    memset(topic, 't', sizeof(topic) - 1);
+    topic[sizeof(topic) - 1] = '\0';
+    broker_publish(UPLINK_ETH, topic, payload, sizeof(payload), 1, 99);
+    run_ms(10);
+    CHECK(!MQTT_Uplink_Ready());
+    CHECK_EQ(stream.chunks, 0);
+    CHECK_EQ(Metrics_Slots[METRIC_MQTT_SESSION_DROPS], 1);
+    CHECK(run_until_ready(MQTT_RETRY_MS + 100));
+
+    /* 主题刚好留出一个内容字节 */
+    memset(&stream, 0, sizeof(stream));
+    topic[MQTT_BUF_SIZE - 3 - 2 - 2 - 1] = '\0';
+    client.defaultMessageHandler = on_stream;   /* SUBSCRIBE 放不进发送缓冲 */
+    broker_publish(UPLINK_ETH, topic, payload, sizeof(payload), 1, 100);
+    run_ms(10);
+    CHECK(MQTT_Uplink_Ready());
+    CHECK_EQ(stream.bad, 0);
+    CHECK_EQ(stream.bytes, sizeof(payload));
+    CHECK_EQ(stream.chunks, sizeof(payload));
+    CHECK_EQ(stream.max_chunk, 1);
+}
+
+/* 基准: 消息全部到达后一次轮询的耗时 (只计客户端), 接收缓冲固定为 MQTT_BUF_SIZE */
+static void test_stream_bench(void)
+{
+    static uint8_t payload[STREAM_MAX];
+    static const uint32_t lens[] = {200, 1024, 8192, STREAM_MAX};
+    link_cfg_t cfg = lan;
+    unsigned long long t0, spent;
+    uint32_t i, k, chunks, rounds = 200;
+
+    cfg.window = PIPE_SIZE;
+    printf("  readbuf %u B:", (unsigned)sizeof(read_buf));
+    for (i = 0; i < 4; i++)
+    {
+        stream_setup(&cfg);
+        fill_pattern(payload, lens[i], i);
+        spent = 0;
+        for (k = 0; k < rounds; k++)
+        {
+            broker_publish(UPLINK_ETH, STREAM_TOPIC, payload, (int)lens[i], 1, (uint16_t)(k + 1));
+            stub_tick += 1000;
+            t0 = test_now_ns();
+            MQTT_Uplink_Poll();
+            spent += test_now_ns() - t0;
+            run_ms(5);
+        }
+        chunks = stream.chunks / rounds;
+        CHECK_EQ(stream.bad, 0);
+        CHECK_EQ(stream.starts, rounds);
+        CHECK_EQ(stream.bytes, lens[i]);
+        CHECK_EQ(broker.pubacks_in, rounds);
+        printf(" %u B in %u chunk%s %.0f ns/KB%s", lens[i], chunks, (chunks > 1) ? "s" : "",
+               (double)spent / (rounds * lens[i] / 1024.0), (i < 3) ? "," : "\n");
+    }
+}
+
+/* 基准 ---------------------------------------------------------------------*/
+
+static uint32_t lat_percentile(uint32_t pct)
+{
+    uint32_t total = 0, acc = 0, i;
+
+    for (i = 0; i < LAT_BUCKETS; i++)
+        total += lat_hist[i];
+    for (i = 0; i < LAT_BUCKETS; i++)
+    {
+        acc += lat_hist[i];
+        if (acc * 100ULL >= (uint64_t)total * pct)
+            return i;
+    }
+    return LAT_BUCKETS;
+}
+
+/* rate=0: 每毫秒发布到窗口满为止; 否则每秒 rate 条 */
+static void bench_link(const char *name, const link_cfg_t *cfg, uint32_t rate, uint32_t seconds)
+{
+    uint8_t payload[64];
+    uint32_t seq = 0, ms, accepted;
+    unsigned long long t0, t1;
+
+    sim_reset(cfg, cfg);
+    CHECK(run_until_ready(1000));
+    run_ms(500);
+    memset(seen, 0, sizeof(seen));
+    memset(lat_hist, 0, sizeof(lat_hist));
+    seq_delivered = seq_duplicates = 0;
+    memset(payload, 0x33, sizeof(payload));
+
+    t0 = test_now_ns();
+    for (ms = 0; ms < seconds * 1000; ms++)
+    {
+        do
+        {
+            if (rate != 0 && seq >= (uint64_t)ms * rate / 1000 + 1)
+                break;
+            payload[0] = (uint8_t)(seq >> 24);
+            payload[1] = (uint8_t)(seq >> 16);
+            payload[2] = (uint8_t)(seq >> 8);
+            payload[3] = (uint8_t)seq;
+            sent_at[seq] = stub_tick;
+            accepted = MQTT_Uplink_Publish(MQTT_TOPIC_RS485_UP, payload, sizeof(payload));
+            seq += accepted;
+        } while (accepted && seq < SEQ_MAX);
+        run_ms(1);
+    }
+    run_ms(2000);
+    t1 = test_now_ns();
+
+    CHECK_EQ(seq_delivered, seq);
+    CHECK_EQ(seq_duplicates, 0);
+    CHECK(MQTT_Uplink_Ready());
+    printf("  %-5s %s: %6.0f msg/s, latency p50 %u ms p99 %u ms, %.0f ns host time per message (client and broker stand-in)\n", name,
+           rate ? "paced  " : "flooded", (double)seq_delivered / seconds, lat_percentile(50), lat_percentile(99),
+           (double)(t1 - t0) / (seq_delivered ? seq_delivered : 1));
+}
+
+/* 不同窗口在蜂窝链路上的 QoS1 消息速率: 窗口为 1 即原来逐条等待 PUBACK 的 MQTTPublish */
+static void test_window_bench(void)
+{
+    static unsigned char store[MAX_INFLIGHT][MQTT_BUF_SIZE];
+    static const uint32_t rtts[] = {80, 150};
+    static const uint32_t windows[] = {1, 2, 4, 8};
+    link_cfg_t cfg = lte;
+    uint8_t payload[64];
+    uint32_t r, w, seq, ms, seconds = 20;
+    double rate, prev;
+
+    memset(payload, 0x44, sizeof(payload));
+    for (r = 0; r < 2; r++)
+    {
+        cfg.delay_ms = rtts[r] / 2;
+        cfg.ns_per_byte = 8000;                 /* 1 Mbit/s: 速率由往返时延和窗口决定 */
+        printf("  RTT %3u ms:", rtts[r]);
+        prev = 0;
+        for (w = 0; w < 4; w++)
+        {
+            sim_reset(&cfg, &cfg);
+            CHECK(run_until_ready(1000));
+            run_ms(500);
+            MQTTSetInflightWindow(&client, store[0], MQTT_BUF_SIZE, windows[w], MQTT_INFLIGHT_RETRY_MS);
+            memset(seen, 0, sizeof(seen));
+            seq_delivered = seq_duplicates = 0;
+            seq = 0;
+            for (ms = 0; ms < seconds * 1000; ms++)
+            {
+                for (;;)
+                {
+                    payload[0] = (uint8_t)(seq >> 24);
+                    payload[1] = (uint8_t)(seq >> 16);
+                    payload[2] = (uint8_t)(seq >> 8);
+                    payload[3] = (uint8_t)seq;
+                    sent_at[seq] = stub_tick;
+                    if (!MQTT_Uplink_Publish(MQTT_TOPIC_RS485_UP, payload, sizeof(payload)))
+                        break;
+                    seq++;
+                }
+                run_ms(1);
+            }
+            run_ms(1000);
+            rate = (double)seq_delivered / seconds;
+            CHECK_EQ(seq_delivered, seq);
+            CHECK_EQ(seq_duplicates, 0);
+            CHECK_EQ(client.retransmits, 0);
+            /* 每个往返发出一个窗口 (另有约 1 ms 的发送和轮询间隔) */
+            CHECK(rate > 0.9 * windows[w] * 1000.0 / (rtts[r] + 2) && rate <= 1.02 * windows[w] * 1000.0 / rtts[r]);
+            CHECK(rate > prev);
+            prev = rate;
+            printf(" window %u %5.1f msg/s%s", windows[w], rate, (w < 3) ? "," : "\n");
+        }
+    }
+}
+
+static void test_bench(void)
+{
+    bench_link("lan", &lan, 0, 10);
+    bench_link("lan", &lan, 100, 10);
+    bench_link("lte", &lte, 0, 30);
+    bench_link("lte", &lte, 20, 30);
+}
+
+int main(void)
+{
+    TEST_RUN(test_session);
+    TEST_RUN(test_publish);
+    TEST_RUN(test_partial_packets);
+    TEST_RUN(test_keepalive_loss);
+    TEST_RUN(test_connack_refused);
+    TEST_RUN(test_failover);
+    TEST_RUN(test_window_out_of_order);
+    TEST_RUN(test_retransmit);
+    TEST_RUN(test_resend_on_reconnect);
+    TEST_RUN(test_packet_id_wrap);
+    TEST_RUN(test_window_bench);
+    TEST_RUN(test_stream);
+    TEST_RUN(test_stream_topics);
+    TEST_RUN(test_stream_ota);
+    TEST_RUN(test_stream_topic_too_long);
+    TEST_RUN(test_stream_bench);
+    TEST_RUN(test_bench);
+    return test_summary("mqtt_uplink");
+}
@@ -0,0 +1,326 @@
+/**
+  ******************************************************************************
+  * @file    test_net_pcap.c
+  * @brief   pcap Writer: Header Layout, Frame Parsing and Record Ring
+  ******************************************************************************
+  * @description
+  * 记录环的读出端模拟 TCP 推送: 每次 peek 一段连续数据再 consume, 拼接后的字节流
+  * 必须与按 pcap 格式逐条构造的期望值一致 (含环回绕)。
+  ******************************************************************************
+  */
+
+#include "test.h"
+#include "../../User/wiz_interface/net_pcap.c"
+
+static uint32_t le32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t le16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+/* 构造以太网帧: 可选 VLAN 标签, 之后是 IPv4 (ihl 个 32 位字) + 端口 */
+static uint16_t build_ipv4(uint8_t *f, uint16_t vlan, uint8_t ihl, uint8_t proto, uint16_t frag,
+                           uint16_t sport, uint16_t dport)
+{
+    uint16_t off = 12;
+
+    memset(f, 0, 128);
+    if (vlan != 0)
+    {
+        f[off++] = 0x81;
+        f[off++] = 0x00;
+        f[off++] = (uint8_t)(0xE0 | (vlan >> 8));  // PCP 位不应影响 VLAN ID
+        f[off++] = (uint8_t)vlan;
+    }
+    f[off++] = 0x08;
+    f[off++] = 0x00;
+    f[off] = (uint8_t)(0x40 | ihl);
+    f[off + 6] = (uint8_t)(frag >> 8);
+    f[off + 7] = (uint8_t)frag;
+    f[off + 9] = proto;
+    off += ihl * 4;
+    f[off++] = (uint8_t)(sport >> 8);
+    f[off++] = (uint8_t)sport;
+    f[off++] = (uint8_t)(dport >> 8);
+    f[off++] = (uint8_t)dport;
+    return off;
+}
+
+static void test_global_header(void)
+{
+    uint8_t hdr[PCAP_GLOBAL_HDR_LEN + 1];
+    static const uint8_t expect[PCAP_GLOBAL_HDR_LEN] = {
+        0xD4, 0xC3, 0xB2, 0xA1, 0x02, 0x00, 0x04, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0xEA, 0x05, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00
+    };
+
+    hdr[PCAP_GLOBAL_HDR_LEN] = 0x5A;
+    CHECK_EQ(pcap_write_global_header(hdr, 1514), PCAP_GLOBAL_HDR_LEN);
+    CHECK_MEM(hdr, expect, PCAP_GLOBAL_HDR_LEN);
+    CHECK_EQ(hdr[PCAP_GLOBAL_HDR_LEN], 0x5A);
+}
+
+static void test_record_header(void)
+{
+    uint8_t buf[64];
+    uint8_t data[6] = { 1, 2, 3, 4, 5, 6 };
+    const uint8_t *p;
+    pcap_ring_t ring;
+
+    pcap_ring_init(&ring, buf, sizeof(buf));
+    CHECK_EQ(pcap_ring_put(&ring, 123456789, data, sizeof(data), 1514), 0);
+    CHECK_EQ(pcap_ring_used(&ring), PCAP_RECORD_HDR_LEN + sizeof(data));
+    CHECK_EQ(pcap_ring_peek(&ring, &p), PCAP_RECORD_HDR_LEN + sizeof(data));
+    CHECK_EQ(le32(&p[0]), 123456);         // ts_sec
+    CHECK_EQ(le32(&p[4]), 789000);         // ts_usec
+    CHECK_EQ(le32(&p[8]), sizeof(data));   // incl_len
+    CHECK_EQ(le32(&p[12]), 1514);          // orig_len
+    CHECK_MEM(&p[16], data, sizeof(data));
+
+    /* 毫秒计数回绕前的最后一个值 */
+    pcap_ring_reset(&ring);
+    CHECK_EQ(pcap_ring_put(&ring, 0xFFFFFFFFU, data, 0, 60), 0);
+    pcap_ring_peek(&ring, &p);
+    CHECK_EQ(le32(&p[0]), 4294967);
+    CHECK_EQ(le32(&p[4]), 295000);
+    CHECK_EQ(le32(&p[8]), 0);
+    CHECK_EQ(le16(&p[12]), 60);
+}
+
+static void test_parse_ipv4(void)
+{
+    uint8_t f[128];
+    net_frame_info_t info;
+    uint16_t len;
+
+    len = build_ipv4(f, 0, 5, NET_IPPROTO_TCP, 0, 502, 49152);
+    CHECK_EQ(net_frame_parse(f, len, &info), 0);
+    CHECK_EQ(info.ethertype, NET_ETHERTYPE_IPV4);
+    CHECK_EQ(info.vlan, 0);
+    CHECK_EQ(info.ip_proto, NET_IPPROTO_TCP);
+    CHECK_EQ(info.src_port, 502);
+    CHECK_EQ(info.dst_port, 49152);
+
+    /* IP 选项: 端口位置随 IHL 后移 */
+    len = build_ipv4(f, 0, 8, NET_IPPROTO_UDP, 0, 161, 1024);
+    CHECK_EQ(net_frame_parse(f, len, &info), 0);
+    CHECK_EQ(info.ip_proto, NET_IPPROTO_UDP);
+    CHECK_EQ(info.src_port, 161);
+    CHECK_EQ(info.dst_port, 1024);
+
+    /* 一层 VLAN */
+    len = build_ipv4(f, 0x123, 5, NET_IPPROTO_UDP, 0, 68, 67);
+    CHECK_EQ(net_frame_parse(f, len, &info), 0);
+    CHECK_EQ(info.vlan, 0x123);
+    CHECK_EQ(info.ethertype, NET_ETHERTYPE_IPV4);
+    CHECK_EQ(info.src_port, 68);
+    CHECK_EQ(info.dst_port, 67);
+
+    /* 非首片: 有协议号, 没有端口; DF 位不算分片 */
+    len = build_ipv4(f, 0, 5, NET_IPPROTO_UDP, 0x00B9, 53, 53);
+    net_frame_parse(f, len, &info);
+    CHECK_EQ(info.ip_proto, NET_IPPROTO_UDP);
+    CHECK_EQ(info.src_port, 0);
+    len = build_ipv4(f, 0, 5, NET_IPPROTO_UDP, 0x4000, 53, 53);
+    net_frame_parse(f, len, &info);
+    CHECK_EQ(info.src_port, 53);
+
+    /* ICMP 没有端口 */
+    len = build_ipv4(f, 0, 5, NET_IPPROTO_ICMP, 0, 0x0800, 0x1234);
+    net_frame_parse(f, len, &info);
+    CHECK_EQ(info.ip_proto, NET_IPPROTO_ICMP);
+    CHECK_EQ(info.src_port, 0);
+    CHECK_EQ(info.dst_port, 0);
+}
+
+static void test_parse_truncated(void)
+{
+    uint8_t f[128];
+    net_frame_info_t info;
+    uint16_t len;
+
+    len = build_ipv4(f, 0, 5, NET_IPPROTO_TCP, 0, 80, 8080);
+    CHECK_EQ(net_frame_parse(f, 13, &info), -1);
+    CHECK_EQ(info.ethertype, 0);
+
+    /* 截到端口前: 协议号有效, 端口为 0 */
+    CHECK_EQ(net_frame_parse(f, len - 1, &info), 0);
+    CHECK_EQ(info.ip_proto, NET_IPPROTO_TCP);
+    CHECK_EQ(info.src_port, 0);
+
+    /* IP 头不完整 */
+    CHECK_EQ(net_frame_parse(f, 14 + 19, &info), 0);
+    CHECK_EQ(info.ethertype, NET_ETHERTYPE_IPV4);
+    CHECK_EQ(info.ip_proto, 0);
+
+    /* IHL < 5 是非法报文 */
+    f[14] = 0x44;
+    net_frame_parse(f, len, &info);
+    CHECK_EQ(info.ip_proto, 0);
+
+    /* VLAN 标签不完整 */
+    len = build_ipv4(f, 7, 5, NET_IPPROTO_TCP, 0, 80, 8080);
+    CHECK_EQ(net_frame_parse(f, 16, &info), 0);
+    CHECK_EQ(info.ethertype, NET_ETHERTYPE_VLAN);
+    CHECK_EQ(info.vlan, 0);
+}
+
+static void test_parse_ipv6_arp(void)
+{
+    uint8_t f[128];
+    net_frame_info_t info;
+
+    memset(f, 0, sizeof(f));
+    f[12] = 0x86;
+    f[13] = 0xDD;
+    f[14] = 0x60;
+    f[14 + 6] = NET_IPPROTO_UDP;
+    f[54] = 0x02;  // 546 -> 547 (DHCPv6)
+    f[55] = 0x22;
+    f[56] = 0x02;
+    f[57] = 0x23;
+    CHECK_EQ(net_frame_parse(f, 58, &info), 0);
+    CHECK_EQ(info.ethertype, NET_ETHERTYPE_IPV6);
+    CHECK_EQ(info.ip_proto, NET_IPPROTO_UDP);
+    CHECK_EQ(info.src_port, 546);
+    CHECK_EQ(info.dst_port, 547);
+
+    /* 版本号不对 */
+    f[14] = 0x40;
+    net_frame_parse(f, 58, &info);
+    CHECK_EQ(info.ip_proto, 0);
+
+    f[12] = 0x08;
+    f[13] = 0x06;
+    CHECK_EQ(net_frame_parse(f, 42, &info), 0);
+    CHECK_EQ(info.ethertype, NET_ETHERTYPE_ARP);
+    CHECK_EQ(info.ip_proto, 0);
+}
+
+static void test_filter(void)
+{
+    net_frame_info_t info = { NET_ETHERTYPE_IPV4, 0, NET_IPPROTO_TCP, 502, 49152 };
+    net_frame_filter_t any = { 0, 0, 0 };
+    net_frame_filter_t arp = { NET_ETHERTYPE_ARP, 0, 0 };
+    net_frame_filter_t udp = { 0, NET_IPPROTO_UDP, 0 };
+    net_frame_filter_t sport = { NET_ETHERTYPE_IPV4, NET_IPPROTO_TCP, 502 };
+    net_frame_filter_t dport = { 0, 0, 49152 };
+    net_frame_filter_t other = { 0, NET_IPPROTO_TCP, 80 };
+
+    CHECK_EQ(net_frame_match(NULL, &info), 1);
+    CHECK_EQ(net_frame_match(&any, &info), 1);
+    CHECK_EQ(net_frame_match(&arp, &info), 0);
+    CHECK_EQ(net_frame_match(&udp, &info), 0);
+    CHECK_EQ(net_frame_match(&sport, &info), 1);
+    CHECK_EQ(net_frame_match(&dport, &info), 1);
+    CHECK_EQ(net_frame_match(&other, &info), 0);
+}
+
+/* 整条记录放不下时丢弃, 保留的 1 字节不可用 */
+static void test_ring_full(void)
+{
+    uint8_t buf[64];
+    uint8_t data[32];
+    pcap_ring_t ring;
+
+    memset(data, 0xA5, sizeof(data));
+    pcap_ring_init(&ring, buf, sizeof(buf));
+    CHECK_EQ(pcap_ring_put(&ring, 0, data, 31, 31), 0);  // 47 字节, 剩 16
+    CHECK_EQ(pcap_ring_put(&ring, 0, data, 1, 1), -1);   // 17 > 16
+    CHECK_EQ(ring.dropped, 1);
+    CHECK_EQ(pcap_ring_used(&ring), 47);
+    CHECK_EQ(pcap_ring_put(&ring, 0, data, 0, 0), 0);    // 16 正好放下
+    CHECK_EQ(pcap_ring_used(&ring), 63);
+    CHECK_EQ(pcap_ring_put(&ring, 0, data, 0, 0), -1);
+    CHECK_EQ(ring.dropped, 2);
+
+    /* reset 清空数据, 不清丢弃计数 */
+    pcap_ring_reset(&ring);
+    CHECK_EQ(pcap_ring_used(&ring), 0);
+    CHECK_EQ(ring.dropped, 2);
+
+    /* 比整个环还大的记录 */
+    CHECK_EQ(pcap_ring_put(&ring, 0, data, 48, 48), -1);
+    CHECK_EQ(ring.dropped, 3);
+}
+
+/* 边写边读, 读出的字节流与逐条构造的 pcap 记录一致 */
+static void test_ring_stream(void)
+{
+    static uint8_t buf[97];
+    static uint8_t expect[8192];
+    static uint8_t got[8192];
+    uint8_t data[40];
+    uint32_t exp_len = 0, got_len = 0;
+    uint32_t wraps = 0, put_fail = 0;
+    pcap_ring_t ring;
+    uint16_t i;
+
+    pcap_ring_init(&ring, buf, sizeof(buf));
+    for (i = 0; i < 200; i++)
+    {
+        uint16_t caplen = (uint16_t)(i * 7 % 41);
+        uint16_t n;
+        const uint8_t *p;
+
+        memset(data, (uint8_t)i, caplen);
+        if (pcap_ring_put(&ring, i * 1001U, data, caplen, (uint16_t)(caplen + i)) == 0)
+        {
+            wr32le(&expect[exp_len], i * 1001U / 1000);
+            wr32le(&expect[exp_len + 4], i * 1001U % 1000 * 1000);
+            wr32le(&expect[exp_len + 8], caplen);
+            wr32le(&expect[exp_len + 12], caplen + i);
+            memset(&expect[exp_len + 16], (uint8_t)i, caplen);
+            exp_len += PCAP_RECORD_HDR_LEN + caplen;
+        }
+        else
+        {
+            put_fail++;
+        }
+
+        /* 每轮最多读出 23 字节, 读得比写得慢, 环会反复写满和回绕 */
+        n = pcap_ring_peek(&ring, &p);
+        CHECK(n <= pcap_ring_used(&ring));
+        if (n > 23)
+            n = 23;
+        if (ring.tail + n == ring.size)
+            wraps++;
+        memcpy(&got[got_len], p, n);
+        got_len += n;
+        pcap_ring_consume(&ring, n);
+    }
+
+    while (pcap_ring_used(&ring) != 0)
+    {
+        const uint8_t *p;
+        uint16_t n = pcap_ring_peek(&ring, &p);
+
+        memcpy(&got[got_len], p, n);
+        got_len += n;
+        pcap_ring_consume(&ring, n);
+    }
+
+    CHECK(wraps > 10);
+    CHECK(put_fail > 0);
+    CHECK_EQ(ring.dropped, put_fail);
+    CHECK_EQ(got_len, exp_len);
+    CHECK_MEM(got, expect, exp_len);
+}
+
+int main(void)
+{
+    TEST_RUN(test_global_header);
+    TEST_RUN(test_record_header);
+    TEST_RUN(test_parse_ipv4);
+    TEST_RUN(test_parse_truncated);
+    TEST_RUN(test_parse_ipv6_arp);
+    TEST_RUN(test_filter);
+    TEST_RUN(test_ring_full);
+    TEST_RUN(test_ring_stream);
+    return test_summary("net_pcap");
+}
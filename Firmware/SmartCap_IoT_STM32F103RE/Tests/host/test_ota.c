@@ -0,0 +1,475 @@
+/**
+  ******************************************************************************
+  * @file    test_ota.c
+  * @brief   OTA Staging, Bootloader Swap and Rollback Under Power Cuts
+  ******************************************************************************
+  * @description
+  * ota.c、flash_if.c 和引导程序 boot_main.c 运行在 flash_sim.h 模拟的片内 Flash 上:
+  * - 下载: 在每一次擦写时断电, 重新上电后 OTA_Init 恢复, 用同一文件头从 received 继续,
+  *   最终暂存区与固件一致并记录 ready
+  * - 安装/回滚交换: 在每次擦除、每个状态页写入和每页复制的首尾编程处断电, 部分断电点
+  *   在恢复过程中再断一次, 最终运行区为新固件 (回滚后为旧固件), 引导程序跳转到应用
+  * - 试运行确认、试运行超时和暂存区在校验后被改写的情况
+  * 引导程序跳转前调用 __set_MSP, 本文件在那里 longjmp 回测试, 记为一次成功启动。
+  ******************************************************************************
+  */
+
+#include "test.h"
+#include "flash_sim.h"
+#include "../../User/ota/sha256.c"
+#include "../../User/fs/flash_if.c"
+#include "../../User/ota/ota.c"
+#define main Boot_Main
+#include "../../Bootloader/boot_main.c"
+#undef main
+
+#define OLD_SIZE                (OTA_PAGE_SIZE + 600)
+#define NEW_SIZE                (2 * OTA_PAGE_SIZE + 301)   /* 奇数长度, 最后一个半字补 0xFF */
+
+static uint8_t old_img[OTA_SLOT_SIZE];
+static uint8_t new_img[OTA_SLOT_SIZE];
+static uint8_t new_hdr[sizeof(OTA_ImageHeader_t)];
+static uint8_t snapshot[SIM_FLASH_SIZE];
+static uint8_t after_cut[SIM_FLASH_SIZE];
+static uint32_t plan[SIM_FLASH_LOG_MAX];         /* 不断电时的擦写序列 */
+
+static jmp_buf boot_jump;
+static uint32_t boot_sp;
+
+static wiz_sup_state_t eth_state = WIZ_SUP_STATE_UP;
+static uint8_t tasks_alive = 1;
+
+/* ota.c 用到的其它模块 -----------------------------------------------------*/
+
+void TFTP_init(uint8_t socket, uint8_t *buf) { }
+void TFTP_exit(void) { }
+int TFTP_run(void) { return TFTP_FAIL; }
+void TFTP_read_request(uint32_t server_ip, uint8_t *filename) { }
+void tftp_timeout_handler(void) { }
+void TFTP_get_transfer_info(uint16_t *blk_size, uint16_t *window, uint16_t *rto_ms)
+{
+    *blk_size = TFTP_BLK_SIZE;
+    *window = 1;
+    *rto_ms = TFTP_RTO_INIT_MS;
+}
+wiz_sup_state_t wiz_supervisor_get_state(void) { return eth_state; }
+Uplink_ID_t Uplink_Router_GetActive(void) { return UPLINK_NONE; }
+uint8_t TaskWdg_AllAlive(void) { return tasks_alive; }
+
+void __set_MSP(uint32_t msp)
+{
+    boot_sp = msp;
+    longjmp(boot_jump, 1);
+}
+
+/* 固件和 Flash 内容 --------------------------------------------------------*/
+
+/* 向量表 (栈顶, 复位入口) 指向运行区, 其余为伪随机内容 */
+static void make_image(uint8_t *img, uint32_t size, uint32_t seed)
+{
+    uint32_t sp = SRAM_BASE + 0x10000, pc = OTA_APP_ADDR + 0x131 + seed * 4;
+    uint32_t i, x = seed * 2654435761UL + 1;
+
+    for (i = 0; i < size; i++)
+    {
+        x = x * 1103515245UL + 12345;
+        img[i] = (uint8_t)(x >> 16);
+    }
+    memcpy(img, &sp, 4);
+    memcpy(img + 4, &pc, 4);
+}
+
+static void make_header(uint8_t *out, const uint8_t *img, uint32_t size, uint32_t version)
+{
+    OTA_ImageHeader_t hdr;
+    SHA256_Ctx_t sha;
+
+    memset(&hdr, 0xFF, sizeof(hdr));
+    hdr.magic = OTA_IMAGE_MAGIC;
+    hdr.size = size;
+    hdr.crc32 = OTA_Crc32(0, img, size);
+    hdr.version = version;
+    SHA256_Init(&sha);
+    SHA256_Update(&sha, img, size);
+    SHA256_Final(&sha, hdr.sha256);
+    hdr.header_crc = OTA_Crc32(0, (const uint8_t *)&hdr, offsetof(OTA_ImageHeader_t, header_crc));
+    memcpy(out, &hdr, sizeof(hdr));
+}
+
+static const uint8_t *flash_at(uint32_t addr)
+{
+    return sim_flash + (addr - SIM_FLASH_BASE);
+}
+
+/* 出厂状态: 运行区为旧固件, 其余为空 */
+static void factory(void)
+{
+    sim_flash_reset();
+    memcpy(sim_flash + (OTA_APP_ADDR - SIM_FLASH_BASE), old_img, OLD_SIZE);
+}
+
+static void save_flash(void)
+{
+    memcpy(snapshot, sim_flash, SIM_FLASH_SIZE);
+}
+
+static void load_flash(void)
+{
+    memcpy(sim_flash, snapshot, SIM_FLASH_SIZE);
+}
+
+/* 上电运行引导程序, cut 为本次上电后第几次擦写时断电; 返回 1:跳转到应用  0:断电 */
+static int boot(uint32_t cut)
+{
+    sim_flash_power_on(cut);
+    memset(IWDG, 0, sizeof(*IWDG));
+    if (setjmp(sim_flash_power))
+        return 0;
+    if (setjmp(boot_jump))
+        return 1;
+    Boot_Main();
+    return -1;
+}
+
+/* 应用启动: 清除 ota.c 的 RAM 状态后 OTA_Init */
+static void app_start(void)
+{
+    ota_busy = 0;
+    phase = OTA_PHASE_IDLE;
+    memset(&image, 0, sizeof(image));
+    received = 0;
+    carry = 0;
+    trial = 0;
+    reverted = 0;
+    error = NULL;
+    seq = 0;
+    verify_pos = 0;
+    ready_tick = 0;
+    trial_fail_tick = 0;
+    tftp_request = 0;
+    tftp_active = 0;
+    stub_tick = 0;
+    stub_resets = 0;
+    OTA_Init();
+}
+
+/* 按 HTTP 上传的方式从 received 开始写入, 收齐后校验到 ready; 返回 1:ready */
+static int upload(uint16_t chunk)
+{
+    OTA_Status_t st;
+    uint32_t n;
+
+    if (OTA_Begin(new_hdr, sizeof(new_hdr)) != OTA_OK)
+        return 0;
+    OTA_GetStatus(&st);
+    while (st.received < NEW_SIZE)
+    {
+        n = NEW_SIZE - st.received;
+        if (n > chunk)
+            n = chunk;
+        if (OTA_Write(st.received, new_img + st.received, (uint16_t)n) != OTA_OK)
+            return 0;
+        OTA_GetStatus(&st);
+    }
+    while (phase == OTA_PHASE_VERIFYING)
+        OTA_Poll();
+    return phase == OTA_PHASE_READY;
+}
+
+/* 应用上电并完成下载, 返回断电前的擦写次数 */
+static uint32_t app_upload(uint32_t cut, uint16_t chunk)
+{
+    sim_flash_power_on(cut);
+    if (setjmp(sim_flash_power))
+        return 0;
+    app_start();
+    CHECK(upload(chunk));
+    return sim_flash_ops;
+}
+
+/* 记录不断电时的擦写序列 */
+static uint32_t record_plan(void)
+{
+    memcpy(plan, sim_flash_log, sizeof(plan));
+    return sim_flash_ops;
+}
+
+/* 断电点: 擦除、状态页写入、紧挨着它们的编程, 以及每 stride 次中的一次 */
+static int cut_point(uint32_t i, uint32_t total, uint32_t stride)
+{
+    uint32_t j, addr;
+
+    for (j = (i > 0) ? i - 1 : 0; j <= i + 1 && j < total; j++)
+    {
+        addr = plan[j] & ~SIM_FLASH_LOG_ERASE;
+        if ((plan[j] & SIM_FLASH_LOG_ERASE) || (addr >= OTA_STATE_ADDR && addr < OTA_STATE_ADDR + OTA_PAGE_SIZE))
+            return 1;
+    }
+    return (i % stride) == 0;
+}
+
+/* 安装或回滚完成后的检查 */
+static void check_app(const uint8_t *img, uint32_t size)
+{
+    CHECK_MEM(flash_at(OTA_APP_ADDR), img, size);
+    CHECK_EQ(boot_sp, SRAM_BASE + 0x10000);
+    CHECK_EQ(SCB->VTOR, OTA_APP_ADDR);
+}
+
+/* 测试 ---------------------------------------------------------------------*/
+
+/* 下载过程中每一次擦写都可能断电, 恢复后从最后一个完整的页继续 */
+static void test_staging_power_cut(void)
+{
+    OTA_Status_t st;
+    uint32_t total, cut;
+    uint32_t resumed_pages = 0;
+
+    factory();
+    total = app_upload(0, 256);
+    CHECK(total > NEW_SIZE / 2);
+    CHECK_MEM(flash_at(OTA_STAGING_ADDR), new_img, NEW_SIZE);
+    CHECK_EQ(ota_state->ready, OTA_FLAG_SET);
+
+    for (cut = 1; cut <= total; cut++)
+    {
+        factory();
+        CHECK_EQ(app_upload(cut, 256), 0);
+
+        /* 重新上电: 已记录的页都是完整的 */
+        sim_flash_power_on(0);
+        app_start();
+        OTA_GetStatus(&st);
+        if (st.phase == OTA_PHASE_RECEIVING)
+        {
+            CHECK_EQ(st.received % OTA_PAGE_SIZE, 0);
+            CHECK_MEM(flash_at(OTA_STAGING_ADDR), new_img, st.received);
+            resumed_pages += st.received / OTA_PAGE_SIZE;
+        }
+        else
+            CHECK(st.phase == OTA_PHASE_IDLE || st.phase == OTA_PHASE_VERIFYING);
+
+        CHECK(upload(200));
+        CHECK_MEM(flash_at(OTA_STAGING_ADDR), new_img, NEW_SIZE);
+        CHECK_EQ(ota_state->ready, OTA_FLAG_SET);
+        CHECK_MEM(flash_at(OTA_APP_ADDR), old_img, OLD_SIZE);
+    }
+    CHECK(resumed_pages > 0);
+    CHECK_EQ(sim_flash_errors, 0);
+}
+
+/* 同一文件头继续, 不同的文件头重新开始; 偏移不对时拒绝 */
+static void test_resume_rules(void)
+{
+    static uint8_t other_hdr[sizeof(OTA_ImageHeader_t)];
+    OTA_Status_t st;
+
+    factory();
+    sim_flash_power_on(0);
+    app_start();
+    CHECK_EQ(OTA_Begin(new_hdr, sizeof(new_hdr)), OTA_OK);
+    CHECK_EQ(OTA_Write(0, new_img, 1000), OTA_OK);
+    CHECK_EQ(OTA_Write(0, new_img, 10), OTA_ERR_OFFSET);
+    CHECK_EQ(OTA_Write(1000, new_img + 1000, 1500), OTA_OK);
+
+    /* 断电前写了 1 页多, 恢复后从第 1 页结束处继续 */
+    app_start();
+    OTA_GetStatus(&st);
+    CHECK_EQ(st.phase, OTA_PHASE_RECEIVING);
+    CHECK_EQ(st.received, OTA_PAGE_SIZE);
+    CHECK_EQ(OTA_Begin(new_hdr, sizeof(new_hdr)), OTA_OK);
+    OTA_GetStatus(&st);
+    CHECK_EQ(st.received, OTA_PAGE_SIZE);
+
+    /* 另一个版本: 状态页擦除, 从 0 开始 */
+    make_header(other_hdr, new_img, NEW_SIZE, 99);
+    CHECK_EQ(OTA_Begin(other_hdr, sizeof(other_hdr)), OTA_OK);
+    OTA_GetStatus(&st);
+    CHECK_EQ(st.received, 0);
+    CHECK_EQ(st.version, 99);
+    CHECK_EQ(ota_state->page_done[0], OTA_FLAG_CLEAR);
+
+    other_hdr[8] ^= 1;
+    CHECK_EQ(OTA_Begin(other_hdr, sizeof(other_hdr)), OTA_ERR_HEADER);
+    CHECK_EQ(sim_flash_errors, 0);
+}
+
+/* 引导程序交换的每一步都可能断电 (部分在恢复时再断一次), 最终安装新固件 */
+static void test_install_power_cut(void)
+{
+    static const uint32_t seconds[] = { 1, 2, 3, 1026, 2051, 4000 };
+    uint32_t total, cut, runs = 0;
+    uint8_t k;
+
+    factory();
+    CHECK_EQ(app_upload(0, 512) > 0, 1);
+    save_flash();
+
+    CHECK_EQ(boot(0), 1);
+    total = record_plan();
+    check_app(new_img, NEW_SIZE);
+    CHECK_MEM(flash_at(OTA_STAGING_ADDR), old_img, OLD_SIZE);
+    CHECK_EQ(ota_state->swap_pages, 3);
+    CHECK_EQ(ota_state->trial, OTA_FLAG_SET);
+    CHECK_EQ(IWDG->KR, 0xAAAA);
+    CHECK_EQ(IWDG->RLR, BOOT_IWDG_RELOAD);
+    CHECK(total > 3 * 3 * (OTA_PAGE_SIZE / 4));
+
+    for (cut = 1; cut <= total; cut++)
+    {
+        if (!cut_point(cut - 1, total, 1021))
+            continue;
+        load_flash();
+        CHECK_EQ(boot(cut), 0);
+        runs++;
+
+        /* 部分断电点在恢复过程中再断一次 */
+        memcpy(after_cut, sim_flash, SIM_FLASH_SIZE);
+        for (k = 0; k < ((runs % 8) ? 1 : sizeof(seconds) / sizeof(seconds[0])); k++)
+        {
+            memcpy(sim_flash, after_cut, SIM_FLASH_SIZE);
+            if (k > 0 && boot(seconds[k]) == 1)
+                continue;
+            CHECK_EQ(boot(0), 1);
+            check_app(new_img, NEW_SIZE);
+            CHECK_MEM(flash_at(OTA_STAGING_ADDR), old_img, OLD_SIZE);
+            CHECK_EQ(ota_state->trial, OTA_FLAG_SET);
+            CHECK_EQ(IWDG->KR, 0xAAAA);
+        }
+    }
+    CHECK(runs > 4 * 3 * 3);
+    CHECK_EQ(sim_flash_errors, 0);
+}
+
+/* 试运行未确认就复位: 回滚的每一步都可能断电, 最终恢复旧固件 */
+static void test_rollback_power_cut(void)
+{
+    OTA_Status_t st;
+    uint32_t total, cut, runs = 0;
+
+    factory();
+    CHECK_EQ(app_upload(0, 512) > 0, 1);
+    CHECK_EQ(boot(0), 1);
+    save_flash();                       /* 试运行中 */
+
+    CHECK_EQ(boot(0), 1);
+    total = record_plan();
+    check_app(old_img, OLD_SIZE);
+    CHECK_EQ(ota_state->reverted, OTA_FLAG_SET);
+    CHECK_EQ(IWDG->KR, 0);              /* 旧固件不启动看门狗 */
+
+    for (cut = 1; cut <= total; cut++)
+    {
+        if (!cut_point(cut - 1, total, 661))
+            continue;
+        load_flash();
+        CHECK_EQ(boot(cut), 0);
+        CHECK_EQ(boot(0), 1);
+        check_app(old_img, OLD_SIZE);
+        CHECK_EQ(ota_state->reverted, OTA_FLAG_SET);
+        runs++;
+    }
+    CHECK(runs > 4 * 3 * 3);
+
+    /* 应用看到回滚, 之后的启动不再擦写 */
+    sim_flash_power_on(0);
+    app_start();
+    OTA_GetStatus(&st);
+    CHECK_EQ(st.trial, 0);
+    CHECK_EQ(st.reverted, 1);
+    CHECK_EQ(boot(0), 1);
+    CHECK_EQ(sim_flash_ops, 0);
+    CHECK_EQ(sim_flash_errors, 0);
+}
+
+/* 试运行检查: OTA_CONFIRM_S 之后有链路且任务都在报到时确认 */
+static void test_trial_confirm(void)
+{
+    OTA_Status_t st;
+
+    factory();
+    CHECK_EQ(app_upload(0, 512) > 0, 1);
+    CHECK_EQ(boot(0), 1);
+
+    sim_flash_power_on(0);
+    app_start();
+    OTA_GetStatus(&st);
+    CHECK_EQ(st.trial, 1);
+    CHECK_EQ(OTA_Begin(new_hdr, sizeof(new_hdr)), OTA_ERR_STATE);
+
+    stub_tick = OTA_CONFIRM_S * 1000 - 1;
+    OTA_Poll();
+    CHECK_EQ(ota_state->confirmed, OTA_FLAG_CLEAR);
+
+    /* 有任务超时时不确认 */
+    stub_tick = OTA_CONFIRM_S * 1000;
+    tasks_alive = 0;
+    OTA_Poll();
+    CHECK_EQ(ota_state->confirmed, OTA_FLAG_CLEAR);
+    tasks_alive = 1;
+    OTA_Poll();
+    CHECK_EQ(ota_state->confirmed, OTA_FLAG_SET);
+    OTA_GetStatus(&st);
+    CHECK_EQ(st.trial, 0);
+
+    /* 确认后引导程序直接跳转 */
+    CHECK_EQ(boot(0), 1);
+    CHECK_EQ(sim_flash_ops, 0);
+    check_app(new_img, NEW_SIZE);
+    CHECK_EQ(IWDG->KR, 0);
+    CHECK_EQ(sim_flash_errors, 0);
+}
+
+/* OTA_TRIAL_MAX_S 内始终没有链路: 记录后复位, 引导程序回滚 */
+static void test_trial_timeout(void)
+{
+    factory();
+    CHECK_EQ(app_upload(0, 512) > 0, 1);
+    CHECK_EQ(boot(0), 1);
+
+    sim_flash_power_on(0);
+    app_start();
+    eth_state = WIZ_SUP_STATE_LINK_DOWN;
+    for (stub_tick = 0; stub_tick < OTA_TRIAL_MAX_S * 1000 + OTA_RESET_DELAY_MS + 1000 && stub_resets == 0;
+         stub_tick += 500)
+        OTA_Poll();
+    eth_state = WIZ_SUP_STATE_UP;
+    CHECK_EQ(stub_resets, 1);
+    CHECK(stub_tick >= OTA_TRIAL_MAX_S * 1000 + OTA_RESET_DELAY_MS);
+    CHECK_EQ(ota_state->confirmed, OTA_FLAG_CLEAR);
+
+    CHECK_EQ(boot(0), 1);
+    check_app(old_img, OLD_SIZE);
+    CHECK_EQ(ota_state->reverted, OTA_FLAG_SET);
+}
+
+/* 校验通过后暂存区被改写: 引导程序放弃更新, 运行区不动 */
+static void test_staging_corrupted(void)
+{
+    factory();
+    CHECK_EQ(app_upload(0, 512) > 0, 1);
+    sim_flash[OTA_STAGING_ADDR - SIM_FLASH_BASE + 100] ^= 0x10;
+
+    CHECK_EQ(boot(0), 1);
+    check_app(old_img, OLD_SIZE);
+    CHECK(!Boot_HeaderValid(&ota_state->image));
+    CHECK_EQ(IWDG->KR, 0);
+    CHECK_EQ(sim_flash_erases[(OTA_APP_ADDR - SIM_FLASH_BASE) / SIM_FLASH_PAGE], 0);
+}
+
+int main(void)
+{
+    sim_flash_init();
+    make_image(old_img, OLD_SIZE, 1);
+    make_image(new_img, NEW_SIZE, 2);
+    make_header(new_hdr, new_img, NEW_SIZE, 2);
+
+    TEST_RUN(test_staging_power_cut);
+    TEST_RUN(test_resume_rules);
+    TEST_RUN(test_install_power_cut);
+    TEST_RUN(test_rollback_power_cut);
+    TEST_RUN(test_trial_confirm);
+    TEST_RUN(test_trial_timeout);
+    TEST_RUN(test_staging_corrupted);
+    return test_summary("ota");
+}
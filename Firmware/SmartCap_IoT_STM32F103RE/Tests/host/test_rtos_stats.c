@@ -0,0 +1,332 @@
+/**
+  ******************************************************************************
+  * @file    test_rtos_stats.c
+  * @brief   RTOS Statistics: CPU Load Arithmetic, Counter Wrap and Task Matching
+  ******************************************************************************
+  * @description
+  * RtosStats_Update 直接用构造的 TaskStatus_t 快照测试; RtosStats_Poll 通过
+  * uxTaskGetSystemState 的桩取同样的快照。运行时间计数按 72MHz CYCCNT 取值。
+  ******************************************************************************
+  */
+
+#include "test.h"
+#include "../../User/user_main/rtos_stats.c"
+
+volatile uint32_t Metrics_Slots[METRICS_SLOT_COUNT];
+
+#define SNAP_MAX                (RTOS_STATS_TASKS_MAX + 4)
+#define CYCLES_PER_WINDOW       (72000000UL / 1000 * RTOS_STATS_WINDOW_MS)
+
+static TaskStatus_t snap[SNAP_MAX];
+static uint8_t snap_count;
+static uint32_t snap_total;
+static uint32_t snap_calls;
+
+UBaseType_t uxTaskGetSystemState(TaskStatus_t *const status, const UBaseType_t size, uint32_t *const total)
+{
+    UBaseType_t n = (snap_count < size) ? snap_count : size;
+
+    snap_calls++;
+    memcpy(status, snap, n * sizeof(TaskStatus_t));
+    *total = snap_total;
+    return n;
+}
+
+static void reset(void)
+{
+    memset(rtos_tasks, 0, sizeof(rtos_tasks));
+    rtos_task_count = 0;
+    rtos_cpu_load = 0;
+    prev_count = 0;
+    prev_total = 0;
+    prev_valid = 0;
+    rtos_tick = 0;
+    memset((void *)Metrics_Slots, 0, sizeof(Metrics_Slots));
+    memset(snap, 0, sizeof(snap));
+    snap_count = 0;
+    snap_total = 0;
+    snap_calls = 0;
+    stub_tick = 0;
+    stub_events = 0;
+}
+
+static void set_task(uint8_t i, const char *name, UBaseType_t number, uint32_t counter, uint16_t stack)
+{
+    snap[i].pcTaskName = name;
+    snap[i].xTaskNumber = number;
+    snap[i].ulRunTimeCounter = counter;
+    snap[i].usStackHighWaterMark = stack;
+    snap[i].uxCurrentPriority = number;
+    snap[i].eCurrentState = eBlocked;
+    if (i >= snap_count)
+        snap_count = i + 1;
+}
+
+/* 按任务号增加运行时间 */
+static void run(UBaseType_t number, uint32_t cycles)
+{
+    uint8_t i;
+
+    for (i = 0; i < snap_count; i++)
+    {
+        if (snap[i].xTaskNumber == number)
+            snap[i].ulRunTimeCounter += cycles;
+    }
+}
+
+static const RtosStats_Task_t *find(const char *name)
+{
+    uint8_t i;
+
+    for (i = 0; i < rtos_task_count; i++)
+    {
+        if (strcmp(rtos_tasks[i].name, name) == 0)
+            return &rtos_tasks[i];
+    }
+    return NULL;
+}
+
+static void update(void)
+{
+    RtosStats_Update(snap, snap_count, snap_total);
+}
+
+/* 测试 ---------------------------------------------------------------------*/
+
+static void test_first_window(void)
+{
+    reset();
+    set_task(0, "IDLE", 1, 5000, 50);
+    set_task(1, "defaultTask", 2, 7000, 120);
+    snap_total = 12000;
+    update();
+
+    /* 第一次快照没有基准, 占用为 0 */
+    CHECK_EQ(rtos_task_count, 2);
+    CHECK_EQ(find("IDLE")->cpu, 0);
+    CHECK_EQ(find("defaultTask")->cpu, 0);
+    CHECK_EQ(RtosStats_CpuLoad(), 0);
+    CHECK_EQ(Metrics_Slots[METRIC_CPU_LOAD], 0);
+    CHECK_EQ(Metrics_Slots[METRIC_STACK_MIN_FREE], 50);
+    CHECK_EQ(find("defaultTask")->stack_free, 120);
+    CHECK_EQ(find("defaultTask")->priority, 2);
+    CHECK_EQ(find("defaultTask")->state, eBlocked);
+}
+
+static void test_load(void)
+{
+    RtosStats_Task_t copy[RTOS_STATS_TASKS_MAX];
+
+    reset();
+    set_task(0, "IDLE", 1, 0, 100);
+    set_task(1, "rs485Rx", 5, 0, 60);
+    set_task(2, "defaultTask", 2, 0, 80);
+    update();
+
+    run(1, CYCLES_PER_WINDOW / 4 * 3);  // 75%
+    run(5, CYCLES_PER_WINDOW / 5);      // 20%
+    run(2, CYCLES_PER_WINDOW / 20);     // 5%
+    snap_total += CYCLES_PER_WINDOW;
+    update();
+
+    CHECK_EQ(find("IDLE")->cpu, 7500);
+    CHECK_EQ(find("rs485Rx")->cpu, 2000);
+    CHECK_EQ(find("defaultTask")->cpu, 500);
+    CHECK_EQ(RtosStats_CpuLoad(), 250);
+    CHECK_EQ(Metrics_Slots[METRIC_CPU_LOAD], 250);
+
+    /* 0.01% 的分辨率: 1/3 取整 */
+    run(1, CYCLES_PER_WINDOW / 3);
+    run(5, CYCLES_PER_WINDOW - CYCLES_PER_WINDOW / 3);
+    snap_total += CYCLES_PER_WINDOW;
+    update();
+    CHECK_EQ(find("IDLE")->cpu, 3333);
+    CHECK_EQ(find("rs485Rx")->cpu, 6666);
+    CHECK_EQ(find("defaultTask")->cpu, 0);
+    CHECK_EQ(RtosStats_CpuLoad(), 666);
+
+    CHECK_EQ(RtosStats_GetTasks(copy, RTOS_STATS_TASKS_MAX), 3);
+    CHECK_EQ(RtosStats_GetTasks(copy, 2), 2);
+    CHECK_MEM(copy, rtos_tasks, 2 * sizeof(RtosStats_Task_t));
+}
+
+/* 窗口跨过 CYCCNT 回绕 (约 60 秒一次) */
+static void test_counter_wrap(void)
+{
+    reset();
+    set_task(0, "IDLE", 1, 0xFFFFF000UL, 100);
+    set_task(1, "busy", 3, 0xFFFF0000UL, 100);
+    snap_total = 0xFFFFFF00UL;
+    update();
+
+    run(1, CYCLES_PER_WINDOW / 2);
+    run(3, CYCLES_PER_WINDOW / 2);
+    snap_total += CYCLES_PER_WINDOW;
+    CHECK(snap_total < 0x80000000UL);
+    CHECK(snap[0].ulRunTimeCounter < 0x80000000UL);
+    update();
+
+    CHECK_EQ(find("IDLE")->cpu, 5000);
+    CHECK_EQ(find("busy")->cpu, 5000);
+    CHECK_EQ(RtosStats_CpuLoad(), 500);
+}
+
+/* 按任务号对应: 顺序变化、新建、删除 */
+static void test_task_matching(void)
+{
+    reset();
+    set_task(0, "IDLE", 1, 0, 100);
+    set_task(1, "a", 2, 0, 100);
+    set_task(2, "b", 3, 0, 100);
+    update();
+
+    run(1, CYCLES_PER_WINDOW / 2);
+    run(2, CYCLES_PER_WINDOW / 4);
+    run(3, CYCLES_PER_WINDOW / 4);
+    snap_total += CYCLES_PER_WINDOW;
+
+    /* 顺序颠倒, 删除 a, 新建 c (运行时间计数从创建开始, 不等于窗口内的增量) */
+    {
+        TaskStatus_t tmp = snap[0];
+        snap[0] = snap[2];
+        snap[2] = tmp;
+    }
+    set_task(1, "c", 4, CYCLES_PER_WINDOW / 10, 100);
+    update();
+
+    CHECK_EQ(rtos_task_count, 3);
+    CHECK(find("a") == NULL);
+    CHECK_EQ(find("b")->cpu, 2500);
+    CHECK_EQ(find("IDLE")->cpu, 5000);
+    CHECK_EQ(find("c")->cpu, 0);  // 下一个窗口开始统计
+
+    run(4, CYCLES_PER_WINDOW / 10);
+    run(1, CYCLES_PER_WINDOW / 10 * 9);
+    snap_total += CYCLES_PER_WINDOW;
+    update();
+    CHECK_EQ(find("c")->cpu, 1000);
+    CHECK_EQ(RtosStats_CpuLoad(), 100);
+}
+
+/* 快照中的计数与总计数不一致时占用不超过 100% */
+static void test_clamp_and_limits(void)
+{
+    static const char long_name[] = "aVeryLongTaskNameIndeed";
+    char names[SNAP_MAX][8];
+    uint8_t i;
+
+    reset();
+    set_task(0, long_name, 1, 0, 100);
+    update();
+    run(1, 2 * CYCLES_PER_WINDOW);
+    snap_total += CYCLES_PER_WINDOW;
+    update();
+    CHECK_EQ(rtos_tasks[0].cpu, 10000);
+    CHECK_EQ(strlen(rtos_tasks[0].name), configMAX_TASK_NAME_LEN - 1);
+    CHECK_MEM(rtos_tasks[0].name, long_name, configMAX_TASK_NAME_LEN - 1);
+
+    /* 没有空闲任务时不计负载 */
+    CHECK_EQ(RtosStats_CpuLoad(), 0);
+
+    /* 时间没有前进 */
+    update();
+    CHECK_EQ(rtos_tasks[0].cpu, 0);
+
+    /* 超过 RTOS_STATS_TASKS_MAX 的任务不统计, 栈最小值只看统计的任务 */
+    reset();
+    for (i = 0; i < SNAP_MAX; i++)
+    {
+        snprintf(names[i], sizeof(names[i]), "t%u", i);
+        set_task(i, names[i], i + 1, 0, (uint16_t)(200 - i));
+    }
+    update();
+    CHECK_EQ(rtos_task_count, RTOS_STATS_TASKS_MAX);
+    CHECK_EQ(Metrics_Slots[METRIC_STACK_MIN_FREE], 200 - (RTOS_STATS_TASKS_MAX - 1));
+
+    /* 空快照不改变栈仪表 */
+    Metrics_Slots[METRIC_STACK_MIN_FREE] = 77;
+    RtosStats_Update(snap, 0, snap_total);
+    CHECK_EQ(rtos_task_count, 0);
+    CHECK_EQ(Metrics_Slots[METRIC_STACK_MIN_FREE], 77);
+}
+
+static void test_poll_window(void)
+{
+    reset();
+    set_task(0, "IDLE", 1, 0, 100);
+    stub_heap_min_free = 4321;
+
+    RtosStats_Poll();
+    CHECK_EQ(snap_calls, 0);
+    stub_tick = RTOS_STATS_WINDOW_MS - 1;
+    RtosStats_Poll();
+    CHECK_EQ(snap_calls, 0);
+    stub_tick = RTOS_STATS_WINDOW_MS;
+    RtosStats_Poll();
+    CHECK_EQ(snap_calls, 1);
+    CHECK_EQ(Metrics_Slots[METRIC_HEAP_MIN_FREE], 4321);
+
+    run(1, CYCLES_PER_WINDOW / 10 * 9);
+    snap_total += CYCLES_PER_WINDOW;
+    stub_tick += RTOS_STATS_WINDOW_MS + 3;  // 默认任务晚了 3ms
+    RtosStats_Poll();
+    CHECK_EQ(snap_calls, 2);
+    CHECK_EQ(RtosStats_CpuLoad(), 100);
+
+    /* 下一个窗口从实际取快照的时刻算起 */
+    stub_tick += RTOS_STATS_WINDOW_MS - 1;
+    RtosStats_Poll();
+    CHECK_EQ(snap_calls, 2);
+}
+
+static void test_stack_overflow_record(void)
+{
+    reset();
+    memset(BKP, 0, sizeof(*BKP));
+
+    RtosStats_Init();
+    CHECK_EQ(stub_events, 0);
+
+    vApplicationStackOverflowHook(NULL, "rs485Rx");
+    CHECK_EQ(BKP->DR1, RTOS_STATS_BKP_MAGIC);
+    CHECK_EQ(BKP->DR2, 'r' | ('s' << 8));
+    CHECK_EQ(BKP->DR3, '4' | ('8' << 8));
+
+    /* 复位后记录一次并清除标志 */
+    RtosStats_Init();
+    CHECK_EQ(stub_events, 1);
+    CHECK_EQ(BKP->DR1, 0);
+    RtosStats_Init();
+    CHECK_EQ(stub_events, 1);
+
+    /* 短任务名 */
+    vApplicationStackOverflowHook(NULL, "ab");
+    CHECK_EQ(BKP->DR2, 'a' | ('b' << 8));
+    CHECK_EQ(BKP->DR3, 0);
+}
+
+static void test_run_time_counter(void)
+{
+    memset(DWT, 0, sizeof(*DWT));
+    memset(CoreDebug, 0, sizeof(*CoreDebug));
+    DWT->CYCCNT = 1234;
+    configureTimerForRunTimeStats();
+    CHECK(CoreDebug->DEMCR & CoreDebug_DEMCR_TRCENA_Msk);
+    CHECK(DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk);
+    CHECK_EQ(getRunTimeCounterValue(), 0);
+    DWT->CYCCNT = 0xFFFFFFFFUL;
+    CHECK_EQ(getRunTimeCounterValue(), 0xFFFFFFFFUL);
+}
+
+int main(void)
+{
+    TEST_RUN(test_first_window);
+    TEST_RUN(test_load);
+    TEST_RUN(test_counter_wrap);
+    TEST_RUN(test_task_matching);
+    TEST_RUN(test_clamp_and_limits);
+    TEST_RUN(test_poll_window);
+    TEST_RUN(test_stack_overflow_record);
+    TEST_RUN(test_run_time_counter);
+    return test_summary("rtos_stats");
+}
@@ -0,0 +1,1108 @@
+/**
+  ******************************************************************************
+  * @file    test_snmp.c
+  * @brief   SNMP Agent: Generated MIB, GET/GETNEXT Walk, Link Traps, Lookup Cost
+  ******************************************************************************
+  * @description
+  * 真实的 ioLibrary snmp.c、生成的 snmp_mib.c 和 snmp_agent.c 运行在模拟 W5500 上,
+  * 测试充当管理站, 按 BER 编码请求并严格解析应答 (每一层长度必须与内容一致):
+  * - 生成的表: 按 compareOID 严格升序, 与 snmp_mib.h 一致 (mib.def 与生成结果是否一致
+  *   由 Makefile 运行 gen_mib.py --check 检查)
+  * - snmpwalk: 从 1.3 起 GETNEXT 遍历全表, 从每个前缀、每个表项和表项之间的 OID 开始
+  *   的 GETNEXT 与线性查找结果相同, 包括多字节子标识符 (企业号 99999 与 16383 的编码比较)
+  * - GET: 各类型的取值和最短 BER 编码, 多个变量绑定, 不存在的 OID 报告 noSuchName 和位置
+  * - 应答超过 MAX_SNMPMSG_LEN 时报告 tooBig; 超长报文和畸形请求 (截断、逐字节变异)
+  *   不会越界或死循环, 之后的正常请求照常应答
+  * - trap: 启动后的 coldStart, 以太网/蜂窝的 linkUp/linkDown (ifIndex), 队列上限
+  * - 基准: findEntry/findNextEntry 二分查找与线性查找的耗时, 一次 GET/GETNEXT 的解析和编码耗时
+  ******************************************************************************
+  */
+
+#include "test.h"
+#include "wiz_sim.h"
+#include "../../User/ioLibrary_Driver/Ethernet/wizchip_conf.c"
+#include "../../User/ioLibrary_Driver/Ethernet/W5500/w5500.c"
+#include "../../User/ioLibrary_Driver/Ethernet/socket.c"
+#include "../../User/modbus/mb_crc.c"
+#include "../../User/user_main/metrics.c"
+#include "../../User/ioLibrary_Driver/Internet/SNMP/snmp.c"
+#include "../../User/ioLibrary_Driver/Internet/SNMP/snmp_custom.c"
+#include "../../User/snmp/snmp_mib.c"
+#include "../../User/snmp/snmp_agent.c"
+
+/* <unistd.h> 的 close 与 socket.h 冲突 (<signal.h> 也会包含它), 只声明需要的函数 */
+#define SIGALRM                 14
+extern void (*signal(int sig, void (*handler)(int)))(int);
+extern unsigned int alarm(unsigned int seconds);
+extern void _exit(int status);
+
+#define BENCH_ROUNDS            2000000
+#define MSG_MAX                 1500
+#define OUT_MAX                 16
+#define VB_MAX                  48
+
+static const uint8_t manager_ip[4] = {192, 168, 1, 20};
+static const uint8_t trap_ip[4] = SNMP_TRAP_MANAGER_IP;
+#define MANAGER_PORT            40000
+
+static const wiz_NetInfo netinfo = {
+    .mac = {0x00, 0x08, 0xDC, 0x12, 0x34, 0x56},
+    .ip = {192, 168, 1, 50},
+    .sn = {255, 255, 255, 0},
+    .gw = {192, 168, 1, 1},
+    .dns = {192, 168, 1, 1},
+    .dhcp = NETINFO_STATIC,
+};
+
+/* 被测模块依赖的其它模块 ---------------------------------------------------*/
+
+static uint8_t eth_ready, cell_ready;
+static Uplink_Stats_t uplink_stats;
+static MB_Gateway_Stats_t mb_stats;
+static TCP_State_t cell_state;
+static uint64_t uptime_ms;
+static wiz_sup_state_t sup_state;
+
+static uint8_t stub_eth_ready(void) { return eth_ready; }
+static uint8_t stub_cell_ready(void) { return cell_ready; }
+
+const Uplink_Transport_t Uplink_EthTransport = {"eth", stub_eth_ready, NULL, NULL, NULL, NULL, NULL};
+const Uplink_Transport_t Uplink_CellTransport = {"cell", stub_cell_ready, NULL, NULL, NULL, NULL, NULL};
+
+void Uplink_Router_GetStats(Uplink_Stats_t *stats) { *stats = uplink_stats; }
+void MB_Gateway_GetStats(MB_Gateway_Stats_t *stats) { *stats = mb_stats; }
+TCP_State_t RG200U_GetTCPState(void) { return cell_state; }
+uint64_t TimeSync_MonotonicMs(void) { return uptime_ms; }
+wiz_sup_state_t wiz_supervisor_get_state(void) { return sup_state; }
+void wiz_sockbuf_set_role(uint8_t sn, wiz_sock_role_t role) { }
+
+/* 代理发出的报文 -----------------------------------------------------------*/
+
+static struct
+{
+    uint8_t ip[4];
+    uint16_t port;
+    uint16_t len;
+    uint8_t data[MSG_MAX];
+} out[OUT_MAX];
+static uint8_t out_count;
+
+static void wiz_sim_udp_out(uint8_t sn, const uint8_t ip[4], uint16_t port, const uint8_t *data, uint16_t len)
+{
+    if (sn != SNMP_AGENT_SOCK || out_count >= OUT_MAX || len > MSG_MAX)
+        return;
+    memcpy(out[out_count].ip, ip, 4);
+    out[out_count].port = port;
+    out[out_count].len = len;
+    memcpy(out[out_count].data, data, len);
+    out_count++;
+}
+
+/* BER 编码 (管理站一侧, 长度用最短形式) -------------------------------------*/
+
+typedef struct
+{
+    uint8_t len;
+    uint8_t b[24];
+} oid_t;
+
+static oid_t oid_make(const uint32_t *arcs, uint8_t n)
+{
+    oid_t o = {0};
+    uint8_t tmp[5], k, i;
+    uint32_t v;
+
+    for (i = 1; i < n; i++)
+    {
+        v = (i == 1) ? 40 * arcs[0] + arcs[1] : arcs[i];
+        k = 0;
+        do { tmp[k++] = v & 0x7F; v >>= 7; } while (v);
+        while (k--)
+            o.b[o.len++] = tmp[k] | (k ? 0x80 : 0);
+    }
+    return o;
+}
+
+static oid_t oid_entry(int32_t id)
+{
+    oid_t o = {0};
+
+    o.len = snmpData[id].oidlen;
+    memcpy(o.b, snmpData[id].oid, o.len);
+    return o;
+}
+
+/* tag + 长度 + 内容, 返回总长度 */
+static uint16_t ber_put(uint8_t *p, uint8_t tag, const uint8_t *body, uint16_t n)
+{
+    uint16_t h = 0;
+
+    p[h++] = tag;
+    if (n < 0x80)
+        p[h++] = (uint8_t)n;
+    else if (n < 0x100)
+    {
+        p[h++] = 0x81;
+        p[h++] = (uint8_t)n;
+    }
+    else
+    {
+        p[h++] = 0x82;
+        p[h++] = (uint8_t)(n >> 8);
+        p[h++] = (uint8_t)n;
+    }
+    memmove(p + h, body, n);
+    return (uint16_t)(h + n);
+}
+
+/* SNMPv1 请求, 每个 OID 的值为 NULL */
+static uint16_t make_request(uint8_t *msg, uint8_t type, int32_t reqid, const char *community,
+                             const oid_t *oids, uint8_t n)
+{
+    uint8_t a[MSG_MAX], b[MSG_MAX], vb[MSG_MAX];
+    uint16_t la = 0, lb, lv;
+    uint8_t i, id[4] = {(uint8_t)(reqid >> 24), (uint8_t)(reqid >> 16), (uint8_t)(reqid >> 8), (uint8_t)reqid};
+    static const uint8_t zero = 0;
+
+    for (i = 0; i < n; i++)
+    {
+        lv = ber_put(vb, SNMPDTYPE_OBJ_ID, oids[i].b, oids[i].len);
+        lv += ber_put(vb + lv, SNMPDTYPE_NULL_ITEM, NULL, 0);
+        la += ber_put(a + la, SNMPDTYPE_SEQUENCE, vb, lv);
+    }
+    lb = ber_put(b, SNMPDTYPE_INTEGER, id, 4);
+    lb += ber_put(b + lb, SNMPDTYPE_INTEGER, &zero, 1);
+    lb += ber_put(b + lb, SNMPDTYPE_INTEGER, &zero, 1);
+    lb += ber_put(b + lb, SNMPDTYPE_SEQUENCE_OF, a, la);
+    la = ber_put(a, SNMPDTYPE_INTEGER, &zero, 1);
+    la += ber_put(a + la, SNMPDTYPE_OCTET_STRING, (const uint8_t *)community, (uint16_t)strlen(community));
+    la += ber_put(a + la, type, b, lb);
+    return ber_put(msg, SNMPDTYPE_SEQUENCE, a, la);
+}
+
+/* BER 解析 (严格: 长度不能超出外层) ----------------------------------------*/
+
+typedef struct
+{
+    uint8_t tag;
+    uint16_t len;
+    const uint8_t *v;
+} tlv_t;
+
+/* 读取 [*pos, end) 中的一个 TLV, 失败返回 0 */
+static int tlv_get(const uint8_t *buf, uint16_t *pos, uint16_t end, tlv_t *t)
+{
+    uint16_t p = *pos, n;
+    uint8_t k;
+
+    if (p + 2 > end)
+        return 0;
+    t->tag = buf[p++];
+    n = buf[p++];
+    if (n & 0x80)
+    {
+        k = n & 0x7F;
+        if (k == 0 || k > 2 || p + k > end)
+            return 0;
+        n = 0;
+        while (k--)
+            n = (uint16_t)((n << 8) | buf[p++]);
+    }
+    if (p + n > end)
+        return 0;
+    t->len = n;
+    t->v = buf + p;
+    *pos = (uint16_t)(p + n);
+    return 1;
+}
+
+static int32_t int_value(const tlv_t *t)
+{
+    int32_t v = (t->len && (t->v[0] & 0x80)) ? -1 : 0;
+    uint16_t i;
+
+    for (i = 0; i < t->len; i++)
+        v = (int32_t)(((uint32_t)v << 8) | t->v[i]);
+    return v;
+}
+
+typedef struct
+{
+    int32_t reqid;
+    int32_t status;
+    int32_t index;
+    uint8_t n;
+    oid_t oid[VB_MAX];
+    tlv_t val[VB_MAX];
+} response_t;
+
+/* 解析 GetResponse, 每一层的长度都必须正好覆盖内容 */
+static int parse_response(const uint8_t *msg, uint16_t len, response_t *r)
+{
+    uint16_t pos = 0, p, end;
+    tlv_t t, pdu, list, vb, name;
+
+    memset(r, 0, sizeof(*r));
+    if (!tlv_get(msg, &pos, len, &t) || t.tag != SNMPDTYPE_SEQUENCE || pos != len)
+        return 0;
+    pos = (uint16_t)(t.v - msg);
+    if (!tlv_get(msg, &pos, len, &t) || t.tag != SNMPDTYPE_INTEGER || int_value(&t) != SNMP_V1)
+        return 0;
+    if (!tlv_get(msg, &pos, len, &t) || t.tag != SNMPDTYPE_OCTET_STRING ||
+        t.len != 6 || memcmp(t.v, "public", 6) != 0)
+        return 0;
+    if (!tlv_get(msg, &pos, len, &pdu) || pdu.tag != GET_RESPONSE || pos != len)
+        return 0;
+    pos = (uint16_t)(pdu.v - msg);
+    end = (uint16_t)(pos + pdu.len);
+    if (!tlv_get(msg, &pos, end, &t) || t.tag != SNMPDTYPE_INTEGER)
+        return 0;
+    r->reqid = int_value(&t);
+    if (!tlv_get(msg, &pos, end, &t) || t.tag != SNMPDTYPE_INTEGER)
+        return 0;
+    r->status = int_value(&t);
+    if (!tlv_get(msg, &pos, end, &t) || t.tag != SNMPDTYPE_INTEGER)
+        return 0;
+    r->index = int_value(&t);
+    if (!tlv_get(msg, &pos, end, &list) || list.tag != SNMPDTYPE_SEQUENCE_OF || pos != end)
+        return 0;
+    pos = (uint16_t)(list.v - msg);
+    while (pos < end)
+    {
+        if (r->n >= VB_MAX || !tlv_get(msg, &pos, end, &vb) || vb.tag != SNMPDTYPE_SEQUENCE)
+            return 0;
+        p = (uint16_t)(vb.v - msg);
+        if (!tlv_get(msg, &p, pos, &name) || name.tag != SNMPDTYPE_OBJ_ID || name.len > sizeof(r->oid[0].b))
+            return 0;
+        r->oid[r->n].len = (uint8_t)name.len;
+        memcpy(r->oid[r->n].b, name.v, name.len);
+        if (!tlv_get(msg, &p, pos, &r->val[r->n]) || p != pos)
+            return 0;
+        r->n++;
+    }
+    return 1;
+}
+
+/* 仿真 ---------------------------------------------------------------------*/
+
+static void setup(void)
+{
+    wiz_sim_init();
+    wizchip_setnetinfo((wiz_NetInfo *)&netinfo);
+    memset((void *)Metrics_Slots, 0, sizeof(Metrics_Slots));
+    memcpy(trap_manager, trap_ip, 4);
+    trap_head = trap_count = 0;
+    memset(link_up, 0, sizeof(link_up));
+    eth_ready = cell_ready = 0;
+    memset(&uplink_stats, 0, sizeof(uplink_stats));
+    memset(&mb_stats, 0, sizeof(mb_stats));
+    cell_state = TCP_STATE_DISCONNECTED;
+    uptime_ms = 0;
+    sup_state = WIZ_SUP_STATE_UP;
+    out_count = 0;
+
+    SNMP_Agent_Init();
+    SNMP_Agent_Poll();                  /* 打开 socket */
+    CHECK_EQ(wiz_sim_sr(SNMP_AGENT_SOCK), SOCK_UDP);
+}
+
+/* 发送请求并运行一次代理, 返回应答长度 (无应答为 0) */
+static uint16_t exchange(const uint8_t *req, uint16_t len, uint8_t *resp)
+{
+    uint8_t i;
+
+    out_count = 0;
+    CHECK(wiz_sim_udp_in(SNMP_AGENT_SOCK, manager_ip, MANAGER_PORT, req, len));
+    SNMP_Agent_Poll();
+    for (i = 0; i < out_count; i++)
+    {
+        if (memcmp(out[i].ip, manager_ip, 4) == 0 && out[i].port == MANAGER_PORT)
+        {
+            memcpy(resp, out[i].data, out[i].len);
+            return out[i].len;
+        }
+    }
+    return 0;
+}
+
+static int32_t req_id = 0x1000;
+
+/* 一个 PDU 的请求/应答, 应答格式错误或 request-id 不符时返回 0 */
+static int request(uint8_t type, const oid_t *oids, uint8_t n, response_t *r)
+{
+    uint8_t msg[MSG_MAX], resp[MSG_MAX];
+    uint16_t len;
+
+    len = make_request(msg, type, ++req_id, "public", oids, n);
+    len = exchange(msg, len, resp);
+    if (len == 0 || !parse_response(resp, len, r))
+        return 0;
+    return r->reqid == req_id;
+}
+
+static int oid_eq(const oid_t *a, const oid_t *b)
+{
+    return a->len == b->len && memcmp(a->b, b->b, a->len) == 0;
+}
+
+/* GETNEXT 的参考结果: 线性查找第一个大于 oid 的表项 */
+static int32_t ref_next(const oid_t *o)
+{
+    int32_t i;
+
+    for (i = 0; i < maxData; i++)
+    {
+        if (compareOID(snmpData[i].oid, snmpData[i].oidlen, o->b, o->len) > 0)
+            return i;
+    }
+    return OID_NOT_FOUND;
+}
+
+/* 按 OID 查找表项 (测试用名称 -> 序号) */
+static int32_t entry_of(const uint32_t *arcs, uint8_t n)
+{
+    oid_t o = oid_make(arcs, n);
+
+    return findEntry(o.b, o.len);
+}
+
+static uint32_t uint_value(const tlv_t *t)
+{
+    uint32_t v = 0;
+    uint16_t i;
+
+    for (i = 0; i < t->len; i++)
+        v = (v << 8) | t->v[i];
+    return v;
+}
+
+/* 整数类型的最短 BER 编码: 内容不能以 9 个相同的位开头 */
+static int ber_int_minimal(const tlv_t *t)
+{
+    if (t->len == 0 || t->len > 5)
+        return 0;
+    if (t->len == 1)
+        return 1;
+    if (t->v[0] == 0x00 && !(t->v[1] & 0x80))
+        return 0;
+    if (t->v[0] == 0xFF && (t->v[1] & 0x80))
+        return 0;
+    return 1;
+}
+
+/* 测试 ---------------------------------------------------------------------*/
+
+/* 生成的表按 OID 严格升序, 与头文件一致 */
+static void test_table(void)
+{
+    static const uint8_t sys_object_id[] = {SNMP_MIB_SYSOBJECTID};
+    static const uint32_t sys_object_id_oid[] = {1, 3, 6, 1, 2, 1, 1, 2, 0};
+    int32_t i, id;
+
+    CHECK_EQ(maxData, SNMP_MIB_COUNT);
+    for (i = 0; i < maxData; i++)
+    {
+        CHECK(snmpData[i].oidlen > 0 && snmpData[i].oidlen <= MAX_OID);
+        CHECK(snmpData[i].setfunction == NULL);
+        if (i > 0)
+            CHECK(compareOID(snmpData[i - 1].oid, snmpData[i - 1].oidlen, snmpData[i].oid, snmpData[i].oidlen) < 0);
+        if (snmpData[i].dataType == SNMPDTYPE_OCTET_STRING && snmpData[i].getfunction == NULL)
+            CHECK_EQ(snmpData[i].dataLen, strlen((const char *)snmpData[i].u.octetstring));
+    }
+
+    id = entry_of(sys_object_id_oid, 9);
+    CHECK(id >= 0);
+    CHECK_EQ(snmpData[id].dataType, SNMPDTYPE_OBJ_ID);
+    CHECK_EQ(snmpData[id].dataLen, SNMP_MIB_SYSOBJECTID_LEN);
+    CHECK_MEM(snmpData[id].u.octetstring, sys_object_id, SNMP_MIB_SYSOBJECTID_LEN);
+
+    /* 多字节子标识符按数值比较: 16383 (ff 7f) < 99999 (86 8d 1f), 字节比较结果相反 */
+    {
+        static const uint32_t a[] = {1, 3, 6, 1, 4, 1, 16383};
+        static const uint32_t b[] = {1, 3, 6, 1, 4, 1, 99999};
+        static const uint32_t c[] = {1, 3, 6, 1, 4, 1, 99999, 2};
+        oid_t oa = oid_make(a, 7), ob = oid_make(b, 7), oc = oid_make(c, 8);
+
+        CHECK(memcmp(oa.b, ob.b, oa.len) > 0);
+        CHECK(compareOID(oa.b, oa.len, ob.b, ob.len) < 0);
+        CHECK(compareOID(ob.b, ob.len, oa.b, oa.len) > 0);
+        CHECK(compareOID(ob.b, ob.len, oc.b, oc.len) < 0);
+        CHECK(compareOID(oc.b, oc.len, oc.b, oc.len) == 0);
+    }
+}
+
+/* snmpwalk: 从 1.3 开始 GETNEXT 直到 MIB 末尾 */
+static void test_walk(void)
+{
+    static const uint32_t start[] = {1, 3};
+    response_t r;
+    oid_t o = oid_make(start, 2);
+    int32_t n = 0;
+
+    setup();
+    for (;;)
+    {
+        if (!request(GET_NEXT_REQUEST, &o, 1, &r))
+        {
+            CHECK(0);
+            return;
+        }
+        CHECK_EQ(r.n, 1);
+        if (r.status != 0)
+            break;
+        CHECK(n < maxData);
+        if (n >= maxData)
+            return;
+        o = oid_entry(n);
+        CHECK(oid_eq(&r.oid[0], &o));
+        CHECK_EQ(r.val[0].tag, snmpData[n].dataType);
+        n++;
+    }
+    CHECK_EQ(n, maxData);
+
+    /* MIB 末尾: noSuchName, 变量绑定原样返回 */
+    CHECK_EQ(r.status, NO_SUCH_NAME);
+    CHECK_EQ(r.index, 1);
+    o = oid_entry(maxData - 1);
+    CHECK(oid_eq(&r.oid[0], &o));
+    CHECK_EQ(r.val[0].tag, SNMPDTYPE_NULL_ITEM);
+}
+
+/* 从任意 OID 开始的 GETNEXT 与线性查找相同 */
+static void test_getnext_anywhere(void)
+{
+    static const uint32_t extra[][12] = {
+        {1, 3, 6, 1, 4, 1, 16383},                  /* 编码的字节序大于 99999 */
+        {1, 3, 6, 1, 4, 1, 99998, 5},
+        {1, 3, 6, 1, 4, 1, 99999, 2, 7},            /* scObjects 之后 */
+        {1, 3, 6, 1, 4, 1, 100000},
+        {1, 3, 6, 1, 2, 1, 1, 4},                   /* sysContact 不在表中 */
+        {1, 3, 6, 1, 2, 1, 2, 2, 1, 1, 3},          /* ifIndex.3 */
+        {1, 3, 6, 1, 2, 1, 2, 2, 1, 9},
+        {0, 0},
+        {2, 999},
+    };
+    static const uint8_t extra_n[] = {7, 8, 9, 7, 8, 11, 10, 2, 2};
+    response_t r;
+    oid_t o, want;
+    int32_t i, next;
+    uint8_t k, cut;
+
+    setup();
+    for (i = 0; i < maxData; i++)
+    {
+        /* 每个子标识符边界的前缀, 表项本身, 以及表项之下 (.0) */
+        for (cut = 1; cut <= snmpData[i].oidlen + 1; cut++)
+        {
+            o = oid_entry(i);
+            if (cut > o.len)
+                o.b[o.len++] = 0;
+            else if (o.b[cut - 1] & 0x80)
+                continue;
+            else
+                o.len = cut;
+
+            next = ref_next(&o);
+            CHECK(request(GET_NEXT_REQUEST, &o, 1, &r));
+            if (next == OID_NOT_FOUND)
+            {
+                CHECK_EQ(r.status, NO_SUCH_NAME);
+                continue;
+            }
+            want = oid_entry(next);
+            CHECK_EQ(r.status, 0);
+            CHECK(oid_eq(&r.oid[0], &want));
+            CHECK_EQ(findNextEntry(o.b, o.len), next);
+        }
+    }
+
+    for (k = 0; k < sizeof(extra_n); k++)
+    {
+        o = oid_make(extra[k], extra_n[k]);
+        next = ref_next(&o);
+        CHECK_EQ(findNextEntry(o.b, o.len), next);
+        CHECK_EQ(findEntry(o.b, o.len), OID_NOT_FOUND);
+        CHECK(request(GET_NEXT_REQUEST, &o, 1, &r));
+        if (next == OID_NOT_FOUND)
+            CHECK_EQ(r.status, NO_SUCH_NAME);
+        else
+        {
+            want = oid_entry(next);
+            CHECK(oid_eq(&r.oid[0], &want));
+        }
+    }
+
+    /* 16383 在 99999 之前: 下一个是 smartcap 的第一个对象 */
+    o = oid_make(extra[0], extra_n[0]);
+    next = ref_next(&o);
+    CHECK(next >= 0 && snmpData[next].oid[5] == 0x86);
+}
+
+/* GET: 各类型的取值和编码 */
+static void test_get_values(void)
+{
+    static const uint32_t sys_descr[] = {1, 3, 6, 1, 2, 1, 1, 1, 0};
+    static const uint32_t sys_uptime[] = {1, 3, 6, 1, 2, 1, 1, 3, 0};
+    static const uint32_t if_oper_1[] = {1, 3, 6, 1, 2, 1, 2, 2, 1, 8, 1};
+    static const uint32_t if_oper_2[] = {1, 3, 6, 1, 2, 1, 2, 2, 1, 8, 2};
+    static const uint32_t rx_bytes[] = {1, 3, 6, 1, 4, 1, 99999, 2, 1, 1, 0};
+    static const uint32_t tx_bytes[] = {1, 3, 6, 1, 4, 1, 99999, 2, 1, 2, 0};
+    static const uint32_t csq[] = {1, 3, 6, 1, 4, 1, 99999, 2, 2, 1, 0};
+    static const uint32_t rssi[] = {1, 3, 6, 1, 4, 1, 99999, 2, 2, 2, 0};
+    static const uint32_t tcp_state[] = {1, 3, 6, 1, 4, 1, 99999, 2, 2, 3, 0};
+    static const uint32_t failovers[] = {1, 3, 6, 1, 4, 1, 99999, 2, 3, 5, 0};
+    static const uint32_t upq_depth[] = {1, 3, 6, 1, 4, 1, 99999, 2, 4, 1, 0};
+    static const uint32_t mb_timeouts[] = {1, 3, 6, 1, 4, 1, 99999, 2, 5, 2, 0};
+    static const uint32_t missing[] = {1, 3, 6, 1, 4, 1, 99999, 2, 9, 9, 0};
+    oid_t o[3];
+    response_t r;
+    int32_t i;
+
+    setup();
+    Metrics_Set(METRIC_RS485_RX_BYTES, 0x80000000UL);      /* 最高位为 1: 前导 0x00 */
+    Metrics_Set(METRIC_RS485_TX_BYTES, 127);
+    Metrics_Set(METRIC_MODEM_CSQ, 31);                     /* -51 dBm */
+    Metrics_Set(METRIC_UPQ_DEPTH, 0);
+    uplink_stats.failovers = 65535;
+    mb_stats.timeouts = 0x00FFFFFFUL;
+    cell_state = TCP_STATE_CONNECTED;
+    uptime_ms = 1234567;
+    eth_ready = 1;
+    SNMP_Agent_Poll();                  /* 记录链路状态 */
+
+    o[0] = oid_make(sys_descr, 9);
+    CHECK(request(GET_REQUEST, o, 1, &r));
+    CHECK_EQ(r.status, 0);
+    CHECK_EQ(r.val[0].tag, SNMPDTYPE_OCTET_STRING);
+    CHECK_EQ(r.val[0].len, strlen("SmartCap RS485 IoT Gateway"));
+    CHECK_MEM(r.val[0].v, "SmartCap RS485 IoT Gateway", r.val[0].len);
+
+    {
+        static const struct {
+            const uint32_t *arcs;
+            uint8_t n;
+            uint8_t type;
+            int64_t value;
+        } cases[] = {
+            {sys_uptime, 9, SNMPDTYPE_TIME_TICKS, 123456},
+            {if_oper_1, 11, SNMPDTYPE_INTEGER, 1},
+            {if_oper_2, 11, SNMPDTYPE_INTEGER, 2},
+            {rx_bytes, 11, SNMPDTYPE_COUNTER, 0x80000000LL},
+            {tx_bytes, 11, SNMPDTYPE_COUNTER, 127},
+            {csq, 11, SNMPDTYPE_INTEGER, 31},
+            {rssi, 11, SNMPDTYPE_INTEGER, -51},
+            {tcp_state, 11, SNMPDTYPE_INTEGER, TCP_STATE_CONNECTED},
+            {failovers, 11, SNMPDTYPE_COUNTER, 65535},
+            {upq_depth, 11, SNMPDTYPE_GAUGE, 0},
+            {mb_timeouts, 11, SNMPDTYPE_COUNTER, 0x00FFFFFF},
+        };
+
+        for (i = 0; i < (int32_t)(sizeof(cases) / sizeof(cases[0])); i++)
+        {
+            o[0] = oid_make(cases[i].arcs, cases[i].n);
+            CHECK(request(GET_REQUEST, o, 1, &r));
+            CHECK_EQ(r.status, 0);
+            CHECK(oid_eq(&r.oid[0], &o[0]));
+            CHECK_EQ(r.val[0].tag, cases[i].type);
+            CHECK(ber_int_minimal(&r.val[0]));
+            if (cases[i].type == SNMPDTYPE_INTEGER)
+                CHECK_EQ(int_value(&r.val[0]), cases[i].value);
+            else
+            {
+                CHECK(!(r.val[0].v[0] & 0x80));             /* 无符号类型不能显示为负数 */
+                CHECK_EQ(uint_value(&r.val[0]), cases[i].value);
+            }
+        }
+    }
+    o[0] = oid_make(rx_bytes, 11);
+    CHECK(request(GET_REQUEST, o, 1, &r));
+    CHECK_EQ(r.val[0].len, 5);
+
+    /* 每个表项都能 GET, 类型与表一致 */
+    for (i = 0; i < maxData; i++)
+    {
+        o[0] = oid_entry(i);
+        CHECK(request(GET_REQUEST, o, 1, &r));
+        CHECK_EQ(r.status, 0);
+        CHECK_EQ(r.val[0].tag, snmpData[i].dataType);
+    }
+
+    /* 不存在的 OID: noSuchName, error-index 指向第 2 个变量绑定 */
+    o[0] = oid_make(sys_descr, 9);
+    o[1] = oid_make(missing, 11);
+    o[2] = oid_make(rx_bytes, 11);
+    CHECK(request(GET_REQUEST, o, 3, &r));
+    CHECK_EQ(r.status, NO_SUCH_NAME);
+    CHECK_EQ(r.index, 2);
+    CHECK_EQ(r.n, 3);
+
+    /* 前缀不是表项 */
+    o[0] = oid_make(sys_descr, 8);
+    CHECK(request(GET_REQUEST, o, 1, &r));
+    CHECK_EQ(r.status, NO_SUCH_NAME);
+
+    /* 只读: SET 报告 noSuchName */
+    {
+        uint8_t msg[MSG_MAX], resp[MSG_MAX];
+        uint16_t len;
+
+        o[0] = oid_make(sys_descr, 9);
+        len = make_request(msg, SET_REQUEST, ++req_id, "public", o, 1);
+        len = exchange(msg, len, resp);
+        CHECK(len > 0 && parse_response(resp, len, &r));
+        CHECK_EQ(r.status, NO_SUCH_NAME);
+        CHECK_EQ(r.index, 1);
+    }
+
+    /* 团体名错误: 不应答 */
+    {
+        uint8_t msg[MSG_MAX], resp[MSG_MAX];
+        uint16_t len;
+
+        len = make_request(msg, GET_REQUEST, ++req_id, "privat", o, 1);
+        CHECK_EQ(exchange(msg, len, resp), 0);
+    }
+}
+
+/* 多个变量绑定: 应答比请求长, 长度字段的形式要随之改变; 放不下时 tooBig */
+static void test_varbinds(void)
+{
+    static const uint32_t strings[][11] = {
+        {1, 3, 6, 1, 2, 1, 1, 1, 0},
+        {1, 3, 6, 1, 2, 1, 1, 2, 0},
+        {1, 3, 6, 1, 2, 1, 1, 5, 0},
+        {1, 3, 6, 1, 2, 1, 2, 2, 1, 2, 1},
+        {1, 3, 6, 1, 2, 1, 2, 2, 1, 2, 2},
+    };
+    static const uint8_t strings_n[] = {9, 9, 9, 11, 11};
+    uint8_t msg[MSG_MAX], resp[MSG_MAX];
+    oid_t o[VB_MAX];
+    response_t r;
+    uint16_t len;
+    int32_t i, n;
+
+    setup();
+
+    /* 请求 < 128 字节 (长度为短形式), 应答 > 128 字节 */
+    for (i = 0; i < 5; i++)
+        o[i] = oid_make(strings[i], strings_n[i]);
+    len = make_request(msg, GET_REQUEST, ++req_id, "public", o, 5);
+    CHECK(len < 128);
+    len = exchange(msg, len, resp);
+    CHECK(len > 128);
+    CHECK(parse_response(resp, len, &r));
+    CHECK_EQ(r.reqid, req_id);
+    CHECK_EQ(r.status, 0);
+    CHECK_EQ(r.n, 5);
+    for (i = 0; i < r.n && i < 5; i++)
+        CHECK(oid_eq(&r.oid[i], &o[i]));
+
+    /* 全表一次 GET (请求和应答都是长形式) */
+    for (n = 0; n < 20; n++)
+        o[n] = oid_entry(n);
+    CHECK(request(GET_REQUEST, o, 20, &r));
+    CHECK_EQ(r.status, 0);
+    CHECK_EQ(r.n, 20);
+    for (i = 0; i < r.n && i < 20; i++)
+    {
+        CHECK(oid_eq(&r.oid[i], &o[i]));
+        CHECK_EQ(r.val[i].tag, snmpData[i].dataType);
+    }
+
+    /* 应答超过 MAX_SNMPMSG_LEN: tooBig, 变量绑定原样返回 */
+    for (n = 0; n < VB_MAX; n++)
+        o[n] = oid_make(strings[0], strings_n[0]);
+    n = 0;
+    while (n < VB_MAX && make_request(msg, GET_REQUEST, 0, "public", o, (uint8_t)(n + 1)) <= MAX_SNMPMSG_LEN)
+        n++;
+    len = make_request(msg, GET_REQUEST, ++req_id, "public", o, (uint8_t)n);
+    len = exchange(msg, len, resp);
+    CHECK(len > 0 && len <= MAX_SNMPMSG_LEN);
+    CHECK(parse_response(resp, len, &r));
+    CHECK_EQ(r.status, 1);              /* tooBig */
+    CHECK_EQ(r.index, 0);
+    CHECK_EQ(r.n, n);
+    CHECK_EQ(r.val[0].tag, SNMPDTYPE_NULL_ITEM);
+    CHECK(response_msg.index <= MAX_SNMPMSG_LEN);
+
+    /* 之后的请求正常 */
+    CHECK(request(GET_REQUEST, o, 1, &r));
+    CHECK_EQ(r.status, 0);
+}
+
+/* 超长报文丢弃, 不写出 request_msg, 之后的请求正常 */
+static void test_oversize(void)
+{
+    static const uint32_t sys_name[] = {1, 3, 6, 1, 2, 1, 1, 5, 0};
+    uint8_t msg[MSG_MAX], resp[MSG_MAX];
+    oid_t o[VB_MAX];
+    response_t r;
+    uint16_t len;
+    uint8_t n;
+
+    setup();
+    for (n = 0; n < VB_MAX; n++)
+        o[n] = oid_make(sys_name, 9);
+    len = make_request(msg, GET_REQUEST, ++req_id, "public", o, VB_MAX);
+    CHECK(len > MAX_SNMPMSG_LEN);
+    CHECK_EQ(exchange(msg, len, resp), 0);
+    CHECK(request_msg.len <= MAX_SNMPMSG_LEN);
+    CHECK_EQ(getSn_RX_RSR(SNMP_AGENT_SOCK), 0);
+
+    CHECK(request(GET_REQUEST, o, 1, &r));
+    CHECK_EQ(r.status, 0);
+    CHECK_MEM(r.val[0].v, "smartcap", 8);
+}
+
+static void on_alarm(int sig)
+{
+    (void)sig;
+    printf("  FAIL %s: agent did not return (parser loop)\n", test_current);
+    _exit(1);
+}
+
+/* 畸形请求: 不越界、不死循环, 应答 (如果有) 格式正确 */
+static void test_malformed(void)
+{
+    static const uint32_t sys_descr[] = {1, 3, 6, 1, 2, 1, 1, 1, 0};
+    static const uint32_t rx_bytes[] = {1, 3, 6, 1, 4, 1, 99999, 2, 1, 1, 0};
+    uint8_t msg[MSG_MAX], bad[MSG_MAX], resp[MSG_MAX];
+    oid_t o[2];
+    response_t r;
+    uint16_t len, cut, i, n;
+    uint32_t answered = 0, rounds = 0;
+    uint32_t seed = 12345;
+    uint8_t bit;
+
+    setup();
+    signal(SIGALRM, on_alarm);
+    o[0] = oid_make(sys_descr, 9);
+    o[1] = oid_make(rx_bytes, 11);
+    len = make_request(msg, GET_REQUEST, ++req_id, "public", o, 2);
+
+    /* 所有截断长度 */
+    for (cut = 1; cut < len; cut++)
+    {
+        alarm(2);
+        n = exchange(msg, cut, resp);
+        alarm(0);
+        if (n)
+        {
+            answered++;
+            CHECK(n <= MAX_SNMPMSG_LEN);
+        }
+        rounds++;
+    }
+
+    /* 每个字节的每一位, 以及随机的多字节变异 */
+    for (i = 0; i < len; i++)
+    {
+        for (bit = 0; bit < 8; bit++)
+        {
+            memcpy(bad, msg, len);
+            bad[i] ^= (uint8_t)(1 << bit);
+            alarm(2);
+            n = exchange(bad, len, resp);
+            alarm(0);
+            if (n)
+            {
+                answered++;
+                CHECK(n <= MAX_SNMPMSG_LEN);
+            }
+            rounds++;
+        }
+    }
+    for (i = 0; i < 20000; i++)
+    {
+        memcpy(bad, msg, len);
+        for (n = 0; n < 4; n++)
+        {
+            seed = seed * 1103515245u + 12345u;
+            bad[(seed >> 8) % len] = (uint8_t)(seed >> 24);
+        }
+        alarm(2);
+        n = exchange(bad, len, resp);
+        alarm(0);
+        if (n)
+        {
+            answered++;
+            CHECK(n <= MAX_SNMPMSG_LEN);
+        }
+        rounds++;
+    }
+
+    /* 构造的报文: 变量绑定列表中不是 SEQUENCE, 长度超出报文 */
+    {
+        static const uint8_t not_seq[] = {
+            0x30, 0x1A, 0x02, 0x01, 0x00, 0x04, 0x06, 'p', 'u', 'b', 'l', 'i', 'c',
+            0xA0, 0x0D, 0x02, 0x01, 0x01, 0x02, 0x01, 0x00, 0x02, 0x01, 0x00,
+            0x30, 0x02, 0x05, 0x00,
+        };
+        static const uint8_t long_len[] = {
+            0x30, 0x1A, 0x02, 0x01, 0x00, 0x04, 0x06, 'p', 'u', 'b', 'l', 'i', 'c',
+            0xA0, 0x0D, 0x02, 0x82, 0x7F, 0xFF, 0x01, 0x02, 0x01, 0x00, 0x02, 0x01, 0x00,
+            0x30, 0x00,
+        };
+        static const uint8_t long_oid[] = {
+            0x30, 0x24, 0x02, 0x01, 0x00, 0x04, 0x06, 'p', 'u', 'b', 'l', 'i', 'c',
+            0xA0, 0x17, 0x02, 0x01, 0x01, 0x02, 0x01, 0x00, 0x02, 0x01, 0x00,
+            0x30, 0x0C, 0x30, 0x0A, 0x06, 0x84, 0x7F, 0xFF, 0xFF, 0xFF, 0x2B, 0x06, 0x05, 0x00,
+        };
+
+        alarm(2);
+        exchange(not_seq, sizeof(not_seq), resp);
+        exchange(long_len, sizeof(long_len), resp);
+        exchange(long_oid, sizeof(long_oid), resp);
+        alarm(0);
+        CHECK(response_msg.index <= MAX_SNMPMSG_LEN);
+    }
+
+    /* 之后的正常请求照常应答 */
+    CHECK(request(GET_REQUEST, o, 2, &r));
+    CHECK_EQ(r.status, 0);
+    CHECK_EQ(r.n, 2);
+    printf("  %lu malformed requests, %lu answered\n", (unsigned long)rounds, (unsigned long)answered);
+}
+
+/* 解析 trap 报文, 返回 generic, 格式错误返回 -1 */
+static int parse_trap(const uint8_t *msg, uint16_t len, uint8_t *if_index)
+{
+    static const uint8_t enterprise[] = {SNMP_MIB_SYSOBJECTID};
+    static const uint8_t if_index_oid[] = {0x2b, 0x06, 0x01, 0x02, 0x01, 0x02, 0x02, 0x01, 0x01};
+    uint16_t pos = 0, end, p, q;
+    tlv_t t, pdu, vb;
+    int generic;
+
+    *if_index = 0;
+    if (!tlv_get(msg, &pos, len, &t) || t.tag != SNMPDTYPE_SEQUENCE || pos != len)
+        return -1;
+    pos = (uint16_t)(t.v - msg);
+    if (!tlv_get(msg, &pos, len, &t) || t.tag != SNMPDTYPE_INTEGER || int_value(&t) != SNMP_V1)
+        return -1;
+    if (!tlv_get(msg, &pos, len, &t) || t.tag != SNMPDTYPE_OCTET_STRING || t.len != 6)
+        return -1;
+    if (!tlv_get(msg, &pos, len, &pdu) || pdu.tag != 0xA4 || pos != len)
+        return -1;
+    pos = (uint16_t)(pdu.v - msg);
+    end = (uint16_t)(pos + pdu.len);
+    if (!tlv_get(msg, &pos, end, &t) || t.tag != SNMPDTYPE_OBJ_ID ||
+        t.len != sizeof(enterprise) || memcmp(t.v, enterprise, t.len) != 0)
+        return -1;
+    if (!tlv_get(msg, &pos, end, &t) || t.tag != 0x40 || t.len != 4 || memcmp(t.v, netinfo.ip, 4) != 0)
+        return -1;
+    if (!tlv_get(msg, &pos, end, &t) || t.tag != SNMPDTYPE_INTEGER)
+        return -1;
+    generic = int_value(&t);
+    if (!tlv_get(msg, &pos, end, &t) || t.tag != SNMPDTYPE_INTEGER || int_value(&t) != 0)
+        return -1;
+    if (!tlv_get(msg, &pos, end, &t) || t.tag != SNMPDTYPE_TIME_TICKS)
+        return -1;
+    if (!tlv_get(msg, &pos, end, &t) || t.tag != SNMPDTYPE_SEQUENCE_OF || pos != end)
+        return -1;
+    p = (uint16_t)(t.v - msg);
+    if (p == end)
+        return generic;
+    if (!tlv_get(msg, &p, end, &vb) || vb.tag != SNMPDTYPE_SEQUENCE || p != end)
+        return -1;
+    q = (uint16_t)(vb.v - msg);
+    if (!tlv_get(msg, &q, end, &t) || t.tag != SNMPDTYPE_OBJ_ID || t.len != sizeof(if_index_oid) + 1 ||
+        memcmp(t.v, if_index_oid, sizeof(if_index_oid)) != 0)
+        return -1;
+    *if_index = t.v[t.len - 1];
+    if (!tlv_get(msg, &q, end, &t) || t.tag != SNMPDTYPE_INTEGER || q != end || int_value(&t) != *if_index)
+        return -1;
+    return generic;
+}
+
+/* 轮询一次, 返回发出的 trap 数 (trap[] 中为 generic << 8 | ifIndex) */
+static uint8_t poll_traps(uint16_t *trap, uint8_t max)
+{
+    uint8_t i, n = 0, if_index;
+    int generic;
+
+    out_count = 0;
+    SNMP_Agent_Poll();
+    for (i = 0; i < out_count; i++)
+    {
+        CHECK_MEM(out[i].ip, trap_ip, 4);
+        CHECK_EQ(out[i].port, PORT_SNMP_TRAP);
+        generic = parse_trap(out[i].data, out[i].len, &if_index);
+        CHECK(generic >= 0);
+        if (n < max)
+            trap[n++] = (uint16_t)((generic << 8) | if_index);
+    }
+    return n;
+}
+
+static void test_traps(void)
+{
+    uint16_t trap[8];
+    uint8_t i, n;
+
+    /* W5500 未就绪时 coldStart 在队列中等待 */
+    wiz_sim_init();
+    wizchip_setnetinfo((wiz_NetInfo *)&netinfo);
+    memcpy(trap_manager, trap_ip, 4);
+    trap_head = trap_count = 0;
+    memset(link_up, 0, sizeof(link_up));
+    eth_ready = cell_ready = 0;
+    sup_state = WIZ_SUP_STATE_ADDR_WAIT;
+    SNMP_Agent_Init();
+    CHECK_EQ(poll_traps(trap, 8), 0);
+    CHECK_EQ(trap_count, 1);
+
+    sup_state = WIZ_SUP_STATE_UP;
+    n = poll_traps(trap, 8);            /* 打开 socket, 发出 coldStart */
+    CHECK_EQ(n, 1);
+    CHECK_EQ(trap[0], SNMPTRAP_COLDSTART << 8);
+    CHECK_EQ(trap_count, 0);
+
+    /* 以太网上行连接: linkUp ifIndex 1 */
+    eth_ready = 1;
+    n = poll_traps(trap, 8);
+    CHECK_EQ(n, 1);
+    CHECK_EQ(trap[0], (SNMPTRAP_LINKUP << 8) | SNMP_IF_ETH);
+    CHECK_EQ(poll_traps(trap, 8), 0);   /* 状态不变不再发送 */
+
+    /* 以太网断开, 蜂窝接管 */
+    eth_ready = 0;
+    cell_ready = 1;
+    n = poll_traps(trap, 8);
+    CHECK_EQ(n, 1);
+    CHECK_EQ(trap[0], (SNMPTRAP_LINKDOWN << 8) | SNMP_IF_ETH);
+    n = poll_traps(trap, 8);
+    CHECK_EQ(n, 1);
+    CHECK_EQ(trap[0], (SNMPTRAP_LINKUP << 8) | SNMP_IF_CELL);
+
+    /* W5500 恢复期间的变化排队, 超出 SNMP_TRAP_QUEUE_MAX 的丢弃, 恢复后按顺序发送 */
+    sup_state = WIZ_SUP_STATE_CHIP_LOST;
+    for (i = 0; i < SNMP_TRAP_QUEUE_MAX + 2; i++)
+    {
+        eth_ready = !eth_ready;
+        SNMP_Agent_Poll();
+    }
+    CHECK_EQ(trap_count, SNMP_TRAP_QUEUE_MAX);
+    sup_state = WIZ_SUP_STATE_UP;
+    for (i = 0; i < SNMP_TRAP_QUEUE_MAX; i++)
+    {
+        n = poll_traps(trap, 8);
+        CHECK_EQ(n, 1);
+        CHECK_EQ(trap[0], (((i & 1) ? SNMPTRAP_LINKDOWN : SNMPTRAP_LINKUP) << 8) | SNMP_IF_ETH);
+    }
+    CHECK_EQ(poll_traps(trap, 8), 0);
+
+    /* 未配置接收端: 不发送 */
+    memset(trap_manager, 0, 4);
+    cell_ready = 0;
+    CHECK_EQ(poll_traps(trap, 8), 0);
+    CHECK_EQ(trap_count, 0);
+}
+
+/* 基准 ---------------------------------------------------------------------*/
+
+/* 原来的线性查找 (逐项 memcmp, 只能精确匹配) */
+static int32_t linear_find(const uint8_t *oid, int32_t len)
+{
+    int32_t i;
+
+    for (i = 0; i < maxData; i++)
+    {
+        if (snmpData[i].oidlen == len && memcmp(snmpData[i].oid, oid, len) == 0)
+            return i;
+    }
+    return OID_NOT_FOUND;
+}
+
+static void test_bench(void)
+{
+    static const uint32_t sys_descr[] = {1, 3, 6, 1, 2, 1, 1, 1, 0};
+    static const uint32_t heap_free[] = {1, 3, 6, 1, 4, 1, 99999, 2, 6, 1, 0};
+    volatile int32_t sink = 0;
+    unsigned long long t0, t1;
+    uint8_t msg[MSG_MAX];
+    uint16_t len;
+    oid_t o;
+    int32_t i, id;
+
+    setup();
+
+    t0 = test_now_ns();
+    for (i = 0; i < BENCH_ROUNDS; i++)
+    {
+        id = i % maxData;
+        sink += findEntry(snmpData[id].oid, snmpData[id].oidlen);
+    }
+    t1 = test_now_ns();
+    printf("  findEntry %.1f ns,", (double)(t1 - t0) / BENCH_ROUNDS);
+
+    t0 = test_now_ns();
+    for (i = 0; i < BENCH_ROUNDS; i++)
+    {
+        id = i % maxData;
+        sink += linear_find(snmpData[id].oid, snmpData[id].oidlen);
+    }
+    t1 = test_now_ns();
+    printf(" linear %.1f ns,", (double)(t1 - t0) / BENCH_ROUNDS);
+
+    t0 = test_now_ns();
+    for (i = 0; i < BENCH_ROUNDS; i++)
+    {
+        id = i % maxData;
+        sink += findNextEntry(snmpData[id].oid, snmpData[id].oidlen);
+    }
+    t1 = test_now_ns();
+    printf(" findNextEntry %.1f ns,", (double)(t1 - t0) / BENCH_ROUNDS);
+
+    t0 = test_now_ns();
+    for (i = 0; i < BENCH_ROUNDS; i++)
+    {
+        o = oid_entry(i % maxData);
+        sink += ref_next(&o);
+    }
+    t1 = test_now_ns();
+    printf(" linear %.1f ns (%ld entries)\n", (double)(t1 - t0) / BENCH_ROUNDS, (long)maxData);
+
+    /* 一次 GET 的解析和应答编码 (不含 socket) */
+    o = oid_make(sys_descr, 9);
+    len = make_request(msg, GET_REQUEST, 1, "public", &o, 1);
+    t0 = test_now_ns();
+    for (i = 0; i < BENCH_ROUNDS / 10; i++)
+    {
+        memcpy(request_msg.buffer, msg, len);
+        request_msg.len = len;
+        request_msg.index = response_msg.index = 0;
+        errorStatus = errorIndex = 0;
+        sink += parseSNMPMessage();
+    }
+    t1 = test_now_ns();
+    printf("  GET sysDescr %.0f ns,", (double)(t1 - t0) / (BENCH_ROUNDS / 10));
+
+    o = oid_make(heap_free, 11);
+    len = make_request(msg, GET_NEXT_REQUEST, 1, "public", &o, 1);
+    t0 = test_now_ns();
+    for (i = 0; i < BENCH_ROUNDS / 10; i++)
+    {
+        memcpy(request_msg.buffer, msg, len);
+        request_msg.len = len;
+        request_msg.index = response_msg.index = 0;
+        errorStatus = errorIndex = 0;
+        sink += parseSNMPMessage();
+    }
+    t1 = test_now_ns();
+    printf(" GETNEXT past the end %.0f ns\n", (double)(t1 - t0) / (BENCH_ROUNDS / 10));
+    CHECK(sink != 0x7FFFFFFF);
+}
+
+int main(void)
+{
+    TEST_RUN(test_table);
+    TEST_RUN(test_walk);
+    TEST_RUN(test_getnext_anywhere);
+    TEST_RUN(test_get_values);
+    TEST_RUN(test_varbinds);
+    TEST_RUN(test_oversize);
+    TEST_RUN(test_malformed);
+    TEST_RUN(test_traps);
+    TEST_RUN(test_bench);
+    return test_summary("snmp");
+}
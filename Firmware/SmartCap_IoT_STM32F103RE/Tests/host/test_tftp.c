@@ -0,0 +1,652 @@
+/**
+  ******************************************************************************
+  * @file    test_tftp.c
+  * @brief   TFTP Client: blksize/windowsize Negotiation, Window Recovery, Adaptive RTO, Throughput
+  ******************************************************************************
+  * @description
+  * 真实的 TFTP 客户端 (tftp.c) 和 ioLibrary 运行在模拟 W5500 (wiz_sim.h) 上, 对端是测试中的
+  * TFTP 服务器替身, 两个方向各经过一条有单向时延和速率的链路:
+  * - 选项协商: 服务器调低 blksize/windowsize、大小写不同的选项名、调高请求值 (客户端回 ERROR 8)、
+  *   不认识选项 (直接回 512 字节的 DATA, 客户端退回 RFC 1350 的停等)
+  * - 丢包: 窗口中间丢块只回一次 ACK 让服务器从缺口重发, 窗口末尾丢块等 RTO 后重发 ACK,
+  *   OACK 的 ACK 丢失时重复的 OACK 不产生 RTT 采样
+  * - 重传超时: 按实测 RTT 收敛, 服务器无响应时指数退避, 重传 TFTP_MAX_RETRY 次后失败
+  * - 基准: 不同单向时延下 windowsize 1/2/4/8 的下载吞吐
+  * 调用节奏与 OTA_Poll 相同: 每 TFTP_TICK_MS 调用 tftp_timeout_handler, 每 ms 调用一次 TFTP_run。
+  ******************************************************************************
+  */
+
+#include "test.h"
+#include "wiz_sim.h"
+#include "../../User/ioLibrary_Driver/Ethernet/wizchip_conf.c"
+#include "../../User/ioLibrary_Driver/Ethernet/W5500/w5500.c"
+#include "../../User/ioLibrary_Driver/Ethernet/socket.c"
+#include "../../User/ioLibrary_Driver/Internet/TFTP/netutil.c"
+#include "../../User/ioLibrary_Driver/Internet/TFTP/tftp.c"
+#include "ota.h"
+
+#define SERVER_TID              50001   /* 服务器传输用的端口 */
+#define FW_RX_KB                4       /* 固件布局中 OTA_TFTP_SOCK 的 RX 缓冲区 (test_wiz_sockbuf.c) */
+#define LINK_RATE               1250    /* 链路每 ms 传输的字节数 (10Mbit/s) */
+#define SERVER_RTO_MS           1000
+#define FILE_MAX                (256 * 1024)
+#define PIPE_PKTS               64
+#define PKT_MAX                 (4 + 1500)
+
+static const uint8_t server_ip[4] = {192, 168, 1, 10};
+
+static wiz_NetInfo conf = {
+    .mac = {0x00, 0x08, 0xDC, 0x12, 0x34, 0x56},
+    .ip = {192, 168, 1, 50},
+    .sn = {255, 255, 255, 0},
+    .gw = {192, 168, 1, 1},
+    .dhcp = NETINFO_STATIC,
+};
+
+/* 链路 ---------------------------------------------------------------------*/
+
+typedef struct {
+    uint32_t due;
+    uint16_t port;
+    uint16_t len;
+    uint8_t data[PKT_MAX];
+} pkt_t;
+
+/* 单向链路: 报文按速率串行发出, 经 delay_ms 后到达 */
+typedef struct {
+    pkt_t q[PIPE_PKTS];
+    uint32_t head, tail;
+    uint32_t free_at;
+} pipe_t;
+
+static pipe_t to_client, to_server;
+static uint32_t link_delay_ms;
+
+static void pipe_put(pipe_t *p, uint16_t port, const uint8_t *data, uint16_t len)
+{
+    pkt_t *k;
+    uint32_t now = wiz_sim.now;
+
+    if (p->tail - p->head >= PIPE_PKTS)
+        return;
+    if (p->free_at < now)
+        p->free_at = now;
+    p->free_at += (len + 28 + LINK_RATE - 1) / LINK_RATE;
+    k = &p->q[p->tail++ % PIPE_PKTS];
+    k->due = p->free_at + link_delay_ms;
+    k->port = port;
+    k->len = len;
+    memcpy(k->data, data, len);
+}
+
+static pkt_t *pipe_get(pipe_t *p)
+{
+    pkt_t *k;
+
+    if (p->head == p->tail)
+        return NULL;
+    k = &p->q[p->head % PIPE_PKTS];
+    if ((int32_t)(wiz_sim.now - k->due) < 0)
+        return NULL;
+    p->head++;
+    return k;
+}
+
+/* TFTP 服务器替身 -----------------------------------------------------------*/
+
+typedef struct {
+    /* 配置 */
+    uint32_t file_len;
+    uint16_t blksize;                   /* OACK 中回的值, 0 照搬请求 */
+    uint16_t window;
+    const char *blk_name;               /* OACK 中的选项名 */
+    const char *win_name;
+    uint8_t ignore_options;             /* 不发 OACK, 512 字节停等 */
+    uint8_t not_found;                  /* 回 ERROR 1 */
+    uint8_t mute;                       /* 不再响应 */
+    uint16_t mute_after;                /* 收到这一块的 ACK 后不再响应 */
+    uint16_t drop_blocks[8];            /* 第一次发送时丢弃的块 */
+    uint8_t drop_ack0;                  /* 丢弃客户端的前几个 ACK 0 */
+    uint32_t rto_ms;                    /* 服务器的重传超时, 0 为 SERVER_RTO_MS */
+
+    /* 状态 */
+    char req_blksize[8];
+    char req_window[8];
+    char req_timeout[8];
+    uint16_t blk;                       /* 生效的 blksize/windowsize */
+    uint16_t win;
+    uint8_t started;
+    uint8_t oack_acked;
+    uint16_t acked;                     /* 客户端确认的最后一块 */
+    uint16_t sent;                      /* 已发出的最大块号 */
+    uint16_t last_block;
+    uint32_t last_send;
+    uint32_t rrqs;
+    uint32_t oacks;
+    uint32_t acks;
+    uint32_t gap_acks;                  /* 比已发出的块号小的 ACK (客户端报告缺口) */
+    uint32_t resends;
+    uint32_t errors;
+    uint16_t error_code;
+    uint32_t ack_times[16];             /* 客户端 ACK 发出的时刻 */
+    uint32_t ack_count;
+    uint8_t done;
+} server_t;
+
+static server_t srv;
+
+static uint8_t file_byte(uint32_t i)
+{
+    return (uint8_t)(i * 7 + (i >> 9));
+}
+
+static void server_send(const uint8_t *pkt, uint16_t len)
+{
+    pipe_put(&to_client, SERVER_TID, pkt, len);
+    srv.last_send = wiz_sim.now;
+}
+
+static void server_send_oack(void)
+{
+    uint8_t pkt[64];
+    uint16_t len = 2;
+
+    pkt[0] = 0;
+    pkt[1] = TFTP_OACK;
+    len += (uint16_t)sprintf((char *)pkt + len, "%s", srv.blk_name) + 1;
+    len += (uint16_t)sprintf((char *)pkt + len, "%u", srv.blk) + 1;
+    len += (uint16_t)sprintf((char *)pkt + len, "%s", srv.win_name) + 1;
+    len += (uint16_t)sprintf((char *)pkt + len, "%u", srv.win) + 1;
+    len += (uint16_t)sprintf((char *)pkt + len, "timeout") + 1;
+    len += (uint16_t)sprintf((char *)pkt + len, "%s", srv.req_timeout) + 1;
+    srv.oacks++;
+    server_send(pkt, len);
+}
+
+static void server_send_block(uint16_t block)
+{
+    uint8_t pkt[4 + TFTP_BLK_SIZE_MAX];
+    uint32_t off = (uint32_t)(block - 1) * srv.blk, n, i;
+
+    for (i = 0; i < sizeof(srv.drop_blocks) / sizeof(srv.drop_blocks[0]); i++)
+    {
+        if (srv.drop_blocks[i] == block)
+        {
+            srv.drop_blocks[i] = 0;
+            srv.last_send = wiz_sim.now;
+            return;
+        }
+    }
+    n = srv.file_len - off < srv.blk ? srv.file_len - off : srv.blk;
+    pkt[0] = 0;
+    pkt[1] = TFTP_DATA;
+    pkt[2] = (uint8_t)(block >> 8);
+    pkt[3] = (uint8_t)block;
+    for (i = 0; i < n; i++)
+        pkt[4 + i] = file_byte(off + i);
+    server_send(pkt, (uint16_t)(4 + n));
+}
+
+/* 发出 from 开始的一个窗口 */
+static void server_send_window(uint16_t from)
+{
+    uint16_t b;
+
+    for (b = from; b < from + srv.win && b <= srv.last_block; b++)
+        server_send_block(b);
+    if ((uint16_t)(b - 1) > srv.sent)
+        srv.sent = (uint16_t)(b - 1);
+}
+
+static const char *rrq_option(const uint8_t *p, const uint8_t *end, const char *name)
+{
+    while (p < end)
+    {
+        const char *code = (const char *)p;
+        p += strlen(code) + 1;
+        if (p >= end)
+            break;
+        if (strcmp(code, name) == 0)
+            return (const char *)p;
+        p += strlen((const char *)p) + 1;
+    }
+    return "";
+}
+
+static void server_on_rrq(const uint8_t *pkt, uint16_t len)
+{
+    const uint8_t *p = pkt + 2, *end = pkt + len;
+    static const uint8_t not_found[] = {0, TFTP_ERROR, 0, 1, 'n', 'o', 't', ' ', 'f', 'o', 'u', 'n', 'd', 0};
+
+    srv.rrqs++;
+    if (srv.mute)
+        return;
+    if (srv.not_found)
+    {
+        server_send(not_found, sizeof(not_found));
+        return;
+    }
+    p += strlen((const char *)p) + 1;           /* 文件名 */
+    p += strlen((const char *)p) + 1;           /* 模式 */
+    snprintf(srv.req_blksize, sizeof(srv.req_blksize), "%s", rrq_option(p, end, "blksize"));
+    snprintf(srv.req_window, sizeof(srv.req_window), "%s", rrq_option(p, end, "windowsize"));
+    snprintf(srv.req_timeout, sizeof(srv.req_timeout), "%s", rrq_option(p, end, "timeout"));
+
+    if (srv.started)
+        return;                                 /* 重传的 RRQ, 服务器超时会重发 */
+    srv.started = 1;
+    if (srv.ignore_options)
+    {
+        srv.blk = TFTP_BLK_SIZE;
+        srv.win = 1;
+        srv.oack_acked = 1;
+    }
+    else
+    {
+        srv.blk = srv.blksize ? srv.blksize : (uint16_t)atoi(srv.req_blksize);
+        srv.win = srv.window ? srv.window : (uint16_t)atoi(srv.req_window);
+    }
+    srv.last_block = (uint16_t)(srv.file_len / srv.blk + 1);
+    if (srv.ignore_options)
+        server_send_window(1);
+    else
+        server_send_oack();
+}
+
+static void server_on_ack(uint16_t block)
+{
+    if (srv.ack_count < sizeof(srv.ack_times) / sizeof(srv.ack_times[0]))
+        srv.ack_times[srv.ack_count] = wiz_sim.now;
+    srv.ack_count++;
+    if (block == 0 && !srv.oack_acked && srv.drop_ack0)
+    {
+        srv.drop_ack0--;
+        return;
+    }
+    srv.acks++;
+    if (srv.mute)
+        return;
+    if (block == 0)
+        srv.oack_acked = 1;
+    if (block < srv.acked)
+        return;
+    if (block < srv.sent)
+        srv.gap_acks++;
+    srv.acked = block;
+    if (srv.mute_after && block >= srv.mute_after)
+    {
+        srv.mute = 1;
+        return;
+    }
+    if (block == srv.last_block)
+    {
+        srv.done = 1;
+        return;
+    }
+    server_send_window((uint16_t)(block + 1));
+}
+
+static void server_poll(void)
+{
+    pkt_t *k;
+    uint16_t op;
+
+    while ((k = pipe_get(&to_server)) != NULL)
+    {
+        op = (uint16_t)((k->data[0] << 8) | k->data[1]);
+        if (op == TFTP_RRQ && k->port == TFTP_SERVER_PORT)
+            server_on_rrq(k->data, k->len);
+        else if (op == TFTP_ACK && k->port == SERVER_TID)
+            server_on_ack((uint16_t)((k->data[2] << 8) | k->data[3]));
+        else if (op == TFTP_ERROR)
+        {
+            srv.errors++;
+            srv.error_code = (uint16_t)((k->data[2] << 8) | k->data[3]);
+        }
+    }
+
+    /* 服务器的重传: 超时后重发 OACK 或从最后确认的块重发窗口 */
+    if (srv.started && !srv.done && !srv.mute &&
+        wiz_sim.now - srv.last_send >= (srv.rto_ms ? srv.rto_ms : SERVER_RTO_MS))
+    {
+        srv.resends++;
+        if (!srv.oack_acked)
+            server_send_oack();
+        else
+            server_send_window((uint16_t)(srv.acked + 1));
+    }
+}
+
+/* 客户端报文发出 */
+static void wiz_sim_udp_out(uint8_t sn, const uint8_t ip[4], uint16_t port, const uint8_t *data, uint16_t len)
+{
+    (void)sn;
+    (void)ip;
+    pipe_put(&to_server, port, data, len);
+}
+
+/* 客户端 -------------------------------------------------------------------*/
+
+static uint8_t tftp_buf[TFTP_RCV_BUF_SIZE];
+static uint8_t image[FILE_MAX];
+static uint32_t image_len;
+static uint32_t image_blocks;
+static uint8_t image_order_ok;
+static uint16_t info_blk, info_win, info_rto;   /* 最后一块时的协商结果 */
+static uint16_t first_rto, last_rto;            /* 第 1 块和最后一块时的 RTO */
+
+/* tftp.c 的下载回调: 块号连续, 数据依次写入 */
+void save_data(uint8_t *data, uint32_t data_len, uint16_t block_number)
+{
+    if (block_number != (uint16_t)(image_blocks + 1))
+        image_order_ok = 0;
+    if (image_len + data_len <= sizeof(image))
+        memcpy(image + image_len, data, data_len);
+    image_len += data_len;
+    image_blocks++;
+    TFTP_get_transfer_info(&info_blk, &info_win, &info_rto);
+    if (image_blocks == 1)
+        first_rto = info_rto;
+    last_rto = info_rto;
+}
+
+static void setup(uint8_t rx_kb, uint32_t delay_ms, uint32_t file_len)
+{
+    wiz_sim_init();
+    wizchip_setnetinfo(&conf);
+    setSn_RXBUF_SIZE(OTA_TFTP_SOCK, rx_kb);
+    memset(&to_client, 0, sizeof(to_client));
+    memset(&to_server, 0, sizeof(to_server));
+    link_delay_ms = delay_ms;
+    memset(&srv, 0, sizeof(srv));
+    srv.file_len = file_len;
+    srv.blk_name = "blksize";
+    srv.win_name = "windowsize";
+    image_len = 0;
+    image_blocks = 0;
+    image_order_ok = 1;
+    info_blk = info_win = info_rto = 0;
+    first_rto = last_rto = 0;
+}
+
+/* 按 OTA_Poll 的节奏运行到结束或 limit_ms, 返回 TFTP_run 的结果, *ms 为耗时 */
+static int run_download(uint32_t limit_ms, uint32_t *ms)
+{
+    uint32_t start = wiz_sim.now, ticks = 0, t;
+    int ret = TFTP_PROGRESS;
+    pkt_t *k;
+
+    TFTP_init(OTA_TFTP_SOCK, tftp_buf);
+    TFTP_read_request(((uint32_t)server_ip[0] << 24) | ((uint32_t)server_ip[1] << 16) |
+                      ((uint32_t)server_ip[2] << 8) | server_ip[3], (uint8_t *)"smartcap.bin");
+    while (ret == TFTP_PROGRESS && wiz_sim.now - start < limit_ms)
+    {
+        wiz_sim_tick(1);
+        server_poll();
+        while ((k = pipe_get(&to_client)) != NULL)
+            wiz_sim_udp_in(OTA_TFTP_SOCK, server_ip, k->port, k->data, k->len);
+        if (++ticks % TFTP_TICK_MS == 0)
+            tftp_timeout_handler();
+        ret = TFTP_run();
+    }
+    if (ms)
+        *ms = wiz_sim.now - start;
+    TFTP_exit();
+
+    /* 最后发出的报文送达服务器 */
+    for (t = 0; t < link_delay_ms + 10; t++)
+    {
+        wiz_sim_tick(1);
+        server_poll();
+    }
+    return ret;
+}
+static uint8_t image_ok(void)
+{
+    uint32_t i;
+
+    if (image_len != srv.file_len || !image_order_ok)
+        return 0;
+    for (i = 0; i < image_len; i++)
+    {
+        if (image[i] != file_byte(i))
+            return 0;
+    }
+    return 1;
+}
+
+/* 测试 ---------------------------------------------------------------------*/
+
+/* 请求按 RX 缓冲区计算: 4KB 放得下 3 个 1024 字节的块, 16KB 取上限 8, 1KB 只能用 512 字节停等 */
+static void test_request_options(void)
+{
+    setup(FW_RX_KB, 2, 10000);
+    CHECK_EQ(run_download(5000, NULL), TFTP_SUCCESS);
+    CHECK_EQ(srv.rrqs, 1);
+    CHECK(strcmp(srv.req_blksize, "1024") == 0);
+    CHECK(strcmp(srv.req_window, "3") == 0);
+    CHECK(strcmp(srv.req_timeout, "5") == 0);
+    CHECK_EQ(info_blk, 1024);
+    CHECK_EQ(info_win, 3);
+    CHECK(image_ok());
+
+    setup(16, 2, 10000);
+    CHECK_EQ(run_download(5000, NULL), TFTP_SUCCESS);
+    CHECK(strcmp(srv.req_window, "8") == 0);
+    CHECK_EQ(info_win, 8);
+    CHECK(image_ok());
+
+    setup(1, 2, 3000);
+    CHECK_EQ(run_download(5000, NULL), TFTP_SUCCESS);
+    CHECK(strcmp(srv.req_blksize, "512") == 0);
+    CHECK(strcmp(srv.req_window, "1") == 0);
+    CHECK_EQ(info_blk, 512);
+    CHECK(image_ok());
+}
+
+/* 服务器调低 blksize/windowsize, 选项名大小写不同也按 OACK 的值传输 */
+static void test_server_lowers(void)
+{
+    setup(16, 2, 5000);
+    srv.blksize = 300;
+    srv.window = 2;
+    srv.blk_name = "BLKSIZE";
+    srv.win_name = "WindowSize";
+    CHECK_EQ(run_download(5000, NULL), TFTP_SUCCESS);
+    CHECK_EQ(info_blk, 300);
+    CHECK_EQ(info_win, 2);
+    CHECK_EQ(image_blocks, 5000 / 300 + 1);
+    CHECK(image_ok());
+    CHECK_EQ(srv.gap_acks, 0);
+    CHECK_EQ(srv.resends, 0);
+}
+
+/* 服务器调高请求的值: 客户端回 ERROR 8 并失败 */
+static void test_server_raises(void)
+{
+    setup(FW_RX_KB, 2, 5000);
+    srv.blksize = 1428;
+    CHECK_EQ(run_download(5000, NULL), TFTP_FAIL);
+    CHECK_EQ(srv.errors, 1);
+    CHECK_EQ(srv.error_code, 8);
+    CHECK_EQ(image_len, 0);
+
+    setup(FW_RX_KB, 2, 5000);
+    srv.window = 4;
+    CHECK_EQ(run_download(5000, NULL), TFTP_FAIL);
+    CHECK_EQ(srv.errors, 1);
+    CHECK_EQ(srv.error_code, 8);
+}
+
+/* 不支持选项的服务器直接回 DATA 1: 512 字节停等, 文件完整 */
+static void test_server_ignores_options(void)
+{
+    setup(16, 2, 5000);
+    srv.ignore_options = 1;
+    CHECK_EQ(run_download(5000, NULL), TFTP_SUCCESS);
+    CHECK_EQ(srv.oacks, 0);
+    CHECK_EQ(info_blk, 512);
+    CHECK_EQ(info_win, 1);
+    CHECK_EQ(image_blocks, 5000 / 512 + 1);
+    CHECK(image_ok());
+}
+
+/* 服务器报告错误时失败 */
+static void test_server_error(void)
+{
+    setup(FW_RX_KB, 2, 5000);
+    srv.not_found = 1;
+    CHECK_EQ(run_download(5000, NULL), TFTP_FAIL);
+    CHECK_EQ(image_len, 0);
+}
+
+/* 文件长度是 blksize 的整数倍时以 0 字节的块结束 */
+static void test_exact_multiple(void)
+{
+    setup(16, 2, 8 * 1024);
+    CHECK_EQ(run_download(5000, NULL), TFTP_SUCCESS);
+    CHECK_EQ(image_blocks, 9);
+    CHECK(image_ok());
+    CHECK_EQ(srv.acked, 9);
+}
+
+/* 窗口中间丢块: 客户端对缺口只回一次 ACK, 服务器从缺口重发, 不等超时 */
+static void test_window_gap(void)
+{
+    uint32_t ms;
+
+    setup(16, 20, 64 * 1024);
+    srv.drop_blocks[0] = 3;
+    srv.drop_blocks[1] = 21;
+    CHECK_EQ(run_download(10000, &ms), TFTP_SUCCESS);
+    CHECK(image_ok());
+    CHECK_EQ(srv.gap_acks, 2);
+    CHECK_EQ(srv.resends, 0);
+    /* 64 块 8 个窗口, 每个缺口多一个往返 */
+    CHECK(ms < 11 * 50);
+}
+
+/* 窗口末尾丢块: 收不到后续块, RTO 后重发最后一个按序块的 ACK */
+static void test_window_tail_loss(void)
+{
+    uint32_t ms;
+
+    setup(16, 20, 64 * 1024);
+    srv.drop_blocks[0] = 16;
+    CHECK_EQ(run_download(10000, &ms), TFTP_SUCCESS);
+    CHECK(image_ok());
+    CHECK_EQ(srv.resends, 0);
+    CHECK(srv.acks > 9);
+    CHECK(ms < SERVER_RTO_MS);
+}
+
+/*
+ * OACK 的 ACK 丢失: 服务器先于客户端超时, 重发 OACK, 客户端再回 ACK 0。DATA 1 回答的是重发的
+ * ACK, 不能作为 RTT 采样, 第 1 块时的 RTO 仍只来自 RRQ/OACK 的往返 (3 x RTT)
+ */
+static void test_lost_oack_ack(void)
+{
+    setup(16, 100, 64 * 1024);
+    srv.rto_ms = 300;
+    srv.drop_ack0 = 1;
+    CHECK_EQ(run_download(10000, NULL), TFTP_SUCCESS);
+    CHECK(image_ok());
+    CHECK_EQ(srv.oacks, 2);
+    CHECK_EQ(srv.resends, 1);
+    CHECK(first_rto <= 3 * 200);
+    CHECK(last_rto < 2 * 200);
+}
+
+/* RTO 收敛到实测 RTT 附近: 远低于初始 1s, 也不低于 RTT */
+static void test_rto_adapts(void)
+{
+    static const uint32_t delays[] = {5, 50, 150};
+    uint32_t i, rtt;
+
+    for (i = 0; i < sizeof(delays) / sizeof(delays[0]); i++)
+    {
+        setup(16, delays[i], 128 * 1024);
+        CHECK_EQ(run_download(60000, NULL), TFTP_SUCCESS);
+        CHECK(image_ok());
+        rtt = 2 * delays[i];
+        CHECK(last_rto >= TFTP_RTO_MIN_MS);
+        CHECK(last_rto > rtt);
+        CHECK(last_rto < rtt + 100 || last_rto == TFTP_RTO_MIN_MS);
+        printf("  one-way %3lu ms: RTO first %4u ms, after %lu blocks %4u ms\n",
+               (unsigned long)delays[i], first_rto, (unsigned long)image_blocks, last_rto);
+    }
+}
+
+/* 服务器无响应: 重传 ACK 的间隔按 RTO 加倍, TFTP_MAX_RETRY 次重传都超时后失败 */
+static void test_backoff(void)
+{
+    uint32_t ms, i, first, gap, prev;
+
+    setup(16, 20, 64 * 1024);
+    srv.mute_after = 8;
+    CHECK_EQ(run_download(60000, &ms), TFTP_FAIL);
+    CHECK_EQ(image_blocks, 8);
+
+    /* ACK 0、ACK 8, 再加 TFTP_MAX_RETRY 次重传的 ACK 8 */
+    CHECK_EQ(srv.ack_count, 2 + TFTP_MAX_RETRY);
+    first = srv.ack_times[2] - srv.ack_times[1];
+    CHECK(first + TFTP_TICK_MS >= TFTP_RTO_MIN_MS && first <= 300);
+    for (i = 3; i < srv.ack_count; i++)
+    {
+        gap = srv.ack_times[i] - srv.ack_times[i - 1];
+        prev = srv.ack_times[i - 1] - srv.ack_times[i - 2];
+        CHECK(gap + 2 * TFTP_TICK_MS >= 2 * prev && gap <= 2 * prev + 2 * TFTP_TICK_MS);
+    }
+    /* 最后一次重传之后还等了一个加倍的 RTO 才失败 */
+    gap = srv.ack_times[srv.ack_count - 1] - srv.ack_times[srv.ack_count - 2];
+    CHECK(ms + TFTP_TICK_MS >= srv.ack_times[srv.ack_count - 1] - srv.ack_times[0] + 2 * gap);
+    printf("  server silent: %u retransmissions, first after %lu ms, gave up after %lu ms\n",
+           TFTP_MAX_RETRY, (unsigned long)first, (unsigned long)ms);
+}
+
+/* 基准: 服务器把 windowsize 调到 1/2/4/8, 不同单向时延下的下载吞吐 */
+static void test_window_bench(void)
+{
+    static const uint32_t delays[] = {2, 20, 60};
+    static const uint16_t windows[] = {1, 2, 4, 8};
+    uint32_t d, w, ms, kbps[4];
+
+    for (d = 0; d < sizeof(delays) / sizeof(delays[0]); d++)
+    {
+        for (w = 0; w < 4; w++)
+        {
+            setup(16, delays[d], 128 * 1024);
+            srv.window = windows[w];
+            CHECK_EQ(run_download(120000, &ms), TFTP_SUCCESS);
+            CHECK(image_ok());
+            CHECK_EQ(info_win, windows[w]);
+            CHECK_EQ(srv.resends, 0);
+            kbps[w] = (uint32_t)((uint64_t)srv.file_len * 1000 / 1024 / ms);
+        }
+        for (w = 1; w < 4; w++)
+            CHECK(kbps[w] > kbps[w - 1]);
+        /* 时延越大窗口越有用: 往返远大于一个窗口的发送时间时近似按窗口成倍 */
+        if (delays[d] >= 20)
+            CHECK(kbps[3] > 5 * kbps[0]);
+        printf("  one-way %2lu ms, blksize 1024: window 1 %4lu KB/s, 2 %4lu KB/s, 4 %4lu KB/s, 8 %4lu KB/s\n",
+               (unsigned long)delays[d], (unsigned long)kbps[0], (unsigned long)kbps[1],
+               (unsigned long)kbps[2], (unsigned long)kbps[3]);
+    }
+}
+
+int main(void)
+{
+    TEST_RUN(test_request_options);
+    TEST_RUN(test_server_lowers);
+    TEST_RUN(test_server_raises);
+    TEST_RUN(test_server_ignores_options);
+    TEST_RUN(test_server_error);
+    TEST_RUN(test_exact_multiple);
+    TEST_RUN(test_window_gap);
+    TEST_RUN(test_window_tail_loss);
+    TEST_RUN(test_lost_oack_ack);
+    TEST_RUN(test_rto_adapts);
+    TEST_RUN(test_backoff);
+    TEST_RUN(test_window_bench);
+    return test_summary("tftp");
+}
@@ -0,0 +1,587 @@
+/**
+  ******************************************************************************
+  * @file    test_time_sync.c
+  * @brief   Clock Discipline Against a Simulated SNTP Server: Accuracy, Drift, Monotonicity
+  ******************************************************************************
+  * @description
+  * 真实的 time_sync.c、UDP 非阻塞发送 (wiz_txq.c) 和 ioLibrary 运行在模拟 W5500 上:
+  * - 真实时间由本机 tick 换算: 本机晶振比真实时间快 drift_ppb, 上电时刻的 UTC 为 TRUE_EPOCH_MS
+  * - SNTP 服务器的时间 = 真实时间 + server_offset_ms, 请求和应答分别经 up_ms/down_ms 到达,
+  *   可以设置为不应答、kiss-o'-death、未同步 (LI=3)、错误 originate 或错误来源
+  * - SNTP 交换中的 osDelay(1) 经 stub_delay_hook 推进模拟 (投递应答)
+  * - 时间戳误差 = TimeSync_GetUnixMs() - 真实时间, 按毫秒检查
+  * 日历换算与 libc gmtime_r/timegm 对照, 并测量换算耗时。
+  ******************************************************************************
+  */
+
+#include "test.h"
+#include "wiz_sim.h"
+#include "stm32f1xx_hal.h"
+#include "../../User/ioLibrary_Driver/Ethernet/wizchip_conf.c"
+#include "../../User/ioLibrary_Driver/Ethernet/W5500/w5500.c"
+#include "../../User/ioLibrary_Driver/Ethernet/socket.c"
+#include "../../User/wiz_interface/wiz_txq.c"
+#include "../../User/user_main/time_sync.c"
+#include <stdlib.h>
+
+#define TRUE_EPOCH_MS           1792281600000LL    /* 2026-10-18 00:00:00 UTC */
+#define NTP_UNIX_DELTA          2208988800ULL
+#define POLL_MS                 100
+#define BENCH_ROUNDS            1000000
+
+static const uint8_t ntp_ip[4] = {203, 107, 6, 88};
+static const uint8_t stranger[4] = {10, 0, 0, 99};
+
+static const wiz_NetInfo netinfo = {
+    .mac = {0x00, 0x08, 0xDC, 0x12, 0x34, 0x56},
+    .ip = {192, 168, 1, 50},
+    .sn = {255, 255, 255, 0},
+    .gw = {192, 168, 1, 1},
+    .dns = {192, 168, 1, 1},
+    .dhcp = NETINFO_STATIC,
+};
+
+/* 模拟世界 */
+static int32_t drift_ppb;           /* 本机晶振比真实时间快 */
+static uint8_t net_up;
+
+/* 模拟 SNTP 服务器 */
+#define SRV_OK          0
+#define SRV_SILENT      1
+#define SRV_KOD         2
+#define SRV_ALARM       3
+#define SRV_BAD_ORIG    4
+#define SRV_STRANGER    5
+
+static struct
+{
+    uint8_t mode;
+    int32_t offset_ms;              /* 服务器时间 - 真实时间 */
+    uint32_t up_ms;
+    uint32_t down_ms;
+    uint32_t requests;
+
+    uint8_t reply[SNTP_MSG_LEN];
+    uint32_t reply_at;              /* 本机 tick, 0 表示没有待投递的应答 */
+} server;
+
+/* 平台接口 -----------------------------------------------------------------*/
+
+uint32_t HAL_GetUIDw0(void) { return 0x12345678; }
+uint32_t HAL_GetUIDw1(void) { return 0x9ABCDEF0; }
+uint32_t HAL_GetUIDw2(void) { return 0x0F1E2D3C; }
+
+wiz_sup_state_t wiz_supervisor_get_state(void)
+{
+    return net_up ? WIZ_SUP_STATE_UP : WIZ_SUP_STATE_LINK_DOWN;
+}
+
+void wiz_sockbuf_set_role(uint8_t sn, wiz_sock_role_t role)
+{
+}
+
+int8_t wiz_dns_resolve(const char *name, wiz_dns_type_t type, uint8_t *addr, wiz_dns_cb_t cb, void *arg)
+{
+    memcpy(addr, ntp_ip, 4);
+    return WIZ_DNS_OK;
+}
+
+/* 本机 tick 对应的真实时间 (UTC, ms, 带小数) */
+static double true_ms(void)
+{
+    return (double)TRUE_EPOCH_MS + (double)stub_tick / (1.0 + drift_ppb * 1e-9);
+}
+
+static void put_ntp(uint8_t *p, double unix_ms)
+{
+    double s = unix_ms / 1000.0;
+    uint64_t sec = (uint64_t)s;
+    uint32_t frac = (uint32_t)((s - (double)sec) * 4294967296.0);
+
+    sec += NTP_UNIX_DELTA;
+    p[0] = (uint8_t)(sec >> 24);
+    p[1] = (uint8_t)(sec >> 16);
+    p[2] = (uint8_t)(sec >> 8);
+    p[3] = (uint8_t)sec;
+    p[4] = (uint8_t)(frac >> 24);
+    p[5] = (uint8_t)(frac >> 16);
+    p[6] = (uint8_t)(frac >> 8);
+    p[7] = (uint8_t)frac;
+}
+
+static void wiz_sim_udp_out(uint8_t sn, const uint8_t ip[4], uint16_t port, const uint8_t *data, uint16_t len)
+{
+    uint8_t *r = server.reply;
+    double t2;
+
+    if (sn != TIME_SYNC_SNTP_SOCK || port != SNTP_SERVER_PORT || memcmp(ip, ntp_ip, 4) != 0 ||
+        len != SNTP_MSG_LEN)
+        return;
+    server.requests++;
+    if (server.mode == SRV_SILENT)
+        return;
+
+    /* 请求到达服务器时记录 t2, 处理 1ms 后发出 (t3) */
+    t2 = true_ms() + server.up_ms + server.offset_ms;
+    memset(r, 0, SNTP_MSG_LEN);
+    r[0] = (0 << 6) | (4 << 3) | SNTP_MODE_SERVER;
+    r[1] = 2;
+    r[2] = 6;
+    r[3] = 0xEC;
+    memcpy(&r[24], &data[40], 8);
+    put_ntp(&r[32], t2);
+    put_ntp(&r[40], t2 + 1);
+    switch (server.mode)
+    {
+    case SRV_KOD:
+        r[1] = 0;
+        break;
+    case SRV_ALARM:
+        r[0] |= SNTP_LI_ALARM << 6;
+        break;
+    case SRV_BAD_ORIG:
+        r[31] ^= 0x01;
+        break;
+    default:
+        break;
+    }
+    server.reply_at = stub_tick + server.up_ms + 1 + server.down_ms;
+}
+
+/* 仿真 ---------------------------------------------------------------------*/
+
+/* 本机 tick 已前进 ms: 推进芯片, 投递到期的应答 */
+static void world_step(uint32_t ms)
+{
+    wiz_sim_tick(ms);
+    if (server.reply_at != 0 && (int32_t)(stub_tick - server.reply_at) >= 0)
+    {
+        server.reply_at = 0;
+        wiz_sim_udp_in(TIME_SYNC_SNTP_SOCK, server.mode == SRV_STRANGER ? stranger : ntp_ip,
+                       SNTP_SERVER_PORT, server.reply, SNTP_MSG_LEN);
+    }
+}
+
+static void setup(int32_t drift)
+{
+    wiz_sim_init();
+    wizchip_setnetinfo((wiz_NetInfo *)&netinfo);
+    stub_tick = 0;
+    stub_delay_hook = world_step;
+    drift_ppb = drift;
+    net_up = 1;
+
+    memset(&clk, 0, sizeof(clk));
+    synced = 0;
+    mono_last = 0;
+    mono_high = 0;
+    freq_base_ms = 0;
+    freq_base_valid = 0;
+    sntp_next_ms = 0;
+    sntp_poll_s = TIME_SYNC_POLL_MIN_S;
+    sntp_last_s = 0;
+    sntp_ever = 0;
+    modem_last_s = 0;
+    modem_queried = 0;
+    memset(&stats, 0, sizeof(stats));
+    TimeSync_Init();
+
+    memset(&server, 0, sizeof(server));
+    server.up_ms = 10;
+    server.down_ms = 10;
+}
+
+/* 时间戳误差 (ms) */
+static double clock_error(void)
+{
+    return (double)TimeSync_GetUnixMs() - true_ms();
+}
+
+static struct
+{
+    double max_abs_error;           /* 统计区间内的最大 |误差| */
+    uint32_t backwards;             /* 墙上时钟倒退次数 */
+    int64_t last_ms;
+} track;
+
+static void track_reset(void)
+{
+    memset(&track, 0, sizeof(track));
+}
+
+/*
+ * 运行到 ms 毫秒之后, 默认任务每 POLL_MS 调用 TimeSync_Poll (交换阻塞的时间计入);
+ * 每 ms 检查墙上时钟单调和误差
+ */
+static void run_ms(uint32_t ms)
+{
+    uint32_t end = stub_tick + ms;
+    int64_t now;
+    double err;
+
+    while ((int32_t)(stub_tick - end) < 0)
+    {
+        stub_tick++;
+        world_step(1);
+        if (stub_tick % POLL_MS == 0)
+            TimeSync_Poll();
+        if (!TimeSync_IsSynced())
+            continue;
+        now = TimeSync_GetUnixMs();
+        if (track.last_ms != 0 && now < track.last_ms)
+            track.backwards++;
+        track.last_ms = now;
+        err = (double)now - true_ms();
+        if (err < 0)
+            err = -err;
+        if (err > track.max_abs_error)
+            track.max_abs_error = err;
+    }
+}
+
+/* 测试 ---------------------------------------------------------------------*/
+
+/* 日历换算与 libc 对照: 1900 ~ 2400 年随机时刻和每个闰日前后 */
+static void test_calendar(void)
+{
+    TimeSync_DateTime_t dt;
+    struct tm tm;
+    time_t t;
+    int64_t s;
+    uint32_t n, bad = 0;
+    int y;
+
+    TimeSync_EpochToCalendar(0, &dt);
+    CHECK(dt.year == 1970 && dt.month == 1 && dt.day == 1 && dt.hour == 0 && dt.weekday == 4);
+    TimeSync_EpochToCalendar(-1, &dt);
+    CHECK(dt.year == 1969 && dt.month == 12 && dt.day == 31 && dt.second == 59 && dt.weekday == 3);
+    TimeSync_EpochToCalendar(951782400, &dt);
+    CHECK(dt.year == 2000 && dt.month == 2 && dt.day == 29 && dt.weekday == 2);
+    TimeSync_EpochToCalendar(4107542400LL, &dt);
+    CHECK(dt.year == 2100 && dt.month == 3 && dt.day == 1 && dt.weekday == 1);
+    TimeSync_EpochToCalendar(253402300799LL, &dt);
+    CHECK(dt.year == 9999 && dt.month == 12 && dt.day == 31 && dt.hour == 23 && dt.minute == 59);
+    CHECK_EQ(TimeSync_CalendarToEpoch(&dt), 253402300799LL);
+
+    srand(1);
+    for (n = 0; n < 2000000; n++)
+    {
+        s = -2208988800LL + (int64_t)(((uint64_t)rand() << 31 | (uint64_t)rand()) % 15778800000ULL);
+        t = (time_t)s;
+        gmtime_r(&t, &tm);
+        TimeSync_EpochToCalendar(s, &dt);
+        if (dt.year != tm.tm_year + 1900 || dt.month != tm.tm_mon + 1 || dt.day != tm.tm_mday ||
+            dt.hour != tm.tm_hour || dt.minute != tm.tm_min || dt.second != tm.tm_sec ||
+            dt.weekday != tm.tm_wday || TimeSync_CalendarToEpoch(&dt) != s)
+            bad++;
+    }
+    CHECK_EQ(bad, 0);
+
+    for (y = 1900; y <= 2400; y++)
+    {
+        memset(&tm, 0, sizeof(tm));
+        tm.tm_year = y - 1900;
+        tm.tm_mon = 2;
+        tm.tm_mday = 1;
+        s = (int64_t)timegm(&tm) - 1;   /* 2 月最后一秒 */
+        TimeSync_EpochToCalendar(s, &dt);
+        CHECK_EQ(dt.day, (y % 4 == 0 && (y % 100 != 0 || y % 400 == 0)) ? 29 : 28);
+        CHECK_EQ(TimeSync_CalendarToEpoch(&dt), s);
+    }
+}
+
+/* NTP 时间戳: 2036-02-07 回绕后的时刻按新纪元解释 */
+static void test_ntp_era(void)
+{
+    uint8_t p[8] = {0};
+
+    CHECK_EQ(TimeSync_NtpToUnixMs(p), 2085978496000LL);
+    p[0] = 0xFF;
+    p[1] = 0xFF;
+    p[2] = 0xFF;
+    p[3] = 0xFF;
+    CHECK_EQ(TimeSync_NtpToUnixMs(p), 2085978495000LL);
+    p[4] = 0x80;
+    CHECK_EQ(TimeSync_NtpToUnixMs(p), 2085978495500LL);
+    put_ntp(p, (double)TRUE_EPOCH_MS + 250);
+    CHECK_EQ(TimeSync_NtpToUnixMs(p), TRUE_EPOCH_MS + 250);
+}
+
+/* 单调时钟跨过 32 位 tick 回绕后继续增加 */
+static void test_monotonic_wrap(void)
+{
+    uint64_t a, b;
+
+    setup(0);
+    stub_tick = 0xFFFFFF00UL;
+    a = TimeSync_MonotonicMs();
+    stub_tick += 0x200;
+    b = TimeSync_MonotonicMs();
+    CHECK_EQ(b - a, 0x200);
+    CHECK(b > 0xFFFFFFFFULL);
+    stub_tick += 0x7FFFFFFF;
+    CHECK_EQ(TimeSync_MonotonicMs() - b, 0x7FFFFFFF);
+    CHECK_EQ(mono_high, 1);
+}
+
+/* 首次同步跳变到服务器时间, 对称延时下误差在 1ms 级 */
+static void test_first_sync(void)
+{
+    TimeSync_Stats_t st;
+    TimeSync_DateTime_t dt;
+
+    setup(0);
+    CHECK(!TimeSync_IsSynced());
+    CHECK_EQ(TimeSync_GetUnixMs(), 0);
+    CHECK(!TimeSync_GetDateTime(&dt));
+    run_ms(POLL_MS + 50);
+    CHECK(TimeSync_IsSynced());
+    TimeSync_GetStats(&st);
+    CHECK_EQ(st.steps, 1);
+    CHECK_EQ(st.sntp_replies, 1);
+    CHECK_EQ(st.source, TIME_SRC_SNTP);
+    CHECK(st.last_delay_ms >= 19 && st.last_delay_ms <= 21);
+    CHECK(clock_error() > -2 && clock_error() < 2);
+    CHECK(TimeSync_GetDateTime(&dt));
+    CHECK(dt.year == 2026 && dt.month == 10 && dt.day == 18 && dt.hour == 0 && dt.minute == 0);
+
+    /* 之前采集的数据按当时的单调时钟换算时间戳 */
+    CHECK(llabs(TimeSync_MonoToUnixMs(50) - (TRUE_EPOCH_MS + 50)) <= 2);
+
+    /* 下一次交换在 TIME_SYNC_POLL_MIN_S 之后 */
+    run_ms(TIME_SYNC_POLL_MIN_S * 1000 - 1000);
+    CHECK_EQ(server.requests, 1);
+    run_ms(2000);
+    CHECK_EQ(server.requests, 2);
+}
+
+/*
+ * 服务器时间变化 300ms: 以 500ppm 渐进调整 (600s), 期间墙上时钟不倒退;
+ * 向后调整同样单调; 超过 TIME_SYNC_STEP_MS 时跳变
+ */
+static void test_slew(void)
+{
+    TimeSync_Stats_t st;
+
+    setup(0);
+    run_ms(POLL_MS + 50);
+    server.offset_ms = 300;
+    track_reset();
+    run_ms(TIME_SYNC_POLL_MIN_S * 1000);
+    TimeSync_GetStats(&st);
+    CHECK_EQ(st.slews, 1);
+    CHECK_EQ(st.steps, 1);
+    CHECK(st.last_offset_ms >= 299 && st.last_offset_ms <= 301);
+    run_ms(600 * 1000);
+    CHECK(clock_error() - 300 > -3 && clock_error() - 300 < 3);
+    CHECK_EQ(track.backwards, 0);
+
+    server.offset_ms = 0;
+    track_reset();
+    run_ms(1200 * 1000);
+    CHECK(clock_error() > -3 && clock_error() < 3);
+    CHECK_EQ(track.backwards, 0);
+
+    server.offset_ms = 2000;
+    run_ms(TIME_SYNC_POLL_MAX_S * 1000);
+    TimeSync_GetStats(&st);
+    CHECK_EQ(st.steps, 2);
+    CHECK(clock_error() - 2000 > -3 && clock_error() - 2000 < 3);
+}
+
+/*
+ * 晶振频偏: 补偿估计收敛到实际值附近, 轮询间隔延长到 1024s 后误差仍远小于
+ * 不补偿时一个间隔累积的偏差
+ */
+static void run_drift(int32_t drift, double *max_err, int32_t *freq_ppb, uint32_t *poll_s)
+{
+    TimeSync_Stats_t st;
+
+    setup(drift);
+    run_ms(3 * 3600 * 1000);
+    track_reset();
+    run_ms(3600 * 1000);
+    TimeSync_GetStats(&st);
+    *max_err = track.max_abs_error;
+    *freq_ppb = st.freq_ppb;
+    *poll_s = sntp_poll_s;
+    CHECK_EQ(track.backwards, 0);
+    CHECK_EQ(st.steps, 1);
+}
+
+static void test_drift(void)
+{
+    static const int32_t drifts[] = {100000, -100000, 30000};
+    double err;
+    int32_t freq;
+    uint32_t poll_s, i;
+
+    for (i = 0; i < sizeof(drifts) / sizeof(drifts[0]); i++)
+    {
+        run_drift(drifts[i], &err, &freq, &poll_s);
+        /* 本机快 drift 时需要 -drift 的补偿 */
+        CHECK(freq + drifts[i] > -10000 && freq + drifts[i] < 10000);
+        CHECK_EQ(poll_s, TIME_SYNC_POLL_MAX_S);
+        CHECK(err < 15);
+        printf("  drift %+4ld ppm: estimate %+7.2f ppm, poll %lu s, max error in 4th hour %.1f ms "
+               "(uncorrected %lu ms per poll)\n",
+               (long)drifts[i] / 1000, -freq / 1000.0, (unsigned long)poll_s, err,
+               (unsigned long)(labs(drifts[i]) * TIME_SYNC_POLL_MAX_S / 1000000));
+    }
+}
+
+/* 非对称路径: 误差为单程延时差的一半; 往返延时过大的样本丢弃 */
+static void test_asymmetric_delay(void)
+{
+    TimeSync_Stats_t st;
+
+    setup(0);
+    server.up_ms = 5;
+    server.down_ms = 45;
+    run_ms(POLL_MS + 100);
+    CHECK(TimeSync_IsSynced());
+    CHECK(clock_error() > -22 && clock_error() < -18);
+
+    setup(0);
+    server.up_ms = 300;
+    server.down_ms = 300;
+    run_ms(POLL_MS + 700);
+    CHECK(!TimeSync_IsSynced());
+    TimeSync_GetStats(&st);
+    CHECK_EQ(st.sntp_rejected, 1);
+    CHECK(st.last_delay_ms >= 599 && st.last_delay_ms <= 601);
+}
+
+/* 无效应答不采用, 从失败的交换开始计 TIME_SYNC_RETRY_S 后重试 */
+static void test_rejects(void)
+{
+    static const uint8_t modes[] = {SRV_KOD, SRV_ALARM, SRV_BAD_ORIG, SRV_STRANGER};
+    TimeSync_Stats_t st;
+    uint8_t i;
+
+    for (i = 0; i < sizeof(modes); i++)
+    {
+        setup(0);
+        server.mode = modes[i];
+        run_ms(POLL_MS + TIME_SYNC_SNTP_TIMEOUT_MS + 50);
+        CHECK(!TimeSync_IsSynced());
+        TimeSync_GetStats(&st);
+        CHECK_EQ(st.sntp_rejected, 1);
+        CHECK_EQ(st.sntp_timeouts, 1);
+    }
+
+    setup(0);
+    server.mode = SRV_SILENT;
+    run_ms(POLL_MS + TIME_SYNC_SNTP_TIMEOUT_MS + 50);
+    TimeSync_GetStats(&st);
+    CHECK_EQ(st.sntp_timeouts, 1);
+    CHECK_EQ(st.sntp_rejected, 0);
+    server.mode = SRV_OK;
+    run_ms(TIME_SYNC_RETRY_S * 1000 - TIME_SYNC_SNTP_TIMEOUT_MS - 200);
+    CHECK(!TimeSync_IsSynced());
+    run_ms(300);
+    CHECK(TimeSync_IsSynced());
+    CHECK_EQ(server.requests, 2);
+}
+
+/*
+ * 没有以太网时用网络时间; 已同步后秒级误差以内的网络时间不采用;
+ * SNTP 接管后小于 TIME_SYNC_STEP_MS 的偏差渐进调整
+ */
+static void test_modem(void)
+{
+    TimeSync_Stats_t st;
+
+    setup(0);
+    net_up = 0;
+    run_ms(1000);
+    CHECK(TimeSync_ModemDue());
+    CHECK(!TimeSync_ModemDue());
+    TimeSync_FeedModem((int64_t)true_ms() - 400, TimeSync_MonotonicMs());
+    CHECK(TimeSync_IsSynced());
+    CHECK(clock_error() > -402 && clock_error() < -398);
+    TimeSync_GetStats(&st);
+    CHECK_EQ(st.source, TIME_SRC_MODEM);
+    CHECK_EQ(st.modem_samples, 1);
+
+    TimeSync_FeedModem((int64_t)true_ms() + 1000, TimeSync_MonotonicMs());
+    TimeSync_GetStats(&st);
+    CHECK_EQ(st.modem_samples, 1);
+    CHECK_EQ(st.steps, 1);
+
+    /* 已同步后按 TIME_SYNC_MODEM_AFTER_S 查询 */
+    run_ms(TIME_SYNC_MODEM_RETRY_S * 1000);
+    CHECK(!TimeSync_ModemDue());
+    run_ms(TIME_SYNC_MODEM_AFTER_S * 1000);
+    CHECK(TimeSync_ModemDue());
+
+    /* SNTP 可用后优先, 不再查询网络时间 */
+    net_up = 1;
+    run_ms(POLL_MS);
+    TimeSync_GetStats(&st);
+    CHECK_EQ(st.source, TIME_SRC_SNTP);
+    CHECK_EQ(st.steps, 1);
+    CHECK_EQ(st.slews, 1);
+    CHECK(st.last_offset_ms >= 398 && st.last_offset_ms <= 402);
+    run_ms(TIME_SYNC_MODEM_AFTER_S * 1000 / 2);
+    CHECK(clock_error() > -3 && clock_error() < 3);
+    CHECK(!TimeSync_ModemDue());
+}
+
+/* 基准 ---------------------------------------------------------------------*/
+
+static void test_bench(void)
+{
+    static const int64_t at[] = {0, 1792281600LL, 4102444800LL, 253402300799LL};
+    TimeSync_DateTime_t dt;
+    volatile int64_t sink = 0;
+    unsigned long long t0, t1;
+    uint32_t n, i;
+
+    printf("  epoch->calendar:");
+    for (i = 0; i < sizeof(at) / sizeof(at[0]); i++)
+    {
+        t0 = test_now_ns();
+        for (n = 0; n < BENCH_ROUNDS; n++)
+        {
+            TimeSync_EpochToCalendar(at[i] + n, &dt);
+            sink += dt.day;
+        }
+        t1 = test_now_ns();
+        printf(" %u %.1f ns%s", dt.year, (double)(t1 - t0) / BENCH_ROUNDS, i + 1 < 4 ? "," : "\n");
+    }
+
+    TimeSync_EpochToCalendar(at[1], &dt);
+    t0 = test_now_ns();
+    for (n = 0; n < BENCH_ROUNDS; n++)
+    {
+        dt.second = (uint8_t)(n % 60);
+        sink += TimeSync_CalendarToEpoch(&dt);
+    }
+    t1 = test_now_ns();
+    printf("  calendar->epoch %.1f ns", (double)(t1 - t0) / BENCH_ROUNDS);
+
+    setup(50000);
+    run_ms(POLL_MS + 50);
+    t0 = test_now_ns();
+    for (n = 0; n < BENCH_ROUNDS; n++)
+        sink += TimeSync_MonoToUnixMs(n);
+    t1 = test_now_ns();
+    printf(", mono->unix %.1f ns\n", (double)(t1 - t0) / BENCH_ROUNDS);
+    CHECK(sink != 0);
+}
+
+int main(void)
+{
+    TEST_RUN(test_calendar);
+    TEST_RUN(test_ntp_era);
+    TEST_RUN(test_monotonic_wrap);
+    TEST_RUN(test_first_sync);
+    TEST_RUN(test_slew);
+    TEST_RUN(test_drift);
+    TEST_RUN(test_asymmetric_delay);
+    TEST_RUN(test_rejects);
+    TEST_RUN(test_modem);
+    TEST_RUN(test_bench);
+    return test_summary("time_sync");
+}
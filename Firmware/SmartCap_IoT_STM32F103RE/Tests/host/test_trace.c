@@ -0,0 +1,226 @@
+/**
+  ******************************************************************************
+  * @file    test_trace.c
+  * @brief   Scheduler Timeline Recorder: Mask, Ring Order and Per-Event Cost
+  ******************************************************************************
+  * @description
+  * DWT->CYCCNT 由测试设置, 每个事件的时间戳即记录时的值。
+  * 最后的基准测试报告 Trace_Record 在主机上的耗时 (记录和被掩码过滤两种情况)。
+  ******************************************************************************
+  */
+
+#include "test.h"
+#include "../../User/trace/trace.c"
+
+static UBaseType_t queue_numbers[TRACE_QUEUES_MAX + 1];
+
+void vQueueSetQueueNumber(QueueHandle_t queue, UBaseType_t number)
+{
+    *(UBaseType_t *)queue = number;
+}
+
+static void reset(uint8_t mask)
+{
+    memset(trace_buf, 0, sizeof(trace_buf));
+    trace_head = 0;
+    trace_mask = mask;
+    DWT->CYCCNT = 0;
+    stub_primask = 0;
+}
+
+/* 读出缓冲中全部事件, 返回事件数 */
+static int read_all(Trace_Event_t *events, int max)
+{
+    uint16_t cursor = 0;
+    int n = 0;
+
+    while (n < max && Trace_Get(&cursor, &events[n]))
+        n++;
+    CHECK_EQ(cursor, n);
+    return n;
+}
+
+/* 测试 ---------------------------------------------------------------------*/
+
+static void test_record(void)
+{
+    Trace_Event_t ev[4];
+
+    reset(0xFF);
+    CHECK_EQ(read_all(ev, 4), 0);
+
+    DWT->CYCCNT = 100;
+    Trace_Record(TRACE_EV_TASK_IN, 3, 0);
+    DWT->CYCCNT = 250;
+    Trace_Record(TRACE_EV_QUEUE_SEND, 1, 7);
+    DWT->CYCCNT = 400;
+    TRACE_ISR_ENTER(TRACE_ISR_RS485);
+
+    CHECK_EQ(read_all(ev, 4), 3);
+    CHECK_EQ(ev[0].cycles, 100);
+    CHECK_EQ(ev[0].type, TRACE_EV_TASK_IN);
+    CHECK_EQ(ev[0].id, 3);
+    CHECK_EQ(ev[1].cycles, 250);
+    CHECK_EQ(ev[1].type, TRACE_EV_QUEUE_SEND);
+    CHECK_EQ(ev[1].arg, 7);
+    CHECK_EQ(ev[2].type, TRACE_EV_ISR_ENTER);
+    CHECK_EQ(ev[2].id, TRACE_ISR_RS485);
+
+    /* 关中断写入后恢复调用前的 PRIMASK */
+    stub_primask = 1;
+    Trace_Record(TRACE_EV_TASK_IN, 1, 0);
+    CHECK_EQ(stub_primask, 1);
+    stub_primask = 0;
+    Trace_Record(TRACE_EV_TASK_IN, 1, 0);
+    CHECK_EQ(stub_primask, 0);
+}
+
+static void test_mask(void)
+{
+    Trace_Event_t ev[8];
+    int n;
+
+    reset(TRACE_MASK_DEFAULT);
+    CHECK_EQ(Trace_GetMask(), TRACE_MASK_DEFAULT);
+    Trace_Record(TRACE_EV_TASK_IN, 1, 0);
+    Trace_Record(TRACE_EV_QUEUE_RX_BLOCK, 0, 0);
+    Trace_Record(TRACE_EV_QUEUE_TX_BLOCK, 2, 0);
+    TRACE_ISR_ENTER(TRACE_ISR_CONSOLE);     // 默认不记录调试串口
+    TRACE_ISR_EXIT(TRACE_ISR_CONSOLE);
+    TRACE_ISR_ENTER(TRACE_ISR_MODEM);
+    TRACE_ISR_EXIT(TRACE_ISR_MODEM);
+    TRACE_ISR_ENTER(TRACE_ISR_WIZ_TIM);
+    n = read_all(ev, 8);
+    CHECK_EQ(n, 5);
+    CHECK_EQ(ev[3].type, TRACE_EV_ISR_ENTER);
+    CHECK_EQ(ev[3].id, TRACE_ISR_MODEM);
+    CHECK_EQ(ev[4].type, TRACE_EV_ISR_EXIT);
+
+    /* 只记录 TIM2 中断 */
+    reset(0);
+    Trace_SetMask(TRACE_MASK_ISR(TRACE_ISR_WIZ_TIM));
+    Trace_Record(TRACE_EV_TASK_IN, 1, 0);
+    Trace_Record(TRACE_EV_QUEUE_SEND, 1, 0);
+    TRACE_ISR_ENTER(TRACE_ISR_RS485);
+    TRACE_ISR_ENTER(TRACE_ISR_WIZ_TIM);
+    n = read_all(ev, 8);
+    CHECK_EQ(n, 1);
+    CHECK_EQ(ev[0].id, TRACE_ISR_WIZ_TIM);
+
+    /* 掩码 0 停止记录 */
+    Trace_SetMask(0);
+    Trace_Record(TRACE_EV_TASK_IN, 1, 0);
+    TRACE_ISR_ENTER(TRACE_ISR_WIZ_TIM);
+    CHECK_EQ(read_all(ev, 8), 1);
+}
+
+/* 缓冲满后覆盖最旧的, 读出的始终是最近 TRACE_BUF_EVENTS 个且按时间顺序 */
+static void test_ring_overwrite(void)
+{
+    static Trace_Event_t ev[TRACE_BUF_EVENTS + 1];
+    const uint32_t total = TRACE_BUF_EVENTS * 3 + 17;
+    uint32_t i;
+    int n;
+
+    reset(0xFF);
+    for (i = 0; i < total; i++)
+    {
+        DWT->CYCCNT = i * 10;
+        Trace_Record(TRACE_EV_QUEUE_SEND, 1, (uint16_t)i);
+    }
+    n = read_all(ev, TRACE_BUF_EVENTS + 1);
+    CHECK_EQ(n, TRACE_BUF_EVENTS);
+    for (i = 0; i < (uint32_t)n; i++)
+    {
+        CHECK_EQ(ev[i].arg, total - TRACE_BUF_EVENTS + i);
+        CHECK_EQ(ev[i].cycles, (total - TRACE_BUF_EVENTS + i) * 10);
+    }
+
+    /* 刚好写满 */
+    reset(0xFF);
+    for (i = 0; i < TRACE_BUF_EVENTS; i++)
+        Trace_Record(TRACE_EV_QUEUE_SEND, 1, (uint16_t)i);
+    n = read_all(ev, TRACE_BUF_EVENTS + 1);
+    CHECK_EQ(n, TRACE_BUF_EVENTS);
+    CHECK_EQ(ev[0].arg, 0);
+    CHECK_EQ(ev[n - 1].arg, TRACE_BUF_EVENTS - 1);
+}
+
+static void test_names(void)
+{
+    uint8_t i;
+
+    memset(queue_numbers, 0, sizeof(queue_numbers));
+    trace_queue_count = 0;
+
+    Trace_NameQueue(NULL, "null");
+    CHECK_EQ(trace_queue_count, 0);
+    Trace_NameQueue(&queue_numbers[0], "rs485Tx");
+    Trace_NameQueue(&queue_numbers[1], "modemRx");
+    CHECK_EQ(queue_numbers[0], 1);
+    CHECK_EQ(queue_numbers[1], 2);
+    CHECK(strcmp(Trace_QueueName(1), "rs485Tx") == 0);
+    CHECK(strcmp(Trace_QueueName(2), "modemRx") == 0);
+    CHECK(Trace_QueueName(0) == NULL);   // 信号量/互斥量和未命名的队列
+    CHECK(Trace_QueueName(3) == NULL);
+
+    /* 超过 TRACE_QUEUES_MAX 的不编号 */
+    for (i = 2; i <= TRACE_QUEUES_MAX; i++)
+        Trace_NameQueue(&queue_numbers[i], "q");
+    CHECK_EQ(trace_queue_count, TRACE_QUEUES_MAX);
+    CHECK_EQ(queue_numbers[TRACE_QUEUES_MAX - 1], TRACE_QUEUES_MAX);
+    CHECK_EQ(queue_numbers[TRACE_QUEUES_MAX], 0);
+
+    CHECK(strcmp(Trace_IsrName(TRACE_ISR_RS485), "USART1 RS485") == 0);
+    CHECK(strcmp(Trace_IsrName(TRACE_ISR_WIZ_TIM), "TIM2 wiz") == 0);
+    CHECK(strcmp(Trace_IsrName(TRACE_ISR_COUNT), "?") == 0);
+}
+
+/* Trace_Bench 清空缓冲并恢复掩码和 PRIMASK */
+static void test_target_bench(void)
+{
+    Trace_Event_t ev;
+    uint16_t cursor = 0;
+
+    reset(TRACE_MASK_TASK);
+    Trace_Record(TRACE_EV_TASK_IN, 1, 0);
+    Trace_Bench();
+    CHECK_EQ(Trace_GetMask(), TRACE_MASK_TASK);
+    CHECK_EQ(stub_primask, 0);
+    CHECK_EQ(Trace_Get(&cursor, &ev), 0);
+}
+
+/* 基准测试 -----------------------------------------------------------------*/
+
+static void test_bench(void)
+{
+    const int iters = 10000000;
+    unsigned long long t0, t_rec, t_skip;
+    int i;
+
+    reset(TRACE_MASK_DEFAULT);
+    t0 = test_now_ns();
+    for (i = 0; i < iters; i++)
+        Trace_Record(TRACE_EV_TASK_IN, (uint8_t)i, 0);
+    t_rec = test_now_ns() - t0;
+
+    t0 = test_now_ns();
+    for (i = 0; i < iters; i++)
+        TRACE_ISR_ENTER(TRACE_ISR_CONSOLE);
+    t_skip = test_now_ns() - t0;
+
+    CHECK_EQ(trace_head, (uint32_t)iters);
+    printf("  Trace_Record %4.1f ns/event, masked out %4.1f ns/event\n",
+           (double)t_rec / iters, (double)t_skip / iters);
+}
+
+int main(void)
+{
+    TEST_RUN(test_record);
+    TEST_RUN(test_mask);
+    TEST_RUN(test_ring_overwrite);
+    TEST_RUN(test_names);
+    TEST_RUN(test_target_bench);
+    TEST_RUN(test_bench);
+    return test_summary("trace");
+}
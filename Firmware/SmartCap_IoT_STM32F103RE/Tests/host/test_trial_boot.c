@@ -0,0 +1,289 @@
+/**
+  ******************************************************************************
+  * @file    test_trial_boot.c
+  * @brief   Trial Boot: Watchdog Fed While the Cellular Module Initializes
+  ******************************************************************************
+  * @description
+  * 引导程序启动新固件试运行前打开 IWDG, 应用必须在它超时前开始喂狗, 并在 60 秒时
+  * 所有任务都按时报到, OTA 才会确认新固件 (ota.c OTA_TrialCheck)。
+  * RG200U_Init 在接收任务中执行, 每次等待经 osDelay 让出 CPU; stub_delay_hook 在
+  * 等待期间按毫秒模拟其它任务: 透传任务报到, 默认任务每 500ms 调用 TaskWdg_Poll。
+  * IWDG 超时按 LSI 上限 60kHz 计算 (最短)。模块的 AT 应答由 HAL_UART_Transmit 模拟。
+  ******************************************************************************
+  */
+
+#include "test.h"
+#include "../../User/user_main/task_wdg.c"
+#include "../../User/user_main/rg200u.c"
+
+volatile uint32_t Metrics_Slots[METRICS_SLOT_COUNT];
+
+#define IWDG_TIMEOUT_MS         (4095UL * 256 / 60)     /* BOOT_IWDG_RELOAD, 预分频 256, LSI 60kHz */
+#define DEFAULT_POLL_MS         500                     /* 默认任务循环周期 (MONITOR_PERIOD_MS) */
+#define OTA_CONFIRM_MS          60000                   /* OTA_CONFIRM_S */
+
+typedef enum {
+    MODEM_SILENT = 0,       /* 不应答 (未上电或损坏) */
+    MODEM_NO_SERVICE,       /* 应答 AT 但一直未注册, 服务器无应答 */
+    MODEM_READY             /* 注册 4G, 连接成功 */
+} Modem_t;
+
+static Modem_t modem;
+static uint32_t last_feed;
+static uint32_t max_gap;                /* 两次喂狗之间的最长间隔 */
+static uint32_t expired_at;             /* IWDG 超时复位的时间, 0 表示没有 */
+static uint32_t not_alive;              /* 默认任务看到有任务超时的次数 */
+static uint8_t alive_at_confirm;        /* 60 秒时 TaskWdg_AllAlive */
+static uint32_t at_commands;
+
+void Metrics_Observe(Metrics_Hist_t hist, uint32_t value)
+{
+    (void)hist;
+    (void)value;
+}
+
+uint8_t Uplink_Cell_Deliver(const uint8_t *data, uint16_t len)
+{
+    (void)data;
+    (void)len;
+    return 0;
+}
+
+uint8_t RS485_AcquireBus(uint32_t timeout_ms)
+{
+    (void)timeout_ms;
+    return 1;
+}
+
+void RS485_SendBuffer(uint8_t *buf, uint16_t len)
+{
+    (void)buf;
+    (void)len;
+}
+
+void RS485_ReleaseBus(void)
+{
+}
+
+void MX_UART5_Init(void)
+{
+}
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *port, uint16_t pin, GPIO_PinState state)
+{
+    (void)port;
+    (void)pin;
+    (void)state;
+}
+
+uint32_t HAL_GetTick(void)
+{
+    return stub_tick;
+}
+
+HAL_StatusTypeDef HAL_UART_Receive_IT(UART_HandleTypeDef *huart, uint8_t *data, uint16_t size)
+{
+    (void)huart;
+    (void)data;
+    (void)size;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_DeInit(UART_HandleTypeDef *huart)
+{
+    (void)huart;
+    return HAL_OK;
+}
+
+/* 模块应答经接收中断写入环形缓冲 */
+static void modem_reply(const char *str)
+{
+    while (*str)
+    {
+        uart_rx_byte = (uint8_t)*str++;
+        RG200U_UART_RxCallback();
+    }
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit(UART_HandleTypeDef *huart, uint8_t *data, uint16_t size, uint32_t timeout)
+{
+    char cmd[160];
+
+    (void)timeout;
+    if (huart != &huart5 || modem == MODEM_SILENT)
+        return HAL_OK;
+    if (size >= sizeof(cmd))
+        size = sizeof(cmd) - 1;
+    memcpy(cmd, data, size);
+    cmd[size] = '\0';
+    at_commands++;
+
+    if (strncmp(cmd, "AT+C5GREG?", 10) == 0)
+        modem_reply("\r\n+C5GREG: 0,2\r\n\r\nOK\r\n");
+    else if (strncmp(cmd, "AT+CEREG?", 9) == 0)
+        modem_reply(modem == MODEM_READY ? "\r\n+CEREG: 0,1\r\n\r\nOK\r\n" : "\r\n+CEREG: 0,2\r\n\r\nOK\r\n");
+    else if (strncmp(cmd, "AT+COPS?", 8) == 0)
+        modem_reply("\r\n+COPS: 0,0,\"TEST\",7\r\n\r\nOK\r\n");
+    else if (strncmp(cmd, "AT+CGPADDR", 10) == 0)
+        modem_reply("\r\n+CGPADDR: 1,\"10.1.2.3\",\"fd00::3\"\r\n\r\nOK\r\n");
+    else if (strncmp(cmd, "AT+QIOPEN", 9) == 0)
+        modem_reply(modem == MODEM_READY ? "\r\nOK\r\n\r\n+QIOPEN: 0,0\r\n" : "\r\nOK\r\n");
+    else
+        modem_reply("\r\nOK\r\n");
+    return HAL_OK;
+}
+
+/* 接收任务等待期间, 按毫秒运行其它任务和 IWDG */
+static void other_tasks(uint32_t ms)
+{
+    uint32_t end = stub_tick;
+    uint32_t t;
+
+    for (t = end - ms + 1; t <= end; t++)
+    {
+        stub_tick = t;
+        TaskWdg_CheckIn(TASK_WDG_RS485_RX);
+        TaskWdg_CheckIn(TASK_WDG_RS485_TX);
+        TaskWdg_CheckIn(TASK_WDG_RG200U_TX);
+
+        if ((t % DEFAULT_POLL_MS) == 0)
+        {
+            if (!TaskWdg_AllAlive())
+                not_alive++;
+            if (t == OTA_CONFIRM_MS)
+                alive_at_confirm = TaskWdg_AllAlive();
+            TaskWdg_Poll();
+            if (IWDG->KR == TASK_WDG_RELOAD_KEY)
+            {
+                IWDG->KR = 0;
+                last_feed = t;
+            }
+        }
+        if ((t - last_feed) > max_gap)
+            max_gap = t - last_feed;
+        if (expired_at == 0 && (t - last_feed) > IWDG_TIMEOUT_MS)
+            expired_at = t;
+    }
+    stub_tick = end;
+}
+
+/* 引导程序刚跳转到新固件: IWDG 已启动, 各任务尚未报到 */
+static void trial_boot(Modem_t m)
+{
+    memset((void *)wdg_tick, 0, sizeof(wdg_tick));
+    wdg_stalled = 0;
+    rx_write_index = 0;
+    rx_read_index = 0;
+    tcp_state = TCP_STATE_DISCONNECTED;
+    modem = m;
+    last_feed = 0;
+    max_gap = 0;
+    expired_at = 0;
+    not_alive = 0;
+    alive_at_confirm = 0;
+    at_commands = 0;
+    IWDG->KR = 0;
+    stub_tick = 0;
+    stub_delay_hook = other_tasks;
+}
+
+/* 初始化完成后的接收任务主循环 */
+static void rx_loop_until(uint32_t tick)
+{
+    uint8_t data;
+
+    while (stub_tick < tick)
+    {
+        TaskWdg_CheckIn(TASK_WDG_RG200U_RX);
+        RG200U_ProcessTCPMessage();
+        while (RG200U_ReceiveByte(&data))
+            ;
+        osDelay(1);
+    }
+}
+
+/* 测试 ---------------------------------------------------------------------*/
+
+/* 模块不应答: 初始化约 30 秒, 比 IWDG 超时长, 期间不断喂狗 */
+static void test_silent_modem(void)
+{
+    trial_boot(MODEM_SILENT);
+    RG200U_Init();
+    CHECK(stub_tick > IWDG_TIMEOUT_MS);
+    CHECK_EQ(tcp_state, TCP_STATE_ERROR);
+    CHECK_EQ(at_commands, 0);
+
+    rx_loop_until(OTA_CONFIRM_MS + 1000);
+    CHECK_EQ(expired_at, 0);
+    CHECK(max_gap <= DEFAULT_POLL_MS);
+    CHECK_EQ(not_alive, 0);
+    CHECK_EQ(alive_at_confirm, 1);
+}
+
+/* 较长的初始化 (约 95 秒): 一直未注册 (20 次查询), 等待 IP, QIOPEN 等满 30 秒 */
+static void test_no_service(void)
+{
+    trial_boot(MODEM_NO_SERVICE);
+    RG200U_Init();
+    CHECK(stub_tick > 90000);
+    CHECK_EQ(tcp_state, TCP_STATE_ERROR);
+    CHECK(at_commands >= 45);
+    CHECK_EQ(expired_at, 0);
+    CHECK(max_gap <= DEFAULT_POLL_MS);
+    CHECK_EQ(not_alive, 0);
+    CHECK_EQ(alive_at_confirm, 1);
+}
+
+/* 正常启动: 初始化结束时已连接, 60 秒时可以确认 */
+static void test_ready_modem(void)
+{
+    trial_boot(MODEM_READY);
+    RG200U_Init();
+    CHECK_EQ(tcp_state, TCP_STATE_CONNECTED);
+    CHECK(stub_tick > 25000);
+
+    rx_loop_until(OTA_CONFIRM_MS + 1000);
+    CHECK_EQ(expired_at, 0);
+    CHECK_EQ(not_alive, 0);
+    CHECK_EQ(alive_at_confirm, 1);
+}
+
+/* 接收任务真的卡住时仍然复位: 超过报到期限后停止喂狗, IWDG 随后超时 */
+static void test_stalled_rx_task(void)
+{
+    const uint32_t limit = wdg_limit_ms[TASK_WDG_RG200U_RX];
+
+    trial_boot(MODEM_READY);
+    RG200U_Init();
+    CHECK_EQ(tcp_state, TCP_STATE_CONNECTED);
+
+    /* 之后只等待不报到 */
+    TaskWdg_CheckIn(TASK_WDG_RG200U_RX);
+    while (stub_tick < OTA_CONFIRM_MS * 3 && expired_at == 0)
+        osDelay(10);
+    CHECK(expired_at != 0);
+    CHECK(expired_at > wdg_tick[TASK_WDG_RG200U_RX] + limit);
+    CHECK(expired_at <= wdg_tick[TASK_WDG_RG200U_RX] + limit + DEFAULT_POLL_MS + IWDG_TIMEOUT_MS + 1);
+    CHECK_EQ(wdg_stalled, 1);
+    CHECK_EQ(TaskWdg_AllAlive(), 0);
+}
+
+/* 应用总是启动看门狗, 配置与引导程序相同 */
+static void test_start(void)
+{
+    memset(IWDG, 0, sizeof(*IWDG));
+    TaskWdg_Start();
+    CHECK_EQ(IWDG->PR, 6);
+    CHECK_EQ(IWDG->RLR, 4095);
+    CHECK_EQ(IWDG->KR, TASK_WDG_RELOAD_KEY);
+}
+
+int main(void)
+{
+    TEST_RUN(test_start);
+    TEST_RUN(test_silent_modem);
+    TEST_RUN(test_no_service);
+    TEST_RUN(test_ready_modem);
+    TEST_RUN(test_stalled_rx_task);
+    return test_summary("trial_boot");
+}
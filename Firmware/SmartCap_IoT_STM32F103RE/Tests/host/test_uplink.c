@@ -0,0 +1,616 @@
+/**
+  ******************************************************************************
+  * @file    test_uplink.c
+  * @brief   Uplink Failover: No Loss or Reordering, W5500 Lock
+  ******************************************************************************
+  * @description
+  * 真实的路由器 (uplink.c)、以太网链路 (uplink_eth.c)、发送队列 (wiz_txq.c)、链路监控
+  * (wiz_supervisor.c) 和 ioLibrary 运行在模拟 W5500 (wiz_sim.h) 上, 蜂窝链路用同步送达的
+  * transport 代替。每毫秒:
+  * - RS485 以 RS485_RATE 字节/ms 写入 Queue_RS485_To_RG200U (256 字节, 满时丢弃, 不算上行丢失)
+  * - 上行发送任务按 UserTask_RG200U_TxHandler 的方式取数据并经路由器发送
+  * - 默认任务每 500ms 调用 Uplink_Eth_Monitor
+  * 服务器收到的字节流 (以太网对端确认的数据和蜂窝送达的数据按时间合并) 与 RS485 写入的
+  * 字节流比较: 不允许丢失和乱序, 只允许链路断开时重发最多 UPLINK_RECLAIM_SIZE 字节。
+  ******************************************************************************
+  */
+
+#include "test.h"
+#include "wiz_sim.h"
+#include "../../User/ioLibrary_Driver/Ethernet/wizchip_conf.c"
+#include "../../User/ioLibrary_Driver/Ethernet/W5500/w5500.c"
+#include "../../User/ioLibrary_Driver/Ethernet/socket.c"
+#include "../../User/wiz_interface/wiz_txq.c"
+#include "../../User/wiz_interface/wiz_supervisor.c"
+#include "../../User/user_main/uplink.c"
+#include "../../User/user_main/uplink_eth.c"
+
+volatile uint32_t Metrics_Slots[METRICS_SLOT_COUNT];
+
+#define RS485_RATE              8       /* 字节/ms, 约 80kbit/s */
+#define UPQ_SIZE                256     /* Queue_RS485_To_RG200U */
+#define CHUNK_SIZE              64      /* UPLINK_CHUNK_SIZE */
+#define MONITOR_PERIOD_MS       500
+#define ETH_PEER_RATE           40      /* 以太网对端确认速率, 字节/ms */
+#define SRC_MAX                 (1024 * 1024)
+#define SRV_MAX                 (2 * 1024 * 1024)
+
+#define TASK_TX                 1
+#define TASK_DEFAULT            2
+
+/* 服务器 ---------------------------------------------------------------------*/
+
+static uint8_t src[SRC_MAX];            /* RS485 写入的字节流 */
+static uint32_t src_len;
+static uint8_t srv[SRV_MAX];            /* 服务器收到的字节流 */
+static uint32_t srv_len;
+
+static void server_put(const uint8_t *data, uint32_t len)
+{
+    if (srv_len + len > SRV_MAX)
+        len = SRV_MAX - srv_len;
+    memcpy(&srv[srv_len], data, len);
+    srv_len += len;
+}
+
+/**
+ * 按 src 检查服务器字节流: 顺序一致, 允许从不早于已收到位置 UPLINK_RECLAIM_SIZE 处重新开始 (重发),
+ * 不允许跳过。返回服务器收到的 src 前缀长度, 出错时为 -1。
+ */
+static int32_t server_check(uint32_t *dup, uint32_t *restarts)
+{
+    uint32_t i = 0, cur = 0, pos = 0;
+    uint32_t a, lo, m, k;
+    uint8_t found;
+
+    *dup = 0;
+    *restarts = 0;
+    while (i < srv_len)
+    {
+        if (cur < src_len && srv[i] == src[cur])
+        {
+            i++;
+            cur++;
+            if (cur > pos)
+                pos = cur;
+            else
+                (*dup)++;
+            continue;
+        }
+
+        /* 重发: 在已收到位置之前的窗口内找后续 16 字节一致的起点 */
+        m = srv_len - i < 16 ? srv_len - i : 16;
+        lo = pos > UPLINK_RECLAIM_SIZE ? pos - UPLINK_RECLAIM_SIZE : 0;
+        found = 0;
+        for (a = pos + 1; a > lo && !found; a--)
+        {
+            for (k = 0; k < m && a - 1 + k < src_len && srv[i + k] == src[a - 1 + k]; k++)
+                ;
+            found = (k == m);
+        }
+        if (!found)
+            return -1;
+        cur = a;
+        (*restarts)++;
+    }
+    return (int32_t)pos;
+}
+
+/* RS485 和队列 ---------------------------------------------------------------*/
+
+static uint8_t upq[UPQ_SIZE];
+static uint16_t upq_head, upq_tail, upq_count;
+static uint32_t upq_drops;
+static uint8_t producing;
+static uint32_t lfsr;
+
+static void rs485_produce(void)
+{
+    uint8_t i, b;
+
+    if (!producing)
+        return;
+    for (i = 0; i < RS485_RATE; i++)
+    {
+        lfsr = lfsr * 1103515245UL + 12345UL;
+        b = (uint8_t)(lfsr >> 16);
+        if (upq_count == UPQ_SIZE || src_len == SRC_MAX)
+        {
+            upq_drops++;
+            continue;
+        }
+        src[src_len++] = b;
+        upq[upq_head] = b;
+        upq_head = (uint16_t)((upq_head + 1) % UPQ_SIZE);
+        upq_count++;
+    }
+}
+
+/* 蜂窝链路 -------------------------------------------------------------------*/
+
+static uint8_t cell_up;
+static uint32_t cell_bytes;
+
+static uint8_t Cell_Ready(void)
+{
+    return cell_up;
+}
+
+static int32_t Cell_Send(const uint8_t *data, uint16_t len)
+{
+    if (!cell_up)
+        return -1;
+    server_put(data, len);
+    cell_bytes += len;
+    return len;
+}
+
+static int32_t Cell_Recv(uint8_t *buf, uint16_t len)
+{
+    (void)buf;
+    (void)len;
+    return 0;
+}
+
+const Uplink_Transport_t Uplink_CellTransport = {
+    "CELL",
+    Cell_Ready,
+    Cell_Send,
+    Cell_Recv,
+    NULL,
+    NULL,
+    NULL,
+};
+
+/* 平台和网络接口 -------------------------------------------------------------*/
+
+static uint8_t sup_blocked;             /* 默认任务在等待上行发送任务释放 W5500 锁 */
+static uint32_t sup_deferred;
+static uint32_t lock_errors;            /* 阻塞等待时锁被占用, 或释放了不属于自己的锁 */
+static uint32_t eth_skipped;            /* 以太网 poll/recv 因锁被占用而跳过 */
+static uint8_t nested;
+
+static void default_task(void);
+
+uint8_t wizchip_acquire(uint32_t timeout_ms)
+{
+    if (wiz_sim.lock_owner != 0)
+    {
+        /* 单线程模拟: 只有 try-lock 会遇到锁被占用, 阻塞等待由任务切换模拟 (preempt) 避开 */
+        if (timeout_ms != 0)
+            lock_errors++;
+        return 0;
+    }
+    wiz_sim.lock_owner = wiz_sim.task;
+    return 1;
+}
+
+void wizchip_release(void)
+{
+    if (wiz_sim.lock_owner != wiz_sim.task)
+        lock_errors++;
+    wiz_sim.lock_owner = 0;
+
+    /* 等待锁的默认任务优先级更高, 释放后立即运行 */
+    if (sup_blocked && wiz_sim.task == TASK_TX && !nested)
+    {
+        sup_blocked = 0;
+        nested = 1;
+        wiz_sim.task = TASK_DEFAULT;
+        default_task();
+        wiz_sim.task = TASK_TX;
+        nested = 0;
+    }
+}
+
+void wizchip_reset(void)
+{
+    wiz_sim_power_reset();
+}
+
+int8_t wizchip_initialize(void)
+{
+    return 0;
+}
+
+void print_network_information(void)
+{
+}
+
+/* DHCP 立即得到地址 */
+void network_init(uint8_t *ethernet_buff, wiz_NetInfo *conf_info)
+{
+    wiz_NetInfo info = *conf_info;
+    const uint8_t ip[4] = {192, 168, 1, 50};
+    const uint8_t gw[4] = {192, 168, 1, 1};
+    const uint8_t sn[4] = {255, 255, 255, 0};
+
+    (void)ethernet_buff;
+    memcpy(info.ip, ip, 4);
+    memcpy(info.gw, gw, 4);
+    memcpy(info.sn, sn, 4);
+    wizchip_setnetinfo(&info);
+}
+
+uint32_t wiz_timer_get_ms(void)
+{
+    return stub_tick;
+}
+
+void wiz_dhcp_stop(void)
+{
+}
+
+uint8_t wiz_dhcp_has_address(void)
+{
+    return 1;
+}
+
+uint8_t wiz_dhcp_take_changed(void)
+{
+    return 0;
+}
+
+int8_t wiz_sockbuf_apply(void)
+{
+    return 0;
+}
+
+void wiz_sockbuf_set_role(uint8_t sn, wiz_sock_role_t role)
+{
+    (void)sn;
+    (void)role;
+}
+
+void wiz_sockbuf_poll(void)
+{
+}
+
+void wiz_dns_init(const uint8_t *mac)
+{
+    (void)mac;
+}
+
+void wiz_dns_poll(void)
+{
+}
+
+uint32_t HAL_GetUIDw0(void)
+{
+    return 0x12345678;
+}
+
+uint32_t HAL_GetUIDw1(void)
+{
+    return 0;
+}
+
+uint32_t HAL_GetUIDw2(void)
+{
+    return 0;
+}
+
+static void wiz_sim_udp_out(uint8_t sn, const uint8_t ip[4], uint16_t port, const uint8_t *data, uint16_t len)
+{
+    (void)sn;
+    (void)ip;
+    (void)port;
+    (void)data;
+    (void)len;
+}
+
+/* 任务 -----------------------------------------------------------------------*/
+
+static uint8_t tx_chunk[CHUNK_SIZE];
+static uint16_t tx_len, tx_off;
+static uint8_t preempt;                 /* 在 SPI 帧之间切换任务 */
+static uint32_t frame_count;
+
+static void default_task(void)
+{
+    Uplink_Eth_Monitor();
+}
+
+/* UserTask_RG200U_TxHandler 的一次循环 (不含 osDelay) */
+static void tx_task(void)
+{
+    uint8_t rx[CHUNK_SIZE];
+
+    Uplink_Router_Poll();
+    Uplink_Router_Recv(rx, sizeof(rx));
+
+    if (tx_off == tx_len)
+    {
+        tx_len = 0;
+        tx_off = 0;
+        if (Uplink_Router_GetActive() == UPLINK_NONE)
+            return;
+        while (tx_len < sizeof(tx_chunk) && upq_count > 0)
+        {
+            tx_chunk[tx_len++] = upq[upq_tail];
+            upq_tail = (uint16_t)((upq_tail + 1) % UPQ_SIZE);
+            upq_count--;
+        }
+    }
+    if (tx_off < tx_len)
+        tx_off += (uint16_t)Uplink_Router_Send(&tx_chunk[tx_off], tx_len - tx_off);
+}
+
+/**
+ * 每隔几个 SPI 帧切换一次任务:
+ * - 上行发送任务的帧之间: 默认任务要运行, 锁被占用时阻塞到释放
+ * - 默认任务的帧之间: 上行发送任务运行 poll/recv, 锁被占用时必须跳过且不访问芯片
+ */
+static void preempt_on_frame(void)
+{
+    uint32_t frames;
+
+    if (!preempt || nested || (++frame_count % 3) != 0)
+        return;
+
+    nested = 1;
+    if (wiz_sim.task == TASK_TX)
+    {
+        if (wiz_sim.lock_owner == TASK_TX)
+        {
+            sup_blocked = 1;
+            sup_deferred++;
+        }
+        else
+        {
+            wiz_sim.task = TASK_DEFAULT;
+            default_task();
+            wiz_sim.task = TASK_TX;
+        }
+    }
+    else if (wiz_sim.lock_owner == TASK_DEFAULT)
+    {
+        uint8_t rx[16];
+
+        frames = wiz_sim.frames;
+        wiz_sim.task = TASK_TX;
+        Uplink_EthTransport.poll();
+        Uplink_EthTransport.recv(rx, sizeof(rx));
+        wiz_sim.task = TASK_DEFAULT;
+        CHECK_EQ(wiz_sim.frames, frames);
+        eth_skipped++;
+    }
+    nested = 0;
+}
+
+/* 运行 ms 毫秒 */
+static void run(uint32_t ms)
+{
+    uint8_t buf[256];
+    uint32_t n;
+
+    while (ms--)
+    {
+        stub_tick++;
+        wiz_sim_tick(1);
+        rs485_produce();
+
+        wiz_sim.task = TASK_TX;
+        tx_task();
+        if ((stub_tick % MONITOR_PERIOD_MS) == 0)
+        {
+            wiz_sim.task = TASK_DEFAULT;
+            default_task();
+        }
+        wiz_sim.task = 0;
+
+        while ((n = wiz_sim_take(ETH_UPLINK_SOCK, buf, sizeof(buf))) > 0)
+            server_put(buf, n);
+    }
+}
+
+/* 运行直到条件成立或超过 limit 毫秒, 返回经过的时间 */
+#define RUN_UNTIL(cond, limit) ({ \
+    uint32_t _t = 0; \
+    while (!(cond) && _t < (limit)) { run(1); _t++; } \
+    _t; })
+
+static void setup(void)
+{
+    wiz_sim_init();
+    wiz_sim.need_lock = 1;
+    wiz_sim.on_frame = preempt_on_frame;
+    wiz_sim.sock[ETH_UPLINK_SOCK].rate = ETH_PEER_RATE;
+
+    stub_tick = 0;
+    stub_kernel_running = 1;
+    src_len = 0;
+    srv_len = 0;
+    lfsr = 1;
+    upq_head = upq_tail = upq_count = 0;
+    upq_drops = 0;
+    producing = 1;
+    cell_up = 1;
+    cell_bytes = 0;
+    tx_len = tx_off = 0;
+    preempt = 0;
+    frame_count = 0;
+    sup_blocked = 0;
+    sup_deferred = 0;
+    lock_errors = 0;
+    eth_skipped = 0;
+    nested = 0;
+
+    /* 被测模块的静态状态回到上电值 */
+    memset(txq, 0, sizeof(txq));
+    sup_state = WIZ_SUP_STATE_INIT;
+    active = UPLINK_NONE;
+    memset(up_since, 0, sizeof(up_since));
+    memset(down_since, 0, sizeof(down_since));
+    outage_start = 0;
+    last_poll_tick = 0;
+    memset(&stats, 0, sizeof(stats));
+    reclaim_len = reclaim_off = 0;
+    eth_started = 0;
+    conn_state = ETH_CONN_IDLE;
+    reset_pending = 0;
+
+    /* 初始化在 eth_started 置位前完成, 上行发送任务不会访问芯片, 不需要锁 */
+    wiz_sim.task = TASK_DEFAULT;
+    Uplink_Eth_Init();
+    wiz_sim.task = 0;
+    wiz_sim.unlocked_frames = 0;
+}
+
+/* 以太网先连上, 再打开蜂窝链路 (否则先接管的蜂窝要 30 秒后才切回以太网) */
+static void start_on_eth(void)
+{
+    uint32_t t;
+
+    cell_up = 0;
+    t = RUN_UNTIL(Uplink_Router_GetActive() == UPLINK_ETH, 5000);
+    CHECK(t < 100);
+    cell_up = 1;
+}
+
+/* 停止写入, 等待全部送达后检查字节流 */
+static void drain_and_check(uint32_t max_dup)
+{
+    uint32_t dup, restarts;
+    int32_t pos;
+
+    producing = 0;
+    RUN_UNTIL(upq_count == 0 && tx_off == tx_len && reclaim_off == reclaim_len &&
+              (wiz_txq_idle(ETH_UPLINK_SOCK) || Uplink_Router_GetActive() != UPLINK_ETH), 20000);
+    run(100);
+
+    pos = server_check(&dup, &restarts);
+    CHECK_EQ(pos, src_len);
+    CHECK(dup <= max_dup);
+    CHECK(src_len > 0);
+}
+
+/* 测试 ---------------------------------------------------------------------*/
+
+/* 网线拔出: 以太网上未确认的数据取回后经蜂窝重发, 1 秒后切换; 网线恢复 30 秒后切回 */
+static void test_link_drop_failover(void)
+{
+    uint32_t t, dup, restarts;
+    int32_t pos;
+
+    setup();
+    start_on_eth();
+    run(5000);
+    CHECK(wiz_sim.sock[ETH_UPLINK_SOCK].acked_bytes > 30000);
+
+    /* 对端确认较慢, 断线时芯片中有未确认的数据 */
+    wiz_sim.sock[ETH_UPLINK_SOCK].rate = 4;
+    run(300);
+    wiz_sim.link = 0;
+    t = RUN_UNTIL(Uplink_Router_GetActive() == UPLINK_CELL, 10000);
+    CHECK(t >= UPLINK_FAILOVER_MS);
+    CHECK(t <= MONITOR_PERIOD_MS + UPLINK_FAILOVER_MS + 2);
+    CHECK(stats.last_failover_ms >= UPLINK_FAILOVER_MS);
+    CHECK(stats.last_failover_ms <= UPLINK_FAILOVER_MS + 1);
+    CHECK(stats.reclaimed_bytes > 0);
+    CHECK(stats.reclaimed_bytes < UPLINK_RECLAIM_SIZE);
+    run(5000);
+    CHECK(cell_bytes > 5000 * RS485_RATE * 9 / 10);
+
+    /* 网线恢复, 以太网稳定 30 秒后切回 */
+    wiz_sim.sock[ETH_UPLINK_SOCK].rate = ETH_PEER_RATE;
+    wiz_sim.link = 1;
+    t = RUN_UNTIL(Uplink_Router_GetActive() == UPLINK_ETH, 60000);
+    CHECK(t >= UPLINK_FAILBACK_MS);
+    CHECK(t <= MONITOR_PERIOD_MS + ETH_RETRY_MS + UPLINK_FAILBACK_MS + 10);
+    CHECK_EQ(stats.failovers, 1);
+    CHECK_EQ(stats.failbacks, 1);
+    run(5000);
+
+    drain_and_check(UPLINK_RECLAIM_SIZE);
+    pos = server_check(&dup, &restarts);
+    CHECK(restarts >= 1);
+    /* RS485 队列只在对端变慢和切换期间溢出 (RS485 侧丢弃, 已进入上行的数据不丢) */
+    CHECK(upq_drops < (300 + MONITOR_PERIOD_MS + UPLINK_FAILOVER_MS) * RS485_RATE);
+    CHECK(src_len >= 45000 * RS485_RATE);
+    printf("  link drop: failover %lu ms, reclaimed %lu bytes, %lu duplicated, %ld bytes delivered\n",
+           (unsigned long)stats.last_failover_ms, (unsigned long)stats.reclaimed_bytes,
+           (unsigned long)dup, (long)pos);
+}
+
+/* 对端不再确认: 重传超时关闭 socket, 未确认的数据经蜂窝送达 */
+static void test_peer_timeout(void)
+{
+    setup();
+    start_on_eth();
+    run(2000);
+    wiz_sim.sock[ETH_UPLINK_SOCK].dead = 1;
+    RUN_UNTIL(Uplink_Router_GetActive() == UPLINK_CELL, 10000);
+    CHECK_EQ(Uplink_Router_GetActive(), UPLINK_CELL);
+    CHECK(stats.reclaimed_bytes > 0);
+    wiz_sim.sock[ETH_UPLINK_SOCK].dead = 0;
+    run(3000);
+    drain_and_check(UPLINK_RECLAIM_SIZE);
+}
+
+/* 没有蜂窝网络: 对端复位连接后, 未确认的数据在新的以太网连接上重发 */
+static void test_reconnect_resume(void)
+{
+    uint32_t t;
+
+    setup();
+    start_on_eth();
+    cell_up = 0;
+    run(2000);
+
+    /* 队列中留有未确认的数据, 不再有新数据时断开 */
+    wiz_sim.sock[ETH_UPLINK_SOCK].rate = 1;
+    producing = 0;
+    RUN_UNTIL(upq_count == 0 && tx_off == tx_len, 1000);
+    CHECK(txq_used(&txq[ETH_UPLINK_SOCK]) > 0);
+    wiz_sim_tcp_abort(ETH_UPLINK_SOCK);
+    wiz_sim.sock[ETH_UPLINK_SOCK].rate = ETH_PEER_RATE;
+
+    t = RUN_UNTIL(conn_state == ETH_CONN_ESTABLISHED && wiz_txq_idle(ETH_UPLINK_SOCK), 10000);
+    CHECK(t >= ETH_RETRY_MS);
+    CHECK(t < ETH_RETRY_MS + 1000);
+    CHECK_EQ(stats.reclaimed_bytes, 0);
+    CHECK_EQ(cell_bytes, 0);
+    CHECK_EQ(wiz_sim.sock[ETH_UPLINK_SOCK].opens, 2);
+
+    producing = 1;
+    run(2000);
+    drain_and_check(UPLINK_RECLAIM_SIZE);
+}
+
+/*
+ * 任务在 SPI 帧之间切换, 网线反复拔插:
+ * 以太网和链路监控的每个 SPI 帧都在 W5500 锁内, 监控持锁时以太网跳过且不访问芯片
+ */
+static void test_spi_lock(void)
+{
+    uint8_t i;
+
+    setup();
+    preempt = 1;
+    start_on_eth();
+    for (i = 0; i < 4; i++)
+    {
+        run(3000);
+        wiz_sim.link = 0;
+        run(2000);
+        wiz_sim.link = 1;
+    }
+    run(35000);
+    CHECK_EQ(Uplink_Router_GetActive(), UPLINK_ETH);
+    CHECK_EQ(wiz_sim.unlocked_frames, 0);
+    CHECK_EQ(lock_errors, 0);
+    CHECK(sup_deferred > 0);
+    CHECK(eth_skipped > 0);
+    CHECK_EQ(sup_blocked, 0);
+    drain_and_check(4 * UPLINK_RECLAIM_SIZE);
+}
+
+int main(void)
+{
+    TEST_RUN(test_link_drop_failover);
+    TEST_RUN(test_peer_timeout);
+    TEST_RUN(test_reconnect_resume);
+    TEST_RUN(test_spi_lock);
+    return test_summary("uplink");
+}
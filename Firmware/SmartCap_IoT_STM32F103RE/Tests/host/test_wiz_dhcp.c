@@ -0,0 +1,650 @@
+/**
+  ******************************************************************************
+  * @file    test_wiz_dhcp.c
+  * @brief   DHCP Client Against a Simulated Server: Time-to-IP, Lease Persistence, Renewal
+  ******************************************************************************
+  * @description
+  * 真实的 DHCP 客户端 (wiz_dhcp.c)、UDP 非阻塞发送 (wiz_txq.c) 和 ioLibrary 运行在
+  * 模拟 W5500 (wiz_sim.h) 上。本文件模拟:
+  * - DHCP 服务器: 收到 DISCOVER/REQUEST 后经 SERVER_DELAY_MS 应答 OFFER/ACK/NAK,
+  *   请求的地址不是分配给本机的地址时 NAK; silent 时不应答
+  * - ARP 冲突检测: 探测报文发往 conflict_ip 时有应答 (SENDOK), 否则 ARP_TIMEOUT_MS 后 TIMEOUT
+  * - 租约 Flash 页 (wiz_lease_load/wiz_lease_save), 擦除状态为 0xFF
+  * - DHCP 任务: dhcp_process 返回的等待时间到期或收到信号时再次调用
+  * 冷启动 (DISCOVER) 和热启动 (INIT-REBOOT) 的获得地址耗时在测试中打印。
+  ******************************************************************************
+  */
+
+#include "test.h"
+#include "wiz_sim.h"
+#include "../../User/ioLibrary_Driver/Ethernet/wizchip_conf.c"
+#include "../../User/ioLibrary_Driver/Ethernet/W5500/w5500.c"
+#include "../../User/ioLibrary_Driver/Ethernet/socket.c"
+#include "../../User/wiz_interface/wiz_txq.c"
+#include "../../User/wiz_interface/wiz_dhcp.c"
+
+#define SERVER_DELAY_MS         5
+#define ARP_TIMEOUT_MS          1800    /* RTR 200ms x (RCR 8 + 1) */
+#define TCP_SOCK                1
+
+static const uint8_t server_ip[4] = {192, 168, 1, 1};
+static const uint8_t peer_ip[4] = {192, 168, 1, 10};
+
+static const wiz_NetInfo fallback = {
+    .mac = {0x00, 0x08, 0xDC, 0x12, 0x34, 0x56},
+    .ip = {192, 168, 1, 50},
+    .sn = {255, 255, 255, 0},
+    .gw = {192, 168, 1, 1},
+    .dns = {192, 168, 1, 1},
+    .dhcp = NETINFO_DHCP,
+};
+
+/* 模拟服务器 */
+static struct
+{
+    uint8_t pool_ip[4];         /* 分配给本机的地址 */
+    uint32_t lease_s;
+    uint8_t silent;
+    uint32_t discovers;
+    uint32_t requests;
+    uint32_t unicast_requests;  /* 续租时直接发给服务器的 REQUEST */
+    uint8_t last_ciaddr[4];
+
+    uint8_t reply[WIZ_DHCP_MSG_MIN];
+    uint16_t reply_len;
+    uint32_t reply_at;          /* 0 表示没有待发出的应答 */
+} server;
+
+static uint8_t conflict_ip[4];
+static uint32_t probe_timeout_at;
+static uint32_t probes;
+
+/* 租约 Flash 页 */
+static uint8_t lease_flash[64];
+static uint32_t flash_writes;
+
+/* DHCP 任务 */
+static uint8_t msg_buf[WIZ_DHCP_MSG_MAX];
+static uint32_t next_process;
+static uint32_t signals_seen;
+
+/* 平台接口 -----------------------------------------------------------------*/
+
+uint32_t wiz_timer_get_ms(void)
+{
+    return stub_tick;
+}
+
+void wiz_lease_load(void *buf, uint16_t len)
+{
+    memcpy(buf, lease_flash, len);
+}
+
+int8_t wiz_lease_save(const void *buf, uint16_t len)
+{
+    memset(lease_flash, 0xFF, sizeof(lease_flash));
+    memcpy(lease_flash, buf, len);
+    flash_writes++;
+    return 0;
+}
+
+/* 模拟服务器 ---------------------------------------------------------------*/
+
+/* 在客户端报文中查找选项, 返回值的位置 */
+static const uint8_t *find_opt(const uint8_t *m, uint16_t len, uint8_t code)
+{
+    uint16_t i = WIZ_DHCP_OPT_OFFSET;
+
+    while (i + 1 < len && m[i] != DHCP_OPT_END)
+    {
+        if (m[i] == DHCP_OPT_PAD)
+        {
+            i++;
+            continue;
+        }
+        if (m[i] == code)
+            return &m[i + 2];
+        i += 2 + m[i + 1];
+    }
+    return NULL;
+}
+
+static void server_reply(const uint8_t *req, uint8_t type, const uint8_t *yiaddr)
+{
+    uint8_t *m = server.reply;
+    uint16_t k = WIZ_DHCP_OPT_OFFSET;
+
+    memset(m, 0, sizeof(server.reply));
+    m[0] = 2;
+    m[1] = 1;
+    m[2] = 6;
+    memcpy(&m[4], &req[4], 4);
+    if (yiaddr != NULL)
+        memcpy(&m[16], yiaddr, 4);
+    memcpy(&m[28], &req[28], 6);
+    put_be32(&m[236], WIZ_DHCP_MAGIC_COOKIE);
+
+    m[k++] = DHCP_OPT_MSG_TYPE;
+    m[k++] = 1;
+    m[k++] = type;
+    m[k++] = DHCP_OPT_SERVER_ID;
+    m[k++] = 4;
+    memcpy(&m[k], server_ip, 4);
+    k += 4;
+    if (type != DHCP_MSG_NAK)
+    {
+        m[k++] = DHCP_OPT_LEASE;
+        m[k++] = 4;
+        put_be32(&m[k], server.lease_s);
+        k += 4;
+        m[k++] = DHCP_OPT_SUBNET;
+        m[k++] = 4;
+        m[k++] = 255;
+        m[k++] = 255;
+        m[k++] = 255;
+        m[k++] = 0;
+        m[k++] = DHCP_OPT_ROUTER;
+        m[k++] = 4;
+        memcpy(&m[k], server_ip, 4);
+        k += 4;
+        m[k++] = DHCP_OPT_DNS;
+        m[k++] = 4;
+        memcpy(&m[k], server_ip, 4);
+        k += 4;
+    }
+    m[k++] = DHCP_OPT_END;
+    server.reply_len = WIZ_DHCP_MSG_MIN;
+    server.reply_at = stub_tick + SERVER_DELAY_MS;
+}
+
+static void server_rx(const uint8_t ip[4], const uint8_t *m, uint16_t len)
+{
+    const uint8_t *type = find_opt(m, len, DHCP_OPT_MSG_TYPE);
+    const uint8_t *req_ip;
+
+    if (type == NULL || server.silent)
+        return;
+    switch (*type)
+    {
+    case DHCP_MSG_DISCOVER:
+        server.discovers++;
+        server_reply(m, DHCP_MSG_OFFER, server.pool_ip);
+        break;
+
+    case DHCP_MSG_REQUEST:
+        server.requests++;
+        if (memcmp(ip, server_ip, 4) == 0)
+            server.unicast_requests++;
+        memcpy(server.last_ciaddr, &m[12], 4);
+        req_ip = find_opt(m, len, DHCP_OPT_REQ_IP);
+        if (req_ip == NULL)
+            req_ip = &m[12];
+        if (memcmp(req_ip, server.pool_ip, 4) == 0)
+            server_reply(m, DHCP_MSG_ACK, server.pool_ip);
+        else
+            server_reply(m, DHCP_MSG_NAK, NULL);
+        break;
+
+    case DHCP_MSG_DECLINE:
+        /* 被占用的地址不再分配, 换下一个 */
+        server.pool_ip[3]++;
+        break;
+
+    default:
+        break;
+    }
+}
+
+static void wiz_sim_udp_out(uint8_t sn, const uint8_t ip[4], uint16_t port, const uint8_t *data, uint16_t len)
+{
+    if (sn != WIZ_DHCP_SOCK)
+        return;
+    if (port == WIZ_DHCP_PROBE_PORT)
+    {
+        /* ARP: 地址没有被占用时无应答, 重试超时后报告 TIMEOUT */
+        probes++;
+        if (memcmp(ip, conflict_ip, 4) != 0)
+        {
+            wiz_sim.sock[sn].reg[0x02] &= (uint8_t)~Sn_IR_SENDOK;
+            probe_timeout_at = stub_tick + ARP_TIMEOUT_MS;
+        }
+        return;
+    }
+    if (port == WIZ_DHCP_SERVER_PORT)
+        server_rx(ip, data, len);
+}
+
+/* 仿真 ---------------------------------------------------------------------*/
+
+static void reset_client(void)
+{
+    dhcp_task_handle = NULL;
+    dhcp_cmd = DHCP_CMD_NONE;
+    cmd_seq = cmd_done_seq = 0;
+    dhcp_state = WIZ_DHCP_STATE_STOPPED;
+    memset(&dhcp_lease, 0, sizeof(dhcp_lease));
+    memset(&dhcp_offer, 0, sizeof(dhcp_offer));
+    dhcp_addr_ok = 0;
+    dhcp_fallback_active = 0;
+    dhcp_bound_once = 0;
+    dhcp_change_seq = dhcp_change_seen = 0;
+    dhcp_sent_ms = 0;
+    memset(&dhcp_stats, 0, sizeof(dhcp_stats));
+    wiz_udp_send_reset(WIZ_DHCP_SOCK);
+}
+
+/* 上电: 芯片复位, 客户端状态清零, Flash 内容保留 */
+static void power_on(void)
+{
+    wiz_sim_init();
+    reset_client();
+    wizchip_setnetinfo((wiz_NetInfo *)&fallback);
+    server.reply_at = 0;
+    probe_timeout_at = 0;
+    probes = 0;
+    flash_writes = 0;
+    next_process = stub_tick;
+    signals_seen = stub_signals;
+}
+
+static void reset_server(uint8_t last)
+{
+    memset(&server, 0, sizeof(server));
+    server.pool_ip[0] = 192;
+    server.pool_ip[1] = 168;
+    server.pool_ip[2] = 1;
+    server.pool_ip[3] = last;
+    server.lease_s = 3600;
+    memset(conflict_ip, 0, sizeof(conflict_ip));
+}
+
+static void run_ms(uint32_t ms)
+{
+    uint32_t wait;
+
+    while (ms--)
+    {
+        stub_tick++;
+        wiz_sim_tick(1);
+        if (server.reply_at != 0 && time_reached(stub_tick, server.reply_at))
+        {
+            server.reply_at = 0;
+            wiz_sim_udp_in(WIZ_DHCP_SOCK, server_ip, WIZ_DHCP_SERVER_PORT, server.reply, server.reply_len);
+        }
+        if (probe_timeout_at != 0 && time_reached(stub_tick, probe_timeout_at))
+        {
+            probe_timeout_at = 0;
+            wiz_sim_irq(WIZ_DHCP_SOCK, Sn_IR_TIMEOUT);
+        }
+
+        /* osSignalWait(WIZ_DHCP_SIGNAL, wait): 超时或收到命令时返回 */
+        if (stub_signals != signals_seen || time_reached(stub_tick, next_process))
+        {
+            signals_seen = stub_signals;
+            wait = dhcp_process();
+            next_process = stub_tick + (wait == osWaitForever ? 0x7FFFFFFFUL : wait);
+        }
+    }
+}
+
+/* 运行直到有地址, 返回耗时 */
+static uint32_t run_until_address(uint32_t limit_ms)
+{
+    uint32_t t = 0;
+
+    while (!wiz_dhcp_has_address() && t < limit_ms)
+    {
+        run_ms(1);
+        t++;
+    }
+    return t;
+}
+
+static void run_until_bound(uint32_t limit_ms)
+{
+    while (wiz_dhcp_get_state() != WIZ_DHCP_STATE_BOUND && limit_ms--)
+        run_ms(1);
+}
+
+static uint8_t sipr_is(const uint8_t ip[4])
+{
+    uint8_t cur[4];
+
+    getSIPR(cur);
+    return memcmp(cur, ip, 4) == 0;
+}
+
+/* 测试 ---------------------------------------------------------------------*/
+
+static uint32_t cold_ms, warm_ms;
+
+/* Flash 擦除状态: DISCOVER -> OFFER -> REQUEST -> ACK -> ARP 检测 -> 保存租约 */
+static void test_cold_boot(void)
+{
+    wiz_dhcp_lease_t saved;
+    wiz_dhcp_stats_t st;
+
+    memset(lease_flash, 0xFF, sizeof(lease_flash));
+    reset_server(100);
+    power_on();
+    wiz_dhcp_start(msg_buf, &fallback);
+    CHECK(sipr_is(fallback.ip));
+    run_ms(1);
+    CHECK(sipr_is(ip_zero));
+    CHECK_EQ(wiz_dhcp_get_state(), WIZ_DHCP_STATE_SELECTING);
+
+    cold_ms = run_until_address(30000);
+    CHECK_EQ(wiz_dhcp_get_state(), WIZ_DHCP_STATE_BOUND);
+    CHECK(sipr_is(server.pool_ip));
+    CHECK_EQ(server.discovers, 1);
+    CHECK_EQ(server.requests, 1);
+    CHECK_EQ(probes, 1);
+    wiz_dhcp_get_stats(&st);
+    CHECK_EQ(st.discovers, 1);
+    CHECK_EQ(st.acks, 1);
+    CHECK_EQ(st.cold_bind_ms, cold_ms);
+    CHECK(st.cold_bind_ms >= 2 * SERVER_DELAY_MS + ARP_TIMEOUT_MS);
+    CHECK(st.cold_bind_ms <= 2 * SERVER_DELAY_MS + ARP_TIMEOUT_MS + 3 * WIZ_DHCP_EVENT_POLL_MS);
+
+    /* 租约写入 Flash 一次, 可以读回 */
+    CHECK_EQ(flash_writes, 1);
+    CHECK_EQ(st.lease_saves, 1);
+    CHECK(dhcp_load_lease(&saved));
+    CHECK_MEM(saved.ip, server.pool_ip, 4);
+    CHECK_MEM(saved.server, server_ip, 4);
+    CHECK_EQ(saved.lease_s, 3600);
+    CHECK_EQ(saved.t1_s, 1800);
+    CHECK_EQ(saved.t2_s, 3150);
+}
+
+/* 再次上电: Flash 中的租约用 INIT-REBOOT 确认, 不 DISCOVER, 不检测冲突, 不重写 Flash */
+static void test_warm_boot(void)
+{
+    wiz_dhcp_stats_t st;
+
+    reset_server(100);
+    power_on();
+    wiz_dhcp_start(msg_buf, &fallback);
+    run_ms(1);
+    CHECK_EQ(wiz_dhcp_get_state(), WIZ_DHCP_STATE_REBOOTING);
+
+    warm_ms = run_until_address(30000);
+    CHECK_EQ(wiz_dhcp_get_state(), WIZ_DHCP_STATE_BOUND);
+    CHECK(sipr_is(server.pool_ip));
+    CHECK_EQ(server.discovers, 0);
+    CHECK_EQ(server.requests, 1);
+    CHECK_EQ(probes, 0);
+    CHECK_EQ(flash_writes, 0);
+    wiz_dhcp_get_stats(&st);
+    CHECK_EQ(st.warm_bind_ms, warm_ms);
+    CHECK_EQ(st.cold_bind_ms, 0);
+    CHECK(warm_ms * 10 < cold_ms);
+
+    printf("  time to IP: cold boot %lu ms (DISCOVER + ARP probe), warm boot %lu ms (INIT-REBOOT)\n",
+           (unsigned long)cold_ms, (unsigned long)warm_ms);
+}
+
+/* 换了网络: INIT-REBOOT 被 NAK, 立即改为 DISCOVER, 新租约覆盖 Flash */
+static void test_warm_boot_nak(void)
+{
+    wiz_dhcp_lease_t saved;
+    wiz_dhcp_stats_t st;
+
+    reset_server(77);
+    power_on();
+    wiz_dhcp_start(msg_buf, &fallback);
+    run_until_address(30000);
+    CHECK(sipr_is(server.pool_ip));
+    wiz_dhcp_get_stats(&st);
+    CHECK_EQ(st.naks, 1);
+    CHECK_EQ(server.discovers, 1);
+    CHECK_EQ(server.requests, 2);
+    CHECK_EQ(flash_writes, 1);
+    CHECK(dhcp_load_lease(&saved));
+    CHECK_EQ(saved.ip[3], 77);
+
+    /* Flash 中其它 MAC 的租约不使用 */
+    lease_flash[offsetof(struct wiz_dhcp_record, mac)] ^= 0x01;
+    reset_server(77);
+    power_on();
+    wiz_dhcp_start(msg_buf, &fallback);
+    run_ms(1);
+    CHECK_EQ(wiz_dhcp_get_state(), WIZ_DHCP_STATE_SELECTING);
+
+    /* CRC 错误的租约不使用 */
+    memset(lease_flash, 0xFF, sizeof(lease_flash));
+    reset_server(77);
+    power_on();
+    wiz_dhcp_start(msg_buf, &fallback);
+    run_until_address(30000);
+    lease_flash[offsetof(struct wiz_dhcp_record, lease)] ^= 0x80;
+    power_on();
+    wiz_dhcp_start(msg_buf, &fallback);
+    run_ms(1);
+    CHECK_EQ(wiz_dhcp_get_state(), WIZ_DHCP_STATE_SELECTING);
+}
+
+/*
+ * T1 时在后台单播续租: 地址和寄存器不变, 已建立的 TCP 连接不受影响,
+ * 参数相同的 ACK 不写 Flash
+ */
+static void test_renew(void)
+{
+    wiz_dhcp_stats_t st;
+    wiz_dhcp_lease_t lease;
+
+    memset(lease_flash, 0xFF, sizeof(lease_flash));
+    reset_server(100);
+    server.lease_s = 120;
+    power_on();
+    wiz_dhcp_start(msg_buf, &fallback);
+    run_until_address(30000);
+    CHECK(wiz_dhcp_take_changed() == 0);
+    wiz_dhcp_get_lease(&lease);
+    CHECK_EQ(lease.t1_s, 60);
+    CHECK_EQ(lease.t2_s, 105);
+
+    CHECK_EQ(socket(TCP_SOCK, Sn_MR_TCP, 50001, SF_IO_NONBLOCK), TCP_SOCK);
+    connect(TCP_SOCK, (uint8_t *)peer_ip, 502);
+    run_ms(10);
+    CHECK_EQ(getSn_SR(TCP_SOCK), SOCK_ESTABLISHED);
+
+    run_ms(59 * 1000);
+    CHECK_EQ(wiz_dhcp_get_state(), WIZ_DHCP_STATE_BOUND);
+    CHECK_EQ(server.requests, 1);
+    run_ms(2 * 1000);
+    CHECK_EQ(wiz_dhcp_get_state(), WIZ_DHCP_STATE_BOUND);
+    CHECK_EQ(server.requests, 2);
+    CHECK_EQ(server.unicast_requests, 1);
+    CHECK_MEM(server.last_ciaddr, server.pool_ip, 4);
+
+    wiz_dhcp_get_stats(&st);
+    CHECK_EQ(st.renewals, 1);
+    CHECK_EQ(flash_writes, 1);
+    CHECK(wiz_dhcp_has_address());
+    CHECK(wiz_dhcp_take_changed() == 0);
+    CHECK(sipr_is(server.pool_ip));
+    CHECK_EQ(getSn_SR(TCP_SOCK), SOCK_ESTABLISHED);
+    CHECK_EQ(wiz_sim.sock[TCP_SOCK].opens, 1);
+
+    /* 租期从最近一次 ACK 重新计算, 之后每个 T1 续租一次 */
+    run_ms(61 * 1000);
+    wiz_dhcp_get_stats(&st);
+    CHECK_EQ(st.renewals, 2);
+    CHECK_EQ(flash_writes, 1);
+}
+
+/*
+ * 服务器消失: T1 单播续租, T2 广播重绑定, 租约到期后停止使用该地址并重新 DISCOVER;
+ * 启动已超过 WIZ_DHCP_FALLBACK_MS, 立即退回静态地址
+ */
+static void test_rebind_and_expire(void)
+{
+    wiz_dhcp_stats_t st;
+
+    memset(lease_flash, 0xFF, sizeof(lease_flash));
+    reset_server(100);
+    server.lease_s = 120;
+    power_on();
+    wiz_dhcp_start(msg_buf, &fallback);
+    run_until_address(30000);
+    server.silent = 1;
+
+    run_ms(61 * 1000);
+    CHECK_EQ(wiz_dhcp_get_state(), WIZ_DHCP_STATE_RENEWING);
+    CHECK(sipr_is(server.pool_ip));
+    run_ms(45 * 1000);
+    CHECK_EQ(wiz_dhcp_get_state(), WIZ_DHCP_STATE_REBINDING);
+    CHECK(wiz_dhcp_has_address());
+    CHECK(wiz_dhcp_take_changed() == 0);
+    run_ms(15 * 1000);
+    CHECK_EQ(wiz_dhcp_get_state(), WIZ_DHCP_STATE_SELECTING);
+    CHECK(wiz_dhcp_take_changed() == 1);
+    CHECK(sipr_is(fallback.ip));
+    wiz_dhcp_get_stats(&st);
+    CHECK_EQ(st.expirations, 1);
+    CHECK_EQ(st.renewals, 0);
+    CHECK_EQ(st.fallbacks, 1);
+
+    /* 服务器恢复后重新获得地址 */
+    server.silent = 0;
+    run_until_bound(120000);
+    CHECK_EQ(wiz_dhcp_get_state(), WIZ_DHCP_STATE_BOUND);
+    CHECK(sipr_is(server.pool_ip));
+    CHECK(wiz_dhcp_take_changed() == 1);
+}
+
+/* 服务器一直不应答: DISCOVER 按 2/4/8/16s 退避, 20s 时退回静态地址, 服务器恢复后切换到租约 */
+static void test_fallback(void)
+{
+    wiz_dhcp_stats_t st;
+
+    memset(lease_flash, 0xFF, sizeof(lease_flash));
+    reset_server(100);
+    server.silent = 1;
+    power_on();
+    wiz_dhcp_start(msg_buf, &fallback);
+    run_ms(WIZ_DHCP_FALLBACK_MS - 10);
+    CHECK(!wiz_dhcp_has_address());
+    wiz_dhcp_get_stats(&st);
+    CHECK_EQ(st.discovers, 4);          /* 0, 2, 6, 14s */
+    run_ms(1000 + 10);                  /* 重传等待之间每秒检查一次 */
+    CHECK(wiz_dhcp_has_address());
+    CHECK(sipr_is(fallback.ip));
+    wiz_dhcp_get_stats(&st);
+    CHECK_EQ(st.fallbacks, 1);
+    CHECK(wiz_dhcp_take_changed() == 0);
+
+    server.silent = 0;
+    run_ms(15 * 1000);                  /* 下一次 DISCOVER 在 30s */
+    CHECK_EQ(wiz_dhcp_get_state(), WIZ_DHCP_STATE_BOUND);
+    CHECK(sipr_is(server.pool_ip));
+    CHECK(wiz_dhcp_take_changed() == 1);
+    CHECK_EQ(flash_writes, 1);
+}
+
+/* ARP 检测到冲突: DECLINE, 等待 10s 后重新 DISCOVER, 得到另一个地址 */
+static void test_conflict(void)
+{
+    wiz_dhcp_stats_t st;
+    uint32_t t;
+
+    memset(lease_flash, 0xFF, sizeof(lease_flash));
+    reset_server(100);
+    memcpy(conflict_ip, server.pool_ip, 4);
+    power_on();
+    wiz_dhcp_start(msg_buf, &fallback);
+    t = run_until_address(30000);
+    CHECK(sipr_is(server.pool_ip));
+    CHECK_EQ(server.pool_ip[3], 101);
+    CHECK_EQ(probes, 2);
+    CHECK(t >= WIZ_DHCP_DECLINE_WAIT_MS + ARP_TIMEOUT_MS);
+    wiz_dhcp_get_stats(&st);
+    CHECK_EQ(st.declines, 1);
+    CHECK_EQ(st.discovers, 2);
+    CHECK_EQ(flash_writes, 1);
+}
+
+/* 其它事务的应答和选项越界的报文不改变状态 */
+static void test_bad_replies(void)
+{
+    wiz_dhcp_stats_t st;
+    uint8_t m[WIZ_DHCP_MSG_MIN];
+
+    memset(lease_flash, 0xFF, sizeof(lease_flash));
+    reset_server(100);
+    server.silent = 1;
+    power_on();
+    wiz_dhcp_start(msg_buf, &fallback);
+    run_ms(10);
+    CHECK_EQ(wiz_dhcp_get_state(), WIZ_DHCP_STATE_SELECTING);
+
+    /* 构造一个本事务的 OFFER 作为模板 */
+    memset(m, 0, sizeof(m));
+    put_be32(&m[4], dhcp_xid);
+    memcpy(&m[28], fallback.mac, 6);
+    server_reply(m, DHCP_MSG_OFFER, server.pool_ip);
+    memcpy(m, server.reply, sizeof(m));
+    server.reply_at = 0;
+
+    m[4] ^= 0x01;                                           /* 其它 xid */
+    wiz_sim_udp_in(WIZ_DHCP_SOCK, server_ip, WIZ_DHCP_SERVER_PORT, m, sizeof(m));
+    m[4] ^= 0x01;
+    m[28] ^= 0x01;                                          /* 其它 MAC */
+    wiz_sim_udp_in(WIZ_DHCP_SOCK, server_ip, WIZ_DHCP_SERVER_PORT, m, sizeof(m));
+    m[28] ^= 0x01;
+    wiz_sim_udp_in(WIZ_DHCP_SOCK, server_ip, 6767, m, sizeof(m));       /* 其它端口 */
+    m[WIZ_DHCP_OPT_OFFSET + 4] = 200;                       /* option 54 长度越界 */
+    wiz_sim_udp_in(WIZ_DHCP_SOCK, server_ip, WIZ_DHCP_SERVER_PORT, m, sizeof(m));
+    m[WIZ_DHCP_OPT_OFFSET + 4] = 4;
+    m[236] = 0;                                             /* magic cookie 错误 */
+    wiz_sim_udp_in(WIZ_DHCP_SOCK, server_ip, WIZ_DHCP_SERVER_PORT, m, sizeof(m));
+    run_ms(WIZ_DHCP_EVENT_POLL_MS * 2);
+
+    CHECK_EQ(wiz_dhcp_get_state(), WIZ_DHCP_STATE_SELECTING);
+    wiz_dhcp_get_stats(&st);
+    CHECK_EQ(st.bad_replies, 2);
+    CHECK_EQ(st.requests, 0);
+
+    /* 正确的 OFFER 仍被接受 */
+    m[236] = 0x63;
+    wiz_sim_udp_in(WIZ_DHCP_SOCK, server_ip, WIZ_DHCP_SERVER_PORT, m, sizeof(m));
+    run_ms(WIZ_DHCP_EVENT_POLL_MS * 2);
+    CHECK_EQ(wiz_dhcp_get_state(), WIZ_DHCP_STATE_REQUESTING);
+}
+
+/* 停止: socket 关闭, 任务不再被唤醒, 之后的启动重新开始 */
+static void test_stop(void)
+{
+    reset_server(100);
+    power_on();
+    wiz_dhcp_start(msg_buf, &fallback);
+    run_until_address(30000);
+    wiz_dhcp_stop();
+    CHECK(!wiz_dhcp_has_address());
+    run_ms(10);
+    CHECK_EQ(wiz_dhcp_get_state(), WIZ_DHCP_STATE_STOPPED);
+    CHECK_EQ(getSn_SR(WIZ_DHCP_SOCK), SOCK_CLOSED);
+    CHECK(!wiz_dhcp_has_address());
+
+    /* 链路恢复: 沿用内存中的租约做 INIT-REBOOT */
+    wiz_dhcp_start(msg_buf, &fallback);
+    run_ms(1);
+    CHECK_EQ(wiz_dhcp_get_state(), WIZ_DHCP_STATE_REBOOTING);
+    run_until_address(30000);
+    CHECK_EQ(wiz_dhcp_get_state(), WIZ_DHCP_STATE_BOUND);
+}
+
+int main(void)
+{
+    TEST_RUN(test_cold_boot);
+    TEST_RUN(test_warm_boot);
+    TEST_RUN(test_warm_boot_nak);
+    TEST_RUN(test_renew);
+    TEST_RUN(test_rebind_and_expire);
+    TEST_RUN(test_fallback);
+    TEST_RUN(test_conflict);
+    TEST_RUN(test_bad_replies);
+    TEST_RUN(test_stop);
+    return test_summary("wiz_dhcp");
+}
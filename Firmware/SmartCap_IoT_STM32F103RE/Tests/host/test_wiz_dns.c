@@ -0,0 +1,839 @@
+/**
+  ******************************************************************************
+  * @file    test_wiz_dns.c
+  * @brief   DNS Resolver Against Simulated Servers: Pipelining, Cache Expiry, Parser Hardening
+  ******************************************************************************
+  * @description
+  * 真实的 resolver (wiz_dns.c)、UDP 非阻塞发送 (wiz_txq.c) 和 ioLibrary 运行在模拟 W5500 上:
+  * - 主/备两台模拟服务器, 按记录表用抓包格式的应答回复 (替换事务 ID), 可设置为不应答、
+  *   SERVFAIL 或截断; hold 时应答暂存, 由测试决定投递顺序
+  * - 网络任务每 POLL_MS 调用一次 wiz_dns_poll, 长时间空闲用 idle_s 直接推进时钟
+  * - 解析加固: 抓包应答的所有截断长度、逐字节变异和随机变异放在保护页之前解析,
+  *   越界读取会立即触发 SIGSEGV; 另有指针循环、前向指针等构造报文
+  * - 基准: 每种抓包应答的 dns_handle 耗时
+  ******************************************************************************
+  */
+
+#include "test.h"
+#include "wiz_sim.h"
+#include "../../User/ioLibrary_Driver/Ethernet/wizchip_conf.c"
+#include "../../User/ioLibrary_Driver/Ethernet/W5500/w5500.c"
+#include "../../User/ioLibrary_Driver/Ethernet/socket.c"
+#include "../../User/wiz_interface/wiz_txq.c"
+#include "../../User/wiz_interface/wiz_dns.c"
+#include <strings.h>
+#include <sys/mman.h>
+
+/* <unistd.h> 的 close 与 socket.h 冲突, 只声明需要的函数 */
+extern int getpagesize(void);
+
+#define POLL_MS                 10
+#define SERVER_DELAY_MS         15
+#define REPLY_QUEUE             8
+#define BENCH_ROUNDS            200000
+
+static const uint8_t primary_ip[4] = {192, 168, 1, 1};
+static const uint8_t backup_ip[4] = {114, 114, 114, 114};
+
+static const wiz_NetInfo netinfo = {
+    .mac = {0x00, 0x08, 0xDC, 0x12, 0x34, 0x56},
+    .ip = {192, 168, 1, 50},
+    .sn = {255, 255, 255, 0},
+    .gw = {192, 168, 1, 1},
+    .dns = {192, 168, 1, 1},
+    .dhcp = NETINFO_STATIC,
+};
+
+/* 抓包格式的应答 (事务 ID 为 0x1A2B, 投递时替换) ----------------------------*/
+
+/* example.com A: 93.184.216.34, TTL 3600 (45 字节) */
+static const uint8_t resp_example_a[] = {
+    0x1A, 0x2B, 0x81, 0x80, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00,
+    0x07, 0x65, 0x78, 0x61, 0x6D, 0x70, 0x6C, 0x65, 0x03, 0x63, 0x6F, 0x6D,
+    0x00, 0x00, 0x01, 0x00, 0x01, 0xC0, 0x0C, 0x00, 0x01, 0x00, 0x01, 0x00,
+    0x00, 0x0E, 0x10, 0x00, 0x04, 0x5D, 0xB8, 0xD8, 0x22,
+};
+
+/* www.github.com A: CNAME github.com (TTL 3600), 140.82.121.4 (TTL 60) (62 字节) */
+static const uint8_t resp_github_cname[] = {
+    0x1A, 0x2B, 0x81, 0x80, 0x00, 0x01, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00,
+    0x03, 0x77, 0x77, 0x77, 0x06, 0x67, 0x69, 0x74, 0x68, 0x75, 0x62, 0x03,
+    0x63, 0x6F, 0x6D, 0x00, 0x00, 0x01, 0x00, 0x01, 0xC0, 0x0C, 0x00, 0x05,
+    0x00, 0x01, 0x00, 0x00, 0x0E, 0x10, 0x00, 0x02, 0xC0, 0x10, 0xC0, 0x2C,
+    0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x3C, 0x00, 0x04, 0x8C, 0x52,
+    0x79, 0x04,
+};
+
+/* ipv6.google.com AAAA: CNAME ipv6.l.google.com, 2a00:1450:4001:82b::200e, TTL 300 (82 字节) */
+static const uint8_t resp_google_aaaa[] = {
+    0x1A, 0x2B, 0x81, 0x80, 0x00, 0x01, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00,
+    0x04, 0x69, 0x70, 0x76, 0x36, 0x06, 0x67, 0x6F, 0x6F, 0x67, 0x6C, 0x65,
+    0x03, 0x63, 0x6F, 0x6D, 0x00, 0x00, 0x1C, 0x00, 0x01, 0xC0, 0x0C, 0x00,
+    0x05, 0x00, 0x01, 0x00, 0x00, 0x01, 0x2C, 0x00, 0x09, 0x04, 0x69, 0x70,
+    0x76, 0x36, 0x01, 0x6C, 0xC0, 0x11, 0xC0, 0x2D, 0x00, 0x1C, 0x00, 0x01,
+    0x00, 0x00, 0x01, 0x2C, 0x00, 0x10, 0x2A, 0x00, 0x14, 0x50, 0x40, 0x01,
+    0x08, 0x2B, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x20, 0x0E,
+};
+
+/* nosuch.example.com A: NXDOMAIN, SOA TTL 3600 minimum 3600 (92 字节) */
+static const uint8_t resp_nxdomain[] = {
+    0x1A, 0x2B, 0x81, 0x83, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00,
+    0x06, 0x6E, 0x6F, 0x73, 0x75, 0x63, 0x68, 0x07, 0x65, 0x78, 0x61, 0x6D,
+    0x70, 0x6C, 0x65, 0x03, 0x63, 0x6F, 0x6D, 0x00, 0x00, 0x01, 0x00, 0x01,
+    0xC0, 0x13, 0x00, 0x06, 0x00, 0x01, 0x00, 0x00, 0x0E, 0x10, 0x00, 0x2C,
+    0x02, 0x6E, 0x73, 0x05, 0x69, 0x63, 0x61, 0x6E, 0x6E, 0x03, 0x6F, 0x72,
+    0x67, 0x00, 0x03, 0x6E, 0x6F, 0x63, 0x03, 0x64, 0x6E, 0x73, 0xC0, 0x33,
+    0x78, 0xA5, 0x08, 0x2F, 0x00, 0x00, 0x1C, 0x20, 0x00, 0x00, 0x0E, 0x10,
+    0x00, 0x12, 0x75, 0x00, 0x00, 0x00, 0x0E, 0x10,
+};
+
+/* sensor.lan AAAA: NOERROR/NODATA, SOA TTL 900 minimum 30 (77 字节) */
+static const uint8_t resp_nodata[] = {
+    0x1A, 0x2B, 0x81, 0x80, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00,
+    0x06, 0x73, 0x65, 0x6E, 0x73, 0x6F, 0x72, 0x03, 0x6C, 0x61, 0x6E, 0x00,
+    0x00, 0x1C, 0x00, 0x01, 0xC0, 0x13, 0x00, 0x06, 0x00, 0x01, 0x00, 0x00,
+    0x03, 0x84, 0x00, 0x25, 0x06, 0x72, 0x6F, 0x75, 0x74, 0x65, 0x72, 0xC0,
+    0x13, 0x05, 0x61, 0x64, 0x6D, 0x69, 0x6E, 0xC0, 0x13, 0x00, 0x00, 0x00,
+    0x01, 0x00, 0x00, 0x0E, 0x10, 0x00, 0x00, 0x02, 0x58, 0x00, 0x01, 0x51,
+    0x80, 0x00, 0x00, 0x00, 0x1E,
+};
+
+/* 模拟服务器 ---------------------------------------------------------------*/
+
+#define SRV_ANSWER      0
+#define SRV_SILENT      1
+#define SRV_SERVFAIL    2
+#define SRV_TRUNCATE    3
+
+struct record
+{
+    const char *name;
+    uint16_t type;
+    const uint8_t *resp;
+    uint16_t len;
+};
+
+static struct record records[] = {
+    {"example.com", WIZ_DNS_TYPE_A, resp_example_a, sizeof(resp_example_a)},
+    {"www.github.com", WIZ_DNS_TYPE_A, resp_github_cname, sizeof(resp_github_cname)},
+    {"ipv6.google.com", WIZ_DNS_TYPE_AAAA, resp_google_aaaa, sizeof(resp_google_aaaa)},
+    {"nosuch.example.com", WIZ_DNS_TYPE_A, resp_nxdomain, sizeof(resp_nxdomain)},
+    {"sensor.lan", WIZ_DNS_TYPE_AAAA, resp_nodata, sizeof(resp_nodata)},
+};
+#define RECORDS (sizeof(records) / sizeof(records[0]))
+
+static struct
+{
+    uint8_t mode;
+    uint32_t queries;
+} servers[2];
+
+static uint8_t hold;                /* 应答暂存, 由测试投递 */
+static uint16_t query_ids[16];
+static uint32_t query_count;
+
+static struct
+{
+    uint32_t at;
+    uint8_t srv;
+    uint16_t len;
+    uint8_t pkt[WIZ_DNS_MSG_MAX];
+} replies[REPLY_QUEUE];
+static uint8_t reply_count;
+
+/* 查询完成回调的记录 */
+static struct
+{
+    char name[WIZ_DNS_NAME_MAX];
+    int8_t status;
+    uint8_t addr[16];
+    uint32_t at;
+} done[8];
+static uint8_t done_count;
+
+uint32_t wiz_timer_get_ms(void)
+{
+    return stub_tick;
+}
+
+static void put_id(uint8_t *m, uint16_t id)
+{
+    m[0] = (uint8_t)(id >> 8);
+    m[1] = (uint8_t)id;
+}
+
+/* 查询报文中的问题 (未压缩) */
+static void query_question(const uint8_t *m, uint16_t len, char *name, uint16_t *type)
+{
+    uint16_t i = WIZ_DNS_HDR_LEN, k = 0;
+
+    while (i < len && m[i] != 0)
+    {
+        if (k)
+            name[k++] = '.';
+        memcpy(&name[k], &m[i + 1], m[i]);
+        k += m[i];
+        i += 1 + m[i];
+    }
+    name[k] = '\0';
+    *type = (uint16_t)((m[i + 1] << 8) | m[i + 2]);
+}
+
+static void queue_reply(uint8_t srv, const uint8_t *pkt, uint16_t len)
+{
+    if (reply_count >= REPLY_QUEUE)
+        return;
+    replies[reply_count].at = hold ? 0 : stub_tick + SERVER_DELAY_MS;
+    replies[reply_count].srv = srv;
+    replies[reply_count].len = len;
+    memcpy(replies[reply_count].pkt, pkt, len);
+    reply_count++;
+}
+
+static void wiz_sim_udp_out(uint8_t sn, const uint8_t ip[4], uint16_t port, const uint8_t *data, uint16_t len)
+{
+    uint8_t pkt[WIZ_DNS_MSG_MAX];
+    char name[WIZ_DNS_NAME_MAX];
+    uint16_t type, id;
+    uint8_t srv, i;
+
+    if (sn != WIZ_DNS_SOCK || port != WIZ_DNS_SERVER_PORT)
+        return;
+    if (memcmp(ip, primary_ip, 4) == 0)
+        srv = 0;
+    else if (memcmp(ip, backup_ip, 4) == 0)
+        srv = 1;
+    else
+        return;
+    servers[srv].queries++;
+    id = (uint16_t)((data[0] << 8) | data[1]);
+    if (query_count < sizeof(query_ids) / sizeof(query_ids[0]))
+        query_ids[query_count] = id;
+    query_count++;
+
+    switch (servers[srv].mode)
+    {
+    case SRV_SILENT:
+        return;
+
+    case SRV_SERVFAIL:
+        memcpy(pkt, data, len);
+        pkt[2] = 0x81;
+        pkt[3] = 0x82;
+        queue_reply(srv, pkt, len);
+        return;
+
+    default:
+        query_question(data, len, name, &type);
+        for (i = 0; i < RECORDS; i++)
+        {
+            if (records[i].type == type && strcasecmp(records[i].name, name) == 0)
+                break;
+        }
+        if (i == RECORDS)
+            return;
+        memcpy(pkt, records[i].resp, records[i].len);
+        put_id(pkt, id);
+        if (servers[srv].mode == SRV_TRUNCATE)
+            pkt[2] |= DNS_FLAG_TC >> 8;
+        queue_reply(srv, pkt, records[i].len);
+        return;
+    }
+}
+
+static void deliver(uint8_t k)
+{
+    wiz_sim_udp_in(WIZ_DNS_SOCK, replies[k].srv ? backup_ip : primary_ip, WIZ_DNS_SERVER_PORT,
+                   replies[k].pkt, replies[k].len);
+    memmove(&replies[k], &replies[k + 1], (reply_count - k - 1) * sizeof(replies[0]));
+    reply_count--;
+}
+
+static void on_done(const char *name, wiz_dns_type_t type, int8_t status, const uint8_t *addr, void *arg)
+{
+    if (done_count >= sizeof(done) / sizeof(done[0]))
+        return;
+    strcpy(done[done_count].name, name);
+    done[done_count].status = status;
+    if (addr != NULL)
+        memcpy(done[done_count].addr, addr, dns_addr_len(type));
+    done[done_count].at = stub_tick;
+    done_count++;
+}
+
+/* 仿真 ---------------------------------------------------------------------*/
+
+static void setup(void)
+{
+    wiz_sim_init();
+    wizchip_setnetinfo((wiz_NetInfo *)&netinfo);
+    memset(dns_queries, 0, sizeof(dns_queries));
+    memset(dns_cache, 0, sizeof(dns_cache));
+    memset(&dns_stats, 0, sizeof(dns_stats));
+    memset(dns_local_ip, 0, sizeof(dns_local_ip));
+    dns_pref = 0;
+    wiz_udp_send_reset(WIZ_DNS_SOCK);
+    wiz_dns_init(netinfo.mac);
+    wiz_dns_set_servers(NULL, backup_ip);
+
+    memset(servers, 0, sizeof(servers));
+    hold = 0;
+    reply_count = 0;
+    query_count = 0;
+    done_count = 0;
+}
+
+static void run_ms(uint32_t ms)
+{
+    uint8_t k;
+
+    while (ms--)
+    {
+        stub_tick++;
+        wiz_sim_tick(1);
+        for (k = 0; k < reply_count;)
+        {
+            if (replies[k].at != 0 && time_reached(stub_tick, replies[k].at))
+                deliver(k);
+            else
+                k++;
+        }
+        if (stub_tick % POLL_MS == 0)
+            wiz_dns_poll();
+    }
+}
+
+/* 长时间没有查询: 只推进时钟 */
+static void idle_s(uint32_t s)
+{
+    stub_tick += s * 1000;
+    wiz_sim.now += s * 1000;
+}
+
+/* 不带回调解析, 直到得到结果 */
+static int8_t resolve_wait(const char *name, wiz_dns_type_t type, uint8_t *addr)
+{
+    int8_t ret;
+    uint32_t t;
+
+    for (t = 0; t < 30000; t += POLL_MS)
+    {
+        ret = wiz_dns_resolve(name, type, addr, NULL, NULL);
+        if (ret != WIZ_DNS_PENDING)
+            return ret;
+        run_ms(POLL_MS);
+    }
+    return WIZ_DNS_PENDING;
+}
+
+/* 测试 ---------------------------------------------------------------------*/
+
+static const uint8_t addr_example[4] = {93, 184, 216, 34};
+static const uint8_t addr_github[4] = {140, 82, 121, 4};
+static const uint8_t addr_google6[16] = {0x2A, 0x00, 0x14, 0x50, 0x40, 0x01, 0x08, 0x2B,
+                                         0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x20, 0x0E};
+
+/* 4 个查询在同一轮发出, 应答乱序到达, 按事务 ID 各自完成; 第 5 个返回 FULL */
+static void test_pipelining(void)
+{
+    wiz_dns_stats_t st;
+    uint32_t start;
+    uint8_t i, j;
+
+    setup();
+    hold = 1;
+    start = stub_tick;
+    CHECK_EQ(wiz_dns_resolve("example.com", WIZ_DNS_TYPE_A, NULL, on_done, NULL), WIZ_DNS_PENDING);
+    CHECK_EQ(wiz_dns_resolve("www.github.com", WIZ_DNS_TYPE_A, NULL, on_done, NULL), WIZ_DNS_PENDING);
+    CHECK_EQ(wiz_dns_resolve("ipv6.google.com", WIZ_DNS_TYPE_AAAA, NULL, on_done, NULL), WIZ_DNS_PENDING);
+    CHECK_EQ(wiz_dns_resolve("nosuch.example.com", WIZ_DNS_TYPE_A, NULL, on_done, NULL), WIZ_DNS_PENDING);
+    CHECK_EQ(servers[0].queries, 4);
+    CHECK_EQ(reply_count, 4);
+    for (i = 0; i < 4; i++)
+        for (j = i + 1; j < 4; j++)
+            CHECK(query_ids[i] != query_ids[j]);
+
+    /* 同名同类型的查询合并, 槽已满时新名字返回 FULL */
+    CHECK_EQ(wiz_dns_resolve("Example.COM.", WIZ_DNS_TYPE_A, NULL, NULL, NULL), WIZ_DNS_PENDING);
+    CHECK_EQ(wiz_dns_resolve("sensor.lan", WIZ_DNS_TYPE_AAAA, NULL, on_done, NULL), WIZ_DNS_ERR_FULL);
+    CHECK_EQ(servers[0].queries, 4);
+
+    /* 倒序投递 */
+    while (reply_count > 0)
+    {
+        replies[reply_count - 1].at = stub_tick + 1;
+        run_ms(1);
+    }
+    run_ms(POLL_MS);
+    CHECK_EQ(done_count, 4);
+    for (i = 0; i < done_count; i++)
+    {
+        CHECK(done[i].at - start <= 2 * POLL_MS);
+        if (strcmp(done[i].name, "example.com") == 0)
+        {
+            CHECK_EQ(done[i].status, WIZ_DNS_OK);
+            CHECK_MEM(done[i].addr, addr_example, 4);
+        }
+        else if (strcmp(done[i].name, "www.github.com") == 0)
+        {
+            CHECK_EQ(done[i].status, WIZ_DNS_OK);
+            CHECK_MEM(done[i].addr, addr_github, 4);
+        }
+        else if (strcmp(done[i].name, "ipv6.google.com") == 0)
+        {
+            CHECK_EQ(done[i].status, WIZ_DNS_OK);
+            CHECK_MEM(done[i].addr, addr_google6, 16);
+        }
+        else
+        {
+            CHECK_EQ(done[i].status, WIZ_DNS_ERR_NOTFOUND);
+        }
+    }
+    wiz_dns_get_stats(&st);
+    CHECK_EQ(st.queries, 4);
+    CHECK_EQ(st.sent, 4);
+    CHECK_EQ(st.answers, 3);
+    CHECK_EQ(st.not_found, 1);
+    CHECK_EQ(st.bad_replies, 0);
+
+    /* 槽已释放 */
+    CHECK_EQ(wiz_dns_resolve("sensor.lan", WIZ_DNS_TYPE_AAAA, NULL, on_done, NULL), WIZ_DNS_PENDING);
+}
+
+/* 成功结果按 TTL (CNAME 链取最小值) 缓存, 过期后重新查询; TTL 限制在 [MIN, MAX] */
+static void test_cache_positive(void)
+{
+    static uint8_t resp_ttl[sizeof(resp_example_a)];
+    wiz_dns_stats_t st;
+    uint8_t addr[16];
+
+    setup();
+    CHECK_EQ(resolve_wait("example.com", WIZ_DNS_TYPE_A, addr), WIZ_DNS_OK);
+    CHECK_MEM(addr, addr_example, 4);
+    CHECK_EQ(resolve_wait("www.github.com", WIZ_DNS_TYPE_A, addr), WIZ_DNS_OK);
+    CHECK_MEM(addr, addr_github, 4);
+    CHECK_EQ(resolve_wait("ipv6.google.com", WIZ_DNS_TYPE_AAAA, addr), WIZ_DNS_OK);
+    CHECK_MEM(addr, addr_google6, 16);
+    CHECK_EQ(servers[0].queries, 3);
+
+    /* 命中缓存: 不发查询, 域名不区分大小写, 忽略结尾的 '.' */
+    memset(addr, 0, sizeof(addr));
+    CHECK_EQ(wiz_dns_resolve("EXAMPLE.com.", WIZ_DNS_TYPE_A, addr, NULL, NULL), WIZ_DNS_OK);
+    CHECK_MEM(addr, addr_example, 4);
+    CHECK_EQ(wiz_dns_resolve("example.com", WIZ_DNS_TYPE_AAAA, addr, NULL, NULL), WIZ_DNS_PENDING);
+    CHECK_EQ(servers[0].queries, 4);
+
+    idle_s(59);
+    CHECK_EQ(wiz_dns_resolve("www.github.com", WIZ_DNS_TYPE_A, addr, NULL, NULL), WIZ_DNS_OK);
+    idle_s(2);
+    CHECK_EQ(wiz_dns_resolve("www.github.com", WIZ_DNS_TYPE_A, addr, NULL, NULL), WIZ_DNS_PENDING);
+    CHECK_EQ(wiz_dns_resolve("ipv6.google.com", WIZ_DNS_TYPE_AAAA, addr, NULL, NULL), WIZ_DNS_OK);
+    idle_s(300 - 61);
+    CHECK_EQ(wiz_dns_resolve("ipv6.google.com", WIZ_DNS_TYPE_AAAA, addr, NULL, NULL), WIZ_DNS_PENDING);
+    CHECK_EQ(wiz_dns_resolve("example.com", WIZ_DNS_TYPE_A, addr, NULL, NULL), WIZ_DNS_OK);
+    idle_s(3600 - 300);
+    CHECK_EQ(wiz_dns_resolve("example.com", WIZ_DNS_TYPE_A, addr, NULL, NULL), WIZ_DNS_PENDING);
+    wiz_dns_get_stats(&st);
+    CHECK_EQ(st.cache_hits, 3 + 4);     /* resolve_wait 最后一次调用也是命中 */
+
+    /* TTL 0 和最高位置位按最小值缓存, 过大的 TTL 截到最大值 */
+    memcpy(resp_ttl, resp_example_a, sizeof(resp_ttl));
+    records[0].resp = resp_ttl;
+    resp_ttl[35] = 0x80;
+    wiz_dns_flush();
+    CHECK_EQ(resolve_wait("example.com", WIZ_DNS_TYPE_A, addr), WIZ_DNS_OK);
+    idle_s(WIZ_DNS_TTL_MIN_S - 1);
+    CHECK_EQ(wiz_dns_resolve("example.com", WIZ_DNS_TYPE_A, addr, NULL, NULL), WIZ_DNS_OK);
+    idle_s(1);
+    CHECK_EQ(resolve_wait("example.com", WIZ_DNS_TYPE_A, addr), WIZ_DNS_OK);
+    resp_ttl[35] = 0x00;
+    resp_ttl[36] = 0x10;        /* 0x00100E10: 约 12 天 */
+    wiz_dns_flush();
+    CHECK_EQ(resolve_wait("example.com", WIZ_DNS_TYPE_A, addr), WIZ_DNS_OK);
+    idle_s(WIZ_DNS_TTL_MAX_S - 1);
+    CHECK_EQ(wiz_dns_resolve("example.com", WIZ_DNS_TYPE_A, addr, NULL, NULL), WIZ_DNS_OK);
+    idle_s(1);
+    CHECK_EQ(wiz_dns_resolve("example.com", WIZ_DNS_TYPE_A, addr, NULL, NULL), WIZ_DNS_PENDING);
+    records[0].resp = resp_example_a;
+
+    /* 本机地址变化时清空缓存 */
+    run_ms(100);
+    CHECK_EQ(wiz_dns_resolve("example.com", WIZ_DNS_TYPE_A, addr, NULL, NULL), WIZ_DNS_OK);
+    setSIPR((uint8_t *)backup_ip);
+    CHECK_EQ(wiz_dns_resolve("example.com", WIZ_DNS_TYPE_A, addr, NULL, NULL), WIZ_DNS_PENDING);
+}
+
+/* NXDOMAIN/NODATA 按 SOA (TTL 与 minimum 取小, 不超过 NEG_TTL_MAX) 缓存, 超时按 FAIL_TTL 缓存 */
+static void test_cache_negative(void)
+{
+    wiz_dns_stats_t st, st0;
+    uint32_t start, q;
+
+    setup();
+    CHECK_EQ(resolve_wait("nosuch.example.com", WIZ_DNS_TYPE_A, NULL), WIZ_DNS_ERR_NOTFOUND);
+    CHECK_EQ(resolve_wait("sensor.lan", WIZ_DNS_TYPE_AAAA, NULL), WIZ_DNS_ERR_NOTFOUND);
+    q = servers[0].queries;
+
+    idle_s(29);
+    CHECK_EQ(wiz_dns_resolve("sensor.lan", WIZ_DNS_TYPE_AAAA, NULL, NULL, NULL), WIZ_DNS_ERR_NOTFOUND);
+    idle_s(2);
+    CHECK_EQ(wiz_dns_resolve("sensor.lan", WIZ_DNS_TYPE_AAAA, NULL, NULL, NULL), WIZ_DNS_PENDING);
+    CHECK_EQ(wiz_dns_resolve("nosuch.example.com", WIZ_DNS_TYPE_A, NULL, NULL, NULL), WIZ_DNS_ERR_NOTFOUND);
+    run_ms(100);
+    idle_s(WIZ_DNS_NEG_TTL_MAX_S - 31);
+    CHECK_EQ(wiz_dns_resolve("sensor.lan", WIZ_DNS_TYPE_AAAA, NULL, NULL, NULL), WIZ_DNS_ERR_NOTFOUND);
+    CHECK_EQ(wiz_dns_resolve("nosuch.example.com", WIZ_DNS_TYPE_A, NULL, NULL, NULL), WIZ_DNS_PENDING);
+    CHECK_EQ(servers[0].queries, q + 2);
+
+    /* 两台服务器都不应答: 1+2+4+8s 后超时, 结果缓存 FAIL_TTL */
+    servers[0].mode = SRV_SILENT;
+    servers[1].mode = SRV_SILENT;
+    run_ms(100);
+    start = stub_tick;
+    done_count = 0;
+    wiz_dns_get_stats(&st0);
+    CHECK_EQ(wiz_dns_resolve("example.com", WIZ_DNS_TYPE_A, NULL, on_done, NULL), WIZ_DNS_PENDING);
+    run_ms(16000);
+    CHECK_EQ(done_count, 1);
+    CHECK_EQ(done[0].status, WIZ_DNS_ERR_TIMEOUT);
+    CHECK(done[0].at - start >= 15000 && done[0].at - start <= 15000 + POLL_MS);
+    wiz_dns_get_stats(&st);
+    CHECK_EQ(st.sent - st0.sent, WIZ_DNS_TRIES);
+    CHECK_EQ(st.retransmits - st0.retransmits, WIZ_DNS_TRIES - 1);
+    CHECK_EQ(st.timeouts, 1);
+    CHECK_EQ(st.failovers - st0.failovers, WIZ_DNS_TRIES - 1);
+    CHECK_EQ(servers[0].queries - q - 2, 2);
+    CHECK_EQ(servers[1].queries, 2);
+
+    servers[0].mode = SRV_ANSWER;
+    CHECK_EQ(wiz_dns_resolve("example.com", WIZ_DNS_TYPE_A, NULL, NULL, NULL), WIZ_DNS_ERR_TIMEOUT);
+    idle_s(WIZ_DNS_FAIL_TTL_S);
+    CHECK_EQ(resolve_wait("example.com", WIZ_DNS_TYPE_A, NULL), WIZ_DNS_OK);
+}
+
+/* 主服务器不应答时重传发往备用服务器, 之后的查询先发给有应答的服务器; SERVFAIL 立即切换 */
+static void test_failover(void)
+{
+    wiz_dns_stats_t st;
+    uint8_t addr[4];
+    uint32_t start;
+
+    setup();
+    servers[0].mode = SRV_SILENT;
+    start = stub_tick;
+    CHECK_EQ(resolve_wait("example.com", WIZ_DNS_TYPE_A, addr), WIZ_DNS_OK);
+    CHECK(stub_tick - start >= WIZ_DNS_RETX_MS);
+    CHECK(stub_tick - start <= WIZ_DNS_RETX_MS + SERVER_DELAY_MS + 2 * POLL_MS);
+    CHECK_EQ(servers[0].queries, 1);
+    CHECK_EQ(servers[1].queries, 1);
+
+    CHECK_EQ(resolve_wait("www.github.com", WIZ_DNS_TYPE_A, addr), WIZ_DNS_OK);
+    CHECK_EQ(servers[0].queries, 1);
+    CHECK_EQ(servers[1].queries, 2);
+
+    /* 备用服务器 SERVFAIL: 不等重传超时, 立即问主服务器 */
+    servers[0].mode = SRV_ANSWER;
+    servers[1].mode = SRV_SERVFAIL;
+    start = stub_tick;
+    CHECK_EQ(resolve_wait("ipv6.google.com", WIZ_DNS_TYPE_AAAA, NULL), WIZ_DNS_OK);
+    CHECK(stub_tick - start <= 2 * SERVER_DELAY_MS + 3 * POLL_MS);
+    CHECK_EQ(servers[0].queries, 2);
+    CHECK_EQ(servers[1].queries, 3);
+    wiz_dns_get_stats(&st);
+    CHECK_EQ(st.failovers, 2);
+    CHECK_EQ(st.server_errors, 0);
+
+    /* 两台都截断 (不支持 TCP): 次数用完后 ERR_SERVER */
+    servers[0].mode = SRV_TRUNCATE;
+    servers[1].mode = SRV_TRUNCATE;
+    CHECK_EQ(resolve_wait("nosuch.example.com", WIZ_DNS_TYPE_A, NULL), WIZ_DNS_ERR_SERVER);
+    wiz_dns_get_stats(&st);
+    CHECK_EQ(st.server_errors, 1);
+
+    /* 只配置了一台服务器时不切换 */
+    setup();
+    wiz_dns_set_servers(NULL, primary_ip);
+    servers[0].mode = SRV_SILENT;
+    CHECK_EQ(wiz_dns_resolve("example.com", WIZ_DNS_TYPE_A, NULL, NULL, NULL), WIZ_DNS_PENDING);
+    run_ms(2000);
+    wiz_dns_get_stats(&st);
+    CHECK_EQ(st.failovers, 0);
+    CHECK_EQ(servers[0].queries, 2);
+}
+
+/* 来源、端口、事务 ID、问题段或标志不符的应答丢弃, 查询继续等待正确的应答 */
+static void test_spoofed_replies(void)
+{
+    static const uint8_t stranger[4] = {10, 0, 0, 1};
+    wiz_dns_stats_t st;
+    uint8_t pkt[WIZ_DNS_MSG_MAX];
+    uint16_t len;
+    uint8_t addr[4];
+
+    setup();
+    hold = 1;
+    CHECK_EQ(wiz_dns_resolve("example.com", WIZ_DNS_TYPE_A, addr, NULL, NULL), WIZ_DNS_PENDING);
+    CHECK_EQ(reply_count, 1);
+    len = replies[0].len;
+    memcpy(pkt, replies[0].pkt, len);
+    reply_count = 0;
+
+    wiz_sim_udp_in(WIZ_DNS_SOCK, stranger, WIZ_DNS_SERVER_PORT, pkt, len);
+    wiz_sim_udp_in(WIZ_DNS_SOCK, primary_ip, 5353, pkt, len);
+    wiz_sim_udp_in(WIZ_DNS_SOCK, backup_ip, WIZ_DNS_SERVER_PORT, pkt, len);    /* 没有发给备用服务器 */
+    pkt[1] ^= 0x01;
+    wiz_sim_udp_in(WIZ_DNS_SOCK, primary_ip, WIZ_DNS_SERVER_PORT, pkt, len);
+    pkt[1] ^= 0x01;
+    pkt[2] &= 0x7F;                                                             /* QR=0 */
+    wiz_sim_udp_in(WIZ_DNS_SOCK, primary_ip, WIZ_DNS_SERVER_PORT, pkt, len);
+    pkt[2] |= 0x80;
+    pkt[13] = 'E';                                                              /* 大小写不同仍匹配 */
+    pkt[16] = 'x';                                                              /* 问题段不同 */
+    wiz_sim_udp_in(WIZ_DNS_SOCK, primary_ip, WIZ_DNS_SERVER_PORT, pkt, len);
+    pkt[16] = 'm';
+    pkt[26] = WIZ_DNS_TYPE_AAAA;                                                /* 类型不同 */
+    wiz_sim_udp_in(WIZ_DNS_SOCK, primary_ip, WIZ_DNS_SERVER_PORT, pkt, len);
+    pkt[26] = WIZ_DNS_TYPE_A;
+    run_ms(POLL_MS);
+    CHECK_EQ(wiz_dns_resolve("example.com", WIZ_DNS_TYPE_A, addr, NULL, NULL), WIZ_DNS_PENDING);
+    wiz_dns_get_stats(&st);
+    CHECK_EQ(st.bad_replies, 7);
+    CHECK_EQ(st.queries, 1);
+
+    wiz_sim_udp_in(WIZ_DNS_SOCK, primary_ip, WIZ_DNS_SERVER_PORT, pkt, len);
+    run_ms(POLL_MS);
+    CHECK_EQ(wiz_dns_resolve("example.com", WIZ_DNS_TYPE_A, addr, NULL, NULL), WIZ_DNS_OK);
+    CHECK_MEM(addr, addr_example, 4);
+}
+
+/* 超过缓冲区的应答: 剩余部分读出丢弃, 按截断重试, 之后的报文不错位 */
+static void test_oversize(void)
+{
+    uint8_t pkt[700];
+    uint8_t addr[4];
+
+    setup();
+    hold = 1;
+    CHECK_EQ(wiz_dns_resolve("example.com", WIZ_DNS_TYPE_A, addr, NULL, NULL), WIZ_DNS_PENDING);
+    memset(pkt, 0, sizeof(pkt));
+    memcpy(pkt, replies[0].pkt, replies[0].len);
+    reply_count = 0;
+    wiz_sim_udp_in(WIZ_DNS_SOCK, primary_ip, WIZ_DNS_SERVER_PORT, pkt, sizeof(pkt));
+    run_ms(POLL_MS);
+    CHECK_EQ(servers[1].queries, 1);
+    CHECK_EQ(reply_count, 1);
+    deliver(0);
+    run_ms(POLL_MS);
+    CHECK_EQ(wiz_dns_resolve("example.com", WIZ_DNS_TYPE_A, addr, NULL, NULL), WIZ_DNS_OK);
+    CHECK_MEM(addr, addr_example, 4);
+    CHECK_EQ(getSn_RX_RSR(WIZ_DNS_SOCK), 0);
+}
+
+/* 解析加固 -----------------------------------------------------------------*/
+
+static uint8_t *guard_page;
+static long page_size;
+
+/* 报文放在保护页之前, 读到 len 之外立即 SIGSEGV */
+static const uint8_t *guarded(const uint8_t *m, uint16_t len)
+{
+    uint8_t *p = guard_page + page_size - len;
+
+    memcpy(p, m, len);
+    return p;
+}
+
+static uint32_t fuzz_cases;
+
+/* 按 dns_handle 的顺序解析整个报文, 检查返回值和输出 */
+static void parse_all(const uint8_t *src, uint16_t len, const char *qname, wiz_dns_type_t type)
+{
+    struct wiz_dns_query q;
+    const uint8_t *m = guarded(src, len);
+    char name[WIZ_DNS_NAME_MAX];
+    uint32_t ttl;
+    int32_t off;
+    int8_t found;
+
+    fuzz_cases++;
+    memset(&q, 0, sizeof(q));
+    strcpy(q.name, qname);
+    q.type = type;
+    if (len < WIZ_DNS_HDR_LEN)
+        return;
+
+    memset(name, 0x55, sizeof(name));
+    off = dns_read_name(m, len, WIZ_DNS_HDR_LEN, name, sizeof(name));
+    CHECK(off == -1 || (off > WIZ_DNS_HDR_LEN && off <= len));
+    if (off < 0)
+        return;
+    CHECK(memchr(name, '\0', sizeof(name)) != NULL);
+    if (off + 4 > len)
+        return;
+    off += 4;
+
+    found = dns_parse_answer(m, len, &off, get_be16(&m[6]), &q, &ttl);
+    CHECK(found == -1 || found == 0 || found == 1);
+    CHECK(memchr(dns_owner, '\0', sizeof(dns_owner)) != NULL);
+    CHECK(memchr(dns_target, '\0', sizeof(dns_target)) != NULL);
+    if (found < 0)
+        return;
+    CHECK(off <= len);
+    CHECK(dns_negative_ttl(m, len, off, get_be16(&m[8])) <= WIZ_DNS_TTL_MIN_S + WIZ_DNS_NEG_TTL_MAX_S);
+}
+
+static uint32_t fuzz_seed = 12345;
+
+static uint32_t fuzz_rand(void)
+{
+    fuzz_seed = fuzz_seed * 1103515245UL + 12345UL;
+    return fuzz_seed >> 8;
+}
+
+static void test_parse_hardening(void)
+{
+    static const uint8_t values[] = {0x00, 0x01, 0x3F, 0x40, 0x80, 0xC0, 0xFF};
+    uint8_t m[WIZ_DNS_MSG_MAX];
+    char name[WIZ_DNS_NAME_MAX];
+    uint16_t len, i, v;
+    uint32_t n;
+    uint8_t r;
+
+    page_size = getpagesize();
+    guard_page = mmap(NULL, page_size * 2, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    CHECK(guard_page != MAP_FAILED);
+    if (guard_page == MAP_FAILED)
+        return;
+    mprotect(guard_page + page_size, page_size, PROT_NONE);
+
+    for (r = 0; r < RECORDS; r++)
+    {
+        len = records[r].len;
+
+        /* 原样: 与 dns_handle 一致 */
+        parse_all(records[r].resp, len, records[r].name, (wiz_dns_type_t)records[r].type);
+
+        /* 所有截断长度 */
+        for (i = 0; i < len; i++)
+            parse_all(records[r].resp, i, records[r].name, (wiz_dns_type_t)records[r].type);
+
+        /* 逐字节改成边界值 */
+        for (i = 0; i < len; i++)
+        {
+            for (v = 0; v < sizeof(values); v++)
+            {
+                memcpy(m, records[r].resp, len);
+                m[i] = values[v];
+                parse_all(m, len, records[r].name, (wiz_dns_type_t)records[r].type);
+                m[i] = records[r].resp[i] ^ (uint8_t)(1 << (v % 8));
+                parse_all(m, len, records[r].name, (wiz_dns_type_t)records[r].type);
+            }
+        }
+
+        /* 随机多字节变异 */
+        for (n = 0; n < 20000; n++)
+        {
+            memcpy(m, records[r].resp, len);
+            for (v = 0; v < 1 + fuzz_rand() % 6; v++)
+                m[fuzz_rand() % len] = (uint8_t)fuzz_rand();
+            parse_all(m, (uint16_t)(len - fuzz_rand() % 8), records[r].name, (wiz_dns_type_t)records[r].type);
+        }
+    }
+
+    /* 构造的攻击报文: 指向自身/向前的指针, 指针链, 未定义的标签类型 */
+    memset(m, 0, sizeof(m));
+    m[12] = 0xC0;
+    m[13] = 12;
+    CHECK_EQ(dns_read_name(guarded(m, 14), 14, 12, name, sizeof(name)), -1);
+    m[13] = 20;
+    CHECK_EQ(dns_read_name(guarded(m, 24), 24, 12, name, sizeof(name)), -1);
+    m[12] = 0x40;
+    CHECK_EQ(dns_read_name(guarded(m, 24), 24, 12, name, sizeof(name)), -1);
+    m[12] = 0x3F;
+    CHECK_EQ(dns_read_name(guarded(m, 24), 24, 12, name, sizeof(name)), -1);
+
+    /* 每个指针指向前一个: 超过 PTR_MAX 次跳转后拒绝 */
+    m[12] = 1;
+    m[13] = 'a';
+    m[14] = 0;
+    for (i = 0; i <= WIZ_DNS_PTR_MAX + 1; i++)
+    {
+        m[15 + 2 * i] = 0xC0;
+        m[16 + 2 * i] = (uint8_t)(i == 0 ? 12 : 15 + 2 * (i - 1));
+    }
+    len = 15 + 2 * (WIZ_DNS_PTR_MAX + 2);
+    CHECK_EQ(dns_read_name(guarded(m, len), len, 15 + 2 * (WIZ_DNS_PTR_MAX - 1), name, sizeof(name)),
+             15 + 2 * WIZ_DNS_PTR_MAX);
+    CHECK_EQ(strcmp(name, "a"), 0);
+    CHECK_EQ(dns_read_name(guarded(m, len), len, 15 + 2 * (WIZ_DNS_PTR_MAX + 1), name, sizeof(name)), -1);
+
+    /* 超长域名: 跳过成功, 输出空串 */
+    len = 12;
+    for (i = 0; i < 3; i++)
+    {
+        m[len] = 40;
+        memset(&m[len + 1], 'x', 40);
+        len += 41;
+    }
+    m[len++] = 0;
+    CHECK_EQ(dns_read_name(guarded(m, len), len, 12, name, sizeof(name)), len);
+    CHECK_EQ(name[0], '\0');
+
+    /* 标签中的 '.' 和 '\0' 不能拼出别的域名 */
+    memcpy(&m[12], "\x0b" "example.com" "\x00", 13);
+    CHECK_EQ(dns_read_name(guarded(m, 25), 25, 12, name, sizeof(name)), 25);
+    CHECK_EQ(name[0], '\0');
+
+    printf("  parse hardening: %lu guarded parses, no out-of-bounds read\n", (unsigned long)fuzz_cases);
+    munmap(guard_page, page_size * 2);
+}
+
+/* 基准 ---------------------------------------------------------------------*/
+
+static void test_bench(void)
+{
+    struct wiz_dns_query *q;
+    unsigned long long t0, t1;
+    uint32_t n;
+    uint8_t r;
+
+    setup();
+    wiz_dns_set_servers(primary_ip, backup_ip);
+    printf("  dns_handle per reply:");
+    for (r = 0; r < RECORDS; r++)
+    {
+        memset(dns_queries, 0, sizeof(dns_queries));
+        dns_start_query(records[r].name, (wiz_dns_type_t)records[r].type, NULL, NULL);
+        q = &dns_queries[0];
+        q->sent_mask = 1;
+        q->state = DNS_Q_SENT;
+
+        t0 = test_now_ns();
+        for (n = 0; n < BENCH_ROUNDS; n++)
+        {
+            memcpy(dns_msg, records[r].resp, records[r].len);
+            put_id(dns_msg, q->id);
+            q->state = DNS_Q_SENT;
+            dns_handle(records[r].len, primary_ip, 0);
+        }
+        t1 = test_now_ns();
+        CHECK_EQ(q->state, DNS_Q_DONE);
+        CHECK_EQ(q->status, records[r].resp == resp_nxdomain || records[r].resp == resp_nodata ?
+                            WIZ_DNS_ERR_NOTFOUND : WIZ_DNS_OK);
+        printf("%s %s %.0f ns", r ? "," : "", records[r].name, (double)(t1 - t0) / BENCH_ROUNDS);
+    }
+    printf("\n");
+}
+
+int main(void)
+{
+    TEST_RUN(test_pipelining);
+    TEST_RUN(test_cache_positive);
+    TEST_RUN(test_cache_negative);
+    TEST_RUN(test_failover);
+    TEST_RUN(test_spoofed_replies);
+    TEST_RUN(test_oversize);
+    TEST_RUN(test_parse_hardening);
+    TEST_RUN(test_bench);
+    return test_summary("wiz_dns");
+}
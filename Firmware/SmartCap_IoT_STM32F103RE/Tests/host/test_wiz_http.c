@@ -0,0 +1,995 @@
+/**
+  ******************************************************************************
+  * @file    test_wiz_http.c
+  * @brief   HTTP/1.1 Server Against a Simulated Client: Keep-Alive, Chunked Streaming, Replay
+  ******************************************************************************
+  * @description
+  * 真实的 wiz_http.c、发送队列 (wiz_txq.c)、网页资源 (web_assets.c) 和 ioLibrary
+  * 运行在模拟 W5500 上:
+  * - 每 ms 推进一次模拟, HTTP 任务按 http_task 的轮询间隔执行 (有连接 2ms, 无连接 20ms)
+  * - 客户端经 wiz_sim_tcp_accept/wiz_sim_tcp_in 连接和发送请求, 从对端收到的数据中
+  *   按 Content-Length、分块编码或连接关闭切分应答, 分块应答解码后与产生的数据比较
+  * - 持久连接、流水线、逐字节到达的请求 (解析不破坏缓冲区)、ETag/304、错误应答、
+  *   超时、对端关闭和抓包抢占
+  * - 回放: 仪表盘会话 (页面 + 状态轮询) 分别用持久连接和每请求一个连接,
+  *   报告模拟时间内的请求速率、发送字节数和主机上每个请求的耗时; 另测请求解析耗时
+  ******************************************************************************
+  */
+
+#include "test.h"
+#include "wiz_sim.h"
+#include "../../User/ioLibrary_Driver/Ethernet/wizchip_conf.c"
+#include "../../User/ioLibrary_Driver/Ethernet/W5500/w5500.c"
+#include "../../User/ioLibrary_Driver/Ethernet/socket.c"
+#include "../../User/wiz_interface/wiz_txq.c"
+#include "../../User/wiz_interface/wiz_http.c"
+#include "../../User/web/web_assets.c"
+#include <stdlib.h>
+
+#define SN                      WIZ_HTTP_SOCK
+#define RESP_TIMEOUT_MS         10000
+#define BIG_LEN                 5000
+#define REPLAY_SESSIONS         50
+#define REPLAY_POLLS            10
+#define REPLAY_RTT_MS           2
+#define REPLAY_RATE             1250        /* 字节/ms, 约 10Mbit/s */
+#define BENCH_ROUNDS            200000
+
+static const uint8_t client_ip[4] = {192, 168, 1, 20};
+
+static const wiz_NetInfo netinfo = {
+    .mac = {0x00, 0x08, 0xDC, 0x12, 0x34, 0x56},
+    .ip = {192, 168, 1, 50},
+    .sn = {255, 255, 255, 0},
+    .gw = {192, 168, 1, 1},
+    .dns = {192, 168, 1, 1},
+    .dhcp = NETINFO_STATIC,
+};
+
+/* 浏览器发出的典型请求头部 */
+#define BROWSER_HEADERS \
+    "Host: 192.168.1.50\r\n" \
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:128.0) Gecko/20100101 Firefox/128.0\r\n" \
+    "Accept: application/json, text/plain, */*\r\n" \
+    "Accept-Language: zh-CN,zh;q=0.8,en-US;q=0.5,en;q=0.3\r\n" \
+    "Accept-Encoding: gzip, deflate\r\n" \
+    "Referer: http://192.168.1.50/\r\n"
+
+static uint8_t capture_running;
+static uint8_t net_up;
+static uint32_t task_next;
+
+/* 平台接口 -----------------------------------------------------------------*/
+
+uint8_t wiz_capture_is_running(void)
+{
+    return capture_running;
+}
+
+wiz_sup_state_t wiz_supervisor_get_state(void)
+{
+    return net_up ? WIZ_SUP_STATE_UP : WIZ_SUP_STATE_LINK_DOWN;
+}
+
+/* HTTP 只用 TCP */
+static void wiz_sim_udp_out(uint8_t sn, const uint8_t ip[4], uint16_t port, const uint8_t *data, uint16_t len)
+{
+}
+
+/* 路由 ---------------------------------------------------------------------*/
+
+static uint32_t status_hits;
+
+static void h_status(const wiz_http_req_t *req)
+{
+    char body[64];
+    int n;
+
+    n = snprintf(body, sizeof(body), "{\"uptime_ms\":%lu,\"hits\":%lu}",
+                 (unsigned long)stub_tick, (unsigned long)++status_hits);
+    wiz_http_reply(200, "application/json", body, (uint16_t)n);
+}
+
+static void h_echo(const wiz_http_req_t *req)
+{
+    if (req->method != WIZ_HTTP_POST)
+    {
+        wiz_http_reply(405, "text/plain", "POST only", 9);
+        return;
+    }
+    wiz_http_reply(200, "application/octet-stream", req->body, req->body_len);
+}
+
+/* /live: 每 period_ms 一行, 共 lines 行 */
+static struct
+{
+    uint32_t lines;
+    uint32_t period_ms;
+    uint32_t sent;
+    uint32_t next_ms;
+    uint32_t waits;
+} live;
+
+static int32_t live_cb(uint8_t *buf, uint16_t size, void *arg)
+{
+    if (live.sent >= live.lines)
+        return 0;
+    if ((int32_t)(stub_tick - live.next_ms) < 0)
+    {
+        live.waits++;
+        return WIZ_HTTP_CHUNK_WAIT;
+    }
+    live.next_ms += live.period_ms;
+    return snprintf((char *)buf, size, "{\"seq\":%lu}\n", (unsigned long)live.sent++);
+}
+
+static void h_live(const wiz_http_req_t *req)
+{
+    live.sent = 0;
+    live.waits = 0;
+    live.next_ms = stub_tick;
+    wiz_http_reply_chunked("application/x-ndjson", live_cb, NULL);
+}
+
+/* /big: BIG_LEN 字节二进制数据, 每次回调写满给出的空间 */
+static struct
+{
+    uint32_t off;
+    uint32_t calls;
+    uint16_t max_size;
+} big;
+
+static uint8_t big_byte(uint32_t i)
+{
+    return (uint8_t)(i * 7 + (i >> 8) + 3);
+}
+
+static int32_t big_cb(uint8_t *buf, uint16_t size, void *arg)
+{
+    uint16_t n, i;
+
+    big.calls++;
+    if (size > big.max_size)
+        big.max_size = size;
+    n = (BIG_LEN - big.off < size) ? (uint16_t)(BIG_LEN - big.off) : size;
+    for (i = 0; i < n; i++)
+        buf[i] = big_byte(big.off + i);
+    big.off += n;
+    return n;
+}
+
+static void h_big(const wiz_http_req_t *req)
+{
+    memset(&big, 0, sizeof(big));
+    wiz_http_reply_chunked("application/octet-stream", big_cb, NULL);
+}
+
+/* 不应答的处理函数, 服务器补发 500 */
+static void h_noreply(const wiz_http_req_t *req)
+{
+}
+
+/* 记录解析结果, 并检查请求缓冲区未被改写 */
+static struct
+{
+    uint32_t called;
+    wiz_http_method_t method;
+    char path[32];
+    char query[64];
+    char y[16];
+    char inm[16];
+    uint8_t intact;
+} seen;
+
+static const char *inspect_raw;
+static uint16_t inspect_len;
+
+static void copy_field(char *dst, uint16_t size, const char *src, uint16_t len)
+{
+    if (src == NULL)
+    {
+        dst[0] = '\0';
+        return;
+    }
+    if (len >= size)
+        len = size - 1;
+    memcpy(dst, src, len);
+    dst[len] = '\0';
+}
+
+static void h_inspect(const wiz_http_req_t *req)
+{
+    seen.called++;
+    seen.method = req->method;
+    copy_field(seen.path, sizeof(seen.path), req->path, req->path_len);
+    copy_field(seen.query, sizeof(seen.query), req->query, req->query_len);
+    copy_field(seen.inm, sizeof(seen.inm), req->if_none_match, req->if_none_match_len);
+    if (wiz_http_param(req->query, req->query_len, "y", seen.y, sizeof(seen.y)) < 0)
+        seen.y[0] = '\0';
+    seen.intact = (inspect_raw != NULL && conn.len >= inspect_len &&
+                   memcmp(conn.buf, inspect_raw, inspect_len) == 0);
+    wiz_http_reply(204, NULL, NULL, 0);
+}
+
+/* 模拟 ---------------------------------------------------------------------*/
+
+static uint8_t cli_buf[WIZ_SIM_SINK_SIZE];
+static uint32_t cli_len;
+static uint32_t cli_total;          /* 客户端收到的总字节数 */
+
+/* HTTP 任务一次循环 (与 http_task 相同, 不含 osDelay) */
+static void task_step(void)
+{
+    if (wiz_supervisor_get_state() == WIZ_SUP_STATE_UP)
+        http_poll();
+    else if (conn.open)
+        http_conn_reset(&conn);
+}
+
+/* 推进 1ms: 芯片, 到期时运行 HTTP 任务, 客户端取走收到的数据 */
+static void step(void)
+{
+    uint32_t n;
+
+    stub_tick++;
+    wiz_sim_tick(1);
+    if ((int32_t)(stub_tick - task_next) >= 0)
+    {
+        task_step();
+        task_next = stub_tick + (conn.open ? WIZ_HTTP_POLL_MS : WIZ_HTTP_IDLE_POLL_MS);
+    }
+    n = wiz_sim_take(SN, &cli_buf[cli_len], sizeof(cli_buf) - cli_len);
+    cli_len += n;
+    cli_total += n;
+}
+
+static void run_ms(uint32_t ms)
+{
+    while (ms--)
+        step();
+}
+
+static uint8_t client_connected(void)
+{
+    return getSn_SR(SN) == SOCK_ESTABLISHED || getSn_SR(SN) == SOCK_CLOSE_WAIT;
+}
+
+/* 等待服务器监听后连接, handshake_ms 模拟 SYN/SYN-ACK 往返 */
+static uint8_t client_connect(uint32_t handshake_ms)
+{
+    uint32_t i;
+
+    for (i = 0; i < 100 && wiz_sim_sr(SN) != SOCK_LISTEN; i++)
+        step();
+    run_ms(handshake_ms);
+    cli_len = 0;
+    return wiz_sim_tcp_accept(SN, client_ip, 50000);
+}
+
+static void client_send(const void *data, uint16_t len)
+{
+    CHECK_EQ(wiz_sim_tcp_in(SN, data, len), len);
+}
+
+static void client_puts(const char *str)
+{
+    client_send(str, (uint16_t)strlen(str));
+}
+
+/* 等待服务器关闭连接 */
+static uint8_t wait_closed(uint32_t max_ms)
+{
+    while (max_ms-- && client_connected())
+        step();
+    return !client_connected();
+}
+
+/* 客户端应答解析 -----------------------------------------------------------*/
+
+struct resp
+{
+    int status;
+    char hdr[512];
+    long content_length;        /* 没有 Content-Length 时为 -1 */
+    uint8_t chunked;
+    uint8_t close;
+    uint8_t keep_alive;
+    uint8_t body[8192];
+    uint32_t body_len;
+    uint32_t chunks;
+    uint32_t max_chunk;
+};
+
+/* 头部值, 没有该头部时返回 NULL */
+static const char *header(const struct resp *r, const char *name)
+{
+    char key[48];
+    const char *p;
+
+    snprintf(key, sizeof(key), "\r\n%s: ", name);
+    p = strstr(r->hdr, key);
+    return p ? p + strlen(key) : NULL;
+}
+
+static uint8_t header_is(const struct resp *r, const char *name, const char *value)
+{
+    const char *v = header(r, name);
+    return v != NULL && strncmp(v, value, strlen(value)) == 0 && v[strlen(value)] == '\r';
+}
+
+/*
+ * 从 buf 中切分一个应答, 返回消耗的字节数, 0 表示还不完整
+ * head: 请求为 HEAD; eof: 连接已关闭 (没有长度的应答以关闭结束)
+ */
+static uint32_t parse_response(const uint8_t *buf, uint32_t len, uint8_t head, uint8_t eof, struct resp *r)
+{
+    const uint8_t *end = memmem(buf, len, "\r\n\r\n", 4);
+    const char *v;
+    uint32_t hlen, pos, size;
+    char *stop;
+
+    if (end == NULL)
+        return 0;
+    hlen = (uint32_t)(end - buf) + 4;
+    memset(r, 0, sizeof(*r));
+    if (hlen >= sizeof(r->hdr))
+        return 0;
+    memcpy(r->hdr, buf, hlen);
+    if (sscanf(r->hdr, "HTTP/1.1 %d", &r->status) != 1)
+        return 0;
+    v = header(r, "Content-Length");
+    r->content_length = v ? strtol(v, NULL, 10) : -1;
+    r->chunked = header_is(r, "Transfer-Encoding", "chunked");
+    r->close = header_is(r, "Connection", "close");
+    r->keep_alive = header_is(r, "Connection", "keep-alive");
+
+    if (head || r->status == 304 || r->status == 204)
+        return hlen;
+    if (r->content_length >= 0)
+    {
+        if (len - hlen < (uint32_t)r->content_length)
+            return 0;
+        r->body_len = (uint32_t)r->content_length;
+        memcpy(r->body, &buf[hlen], r->body_len);
+        return hlen + r->body_len;
+    }
+    if (!r->chunked)
+    {
+        if (!eof)
+            return 0;
+        r->body_len = len - hlen;
+        memcpy(r->body, &buf[hlen], r->body_len);
+        return len;
+    }
+
+    /* 分块: 十六进制长度 CRLF 数据 CRLF ..., 以 "0" CRLF CRLF 结束 */
+    pos = hlen;
+    for (;;)
+    {
+        end = memmem(&buf[pos], len - pos, "\r\n", 2);
+        if (end == NULL)
+            return 0;
+        size = (uint32_t)strtoul((const char *)&buf[pos], &stop, 16);
+        if ((const uint8_t *)stop != end)
+            return 0;
+        pos = (uint32_t)(end - buf) + 2;
+        if (len - pos < size + 2)
+            return 0;
+        if (buf[pos + size] != '\r' || buf[pos + size + 1] != '\n')
+            return 0;
+        if (size == 0)
+            return pos + 2;
+        memcpy(&r->body[r->body_len], &buf[pos], size);
+        r->body_len += size;
+        r->chunks++;
+        if (size > r->max_chunk)
+            r->max_chunk = size;
+        pos += size + 2;
+    }
+}
+
+/* 等待一个完整应答, 超时返回 0 */
+static uint8_t get_response(struct resp *r, uint8_t head, uint32_t max_ms)
+{
+    uint32_t n;
+
+    for (;;)
+    {
+        n = parse_response(cli_buf, cli_len, head, !client_connected(), r);
+        if (n > 0)
+        {
+            memmove(cli_buf, &cli_buf[n], cli_len - n);
+            cli_len -= n;
+            return 1;
+        }
+        if (max_ms-- == 0)
+            return 0;
+        step();
+    }
+}
+
+/* 发送请求并等待应答 (连接未建立时先连接) */
+static uint8_t request(const char *raw, struct resp *r)
+{
+    if (!client_connected() && !client_connect(0))
+        return 0;
+    client_puts(raw);
+    return get_response(r, strncmp(raw, "HEAD ", 5) == 0, RESP_TIMEOUT_MS);
+}
+
+/* 上电, 以太网就绪, 登记路由和资源并启动 HTTP 任务 */
+static void setup(void)
+{
+    wiz_sim_init();
+    wizchip_setnetinfo((wiz_NetInfo *)&netinfo);
+    memset(txq, 0, sizeof(txq));
+    memset(&conn, 0, sizeof(conn));
+    memset(&http_stats, 0, sizeof(http_stats));
+    route_count = 0;
+    cur = NULL;
+    http_task_handle = NULL;
+
+    CHECK_EQ(wiz_http_route("/api/status", h_status), 0);
+    CHECK_EQ(wiz_http_route("/echo", h_echo), 0);
+    CHECK_EQ(wiz_http_route("/live", h_live), 0);
+    CHECK_EQ(wiz_http_route("/big", h_big), 0);
+    CHECK_EQ(wiz_http_route("/noreply", h_noreply), 0);
+    CHECK_EQ(wiz_http_route("/inspect*", h_inspect), 0);
+    wiz_http_set_assets(Web_Assets, Web_AssetCount);
+    wiz_http_start();
+    CHECK(http_task_handle != NULL);
+
+    capture_running = 0;
+    net_up = 1;
+    status_hits = 0;
+    memset(&seen, 0, sizeof(seen));
+    inspect_raw = NULL;
+    live.lines = 3;
+    live.period_ms = 100;
+    cli_len = 0;
+    cli_total = 0;
+    task_next = stub_tick;
+}
+
+/* 测试 ---------------------------------------------------------------------*/
+
+/*
+ * 持久连接: 一个连接上连续处理请求, 空闲 WIZ_HTTP_IDLE_MS 后关闭;
+ * 第 WIZ_HTTP_KEEPALIVE_MAX 个应答带 Connection: close
+ */
+static void test_keepalive(void)
+{
+    static struct resp r;
+    wiz_http_stats_t st;
+    uint32_t i, opens;
+
+    setup();
+    CHECK(client_connect(0));
+    opens = wiz_sim.sock[SN].opens;
+    for (i = 0; i < 20; i++)
+    {
+        CHECK(request("GET /api/status HTTP/1.1\r\n" BROWSER_HEADERS "\r\n", &r));
+        CHECK_EQ(r.status, 200);
+        CHECK(r.keep_alive);
+        CHECK(header_is(&r, "Content-Type", "application/json"));
+        CHECK(header_is(&r, "Keep-Alive", "timeout=15"));
+        CHECK_EQ(r.content_length, r.body_len);
+    }
+    CHECK(client_connected());
+    CHECK_EQ(wiz_sim.sock[SN].opens, opens);
+    wiz_http_get_stats(&st);
+    CHECK_EQ(st.connections, 1);
+    CHECK_EQ(st.requests, 20);
+    CHECK_EQ(st.reused, 19);
+    CHECK(memcmp(r.body, "{\"uptime_ms\":", 13) == 0);
+
+    /* 空闲超时 */
+    run_ms(WIZ_HTTP_IDLE_MS - 100);
+    CHECK(client_connected());
+    CHECK(wait_closed(200));
+    wiz_http_get_stats(&st);
+    CHECK_EQ(st.timeouts, 1);
+
+    /* 每个连接最多 WIZ_HTTP_KEEPALIVE_MAX 个请求 */
+    CHECK(client_connect(0));
+    for (i = 1; i <= WIZ_HTTP_KEEPALIVE_MAX; i++)
+    {
+        CHECK(request("GET /api/status HTTP/1.1\r\nHost: x\r\n\r\n", &r));
+        if (i < WIZ_HTTP_KEEPALIVE_MAX)
+            CHECK(r.keep_alive);
+    }
+    CHECK(r.close);
+    CHECK(wait_closed(100));
+    wiz_http_get_stats(&st);
+    CHECK_EQ(st.connections, 2);
+    CHECK_EQ(st.requests, 20 + WIZ_HTTP_KEEPALIVE_MAX);
+}
+
+/* 流水线: 一个报文中的多个请求按顺序应答; 请求之间的空行忽略 */
+static void test_pipelining(void)
+{
+    static struct resp r;
+    static const char batch[] =
+        "GET /api/status HTTP/1.1\r\nHost: x\r\n\r\n"
+        "\r\n"
+        "POST /echo HTTP/1.1\r\nHost: x\r\nContent-Length: 11\r\n\r\nhello world"
+        "HEAD /index.html HTTP/1.1\r\nHost: x\r\n\r\n"
+        "GET /api/status HTTP/1.1\r\nHost: x\r\nConnection: close\r\n\r\n";
+
+    setup();
+    CHECK(client_connect(0));
+    client_puts(batch);
+    CHECK(get_response(&r, 0, RESP_TIMEOUT_MS));
+    CHECK_EQ(r.status, 200);
+    CHECK(memcmp(r.body, "{\"uptime_ms\":", 13) == 0);
+    CHECK(get_response(&r, 0, RESP_TIMEOUT_MS));
+    CHECK_EQ(r.status, 200);
+    CHECK_EQ(r.body_len, 11);
+    CHECK_MEM(r.body, "hello world", 11);
+    CHECK(get_response(&r, 1, RESP_TIMEOUT_MS));
+    CHECK_EQ(r.status, 200);
+    CHECK_EQ(r.content_length, Web_Assets[0].len);
+    CHECK(get_response(&r, 0, RESP_TIMEOUT_MS));
+    CHECK_EQ(r.status, 200);
+    CHECK(r.close);
+    CHECK(memcmp(r.body, "{\"uptime_ms\":", 13) == 0);
+    CHECK(wait_closed(100));
+    CHECK_EQ(cli_len, 0);
+    CHECK_EQ(status_hits, 2);
+}
+
+/*
+ * 请求逐字节到达: 增量解析只在收齐后处理一次, 解析结果指向未修改的请求缓冲区;
+ * 请求体分段到达
+ */
+static void test_incremental(void)
+{
+    static struct resp r;
+    static const char raw[] =
+        "GET /inspect/a?x=1&y=a%20b+c HTTP/1.1\r\n"
+        "Host: 192.168.1.50\r\n"
+        "If-None-Match: \"abc\"\r\n"
+        "\r\n";
+    static const char post_hdr[] = "POST /echo HTTP/1.1\r\nContent-Length: 200\r\n\r\n";
+    static uint8_t body[200];
+    uint32_t i;
+
+    setup();
+    CHECK(client_connect(0));
+    inspect_raw = raw;
+    inspect_len = sizeof(raw) - 1;
+    for (i = 0; i < sizeof(raw) - 1; i++)
+    {
+        client_send(&raw[i], 1);
+        run_ms(3);
+        CHECK_EQ(seen.called, (i == sizeof(raw) - 2) ? 1 : 0);
+    }
+    CHECK(get_response(&r, 0, RESP_TIMEOUT_MS));
+    CHECK_EQ(r.status, 204);
+    CHECK(seen.intact);
+    CHECK_EQ(seen.method, WIZ_HTTP_GET);
+    CHECK(strcmp(seen.path, "/inspect/a") == 0);
+    CHECK(strcmp(seen.query, "x=1&y=a%20b+c") == 0);
+    CHECK(strcmp(seen.y, "a b c") == 0);
+    CHECK(strcmp(seen.inm, "\"abc\"") == 0);
+
+    /* 单独的 LF 作为行尾也接受 */
+    inspect_raw = NULL;
+    CHECK(request("GET /inspect HTTP/1.1\nHost: x\n\n", &r));
+    CHECK_EQ(r.status, 204);
+    CHECK_EQ(seen.called, 2);
+
+    for (i = 0; i < sizeof(body); i++)
+        body[i] = (uint8_t)(i * 13);
+    client_puts(post_hdr);
+    for (i = 0; i < 4; i++)
+    {
+        run_ms(50);
+        CHECK_EQ(cli_len, 0);
+        client_send(&body[i * 50], 50);
+    }
+    CHECK(get_response(&r, 0, RESP_TIMEOUT_MS));
+    CHECK_EQ(r.status, 200);
+    CHECK_EQ(r.body_len, sizeof(body));
+    CHECK_MEM(r.body, body, sizeof(body));
+}
+
+/* 压缩资源: gzip 内容直接从 flash 发送, ETag 匹配时 304, 不接受 gzip 时 406 */
+static void test_assets(void)
+{
+    static struct resp r;
+    char req[256];
+    const wiz_http_asset_t *a = &Web_Assets[0];
+    wiz_http_stats_t st;
+
+    setup();
+    CHECK(Web_AssetCount >= 1);
+    CHECK(strcmp(a->path, "/index.html") == 0);
+    CHECK(a->gzip && a->data[0] == 0x1F && a->data[1] == 0x8B);
+
+    CHECK(request("GET / HTTP/1.1\r\n" BROWSER_HEADERS "\r\n", &r));
+    CHECK_EQ(r.status, 200);
+    CHECK(header_is(&r, "Content-Encoding", "gzip"));
+    CHECK(header_is(&r, "Vary", "Accept-Encoding"));
+    CHECK(header_is(&r, "ETag", a->etag));
+    CHECK(header_is(&r, "Content-Type", a->content_type));
+    CHECK_EQ(r.body_len, a->len);
+    CHECK_MEM(r.body, a->data, a->len);
+
+    /* 浏览器重新验证 */
+    snprintf(req, sizeof(req), "GET /index.html HTTP/1.1\r\nHost: x\r\nIf-None-Match: W/\"0\", %s\r\n\r\n", a->etag);
+    CHECK(request(req, &r));
+    CHECK_EQ(r.status, 304);
+    CHECK(header_is(&r, "ETag", a->etag));
+    CHECK(header(&r, "Content-Encoding") == NULL);
+    CHECK(header(&r, "Content-Length") == NULL);
+    CHECK(request("GET / HTTP/1.1\r\nHost: x\r\nIf-None-Match: \"00000000\"\r\n\r\n", &r));
+    CHECK_EQ(r.status, 200);
+    CHECK(request("GET / HTTP/1.1\r\nHost: x\r\nIf-None-Match: *\r\n\r\n", &r));
+    CHECK_EQ(r.status, 304);
+
+    CHECK(request("GET / HTTP/1.1\r\nHost: x\r\nAccept-Encoding: identity\r\n\r\n", &r));
+    CHECK_EQ(r.status, 406);
+    CHECK(request("HEAD / HTTP/1.1\r\nHost: x\r\n\r\n", &r));
+    CHECK_EQ(r.status, 200);
+    CHECK_EQ(r.content_length, a->len);
+    CHECK(request("POST / HTTP/1.1\r\nHost: x\r\n\r\n", &r));
+    CHECK_EQ(r.status, 405);
+    CHECK(request("GET /missing.js HTTP/1.1\r\nHost: x\r\n\r\n", &r));
+    CHECK_EQ(r.status, 404);
+    CHECK(request("GET /echo HTTP/1.1\r\nHost: x\r\n\r\n", &r));
+    CHECK_EQ(r.status, 405);
+
+    /* HEAD 之后没有残留内容, 同一连接继续可用 */
+    CHECK(client_connected());
+    CHECK_EQ(cli_len, 0);
+    wiz_http_get_stats(&st);
+    CHECK_EQ(st.connections, 1);
+    CHECK_EQ(st.not_modified, 2);
+    CHECK_EQ(st.bad_requests, 4);
+}
+
+/*
+ * 分块传输: 持续产生的数据逐块发出, 解码后与产生的数据一致; 回调等待期间不因空闲关闭;
+ * 大块数据受发送队列限流; HTTP/1.0 不分块, 以关闭连接结束
+ */
+static void test_chunked(void)
+{
+    static struct resp r;
+    char expect[256];
+    wiz_http_stats_t st;
+    uint32_t i, n, t0;
+
+    setup();
+    live.lines = 5;
+    live.period_ms = 1000;
+    t0 = stub_tick;
+    CHECK(request("GET /live HTTP/1.1\r\nHost: x\r\n\r\n", &r));
+    CHECK_EQ(r.status, 200);
+    CHECK(r.chunked);
+    CHECK(r.keep_alive);
+    CHECK(header(&r, "Content-Length") == NULL);
+    CHECK_EQ(r.chunks, 5);
+    for (i = 0, n = 0; i < 5; i++)
+        n += (uint32_t)snprintf(&expect[n], sizeof(expect) - n, "{\"seq\":%lu}\n", (unsigned long)i);
+    CHECK_EQ(r.body_len, n);
+    CHECK_MEM(r.body, expect, n);
+    CHECK(stub_tick - t0 >= 4000 && stub_tick - t0 < 4100);
+    CHECK(live.waits > 0);
+
+    /* 分块之后同一连接继续处理请求 */
+    CHECK(request("GET /api/status HTTP/1.1\r\nHost: x\r\n\r\n", &r));
+    CHECK_EQ(r.status, 200);
+
+    /* 数据间隔长于空闲超时 */
+    live.lines = 2;
+    live.period_ms = WIZ_HTTP_IDLE_MS + 5000;
+    client_puts("GET /live HTTP/1.1\r\nHost: x\r\n\r\n");
+    CHECK(get_response(&r, 0, live.period_ms + 1000));
+    CHECK_EQ(r.chunks, 2);
+    wiz_http_get_stats(&st);
+    CHECK_EQ(st.timeouts, 0);
+    CHECK(client_connected());
+
+    /* 发送队列只有 WIZ_HTTP_TXQ_SIZE, 大量数据分多块, 每块不超过 WIZ_HTTP_CHUNK_MAX */
+    CHECK(request("GET /big HTTP/1.1\r\nHost: x\r\n\r\n", &r));
+    CHECK_EQ(r.status, 200);
+    CHECK_EQ(r.body_len, BIG_LEN);
+    for (i = 0, n = 0; i < BIG_LEN; i++)
+        n += (r.body[i] != big_byte(i));
+    CHECK_EQ(n, 0);
+    CHECK(r.max_chunk <= WIZ_HTTP_CHUNK_MAX);
+    CHECK(big.max_size <= WIZ_HTTP_CHUNK_MAX);
+    CHECK(r.chunks >= (BIG_LEN + WIZ_HTTP_CHUNK_MAX - 1) / WIZ_HTTP_CHUNK_MAX);
+
+    /* HEAD 不调用回调 */
+    live.lines = 3;
+    live.period_ms = 10;
+    live.sent = 0;
+    CHECK(request("HEAD /live HTTP/1.1\r\nHost: x\r\n\r\n", &r));
+    CHECK(r.chunked);
+    run_ms(100);
+    CHECK_EQ(live.sent, 0);
+    CHECK_EQ(cli_len, 0);
+
+    /* HTTP/1.0 */
+    CHECK(request("GET /live HTTP/1.0\r\nHost: x\r\n\r\n", &r));
+    CHECK_EQ(r.status, 200);
+    CHECK(!r.chunked);
+    CHECK(r.close);
+    CHECK_EQ(r.body_len, (uint32_t)strlen("{\"seq\":0}\n{\"seq\":1}\n{\"seq\":2}\n"));
+    CHECK_MEM(r.body, "{\"seq\":0}\n{\"seq\":1}\n{\"seq\":2}\n", r.body_len);
+    CHECK(!client_connected());
+    wiz_http_get_stats(&st);
+    CHECK_EQ(st.connections, 1);
+}
+
+/* HTTP/1.0 只在带 keep-alive 时保持连接; Connection: close 应答后关闭 */
+static void test_connection_header(void)
+{
+    static struct resp r;
+
+    setup();
+    CHECK(request("GET /api/status HTTP/1.0\r\n\r\n", &r));
+    CHECK(r.close);
+    CHECK(wait_closed(100));
+    CHECK(request("GET /api/status HTTP/1.0\r\nConnection: Keep-Alive\r\n\r\n", &r));
+    CHECK(r.keep_alive);
+    CHECK(request("GET /api/status HTTP/1.1\r\nConnection: TE, close\r\n\r\n", &r));
+    CHECK(r.close);
+    CHECK(wait_closed(100));
+}
+
+/* 错误应答: 格式错误和过长的请求应答后关闭连接 */
+static void test_errors(void)
+{
+    static const struct
+    {
+        const char *raw;
+        int status;
+        uint8_t keep;
+    } cases[] = {
+        {"BLAH\r\n\r\n", 400, 0},
+        {"GET index.html HTTP/1.1\r\n\r\n", 400, 0},
+        {"GET / HTTP/2.0\r\n\r\n", 505, 0},
+        {"GET / HTTP/1.1\r\n folded\r\n\r\n", 400, 0},
+        {"GET / HTTP/1.1\r\nNoColon\r\n\r\n", 400, 0},
+        {"POST /echo HTTP/1.1\r\nContent-Length: 300\r\n\r\n", 413, 0},
+        {"POST /echo HTTP/1.1\r\nContent-Length: 1x\r\n\r\n", 400, 0},
+        {"POST /echo HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n", 501, 0},
+        {"PUT /echo HTTP/1.1\r\n\r\n", 405, 1},
+        {"GET /noreply HTTP/1.1\r\n\r\n", 500, 1},
+    };
+    static struct resp r;
+    static char big_req[1024];
+    wiz_http_stats_t st;
+    uint32_t i;
+
+    for (i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    {
+        setup();
+        CHECK(request(cases[i].raw, &r));
+        CHECK_EQ(r.status, cases[i].status);
+        CHECK_EQ(r.close, !cases[i].keep);
+        if (!cases[i].keep)
+            CHECK(wait_closed(100));
+        else
+            CHECK(client_connected());
+    }
+
+    /* 请求行填满缓冲区 */
+    setup();
+    memset(big_req, 'a', 900);
+    memcpy(big_req, "GET /", 5);
+    big_req[900] = '\0';
+    CHECK(request(big_req, &r));
+    CHECK_EQ(r.status, 414);
+    CHECK(wait_closed(100));
+
+    /* 头部填满缓冲区 */
+    setup();
+    memset(big_req, 'b', 900);
+    memcpy(big_req, "GET / HTTP/1.1\r\nX-Long: ", 24);
+    big_req[900] = '\0';
+    CHECK(request(big_req, &r));
+    CHECK_EQ(r.status, 431);
+
+    /* 请求未在 WIZ_HTTP_REQ_TIMEOUT_MS 内收齐 */
+    setup();
+    CHECK(client_connect(0));
+    client_puts("GET /api/status HTTP/1.1\r\nHo");
+    run_ms(WIZ_HTTP_REQ_TIMEOUT_MS - 100);
+    CHECK_EQ(cli_len, 0);
+    CHECK(get_response(&r, 0, 200));
+    CHECK_EQ(r.status, 408);
+    CHECK(wait_closed(100));
+    wiz_http_get_stats(&st);
+    CHECK_EQ(st.timeouts, 1);
+    CHECK_EQ(st.bad_requests, 1);
+    CHECK_EQ(status_hits, 0);
+}
+
+/* 对端关闭发送方向后仍应答已收到的请求; 抓包占用 socket 时连接被丢弃, 结束后恢复监听 */
+static void test_peer_close_and_capture(void)
+{
+    static struct resp r;
+    wiz_http_stats_t st;
+    uint32_t i;
+
+    setup();
+    CHECK(client_connect(0));
+    client_puts("GET /api/status HTTP/1.1\r\nHost: x\r\n\r\n");
+    wiz_sim_tcp_peer_close(SN);
+    CHECK(get_response(&r, 0, RESP_TIMEOUT_MS));
+    CHECK_EQ(r.status, 200);
+    CHECK(wait_closed(100));
+
+    CHECK(request("GET /api/status HTTP/1.1\r\nHost: x\r\n\r\n", &r));
+    capture_running = 1;
+    run_ms(10);
+    wiz_http_get_stats(&st);
+    CHECK_EQ(st.preempted, 1);
+    CHECK(!conn.open);
+    /* 抓包结束时由抓包模块关闭 socket */
+    capture_running = 0;
+    close(SN);
+    CHECK(request("GET /api/status HTTP/1.1\r\nHost: x\r\n\r\n", &r));
+    CHECK_EQ(r.status, 200);
+
+    /* 链路断开时只丢弃本地状态, 恢复后重新监听 */
+    net_up = 0;
+    run_ms(50);
+    CHECK(!conn.open);
+    wiz_sim_tcp_abort(SN);
+    net_up = 1;
+    for (i = 0; i < 100 && wiz_sim_sr(SN) != SOCK_LISTEN; i++)
+        step();
+    CHECK_EQ(wiz_sim_sr(SN), SOCK_LISTEN);
+    CHECK(request("GET /api/status HTTP/1.1\r\nHost: x\r\n\r\n", &r));
+    CHECK_EQ(r.status, 200);
+}
+
+/* 回放与基准 ---------------------------------------------------------------*/
+
+struct replay_result
+{
+    uint32_t requests;
+    uint32_t sim_ms;
+    uint32_t bytes_sent;
+    uint32_t bytes_received;
+    uint32_t connections;
+    double host_ns;
+};
+
+/*
+ * 仪表盘会话: 打开页面 (第一次 200, 之后带 If-None-Match 得到 304),
+ * 然后轮询状态 REPLAY_POLLS 次; keep_alive=0 时每个请求带 Connection: close
+ */
+static void replay(uint8_t keep_alive, struct replay_result *res)
+{
+    static struct resp r;
+    static char req[768];
+    const char *conn_hdr = keep_alive ? "Connection: keep-alive\r\n" : "Connection: close\r\n";
+    wiz_http_stats_t st;
+    unsigned long long t0;
+    uint32_t s, i, tick0;
+    uint8_t ok = 1;
+
+    setup();
+    wiz_sim.sock[SN].rtt_ms = REPLAY_RTT_MS;
+    wiz_sim.sock[SN].rate = REPLAY_RATE;
+    tick0 = stub_tick;
+    t0 = test_now_ns();
+    res->requests = 0;
+    for (s = 0; s < REPLAY_SESSIONS && ok; s++)
+    {
+        for (i = 0; i <= REPLAY_POLLS && ok; i++)
+        {
+            if (i == 0)
+                snprintf(req, sizeof(req), "GET / HTTP/1.1\r\n" BROWSER_HEADERS "%s%s%s%s\r\n", conn_hdr,
+                         s ? "If-None-Match: " : "", s ? Web_Assets[0].etag : "", s ? "\r\n" : "");
+            else
+                snprintf(req, sizeof(req), "GET /api/status HTTP/1.1\r\n" BROWSER_HEADERS "%s\r\n", conn_hdr);
+            if (!client_connected())
+                ok = client_connect(REPLAY_RTT_MS);
+            ok = ok && request(req, &r);
+            ok = ok && r.status == ((i == 0) ? (s ? 304 : 200) : 200);
+            if (ok && r.close)
+                ok = wait_closed(100);
+            res->requests++;
+        }
+    }
+    res->host_ns = (double)(test_now_ns() - t0) / res->requests;
+    res->sim_ms = stub_tick - tick0;
+    wiz_http_get_stats(&st);
+    res->bytes_sent = st.bytes_sent;
+    res->bytes_received = cli_total;
+    res->connections = st.connections;
+    CHECK(ok);
+    CHECK_EQ(st.requests, res->requests);
+}
+
+static void test_replay(void)
+{
+    struct replay_result ka, cl;
+    uint32_t total = REPLAY_SESSIONS * (REPLAY_POLLS + 1);
+
+    replay(1, &ka);
+    replay(0, &cl);
+    CHECK_EQ(ka.requests, total);
+    CHECK_EQ(cl.requests, total);
+    CHECK_EQ(ka.connections, (total + WIZ_HTTP_KEEPALIVE_MAX - 1) / WIZ_HTTP_KEEPALIVE_MAX);
+    CHECK_EQ(cl.connections, total);
+    CHECK(ka.sim_ms < cl.sim_ms);
+    CHECK_EQ(ka.bytes_received, ka.bytes_sent);
+    CHECK_EQ(cl.bytes_received, cl.bytes_sent);
+
+    printf("  replay keep-alive: %lu requests on %lu connections, %.1f req/s simulated, "
+           "%lu bytes sent, host %.2f us/request\n",
+           (unsigned long)ka.requests, (unsigned long)ka.connections, ka.requests * 1000.0 / ka.sim_ms,
+           (unsigned long)ka.bytes_sent, ka.host_ns / 1000.0);
+    printf("  replay close     : %lu requests on %lu connections, %.1f req/s simulated, "
+           "%lu bytes sent, host %.2f us/request\n",
+           (unsigned long)cl.requests, (unsigned long)cl.connections, cl.requests * 1000.0 / cl.sim_ms,
+           (unsigned long)cl.bytes_sent, cl.host_ns / 1000.0);
+}
+
+/* 请求解析耗时: 一次到达和逐字节到达 (增量解析不重复扫描已检查的数据) */
+static void test_bench(void)
+{
+    static const char raw[] = "GET /api/status HTTP/1.1\r\n" BROWSER_HEADERS
+                              "Connection: keep-alive\r\nIf-None-Match: \"0123abcd\"\r\n\r\n";
+    uint16_t len = sizeof(raw) - 1, i;
+    unsigned long long t0;
+    double whole_ns, bytewise_ns;
+    volatile uint32_t sink = 0;
+    uint32_t n;
+
+    setup();
+    memcpy(conn.buf, raw, len);
+    t0 = test_now_ns();
+    for (n = 0; n < BENCH_ROUNDS; n++)
+    {
+        http_parse_reset(&conn);
+        conn.len = len;
+        http_parse(&conn);
+        sink += conn.parse;
+    }
+    whole_ns = (double)(test_now_ns() - t0) / BENCH_ROUNDS;
+    CHECK_EQ(conn.parse, HTTP_PARSE_DONE);
+    CHECK_EQ(conn.req_end, len);
+
+    t0 = test_now_ns();
+    for (n = 0; n < BENCH_ROUNDS / 10; n++)
+    {
+        http_parse_reset(&conn);
+        for (i = 1; i <= len; i++)
+        {
+            conn.len = i;
+            http_parse(&conn);
+        }
+        sink += conn.parse;
+    }
+    bytewise_ns = (double)(test_now_ns() - t0) / (BENCH_ROUNDS / 10);
+    CHECK_EQ(conn.parse, HTTP_PARSE_DONE);
+    CHECK_EQ(conn.error, 0);
+    CHECK_MEM(conn.buf, raw, len);
+
+    printf("  parse %u-byte request: %.0f ns at once, %.0f ns byte by byte\n",
+           (unsigned)len, whole_ns, bytewise_ns);
+}
+
+int main(void)
+{
+    TEST_RUN(test_keepalive);
+    TEST_RUN(test_pipelining);
+    TEST_RUN(test_incremental);
+    TEST_RUN(test_assets);
+    TEST_RUN(test_chunked);
+    TEST_RUN(test_connection_header);
+    TEST_RUN(test_errors);
+    TEST_RUN(test_peer_close_and_capture);
+    TEST_RUN(test_replay);
+    TEST_RUN(test_bench);
+    return test_summary("wiz_http");
+}
@@ -0,0 +1,281 @@
+/**
+  ******************************************************************************
+  * @file    test_wiz_sockbuf.c
+  * @brief   Socket Buffer Layout: Plan, Usage Sampling, Default vs Planned Throughput
+  ******************************************************************************
+  * @description
+  * 真实的缓冲区分配 (wiz_sockbuf.c)、发送队列 (wiz_txq.c)、TFTP 选项协商 (tftp.c) 和
+  * ioLibrary 运行在模拟 W5500 (wiz_sim.h) 上, 比较复位后的默认布局 (8 x 2KB) 和按
+  * 固件登记的用途计算的布局:
+  * - HTTP 大响应: socket 0 经 WIZ_HTTP_TXQ_SIZE 的发送队列持续写入, 对端往返 RTT_MS,
+  *   每个往返能发出的数据受片内 TX 缓冲区限制
+  * - TFTP 下载: socket 5 按 RX 缓冲区协商 blksize/windowsize, 服务器每个往返发出一个窗口
+  * 另外检查 wiz_sockbuf_poll 采样的占用峰值。
+  ******************************************************************************
+  */
+
+#include "test.h"
+#include "wiz_sim.h"
+#include "../../User/ioLibrary_Driver/Ethernet/wizchip_conf.c"
+#include "../../User/ioLibrary_Driver/Ethernet/W5500/w5500.c"
+#include "../../User/ioLibrary_Driver/Ethernet/socket.c"
+#include "../../User/ioLibrary_Driver/Internet/TFTP/netutil.c"
+#include "../../User/ioLibrary_Driver/Internet/TFTP/tftp.c"
+#include "../../User/wiz_interface/wiz_txq.c"
+#include "../../User/wiz_interface/wiz_sockbuf.c"
+#include "wiz_http.h"
+#include "wiz_dns.h"
+#include "wiz_dhcp.h"
+#include "time_sync.h"
+#include "ota.h"
+#include "../../User/snmp/snmp_agent.h"
+
+#define ETH_UPLINK_SOCK         1       /* uplink_eth.c */
+#define RTT_MS                  20
+#define PEER_RATE               1000    /* 对端每 ms 确认的字节数 (约 8Mbit/s) */
+#define RUN_MS                  2000
+
+static const uint8_t peer_ip[4] = {192, 168, 1, 10};
+
+static wiz_NetInfo conf = {
+    .mac = {0x00, 0x08, 0xDC, 0x12, 0x34, 0x56},
+    .ip = {192, 168, 1, 50},
+    .sn = {255, 255, 255, 0},
+    .gw = {192, 168, 1, 1},
+    .dhcp = NETINFO_STATIC,
+};
+
+/* tftp.c 的下载回调 */
+void save_data(uint8_t *data, uint32_t data_len, uint16_t block_number)
+{
+    (void)data;
+    (void)data_len;
+    (void)block_number;
+}
+
+static void wiz_sim_udp_out(uint8_t sn, const uint8_t ip[4], uint16_t port, const uint8_t *data, uint16_t len)
+{
+    (void)sn;
+    (void)ip;
+    (void)port;
+    (void)data;
+    (void)len;
+}
+
+/* 按 user_tasks.c 的初始化顺序登记用途 (Uplink_Eth_Init、TimeSync_Init、SNMP_Agent_Init) */
+static void set_firmware_roles(void)
+{
+    wiz_sockbuf_set_role(ETH_UPLINK_SOCK, WIZ_SOCK_ROLE_INTERACTIVE);
+    wiz_sockbuf_set_role(WIZ_DHCP_SOCK, WIZ_SOCK_ROLE_CONTROL);
+    wiz_sockbuf_set_role(WIZ_DNS_SOCK, WIZ_SOCK_ROLE_CONTROL);
+    wiz_sockbuf_set_role(WIZ_HTTP_SOCK, WIZ_SOCK_ROLE_BULK_TX);
+    wiz_sockbuf_set_role(TIME_SYNC_SNTP_SOCK, WIZ_SOCK_ROLE_BULK_RX);
+    wiz_sockbuf_set_role(SNMP_AGENT_SOCK, WIZ_SOCK_ROLE_CONTROL);
+}
+
+/* 上电并应用布局: planned 为 0 时保持复位后的默认用途 */
+static void setup(uint8_t planned)
+{
+    uint8_t sn;
+
+    wiz_sim_init();
+    for (sn = 0; sn < _WIZCHIP_SOCK_NUM_; sn++)
+        sock_roles[sn] = WIZ_SOCK_ROLE_INTERACTIVE;
+    memset(sock_stats, 0, sizeof(sock_stats));
+    memset(txq, 0, sizeof(txq));
+    if (planned)
+        set_firmware_roles();
+    CHECK_EQ(wiz_sockbuf_apply(), 0);
+    wizchip_setnetinfo(&conf);
+}
+
+/* 测试 ---------------------------------------------------------------------*/
+
+/* 固件用途的布局: 各方向合计 16KB, 每个大小都是 2 的幂, 与写入芯片的一致 */
+static void test_plan(void)
+{
+    static const uint8_t tx_expect[_WIZCHIP_SOCK_NUM_] = {4, 4, 2, 2, 1, 1, 1, 1};
+    static const uint8_t rx_expect[_WIZCHIP_SOCK_NUM_] = {1, 4, 2, 2, 1, 4, 1, 1};
+    uint8_t tx[_WIZCHIP_SOCK_NUM_], rx[_WIZCHIP_SOCK_NUM_];
+    uint8_t sn, role;
+
+    setup(1);
+    wiz_sockbuf_plan(tx, rx);
+    CHECK_MEM(tx, tx_expect, sizeof(tx));
+    CHECK_MEM(rx, rx_expect, sizeof(rx));
+    for (sn = 0; sn < _WIZCHIP_SOCK_NUM_; sn++)
+    {
+        CHECK_EQ(getSn_TXBUF_SIZE(sn), tx[sn]);
+        CHECK_EQ(getSn_RXBUF_SIZE(sn), rx[sn]);
+    }
+
+    /* 所有 socket 同一用途时也不超出 16KB */
+    for (role = 0; role < WIZ_SOCK_ROLE_MAX; role++)
+    {
+        for (sn = 0; sn < _WIZCHIP_SOCK_NUM_; sn++)
+            sock_roles[sn] = (wiz_sock_role_t)role;
+        wiz_sockbuf_plan(tx, rx);
+        CHECK(sockbuf_sum(tx) <= WIZ_SOCKBUF_TOTAL_KB);
+        CHECK(sockbuf_sum(rx) <= WIZ_SOCKBUF_TOTAL_KB);
+        for (sn = 0; sn < _WIZCHIP_SOCK_NUM_; sn++)
+        {
+            CHECK((tx[sn] & (tx[sn] - 1)) == 0);
+            CHECK((rx[sn] & (rx[sn] - 1)) == 0);
+        }
+    }
+}
+
+/* HTTP 大响应: 返回 RUN_MS 内对端确认的字节数 */
+static uint32_t http_bulk(uint8_t planned, wiz_sockbuf_stats_t *stats)
+{
+    static uint8_t queue[WIZ_HTTP_TXQ_SIZE];
+    uint8_t data[WIZ_HTTP_TXQ_SIZE];
+    uint8_t buf[512];
+    uint16_t n, i;
+    uint32_t t;
+
+    setup(planned);
+    wiz_sim.sock[WIZ_HTTP_SOCK].rate = PEER_RATE;
+    wiz_sim.sock[WIZ_HTTP_SOCK].rtt_ms = RTT_MS;
+    socket(WIZ_HTTP_SOCK, Sn_MR_TCP, WIZ_HTTP_PORT, SF_IO_NONBLOCK);
+    connect(WIZ_HTTP_SOCK, (uint8_t *)peer_ip, 50000);
+    wiz_sim_tick(wiz_sim.sock[WIZ_HTTP_SOCK].connect_ms);
+    CHECK_EQ(getSn_SR(WIZ_HTTP_SOCK), SOCK_ESTABLISHED);
+    CHECK_EQ(wiz_txq_open(WIZ_HTTP_SOCK, queue, sizeof(queue)), 0);
+
+    for (i = 0; i < sizeof(data); i++)
+        data[i] = (uint8_t)i;
+    for (t = 0; t < RUN_MS; t++)
+    {
+        /* 响应内容总是就绪, 队列有空间就写 */
+        n = wiz_txq_free(WIZ_HTTP_SOCK);
+        if (n > 0)
+            wiz_txq_write(WIZ_HTTP_SOCK, data, n, 0);
+        wiz_txq_poll_socket(WIZ_HTTP_SOCK);
+        if ((t % 10) == 0)
+            wiz_sockbuf_poll();
+        wiz_sim_tick(1);
+        while (wiz_sim_take(WIZ_HTTP_SOCK, buf, sizeof(buf)) > 0)
+            ;
+    }
+    wiz_sockbuf_get_stats(WIZ_HTTP_SOCK, stats);
+    return wiz_sim.sock[WIZ_HTTP_SOCK].acked_bytes;
+}
+
+static void test_http_throughput(void)
+{
+    wiz_sockbuf_stats_t def_st, plan_st;
+    uint32_t def, plan;
+
+    def = http_bulk(0, &def_st);
+    plan = http_bulk(1, &plan_st);
+
+    CHECK_EQ(def_st.tx_kb, 2);
+    CHECK_EQ(plan_st.tx_kb, 4);
+    /* 每个往返发出的数据接近片内 TX 缓冲区大小 */
+    CHECK(def_st.tx_peak > 2048 - WIZ_HTTP_TXQ_SIZE);
+    CHECK(plan_st.tx_peak > 4096 - WIZ_HTTP_TXQ_SIZE);
+    CHECK(def > (uint32_t)RUN_MS / (RTT_MS + 3) * 2048 * 8 / 10);
+    CHECK(plan * 10 > def * 17);
+    printf("  http bulk, RTT %u ms: default %u KB TX %5lu KB/s, planned %u KB TX %5lu KB/s\n",
+           RTT_MS, def_st.tx_kb, (unsigned long)(def / RUN_MS), plan_st.tx_kb,
+           (unsigned long)(plan / RUN_MS));
+}
+
+/*
+ * TFTP 下载: 服务器每个往返发出协商的一个窗口 (每块 4 字节头 + blksize), 客户端每 ms
+ * 用 recvfrom 取出。返回 RUN_MS 内收到的数据字节数, 窗口中放不进 RX 缓冲区的块计入 drops。
+ */
+static uint32_t tftp_download(uint8_t planned, uint16_t *blk, uint16_t *window, uint32_t *drops)
+{
+    uint8_t pkt[4 + TFTP_BLK_SIZE_MAX];
+    uint8_t ip[4];
+    uint16_t port, k;
+    int32_t len;
+    uint32_t t, bytes = 0;
+
+    setup(planned);
+    socket(OTA_TFTP_SOCK, Sn_MR_UDP, TFTP_TEMP_PORT, 0);
+    g_tftp_socket = OTA_TFTP_SOCK;
+    set_tftp_option();
+    *blk = g_req_blk_size;
+    *window = g_req_window;
+    *drops = 0;
+
+    memset(pkt, 0, sizeof(pkt));
+    for (t = 0; t < RUN_MS; t++)
+    {
+        if ((t % RTT_MS) == 0)
+        {
+            for (k = 0; k < *window; k++)
+            {
+                if (!wiz_sim_udp_in(OTA_TFTP_SOCK, peer_ip, 50001, pkt, (uint16_t)(4 + *blk)))
+                    (*drops)++;
+            }
+        }
+        while (getSn_RX_RSR(OTA_TFTP_SOCK) > 0)
+        {
+            len = recvfrom(OTA_TFTP_SOCK, pkt, sizeof(pkt), ip, &port);
+            if (len > 4)
+                bytes += (uint32_t)len - 4;
+        }
+        wiz_sockbuf_poll();
+        wiz_sim_tick(1);
+    }
+    return bytes;
+}
+
+static void test_tftp_throughput(void)
+{
+    uint16_t def_blk, def_win, plan_blk, plan_win;
+    uint32_t def, plan, def_drops, plan_drops;
+
+    def = tftp_download(0, &def_blk, &def_win, &def_drops);
+    plan = tftp_download(1, &plan_blk, &plan_win, &plan_drops);
+
+    CHECK_EQ(def_drops, 0);
+    CHECK_EQ(plan_drops, 0);
+    CHECK(def_win >= 1);
+    CHECK(plan_win > def_win);
+    CHECK(plan > def * 2);
+    printf("  tftp download, RTT %u ms: default blksize %u x %u %4lu KB/s, planned blksize %u x %u %4lu KB/s\n",
+           RTT_MS, def_blk, def_win, (unsigned long)(def / RUN_MS), plan_blk, plan_win,
+           (unsigned long)(plan / RUN_MS));
+}
+
+/* 采样记录 RX 占用峰值, 关闭的 socket 不采样, 清零统计保留当前大小 */
+static void test_poll_sampling(void)
+{
+    uint8_t pkt[256];
+    wiz_sockbuf_stats_t st;
+
+    setup(1);
+    socket(WIZ_DNS_SOCK, Sn_MR_UDP, 53000, 0);
+    memset(pkt, 0, sizeof(pkt));
+    while (wiz_sim_udp_in(WIZ_DNS_SOCK, peer_ip, 53, pkt, 120))
+        ;
+    while (wiz_sim_udp_in(WIZ_DNS_SOCK, peer_ip, 53, pkt, 1))
+        ;
+    wiz_sockbuf_poll();
+    wiz_sockbuf_get_stats(WIZ_DNS_SOCK, &st);
+    CHECK_EQ(st.rx_kb, 1);
+    CHECK(st.rx_peak >= 1024 - 8);
+    CHECK_EQ(st.samples, 1);
+
+    wiz_sockbuf_get_stats(WIZ_DHCP_SOCK, &st);
+    CHECK_EQ(st.samples, 0);
+
+    wiz_sockbuf_reset_stats();
+    wiz_sockbuf_get_stats(WIZ_DNS_SOCK, &st);
+    CHECK_EQ(st.rx_kb, 1);
+    CHECK_EQ(st.rx_peak, 0);
+}
+
+int main(void)
+{
+    TEST_RUN(test_plan);
+    TEST_RUN(test_http_throughput);
+    TEST_RUN(test_tftp_throughput);
+    TEST_RUN(test_poll_sampling);
+    return test_summary("wiz_sockbuf");
+}
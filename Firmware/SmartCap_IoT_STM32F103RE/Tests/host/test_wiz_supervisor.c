@@ -0,0 +1,445 @@
+/**
+  ******************************************************************************
+  * @file    test_wiz_supervisor.c
+  * @brief   W5500 Supervisor Fault Recovery on the Simulated Chip
+  ******************************************************************************
+  * @description
+  * 真实的链路监控 (wiz_supervisor.c)、发送队列 (wiz_txq.c) 和 ioLibrary 运行在模拟 W5500
+  * (wiz_sim.h) 上。默认任务每 500ms 调用 wiz_supervisor_poll; 拥有者任务每毫秒处理重开请求,
+  * 经 TCP socket 的发送队列持续写入 (对端确认慢于写入, 故障时总有未完成的 SEND),
+  * 并每 200ms 从 UDP socket 发一个报文。故障场景:
+  * - 网线断开后恢复
+  * - PHY 挂死: 网线接回后 PHY 不报告链路, 需要监控复位 PHY
+  * - 寄存器被改写: SHAR/SIPR 变成错误值
+  * - 芯片无响应: SPI 读取全为 0xFF, 硬件复位后恢复
+  * 每个场景检查: 恢复到 UP 的耗时、socket 只由拥有者任务操作 (foreign_cmds 为 0)、
+  * 重开时发送队列没有残留的 SEND 状态、恢复后数据继续送达对端。
+  ******************************************************************************
+  */
+
+#include "test.h"
+#include "wiz_sim.h"
+#include "../../User/ioLibrary_Driver/Ethernet/wizchip_conf.c"
+#include "../../User/ioLibrary_Driver/Ethernet/W5500/w5500.c"
+#include "../../User/ioLibrary_Driver/Ethernet/socket.c"
+#include "../../User/wiz_interface/wiz_txq.c"
+#include "../../User/wiz_interface/wiz_supervisor.c"
+
+#define MONITOR_PERIOD_MS       500
+#define TCP_SOCK                3
+#define UDP_SOCK                2
+#define TCP_PORT                50003
+#define UDP_PORT                50002
+#define WRITE_RATE              32      /* 拥有者每 ms 写入的字节数 */
+#define PEER_RATE               4       /* 对端每 ms 确认的字节数 */
+#define UDP_PERIOD_MS           200
+#define RECONNECT_MS            1000
+
+#define TASK_DEFAULT            1
+#define TASK_OWNER              2
+
+static const uint8_t peer_ip[4] = {192, 168, 1, 10};
+
+static wiz_NetInfo conf = {
+    .mac = {0x00, 0x08, 0xDC, 0x12, 0x34, 0x56},
+    .ip = {192, 168, 1, 50},
+    .sn = {255, 255, 255, 0},
+    .gw = {192, 168, 1, 1},
+    .dns = {192, 168, 1, 1},
+    .dhcp = NETINFO_STATIC,
+};
+
+/* 平台和网络接口 -------------------------------------------------------------*/
+
+static uint32_t lock_errors;            /* 阻塞等待时锁被占用, 或释放了不属于自己的锁 */
+static uint32_t chip_hw_resets;
+static uint32_t udp_frames;
+
+uint8_t wizchip_acquire(uint32_t timeout_ms)
+{
+    if (wiz_sim.lock_owner != 0)
+    {
+        /* 各任务顺序运行, 阻塞等待时锁应当是空闲的 */
+        if (timeout_ms != 0)
+            lock_errors++;
+        return 0;
+    }
+    wiz_sim.lock_owner = wiz_sim.task;
+    return 1;
+}
+
+void wizchip_release(void)
+{
+    if (wiz_sim.lock_owner != wiz_sim.task)
+        lock_errors++;
+    wiz_sim.lock_owner = 0;
+}
+
+/* RSTn 脉冲: 寄存器回到上电值; 故障未消失时 (hung) 芯片仍无响应 */
+void wizchip_reset(void)
+{
+    wiz_sim_power_reset();
+    chip_hw_resets++;
+}
+
+void print_network_information(void)
+{
+}
+
+void network_init(uint8_t *ethernet_buff, wiz_NetInfo *conf_info)
+{
+    (void)ethernet_buff;
+    wizchip_setnetinfo(conf_info);
+}
+
+uint32_t wiz_timer_get_ms(void)
+{
+    return stub_tick;
+}
+
+void wiz_dhcp_stop(void)
+{
+}
+
+uint8_t wiz_dhcp_has_address(void)
+{
+    return 1;
+}
+
+uint8_t wiz_dhcp_take_changed(void)
+{
+    return 0;
+}
+
+int8_t wiz_sockbuf_apply(void)
+{
+    return 0;
+}
+
+static void wiz_sim_udp_out(uint8_t sn, const uint8_t ip[4], uint16_t port, const uint8_t *data, uint16_t len)
+{
+    (void)ip;
+    (void)port;
+    (void)data;
+    (void)len;
+    if (sn == UDP_SOCK)
+        udp_frames++;
+}
+
+/* 拥有者任务 -----------------------------------------------------------------*/
+
+static uint8_t tcp_buf[1024];
+static uint8_t tcp_queue;               /* 连接已建立, 发送队列已打开 */
+static uint32_t reconnect_at;
+static uint32_t reopens;
+static uint32_t stale_txq;              /* on_reopen 时发送队列仍有未完成的 SEND */
+static uint32_t stale_udp;
+static uint8_t owner_running;
+static uint8_t pattern;
+
+static void tcp_on_reopen(uint8_t sn)
+{
+    if (txq[sn].cmd_pending || txq[sn].sending || txq[sn].opened)
+        stale_txq++;
+    if (wiz_udp_send_busy(sn))
+        stale_udp++;
+    tcp_queue = 0;
+    connect(sn, (uint8_t *)peer_ip, 80);
+}
+
+static void udp_on_reopen(uint8_t sn)
+{
+    if (wiz_udp_send_busy(sn))
+        stale_udp++;
+}
+
+static void owner_task(void)
+{
+    uint8_t data[WRITE_RATE];
+    uint8_t i, sr;
+
+    if (wiz_supervisor_service_socket(TCP_SOCK) == 1)
+        reopens++;
+    if (wiz_supervisor_service_socket(UDP_SOCK) == 1)
+        reopens++;
+
+    if (!wizchip_acquire(0))
+        return;
+
+    sr = getSn_SR(TCP_SOCK);
+    if (sr == SOCK_ESTABLISHED && !tcp_queue)
+    {
+        wiz_txq_open(TCP_SOCK, tcp_buf, sizeof(tcp_buf));
+        tcp_queue = 1;
+    }
+    else if (sr == SOCK_CLOSED && (int32_t)(stub_tick - reconnect_at) >= 0)
+    {
+        /* 对端超时关闭后自行重连 */
+        wiz_txq_close(TCP_SOCK);
+        tcp_queue = 0;
+        socket(TCP_SOCK, Sn_MR_TCP, TCP_PORT, SF_IO_NONBLOCK);
+        connect(TCP_SOCK, (uint8_t *)peer_ip, 80);
+        reconnect_at = stub_tick + RECONNECT_MS;
+    }
+
+    if (tcp_queue)
+    {
+        for (i = 0; i < sizeof(data); i++)
+            data[i] = pattern++;
+        wiz_txq_write(TCP_SOCK, data, sizeof(data), 0);
+        wiz_txq_poll_socket(TCP_SOCK);
+    }
+
+    if ((stub_tick % UDP_PERIOD_MS) == 0 && getSn_SR(UDP_SOCK) == SOCK_UDP)
+    {
+        wiz_udp_send_status(UDP_SOCK);
+        wiz_udp_send_nowait(UDP_SOCK, data, 48, peer_ip, 123);
+    }
+    wizchip_release();
+}
+
+/* 运行 ms 毫秒 */
+static void run(uint32_t ms)
+{
+    uint8_t buf[256];
+
+    while (ms--)
+    {
+        stub_tick++;
+        wiz_sim_tick(1);
+
+        if (owner_running)
+        {
+            wiz_sim.task = TASK_OWNER;
+            owner_task();
+        }
+        if ((stub_tick % MONITOR_PERIOD_MS) == 0)
+        {
+            wiz_sim.task = TASK_DEFAULT;
+            wiz_supervisor_poll();
+        }
+        wiz_sim.task = 0;
+
+        while (wiz_sim_take(TCP_SOCK, buf, sizeof(buf)) > 0)
+            ;
+    }
+}
+
+/* 运行直到条件成立或超过 limit 毫秒, 返回经过的时间 */
+#define RUN_UNTIL(cond, limit) ({ \
+    uint32_t _t = 0; \
+    while (!(cond) && _t < (limit)) { run(1); _t++; } \
+    _t; })
+
+static void setup(void)
+{
+    wiz_sim_init();
+    wiz_sim.cr_reads = 2;
+    wiz_sim.sock[TCP_SOCK].rate = PEER_RATE;
+    wiz_sim.sock[TCP_SOCK].owner = TASK_OWNER;
+    wiz_sim.sock[UDP_SOCK].owner = TASK_OWNER;
+
+    stub_tick = 0;
+    stub_kernel_running = 1;
+    lock_errors = 0;
+    chip_hw_resets = 0;
+    udp_frames = 0;
+    tcp_queue = 0;
+    reconnect_at = 0;
+    reopens = 0;
+    stale_txq = 0;
+    stale_udp = 0;
+    pattern = 0;
+
+    /* 被测模块的静态状态回到上电值 */
+    memset(txq, 0, sizeof(txq));
+    memset((void *)udp_send_busy, 0, sizeof(udp_send_busy));
+    memset(udp_cmd_pending, 0, sizeof(udp_cmd_pending));
+    memset(sup_socks, 0, sizeof(sup_socks));
+    sup_state = WIZ_SUP_STATE_INIT;
+    sup_need_network = 0;
+
+    wiz_sim.task = TASK_DEFAULT;
+    network_init(NULL, &conf);
+    wiz_supervisor_init(NULL, &conf);
+    wiz_supervisor_register_socket(TCP_SOCK, Sn_MR_TCP, TCP_PORT, SF_IO_NONBLOCK, tcp_on_reopen);
+    wiz_supervisor_register_socket(UDP_SOCK, Sn_MR_UDP, UDP_PORT, 0, udp_on_reopen);
+
+    wiz_sim.task = TASK_OWNER;
+    socket(UDP_SOCK, Sn_MR_UDP, UDP_PORT, 0);
+    wiz_sim.task = 0;
+
+    /* 初始化之后各任务都在锁内访问芯片 */
+    wiz_sim.need_lock = 1;
+    owner_running = 1;
+    run(2000);
+    CHECK_EQ(wiz_supervisor_get_state(), WIZ_SUP_STATE_UP);
+    CHECK(tcp_queue);
+    CHECK(wiz_sim.sock[TCP_SOCK].acked_bytes > 0);
+    CHECK(udp_frames > 0);
+}
+
+/* 故障时拥有者的发送队列正在等待 SEND_OK */
+static void check_busy(void)
+{
+    CHECK(txq[TCP_SOCK].sending);
+}
+
+/* 恢复后: socket 已由拥有者重开, 数据继续送达, 只有拥有者操作过 socket, 所有 SPI 帧都在锁内 */
+static void check_recovered(const char *name, uint32_t reopens_before)
+{
+    wiz_sup_stats_t stats;
+    uint32_t acked, frames;
+
+    wiz_supervisor_get_stats(&stats);
+    CHECK_EQ(wiz_supervisor_get_state(), WIZ_SUP_STATE_UP);
+    CHECK(reopens >= reopens_before + 2);
+    CHECK_EQ(stale_txq, 0);
+    CHECK_EQ(stale_udp, 0);
+
+    acked = wiz_sim.sock[TCP_SOCK].acked_bytes;
+    frames = udp_frames;
+    run(2000);
+    CHECK(wiz_sim.sock[TCP_SOCK].acked_bytes > acked + 1000);
+    CHECK(udp_frames >= frames + 5);
+
+    CHECK_EQ(wiz_sim.foreign_cmds, 0);
+    CHECK_EQ(wiz_sim.unlocked_frames, 0);
+    CHECK_EQ(lock_errors, 0);
+    printf("  %s: recovered in %lu ms, %lu reopens\n", name,
+           (unsigned long)stats.last_recovery_ms, (unsigned long)(reopens - reopens_before));
+}
+
+/* 测试 ---------------------------------------------------------------------*/
+
+/* 网线断开 2 秒: 断线期间不重开, 接回后下一次 poll 恢复并请求拥有者重开 */
+static void test_link_drop(void)
+{
+    wiz_sup_stats_t stats;
+    uint32_t before, t;
+
+    setup();
+    check_busy();
+    before = reopens;
+    wiz_sim.link = 0;
+    run(2000);
+    CHECK_EQ(wiz_supervisor_get_state(), WIZ_SUP_STATE_LINK_DOWN);
+    CHECK_EQ(reopens, before);
+
+    wiz_sim.link = 1;
+    t = RUN_UNTIL(wiz_supervisor_get_state() == WIZ_SUP_STATE_UP, 5000);
+    CHECK(t <= MONITOR_PERIOD_MS);
+    run(1);
+    wiz_supervisor_get_stats(&stats);
+    CHECK_EQ(stats.link_loss, 1);
+    CHECK_EQ(stats.phy_resets, 0);
+    check_recovered("link drop", before);
+}
+
+/* PHY 挂死: 网线接回后仍不报告链路, 断线 WIZ_SUP_PHY_RESET_MS 后复位 PHY */
+static void test_phy_hang(void)
+{
+    wiz_sup_stats_t stats;
+    uint32_t before, t;
+
+    setup();
+    check_busy();
+    before = reopens;
+    wiz_sim.link = 0;
+    run(1000);
+    wiz_sim.link = 1;
+    wiz_sim.phy_hung = 1;
+    t = RUN_UNTIL(wiz_supervisor_get_state() == WIZ_SUP_STATE_UP, 3 * WIZ_SUP_PHY_RESET_MS);
+    CHECK(t <= WIZ_SUP_PHY_RESET_MS);
+    CHECK_EQ(wiz_sim.phy_resets, 1);
+    run(1);
+    wiz_supervisor_get_stats(&stats);
+    CHECK_EQ(stats.phy_resets, 1);
+    CHECK_EQ(chip_hw_resets, 0);
+    check_recovered("phy hang", before);
+}
+
+/* SHAR/SIPR 被改写: 下一次 poll 发现 MAC 不符, 恢复寄存器并重开 */
+static void test_register_corruption(void)
+{
+    uint32_t before, t;
+    uint8_t mac[6], ip[4];
+
+    setup();
+    check_busy();
+    before = reopens;
+    memset(&wiz_sim.common[0x09], 0x5A, 6);
+    memset(&wiz_sim.common[0x0F], 0xA5, 4);
+    t = RUN_UNTIL(reopens >= before + 2, 5000);
+    CHECK(t <= MONITOR_PERIOD_MS + 1);
+
+    getSHAR(mac);
+    getSIPR(ip);
+    CHECK_MEM(mac, conf.mac, 6);
+    CHECK_MEM(ip, conf.ip, 4);
+    CHECK_EQ(chip_hw_resets, 0);
+    check_recovered("register corruption", before);
+}
+
+/*
+ * 芯片无响应 2 秒: 连续 WIZ_SUP_GLITCH_LIMIT 次读错 VERSIONR 后判定失联, 每次 poll 硬件复位,
+ * 恢复后重新配置。无响应期间拥有者任务暂停 (socket.c 的 close 会一直等待 Sn_CR 清零)。
+ */
+static void test_chip_hang(void)
+{
+    wiz_sup_stats_t stats;
+    uint32_t before, t;
+
+    setup();
+    check_busy();
+    before = reopens;
+    owner_running = 0;
+    wiz_sim.hung = 1;
+    run(MONITOR_PERIOD_MS * WIZ_SUP_GLITCH_LIMIT);
+    CHECK_EQ(wiz_supervisor_get_state(), WIZ_SUP_STATE_CHIP_LOST);
+    run(2000 - MONITOR_PERIOD_MS * WIZ_SUP_GLITCH_LIMIT);
+    CHECK(chip_hw_resets > 0);
+
+    wiz_sim.hung = 0;
+    t = RUN_UNTIL(wiz_supervisor_get_state() == WIZ_SUP_STATE_UP, 5000);
+    CHECK(t <= MONITOR_PERIOD_MS);
+    owner_running = 1;
+    run(1);
+    wiz_supervisor_get_stats(&stats);
+    CHECK(stats.spi_glitches >= WIZ_SUP_GLITCH_LIMIT);
+    check_recovered("chip hang", before);
+}
+
+/* 单次读错不判定失联, 不复位、不重开 */
+static void test_spi_glitch(void)
+{
+    wiz_sup_stats_t stats;
+    uint32_t before;
+
+    setup();
+    before = reopens;
+    owner_running = 0;
+    run(MONITOR_PERIOD_MS - (stub_tick % MONITOR_PERIOD_MS) - 1);
+    wiz_sim.hung = 1;
+    run(1);
+    wiz_sim.hung = 0;
+    owner_running = 1;
+    run(2000);
+
+    wiz_supervisor_get_stats(&stats);
+    CHECK_EQ(stats.spi_glitches, 1);
+    CHECK_EQ(wiz_supervisor_get_state(), WIZ_SUP_STATE_UP);
+    CHECK_EQ(chip_hw_resets, 0);
+    CHECK_EQ(reopens, before);
+    CHECK_EQ(wiz_sim.foreign_cmds, 0);
+}
+
+int main(void)
+{
+    TEST_RUN(test_link_drop);
+    TEST_RUN(test_phy_hang);
+    TEST_RUN(test_register_corruption);
+    TEST_RUN(test_chip_hang);
+    TEST_RUN(test_spi_glitch);
+    return test_summary("wiz_supervisor");
+}
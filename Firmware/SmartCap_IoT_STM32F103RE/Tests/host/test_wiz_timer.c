@@ -0,0 +1,316 @@
+/**
+  ******************************************************************************
+  * @file    test_wiz_timer.c
+  * @brief   W5500 Timer Heap: Ordering, Drift and Counter Wrap
+  ******************************************************************************
+  * @description
+  * 1ms 中断用 tick() 模拟。调度器未运行时到期回调在中断中直接执行;
+  * 运行时中断只发信号, 测试在之后的某个时刻调用 wiz_timer_process, 模拟任务调度延迟。
+  * 池容量按基准测试的规模编译 (固件为 16), 基准测试比较数百个定时器时中断和到期处理的开销。
+  ******************************************************************************
+  */
+
+#include "test.h"
+
+#define WIZ_TIMER_MAX 512
+#include "../../User/wiz_interface/wiz_timer.c"
+
+#define LOG_MAX 256
+
+static uint32_t fire_ms[LOG_MAX];
+static char fire_id[LOG_MAX];
+static int fires = 0;
+
+static void record(char id)
+{
+    if (fires < LOG_MAX)
+    {
+        fire_ms[fires] = wiz_ms_ticks;
+        fire_id[fires] = id;
+    }
+    fires++;
+}
+
+static void cb_a(void) { record('a'); }
+static void cb_b(void) { record('b'); }
+static void cb_c(void) { record('c'); }
+static void cb_d(void) { record('d'); }
+
+static void (*const cbs[])(void) = { cb_a, cb_b, cb_c, cb_d };
+
+static void reset(uint32_t start_ms)
+{
+    memset(timer_pool, 0, sizeof(timer_pool));
+    memset(&timer_stats, 0, sizeof(timer_stats));
+    timer_heap_len = 0;
+    timer_next_deadline = 0;
+    timer_signal_pending = 0;
+    timer_task_handle = NULL;
+    wiz_ms_ticks = start_ms;
+    stub_kernel_running = 0;
+    stub_signals = 0;
+    fires = 0;
+}
+
+static void tick(uint32_t n)
+{
+    while (n--)
+        wiz_timer_handler();
+}
+
+/* 堆顶总是 deadline 最早的定时器, 每个节点记录的位置与堆一致 */
+static int heap_valid(void)
+{
+    uint16_t i;
+
+    for (i = 0; i < timer_heap_len; i++)
+    {
+        if (timer_pool[timer_heap[i]].heap_pos != i || timer_pool[timer_heap[i]].func == NULL)
+            return 0;
+        if (i > 0 && time_before(timer_pool[timer_heap[i]].deadline,
+                                 timer_pool[timer_heap[(i - 1) / 2]].deadline))
+            return 0;
+    }
+    return 1;
+}
+
+static void test_fire_order(void)
+{
+    reset(0);
+    CHECK_EQ(wiz_add_timer(cb_a, 7), 0);
+    CHECK_EQ(wiz_add_timer(cb_b, 3), 0);
+    CHECK_EQ(wiz_add_timer(cb_c, 5), 0);
+    CHECK(heap_valid());
+
+    tick(15);
+    /* 3:b 5:c 6:b 7:a 9:b 10:c 12:b 14:a 15:b,c (同一时刻到期的顺序不确定) */
+    CHECK_EQ(fires, 10);
+    CHECK_MEM(fire_id, "bcbabcba", 8);
+    CHECK((fire_id[8] == 'b' && fire_id[9] == 'c') || (fire_id[8] == 'c' && fire_id[9] == 'b'));
+    CHECK_EQ(fire_ms[0], 3);
+    CHECK_EQ(fire_ms[1], 5);
+    CHECK_EQ(fire_ms[2], 6);
+    CHECK_EQ(fire_ms[3], 7);
+    CHECK_EQ(fire_ms[4], 9);
+    CHECK_EQ(fire_ms[5], 10);
+    CHECK_EQ(fire_ms[6], 12);
+    CHECK_EQ(fire_ms[7], 14);
+    CHECK_EQ(fire_ms[8], 15);
+    CHECK_EQ(fire_ms[9], 15);
+    CHECK(heap_valid());
+}
+
+static void test_same_deadline(void)
+{
+    reset(0);
+    wiz_add_timer(cb_a, 4);
+    wiz_add_timer(cb_b, 4);
+    tick(4);
+    CHECK_EQ(fires, 2);
+    CHECK_EQ(fire_ms[0], 4);
+    CHECK_EQ(fire_ms[1], 4);
+}
+
+static void test_delete_keeps_heap(void)
+{
+    int i;
+
+    reset(0);
+    for (i = 0; i < 4; i++)
+        wiz_add_timer(cbs[i], (uint32_t)(10 - i * 2));    /* 10 8 6 4 */
+    wiz_delete_timer(cb_c);                                 /* 中间的节点 */
+    CHECK(heap_valid());
+    CHECK_EQ(timer_heap_len, 3);
+    wiz_delete_timer(cb_c);                                 /* 不存在: 不变 */
+    CHECK_EQ(timer_heap_len, 3);
+
+    tick(10);
+    for (i = 0; i < fires && i < LOG_MAX; i++)
+        CHECK(fire_id[i] != 'c');
+    CHECK_EQ(fire_id[0], 'd');
+    CHECK_EQ(fire_ms[0], 4);
+
+    wiz_delete_timer(cb_d);                                 /* 堆顶 */
+    CHECK(heap_valid());
+    CHECK_EQ(timer_pool[timer_heap[0]].func == cb_b, 1);
+}
+
+static void test_pool_full(void)
+{
+    wiz_timer_stats_t st;
+    int i;
+
+    reset(0);
+    for (i = 0; i < WIZ_TIMER_MAX; i++)
+        CHECK_EQ(wiz_add_timer(cbs[i % 4], (uint32_t)(i + 1)), 0);
+    CHECK_EQ(wiz_add_timer(cb_a, 1), -1);
+    CHECK_EQ(wiz_add_timer(NULL, 1), -1);
+    CHECK_EQ(wiz_add_timer(cb_a, 0), -1);
+    CHECK(heap_valid());
+    wiz_timer_get_stats(&st);
+    CHECK_EQ(st.add_failed, 1);
+    CHECK_EQ(st.peak, WIZ_TIMER_MAX);
+}
+
+/* 回调在任务中执行, 每次晚 3ms 处理: 到期时刻仍按周期累加, 不漂移 */
+static void test_no_drift_when_late(void)
+{
+    wiz_timer_stats_t st;
+    int n;
+
+    reset(0);
+    wiz_timer_init();
+    stub_kernel_running = 1;
+    wiz_add_timer(cb_a, 10);
+
+    for (n = 0; n < 100; n++)
+    {
+        tick(n == 0 ? 13 : 10);
+        CHECK_EQ(stub_signals, (uint32_t)n + 1);
+        CHECK_EQ(fires, n);             /* 中断中不执行回调 */
+        timer_signal_pending = 0;
+        wiz_timer_process();
+        /* 下一次到期从上一次到期时刻算起, 不从处理时刻算起 */
+        CHECK_EQ(timer_pool[timer_heap[0]].deadline, (uint32_t)(n + 2) * 10);
+    }
+    CHECK_EQ(fires, 100);
+    CHECK_EQ(fire_ms[99], 1003);
+    wiz_timer_get_stats(&st);
+    CHECK_EQ(st.fired, 100);
+    CHECK_EQ(st.late_max, 3);
+}
+
+/* 落后超过一个周期时对齐到当前时刻, 只补执行一次 */
+static void test_catch_up_once(void)
+{
+    reset(0);
+    wiz_timer_init();
+    stub_kernel_running = 1;
+    wiz_add_timer(cb_a, 10);
+
+    tick(55);
+    CHECK_EQ(stub_signals, 1);          /* 信号未被处理前不重复发送 */
+    wiz_timer_process();
+    CHECK_EQ(fires, 1);
+    CHECK_EQ(timer_pool[timer_heap[0]].deadline, 65);
+}
+
+/* 毫秒计数回绕 */
+static void test_wrap(void)
+{
+    reset(0xFFFFFFF0U);
+    wiz_add_timer(cb_a, 10);
+    wiz_add_timer(cb_b, 25);
+    CHECK(heap_valid());
+
+    tick(40);
+    /* 0xFFFFFFFA:a 4:a 9:b 14:a 24:a */
+    CHECK_EQ(fires, 5);
+    CHECK_MEM(fire_id, "aabaa", 5);
+    CHECK_EQ(fire_ms[0], 0xFFFFFFFAU);
+    CHECK_EQ(fire_ms[1], 4);
+    CHECK_EQ(fire_ms[2], 9);
+    CHECK_EQ(fire_ms[4], 24);
+    CHECK(heap_valid());
+}
+
+/* 数百个定时器: 每个周期的到期次数准确, 堆保持有效; 对比原链表每 ms 遍历全部节点的开销 */
+#define BENCH_TIMERS    500
+#define BENCH_MS        20000
+
+static uint32_t bench_fires;
+static void cb_count(void) { bench_fires++; }
+
+struct bench_node
+{
+    struct bench_node *next;
+    uint32_t count_time;
+    uint32_t period;
+    void (*func)(void);
+};
+
+static void test_bench_many(void)
+{
+    static struct bench_node nodes[BENCH_TIMERS];
+    struct bench_node *head = NULL, *n;
+    uint32_t period[BENCH_TIMERS];
+    uint32_t expect = 0, lfsr = 1, i, fires_isr;
+    unsigned long long t0, heap_ns, isr_ns, list_ns;
+    wiz_timer_stats_t st;
+
+    reset(0);
+    bench_fires = 0;
+    for (i = 0; i < BENCH_TIMERS; i++)
+    {
+        lfsr = lfsr * 1103515245UL + 12345UL;
+        period[i] = 10 + (lfsr >> 16) % 991;        /* 10ms ~ 1s */
+        expect += BENCH_MS / period[i];
+        CHECK_EQ(wiz_add_timer(cb_count, period[i]), 0);
+    }
+    CHECK(heap_valid());
+
+    /* 调度器启动前: 中断中直接执行到期回调 */
+    t0 = test_now_ns();
+    tick(BENCH_MS);
+    heap_ns = test_now_ns() - t0;
+    CHECK_EQ(bench_fires, expect);
+    CHECK(heap_valid());
+    wiz_timer_get_stats(&st);
+    CHECK_EQ(st.active, BENCH_TIMERS);
+    CHECK_EQ(st.late_max, 0);
+
+    /* 调度器运行时: 中断只计数和比较, 到期时发一次信号 */
+    wiz_timer_init();
+    stub_kernel_running = 1;
+    fires_isr = bench_fires;
+    t0 = test_now_ns();
+    for (i = 0; i < BENCH_MS; i++)
+    {
+        wiz_timer_handler();
+        timer_signal_pending = 0;
+    }
+    isr_ns = test_now_ns() - t0;
+    CHECK_EQ(bench_fires, fires_isr);
+
+    /* 原实现: 每 ms 遍历链表, 递增每个节点的计数 */
+    for (i = 0; i < BENCH_TIMERS; i++)
+    {
+        nodes[i].period = period[i];
+        nodes[i].count_time = 0;
+        nodes[i].func = cb_count;
+        nodes[i].next = head;
+        head = &nodes[i];
+    }
+    bench_fires = 0;
+    t0 = test_now_ns();
+    for (i = 0; i < BENCH_MS; i++)
+    {
+        for (n = head; n != NULL; n = *(struct bench_node *volatile *)&n->next)
+        {
+            if (++n->count_time >= n->period)
+            {
+                n->count_time = 0;
+                n->func();
+            }
+        }
+    }
+    list_ns = test_now_ns() - t0;
+    CHECK_EQ(bench_fires, expect);
+
+    printf("  %u timers, %u ms (%lu fires): heap %.1f ns/ms incl. callbacks, ISR %.1f ns/ms, "
+           "linked list %.1f ns/ms\n", BENCH_TIMERS, BENCH_MS, (unsigned long)expect,
+           (double)heap_ns / BENCH_MS, (double)isr_ns / BENCH_MS, (double)list_ns / BENCH_MS);
+}
+
+int main(void)
+{
+    TEST_RUN(test_fire_order);
+    TEST_RUN(test_same_deadline);
+    TEST_RUN(test_delete_keeps_heap);
+    TEST_RUN(test_pool_full);
+    TEST_RUN(test_no_drift_when_late);
+    TEST_RUN(test_catch_up_once);
+    TEST_RUN(test_wrap);
+    TEST_RUN(test_bench_many);
+    return test_summary("wiz_timer");
+}
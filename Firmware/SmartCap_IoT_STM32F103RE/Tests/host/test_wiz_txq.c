@@ -0,0 +1,313 @@
+/**
+  ******************************************************************************
+  * @file    test_wiz_txq.c
+  * @brief   TCP Send Queue: Slow Peer CPU/Throughput, Backpressure, Close During Pump
+  ******************************************************************************
+  * @description
+  * 真实的发送队列 (wiz_txq.c) 和 ioLibrary 运行在模拟 W5500 (wiz_sim.h) 上:
+  * - 慢速对端: 比较 socket.c 阻塞 send() 和发送队列的 CPU 占用与吞吐量。
+  *   每个 SPI 帧按 FRAME_US 微秒计入 CPU 时间并推进模拟时钟; 发送队列每 ms 推进一次,
+  *   其余时间任务阻塞 (不计入 CPU)
+  * - 背压: 队列满时 wiz_txq_write 只写入剩余空间, 不等待时返回 WIZ_TXQ_ERR_TIMEOUT
+  * - 关闭与 pump 交错: 其它任务在 pump 的 SPI 帧之间调用 wiz_txq_close,
+  *   关闭由 pump 返回前完成, 不留下过期的 tail 和 SEND 状态
+  ******************************************************************************
+  */
+
+#include "test.h"
+#include "wiz_sim.h"
+#include "../../User/ioLibrary_Driver/Ethernet/wizchip_conf.c"
+#include "../../User/ioLibrary_Driver/Ethernet/W5500/w5500.c"
+#include "../../User/ioLibrary_Driver/Ethernet/socket.c"
+#include "../../User/wiz_interface/wiz_txq.c"
+
+#define SN              0
+#define FRAME_US        5       /* 一个 SPI 帧 (3 字节头 + 数据, 18MHz) 加 HAL 开销 */
+#define PEER_RATE       20      /* 对端每 ms 确认的字节数 (160kbit/s) */
+#define PEER_RTT_MS     50
+#define TOTAL_BYTES     16384
+#define CHUNK           512
+
+static const uint8_t peer_ip[4] = {192, 168, 1, 10};
+
+static wiz_NetInfo conf = {
+    .mac = {0x00, 0x08, 0xDC, 0x12, 0x34, 0x56},
+    .ip = {192, 168, 1, 50},
+    .sn = {255, 255, 255, 0},
+    .gw = {192, 168, 1, 1},
+    .dhcp = NETINFO_STATIC,
+};
+
+static uint8_t queue[2048];
+static uint8_t data[TOTAL_BYTES];
+
+/* 模拟时钟: SPI 帧占用 CPU, 每满 1ms 推进 W5500 */
+static uint32_t clock_us;
+static uint32_t busy_us;
+static uint32_t ms_us;
+
+/* on_frame 中模拟的其它任务 */
+static uint32_t close_at_frame;
+
+static void wiz_sim_udp_out(uint8_t sn, const uint8_t ip[4], uint16_t port, const uint8_t *buf, uint16_t len)
+{
+    (void)sn;
+    (void)ip;
+    (void)port;
+    (void)buf;
+    (void)len;
+}
+
+static void clock_advance(uint32_t us)
+{
+    clock_us += us;
+    ms_us += us;
+    while (ms_us >= 1000)
+    {
+        ms_us -= 1000;
+        stub_tick++;
+        wiz_sim_tick(1);
+    }
+}
+
+static void frame_cost(void)
+{
+    busy_us += FRAME_US;
+    clock_advance(FRAME_US);
+}
+
+/* 任务阻塞到下一个 ms */
+static void idle_to_next_ms(void)
+{
+    clock_advance(1000 - ms_us);
+}
+
+static void close_in_frame(void)
+{
+    if (close_at_frame != 0 && wiz_sim.frames == close_at_frame)
+    {
+        close_at_frame = 0;
+        wiz_txq_close(SN);
+    }
+}
+
+/* 上电, socket 连接到对端 */
+static void setup(uint32_t rate, uint32_t rtt_ms)
+{
+    uint8_t i;
+
+    wiz_sim_init();
+    memset(txq, 0, sizeof(txq));
+    wizchip_setnetinfo(&conf);
+    wiz_sim.sock[SN].rate = rate;
+    wiz_sim.sock[SN].rtt_ms = rtt_ms;
+    CHECK_EQ(socket(SN, Sn_MR_TCP, 5000, SF_IO_NONBLOCK), SN);
+    CHECK_EQ(connect(SN, (uint8_t *)peer_ip, 50000), SOCK_BUSY);
+    for (i = 0; i < 10 && getSn_SR(SN) != SOCK_ESTABLISHED; i++)
+        wiz_sim_tick(1);
+    CHECK_EQ(getSn_SR(SN), SOCK_ESTABLISHED);
+
+    clock_us = 0;
+    busy_us = 0;
+    ms_us = 0;
+    stub_tick = 0;
+    close_at_frame = 0;
+    wiz_sim.on_frame = NULL;
+}
+
+/* 测试 ---------------------------------------------------------------------*/
+
+/*
+ * 慢速对端: socket.c 的阻塞 send() 在等待 TX 空间和 SEND_OK 时一直读寄存器,
+ * 发送队列每 ms 只推进一次, 两者的吞吐量都由对端决定
+ */
+static void test_slow_peer(void)
+{
+    uint32_t sent, old_ms, old_busy, txq_ms, txq_busy;
+    int32_t ret;
+    uint16_t n;
+
+    /* socket.c: 阻塞模式, 调用者在 SOCK_BUSY 时重试 */
+    setup(PEER_RATE, PEER_RTT_MS);
+    ctlsocket(SN, CS_SET_IOMODE, &(uint8_t){SOCK_IO_BLOCK});
+    wiz_sim.on_frame = frame_cost;
+    sent = 0;
+    while (sent < TOTAL_BYTES)
+    {
+        ret = send(SN, &data[sent], CHUNK);
+        if (ret < 0)
+            break;
+        sent += (uint32_t)ret;
+    }
+    while (wiz_sim.sock[SN].acked_bytes < TOTAL_BYTES && clock_us < 10000000)
+        frame_cost();
+    old_ms = clock_us / 1000;
+    old_busy = busy_us;
+    CHECK_EQ(sent, TOTAL_BYTES);
+    CHECK_EQ(wiz_sim.sock[SN].acked_bytes, TOTAL_BYTES);
+
+    /* 发送队列: 生产者写满队列后阻塞, 网络任务每 ms 推进一次 */
+    setup(PEER_RATE, PEER_RTT_MS);
+    wiz_sim.on_frame = frame_cost;
+    CHECK_EQ(wiz_txq_open(SN, queue, sizeof(queue)), 0);
+    sent = 0;
+    while ((sent < TOTAL_BYTES || !wiz_txq_idle(SN)) && clock_us < 10000000)
+    {
+        n = wiz_txq_free(SN);
+        if (n > TOTAL_BYTES - sent)
+            n = (uint16_t)(TOTAL_BYTES - sent);
+        if (n > 0)
+            sent += (uint32_t)wiz_txq_write(SN, &data[sent], n, 0);
+        wiz_txq_poll_socket(SN);
+        idle_to_next_ms();
+    }
+    txq_ms = clock_us / 1000;
+    txq_busy = busy_us;
+    CHECK_EQ(sent, TOTAL_BYTES);
+    CHECK_EQ(wiz_sim.sock[SN].acked_bytes, TOTAL_BYTES);
+
+    /* 阻塞 send 占满 CPU; 队列只在每 ms 的推进中读写几次寄存器, 吞吐量不低于 send */
+    CHECK(old_busy * 10 >= old_ms * 1000 * 9);
+    CHECK(txq_busy * 20 < txq_ms * 1000);
+    CHECK(txq_ms * 10 <= old_ms * 11);
+
+    printf("  slow peer %u B/ms, RTT %u ms, %u bytes: send() CPU %lu%% %lu B/s, "
+           "txq CPU %lu.%lu%% %lu B/s\n", PEER_RATE, PEER_RTT_MS, TOTAL_BYTES,
+           (unsigned long)(old_busy / (old_ms * 10)), (unsigned long)(TOTAL_BYTES * 1000UL / old_ms),
+           (unsigned long)(txq_busy / (txq_ms * 10)), (unsigned long)(txq_busy / txq_ms % 10),
+           (unsigned long)(TOTAL_BYTES * 1000UL / txq_ms));
+}
+
+/* 队列满时只写入剩余空间; 对端确认后空间释放, 数据按顺序到达 */
+static void test_backpressure(void)
+{
+    uint8_t buf[TOTAL_BYTES];
+    wiz_txq_stats_t st;
+    uint32_t i, got = 0;
+    int32_t ret;
+
+    for (i = 0; i < TOTAL_BYTES; i++)
+        data[i] = (uint8_t)(i * 7);
+    setup(PEER_RATE * 10, 5);
+    CHECK_EQ(wiz_txq_open(SN, queue, sizeof(queue)), 0);
+    CHECK_EQ(wiz_txq_free(SN), sizeof(queue) - 1);
+
+    ret = wiz_txq_write(SN, data, sizeof(queue) + 100, 0);
+    CHECK_EQ(ret, sizeof(queue) - 1);
+    CHECK_EQ(wiz_txq_write(SN, &data[ret], 100, 0), WIZ_TXQ_ERR_TIMEOUT);
+    wiz_txq_get_stats(SN, &st);
+    CHECK_EQ(st.queued, sizeof(queue) - 1);
+
+    /* 第一次 pump 写入芯片并发出 SEND, 队列空间立即释放 */
+    wiz_txq_poll_socket(SN);
+    CHECK(wiz_txq_free(SN) > 0);
+    CHECK(!wiz_txq_idle(SN));
+
+    i = (uint32_t)ret;
+    while ((i < TOTAL_BYTES || !wiz_txq_idle(SN)) && stub_tick < 10000)
+    {
+        if (i < TOTAL_BYTES && wiz_txq_free(SN) > 0)
+        {
+            ret = wiz_txq_write(SN, &data[i], (uint16_t)(TOTAL_BYTES - i > 1000 ? 1000 : TOTAL_BYTES - i), 0);
+            CHECK(ret > 0);
+            i += (uint32_t)ret;
+        }
+        wiz_txq_poll_socket(SN);
+        stub_tick++;
+        wiz_sim_tick(1);
+        got += wiz_sim_take(SN, &buf[got], sizeof(buf) - got);
+    }
+    CHECK_EQ(got, TOTAL_BYTES);
+    CHECK_MEM(buf, data, TOTAL_BYTES);
+    wiz_txq_get_stats(SN, &st);
+    CHECK_EQ(st.bytes_queued, TOTAL_BYTES);
+    CHECK_EQ(st.bytes_sent, TOTAL_BYTES);
+    CHECK_EQ(st.send_ok, st.send_cmds);
+}
+
+/*
+ * 另一个任务在 pump 的两个 SPI 帧之间关闭队列 (如连接复位): 关闭推迟到 pump 返回前完成,
+ * 此后 tail 等于 head, 没有残留的 SEND 状态, 重新打开后从空队列开始
+ */
+static void test_close_during_pump(void)
+{
+    uint32_t start, frames, k;
+    uint16_t n;
+
+    /* 先统计一次完整 pump 用到的 SPI 帧数, 再逐帧在其中插入 close */
+    setup(0, 5);
+    CHECK_EQ(wiz_txq_open(SN, queue, sizeof(queue)), 0);
+    wiz_txq_write(SN, data, 600, 0);
+    start = wiz_sim.frames;
+    wiz_txq_poll_socket(SN);
+    frames = wiz_sim.frames - start;
+    CHECK(frames > 3);
+
+    for (k = 1; k <= frames; k++)
+    {
+        setup(0, 5);
+        CHECK_EQ(wiz_txq_open(SN, queue, sizeof(queue)), 0);
+        wiz_txq_write(SN, data, 600, 0);
+        wiz_sim.on_frame = close_in_frame;
+        close_at_frame = wiz_sim.frames + k - 1;      /* 第 k 个帧之前 */
+        n = wiz_txq_poll_socket(SN);
+        wiz_sim.on_frame = NULL;
+
+        CHECK_EQ(close_at_frame, 0);
+        CHECK_EQ(txq[SN].close_req, 0);
+        CHECK_EQ(txq[SN].pumping, 0);
+        CHECK_EQ(txq[SN].tail, txq[SN].head);
+        CHECK_EQ(txq[SN].sending, 0);
+        CHECK_EQ(txq[SN].cmd_pending, 0);
+        CHECK_EQ(txq[SN].staged, 0);
+        CHECK(wiz_txq_idle(SN));
+        CHECK_EQ(wiz_txq_poll_socket(SN), 0);
+        CHECK(n <= 600);
+
+        /* 重新打开: 空队列, 写入的数据完整发出 */
+        CHECK_EQ(wiz_txq_open(SN, queue, sizeof(queue)), 0);
+        CHECK_EQ(wiz_txq_free(SN), sizeof(queue) - 1);
+    }
+
+    /* pump 不在运行时直接完成 */
+    setup(0, 5);
+    CHECK_EQ(wiz_txq_open(SN, queue, sizeof(queue)), 0);
+    wiz_txq_write(SN, data, 600, 0);
+    wiz_txq_close(SN);
+    CHECK_EQ(txq[SN].close_req, 0);
+    CHECK_EQ(txq[SN].tail, txq[SN].head);
+    CHECK_EQ(wiz_txq_write(SN, data, 10, 0), WIZ_TXQ_ERR_SOCKNUM);
+}
+
+/* retain 队列在 pump 中途关闭: 未确认的数据保留, 可以完整取回 */
+static void test_close_during_pump_retain(void)
+{
+    uint8_t buf[700];
+    uint32_t k;
+
+    for (k = 1; k <= 6; k++)
+    {
+        setup(0, 5);
+        CHECK_EQ(wiz_txq_open_retain(SN, queue, sizeof(queue)), 0);
+        wiz_txq_write(SN, data, 600, 0);
+        wiz_sim.on_frame = close_in_frame;
+        close_at_frame = wiz_sim.frames + k - 1;      /* 第 k 个帧之前 */
+        wiz_txq_poll_socket(SN);
+        wiz_sim.on_frame = NULL;
+
+        CHECK_EQ(txq[SN].close_req, 0);
+        CHECK_EQ(txq[SN].inflight, 0);
+        CHECK_EQ(txq[SN].sending, 0);
+        CHECK_EQ(wiz_txq_reclaim(SN, buf, sizeof(buf)), 600);
+        CHECK_MEM(buf, data, 600);
+    }
+}
+
+int main(void)
+{
+    TEST_RUN(test_slow_peer);
+    TEST_RUN(test_backpressure);
+    TEST_RUN(test_close_during_pump);
+    TEST_RUN(test_close_during_pump_retain);
+    return test_summary("wiz_txq");
+}
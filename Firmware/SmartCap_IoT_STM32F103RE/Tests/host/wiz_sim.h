@@ -0,0 +1,625 @@
+/**
+  ******************************************************************************
+  * @file    wiz_sim.h
+  * @brief   Simulated W5500 Behind the ioLibrary SPI Callbacks
+  ******************************************************************************
+  * @description
+  * 测试程序包含真实的 wizchip_conf.c、w5500.c 和 socket.c, 本文件注册 SPI 回调,
+  * 按 W5500 的帧格式 (2 字节地址 + 控制字节 + 数据) 解码, 模拟寄存器和收发缓冲区:
+  * - 通用寄存器: SHAR/SIPR 等保存写入值, VERSIONR 为 0x04, PHYCFGR.LNK 由 wiz_sim.link 决定
+  * - socket 命令 (Sn_CR) 立即执行, wiz_sim.cr_reads 次读取之后 Sn_CR 才清零 (模拟命令处理延迟)
+  * - TCP: CONNECT 后经 connect_ms 建立 (对端不接受时 Sn_IR_TIMEOUT 并关闭);
+  *   SEND 的数据经往返时间 rtt_ms 后按对端速率 rate (字节/ms, 0 不限) 确认并进入 sink,
+  *   全部确认后置 SENDOK;
+  *   对端停止确认 (dead) 时 timeout_ms 后 Sn_IR_TIMEOUT 并关闭
+  * - UDP: SEND 的报文交给 wiz_sim_udp_out, wiz_sim_udp_in 按 W5500 格式 (IP、端口、长度头) 写入接收缓冲
+  * - 故障: link=0 网线断开; phy_hung=1 PHY 挂死 (不报告链路, 直到写 PHYCFGR.RST=0 复位 PHY);
+  *   hung=1 所有读取返回 0xFF; wiz_sim_power_reset 芯片复位 (寄存器回到上电值)
+  * 时间由测试调用 wiz_sim_tick 推进。
+  * 锁检查: 测试提供 wizchip_acquire/wizchip_release, 把持锁任务记在 wiz_sim.lock_owner,
+  * 当前运行的任务记在 wiz_sim.task; need_lock 为 1 时, 当前任务未持锁发出的 SPI 帧计入
+  * unlocked_frames。on_frame 在每个 SPI 帧开始前调用, 测试在其中模拟任务切换 (帧本身是原子的)。
+  * socket 的 owner 非 0 时, 其它任务写入的 Sn_CR 命令计入 foreign_cmds。
+  ******************************************************************************
+  */
+
+#ifndef __WIZ_SIM_H__
+#define __WIZ_SIM_H__
+
+#include <stdint.h>
+#include <string.h>
+#include "wizchip_conf.h"
+
+#define WIZ_SIM_SOCKS           8
+#define WIZ_SIM_BUF_MAX         16384
+#define WIZ_SIM_SINK_SIZE       65536
+
+/* 每个 socket 的对端和内部状态 */
+typedef struct {
+    uint8_t reg[0x30];
+    uint8_t tx[WIZ_SIM_BUF_MAX];
+    uint8_t rx[WIZ_SIM_BUF_MAX];
+    uint8_t cr_reads;                   /* Sn_CR 还要被读几次才清零 */
+
+    /* 对端 */
+    uint8_t accept;                     /* CONNECT 时接受 */
+    uint32_t connect_ms;                /* 建立连接的耗时 */
+    uint32_t rate;                      /* 每 ms 确认的字节数, 0 不限 */
+    uint32_t rtt_ms;                    /* SEND 之后多久开始确认 */
+    uint8_t dead;                       /* 不再确认, timeout_ms 后超时 */
+    uint32_t timeout_ms;
+
+    /* 对端收到的数据 */
+    uint8_t sink[WIZ_SIM_SINK_SIZE];
+    uint32_t sink_len;
+
+    /* 进行中的操作 */
+    uint32_t timer;                     /* SYNSENT 的剩余时间, 或发送无确认的时间 */
+    uint8_t sending;
+    uint16_t send_end;                  /* SEND 时的 TX_WR */
+    uint32_t send_at;
+    uint32_t send_cmds;
+    uint32_t opens;
+    uint32_t closes;
+    uint32_t acked_bytes;
+    uint8_t owner;                      /* 拥有 socket 的任务, 0 不检查 */
+} Wiz_Sim_Sock_t;
+
+typedef struct {
+    uint8_t common[0x40];
+    Wiz_Sim_Sock_t sock[WIZ_SIM_SOCKS];
+    uint8_t link;
+    uint8_t hung;
+    uint8_t phy_hung;
+    uint32_t phy_resets;
+    uint8_t cr_reads;                   /* 命令处理延迟 (每次写 Sn_CR 时复制到 socket) */
+    uint32_t now;
+
+    /* SPI 帧 */
+    uint8_t hdr[3];
+    uint8_t idx;
+    uint16_t addr;
+    uint32_t frames;
+
+    /* 锁检查和任务切换 */
+    uint8_t need_lock;
+    uint8_t lock_owner;
+    uint8_t task;
+    uint32_t unlocked_frames;
+    void (*on_frame)(void);
+    uint32_t resets;
+    uint32_t foreign_cmds;
+} Wiz_Sim_t;
+
+static Wiz_Sim_t wiz_sim;
+
+/* 网线接通且 PHY 正常 */
+static uint8_t wiz_sim_link_up(void)
+{
+    return wiz_sim.link && !wiz_sim.phy_hung;
+}
+
+/* UDP 报文发出 (测试实现) */
+static void wiz_sim_udp_out(uint8_t sn, const uint8_t ip[4], uint16_t port, const uint8_t *data, uint16_t len);
+
+/* 寄存器访问 ---------------------------------------------------------------*/
+
+static uint16_t wiz_sim_get16(const uint8_t *reg, uint8_t off)
+{
+    return (uint16_t)((reg[off] << 8) | reg[off + 1]);
+}
+
+static void wiz_sim_set16(uint8_t *reg, uint8_t off, uint16_t v)
+{
+    reg[off] = (uint8_t)(v >> 8);
+    reg[off + 1] = (uint8_t)v;
+}
+
+static uint16_t wiz_sim_txsize(uint8_t sn)
+{
+    return (uint16_t)(wiz_sim.sock[sn].reg[0x1F] << 10);
+}
+
+static uint16_t wiz_sim_rxsize(uint8_t sn)
+{
+    return (uint16_t)(wiz_sim.sock[sn].reg[0x1E] << 10);
+}
+
+static uint16_t wiz_sim_rx_used(uint8_t sn)
+{
+    const uint8_t *r = wiz_sim.sock[sn].reg;
+    return (uint16_t)(wiz_sim_get16(r, 0x2A) - wiz_sim_get16(r, 0x28));
+}
+
+static uint16_t wiz_sim_tx_free(uint8_t sn)
+{
+    const uint8_t *r = wiz_sim.sock[sn].reg;
+    return (uint16_t)(wiz_sim_txsize(sn) - (uint16_t)(wiz_sim_get16(r, 0x24) - wiz_sim_get16(r, 0x22)));
+}
+
+static uint8_t wiz_sim_sr(uint8_t sn)
+{
+    return wiz_sim.sock[sn].reg[0x03];
+}
+
+static void wiz_sim_set_sr(uint8_t sn, uint8_t sr)
+{
+    wiz_sim.sock[sn].reg[0x03] = sr;
+}
+
+static void wiz_sim_irq(uint8_t sn, uint8_t ir)
+{
+    wiz_sim.sock[sn].reg[0x02] |= ir;
+}
+
+/* socket 关闭: 进行中的发送作废 */
+static void wiz_sim_sock_closed(uint8_t sn)
+{
+    wiz_sim_set_sr(sn, SOCK_CLOSED);
+    wiz_sim.sock[sn].sending = 0;
+    wiz_sim.sock[sn].timer = 0;
+}
+
+/* 把 RX 缓冲中空闲的部分写入数据, 返回写入的字节数 */
+static uint16_t wiz_sim_rx_put(uint8_t sn, const uint8_t *data, uint16_t len)
+{
+    Wiz_Sim_Sock_t *s = &wiz_sim.sock[sn];
+    uint16_t size = wiz_sim_rxsize(sn);
+    uint16_t wr = wiz_sim_get16(s->reg, 0x2A);
+    uint16_t room = (uint16_t)(size - wiz_sim_rx_used(sn));
+    uint16_t i;
+
+    if (len > room)
+        len = room;
+    for (i = 0; i < len; i++)
+        s->rx[(uint16_t)(wr + i) & (size - 1)] = data[i];
+    wiz_sim_set16(s->reg, 0x2A, (uint16_t)(wr + len));
+    return len;
+}
+
+static void wiz_sim_sock_reset(uint8_t sn)
+{
+    Wiz_Sim_Sock_t *s = &wiz_sim.sock[sn];
+
+    memset(s->reg, 0, sizeof(s->reg));
+    s->reg[0x1E] = 2;
+    s->reg[0x1F] = 2;
+    s->reg[0x2C] = 0xFF;
+    s->cr_reads = 0;
+    s->sending = 0;
+    s->timer = 0;
+}
+
+/* 执行 socket 命令 */
+static void wiz_sim_command(uint8_t sn, uint8_t cmd)
+{
+    Wiz_Sim_Sock_t *s = &wiz_sim.sock[sn];
+    uint8_t proto = s->reg[0x00] & 0x0F;
+    uint16_t wr, rd, n, size, i;
+    uint8_t ip[4];
+
+    s->reg[0x01] = cmd;
+    s->cr_reads = wiz_sim.cr_reads;
+    if (s->owner != 0 && s->owner != wiz_sim.task)
+        wiz_sim.foreign_cmds++;
+    switch (cmd)
+    {
+    case Sn_CR_OPEN:
+        s->opens++;
+        wiz_sim_set16(s->reg, 0x22, 0);
+        wiz_sim_set16(s->reg, 0x24, 0);
+        wiz_sim_set16(s->reg, 0x28, 0);
+        wiz_sim_set16(s->reg, 0x2A, 0);
+        s->sending = 0;
+        s->timer = 0;
+        if (proto == Sn_MR_TCP)
+            wiz_sim_set_sr(sn, SOCK_INIT);
+        else if (proto == Sn_MR_UDP)
+            wiz_sim_set_sr(sn, SOCK_UDP);
+        else if (proto == Sn_MR_MACRAW)
+            wiz_sim_set_sr(sn, SOCK_MACRAW);
+        break;
+
+    case Sn_CR_LISTEN:
+        if (wiz_sim_sr(sn) == SOCK_INIT)
+            wiz_sim_set_sr(sn, SOCK_LISTEN);
+        else
+            wiz_sim_sock_closed(sn);
+        break;
+
+    case Sn_CR_CONNECT:
+        if (wiz_sim_sr(sn) != SOCK_INIT)
+            break;
+        if (!wiz_sim_link_up())
+        {
+            /* SYN 重传到超时, 期间链路恢复仍可建立 */
+            s->timer = s->timeout_ms;
+            wiz_sim_set_sr(sn, SOCK_SYNSENT);
+            break;
+        }
+        wiz_sim_set_sr(sn, SOCK_SYNSENT);
+        s->timer = s->accept ? s->connect_ms : s->timeout_ms;
+        if (s->timer == 0)
+            s->timer = 1;
+        break;
+
+    case Sn_CR_DISCON:
+        if (wiz_sim_sr(sn) == SOCK_ESTABLISHED || wiz_sim_sr(sn) == SOCK_CLOSE_WAIT)
+        {
+            wiz_sim_sock_closed(sn);
+            wiz_sim_irq(sn, Sn_IR_DISCON);
+        }
+        break;
+
+    case Sn_CR_CLOSE:
+        s->closes++;
+        wiz_sim_sock_closed(sn);
+        break;
+
+    case Sn_CR_SEND:
+        wr = wiz_sim_get16(s->reg, 0x24);
+        rd = wiz_sim_get16(s->reg, 0x22);
+        size = wiz_sim_txsize(sn);
+        s->send_cmds++;
+        if (wiz_sim_sr(sn) == SOCK_UDP)
+        {
+            /* 报文立即发出 */
+            uint8_t pkt[WIZ_SIM_BUF_MAX];
+            n = (uint16_t)(wr - rd);
+            for (i = 0; i < n; i++)
+                pkt[i] = s->tx[(uint16_t)(rd + i) & (size - 1)];
+            memcpy(ip, &s->reg[0x0C], 4);
+            wiz_sim_set16(s->reg, 0x22, wr);
+            wiz_sim_irq(sn, Sn_IR_SENDOK);
+            wiz_sim_udp_out(sn, ip, wiz_sim_get16(s->reg, 0x10), pkt, n);
+            break;
+        }
+        if (wiz_sim_sr(sn) != SOCK_ESTABLISHED && wiz_sim_sr(sn) != SOCK_CLOSE_WAIT)
+            break;
+        s->sending = 1;
+        s->send_end = wr;
+        s->send_at = wiz_sim.now;
+        s->timer = 0;
+        break;
+
+    case Sn_CR_RECV:
+        if (wiz_sim_rx_used(sn) != 0)
+            wiz_sim_irq(sn, Sn_IR_RECV);
+        break;
+
+    default:
+        break;
+    }
+}
+
+/* 芯片复位: 寄存器回到上电值, 连接全部断开 */
+static void wiz_sim_power_reset(void)
+{
+    uint8_t sn;
+
+    memset(wiz_sim.common, 0, sizeof(wiz_sim.common));
+    wiz_sim.common[0x19] = 0x07;    /* RTR 2000 */
+    wiz_sim.common[0x1A] = 0xD0;
+    wiz_sim.common[0x1B] = 8;       /* RCR */
+    wiz_sim.common[0x39] = 0x04;
+    for (sn = 0; sn < WIZ_SIM_SOCKS; sn++)
+        wiz_sim_sock_reset(sn);
+    wiz_sim.phy_hung = 0;
+    wiz_sim.resets++;
+}
+
+/* SPI 回调 -----------------------------------------------------------------*/
+
+static uint8_t wiz_sim_read_reg(uint8_t block, uint16_t addr)
+{
+    uint8_t sn = (uint8_t)(block >> 2);
+    Wiz_Sim_Sock_t *s;
+    uint16_t v;
+
+    if (wiz_sim.hung)
+        return 0xFF;
+    if (block == 0)
+    {
+        if (addr == 0x2E)
+            return (uint8_t)((wiz_sim.common[0x2E] & ~PHYCFGR_LNK_ON) | 0x06 | (wiz_sim_link_up() ? PHYCFGR_LNK_ON : 0));
+        return addr < sizeof(wiz_sim.common) ? wiz_sim.common[addr] : 0;
+    }
+    if (sn >= WIZ_SIM_SOCKS)
+        return 0;
+    s = &wiz_sim.sock[sn];
+    switch (block & 3)
+    {
+    case 1:
+        if (addr >= sizeof(s->reg))
+            return 0;
+        if (addr == 0x01)
+        {
+            if (s->cr_reads == 0)
+                s->reg[0x01] = 0;
+            else
+                s->cr_reads--;
+        }
+        if (addr == 0x20 || addr == 0x21)
+        {
+            v = wiz_sim_tx_free(sn);
+            return (uint8_t)(addr == 0x20 ? v >> 8 : v);
+        }
+        if (addr == 0x26 || addr == 0x27)
+        {
+            v = wiz_sim_rx_used(sn);
+            return (uint8_t)(addr == 0x26 ? v >> 8 : v);
+        }
+        return s->reg[addr];
+    case 2:
+        return s->tx[addr & (wiz_sim_txsize(sn) - 1)];
+    case 3:
+        return s->rx[addr & (wiz_sim_rxsize(sn) - 1)];
+    default:
+        return 0;
+    }
+}
+
+static void wiz_sim_write_reg(uint8_t block, uint16_t addr, uint8_t v)
+{
+    uint8_t sn = (uint8_t)(block >> 2);
+    Wiz_Sim_Sock_t *s;
+
+    if (wiz_sim.hung)
+        return;
+    if (block == 0)
+    {
+        if (addr == 0x00 && (v & 0x80))
+        {
+            wiz_sim_power_reset();
+            return;
+        }
+        if (addr == 0x2E && !(v & 0x80))
+        {
+            wiz_sim.phy_hung = 0;
+            wiz_sim.phy_resets++;
+        }
+        if (addr == 0x15 || addr == 0x17)
+            wiz_sim.common[addr] &= (uint8_t)~v;
+        else if (addr != 0x39 && addr < sizeof(wiz_sim.common))
+            wiz_sim.common[addr] = v;
+        return;
+    }
+    if (sn >= WIZ_SIM_SOCKS)
+        return;
+    s = &wiz_sim.sock[sn];
+    switch (block & 3)
+    {
+    case 1:
+        if (addr == 0x01)
+            wiz_sim_command(sn, v);
+        else if (addr == 0x02)
+            s->reg[0x02] &= (uint8_t)~v;
+        else if (addr == 0x03 || addr == 0x20 || addr == 0x21 || addr == 0x22 || addr == 0x23 ||
+                 addr == 0x26 || addr == 0x27 || addr == 0x2A || addr == 0x2B)
+            ;   /* 只读 */
+        else if (addr < sizeof(s->reg))
+            s->reg[addr] = v;
+        break;
+    case 2:
+        s->tx[addr & (wiz_sim_txsize(sn) - 1)] = v;
+        break;
+    default:
+        break;
+    }
+}
+
+static void wiz_sim_select(void)
+{
+    if (wiz_sim.on_frame != NULL)
+        wiz_sim.on_frame();
+    wiz_sim.idx = 0;
+    wiz_sim.frames++;
+    if (wiz_sim.need_lock && wiz_sim.lock_owner != wiz_sim.task)
+        wiz_sim.unlocked_frames++;
+}
+
+static void wiz_sim_deselect(void)
+{
+}
+
+static void wiz_sim_write_byte(uint8_t b)
+{
+    if (wiz_sim.idx < 3)
+    {
+        wiz_sim.hdr[wiz_sim.idx++] = b;
+        if (wiz_sim.idx == 3)
+            wiz_sim.addr = (uint16_t)((wiz_sim.hdr[0] << 8) | wiz_sim.hdr[1]);
+        return;
+    }
+    wiz_sim_write_reg((uint8_t)(wiz_sim.hdr[2] >> 3), wiz_sim.addr++, b);
+}
+
+static uint8_t wiz_sim_read_byte(void)
+{
+    return wiz_sim_read_reg((uint8_t)(wiz_sim.hdr[2] >> 3), wiz_sim.addr++);
+}
+
+static void wiz_sim_write_burst(uint8_t *buf, uint16_t len)
+{
+    uint16_t i;
+
+    for (i = 0; i < len; i++)
+        wiz_sim_write_byte(buf[i]);
+}
+
+static void wiz_sim_read_burst(uint8_t *buf, uint16_t len)
+{
+    uint16_t i;
+
+    for (i = 0; i < len; i++)
+        buf[i] = wiz_sim_read_byte();
+}
+
+/* 测试接口 -----------------------------------------------------------------*/
+
+/* 上电, 注册 SPI 回调; 各 socket 的对端默认接受连接、不限速 */
+static void wiz_sim_init(void)
+{
+    uint8_t sn;
+
+    memset(&wiz_sim, 0, sizeof(wiz_sim));
+    wiz_sim_power_reset();
+    wiz_sim.resets = 0;
+    wiz_sim.link = 1;
+    for (sn = 0; sn < WIZ_SIM_SOCKS; sn++)
+    {
+        wiz_sim.sock[sn].accept = 1;
+        wiz_sim.sock[sn].connect_ms = 2;
+        wiz_sim.sock[sn].timeout_ms = 3000;
+    }
+    reg_wizchip_cs_cbfunc(wiz_sim_select, wiz_sim_deselect);
+    reg_wizchip_spi_cbfunc(wiz_sim_read_byte, wiz_sim_write_byte);
+    reg_wizchip_spiburst_cbfunc(wiz_sim_read_burst, wiz_sim_write_burst);
+}
+
+/* 推进 ms 毫秒: 连接建立/超时, 对端确认发送的数据 */
+static void wiz_sim_tick(uint32_t ms)
+{
+    Wiz_Sim_Sock_t *s;
+    uint16_t rd, n, size, i;
+    uint32_t budget;
+    uint8_t sn;
+
+    wiz_sim.now += ms;
+    if (wiz_sim.hung)
+        return;
+    for (sn = 0; sn < WIZ_SIM_SOCKS; sn++)
+    {
+        s = &wiz_sim.sock[sn];
+        if (wiz_sim_sr(sn) == SOCK_SYNSENT)
+        {
+            if (s->timer > ms)
+            {
+                s->timer -= ms;
+                continue;
+            }
+            s->timer = 0;
+            if (s->accept && wiz_sim_link_up())
+            {
+                wiz_sim_set_sr(sn, SOCK_ESTABLISHED);
+                wiz_sim_irq(sn, Sn_IR_CON);
+            }
+            else
+            {
+                wiz_sim_sock_closed(sn);
+                wiz_sim_irq(sn, Sn_IR_TIMEOUT);
+            }
+            continue;
+        }
+        if (!s->sending)
+            continue;
+
+        /* 网线断开或对端不再确认: 重传超时后关闭 */
+        if (s->dead || !wiz_sim_link_up())
+        {
+            s->timer += ms;
+            if (s->timer >= s->timeout_ms)
+            {
+                wiz_sim_sock_closed(sn);
+                wiz_sim_irq(sn, Sn_IR_TIMEOUT);
+            }
+            continue;
+        }
+        if (wiz_sim.now - s->send_at < s->rtt_ms)
+            continue;
+        rd = wiz_sim_get16(s->reg, 0x22);
+        size = wiz_sim_txsize(sn);
+        n = (uint16_t)(s->send_end - rd);
+        budget = s->rate ? s->rate * ms : n;
+        if (n > budget)
+            n = (uint16_t)budget;
+        for (i = 0; i < n; i++)
+        {
+            if (s->sink_len < WIZ_SIM_SINK_SIZE)
+                s->sink[s->sink_len++] = s->tx[(uint16_t)(rd + i) & (size - 1)];
+        }
+        s->acked_bytes += n;
+        wiz_sim_set16(s->reg, 0x22, (uint16_t)(rd + n));
+        if ((uint16_t)(rd + n) == s->send_end)
+        {
+            s->sending = 0;
+            wiz_sim_irq(sn, Sn_IR_SENDOK);
+        }
+    }
+}
+
+/* 对端发来 TCP 数据 (放不下的部分丢弃), 返回写入的字节数 */
+static uint16_t wiz_sim_tcp_in(uint8_t sn, const void *data, uint16_t len)
+{
+    if (wiz_sim_sr(sn) != SOCK_ESTABLISHED)
+        return 0;
+    len = wiz_sim_rx_put(sn, (const uint8_t *)data, len);
+    if (len)
+        wiz_sim_irq(sn, Sn_IR_RECV);
+    return len;
+}
+
+/* 对端连接到监听中的 socket */
+static uint8_t wiz_sim_tcp_accept(uint8_t sn, const uint8_t ip[4], uint16_t port)
+{
+    Wiz_Sim_Sock_t *s = &wiz_sim.sock[sn];
+
+    if (wiz_sim_sr(sn) != SOCK_LISTEN)
+        return 0;
+    memcpy(&s->reg[0x0C], ip, 4);
+    wiz_sim_set16(s->reg, 0x10, port);
+    wiz_sim_set_sr(sn, SOCK_ESTABLISHED);
+    wiz_sim_irq(sn, Sn_IR_CON);
+    return 1;
+}
+
+/* 对端关闭 (FIN) */
+static void wiz_sim_tcp_peer_close(uint8_t sn)
+{
+    if (wiz_sim_sr(sn) == SOCK_ESTABLISHED)
+    {
+        wiz_sim_set_sr(sn, SOCK_CLOSE_WAIT);
+        wiz_sim_irq(sn, Sn_IR_DISCON);
+    }
+}
+
+/* 对端复位 (RST) 或中间设备丢弃连接 */
+static void wiz_sim_tcp_abort(uint8_t sn)
+{
+    wiz_sim_sock_closed(sn);
+    wiz_sim_irq(sn, Sn_IR_DISCON);
+}
+
+/* UDP 报文到达 (W5500 格式: 源 IP 4 + 源端口 2 + 长度 2 + 数据), 放不下时丢弃整个报文 */
+static uint8_t wiz_sim_udp_in(uint8_t sn, const uint8_t ip[4], uint16_t port, const void *data, uint16_t len)
+{
+    uint8_t hdr[8];
+
+    if (wiz_sim_sr(sn) != SOCK_UDP || !wiz_sim_link_up() ||
+        (uint32_t)wiz_sim_rxsize(sn) - wiz_sim_rx_used(sn) < (uint32_t)len + 8)
+        return 0;
+    memcpy(hdr, ip, 4);
+    hdr[4] = (uint8_t)(port >> 8);
+    hdr[5] = (uint8_t)port;
+    hdr[6] = (uint8_t)(len >> 8);
+    hdr[7] = (uint8_t)len;
+    wiz_sim_rx_put(sn, hdr, 8);
+    wiz_sim_rx_put(sn, (const uint8_t *)data, len);
+    wiz_sim_irq(sn, Sn_IR_RECV);
+    return 1;
+}
+
+/* 取出对端收到的数据 */
+static uint32_t wiz_sim_take(uint8_t sn, uint8_t *buf, uint32_t len)
+{
+    Wiz_Sim_Sock_t *s = &wiz_sim.sock[sn];
+
+    if (len > s->sink_len)
+        len = s->sink_len;
+    memcpy(buf, s->sink, len);
+    memmove(s->sink, s->sink + len, s->sink_len - len);
+    s->sink_len -= len;
+    return len;
+}
+
+#endif /* __WIZ_SIM_H__ */
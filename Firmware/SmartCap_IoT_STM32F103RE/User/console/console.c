@@ -0,0 +1,551 @@
+/**
+  ******************************************************************************
+  * @file    console.c
+  * @brief   Debug Console (USART2)
+  ******************************************************************************
+  * @description
+  * 发送: 写者在关中断的情况下复制整条消息并推进 tx_head, 然后打开 TXEIE; 中断每次发一个
+  * 字节, 缓冲发空后关闭 TXEIE。只关很短的时间 (复制一条消息), 不使用 taskENTER_CRITICAL,
+  * 调度器启动前也能正常开关中断 (同 wiz_timer.c)。
+  * 接收: 中断是唯一的写者, 默认任务是唯一的读者, 不需要加锁。
+  * 命令的输出可能超过发送缓冲, 由 Shell_Printf 在默认任务中等待缓冲有空间, 不丢弃。
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "console.h"
+#include "usart.h"
+#include "cmsis_os.h"
+#include "wiz_interface.h"
+#include "wiz_supervisor.h"
+#include "wiz_sockbuf.h"
+#include "uplink.h"
+#include "rg200u.h"
+#include "time_sync.h"
+#include "metrics.h"
+#include "ota.h"
+#include "flash_fs.h"
+#include "event_log.h"
+#include "rtos_stats.h"
+#include "trace.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if CONSOLE_ENABLE
+
+/* Private defines -----------------------------------------------------------*/
+#define CONSOLE_UART            USART2
+#define CONSOLE_TX_MASK         (CONSOLE_TX_SIZE - 1)
+#define CONSOLE_RX_MASK         (CONSOLE_RX_SIZE - 1)
+#define CONSOLE_PROMPT          "\r\n> "
+#define CONSOLE_SHELL_BUF       256     /* metrics/ota 命令的输出缓冲 */
+
+/* Private types -------------------------------------------------------------*/
+typedef struct {
+    const char *name;
+    const char *help;
+    void (*handler)(uint8_t argc, char *argv[]);
+} Console_Cmd_t;
+
+/* Private variables ---------------------------------------------------------*/
+static char tx_buf[CONSOLE_TX_SIZE];
+static volatile uint16_t tx_head = 0;           /* 不回绕的计数, 取低位作下标 */
+static volatile uint16_t tx_tail = 0;
+static uint8_t rx_buf[CONSOLE_RX_SIZE];
+static volatile uint16_t rx_head = 0;
+static volatile uint16_t rx_tail = 0;
+static Console_Stats_t console_stats;
+
+static char line_buf[CONSOLE_LINE_MAX];
+static uint8_t line_len = 0;
+static uint8_t line_cr = 0;                     /* 上一个字符是 '\r', 忽略紧跟的 '\n' */
+static char shell_buf[CONSOLE_SHELL_BUF];
+#if RTOS_STATS_ENABLE
+static RtosStats_Task_t shell_tasks[RTOS_STATS_TASKS_MAX];  /* 默认任务栈较小, 不放在栈上 */
+#endif
+
+static const char *const eth_state_name[] = {
+    "INIT", "UP", "LINK_DOWN", "CHIP_LOST", "ADDR_WAIT"
+};
+
+/* Private function prototypes -----------------------------------------------*/
+static void Cmd_Help(uint8_t argc, char *argv[]);
+static void Cmd_Status(uint8_t argc, char *argv[]);
+static void Cmd_Net(uint8_t argc, char *argv[]);
+static void Cmd_Metrics(uint8_t argc, char *argv[]);
+#if EVENT_LOG_ENABLE
+static void Cmd_Log(uint8_t argc, char *argv[]);
+#endif
+#if FS_ENABLE
+static void Cmd_Fs(uint8_t argc, char *argv[]);
+#endif
+#if OTA_ENABLE
+static void Cmd_Ota(uint8_t argc, char *argv[]);
+#endif
+#if RTOS_STATS_ENABLE
+static void Cmd_Tasks(uint8_t argc, char *argv[]);
+#endif
+#if TRACE_ENABLE
+static void Cmd_Trace(uint8_t argc, char *argv[]);
+#endif
+static void Cmd_Reboot(uint8_t argc, char *argv[]);
+
+static const Console_Cmd_t console_cmds[] = {
+    { "help",    "list commands",                   Cmd_Help },
+    { "status",  "uptime, uplink, link states",     Cmd_Status },
+    { "net",     "W5500 address configuration",     Cmd_Net },
+    { "metrics", "all metrics (Prometheus text)",   Cmd_Metrics },
+#if EVENT_LOG_ENABLE
+    { "log",     "log [0-3]: show/set event level", Cmd_Log },
+#endif
+#if FS_ENABLE
+    { "fs",      "file system usage and files",     Cmd_Fs },
+#endif
+#if OTA_ENABLE
+    { "ota",     "firmware update status",          Cmd_Ota },
+#endif
+#if RTOS_STATS_ENABLE
+    { "tasks",   "task CPU load and stack usage",   Cmd_Tasks },
+#endif
+#if TRACE_ENABLE
+    { "trace",   "timeline dump, trace on [mask]|off|bench", Cmd_Trace },
+#endif
+    { "reboot",  "software reset",                  Cmd_Reboot },
+};
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief  把整段文本放入发送缓冲并打开发送中断
+ * @retval 1:成功  0:空间不够, 未放入
+ */
+static uint8_t Console_Push(const char *data, uint16_t len)
+{
+    uint32_t primask;
+    uint16_t head, first;
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    head = tx_head;
+    if ((uint16_t)(CONSOLE_TX_SIZE - (uint16_t)(head - tx_tail)) < len)
+    {
+        __set_PRIMASK(primask);
+        return 0;
+    }
+    first = CONSOLE_TX_SIZE - (head & CONSOLE_TX_MASK);
+    if (first > len)
+        first = len;
+    memcpy(&tx_buf[head & CONSOLE_TX_MASK], data, first);
+    memcpy(tx_buf, data + first, len - first);
+    tx_head = head + len;
+    console_stats.tx_bytes += len;
+    CONSOLE_UART->CR1 |= USART_CR1_TXEIE;
+    __set_PRIMASK(primask);
+    return 1;
+}
+
+/**
+ * @brief  命令输出: 缓冲放不下时等待中断发出一部分 (只在默认任务中调用)
+ */
+static void Shell_Write(const char *data, uint16_t len)
+{
+    while (len > 0)
+    {
+        uint16_t n = (len > CONSOLE_TX_SIZE / 2) ? CONSOLE_TX_SIZE / 2 : len;
+
+        while (!Console_Push(data, n))
+            osDelay(5);
+        data += n;
+        len -= n;
+    }
+}
+
+static void Shell_Printf(const char *fmt, ...)
+{
+    char buf[CONSOLE_PRINTF_MAX];
+    va_list ap;
+    int n;
+
+    va_start(ap, fmt);
+    n = vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+    if (n < 0)
+        return;
+    if (n >= (int)sizeof(buf))
+        n = sizeof(buf) - 1;
+    Shell_Write(buf, (uint16_t)n);
+}
+
+static void Cmd_Help(uint8_t argc, char *argv[])
+{
+    uint8_t i;
+
+    for (i = 0; i < sizeof(console_cmds) / sizeof(console_cmds[0]); i++)
+        Shell_Printf("%-8s %s\r\n", console_cmds[i].name, console_cmds[i].help);
+}
+
+static void Cmd_Status(uint8_t argc, char *argv[])
+{
+    Uplink_Stats_t up;
+    wiz_sup_stats_t sup;
+    wiz_sup_state_t eth = wiz_supervisor_get_state();
+    Uplink_ID_t active = Uplink_Router_GetActive();
+
+    Uplink_Router_GetStats(&up);
+    wiz_supervisor_get_stats(&sup);
+
+    Shell_Printf("uptime    %lu s, time %s\r\n",
+                 (unsigned long)(TimeSync_MonotonicMs() / 1000),
+                 TimeSync_IsSynced() ? "synced" : "not synced");
+    Shell_Printf("uplink    %s, failovers %lu\r\n",
+                 (active == UPLINK_ETH) ? "ETH" : (active == UPLINK_CELL) ? "CELL" : "NONE",
+                 (unsigned long)up.failovers);
+    Shell_Printf("eth       %s, link loss %lu, chip resets %lu\r\n",
+                 (eth <= WIZ_SUP_STATE_ADDR_WAIT) ? eth_state_name[eth] : "?",
+                 (unsigned long)sup.link_loss, (unsigned long)sup.chip_resets);
+    Shell_Printf("cell tcp  %u\r\n", (unsigned)RG200U_GetTCPState());
+    Shell_Printf("heap free %u, min %u\r\n",
+                 (unsigned)xPortGetFreeHeapSize(), (unsigned)xPortGetMinimumEverFreeHeapSize());
+    Shell_Printf("console   %lu bytes, %lu dropped, %lu rx overruns\r\n",
+                 (unsigned long)console_stats.tx_bytes, (unsigned long)console_stats.tx_dropped,
+                 (unsigned long)console_stats.rx_overruns);
+}
+
+static void Cmd_Net(uint8_t argc, char *argv[])
+{
+    wiz_sockbuf_stats_t sb;
+    uint8_t sn;
+
+    print_network_information();
+    Shell_Printf("sock  tx KB  peak  rx KB  peak  rx full\r\n");
+    for (sn = 0; sn < _WIZCHIP_SOCK_NUM_; sn++)
+    {
+        wiz_sockbuf_get_stats(sn, &sb);
+        Shell_Printf("%4u  %5u  %4u  %5u  %4u  %7lu\r\n", (unsigned)sn, (unsigned)sb.tx_kb,
+                     (unsigned)sb.tx_peak, (unsigned)sb.rx_kb, (unsigned)sb.rx_peak,
+                     (unsigned long)sb.rx_overflow);
+    }
+}
+
+static void Cmd_Metrics(uint8_t argc, char *argv[])
+{
+    uint16_t cursor = 0;
+    uint16_t len, i, start;
+
+    /* Prometheus 文本以 '\n' 换行, 终端需要 "\r\n" */
+    while ((len = Metrics_FormatPrometheus(&cursor, shell_buf, sizeof(shell_buf))) > 0)
+    {
+        for (i = 0, start = 0; i < len; i++)
+        {
+            if (shell_buf[i] == '\n')
+            {
+                Shell_Write(&shell_buf[start], i - start);
+                Shell_Write("\r\n", 2);
+                start = i + 1;
+            }
+        }
+        Shell_Write(&shell_buf[start], len - start);
+    }
+}
+
+#if EVENT_LOG_ENABLE
+static void Cmd_Log(uint8_t argc, char *argv[])
+{
+    if (argc > 1)
+    {
+        if (argv[1][0] < '0' || argv[1][0] > '3' || argv[1][1] != '\0')
+        {
+            Shell_Printf("level must be 0-3\r\n");
+            return;
+        }
+        EventLog_SetLevel((uint8_t)(argv[1][0] - '0'));
+    }
+    Shell_Printf("event log level %u (0=DEBUG 1=INFO 2=WARN 3=ERROR)\r\n", EventLog_GetLevel());
+}
+#endif
+
+#if FS_ENABLE
+static void Cmd_Fs(uint8_t argc, char *argv[])
+{
+    FS_Info_t info;
+    FS_Stat_t st;
+    uint8_t cursor = 0;
+
+    FS_GetInfo(&info);
+    Shell_Printf("%u/%u pages free, %u files, erase count %lu..%lu\r\n",
+                 info.free_pages, info.pages, info.files,
+                 (unsigned long)info.erase_min, (unsigned long)info.erase_max);
+    while (FS_List(&cursor, &st) == FS_OK)
+        Shell_Printf("  %-16s %6lu\r\n", st.name, (unsigned long)st.size);
+}
+#endif
+
+#if OTA_ENABLE
+static void Cmd_Ota(uint8_t argc, char *argv[])
+{
+    uint16_t len = OTA_StatusJson(shell_buf, sizeof(shell_buf));
+
+    Shell_Write(shell_buf, len);
+}
+#endif
+
+#if RTOS_STATS_ENABLE
+static void Cmd_Tasks(uint8_t argc, char *argv[])
+{
+    static const char state_name[] = "XRBSD?";          /* eTaskState, 字母同 vTaskList */
+    RtosStats_Task_t *tasks = shell_tasks;
+    uint8_t n = RtosStats_GetTasks(tasks, RTOS_STATS_TASKS_MAX);
+    uint8_t i;
+    uint16_t load = RtosStats_CpuLoad();
+
+    Shell_Printf("%-16s prio st   cpu%%  stack free\r\n", "task");
+    for (i = 0; i < n; i++)
+    {
+        Shell_Printf("%-16s %4u  %c %3u.%02u %11u\r\n",
+                     tasks[i].name, tasks[i].priority,
+                     state_name[(tasks[i].state < 5) ? tasks[i].state : 5],
+                     tasks[i].cpu / 100, tasks[i].cpu % 100, tasks[i].stack_free);
+    }
+    Shell_Printf("cpu load %u.%u%%, heap free %u (min %u) bytes\r\n",
+                 load / 10, load % 10,
+                 (unsigned)xPortGetFreeHeapSize(), (unsigned)xPortGetMinimumEverFreeHeapSize());
+}
+#endif
+
+#if TRACE_ENABLE
+/**
+ * @brief  输出时间线 (trace_to_perfetto.py 的输入), 或设置记录掩码
+ */
+static void Cmd_Trace(uint8_t argc, char *argv[])
+{
+    Trace_Event_t ev;
+    uint16_t cursor = 0;
+    uint8_t mask = Trace_GetMask();
+    const char *name;
+    uint8_t i, n;
+
+    if (argc > 1)
+    {
+        if (strcmp(argv[1], "bench") == 0)
+        {
+            Shell_Printf("%lu cycles per event\r\n", (unsigned long)Trace_Bench());
+            return;
+        }
+        if (strcmp(argv[1], "off") == 0)
+            mask = 0;
+        else if (strcmp(argv[1], "on") == 0)
+            mask = (argc > 2) ? (uint8_t)strtoul(argv[2], NULL, 16) : TRACE_MASK_DEFAULT;
+        else
+        {
+            Shell_Printf("usage: trace [on [mask]|off|bench]\r\n");
+            return;
+        }
+        Trace_SetMask(mask);
+        Shell_Printf("trace mask 0x%02x\r\n", mask);
+        return;
+    }
+
+    Trace_SetMask(0);                           /* 输出期间暂停记录, 缓冲即为快照 */
+    Shell_Printf("trace begin %lu %02x\r\n", (unsigned long)SystemCoreClock, mask);
+#if RTOS_STATS_ENABLE
+    n = RtosStats_GetTasks(shell_tasks, RTOS_STATS_TASKS_MAX);
+    for (i = 0; i < n; i++)
+        Shell_Printf("task %u %s\r\n", shell_tasks[i].number, shell_tasks[i].name);
+#endif
+    for (i = 1; i <= TRACE_QUEUES_MAX; i++)
+    {
+        name = Trace_QueueName(i);
+        if (name)
+            Shell_Printf("queue %u %s\r\n", i, name);
+    }
+    for (i = 0; i < TRACE_ISR_COUNT; i++)
+        Shell_Printf("isr %u %s\r\n", i, Trace_IsrName(i));
+    while (Trace_Get(&cursor, &ev))
+    {
+        Shell_Printf("ev %08lx %u %u %u\r\n",
+                     (unsigned long)ev.cycles, ev.type, ev.id, ev.arg);
+    }
+    Shell_Printf("trace end %u\r\n", cursor);
+    Trace_SetMask(mask);
+}
+#endif
+
+static void Cmd_Reboot(uint8_t argc, char *argv[])
+{
+    Shell_Printf("rebooting\r\n");
+    osDelay(100);                               /* 等待发送完成 */
+    NVIC_SystemReset();
+}
+
+/**
+ * @brief  拆分命令行并执行
+ */
+static void Console_Execute(char *line)
+{
+    char *argv[CONSOLE_ARGS_MAX];
+    uint8_t argc = 0;
+    uint8_t i;
+
+    while (*line && argc < CONSOLE_ARGS_MAX)
+    {
+        while (*line == ' ')
+            *line++ = '\0';
+        if (*line == '\0')
+            break;
+        argv[argc++] = line;
+        while (*line && *line != ' ')
+            line++;
+    }
+    if (argc == 0)
+        return;
+
+    for (i = 0; i < sizeof(console_cmds) / sizeof(console_cmds[0]); i++)
+    {
+        if (strcmp(argv[0], console_cmds[i].name) == 0)
+        {
+            console_cmds[i].handler(argc, argv);
+            return;
+        }
+    }
+    Shell_Printf("unknown command '%s', try help\r\n", argv[0]);
+}
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief  开启接收中断并输出提示符
+ */
+void Console_Init(void)
+{
+    __HAL_UART_ENABLE_IT(&huart2, UART_IT_RXNE);
+    Console_Puts("\r\nSmartCap console, type help\r\n");
+}
+
+/**
+ * @brief  输出一段文本 (不等待)
+ */
+uint8_t Console_Write(const char *data, uint16_t len)
+{
+    if (Console_Push(data, len))
+        return 1;
+    console_stats.tx_dropped++;
+    return 0;
+}
+
+/**
+ * @brief  输出字符串
+ */
+uint8_t Console_Puts(const char *str)
+{
+    return Console_Write(str, (uint16_t)strlen(str));
+}
+
+/**
+ * @brief  格式化输出
+ */
+uint8_t Console_Printf(const char *fmt, ...)
+{
+    char buf[CONSOLE_PRINTF_MAX];
+    va_list ap;
+    int n;
+
+    va_start(ap, fmt);
+    n = vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+    if (n < 0)
+        return 0;
+    if (n >= (int)sizeof(buf))
+        n = sizeof(buf) - 1;
+    return Console_Write(buf, (uint16_t)n);
+}
+
+/**
+ * @brief  处理收到的字符, 执行命令
+ */
+void Console_Poll(void)
+{
+    char c;
+
+    while (rx_tail != rx_head)
+    {
+        c = (char)rx_buf[rx_tail & CONSOLE_RX_MASK];
+        rx_tail++;
+
+        if (c == '\r' || c == '\n')
+        {
+            if (c == '\n' && line_cr)
+            {
+                line_cr = 0;
+                continue;
+            }
+            line_cr = (c == '\r');
+            Shell_Write("\r\n", 2);
+            line_buf[line_len] = '\0';
+            Console_Execute(line_buf);
+            line_len = 0;
+            Shell_Write(CONSOLE_PROMPT, sizeof(CONSOLE_PROMPT) - 1);
+            continue;
+        }
+        line_cr = 0;
+
+        if (c == '\b' || c == 0x7F)
+        {
+            if (line_len > 0)
+            {
+                line_len--;
+                Shell_Write("\b \b", 3);
+            }
+        }
+        else if (c >= ' ' && c <= '~' && line_len < CONSOLE_LINE_MAX - 1)
+        {
+            line_buf[line_len++] = c;
+            Shell_Write(&c, 1);
+        }
+    }
+}
+
+/**
+ * @brief  USART2 中断: 收一个字节 / 发一个字节
+ */
+void Console_IRQHandler(void)
+{
+    uint32_t sr = CONSOLE_UART->SR;
+    uint8_t data;
+
+    /* 读 DR 同时清除 RXNE 和溢出错误 */
+    if (sr & (USART_SR_RXNE | USART_SR_ORE))
+    {
+        data = (uint8_t)CONSOLE_UART->DR;
+        if ((uint16_t)(rx_head - rx_tail) < CONSOLE_RX_SIZE)
+        {
+            rx_buf[rx_head & CONSOLE_RX_MASK] = data;
+            rx_head++;
+        }
+        else
+        {
+            console_stats.rx_overruns++;
+        }
+    }
+
+    if ((CONSOLE_UART->CR1 & USART_CR1_TXEIE) && (sr & USART_SR_TXE))
+    {
+        if (tx_tail != tx_head)
+        {
+            CONSOLE_UART->DR = (uint8_t)tx_buf[tx_tail & CONSOLE_TX_MASK];
+            tx_tail++;
+        }
+        else
+        {
+            CONSOLE_UART->CR1 &= ~USART_CR1_TXEIE;
+        }
+    }
+}
+
+void Console_GetStats(Console_Stats_t *stats)
+{
+    *stats = console_stats;
+}
+
+#endif /* CONSOLE_ENABLE */
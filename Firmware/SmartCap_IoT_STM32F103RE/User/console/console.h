@@ -0,0 +1,93 @@
+/**
+  ******************************************************************************
+  * @file    console.h
+  * @brief   Debug Console Header (USART2)
+  ******************************************************************************
+  * @description
+  * 调试串口 USART2 (PA2=TX, PA3=RX, 115200 8N1), 与 RS485 (USART1) 完全分开,
+  * RS485 总线上只有 Modbus/透传数据。
+  * - 输出: Console_Write/Puts/Printf 只把文本复制到发送环形缓冲, 由 USART2 的 TXE 中断
+  *   逐字节发出, 不等待串口; 缓冲放不下时整条丢弃并计数。调度器启动前 (RG200U_Init) 也可用
+  * - 输入: 接收中断把字节放入接收缓冲, 默认任务调用 Console_Poll 回显并执行命令行,
+  *   输入 help 列出命令
+  ******************************************************************************
+  */
+
+#ifndef __CONSOLE_H__
+#define __CONSOLE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported defines ----------------------------------------------------------*/
+#define CONSOLE_ENABLE          1       /* 1=启用调试串口 */
+
+#define CONSOLE_TX_SIZE         1024    /* 发送环形缓冲 (2 的幂), 115200 波特率约 90ms 发完 */
+#define CONSOLE_RX_SIZE         32      /* 接收环形缓冲 (2 的幂) */
+#define CONSOLE_LINE_MAX        64      /* 命令行长度 */
+#define CONSOLE_ARGS_MAX        4       /* 命令名和参数个数 */
+#define CONSOLE_PRINTF_MAX      96      /* Console_Printf 单条长度 (在调用者的栈上格式化) */
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct {
+    uint32_t tx_bytes;                  /* 已放入发送缓冲的字节数 */
+    uint32_t tx_dropped;                /* 缓冲放不下丢弃的消息数 */
+    uint32_t rx_overruns;               /* 接收缓冲满丢弃的字节数 */
+} Console_Stats_t;
+
+/* Exported functions --------------------------------------------------------*/
+#if CONSOLE_ENABLE
+
+/**
+ * @brief  开启接收中断并输出提示符, 在 MX_USART2_UART_Init 之后、其它模块输出之前调用
+ */
+void Console_Init(void);
+
+/**
+ * @brief  输出一段文本 (不等待), 任务和中断中均可调用
+ * @retval 1:已放入发送缓冲  0:缓冲放不下, 整段丢弃
+ */
+uint8_t Console_Write(const char *data, uint16_t len);
+
+/**
+ * @brief  输出字符串, 同 Console_Write
+ */
+uint8_t Console_Puts(const char *str);
+
+/**
+ * @brief  格式化输出, 超过 CONSOLE_PRINTF_MAX 的部分截断; 只在任务中调用
+ */
+uint8_t Console_Printf(const char *fmt, ...);
+
+/**
+ * @brief  处理收到的字符, 执行命令, 由默认任务周期调用
+ */
+void Console_Poll(void);
+
+/**
+ * @brief  USART2 中断处理, 由 USART2_IRQHandler (stm32f1xx_it.c USER CODE 1) 调用, 不经过 HAL_UART_IRQHandler
+ */
+void Console_IRQHandler(void);
+
+void Console_GetStats(Console_Stats_t *stats);
+
+#else
+
+#define Console_Init()                  ((void)0)
+#define Console_Write(data, len)        ((void)0)
+#define Console_Puts(str)               ((void)0)
+#define Console_Printf(...)             ((void)0)
+#define Console_Poll()                  ((void)0)
+#define Console_IRQHandler()            ((void)0)
+
+#endif /* CONSOLE_ENABLE */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CONSOLE_H__ */
@@ -0,0 +1,1196 @@
+/**
+  ******************************************************************************
+  * @file    flash_fs.c
+  * @brief   Log-Structured File System on Spare Internal Flash
+  ******************************************************************************
+  * @description
+  * 页头中的标志和提交项都是半字, 擦除后为 0xFFFF, 每项只编程一次:
+  * - 分配: 依次写序号、块号、文件名, 最后写 allocated; 挂载时没有 allocated 的页视为未完成
+  * - 提交: end[k] 为第 k 次提交后数据区的结束位置。奇数结束位置的最后一个半字补 0xFF,
+  *   下一段从偶数位置开始, 所以第 k 段为 [ALIGN2(end[k-1]), end[k])
+  *   断电时已写入但未提交的数据留在最后一段之后, 挂载后该页不再追加, 从下一块继续
+  * - 替换: 新版本第 0 块的 committed 在 FS_Close 时写, 之后旧版本各页写 obsolete;
+  *   挂载时同名文件保留 committed 且序号最大的一个
+  * - 搬移: 先复制页头、数据和提交项, 再写源页的 obsolete; 挂载时同一块有两页时保留提交项多的
+  *   (相同时保留第 0 块中已写 committed 的)
+  * - 擦除次数页: magic 之后每条记录两个半字, 先写擦除次数的低 16 位, 再写页号和高 8 位;
+  *   擦除一页前追加一条, 写满后擦除重来。挂载时页头无效的页取其中该页最大的记录
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "flash_fs.h"
+#include "flash_if.h"
+#include "cmsis_os.h"
+#include "stm32f1xx_hal.h"
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define FS_PAGE_MAGIC           0x5346534CUL    /* "LSFS" */
+#define FS_FLAG_SET             0x0000
+#define FS_NONE                 0xFF
+#define FS_ERASE_UNKNOWN        0xFFFFFFFFUL
+#define FS_INDEX_SIZE           (FS_MAX_FILES * 2)
+#define FS_WEAR_MAGIC           0x5745534CUL    /* "LSEW" */
+#define FS_WEAR_SLOTS           ((FS_PAGE_SIZE - 4) / 4)
+
+#define FS_PAGE_ADDR(p)         (FS_FLASH_ADDR + (uint32_t)(p) * FS_PAGE_SIZE)
+#define FS_HDR(p)               ((const FS_PageHeader_t *)FS_PAGE_ADDR(p))
+#define FS_DATA(p)              ((const uint8_t *)FS_PAGE_ADDR(p) + sizeof(FS_PageHeader_t))
+#define FS_DATA_SIZE            (FS_PAGE_SIZE - sizeof(FS_PageHeader_t))
+#define FS_ALIGN2(x)            (((x) + 1) & ~1U)
+#define FS_WEAR_REC(i)          ((const uint16_t *)(FS_WEAR_ADDR + 4 + (uint32_t)(i) * 4))
+
+/* Private types -------------------------------------------------------------*/
+
+/* Flash 中的页头 */
+typedef struct {
+    uint32_t magic;                     /* FS_PAGE_MAGIC, 擦除后与 erase_count 一起写 */
+    uint32_t erase_count;
+    uint32_t seq;                       /* 所属文件的序号, 每个文件 (版本) 唯一 */
+    uint16_t block;                     /* 在文件中的块号 */
+    uint16_t allocated;                 /* 以上字段和文件名已写完 */
+    uint16_t committed;                 /* 第 0 块: 文件 (版本) 已生效 */
+    uint16_t obsolete;                  /* 已作废, 等待擦除 */
+    char     name[FS_NAME_MAX];         /* 第 0 块: 文件名 */
+    uint16_t end[FS_COMMIT_SLOTS];      /* 提交记录 */
+} FS_PageHeader_t;
+
+typedef enum {
+    FS_PAGE_FREE = 0,                   /* 已擦除, 可直接分配 */
+    FS_PAGE_USED,
+    FS_PAGE_DIRTY                       /* 作废或内容未知, 分配前擦除 */
+} FS_PageState_t;
+
+/* RAM 中的页表 */
+typedef struct {
+    uint32_t erase_count;
+    uint8_t state;
+    uint8_t file;                       /* 所属文件槽 */
+    uint8_t block;
+    uint8_t commits;                    /* 已用的提交项 */
+    uint16_t end;                       /* 最后一次提交的结束位置 */
+    uint16_t bytes;                     /* 已提交的文件字节数 */
+    uint8_t torn;                       /* 最后一次提交之后有断电前未提交的数据, 不再追加 */
+} FS_Page_t;
+
+/* RAM 中的文件表 */
+typedef struct {
+    uint32_t seq;                       /* 0: 空槽 */
+    uint32_t size;
+    uint16_t hash;
+    uint8_t first;                      /* 第 0 块所在页 */
+    uint8_t tail;                       /* 最后一块所在页 */
+    uint8_t blocks;
+    uint8_t readers;
+    uint8_t writer;                     /* 有写句柄 (包括正在被替换的旧版本) */
+    uint8_t visible;                    /* 在索引中 (已生效且未删除) */
+    uint8_t replaces;                   /* 写入中的新版本: 将被替换的旧版本槽 */
+} FS_Entry_t;
+
+typedef struct {
+    uint8_t used;
+    uint8_t file;
+    uint8_t mode;
+    uint8_t page;                       /* 读: 当前页 (FS_NONE 时重新定位); 写: 尾页 */
+    uint32_t pos;                       /* 读: 文件偏移 */
+    uint32_t page_pos;                  /* 读: 当前页第一个字节的文件偏移 */
+    uint16_t wpos;                      /* 写: 尾页数据区中下一个字节的位置 */
+    uint8_t carry;                      /* 写: 偶数位置上还没有编程的字节 */
+} FS_Handle_t;
+
+/* Private variables ---------------------------------------------------------*/
+static FS_Page_t fs_pages[FS_PAGES];
+static FS_Entry_t fs_files[FS_MAX_FILES];
+static FS_Handle_t fs_handles[FS_MAX_OPEN];
+static uint8_t fs_index[FS_INDEX_SIZE];         /* 文件槽 + 1, 0 为空 */
+static uint32_t fs_next_seq = 1;
+static uint32_t fs_relocations = 0;
+static uint32_t fs_mount_ms = 0;
+static uint16_t fs_wear_next = FS_WEAR_SLOTS;   /* 擦除次数页的下一条记录, 满或无效时为 FS_WEAR_SLOTS */
+static uint8_t fs_mounted = 0;
+
+static osMutexId fs_mutex = NULL;
+static osStaticMutexDef_t fs_mutex_cb;
+
+/* Private functions ---------------------------------------------------------*/
+
+static uint8_t FS_Lock(void)
+{
+    return fs_mounted && osMutexWait(fs_mutex, FS_LOCK_MS) == osOK;
+}
+
+static void FS_Unlock(void)
+{
+    osMutexRelease(fs_mutex);
+}
+
+/**
+ * @brief  编程一个半字; 与 OTA、DHCP 租约共用 Flash 锁 (flash_if.h)
+ */
+static uint8_t FS_FlashProgram(uint32_t addr, uint16_t half)
+{
+    uint8_t ok;
+
+    if (half == 0xFFFF)
+        return *(const volatile uint16_t *)addr == 0xFFFF;
+
+    Flash_Acquire();
+    ok = Flash_Program16(addr, half);
+    Flash_Release();
+    return ok;
+}
+
+static uint8_t FS_FlashProgram32(const uint32_t *addr, uint32_t word)
+{
+    return FS_FlashProgram((uint32_t)addr, (uint16_t)word) &&
+           FS_FlashProgram((uint32_t)addr + 2, (uint16_t)(word >> 16));
+}
+
+static uint8_t FS_SetFlag(const uint16_t *flag)
+{
+    return FS_FlashProgram((uint32_t)flag, FS_FLAG_SET);
+}
+
+/**
+ * @brief  把页 p 的新擦除次数追加到擦除次数页, 在擦除 p 之前调用
+ */
+static void FS_WearNote(uint8_t p, uint32_t count)
+{
+    const uint16_t *rec;
+    uint8_t ok;
+
+    if (fs_wear_next >= FS_WEAR_SLOTS)
+    {
+        Flash_Acquire();
+        ok = Flash_ErasePage(FS_WEAR_ADDR);
+        Flash_Release();
+        if (!ok || !FS_FlashProgram32((const uint32_t *)FS_WEAR_ADDR, FS_WEAR_MAGIC))
+            return;
+        fs_wear_next = 0;
+    }
+    rec = FS_WEAR_REC(fs_wear_next++);
+    if (FS_FlashProgram((uint32_t)&rec[1], (uint16_t)count))
+        FS_FlashProgram((uint32_t)&rec[0], (uint16_t)(p | ((count >> 8) & 0xFF00)));
+}
+
+/**
+ * @brief  读擦除次数页: 每页最大的记录写入 fs_pages[].erase_count (没有记录时为 FS_ERASE_UNKNOWN)
+ */
+static void FS_WearScan(void)
+{
+    const uint16_t *rec;
+    uint32_t count;
+    uint16_t i;
+    uint8_t p;
+
+    for (p = 0; p < FS_PAGES; p++)
+        fs_pages[p].erase_count = FS_ERASE_UNKNOWN;
+    fs_wear_next = FS_WEAR_SLOTS;
+    if (*(const uint32_t *)FS_WEAR_ADDR != FS_WEAR_MAGIC)
+        return;
+
+    for (i = 0; i < FS_WEAR_SLOTS; i++)
+    {
+        rec = FS_WEAR_REC(i);
+        if (rec[0] == 0xFFFF && rec[1] == 0xFFFF)
+            break;
+        p = (uint8_t)rec[0];
+        if (rec[0] == 0xFFFF || p >= FS_PAGES)
+            continue;           /* 写到一半断电 */
+        count = ((uint32_t)(rec[0] & 0xFF00) << 8) | rec[1];
+        if (fs_pages[p].erase_count == FS_ERASE_UNKNOWN || count > fs_pages[p].erase_count)
+            fs_pages[p].erase_count = count;
+    }
+    fs_wear_next = i;
+}
+
+/**
+ * @brief  擦除一页并写入页头的 magic 和擦除次数
+ */
+static uint8_t FS_ErasePage(uint8_t p)
+{
+    uint8_t ok;
+
+    fs_pages[p].erase_count++;
+    fs_pages[p].state = FS_PAGE_DIRTY;
+    FS_WearNote(p, fs_pages[p].erase_count);
+
+    Flash_Acquire();
+    ok = Flash_ErasePage(FS_PAGE_ADDR(p));
+    Flash_Release();
+
+    if (!ok || !FS_FlashProgram32(&FS_HDR(p)->erase_count, fs_pages[p].erase_count) ||
+        !FS_FlashProgram32(&FS_HDR(p)->magic, FS_PAGE_MAGIC))
+        return 0;
+    fs_pages[p].state = FS_PAGE_FREE;
+    return 1;
+}
+
+/**
+ * @brief  作废一页 (写 obsolete), 之后可以分配
+ */
+static void FS_DropPage(uint8_t p)
+{
+    FS_SetFlag(&FS_HDR(p)->obsolete);
+    fs_pages[p].state = FS_PAGE_DIRTY;
+    fs_pages[p].file = FS_NONE;
+}
+
+static uint16_t FS_Hash(const char *name)
+{
+    uint32_t h = 2166136261UL;
+
+    while (*name)
+        h = (h ^ (uint8_t)*name++) * 16777619UL;
+    return (uint16_t)(h ^ (h >> 16));
+}
+
+static uint8_t FS_NameValid(const char *name)
+{
+    size_t len = strlen(name);
+
+    return len > 0 && len < FS_NAME_MAX && strchr(name, '/') == NULL;
+}
+
+static const char *FS_Name(uint8_t f)
+{
+    return FS_HDR(fs_files[f].first)->name;
+}
+
+static void FS_IndexBuild(void)
+{
+    uint8_t f, i;
+
+    memset(fs_index, 0, sizeof(fs_index));
+    for (f = 0; f < FS_MAX_FILES; f++)
+    {
+        if (fs_files[f].seq == 0 || !fs_files[f].visible)
+            continue;
+        i = fs_files[f].hash % FS_INDEX_SIZE;
+        while (fs_index[i] != 0)
+            i = (i + 1) % FS_INDEX_SIZE;
+        fs_index[i] = f + 1;
+    }
+}
+
+/**
+ * @brief  按文件名查找已生效的文件
+ * @retval 文件槽或 FS_NONE
+ */
+static uint8_t FS_Lookup(const char *name)
+{
+    uint16_t hash = FS_Hash(name);
+    uint8_t i = hash % FS_INDEX_SIZE;
+    uint8_t n, f;
+
+    for (n = 0; n < FS_INDEX_SIZE && fs_index[i] != 0; n++)
+    {
+        f = fs_index[i] - 1;
+        if (fs_files[f].hash == hash && strncmp(FS_Name(f), name, FS_NAME_MAX) == 0)
+            return f;
+        i = (i + 1) % FS_INDEX_SIZE;
+    }
+    return FS_NONE;
+}
+
+/**
+ * @brief  文件第 block 块所在的页
+ */
+static uint8_t FS_FindBlock(uint8_t f, uint8_t block)
+{
+    uint8_t p;
+
+    for (p = 0; p < FS_PAGES; p++)
+    {
+        if (fs_pages[p].state == FS_PAGE_USED && fs_pages[p].file == f && fs_pages[p].block == block)
+            return p;
+    }
+    return FS_NONE;
+}
+
+/**
+ * @brief  释放文件槽; 没有读句柄时各页改为待擦除 (页头的 obsolete 已由调用者写)
+ */
+static void FS_Release(uint8_t f)
+{
+    uint8_t p;
+
+    fs_files[f].visible = 0;
+    if (fs_files[f].readers != 0 || fs_files[f].writer)
+        return;
+    for (p = 0; p < FS_PAGES; p++)
+    {
+        if (fs_pages[p].state == FS_PAGE_USED && fs_pages[p].file == f)
+        {
+            fs_pages[p].state = FS_PAGE_DIRTY;
+            fs_pages[p].file = FS_NONE;
+        }
+    }
+    fs_files[f].seq = 0;
+}
+
+/**
+ * @brief  作废文件的所有页并释放; 先作废第 0 块, 中途断电时挂载丢弃其余的块, 不会留下截短的文件
+ */
+static void FS_DropFile(uint8_t f)
+{
+    uint8_t p;
+
+    FS_SetFlag(&FS_HDR(fs_files[f].first)->obsolete);
+    for (p = 0; p < FS_PAGES; p++)
+    {
+        if (fs_pages[p].state == FS_PAGE_USED && fs_pages[p].file == f && p != fs_files[f].first)
+            FS_SetFlag(&FS_HDR(p)->obsolete);
+    }
+    FS_Release(f);
+}
+
+/**
+ * @brief  选一个可分配的页并擦除
+ * @param  worn: 0 时选擦除次数最少的页 (已擦除的优先, 省去一次擦除);
+ *               1 时选擦除次数最多的页, 作为静态磨损均衡的目标
+ */
+static uint8_t FS_TakePage(uint8_t worn)
+{
+    uint8_t p, best = FS_NONE;
+
+    for (p = 0; p < FS_PAGES; p++)
+    {
+        if (fs_pages[p].state == FS_PAGE_USED)
+            continue;
+        if (best == FS_NONE)
+            best = p;
+        else if (worn)
+        {
+            if (fs_pages[p].erase_count > fs_pages[best].erase_count)
+                best = p;
+        }
+        else if (fs_pages[p].state != fs_pages[best].state)
+        {
+            if (fs_pages[p].state == FS_PAGE_FREE)
+                best = p;
+        }
+        else if (fs_pages[p].erase_count < fs_pages[best].erase_count)
+            best = p;
+    }
+    if (best == FS_NONE)
+        return FS_NONE;
+    if (fs_pages[best].state == FS_PAGE_DIRTY && !FS_ErasePage(best))
+        return FS_NONE;
+    return best;
+}
+
+static uint8_t FS_AvailablePages(void)
+{
+    uint8_t p, n = 0;
+
+    for (p = 0; p < FS_PAGES; p++)
+    {
+        if (fs_pages[p].state != FS_PAGE_USED)
+            n++;
+    }
+    return n;
+}
+
+/**
+ * @brief  在已擦除的页上写页头 (序号、块号、第 0 块的文件名, 最后写 allocated)
+ */
+static uint8_t FS_WriteHeader(uint8_t p, uint32_t seq, uint8_t block, const char *name)
+{
+    const FS_PageHeader_t *hdr = FS_HDR(p);
+    uint8_t i, len;
+    uint16_t half;
+
+    if (!FS_FlashProgram32(&hdr->seq, seq) || !FS_FlashProgram((uint32_t)&hdr->block, block))
+        return 0;
+    if (name != NULL)
+    {
+        /* 文件名连同结束符编程, 其余保持 0xFF */
+        len = (uint8_t)strlen(name) + 1;
+        for (i = 0; i < len; i += 2)
+        {
+            half = (uint8_t)name[i];
+            half |= (uint16_t)((i + 1 < len) ? (uint8_t)name[i + 1] : 0xFF) << 8;
+            if (!FS_FlashProgram((uint32_t)hdr->name + i, half))
+                return 0;
+        }
+    }
+    return FS_SetFlag(&hdr->allocated);
+}
+
+/**
+ * @brief  把一页 (冷数据) 搬到另一页, 用于静态磨损均衡
+ */
+static uint8_t FS_Relocate(uint8_t src, uint8_t dst)
+{
+    const FS_PageHeader_t *from = FS_HDR(src);
+    const FS_PageHeader_t *to = FS_HDR(dst);
+    FS_Page_t *ps = &fs_pages[src];
+    FS_Entry_t *e = &fs_files[ps->file];
+    uint16_t i;
+    uint8_t h;
+
+    if (!FS_WriteHeader(dst, from->seq, ps->block, ps->block == 0 ? from->name : NULL))
+    {
+        FS_DropPage(dst);
+        return 0;
+    }
+    if (ps->block == 0 && from->committed == FS_FLAG_SET)
+        FS_SetFlag(&to->committed);
+    for (i = 0; i < FS_ALIGN2(ps->end); i += 2)
+    {
+        if (!FS_FlashProgram((uint32_t)FS_DATA(dst) + i, *(const uint16_t *)(FS_DATA(src) + i)))
+        {
+            FS_DropPage(dst);
+            return 0;
+        }
+    }
+    for (i = 0; i < ps->commits; i++)
+    {
+        if (!FS_FlashProgram((uint32_t)&to->end[i], from->end[i]))
+        {
+            FS_DropPage(dst);
+            return 0;
+        }
+    }
+
+    fs_pages[dst].state = FS_PAGE_USED;
+    fs_pages[dst].file = ps->file;
+    fs_pages[dst].block = ps->block;
+    fs_pages[dst].commits = ps->commits;
+    fs_pages[dst].end = ps->end;
+    fs_pages[dst].bytes = ps->bytes;
+    fs_pages[dst].torn = 0;
+    if (e->first == src)
+        e->first = dst;
+    if (e->tail == src)
+        e->tail = dst;
+    for (h = 0; h < FS_MAX_OPEN; h++)
+    {
+        if (fs_handles[h].used && fs_handles[h].page == src)
+            fs_handles[h].page = dst;
+    }
+    FS_DropPage(src);
+    fs_relocations++;
+    return 1;
+}
+
+/**
+ * @brief  静态磨损均衡: 最冷的数据页与磨损最多的可分配页擦除次数相差过大时搬移
+ */
+static void FS_WearLevel(void)
+{
+    uint8_t p, cold = FS_NONE, worn = FS_NONE;
+
+    if (FS_AvailablePages() < 2)
+        return;
+    for (p = 0; p < FS_PAGES; p++)
+    {
+        if (fs_pages[p].state == FS_PAGE_USED)
+        {
+            if (fs_files[fs_pages[p].file].writer || !fs_files[fs_pages[p].file].visible)
+                continue;
+            if (cold == FS_NONE || fs_pages[p].erase_count < fs_pages[cold].erase_count)
+                cold = p;
+        }
+        else if (worn == FS_NONE || fs_pages[p].erase_count > fs_pages[worn].erase_count)
+            worn = p;
+    }
+    if (cold == FS_NONE || worn == FS_NONE ||
+        fs_pages[worn].erase_count < fs_pages[cold].erase_count + FS_WEAR_DELTA)
+        return;
+
+    worn = FS_TakePage(1);
+    if (worn != FS_NONE)
+        FS_Relocate(cold, worn);
+}
+
+/**
+ * @brief  为文件分配下一块
+ * @retval 页号或 FS_NONE
+ */
+static uint8_t FS_Allocate(uint8_t f, uint8_t block, const char *name)
+{
+    uint8_t p = FS_TakePage(0);
+
+    if (p == FS_NONE)
+        return FS_NONE;
+    if (!FS_WriteHeader(p, fs_files[f].seq, block, name))
+    {
+        FS_DropPage(p);
+        return FS_NONE;
+    }
+    fs_pages[p].state = FS_PAGE_USED;
+    fs_pages[p].file = f;
+    fs_pages[p].block = block;
+    fs_pages[p].commits = 0;
+    fs_pages[p].end = 0;
+    fs_pages[p].bytes = 0;
+    fs_pages[p].torn = 0;
+
+    /* 每次分配最多搬移一页, 磨损差距在以后的分配中逐步缩小 */
+    FS_WearLevel();
+    return p;
+}
+
+/**
+ * @brief  新建文件 (版本), 分配第 0 块
+ * @param  commit: 1 时立即生效 (不是替换)
+ */
+static int8_t FS_Create(const char *name, uint8_t commit, uint8_t *file)
+{
+    uint8_t f, p;
+
+    for (f = 0; f < FS_MAX_FILES && fs_files[f].seq != 0; f++)
+        ;
+    if (f == FS_MAX_FILES)
+        return FS_ERR_FILES;
+
+    memset(&fs_files[f], 0, sizeof(fs_files[f]));
+    fs_files[f].seq = fs_next_seq++;
+    fs_files[f].hash = FS_Hash(name);
+    fs_files[f].replaces = FS_NONE;
+    p = FS_Allocate(f, 0, name);
+    if (p == FS_NONE)
+    {
+        fs_files[f].seq = 0;
+        return FS_AvailablePages() ? FS_ERR_FLASH : FS_ERR_FULL;
+    }
+    fs_files[f].first = fs_files[f].tail = p;
+    fs_files[f].blocks = 1;
+    if (commit)
+    {
+        FS_SetFlag(&FS_HDR(p)->committed);
+        fs_files[f].visible = 1;
+        FS_IndexBuild();
+    }
+    *file = f;
+    return FS_OK;
+}
+
+/**
+ * @brief  提交尾页中已写入的数据
+ */
+static int8_t FS_Commit(FS_Handle_t *h)
+{
+    FS_Entry_t *e = &fs_files[h->file];
+    FS_Page_t *pg = &fs_pages[e->tail];
+    uint16_t start = FS_ALIGN2(pg->end);
+
+    if (h->wpos == start)
+        return FS_OK;
+    if (pg->commits >= FS_COMMIT_SLOTS)
+        return FS_ERR_PARAM;
+
+    /* 奇数结束位置: 最后一个字节与 0xFF 组成半字 */
+    if ((h->wpos & 1) &&
+        !FS_FlashProgram((uint32_t)FS_DATA(e->tail) + h->wpos - 1, (uint16_t)(0xFF00 | h->carry)))
+        return FS_ERR_FLASH;
+    if (!FS_FlashProgram((uint32_t)&FS_HDR(e->tail)->end[pg->commits], h->wpos))
+        return FS_ERR_FLASH;
+
+    pg->commits++;
+    pg->bytes += h->wpos - start;
+    e->size += h->wpos - start;
+    pg->end = h->wpos;
+    h->wpos = FS_ALIGN2(h->wpos);
+    return FS_OK;
+}
+
+/**
+ * @brief  把读句柄定位到 pos 所在的页
+ */
+static uint8_t FS_Locate(FS_Handle_t *h)
+{
+    uint8_t block;
+
+    if (h->page != FS_NONE && h->pos >= h->page_pos && h->pos < h->page_pos + fs_pages[h->page].bytes)
+        return 1;
+
+    /* 顺序读到下一页, 否则从第 0 块开始 */
+    if (h->page != FS_NONE && h->pos == h->page_pos + fs_pages[h->page].bytes)
+    {
+        h->page_pos += fs_pages[h->page].bytes;
+        block = fs_pages[h->page].block + 1;
+    }
+    else
+    {
+        h->page_pos = 0;
+        block = 0;
+    }
+    for (; block < fs_files[h->file].blocks; block++)
+    {
+        h->page = FS_FindBlock(h->file, block);
+        if (h->page == FS_NONE)
+            break;
+        if (h->pos < h->page_pos + fs_pages[h->page].bytes)
+            return 1;
+        h->page_pos += fs_pages[h->page].bytes;
+    }
+    h->page = FS_NONE;
+    return 0;
+}
+
+/**
+ * @brief  扫描页的提交项
+ */
+static void FS_ScanCommits(uint8_t p)
+{
+    const FS_PageHeader_t *hdr = FS_HDR(p);
+    FS_Page_t *pg = &fs_pages[p];
+    uint16_t start = 0;
+
+    pg->commits = 0;
+    pg->end = 0;
+    pg->bytes = 0;
+    while (pg->commits < FS_COMMIT_SLOTS && hdr->end[pg->commits] != 0xFFFF &&
+           hdr->end[pg->commits] >= start && hdr->end[pg->commits] <= FS_DATA_SIZE)
+    {
+        pg->end = hdr->end[pg->commits];
+        pg->bytes += pg->end - start;
+        start = FS_ALIGN2(pg->end);
+        pg->commits++;
+    }
+
+    /* 已编程的位置不能再写, 追加从下一块开始 */
+    pg->torn = 0;
+    for (; start < FS_DATA_SIZE && !pg->torn; start += 2)
+        pg->torn = *(const uint16_t *)(FS_DATA(p) + start) != 0xFFFF;
+}
+
+/**
+ * @brief  挂载: 建立页表和文件表, 清理断电留下的未完成操作
+ */
+static void FS_Mount(void)
+{
+    const FS_PageHeader_t *hdr;
+    uint32_t erase_max = 0;
+    uint8_t p, q, f, g, block, keep;
+
+    memset(fs_files, 0, sizeof(fs_files));
+    fs_next_seq = 1;
+    FS_WearScan();
+
+    /* 1. 页状态 */
+    for (p = 0; p < FS_PAGES; p++)
+    {
+        hdr = FS_HDR(p);
+        fs_pages[p].file = FS_NONE;
+        if (hdr->magic != FS_PAGE_MAGIC || hdr->erase_count == FS_ERASE_UNKNOWN)
+        {
+            /* 擦除后断电: 擦除次数取擦除次数页中的记录; 从未使用时按最大值计 */
+            fs_pages[p].state = FS_PAGE_DIRTY;
+            continue;
+        }
+        fs_pages[p].erase_count = hdr->erase_count;
+        if (hdr->erase_count > erase_max)
+            erase_max = hdr->erase_count;
+
+        if (hdr->allocated != FS_FLAG_SET)
+            fs_pages[p].state = (hdr->seq == 0xFFFFFFFFUL && hdr->block == 0xFFFF) ? FS_PAGE_FREE : FS_PAGE_DIRTY;
+        else if (hdr->obsolete == FS_FLAG_SET || hdr->block >= FS_PAGES || hdr->seq == 0)
+            fs_pages[p].state = FS_PAGE_DIRTY;
+        else
+        {
+            fs_pages[p].state = FS_PAGE_USED;
+            fs_pages[p].block = (uint8_t)hdr->block;
+            FS_ScanCommits(p);
+            if (hdr->seq >= fs_next_seq)
+                fs_next_seq = hdr->seq + 1;
+        }
+    }
+    for (p = 0; p < FS_PAGES; p++)
+    {
+        if (fs_pages[p].erase_count == FS_ERASE_UNKNOWN)
+            fs_pages[p].erase_count = erase_max;
+    }
+
+    /* 2. 第 0 块建立文件, 同一块有两页时 (搬移中断电) 保留提交项多的 */
+    for (block = 0; block < FS_PAGES; block++)
+    {
+        for (p = 0; p < FS_PAGES; p++)
+        {
+            if (fs_pages[p].state != FS_PAGE_USED || fs_pages[p].file != FS_NONE || fs_pages[p].block != block)
+                continue;
+            hdr = FS_HDR(p);
+            for (f = 0; f < FS_MAX_FILES && !(fs_files[f].seq == hdr->seq); f++)
+                ;
+            if (f == FS_MAX_FILES)
+            {
+                if (block != 0 || memchr(hdr->name, 0, FS_NAME_MAX) == NULL)
+                {
+                    FS_DropPage(p);         /* 没有第 0 块或文件名无效 */
+                    continue;
+                }
+                for (f = 0; f < FS_MAX_FILES && fs_files[f].seq != 0; f++)
+                    ;
+                if (f == FS_MAX_FILES)
+                {
+                    FS_DropPage(p);
+                    continue;
+                }
+                fs_files[f].seq = hdr->seq;
+                fs_files[f].hash = FS_Hash(hdr->name);
+                fs_files[f].replaces = FS_NONE;
+                fs_files[f].first = p;
+                fs_files[f].visible = hdr->committed == FS_FLAG_SET;
+            }
+            else if (block == fs_files[f].blocks)
+            {
+                /* 块连续, 接到文件末尾 */
+            }
+            else
+            {
+                q = FS_FindBlock(f, block);
+                if (q == FS_NONE)
+                {
+                    FS_DropPage(p);         /* 前面缺块, 之后的块丢弃 */
+                    continue;
+                }
+                /* 只搬移已生效的文件: 第 0 块任一页有 committed 即生效, 保留的页缺少时补写,
+                 * 再作废另一页 */
+                if (block == 0 && FS_HDR(p)->committed == FS_FLAG_SET)
+                    fs_files[f].visible = 1;
+                keep = q;
+                if (fs_pages[p].commits > fs_pages[q].commits ||
+                    (fs_pages[p].commits == fs_pages[q].commits && block == 0 &&
+                     FS_HDR(p)->committed == FS_FLAG_SET && FS_HDR(q)->committed != FS_FLAG_SET))
+                {
+                    keep = p;
+                    if (fs_files[f].first == q)
+                        fs_files[f].first = p;
+                    if (fs_files[f].tail == q)
+                        fs_files[f].tail = p;
+                    fs_pages[p].file = f;
+                }
+                if (block == 0 && fs_files[f].visible && FS_HDR(keep)->committed != FS_FLAG_SET)
+                    FS_SetFlag(&FS_HDR(keep)->committed);
+                FS_DropPage(keep == p ? q : p);
+                continue;
+            }
+            fs_pages[p].file = f;
+            fs_files[f].tail = p;
+            fs_files[f].blocks++;
+        }
+    }
+
+    /* 3. 未生效的版本丢弃; 同名文件保留序号最大的 */
+    for (f = 0; f < FS_MAX_FILES; f++)
+    {
+        if (fs_files[f].seq != 0 && !fs_files[f].visible)
+            FS_DropFile(f);
+    }
+    for (f = 0; f < FS_MAX_FILES; f++)
+    {
+        if (fs_files[f].seq == 0)
+            continue;
+        for (g = f + 1; g < FS_MAX_FILES; g++)
+        {
+            if (fs_files[g].seq == 0 || fs_files[g].hash != fs_files[f].hash ||
+                strncmp(FS_Name(f), FS_Name(g), FS_NAME_MAX) != 0)
+                continue;
+            if (fs_files[g].seq > fs_files[f].seq)
+            {
+                FS_DropFile(f);
+                break;
+            }
+            FS_DropFile(g);
+        }
+    }
+
+    /* 4. 文件大小 */
+    for (p = 0; p < FS_PAGES; p++)
+    {
+        if (fs_pages[p].state == FS_PAGE_USED && fs_pages[p].file != FS_NONE)
+            fs_files[fs_pages[p].file].size += fs_pages[p].bytes;
+    }
+    FS_IndexBuild();
+}
+
+static FS_Handle_t *FS_Handle(int8_t fd)
+{
+    if (fd < 0 || fd >= FS_MAX_OPEN || !fs_handles[fd].used)
+        return NULL;
+    return &fs_handles[fd];
+}
+
+/* Exported functions --------------------------------------------------------*/
+
+void FS_Init(void)
+{
+    uint32_t start = osKernelSysTick();
+
+    if (fs_mutex == NULL)
+    {
+        osMutexStaticDef(FS, &fs_mutex_cb);
+        fs_mutex = osMutexCreate(osMutex(FS));
+    }
+    FS_Mount();
+    fs_mount_ms = osKernelSysTick() - start;
+    fs_mounted = 1;
+}
+
+int8_t FS_Open(const char *name, uint8_t mode)
+{
+    FS_Handle_t *h;
+    uint8_t f, fd;
+    int8_t ret;
+
+    if (!FS_NameValid(name))
+        return FS_ERR_NAME;
+    if (mode != FS_O_READ && mode != FS_O_APPEND && mode != FS_O_TRUNC)
+        return FS_ERR_PARAM;
+    if (!FS_Lock())
+        return FS_ERR_BUSY;
+
+    for (fd = 0; fd < FS_MAX_OPEN && fs_handles[fd].used; fd++)
+        ;
+    f = FS_Lookup(name);
+    if (fd == FS_MAX_OPEN)
+        ret = FS_ERR_FILES;
+    else if (mode == FS_O_READ)
+        ret = (f == FS_NONE) ? FS_ERR_NOENT : FS_OK;
+    else if (f != FS_NONE && fs_files[f].writer)
+        ret = FS_ERR_BUSY;
+    else if (mode == FS_O_APPEND && f != FS_NONE)
+        ret = FS_OK;
+    else
+    {
+        /* 新文件立即生效; 替换时新版本在关闭时生效 */
+        uint8_t old = f;
+
+        ret = FS_Create(name, old == FS_NONE, &f);
+        if (ret == FS_OK && old != FS_NONE)
+        {
+            fs_files[f].replaces = old;
+            fs_files[old].writer = 1;
+        }
+    }
+
+    if (ret != FS_OK)
+    {
+        FS_Unlock();
+        return ret;
+    }
+
+    h = &fs_handles[fd];
+    memset(h, 0, sizeof(*h));
+    h->used = 1;
+    h->file = f;
+    h->mode = mode;
+    h->page = FS_NONE;
+    if (mode == FS_O_READ)
+        fs_files[f].readers++;
+    else
+    {
+        fs_files[f].writer = 1;
+        h->page = fs_files[f].tail;
+        h->wpos = FS_ALIGN2(fs_pages[h->page].end);
+    }
+    FS_Unlock();
+    return (int8_t)fd;
+}
+
+int32_t FS_Read(int8_t fd, void *buf, uint32_t len)
+{
+    FS_Handle_t *h = FS_Handle(fd);
+    const FS_PageHeader_t *hdr;
+    uint8_t *out = (uint8_t *)buf;
+    uint32_t total = 0, offset, n;
+    uint16_t start, k;
+
+    if (h == NULL || h->mode != FS_O_READ)
+        return FS_ERR_PARAM;
+    if (!FS_Lock())
+        return FS_ERR_BUSY;
+
+    while (total < len && h->pos < fs_files[h->file].size && FS_Locate(h))
+    {
+        /* 文件偏移 -> 数据区位置: 跳过前面的提交段 */
+        hdr = FS_HDR(h->page);
+        offset = h->pos - h->page_pos;
+        start = 0;
+        for (k = 0; k < fs_pages[h->page].commits; k++)
+        {
+            n = hdr->end[k] - start;
+            if (offset < n)
+                break;
+            offset -= n;
+            start = FS_ALIGN2(hdr->end[k]);
+        }
+        if (k == fs_pages[h->page].commits)
+            break;
+        n -= offset;
+        if (n > len - total)
+            n = len - total;
+        memcpy(out + total, FS_DATA(h->page) + start + offset, n);
+        total += n;
+        h->pos += n;
+    }
+
+    FS_Unlock();
+    return (int32_t)total;
+}
+
+int8_t FS_Seek(int8_t fd, uint32_t offset)
+{
+    FS_Handle_t *h = FS_Handle(fd);
+
+    if (h == NULL || h->mode != FS_O_READ)
+        return FS_ERR_PARAM;
+    h->pos = offset;
+    h->page = FS_NONE;
+    return FS_OK;
+}
+
+int32_t FS_Write(int8_t fd, const void *data, uint32_t len)
+{
+    FS_Handle_t *h = FS_Handle(fd);
+    const uint8_t *in = (const uint8_t *)data;
+    FS_Entry_t *e;
+    uint32_t i;
+    uint8_t p;
+    int8_t ret = FS_OK;
+
+    if (h == NULL || h->mode == FS_O_READ)
+        return FS_ERR_PARAM;
+    if (!FS_Lock())
+        return FS_ERR_BUSY;
+    e = &fs_files[h->file];
+
+    for (i = 0; i < len; i++)
+    {
+        if (h->wpos >= FS_DATA_SIZE || fs_pages[e->tail].commits >= FS_COMMIT_SLOTS ||
+            fs_pages[e->tail].torn)
+        {
+            /* 尾页已满、提交项用完或有断电留下的数据, 换下一块 */
+            if (e->blocks >= FS_PAGES)
+                p = FS_NONE;
+            else
+                p = FS_Allocate(h->file, e->blocks, NULL);
+            if (p == FS_NONE)
+            {
+                ret = FS_AvailablePages() ? FS_ERR_FLASH : FS_ERR_FULL;
+                break;
+            }
+            e->tail = h->page = p;
+            e->blocks++;
+            h->wpos = 0;
+        }
+
+        if ((h->wpos & 1) == 0)
+            h->carry = in[i];
+        else if (!FS_FlashProgram((uint32_t)FS_DATA(e->tail) + h->wpos - 1,
+                                  (uint16_t)(h->carry | ((uint16_t)in[i] << 8))))
+        {
+            ret = FS_ERR_FLASH;
+            break;
+        }
+        h->wpos++;
+
+        if (h->wpos == FS_DATA_SIZE && FS_Commit(h) != FS_OK)
+        {
+            ret = FS_ERR_FLASH;
+            i++;
+            break;
+        }
+    }
+
+    FS_Unlock();
+    return (i > 0 || ret == FS_OK) ? (int32_t)i : ret;
+}
+
+int8_t FS_Sync(int8_t fd)
+{
+    FS_Handle_t *h = FS_Handle(fd);
+    int8_t ret;
+
+    if (h == NULL || h->mode == FS_O_READ)
+        return FS_ERR_PARAM;
+    if (!FS_Lock())
+        return FS_ERR_BUSY;
+    ret = FS_Commit(h);
+    FS_Unlock();
+    return ret;
+}
+
+int8_t FS_Close(int8_t fd)
+{
+    FS_Handle_t *h = FS_Handle(fd);
+    FS_Entry_t *e;
+    int8_t ret = FS_OK;
+
+    if (h == NULL)
+        return FS_ERR_PARAM;
+    if (!FS_Lock())
+        return FS_ERR_BUSY;
+    e = &fs_files[h->file];
+
+    if (h->mode == FS_O_READ)
+    {
+        e->readers--;
+        if (!e->visible)
+            FS_Release(h->file);
+    }
+    else
+    {
+        ret = FS_Commit(h);
+        e->writer = 0;
+        if (e->replaces != FS_NONE)
+        {
+            /* 新版本生效后再作废旧版本, 两步之间断电时挂载保留序号大的 */
+            if (ret == FS_OK && FS_SetFlag(&FS_HDR(e->first)->committed))
+            {
+                fs_files[e->replaces].writer = 0;
+                FS_DropFile(e->replaces);
+                e->visible = 1;
+            }
+            else
+            {
+                fs_files[e->replaces].writer = 0;
+                FS_DropFile(h->file);
+                ret = FS_ERR_FLASH;
+            }
+            e->replaces = FS_NONE;
+            FS_IndexBuild();
+        }
+    }
+    h->used = 0;
+    FS_Unlock();
+    return ret;
+}
+
+int8_t FS_Discard(int8_t fd)
+{
+    FS_Handle_t *h = FS_Handle(fd);
+    FS_Entry_t *e;
+
+    if (h == NULL || h->mode == FS_O_READ)
+        return FS_ERR_PARAM;
+    if (h->mode != FS_O_TRUNC)
+        return FS_Close(fd);
+    if (!FS_Lock())
+        return FS_ERR_BUSY;
+    e = &fs_files[h->file];
+    if (e->replaces != FS_NONE)
+        fs_files[e->replaces].writer = 0;
+    e->writer = 0;
+    FS_DropFile(h->file);
+    FS_IndexBuild();
+    h->used = 0;
+    FS_Unlock();
+    return FS_OK;
+}
+
+int8_t FS_Remove(const char *name)
+{
+    uint8_t f;
+    int8_t ret = FS_OK;
+
+    if (!FS_NameValid(name))
+        return FS_ERR_NAME;
+    if (!FS_Lock())
+        return FS_ERR_BUSY;
+    f = FS_Lookup(name);
+    if (f == FS_NONE)
+        ret = FS_ERR_NOENT;
+    else if (fs_files[f].writer)
+        ret = FS_ERR_BUSY;
+    else
+    {
+        FS_DropFile(f);
+        FS_IndexBuild();
+    }
+    FS_Unlock();
+    return ret;
+}
+
+int8_t FS_Stat(const char *name, FS_Stat_t *st)
+{
+    uint8_t f;
+
+    if (!FS_NameValid(name))
+        return FS_ERR_NAME;
+    if (!FS_Lock())
+        return FS_ERR_BUSY;
+    f = FS_Lookup(name);
+    if (f != FS_NONE)
+    {
+        strncpy(st->name, FS_Name(f), FS_NAME_MAX);
+        st->size = fs_files[f].size;
+        st->blocks = fs_files[f].blocks;
+    }
+    FS_Unlock();
+    return (f == FS_NONE) ? FS_ERR_NOENT : FS_OK;
+}
+
+int8_t FS_List(uint8_t *cursor, FS_Stat_t *st)
+{
+    int8_t ret = FS_ERR_NOENT;
+
+    if (!FS_Lock())
+        return FS_ERR_BUSY;
+    for (; *cursor < FS_MAX_FILES; (*cursor)++)
+    {
+        if (fs_files[*cursor].seq != 0 && fs_files[*cursor].visible)
+        {
+            strncpy(st->name, FS_Name(*cursor), FS_NAME_MAX);
+            st->size = fs_files[*cursor].size;
+            st->blocks = fs_files[*cursor].blocks;
+            (*cursor)++;
+            ret = FS_OK;
+            break;
+        }
+    }
+    FS_Unlock();
+    return ret;
+}
+
+int8_t FS_Format(void)
+{
+    uint8_t p, fd;
+    int8_t ret = FS_OK;
+
+    if (!FS_Lock())
+        return FS_ERR_BUSY;
+    for (fd = 0; fd < FS_MAX_OPEN; fd++)
+    {
+        if (fs_handles[fd].used)
+            ret = FS_ERR_BUSY;
+    }
+    for (p = 0; ret == FS_OK && p < FS_PAGES; p++)
+    {
+        if (!FS_ErasePage(p))
+            ret = FS_ERR_FLASH;
+    }
+    if (ret != FS_ERR_BUSY)
+        FS_Mount();
+    FS_Unlock();
+    return ret;
+}
+
+void FS_GetInfo(FS_Info_t *info)
+{
+    uint8_t p, f;
+
+    memset(info, 0, sizeof(*info));
+    info->pages = FS_PAGES;
+    info->erase_min = FS_ERASE_UNKNOWN;
+    for (p = 0; p < FS_PAGES; p++)
+    {
+        if (fs_pages[p].state != FS_PAGE_USED)
+            info->free_pages++;
+        if (fs_pages[p].erase_count < info->erase_min)
+            info->erase_min = fs_pages[p].erase_count;
+        if (fs_pages[p].erase_count > info->erase_max)
+            info->erase_max = fs_pages[p].erase_count;
+    }
+    for (f = 0; f < FS_MAX_FILES; f++)
+    {
+        if (fs_files[f].seq != 0 && fs_files[f].visible)
+            info->files++;
+    }
+    info->relocations = fs_relocations;
+    info->mount_ms = fs_mount_ms;
+}
@@ -0,0 +1,151 @@
+/**
+  ******************************************************************************
+  * @file    flash_fs.h
+  * @brief   Log-Structured File System on Spare Internal Flash Header
+  ******************************************************************************
+  * @description
+  * OTA 状态页与 DHCP 租约之间的 21 页 (ota_image.h) 组成的小文件系统, 供网页上传的文件、
+  * 配置和日志使用 (20 页存放数据, 最后一页记录擦除次数):
+  * - 每页属于一个文件的一个块, 页头记录文件序号、块号、文件名 (第 0 块) 和提交记录;
+  *   数据只追加, 不改写: FS_Write 直接按半字编程, FS_Sync/FS_Close/页写满时在页头写一个
+  *   提交项, 断电后只丢失最后一次提交之后的数据
+  * - FS_O_TRUNC 写入新版本, FS_Close 时新版本生效, 旧版本的页作废; 断电时保留旧版本
+  * - 作废的页在分配时才擦除, 分配总是选擦除次数最少的页; 空闲页与存放静态数据的页
+  *   擦除次数相差超过 FS_WEAR_DELTA 时, 把冷数据搬到磨损最多的页上 (静态磨损均衡)
+  * - 擦除次数在页头中; 擦除前先追加到擦除次数页, 擦除后写页头前断电时从那里恢复
+  * - 挂载时扫描页头在 RAM 中建立页表和文件名哈希索引, 打开文件不访问 Flash
+  * 所有函数可在不同任务中调用 (互斥锁), 擦除一页期间 CPU 取指暂停约 20ms。
+  ******************************************************************************
+  */
+
+#ifndef __FLASH_FS_H__
+#define __FLASH_FS_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported defines ----------------------------------------------------------*/
+#define FS_ENABLE               1       /* 1=启用文件系统 */
+
+#define FS_FLASH_ADDR           0x08075000UL    /* OTA 状态页之后 */
+#define FS_PAGE_SIZE            2048
+#define FS_PAGES                20              /* 数据页 */
+#define FS_WEAR_ADDR            0x0807F000UL    /* 擦除次数页, DHCP 租约页 (0x0807F800) 之前 */
+
+#define FS_NAME_MAX             24      /* 文件名长度上限 (含结束符) */
+#define FS_MAX_FILES            16      /* 文件个数上限 (替换中的新版本也占一个) */
+#define FS_MAX_OPEN             4       /* 同时打开的句柄 */
+#define FS_COMMIT_SLOTS         32      /* 每页的提交项, 用完后换下一页 */
+#define FS_WEAR_DELTA           32      /* 静态磨损均衡的擦除次数差 */
+#define FS_LOCK_MS              1000    /* 等待其它任务的文件操作 */
+
+/* 打开方式 */
+#define FS_O_READ               0x01
+#define FS_O_APPEND             0x02    /* 追加, 文件不存在时创建 */
+#define FS_O_TRUNC              0x04    /* 写入新版本, 关闭时替换旧版本 */
+
+/* 返回值 */
+#define FS_OK                   0
+#define FS_ERR_NOENT            (-1)    /* 文件不存在 */
+#define FS_ERR_FULL             (-2)    /* 没有可用的页 */
+#define FS_ERR_FILES            (-3)    /* 文件个数或句柄已达上限 */
+#define FS_ERR_NAME             (-4)    /* 文件名为空、过长或含 '/' */
+#define FS_ERR_BUSY             (-5)    /* 文件正在写入, 或等锁超时 */
+#define FS_ERR_FLASH            (-6)    /* 擦写失败 */
+#define FS_ERR_PARAM            (-7)    /* 句柄无效或打开方式不允许该操作 */
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct {
+    char name[FS_NAME_MAX];
+    uint32_t size;                      /* 已提交的字节数 */
+    uint8_t blocks;                     /* 占用的页数 */
+} FS_Stat_t;
+
+typedef struct {
+    uint8_t pages;                      /* 总页数 */
+    uint8_t free_pages;                 /* 可分配的页 (含待擦除的页) */
+    uint8_t files;
+    uint32_t erase_min;                 /* 各页擦除次数的最小/最大值 */
+    uint32_t erase_max;
+    uint32_t relocations;               /* 本次上电以来静态磨损均衡搬移的页 */
+    uint32_t mount_ms;                  /* 挂载耗时 */
+} FS_Info_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief  挂载 (扫描页头, 清理断电留下的未完成操作), 在使用文件系统的模块之前调用一次
+ */
+void FS_Init(void);
+
+/**
+ * @brief  打开文件
+ * @param  name: 文件名
+ * @param  mode: FS_O_READ / FS_O_APPEND / FS_O_TRUNC, 同一文件同时只能有一个写句柄
+ * @retval 句柄 (>=0) 或 FS_ERR_*
+ */
+int8_t FS_Open(const char *name, uint8_t mode);
+
+/**
+ * @brief  从当前位置读取已提交的数据
+ * @retval 读到的字节数 (0 为文件末尾) 或 FS_ERR_*
+ */
+int32_t FS_Read(int8_t fd, void *buf, uint32_t len);
+
+/**
+ * @brief  设置读取位置
+ */
+int8_t FS_Seek(int8_t fd, uint32_t offset);
+
+/**
+ * @brief  追加数据 (直接写入 Flash, FS_Sync 之后才可被读取和在断电后保留)
+ * @retval 写入的字节数 (空间不足时小于 len) 或 FS_ERR_*
+ */
+int32_t FS_Write(int8_t fd, const void *data, uint32_t len);
+
+/**
+ * @brief  提交已写入的数据 (占用一个提交项, 不要每写一个字节调用一次)
+ */
+int8_t FS_Sync(int8_t fd);
+
+/**
+ * @brief  关闭句柄, 写句柄先提交; FS_O_TRUNC 打开的新版本在此生效
+ */
+int8_t FS_Close(int8_t fd);
+
+/**
+ * @brief  关闭写句柄并放弃 FS_O_TRUNC 打开后写入的文件 (替换时旧版本保持不变);
+ *         FS_O_APPEND 句柄同 FS_Close
+ */
+int8_t FS_Discard(int8_t fd);
+
+/**
+ * @brief  删除文件, 仍在读取的句柄可以读完
+ */
+int8_t FS_Remove(const char *name);
+
+int8_t FS_Stat(const char *name, FS_Stat_t *st);
+
+/**
+ * @brief  遍历文件
+ * @param  cursor: 第一次调用前置 0
+ * @retval FS_OK, 没有更多文件时 FS_ERR_NOENT
+ */
+int8_t FS_List(uint8_t *cursor, FS_Stat_t *st);
+
+/**
+ * @brief  删除所有文件并擦除所有页 (保留擦除次数), 有打开的句柄时返回 FS_ERR_BUSY
+ */
+int8_t FS_Format(void);
+
+void FS_GetInfo(FS_Info_t *info);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __FLASH_FS_H__ */
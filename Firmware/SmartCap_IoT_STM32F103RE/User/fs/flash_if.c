@@ -0,0 +1,58 @@
+/**
+  ******************************************************************************
+  * @file    flash_if.c
+  * @brief   Shared Internal Flash Access
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "flash_if.h"
+#include "cmsis_os.h"
+#include "stm32f1xx_hal.h"
+#include <stddef.h>
+
+/* Private variables ---------------------------------------------------------*/
+static osMutexId flash_mutex = NULL;
+static osStaticMutexDef_t flash_mutex_cb;
+
+/* Exported functions --------------------------------------------------------*/
+
+void Flash_Init(void)
+{
+    if (flash_mutex == NULL)
+    {
+        osMutexStaticDef(Flash, &flash_mutex_cb);
+        flash_mutex = osMutexCreate(osMutex(Flash));
+    }
+}
+
+void Flash_Acquire(void)
+{
+    if (osKernelRunning())
+        osMutexWait(flash_mutex, osWaitForever);
+    HAL_FLASH_Unlock();
+}
+
+void Flash_Release(void)
+{
+    HAL_FLASH_Lock();
+    if (osKernelRunning())
+        osMutexRelease(flash_mutex);
+}
+
+uint8_t Flash_ErasePage(uint32_t addr)
+{
+    FLASH_EraseInitTypeDef erase;
+    uint32_t page_error = 0;
+
+    erase.TypeErase = FLASH_TYPEERASE_PAGES;
+    erase.Banks = FLASH_BANK_1;
+    erase.PageAddress = addr;
+    erase.NbPages = 1;
+    return HAL_FLASHEx_Erase(&erase, &page_error) == HAL_OK;
+}
+
+uint8_t Flash_Program16(uint32_t addr, uint16_t half)
+{
+    return HAL_FLASH_Program(FLASH_TYPEPROGRAM_HALFWORD, addr, half) == HAL_OK;
+}
@@ -0,0 +1,60 @@
+/**
+  ******************************************************************************
+  * @file    flash_if.h
+  * @brief   Shared Internal Flash Access Header
+  ******************************************************************************
+  * @description
+  * 内部 Flash 的写入者有 OTA (暂存区和状态页)、文件系统和 DHCP 租约, 分别运行在
+  * HTTP/MQTT/默认任务和 DHCP 任务中。FLASH->CR 的解锁状态和 BSY 只有一份, 所以所有
+  * 擦写都在 Flash_Acquire/Flash_Release 之间进行:
+  * - Flash_Acquire 等待互斥锁后解锁 FLASH 控制器, Flash_Release 重新上锁并释放互斥锁
+  * - 调度器启动前不使用互斥锁
+  * 持锁期间不要再调用文件系统等会间接写 Flash 的接口。
+  ******************************************************************************
+  */
+
+#ifndef __FLASH_IF_H__
+#define __FLASH_IF_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief  创建互斥锁, 在调度器启动前调用一次 (User_main)
+ */
+void Flash_Init(void);
+
+/**
+ * @brief  占用 Flash 并解锁控制器, 其它任务正在擦写时等待
+ */
+void Flash_Acquire(void);
+
+/**
+ * @brief  控制器上锁并释放 Flash
+ */
+void Flash_Release(void);
+
+/**
+ * @brief  擦除一页 (须持锁), CPU 取指暂停约 20ms
+ * @param  addr: 页起始地址
+ * @retval 1:成功  0:失败
+ */
+uint8_t Flash_ErasePage(uint32_t addr);
+
+/**
+ * @brief  编程一个半字 (须持锁)
+ * @retval 1:成功  0:失败
+ */
+uint8_t Flash_Program16(uint32_t addr, uint16_t half);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __FLASH_IF_H__ */
@@ -14,10 +14,13 @@
  *    Allan Stockdill-Mander/Ian Craggs - initial API and implementation and/or initial documentation
  *******************************************************************************/
 #include "MQTTClient.h"
+#include <string.h>
 
 static void NewMessageData(MessageData* md, MQTTString* aTopicName, MQTTMessage* aMessage) {
     md->topicName = aTopicName;
     md->message = aMessage;
+    md->offset = 0;
+    md->total = aMessage->payloadlen;
 }
 
 
@@ -26,21 +29,24 @@ static int getNextPacketId(MQTTClient *c) {
 }
 
 
-static int sendPacket(MQTTClient* c, int length, Timer* timer)
+static int sendBuffer(MQTTClient* c, unsigned char* buf, int length, Timer* timer)
 {
     int rc = FAILURE,
         sent = 0;
 
     while (sent < length && !TimerIsExpired(timer))
     {
-        rc = c->ipstack->mqttwrite(c->ipstack, &c->buf[sent], length, TimerLeftMS(timer));
+        rc = c->ipstack->mqttwrite(c->ipstack, &buf[sent], length - sent, TimerLeftMS(timer));
         if (rc < 0)  // there was an error writing the data
             break;
         sent += rc;
     }
     if (sent == length)
     {
-        TimerCountdown(&c->ping_timer, c->keepAliveInterval); // record the fact that we have successfully sent the packet
+        // record the fact that we have successfully sent the packet; while a PINGRESP is
+        // outstanding the timer is its deadline and later sends (retransmits) must not move it
+        if (!c->ping_outstanding)
+            TimerCountdown(&c->ping_timer, c->keepAliveInterval);
         rc = SUCCESSS;
     }
     else
@@ -49,6 +55,69 @@ static int sendPacket(MQTTClient* c, int length, Timer* timer)
 }
 
 
+static int sendPacket(MQTTClient* c, int length, Timer* timer)
+{
+    return sendBuffer(c, c->buf, length, timer);
+}
+
+
+static unsigned char* inflightPacket(MQTTClient* c, unsigned int slot)
+{
+    return c->inflight_store + slot * c->inflight_slot_size;
+}
+
+
+/* release the in-flight publish acknowledged by a PUBACK; slots at the head of the ring are
+ * reused once everything sent before them is acknowledged too */
+static void inflightAck(MQTTClient* c, unsigned short packetid)
+{
+    unsigned int i;
+
+    for (i = 0; i < c->inflight_count; ++i)
+    {
+        unsigned int slot = (c->inflight_head + i) % c->inflight_window;
+        if (c->inflight[slot].id == packetid)
+        {
+            c->inflight[slot].id = 0;
+            break;
+        }
+    }
+    while (c->inflight_count > 0 && c->inflight[c->inflight_head].id == 0)
+    {
+        c->inflight_head = (c->inflight_head + 1) % c->inflight_window;
+        c->inflight_count--;
+    }
+}
+
+
+/* (re)send the in-flight publishes that are due, oldest first: never sent yet (queued while
+ * disconnected), or PUBACK overdue / connection replaced - those are resent with DUP */
+static int inflightSend(MQTTClient* c, Timer* timer)
+{
+    int rc = SUCCESSS;
+    unsigned int i;
+
+    for (i = 0; i < c->inflight_count && rc == SUCCESSS; ++i)
+    {
+        unsigned int slot = (c->inflight_head + i) % c->inflight_window;
+        struct InflightMessage* m = &c->inflight[slot];
+        unsigned char* pkt = inflightPacket(c, slot);
+
+        if (m->id == 0 || !TimerIsExpired(&m->retry_timer))
+            continue;
+        if (m->sent)
+        {
+            pkt[0] |= 0x08; // DUP flag of the fixed header
+            c->retransmits++;
+        }
+        rc = sendBuffer(c, pkt, m->len, timer);
+        m->sent = 1;
+        TimerCountdownMS(&m->retry_timer, c->inflight_retry_ms);
+    }
+    return rc;
+}
+
+
 void MQTTClientInit(MQTTClient* c, Network* network, unsigned int command_timeout_ms,
 		unsigned char* sendbuf, size_t sendbuf_size, unsigned char* readbuf, size_t readbuf_size)
 {
@@ -57,6 +126,7 @@ void MQTTClientInit(MQTTClient* c, Network* network, unsigned int command_timeou
 
     for (i = 0; i < MAX_MESSAGE_HANDLERS; ++i)
         c->messageHandlers[i].topicFilter = 0;
+    MQTTTopicTrie_init(&c->subscriptions);
     c->command_timeout_ms = command_timeout_ms;
     c->buf = sendbuf;
     c->buf_size = sendbuf_size;
@@ -64,155 +134,257 @@ void MQTTClientInit(MQTTClient* c, Network* network, unsigned int command_timeou
     c->readbuf_size = readbuf_size;
     c->isconnected = 0;
     c->ping_outstanding = 0;
+    c->read_len = 0;
+    c->read_need = 0;
+    c->stream_state = 0;
     c->defaultMessageHandler = NULL;
+    c->inflight_store = NULL;
+    c->inflight_slot_size = 0;
+    c->inflight_window = 0;
+    c->inflight_head = 0;
+    c->inflight_count = 0;
+    c->inflight_retry_ms = 0;
+    c->retransmits = 0;
 	c->next_packetid = 1;
     TimerInit(&c->ping_timer);
+    TimerInit(&c->last_received);
 #if defined(MQTT_TASK)
 	MutexInit(&c->mutex);
 #endif
 }
 
 
-static int decodePacket(MQTTClient* c, int* value, int timeout)
+enum StreamState { STREAM_TOPIC_LEN = 1, STREAM_VAR_HEADER, STREAM_PAYLOAD };
+
+
+/* Continue a PUBLISH too long for readbuf: the variable header (topic and packet id) is
+ * assembled in readbuf and kept there, then the payload is read into the rest of readbuf
+ * one chunk at a time.  deliverStream consumes each chunk and sets up the next one.
+ * Returns PUBLISH once the variable header or a chunk is complete, 0 while waiting for data.
+ */
+static int readStream(MQTTClient* c, Timer* timer)
 {
-    unsigned char i;
-    int multiplier = 1;
-    int len = 0;
-    const int MAX_NO_OF_REMAINING_LENGTH_BYTES = 4;
+    int rc;
+    MQTTHeader header = {0};
 
-    *value = 0;
-    do
+    for (;;)
     {
-        int rc = MQTTPACKET_READ_ERROR;
+        while (c->read_len < c->read_need)
+        {
+            rc = c->ipstack->mqttread(c->ipstack, c->readbuf + c->read_len, (int)(c->read_need - c->read_len),
+                                      TimerLeftMS(timer));
+            if (rc <= 0)
+                return (rc < 0) ? FAILURE : 0;
+            c->read_len += rc;
+            c->stream_left -= rc;
+        }
 
-        if (++len > MAX_NO_OF_REMAINING_LENGTH_BYTES)
+        if (c->stream_state == STREAM_TOPIC_LEN)
         {
-            rc = MQTTPACKET_READ_ERROR; /* bad data */
-            goto exit;
+            size_t topic_len = (c->readbuf[c->read_len - 2] << 8) | c->readbuf[c->read_len - 1];
+            header.byte = c->readbuf[0];
+            topic_len += (header.bits.qos > 0) ? 2 : 0; // and the packet id
+            if (c->read_len + topic_len >= c->readbuf_size || topic_len > c->stream_left)
+                return FAILURE; /* no room left for payload: the stream cannot be parsed */
+            c->read_need = c->read_len + topic_len;
+            c->stream_state = STREAM_VAR_HEADER;
         }
-        rc = c->ipstack->mqttread(c->ipstack, &i, 1, timeout);
-        if (rc != 1)
-            goto exit;
-        *value += (i & 127) * multiplier;
-        multiplier *= 128;
-    } while ((i & 128) != 0);
-exit:
-    return len;
+        else if (c->stream_state == STREAM_VAR_HEADER)
+        {
+            c->stream_hdr = c->read_len;
+            c->stream_total = c->stream_left;
+            c->stream_state = STREAM_PAYLOAD;
+            return PUBLISH; // the topic first: deliverStream sets up the first payload chunk
+        }
+        else
+            return PUBLISH; // a payload chunk
+    }
 }
 
 
+/* Assemble the next incoming packet in readbuf without waiting.  The network read returns
+ * whatever is available (0 when nothing is pending); the bytes read so far are kept in
+ * readbuf across calls, so a packet split over several TCP segments or modem reads is
+ * completed by later calls.  A PUBLISH that cannot fit in readbuf is streamed (readStream).
+ * Returns the packet type when a whole packet (or a streamed part) is in readbuf, 0 while
+ * it is incomplete, FAILURE on a network error or another packet that cannot fit in readbuf.
+ */
 static int readPacket(MQTTClient* c, Timer* timer)
 {
-    int rc = FAILURE;
+    int rc = 0;
     MQTTHeader header = {0};
-    int len = 0;
-    int rem_len = 0;
+    const size_t MAX_HEADER_LEN = 5; /* fixed header byte + up to 4 remaining length bytes */
 
-    /* 1. read the header byte.  This has the packet type in it */
-    if (c->ipstack->mqttread(c->ipstack, c->readbuf, 1, TimerLeftMS(timer)) != 1)
-        goto exit;
+    if (c->stream_state != 0)
+        return readStream(c, timer);
 
-    len = 1;
-    /* 2. read the remaining length.  This is variable in itself */
-    decodePacket(c, &rem_len, TimerLeftMS(timer));
-    len += MQTTPacket_encode(c->readbuf + 1, rem_len); /* put the original remaining length back into the buffer */
+    /* 1. the header byte and the remaining length, one byte at a time as the length
+     *    field is variable in itself */
+    while (c->read_need == 0)
+    {
+        rc = c->ipstack->mqttread(c->ipstack, c->readbuf + c->read_len, 1, TimerLeftMS(timer));
+        if (rc != 1)
+            goto exit;
+        if (++c->read_len >= 2 && (c->readbuf[c->read_len - 1] & 128) == 0)
+        {
+            size_t rem_len = 0, multiplier = 1, i;
 
-    /* 3. read the rest of the buffer using a callback to supply the rest of the data */
-    if (rem_len > 0 && (c->ipstack->mqttread(c->ipstack, c->readbuf + len, rem_len, TimerLeftMS(timer)) != rem_len))
-        goto exit;
+            for (i = 1; i < c->read_len; ++i)
+            {
+                rem_len += (c->readbuf[i] & 127) * multiplier;
+                multiplier *= 128;
+            }
+            c->read_need = c->read_len + rem_len;
+            if (c->read_need > c->readbuf_size)
+            {
+                header.byte = c->readbuf[0];
+                if (header.bits.type != PUBLISH || rem_len < 2)
+                {
+                    rc = BUFFER_OVERFLOW; /* the rest of the stream cannot be parsed */
+                    goto exit;
+                }
+                c->stream_state = STREAM_TOPIC_LEN;
+                c->stream_left = rem_len;
+                c->read_need = c->read_len + 2;
+                return readStream(c, timer);
+            }
+        }
+        else if (c->read_len >= MAX_HEADER_LEN)
+        {
+            rc = FAILURE; /* bad data */
+            goto exit;
+        }
+    }
+
+    /* 2. the rest of the packet, as much as is available now */
+    while (c->read_len < c->read_need)
+    {
+        rc = c->ipstack->mqttread(c->ipstack, c->readbuf + c->read_len, (int)(c->read_need - c->read_len),
+                                  TimerLeftMS(timer));
+        if (rc <= 0)
+            goto exit;
+        c->read_len += rc;
+    }
 
     header.byte = c->readbuf[0];
     rc = header.bits.type;
+    c->read_len = 0;
+    c->read_need = 0;
 exit:
+    if (rc < 0)
+        rc = FAILURE;
     return rc;
 }
 
 
-// assume topic filter and name is in correct format
-// # can only be at end
-// + and # can only be next to separator
-static char isTopicMatched(char* topicFilter, MQTTString* topicName)
+struct Delivery
 {
-    char* curf = topicFilter;
-    char* curn = topicName->lenstring.data;
-    char* curn_end = curn + topicName->lenstring.len;
+    MQTTClient* c;
+    MessageData md;
+    int rc;
+};
 
-    while (*curf && curn < curn_end)
-    {
-        if (*curn == '/' && *curf != '/')
-            break;
-        if (*curf != '+' && *curf != '#' && *curf != *curn)
-            break;
-        if (*curf == '+')
-        {   // skip until we meet the next separator, or end of string
-            char* nextpos = curn + 1;
-            while (nextpos < curn_end && *nextpos != '/')
-                nextpos = ++curn + 1;
-        }
-        else if (*curf == '#')
-            curn = curn_end - 1;    // skip until end of string
-        curf++;
-        curn++;
-    };
 
-    return (curn == curn_end) && (*curf == '\0');
+static void deliverTo(void* arg, int slot)
+{
+    struct Delivery* d = (struct Delivery*)arg;
+
+    if (d->c->messageHandlers[slot].fp != NULL)
+    {
+        d->c->messageHandlers[slot].fp(&d->md);
+        d->rc = SUCCESSS;
+    }
 }
 
 
-int deliverMessage(MQTTClient* c, MQTTString* topicName, MQTTMessage* message)
+static int deliverChunk(MQTTClient* c, MQTTString* topicName, MQTTMessage* message, size_t offset, size_t total)
 {
-    int i;
-    int rc = FAILURE;
+    struct Delivery d;
 
-    // we have to find the right message handler - indexed by topic
-    for (i = 0; i < MAX_MESSAGE_HANDLERS; ++i)
+    // the subscriptions matching the topic, found by walking its levels down the trie
+    d.c = c;
+    d.rc = FAILURE;
+    NewMessageData(&d.md, topicName, message);
+    d.md.offset = offset;
+    d.md.total = total;
+    MQTTTopicTrie_match(&c->subscriptions, topicName, deliverTo, &d);
+
+    if (d.rc == FAILURE && c->defaultMessageHandler != NULL)
     {
-        if (c->messageHandlers[i].topicFilter != 0 && (MQTTPacket_equals(topicName, (char*)c->messageHandlers[i].topicFilter) ||
-                isTopicMatched((char*)c->messageHandlers[i].topicFilter, topicName)))
-        {
-            if (c->messageHandlers[i].fp != NULL)
-            {
-                MessageData md;
-                NewMessageData(&md, topicName, message);
-                c->messageHandlers[i].fp(&md);
-                rc = SUCCESSS;
-            }
-        }
+        c->defaultMessageHandler(&d.md);
+        d.rc = SUCCESSS;
     }
 
-    if (rc == FAILURE && c->defaultMessageHandler != NULL)
+    return d.rc;
+}
+
+
+int deliverMessage(MQTTClient* c, MQTTString* topicName, MQTTMessage* message)
+{
+    return deliverChunk(c, topicName, message, 0, message->payloadlen);
+}
+
+
+/* deliver the streamed PUBLISH part now in readbuf (the topic, then each payload chunk) and
+ * set up the read of the next chunk; returns 1 once the whole message has been delivered */
+static int deliverStream(MQTTClient* c, MQTTMessage* msg)
+{
+    MQTTHeader header = {0};
+    MQTTString topicName = MQTTString_initializer;
+    unsigned char* ptr = c->readbuf + 1;
+    size_t chunk = c->read_len - c->stream_hdr,
+        room = c->readbuf_size - c->stream_hdr;
+
+    while (*ptr++ & 128)
+        ; // skip the remaining length
+    header.byte = c->readbuf[0];
+    topicName.lenstring.len = readInt(&ptr);
+    topicName.lenstring.data = (char*)ptr;
+    ptr += topicName.lenstring.len;
+    msg->qos = (enum QoS)header.bits.qos;
+    msg->retained = header.bits.retain;
+    msg->dup = header.bits.dup;
+    msg->id = (msg->qos != QOS0) ? (unsigned short)readInt(&ptr) : 0;
+    msg->payload = c->readbuf + c->stream_hdr;
+    msg->payloadlen = chunk;
+    if (chunk > 0) // not after the variable header: each chunk carries the topic, offset 0 starts a message
+        deliverChunk(c, &topicName, msg, c->stream_total - c->stream_left - chunk, c->stream_total);
+
+    c->read_len = c->stream_hdr;
+    if (c->stream_left > 0)
     {
-        MessageData md;
-        NewMessageData(&md, topicName, message);
-        c->defaultMessageHandler(&md);
-        rc = SUCCESSS;
+        c->read_need = c->stream_hdr + ((c->stream_left < room) ? c->stream_left : room);
+        return 0;
     }
-
-    return rc;
+    c->stream_state = 0;
+    c->read_len = 0;
+    c->read_need = 0;
+    return 1;
 }
 
 
 int keepalive(MQTTClient* c)
 {
-    int rc = FAILURE;
+    int rc = SUCCESSS;
 
     if (c->keepAliveInterval == 0)
-    {
-        rc = SUCCESSS;
         goto exit;
-    }
 
-    if (TimerIsExpired(&c->ping_timer))
+    if (c->ping_outstanding)
     {
-        if (!c->ping_outstanding)
-        {
-            Timer timer;
-            TimerInit(&timer);
-            TimerCountdownMS(&timer, 1000);
-            int len = MQTTSerialize_pingreq(c->buf, c->buf_size);
-            if (len > 0 && (rc = sendPacket(c, len, &timer)) == SUCCESSS) // send the ping packet
-                c->ping_outstanding = 1;
-        }
+        if (TimerIsExpired(&c->ping_timer))
+            rc = FAILURE; /* no PINGRESP within a keepalive interval: the connection is gone */
+    }
+    /* ping when nothing was sent, or nothing received: a stream of retransmits to a server
+     * that no longer answers must not keep the dead connection open */
+    else if (TimerIsExpired(&c->ping_timer) || TimerIsExpired(&c->last_received))
+    {
+        Timer timer;
+        TimerInit(&timer);
+        TimerCountdownMS(&timer, 1000);
+        int len = MQTTSerialize_pingreq(c->buf, c->buf_size);
+        if (len > 0 && (rc = sendPacket(c, len, &timer)) == SUCCESSS) // send the ping packet
+            c->ping_outstanding = 1;
     }
 
 exit:
@@ -223,27 +395,56 @@ exit:
 int cycle(MQTTClient* c, Timer* timer)
 {
     // read the socket, see what work is due
-    unsigned short packet_type = readPacket(c, timer);
+    int packet_type = readPacket(c, timer);
 
     int len = 0,
         rc = SUCCESSS;
 
+    if (packet_type == FAILURE)
+        return FAILURE;
+    if (packet_type > 0)
+        TimerCountdown(&c->last_received, c->keepAliveInterval);
+
     switch (packet_type)
     {
         case CONNACK:
+        {
+            unsigned char connack_rc = 255;
+            unsigned char sessionPresent = 0;
+            if (MQTTDeserialize_connack(&sessionPresent, &connack_rc, c->readbuf, c->readbuf_size) == 1 &&
+                connack_rc == 0)
+                c->isconnected = 1;
+            break;
+        }
         case PUBACK:
+        {
+            unsigned short mypacketid;
+            unsigned char dup, type;
+            if (MQTTDeserialize_ack(&type, &dup, &mypacketid, c->readbuf, c->readbuf_size) == 1)
+                inflightAck(c, mypacketid);
+            break;
+        }
         case SUBACK:
             break;
         case PUBLISH:
         {
             MQTTString topicName;
             MQTTMessage msg;
-            int intQoS;
-            if (MQTTDeserialize_publish(&msg.dup, &intQoS, &msg.retained, &msg.id, &topicName,
-               (unsigned char**)&msg.payload, (int*)&msg.payloadlen, c->readbuf, c->readbuf_size) != 1)
-                goto exit;
-            msg.qos = (enum QoS)intQoS;
-            deliverMessage(c, &topicName, &msg);
+            int intQoS, intPayloadLen; // payloadlen is a size_t, the deserializer writes an int
+            if (c->stream_state != 0)
+            {
+                if (!deliverStream(c, &msg))
+                    break; // acknowledged after the last chunk
+            }
+            else
+            {
+                if (MQTTDeserialize_publish(&msg.dup, &intQoS, &msg.retained, &msg.id, &topicName,
+                   (unsigned char**)&msg.payload, &intPayloadLen, c->readbuf, c->readbuf_size) != 1)
+                    goto exit;
+                msg.qos = (enum QoS)intQoS;
+                msg.payloadlen = intPayloadLen;
+                deliverMessage(c, &topicName, &msg);
+            }
             if (msg.qos != QOS0)
             {
                 if (msg.qos == QOS1)
@@ -304,6 +505,44 @@ int MQTTYield(MQTTClient* c, int timeout_ms)
 }
 
 
+int MQTTPoll(MQTTClient* c)
+{
+    int rc = SUCCESSS;
+    Timer timer;
+
+    TimerInit(&timer);
+    TimerCountdownMS(&timer, c->command_timeout_ms); /* bounds the acks sent from cycle */
+
+    // cycle returns 0 once no complete packet is left
+    do
+    {
+        rc = cycle(c, &timer);
+    } while (rc > 0);
+
+    if (rc != FAILURE && c->isconnected)
+        rc = inflightSend(c, &timer);
+    if (rc != FAILURE)
+        rc = keepalive(c);
+    return rc;
+}
+
+
+void MQTTCloseSession(MQTTClient* c)
+{
+    unsigned int i;
+
+    c->isconnected = 0;
+    c->ping_outstanding = 0;
+    c->read_len = 0;
+    c->read_need = 0;
+    c->stream_state = 0;
+
+    // the in-flight publishes stay queued and are all due once the next Connack arrives
+    for (i = 0; i < c->inflight_window; ++i)
+        TimerCountdownMS(&c->inflight[i].retry_timer, 0);
+}
+
+
 void MQTTRun(void* parm)
 {
 	Timer timer;
@@ -348,6 +587,34 @@ int waitfor(MQTTClient* c, int packet_type, Timer* timer)
 }
 
 
+int MQTTConnectAsync(MQTTClient* c, MQTTPacket_connectData* options)
+{
+    Timer connect_timer;
+    int rc = FAILURE;
+    MQTTPacket_connectData default_options = MQTTPacket_connectData_initializer;
+    int len = 0;
+
+    if (c->isconnected) /* don't send connect packet again if we are already connected */
+        goto exit;
+
+    TimerInit(&connect_timer);
+    TimerCountdownMS(&connect_timer, c->command_timeout_ms);
+
+    if (options == 0)
+        options = &default_options; /* set default options if none were supplied */
+
+    c->keepAliveInterval = options->keepAliveInterval;
+    c->ping_outstanding = 0;
+    TimerCountdown(&c->last_received, c->keepAliveInterval);
+    if ((len = MQTTSerialize_connect(c->buf, c->buf_size, options)) <= 0)
+        goto exit;
+    rc = sendPacket(c, len, &connect_timer); // the connack is handled by cycle
+
+exit:
+    return rc;
+}
+
+
 int MQTTConnect(MQTTClient* c, MQTTPacket_connectData* options)
 {
     Timer connect_timer;
@@ -369,6 +636,7 @@ int MQTTConnect(MQTTClient* c, MQTTPacket_connectData* options)
 
     c->keepAliveInterval = options->keepAliveInterval;
     TimerCountdown(&c->ping_timer, c->keepAliveInterval);
+    TimerCountdown(&c->last_received, c->keepAliveInterval);
     if ((len = MQTTSerialize_connect(c->buf, c->buf_size, options)) <= 0)
         goto exit;
     if ((rc = sendPacket(c, len, &connect_timer)) != SUCCESSS)  // send the connect packet
@@ -433,16 +701,13 @@ int MQTTSubscribe(MQTTClient* c, const char* topicFilter, enum QoS qos, messageH
             rc = grantedQoS; // 0, 1, 2 or 0x80
         if (rc != 0x80)
         {
-            int i;
-            for (i = 0; i < MAX_MESSAGE_HANDLERS; ++i)
+            int slot = MQTTTopicTrie_add(&c->subscriptions, topicFilter);
+            if (slot >= 0)
             {
-                if (c->messageHandlers[i].topicFilter == 0)
-                {
-                    c->messageHandlers[i].topicFilter = topicFilter;
-                    c->messageHandlers[i].fp = messageHandler;
-                    rc = 0;
-                    break;
-                }
+                if (c->messageHandlers[slot].topicFilter == 0)
+                    c->messageHandlers[slot].topicFilter = topicFilter;
+                c->messageHandlers[slot].fp = messageHandler;
+                rc = 0;
             }
         }
     }
@@ -457,6 +722,44 @@ exit:
 }
 
 
+int MQTTSubscribeAsync(MQTTClient* c, const char* topicFilter, enum QoS qos, messageHandler messageHandler)
+{
+    int rc = FAILURE;
+    Timer timer;
+    int len = 0;
+    int slot = -1;
+    MQTTString topic = MQTTString_initializer;
+    topic.cstring = (char *)topicFilter;
+    char charQos = (char)qos;
+
+    if (!c->isconnected)
+        goto exit;
+
+    // the same filter again (resubscribe after a reconnect) keeps its slot
+    if ((slot = MQTTTopicTrie_add(&c->subscriptions, topicFilter)) < 0)
+        goto exit;
+
+    TimerInit(&timer);
+    TimerCountdownMS(&timer, c->command_timeout_ms);
+
+    len = MQTTSerialize_subscribe(c->buf, c->buf_size, 0, getNextPacketId(c), 1, &topic, &charQos);
+    if (len <= 0)
+        goto exit;
+    if ((rc = sendPacket(c, len, &timer)) != SUCCESSS) // send the subscribe packet
+        goto exit;             // there was a problem
+
+    // registered before the suback so that messages sent right after it are not lost
+    if (c->messageHandlers[slot].topicFilter == 0)
+        c->messageHandlers[slot].topicFilter = topicFilter;
+    c->messageHandlers[slot].fp = messageHandler;
+
+exit:
+    if (rc != SUCCESSS && slot >= 0 && c->messageHandlers[slot].topicFilter == 0)
+        MQTTTopicTrie_remove(&c->subscriptions, topicFilter); // not subscribed before
+    return rc;
+}
+
+
 int MQTTUnsubscribe(MQTTClient* c, const char* topicFilter)
 {
     int rc = FAILURE;
@@ -483,7 +786,15 @@ int MQTTUnsubscribe(MQTTClient* c, const char* topicFilter)
     {
         unsigned short mypacketid;  // should be the same as the packetid above
         if (MQTTDeserialize_unsuback(&mypacketid, c->readbuf, c->readbuf_size) == 1)
+        {
+            int slot = MQTTTopicTrie_remove(&c->subscriptions, topicFilter);
+            if (slot >= 0)
+            {
+                c->messageHandlers[slot].topicFilter = 0;
+                c->messageHandlers[slot].fp = NULL;
+            }
             rc = 0;
+        }
     }
     else
         rc = FAILURE;
@@ -496,6 +807,81 @@ exit:
 }
 
 
+void MQTTSetInflightWindow(MQTTClient* c, unsigned char* store, size_t slot_size,
+		unsigned int window, unsigned int retry_ms)
+{
+    unsigned int i;
+
+    if (window > MAX_INFLIGHT)
+        window = MAX_INFLIGHT;
+    c->inflight_store = store;
+    c->inflight_slot_size = slot_size;
+    c->inflight_window = (store != NULL) ? window : 0;
+    c->inflight_head = 0;
+    c->inflight_count = 0;
+    c->inflight_retry_ms = retry_ms;
+    for (i = 0; i < MAX_INFLIGHT; ++i)
+    {
+        c->inflight[i].id = 0;
+        c->inflight[i].sent = 0;
+        TimerInit(&c->inflight[i].retry_timer);
+    }
+}
+
+
+int MQTTPublishAsync(MQTTClient* c, const char* topicName, MQTTMessage* message)
+{
+    int rc = FAILURE;
+    Timer timer;
+    MQTTString topic = MQTTString_initializer;
+    topic.cstring = (char *)topicName;
+    int len = 0;
+    unsigned int slot;
+    unsigned short id;
+    struct InflightMessage* m;
+
+    if (message->qos == QOS0)
+        return MQTTPublish(c, topicName, message);
+
+    message->id = 0;
+    if (message->qos != QOS1 || c->inflight_window == 0)
+        goto exit;
+    if (c->inflight_count >= c->inflight_window)
+    {
+        rc = WINDOW_FULL;
+        goto exit;
+    }
+
+    slot = (c->inflight_head + c->inflight_count) % c->inflight_window;
+    id = (unsigned short)getNextPacketId(c);
+    len = MQTTSerialize_publish(inflightPacket(c, slot), c->inflight_slot_size, 0, QOS1, message->retained,
+              id, topic, (unsigned char*)message->payload, message->payloadlen);
+    if (len <= 0)
+        goto exit;
+
+    m = &c->inflight[slot];
+    m->id = id;
+    m->len = (unsigned short)len;
+    m->sent = 0;
+    TimerCountdownMS(&m->retry_timer, 0);
+    c->inflight_count++;
+    message->id = m->id;
+
+    rc = SUCCESSS;
+    if (c->isconnected)
+    {
+        TimerInit(&timer);
+        TimerCountdownMS(&timer, c->command_timeout_ms);
+        rc = sendBuffer(c, inflightPacket(c, slot), len, &timer);
+        m->sent = 1; // even a failed write may have reached the broker in part: resend with DUP
+        TimerCountdownMS(&m->retry_timer, c->inflight_retry_ms);
+    }
+
+exit:
+    return rc;
+}
+
+
 int MQTTPublish(MQTTClient* c, const char* topicName, MQTTMessage* message)
 {
     int rc = FAILURE;
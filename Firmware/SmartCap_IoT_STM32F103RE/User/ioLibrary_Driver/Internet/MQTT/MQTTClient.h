@@ -40,13 +40,19 @@
 #define MAX_PACKET_ID 65535 /* according to the MQTT specification - do not change! */
 
 #if !defined(MAX_MESSAGE_HANDLERS)
-#define MAX_MESSAGE_HANDLERS 5 /* redefinable - how many subscriptions do you want? */
+#define MAX_MESSAGE_HANDLERS 32 /* redefinable - how many subscriptions do you want? */
+#endif
+
+#include "MQTTTopicTrie.h"
+
+#if !defined(MAX_INFLIGHT)
+#define MAX_INFLIGHT 8 /* redefinable - largest window for MQTTPublishAsync */
 #endif
 
 enum QoS { QOS0, QOS1, QOS2 };
 
 /* all failure return codes must be negative */
-enum returnCode { BUFFER_OVERFLOW = -2, FAILURE = -1, SUCCESSS = 0 };
+enum returnCode { WINDOW_FULL = -3, BUFFER_OVERFLOW = -2, FAILURE = -1, SUCCESSS = 0 };
 
 /* The Platform specific header must define the Network and Timer structures and functions
  * which operate on them.
@@ -75,10 +81,17 @@ typedef struct MQTTMessage
     size_t payloadlen;
 } MQTTMessage;
 
+/* A PUBLISH longer than readbuf is streamed: the topic is parsed first, then the handler is
+ * called once per chunk of up to readbuf_size - header bytes, read straight from the network
+ * into readbuf.  message->payload/payloadlen is the chunk at offset, every chunk carries the
+ * topic and only the first one has offset 0; the message is complete when offset + payloadlen
+ * == total.  Messages that fit in readbuf arrive in one call with offset 0 and total == payloadlen. */
 typedef struct MessageData
 {
     MQTTMessage* message;
     MQTTString* topicName;
+    size_t offset,          /* position of this chunk in the whole payload */
+      total;                /* whole payload length */
 } MessageData;
 
 typedef void (*messageHandler)(MessageData*);
@@ -94,24 +107,50 @@ typedef struct MQTTClient
     unsigned int keepAliveInterval;
     char ping_outstanding;
     int isconnected;
+    size_t read_len,        /* bytes of the current incoming packet already in readbuf */
+      read_need;            /* total packet length once the remaining length is known, 0 before */
+    char stream_state;      /* streamed PUBLISH: header part being read, 0 when not streaming */
+    size_t stream_hdr,      /* fixed + variable header bytes kept in readbuf while streaming */
+      stream_left,          /* bytes of the streamed packet not read yet */
+      stream_total;         /* its payload length */
 
     struct MessageHandlers
     {
         const char* topicFilter;
         void (*fp) (MessageData*);
-    } messageHandlers[MAX_MESSAGE_HANDLERS];      /* Message handlers are indexed by subscription topic */
+    } messageHandlers[MAX_MESSAGE_HANDLERS];      /* Message handlers are indexed by subscription slot */
+    MQTTTopicTrie subscriptions;                  /* topic filters, matched against incoming topics */
 
     void (*defaultMessageHandler) (MessageData*);
 
+    /* QoS1 publishes awaiting PUBACK, a ring in send order.  The serialized packets live in
+     * inflight_store (one slot of inflight_slot_size bytes per entry) and are kept across
+     * MQTTCloseSession, so they are sent again (with DUP) on the next connection. */
+    struct InflightMessage
+    {
+        unsigned short id;      /* packet id, 0 once acknowledged */
+        unsigned short len;     /* serialized PUBLISH length */
+        unsigned char sent;     /* transmitted at least once: later sends carry DUP */
+        Timer retry_timer;
+    } inflight[MAX_INFLIGHT];
+    unsigned char* inflight_store;
+    size_t inflight_slot_size;
+    unsigned int inflight_window,
+      inflight_head,
+      inflight_count,
+      inflight_retry_ms;
+    unsigned long retransmits;
+
     Network* ipstack;
-    Timer ping_timer;
+    Timer ping_timer;       /* keepalive since the last send, the PINGRESP deadline while one is outstanding */
+    Timer last_received;    /* keepalive since the last packet from the server */
 #if defined(MQTT_TASK)
 	Mutex mutex;
 	Thread thread;
 #endif 
 } MQTTClient;
 
-#define DefaultClient {0, 0, 0, 0, NULL, NULL, 0, 0, 0}
+#define DefaultClient {0, 0, 0, 0, NULL, NULL, 0, 0, 0, 0, 0}
 
 
 /**
@@ -160,6 +199,60 @@ DLLExport int MQTTUnsubscribe(MQTTClient* client, const char* topicFilter);
  */
 DLLExport int MQTTDisconnect(MQTTClient* client);
 
+/** MQTT Connect, non-blocking - send the connect packet and return.  The client becomes
+ *  connected (isconnected) when MQTTPoll receives a successful Connack.
+ *  @param options - connect options
+ *  @return success code
+ */
+DLLExport int MQTTConnectAsync(MQTTClient* client, MQTTPacket_connectData* options);
+
+/** MQTT Subscribe, non-blocking - register the handler and send the subscribe packet.
+ *  The Suback is consumed by MQTTPoll.  Subscribing again to the same filter (after a
+ *  reconnect) replaces the handler instead of taking another slot.
+ *  @return success code
+ */
+DLLExport int MQTTSubscribeAsync(MQTTClient* client, const char* topicFilter, enum QoS, messageHandler);
+
+/** MQTT Set In-flight Window - enable MQTTPublishAsync for QoS1.  Call before connecting.
+ *  @param client - the client object to use
+ *  @param store - window * slot_size bytes for the serialized packets awaiting PUBACK
+ *  @param slot_size - largest PUBLISH packet
+ *  @param window - messages in flight at once (at most MAX_INFLIGHT)
+ *  @param retry_ms - resend a message with DUP when its PUBACK has not arrived in this time
+ */
+DLLExport void MQTTSetInflightWindow(MQTTClient* client, unsigned char* store, size_t slot_size,
+		unsigned int window, unsigned int retry_ms);
+
+/** MQTT Publish, pipelined - QoS1 messages are copied into the in-flight window, sent and
+ *  left there until the PUBACK with their packet id is matched by MQTTPoll; up to window
+ *  messages may await acknowledgement.  QoS0 is sent as by MQTTPublish.
+ *  A message queued while disconnected is sent once the next Connack arrives.
+ *  @param client - the client object to use
+ *  @param topicName - the topic to publish to
+ *  @param message - the message to send, message->id is set for QoS1
+ *  @return SUCCESSS when queued (QoS1) or sent (QoS0), WINDOW_FULL when no slot is free,
+ *          FAILURE when the message could not be serialized or the write failed - in the
+ *          latter case a QoS1 message (message->id != 0) stays queued for the next connection
+ */
+DLLExport int MQTTPublishAsync(MQTTClient* client, const char* topicName, MQTTMessage* message);
+
+/** MQTT Poll - process every complete packet that has arrived and send a ping when due.
+ *  Never waits for data: the network read must return 0 when nothing is pending, partial
+ *  packets are kept in readbuf until the rest arrives.  In-flight publishes whose PUBACK is
+ *  overdue are sent again with DUP.
+ *  @param client - the client object to use
+ *  @return success code, FAILURE when the connection must be dropped
+ */
+DLLExport int MQTTPoll(MQTTClient* client);
+
+/** MQTT Close Session - forget the connection state (receive assembly, ping, connected flag)
+ *  without sending anything.  Used when the underlying connection was lost or is replaced.
+ *  Message handlers and in-flight publishes are kept; the latter are resent after the next
+ *  Connack.
+ *  @param client - the client object to use
+ */
+DLLExport void MQTTCloseSession(MQTTClient* client);
+
 /** MQTT Yield - MQTT background
  *  @param client - the client object to use
  *  @param time - the time, in milliseconds, to yield for 
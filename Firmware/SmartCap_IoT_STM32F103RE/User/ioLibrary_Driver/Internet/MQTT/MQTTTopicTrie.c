@@ -0,0 +1,261 @@
+/*******************************************************************************
+ * Topic filter trie for the MQTT client subscription table.
+ *******************************************************************************/
+#include "MQTTTopicTrie.h"
+#include <string.h>
+
+#define TRIE_ROOT 0
+
+
+/* length of the level starting at s, ending at '/' or at end */
+static int levelLength(const char* s, const char* end)
+{
+    const char* p = s;
+
+    while (p < end && *p != '/')
+        ++p;
+    return (int)(p - s);
+}
+
+
+static int isLevel(MQTTTopicNode* n, char wildcard)
+{
+    return n->len == 1 && n->level[0] == wildcard;
+}
+
+
+/* the child of node holding exactly this level text (wildcards compare as plain text), 0 if none */
+static unsigned char findChild(MQTTTopicTrie* t, unsigned char node, const char* level, int len)
+{
+    unsigned char i;
+
+    for (i = t->nodes[node].child; i != 0; i = t->nodes[i].next)
+    {
+        if (t->nodes[i].len == len && memcmp(t->nodes[i].level, level, len) == 0)
+            break;
+    }
+    return i;
+}
+
+
+/* the valid filters: '+' and '#' fill a whole level, '#' only as the last one */
+static int filterCheck(const char* filter, const char* end)
+{
+    const char* level = filter;
+
+    if (filter == end)
+        return 0;
+    for (;;)
+    {
+        int len = levelLength(level, end);
+        if (len > 255)
+            return 0;
+        if ((memchr(level, '+', len) != NULL || memchr(level, '#', len) != NULL) && len != 1)
+            return 0;
+        if (len == 1 && level[0] == '#' && level + len != end)
+            return 0;
+        if (level + len == end)
+            return 1;
+        level += len + 1;
+    }
+}
+
+
+void MQTTTopicTrie_init(MQTTTopicTrie* t)
+{
+    int i;
+
+    memset(t, 0, sizeof(*t));
+    for (i = 1; i < MAX_TOPIC_NODES - 1; ++i)
+        t->nodes[i].next = (unsigned char)(i + 1);
+    t->free = (MAX_TOPIC_NODES > 1) ? 1 : 0;
+}
+
+
+int MQTTTopicTrie_add(MQTTTopicTrie* t, const char* filter)
+{
+    const char* end = filter + strlen(filter);
+    const char* level;
+    unsigned char node = TRIE_ROOT, i;
+    int len, slot, missing = 0, available = 0;
+
+    if (!filterCheck(filter, end))
+        return -1;
+
+    /* 1. the nodes the filter needs beyond its longest existing prefix */
+    for (level = filter; ; level += len + 1)
+    {
+        len = levelLength(level, end);
+        if (missing == 0 && (i = findChild(t, node, level, len)) != 0)
+            node = i;
+        else
+            ++missing;
+        if (level + len == end)
+            break;
+    }
+    if (missing == 0 && t->nodes[node].slot != 0)
+        return t->nodes[node].slot - 1; // already subscribed
+
+    for (slot = 0; slot < MAX_MESSAGE_HANDLERS; ++slot)
+    {
+        if (t->filters[slot] == 0)
+            break;
+    }
+    for (i = t->free; i != 0; i = t->nodes[i].next)
+        ++available;
+    if (slot == MAX_MESSAGE_HANDLERS || missing > available)
+        return -1;
+
+    /* 2. the same walk again, linking the missing levels */
+    node = TRIE_ROOT;
+    for (level = filter; ; level += len + 1)
+    {
+        len = levelLength(level, end);
+        if ((i = findChild(t, node, level, len)) == 0)
+        {
+            i = t->free;
+            t->free = t->nodes[i].next;
+            t->nodes[i].level = level;
+            t->nodes[i].len = (unsigned char)len;
+            t->nodes[i].child = 0;
+            t->nodes[i].slot = 0;
+            t->nodes[i].next = t->nodes[node].child;
+            t->nodes[node].child = i;
+        }
+        node = i;
+        if (level + len == end)
+            break;
+    }
+    t->nodes[node].slot = (unsigned char)(slot + 1);
+    t->filters[slot] = filter;
+    return slot;
+}
+
+
+/* level number depth (0 = first) of filter */
+static const char* filterLevel(const char* filter, int depth, unsigned char* len)
+{
+    const char* end = filter + strlen(filter);
+
+    while (depth-- > 0)
+        filter += levelLength(filter, end) + 1;
+    *len = (unsigned char)levelLength(filter, end);
+    return filter;
+}
+
+
+int MQTTTopicTrie_remove(MQTTTopicTrie* t, const char* filter)
+{
+    const char* end = filter + strlen(filter);
+    const char* level = filter;
+    unsigned char path[MAX_TOPIC_NODES];
+    int depth = 0, slot, d;
+
+    path[0] = TRIE_ROOT;
+    for (;;)
+    {
+        int len = levelLength(level, end);
+        if (depth + 1 >= MAX_TOPIC_NODES || (path[depth + 1] = findChild(t, path[depth], level, len)) == 0)
+            return -1;
+        ++depth;
+        if (level + len == end)
+            break;
+        level += len + 1;
+    }
+    if (t->nodes[path[depth]].slot == 0)
+        return -1;
+
+    slot = t->nodes[path[depth]].slot - 1;
+    t->nodes[path[depth]].slot = 0;
+    t->filters[slot] = 0;
+
+    /* free the levels used by no other filter, deepest first */
+    for (d = depth; d > 0 && t->nodes[path[d]].slot == 0 && t->nodes[path[d]].child == 0; --d)
+    {
+        unsigned char* link = &t->nodes[path[d - 1]].child;
+        while (*link != path[d])
+            link = &t->nodes[*link].next;
+        *link = t->nodes[path[d]].next;
+        t->nodes[path[d]].next = t->free;
+        t->free = path[d];
+    }
+
+    /* the remaining levels may point into the removed filter string: move them to a filter
+     * still using the node (every remaining node leads to at least one subscription) */
+    for (; d > 0; --d)
+    {
+        MQTTTopicNode* n = &t->nodes[path[d]];
+        unsigned char i = path[d];
+        if (n->level < filter || n->level > end)
+            continue;
+        while (t->nodes[i].slot == 0)
+            i = t->nodes[i].child;
+        n->level = filterLevel(t->filters[t->nodes[i].slot - 1], d - 1, &n->len);
+    }
+    return slot;
+}
+
+
+static int matchLevel(MQTTTopicTrie* t, unsigned char node, const char* level, const char* end,
+        int sys, MQTTTopicMatchFn fn, void* arg)
+{
+    int len = levelLength(level, end);
+    int count = 0;
+    unsigned char i, j;
+
+    for (i = t->nodes[node].child; i != 0; i = t->nodes[i].next)
+    {
+        MQTTTopicNode* n = &t->nodes[i];
+
+        if (isLevel(n, '#'))
+        {
+            if (!sys)
+            {
+                fn(arg, n->slot - 1); // '#' is always a leaf with a subscription
+                ++count;
+            }
+            continue;
+        }
+        if (isLevel(n, '+') ? sys : (n->len != len || memcmp(n->level, level, len) != 0))
+            continue;
+
+        if (level + len < end)
+            count += matchLevel(t, i, level + len + 1, end, 0, fn, arg);
+        else
+        {
+            if (n->slot != 0)
+            {
+                fn(arg, n->slot - 1);
+                ++count;
+            }
+            // "a/#" also matches "a"
+            for (j = n->child; j != 0; j = t->nodes[j].next)
+            {
+                if (isLevel(&t->nodes[j], '#'))
+                {
+                    fn(arg, t->nodes[j].slot - 1);
+                    ++count;
+                }
+            }
+        }
+    }
+    return count;
+}
+
+
+int MQTTTopicTrie_match(MQTTTopicTrie* t, MQTTString* topicName, MQTTTopicMatchFn fn, void* arg)
+{
+    const char* topic = topicName->cstring;
+    int len;
+
+    if (topic != NULL)
+        len = (int)strlen(topic);
+    else
+    {
+        topic = topicName->lenstring.data;
+        len = topicName->lenstring.len;
+    }
+    if (topic == NULL)
+        return 0;
+    return matchLevel(t, TRIE_ROOT, topic, topic + len, len > 0 && topic[0] == '$', fn, arg);
+}
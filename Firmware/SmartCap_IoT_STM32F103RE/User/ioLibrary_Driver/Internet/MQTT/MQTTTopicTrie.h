@@ -0,0 +1,75 @@
+/*******************************************************************************
+ * Topic filter trie for the MQTT client subscription table.
+ *
+ * Every subscribed filter is a path of level nodes from the root ("a/+/c" is
+ * a -> + -> c); filters sharing a prefix share its nodes.  An incoming topic is
+ * matched by walking its levels down the trie, following the exact level, '+'
+ * and '#' children at each step, so the cost depends on the topic depth and
+ * the branching at each level, not on the number of subscriptions.
+ *
+ * Nodes come from a fixed pool inside the trie (no heap).  The level text is
+ * not copied: nodes point into the subscribed filter strings, which must stay
+ * valid until they are removed.
+ *******************************************************************************/
+
+#if !defined(MQTTTOPICTRIE_H)
+#define MQTTTOPICTRIE_H
+
+#if defined(__cplusplus)
+ extern "C" {
+#endif
+
+#include "./MQTTPacket/src/MQTTPacket.h"
+
+#if !defined(MAX_MESSAGE_HANDLERS)
+#define MAX_MESSAGE_HANDLERS 32 /* redefinable - how many subscriptions do you want? */
+#endif
+
+#if !defined(MAX_TOPIC_NODES)
+#define MAX_TOPIC_NODES 64 /* redefinable - one node per distinct filter level, plus the root (at most 255) */
+#endif
+
+typedef struct MQTTTopicNode
+{
+    const char* level;      /* level text inside a subscribed filter, not terminated */
+    unsigned char len;      /* level length */
+    unsigned char child;    /* first child, 0 = none (node 0 is the root) */
+    unsigned char next;     /* next sibling, or next free node */
+    unsigned char slot;     /* subscription ending at this node + 1, 0 = none */
+} MQTTTopicNode;
+
+typedef struct MQTTTopicTrie
+{
+    MQTTTopicNode nodes[MAX_TOPIC_NODES];
+    const char* filters[MAX_MESSAGE_HANDLERS];  /* subscribed filter per slot, 0 = free */
+    unsigned char free;                         /* first free node, 0 = pool exhausted */
+} MQTTTopicTrie;
+
+/* called once per subscription slot matching a topic */
+typedef void (*MQTTTopicMatchFn)(void* arg, int slot);
+
+/** Empty the trie. */
+void MQTTTopicTrie_init(MQTTTopicTrie* trie);
+
+/** Add a topic filter.
+ *  @return its slot (0 .. MAX_MESSAGE_HANDLERS-1) - the existing one when the filter is
+ *          already subscribed - or -1 for an invalid filter or a full table/pool
+ */
+int MQTTTopicTrie_add(MQTTTopicTrie* trie, const char* filter);
+
+/** Remove a topic filter and free the nodes no other filter uses.
+ *  @return the slot it occupied, -1 when the filter is not subscribed
+ */
+int MQTTTopicTrie_remove(MQTTTopicTrie* trie, const char* filter);
+
+/** Call fn once for each subscribed filter matching a topic name.  Topics starting with '$'
+ *  are not matched by filters starting with a wildcard.
+ *  @return the number of matching filters
+ */
+int MQTTTopicTrie_match(MQTTTopicTrie* trie, MQTTString* topicName, MQTTTopicMatchFn fn, void* arg);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif
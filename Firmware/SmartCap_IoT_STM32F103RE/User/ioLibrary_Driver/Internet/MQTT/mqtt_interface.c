@@ -43,17 +43,25 @@
 #include "mqtt_interface.h"
 #include "wizchip_conf.h"
 #include "socket.h"
+#include "cmsis_os.h"
 
 unsigned long MilliTimer;
 
 /*
  * @brief MQTT MilliTimer handler
- * @note MUST BE register to your system 1m Tick timer handler.
+ * @note Kept for compatibility, the timers below read the RTOS tick instead.
  */
 void MilliTimer_Handler(void) {
 	MilliTimer++;
 }
 
+/*
+ * @brief current time in milliseconds (configTICK_RATE_HZ is 1000)
+ */
+static unsigned long mqtt_millis(void) {
+	return osKernelSysTick();
+}
+
 /*
  * @brief Timer Initialize
  * @param  timer : pointer to a Timer structure
@@ -69,7 +77,7 @@ void TimerInit(Timer* timer) {
  *         that contains the configuration information for the Timer.
  */
 char TimerIsExpired(Timer* timer) {
-	long left = timer->end_time - MilliTimer;
+	long left = timer->end_time - mqtt_millis();
 	return (left < 0);
 }
 
@@ -80,7 +88,7 @@ char TimerIsExpired(Timer* timer) {
  *         timeout : setting timeout millisecond.
  */
 void TimerCountdownMS(Timer* timer, unsigned int timeout) {
-	timer->end_time = MilliTimer + timeout;
+	timer->end_time = mqtt_millis() + timeout;
 }
 
 /*
@@ -90,7 +98,7 @@ void TimerCountdownMS(Timer* timer, unsigned int timeout) {
  *         timeout : setting timeout millisecond.
  */
 void TimerCountdown(Timer* timer, unsigned int timeout) {
-	timer->end_time = MilliTimer + (timeout * 1000);
+	timer->end_time = mqtt_millis() + (timeout * 1000);
 }
 
 /*
@@ -99,7 +107,7 @@ void TimerCountdown(Timer* timer, unsigned int timeout) {
  *         that contains the configuration information for the Timer.
  */
 int TimerLeftMS(Timer* timer) {
-	long left = timer->end_time - MilliTimer;
+	long left = timer->end_time - mqtt_millis();
 	return (left < 0) ? 0 : left;
 }
 
@@ -112,6 +120,7 @@ int TimerLeftMS(Timer* timer) {
  */
 void NewNetwork(Network* n, int sn) {
 	n->my_socket = sn;
+	n->ctx = 0;
 	n->mqttread = w5x00_read;
 	n->mqttwrite = w5x00_write;
 	n->disconnect = w5x00_disconnect;
@@ -123,15 +132,22 @@ void NewNetwork(Network* n, int sn) {
  *         that contains the configuration information for the Network.
  *         buffer : pointer to a read buffer.
  *         len : buffer length.
- * @retval received data length or SOCKERR code
+ * @retval received data length, 0 when nothing is pending, or SOCKERR code
+ * @note   never waits: MQTTClient assembles partial packets across calls.
  */
 int w5x00_read(Network* n, unsigned char* buffer, int len, long time)
 {
+	uint16_t rsr;
 
-	if((getSn_SR(n->my_socket) == SOCK_ESTABLISHED) && (getSn_RX_RSR(n->my_socket)>0))
-		return recv(n->my_socket, buffer, len);
+	if(getSn_SR(n->my_socket) != SOCK_ESTABLISHED)
+		return SOCK_ERROR;
 
-	return SOCK_ERROR;
+	rsr = getSn_RX_RSR(n->my_socket);
+	if(rsr == 0)
+		return 0;
+	if(len > rsr)
+		len = rsr;
+	return recv(n->my_socket, buffer, len);
 }
 
 /*
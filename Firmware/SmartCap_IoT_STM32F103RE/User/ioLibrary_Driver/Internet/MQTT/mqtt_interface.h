@@ -221,7 +221,7 @@ extern "C" {
 
 /*
  * @brief MQTT MilliTimer handler
- * @note MUST BE register to your system 1m Tick timer handler
+ * @note Not needed in this port: the timers use the RTOS tick (osKernelSysTick, 1 kHz).
  */
 void MilliTimer_Handler(void);
 
@@ -241,6 +241,7 @@ typedef struct Network Network;
 struct Network
 {
 	int my_socket;
+	const void* ctx;	// transport used by non-socket networks (see mqtt_uplink.c)
 	int (*mqttread) (Network*, unsigned char*, int, long);
 	int (*mqttwrite) (Network*, unsigned char*, int, long);
 	void (*disconnect) (Network*);
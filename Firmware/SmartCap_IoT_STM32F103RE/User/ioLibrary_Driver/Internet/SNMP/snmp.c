@@ -13,6 +13,8 @@
 /********************************************************************************************/
 // SNMP Parsing functions
 int32_t findEntry(uint8_t *oid, int32_t len);
+int32_t findNextEntry(uint8_t *oid, int32_t len);
+int32_t compareOID(const uint8_t *a, int32_t alen, const uint8_t *b, int32_t blen);
 int32_t getOID(int32_t id, uint8_t *oid, uint8_t *len);
 int32_t getValue( uint8_t *vptr, int32_t vlen);
 int32_t getEntry(int32_t id, uint8_t *dataType, void *ptr, int32_t *len);
@@ -21,7 +23,6 @@ int32_t makeTrapVariableBindings(dataEntryType *oid_data, void *ptr, uint32_t *l
 
 int32_t parseLength(const uint8_t *msg, int32_t *len);
 int32_t parseTLV(const uint8_t *msg, int32_t index, tlvStructType *tlv);
-void insertRespLen(int32_t reqStart, int32_t respStart, int32_t size);
 int32_t parseVarBind(int32_t reqType, int32_t index);
 int32_t parseSequence(int32_t reqType, int32_t index);
 int32_t parseSequenceOf(int32_t reqType);
@@ -56,6 +57,14 @@ static uint8_t SOCK_SNMP_TRAP;
 uint8_t packet_trap[MAX_TRAPMSG_LEN] = {0,};
 uint8_t errorStatus, errorIndex;
 
+// Request offsets of the PDU tag, error-status and error-index (tooBig response)
+static int32_t reqPduStart, reqErrStatus, reqErrIndex;
+
+#define RESP_HEADER_LEN				4		// tag, 0x82, length (2 bytes)
+#ifndef MAX
+#define MAX(a, b)					(((a) > (b)) ? (a) : (b))
+#endif
+
 
 /********************************************************************************************/
 /* SNMP : Time handler                                                                      */
@@ -157,7 +166,21 @@ int32_t snmpd_run(void)
 		case SOCK_UDP :
 			if ( (len = getSn_RX_RSR(SOCK_SNMP_AGENT)) > 0)
 			{
+				uint8_t info = 0;
+
+				if (len > MAX_SNMPMSG_LEN) len = MAX_SNMPMSG_LEN;
 				request_msg.len= recvfrom(SOCK_SNMP_AGENT, request_msg.buffer, len, svr_addr, &svr_port);
+
+				// A request larger than the buffer is dropped: the rest of the
+				// datagram is read and discarded, or the next recvfrom returns it
+				getsockopt(SOCK_SNMP_AGENT, SO_PACKINFO, &info);
+				while (info & PACK_REMAINED)
+				{
+					request_msg.len = 0;
+					if (recvfrom(SOCK_SNMP_AGENT, response_msg.buffer, MAX_SNMPMSG_LEN, svr_addr, &svr_port) <= 0)
+						break;
+					getsockopt(SOCK_SNMP_AGENT, SO_PACKINFO, &info);
+				}
 			}
 			else
 			{
@@ -204,22 +227,83 @@ int32_t snmpd_run(void)
 }
 
 
+/*
+ * Compare two BER encoded OIDs in lexicographic order of their sub-identifiers.
+ * Sub-identifiers are decoded first: comparing the raw bytes is wrong when
+ * a multi-byte sub-identifier meets one of a different encoded length.
+ * Returns <0, 0 or >0 like memcmp.
+ */
+int32_t compareOID(const uint8_t *a, int32_t alen, const uint8_t *b, int32_t blen)
+{
+	int32_t i = 0, j, k = 0;
+	uint32_t va, vb;
+
+	// Equal bytes are equal sub-identifiers: start decoding at the
+	// sub-identifier that holds the first difference
+	while ((i < alen) && (i < blen) && (a[i] == b[i]))
+	{
+		if (!(a[i] & 0x80)) k = i + 1;
+		i++;
+	}
+	i = j = k;
+
+	while ((i < alen) && (j < blen))
+	{
+		va = 0;
+		do { va = (va << 7) | (a[i] & 0x7f); } while ((a[i++] & 0x80) && (i < alen));
+		vb = 0;
+		do { vb = (vb << 7) | (b[j] & 0x7f); } while ((b[j++] & 0x80) && (j < blen));
+
+		if (va != vb) return (va < vb) ? -1 : 1;
+	}
+
+	if (i < alen) return 1;		// b is a prefix of a
+	if (j < blen) return -1;
+	return 0;
+}
+
+
+/*
+ * snmpData[] is generated in ascending OID order (see User/snmp/gen_mib.py),
+ * both lookups are binary searches.
+ */
 int32_t findEntry(uint8_t *oid, int32_t len)
 {
-	int32_t i;
+	int32_t lo = 0, hi = maxData - 1, mid, cmp;
 
-	for (i = 0 ; i < maxData ; i++)
+	while (lo <= hi)
 	{
-		if (len == snmpData[i].oidlen)
-		{
-			if (!memcmp(snmpData[i].oid, oid, len)) return(i);
-		}
+		mid = (lo + hi) / 2;
+		cmp = compareOID(snmpData[mid].oid, snmpData[mid].oidlen, oid, len);
+
+		if (cmp == 0) return mid;
+		if (cmp < 0) lo = mid + 1;
+		else hi = mid - 1;
 	}
 
 	return OID_NOT_FOUND;
 }
 
 
+/*
+ * Index of the first entry after the given OID (GetNext). The OID does not
+ * have to exist: a subtree prefix such as 1.3.6.1 returns its first leaf.
+ */
+int32_t findNextEntry(uint8_t *oid, int32_t len)
+{
+	int32_t lo = 0, hi = maxData, mid;
+
+	while (lo < hi)
+	{
+		mid = (lo + hi) / 2;
+		if (compareOID(snmpData[mid].oid, snmpData[mid].oidlen, oid, len) <= 0) lo = mid + 1;
+		else hi = mid;
+	}
+
+	return (lo < maxData) ? lo : OID_NOT_FOUND;
+}
+
+
 int32_t getOID(int32_t id, uint8_t *oid, uint8_t *len)
 {
 	int32_t j;
@@ -256,6 +340,8 @@ int32_t getEntry(int32_t id, uint8_t *dataType, void *ptr, int32_t *len)
 {
 	uint8_t * ptr_8;
 	int32_t value;
+	uint8_t be[5];
+	int32_t first;
 
 	uint8_t * string;
 	int32_t j;
@@ -299,9 +385,6 @@ int32_t getEntry(int32_t id, uint8_t *dataType, void *ptr, int32_t *len)
 				snmpData[id].getfunction( (void *)&snmpData[id].u.intval, &snmpData[id].dataLen );
 			}
 
-			if(snmpData[id].dataLen) 	*len = snmpData[id].dataLen;
-			else 						*len = sizeof(uint32_t);
-
 			/*
 			// Original code (IAR, STM32)
 			// This code is not working in NXP+LPCXpresso (32-bit pointer operation error)
@@ -310,12 +393,27 @@ int32_t getEntry(int32_t id, uint8_t *dataType, void *ptr, int32_t *len)
 			*/
 
 			ptr_8 = ptr;
-			//value = HTONL(snmpData[id].u.intval); // Endian convert when processing 32bit pointer operation
 			value = snmpData[id].u.intval;
 
+			// Shortest BER content: INTEGER is signed, Counter/Gauge/TimeTicks are
+			// unsigned and need a leading 0x00 when the top bit is set.
+			be[0] = ((*dataType == SNMPDTYPE_INTEGER) && (value < 0)) ? 0xff : 0x00;
+			for (j = 0 ; j < 4 ; j++)
+			{
+				be[j+1] = (uint8_t)((uint32_t)value >> ((3-j)*8));
+			}
+			first = 0;
+			while ((first < 4) &&
+			       (((be[first] == 0x00) && !(be[first+1] & 0x80)) ||
+			        ((be[first] == 0xff) && (be[first+1] & 0x80))))
+			{
+				first++;
+			}
+
+			*len = 5 - first;
 			for (j = 0 ; j < *len ; j++)
 			{
-				ptr_8[j] = (uint8_t)((value >> ((*len-j-1)*8)));
+				ptr_8[j] = be[first+j];
 			}
 		}
 		break;
@@ -334,6 +432,14 @@ int32_t setEntry(int32_t id, void *val, int32_t vlen, uint8_t dataType, int32_t
 	int32_t retStatus=OID_NOT_FOUND;
 	int32_t j;
 
+	// Only entries with a set function are writable (SNMPv1 reports noSuchName)
+	if (snmpData[id].setfunction == NULL)
+	{
+		errorStatus = NO_SUCH_NAME;
+		errorIndex = index;
+		return OID_NOT_FOUND;
+	}
+
 	if (snmpData[id].dataType != dataType)
 	{
 		errorStatus = BAD_VALUE; 
@@ -407,16 +513,28 @@ int32_t parseLength(const uint8_t *msg, int32_t *len)
 }
 
 
+/*
+ * Returns -1 when the TLV does not fit in the received message: every
+ * length comes from the network and is checked before it is used.
+ */
 int32_t parseTLV(const uint8_t *msg, int32_t index, tlvStructType *tlv)
 {
 	int32_t Llen = 0;
 
+	if (index + 2 > request_msg.len) return -1;
+
+	// Long form with 1 or 2 length bytes (MAX_SNMPMSG_LEN needs no more)
+	if ((msg[index+1] & 0x80) && (((msg[index+1] & 0x7f) == 0) || ((msg[index+1] & 0x7f) > 2))) return -1;
+	if (index + 2 + (msg[index+1] & 0x7f) > request_msg.len) return -1;
+
 	tlv->start = index;
 
 	Llen = parseLength((const uint8_t *)&msg[index+1], &tlv->len );
 
 	tlv->vstart = index + Llen + 1;
 
+	if (tlv->vstart + tlv->len > request_msg.len) return -1;
+
 	switch (msg[index])
 	{
 	case SNMPDTYPE_SEQUENCE:
@@ -434,31 +552,30 @@ int32_t parseTLV(const uint8_t *msg, int32_t index, tlvStructType *tlv)
 }
 
 
-void insertRespLen(int32_t reqStart, int32_t respStart, int32_t size)
+/*
+ * Constructed types in the response are written with a two byte long form
+ * length (0x82 hi lo): the response is usually longer than the request, so
+ * copying the request's length form does not work once a length crosses 127.
+ */
+static int32_t putRespHeader(uint8_t tag)
 {
-	int32_t indexStart, lenLength;
-	uint32_t mask = 0xff;
-	int32_t shift = 0;
+	int32_t loc = response_msg.index;
 
-	if (request_msg.buffer[reqStart+1] & 0x80)
-	{
-		lenLength = request_msg.buffer[reqStart+1] & 0x7f;
-		indexStart = respStart+2;
+	response_msg.buffer[loc] = tag;
+	response_msg.buffer[loc+1] = 0x82;
+	response_msg.index += RESP_HEADER_LEN;
 
-		while (lenLength--)
-		{
-			response_msg.buffer[indexStart+lenLength] = 
-				(uint8_t)((size & mask) >> shift);
-			shift+=8;
-			mask <<= shift;
-		}
-	}
-	else
-	{
-		response_msg.buffer[respStart+1] = (uint8_t)(size & 0xff);
-	}
+	return loc;
 }
 
+
+static void putRespLen(int32_t respLoc, int32_t size)
+{
+	response_msg.buffer[respLoc+2] = (uint8_t)(size >> 8);
+	response_msg.buffer[respLoc+3] = (uint8_t)size;
+}
+
+
 int32_t parseVarBind(int32_t reqType, int32_t index)
 {
 	int32_t seglen = 0, id;
@@ -467,11 +584,22 @@ int32_t parseVarBind(int32_t reqType, int32_t index)
 	
 	//extern const int32_t maxData;
 
-	parseTLV(request_msg.buffer, request_msg.index, &name);
+	if (parseTLV(request_msg.buffer, request_msg.index, &name) < 0) return -1;
 
 	if ( request_msg.buffer[name.start] != SNMPDTYPE_OBJ_ID ) return -1;
 
-	id = findEntry(&request_msg.buffer[name.vstart], name.len);
+	if (parseTLV(request_msg.buffer, name.nstart, &value) < 0) return -1;
+
+	// Worst case for this variable binding: the name or the longest OID in the
+	// table, the request's value or the longest value in the table
+	if (response_msg.index + MAX(name.nstart - name.start, 2 + MAX_OID) + MAX(value.nstart - value.start, 2 + MAX_STRING)
+	    > MAX_SNMPMSG_LEN)
+		return RESPONSE_TOO_BIG;
+
+	if (reqType == GET_NEXT_REQUEST)
+		id = findNextEntry(&request_msg.buffer[name.vstart], name.len);
+	else
+		id = findEntry(&request_msg.buffer[name.vstart], name.len);
 
 	if ((reqType == GET_REQUEST) || (reqType == SET_REQUEST))
 	{
@@ -483,7 +611,7 @@ int32_t parseVarBind(int32_t reqType, int32_t index)
 	{
 		response_msg.buffer[response_msg.index] = request_msg.buffer[name.start];
 
-		if (++id >= maxData)
+		if (id == OID_NOT_FOUND)
 		{
 			id = OID_NOT_FOUND;
 			seglen = name.nstart - name.start;
@@ -502,8 +630,6 @@ int32_t parseVarBind(int32_t reqType, int32_t index)
 		}
 	}
 
-	parseTLV(request_msg.buffer, request_msg.index, &value);
-
 	if (id != OID_NOT_FOUND)
 	{
 		uint8_t dataType;
@@ -545,49 +671,53 @@ int32_t parseVarBind(int32_t reqType, int32_t index)
 
 int32_t parseSequence(int32_t reqType, int32_t index)
 {
-	int32_t seglen;
 	tlvStructType seq;
 	int32_t size = 0, respLoc;
 
-	parseTLV(request_msg.buffer, request_msg.index, &seq);
+	if (parseTLV(request_msg.buffer, request_msg.index, &seq) < 0) return -1;
 
 	if ( request_msg.buffer[seq.start] != SNMPDTYPE_SEQUENCE ) return -1;
 
-	seglen = seq.vstart - seq.start;
-	respLoc = response_msg.index;
-	COPY_SEGMENT(seq);
+	if (response_msg.index + RESP_HEADER_LEN > MAX_SNMPMSG_LEN) return RESPONSE_TOO_BIG;
+
+	request_msg.index = seq.vstart;
+	respLoc = putRespHeader(SNMPDTYPE_SEQUENCE);
 
 	size = parseVarBind( reqType, index );
-	insertRespLen(seq.start, respLoc, size);
-	size += seglen;
+	if (size < 0) return size;
 
-	return size;
+	// The variable binding must end where its SEQUENCE ends
+	if (request_msg.index != seq.vstart + seq.len) return -1;
+
+	putRespLen(respLoc, size);
+
+	return size + RESP_HEADER_LEN;
 }
 
 
 int32_t parseSequenceOf(int32_t reqType)
 {
-	int32_t seglen;
 	tlvStructType seqof;
-	int32_t size = 0, respLoc;
+	int32_t size = 0, respLoc, ret;
 	int32_t index = 0;
 
-	parseTLV(request_msg.buffer, request_msg.index, &seqof);
+	if (parseTLV(request_msg.buffer, request_msg.index, &seqof) < 0) return -1;
 
 	if ( request_msg.buffer[seqof.start] != SNMPDTYPE_SEQUENCE_OF ) return -1;
 
-	seglen = seqof.vstart - seqof.start;
-	respLoc = response_msg.index;
-	COPY_SEGMENT(seqof);
+	request_msg.index = seqof.vstart;
+	respLoc = putRespHeader(SNMPDTYPE_SEQUENCE_OF);
 
-	while (request_msg.index < request_msg.len)
+	while (request_msg.index < seqof.vstart + seqof.len)
 	{
-		size += parseSequence( reqType, index++ );
+		ret = parseSequence( reqType, index++ );
+		if (ret < 0) return ret;
+		size += ret;
 	}
 
-	insertRespLen(seqof.start, respLoc, size);
+	putRespLen(respLoc, size);
 
-	return size;
+	return size + RESP_HEADER_LEN;
 }
 
 
@@ -596,48 +726,56 @@ int32_t parseRequest()
 	int32_t ret, seglen;
 	tlvStructType snmpreq, requestid, errStatus, errIndex;
 	int32_t size = 0, respLoc, reqType;
+	int32_t respErrStatus, respErrIndex;
 
-	parseTLV(request_msg.buffer, request_msg.index, &snmpreq);
+	if (parseTLV(request_msg.buffer, request_msg.index, &snmpreq) < 0) return -1;
 
 	reqType = request_msg.buffer[snmpreq.start];
 
 	if ( !VALID_REQUEST(reqType) ) return -1;
 
-	seglen = snmpreq.vstart - snmpreq.start;
-	respLoc = snmpreq.start;
-	size += seglen;
-	COPY_SEGMENT(snmpreq);
-
-	response_msg.buffer[snmpreq.start] = GET_RESPONSE;
+	request_msg.index = snmpreq.vstart;
+	respLoc = putRespHeader(GET_RESPONSE);
 
-	parseTLV(request_msg.buffer, request_msg.index, &requestid);
+	if (parseTLV(request_msg.buffer, request_msg.index, &requestid) < 0) return -1;
+	if ((request_msg.buffer[requestid.start] != SNMPDTYPE_INTEGER) || (requestid.len < 1) || (requestid.len > 4)) return -1;
 	seglen = requestid.nstart - requestid.start;
 	size += seglen;
 	COPY_SEGMENT(requestid);
 
-	parseTLV(request_msg.buffer, request_msg.index, &errStatus);
+	// error-status and error-index are rewritten in place: one byte each
+	if (parseTLV(request_msg.buffer, request_msg.index, &errStatus) < 0) return -1;
+	if ((request_msg.buffer[errStatus.start] != SNMPDTYPE_INTEGER) || (errStatus.len != 1)) return -1;
 	seglen = errStatus.nstart - errStatus.start;
 	size += seglen;
+	respErrStatus = response_msg.index + (errStatus.vstart - errStatus.start);
 	COPY_SEGMENT(errStatus);
 
-	parseTLV(request_msg.buffer, request_msg.index, &errIndex);
+	if (parseTLV(request_msg.buffer, request_msg.index, &errIndex) < 0) return -1;
+	if ((request_msg.buffer[errIndex.start] != SNMPDTYPE_INTEGER) || (errIndex.len != 1)) return -1;
 	seglen = errIndex.nstart - errIndex.start;
 	size += seglen;
+	respErrIndex = response_msg.index + (errIndex.vstart - errIndex.start);
 	COPY_SEGMENT(errIndex);
 
+	// Request offsets for a tooBig response, which is a copy of the request
+	reqPduStart = snmpreq.start;
+	reqErrStatus = errStatus.vstart;
+	reqErrIndex = errIndex.vstart;
+
 	ret = parseSequenceOf(reqType);
-	if (ret == -1) return -1;
+	if (ret < 0) return ret;
 	else size += ret;
 
-	insertRespLen(snmpreq.start, respLoc, size);
+	putRespLen(respLoc, size);
 
 	if (errorStatus)
 	{
-		response_msg.buffer[errStatus.vstart] = errorStatus;
-		response_msg.buffer[errIndex.vstart] = errorIndex + 1;
+		response_msg.buffer[respErrStatus] = errorStatus;
+		response_msg.buffer[respErrIndex] = errorIndex + 1;
 	}
 
-	return size;
+	return size + RESP_HEADER_LEN;
 }
 
 
@@ -645,9 +783,9 @@ int32_t parseCommunity()
 {
 	int32_t seglen;
 	tlvStructType community;
-	int32_t size=0;
+	int32_t size=0, ret;
 
-	parseTLV(request_msg.buffer, request_msg.index, &community);
+	if (parseTLV(request_msg.buffer, request_msg.index, &community) < 0) return -1;
 
 	if (!((request_msg.buffer[community.start] == SNMPDTYPE_OCTET_STRING) && (community.len == COMMUNITY_SIZE))) 
 	{
@@ -660,7 +798,9 @@ int32_t parseCommunity()
 		size += seglen;
 		COPY_SEGMENT(community);
 
-		size += parseRequest();
+		ret = parseRequest();
+		if (ret < 0) return ret;
+		size += ret;
 	}
 	else
 	{
@@ -676,40 +816,53 @@ int32_t parseVersion()
 	int32_t size = 0, seglen;
 	tlvStructType tlv;
 
-	size = parseTLV(request_msg.buffer, request_msg.index, &tlv);
+	if (parseTLV(request_msg.buffer, request_msg.index, &tlv) < 0) return -1;
 
-	if (!((request_msg.buffer[tlv.start] == SNMPDTYPE_INTEGER) && (request_msg.buffer[tlv.vstart] == SNMP_V1)))
+	if (!((request_msg.buffer[tlv.start] == SNMPDTYPE_INTEGER) && (tlv.len == 1) && (request_msg.buffer[tlv.vstart] == SNMP_V1)))
 		return -1;
 
 	seglen = tlv.nstart - tlv.start;
-	size += seglen;
 	COPY_SEGMENT(tlv);
 	size = parseCommunity();
 
-	if (size == -1) return size;
+	if (size < 0) return size;
 	else return (size + seglen);
 }
 
 
+/*
+ * Returns 0 when response_msg holds the response, -1 when the request is
+ * dropped. A response that would not fit in MAX_SNMPMSG_LEN is replaced by a
+ * copy of the request with error-status tooBig and error-index 0 (RFC 1157 4.1.2).
+ */
 int32_t parseSNMPMessage()
 {
-	int32_t size = 0, seglen, respLoc;
+	int32_t size = 0, respLoc, msgLen;
 	tlvStructType tlv;
 
-	parseTLV(request_msg.buffer, request_msg.index, &tlv);
+	if (parseTLV(request_msg.buffer, request_msg.index, &tlv) < 0) return -1;
 
 	if (request_msg.buffer[tlv.start] != SNMPDTYPE_SEQUENCE_OF) return -1;
 
-	seglen = tlv.vstart - tlv.start;
-	respLoc = tlv.start;
-	COPY_SEGMENT(tlv);
+	msgLen = tlv.vstart + tlv.len;
+	request_msg.len = msgLen;		// ignore anything after the message
+	request_msg.index = tlv.vstart;
+	respLoc = putRespHeader(SNMPDTYPE_SEQUENCE_OF);
 
 	size = parseVersion();
 
-	if (size == -1) return -1;
-	else size += seglen;
+	if (size == RESPONSE_TOO_BIG)
+	{
+		memcpy(response_msg.buffer, request_msg.buffer, msgLen);
+		response_msg.buffer[reqPduStart] = GET_RESPONSE;
+		response_msg.buffer[reqErrStatus] = TOO_BIG;
+		response_msg.buffer[reqErrIndex] = 0;
+		response_msg.index = msgLen;
+		return 0;
+	}
+	if (size < 0) return -1;
 
-	insertRespLen(tlv.start, respLoc, size);
+	putRespLen(respLoc, size);
 
 	return 0;
 }
@@ -876,12 +1029,18 @@ int32_t snmp_sendTrap(uint8_t * managerIP, uint8_t * agentIP, int8_t* community,
 	packet_trap[packet_buff2] = packet_index - (9 + (uint8_t)strlen((char const*)community));
 
 	// Send SNMP Trap Packet to NMS
+	// The trap socket may be the agent socket itself (the W5500 has only 8 sockets):
+	// in that case it is already open and must stay open.
 	{
-		socket(SOCK_SNMP_TRAP, Sn_MR_UDP, PORT_SNMP_TRAP, 0);
-		sendto(SOCK_SNMP_TRAP, packet_trap, packet_index, managerIP, PORT_SNMP_TRAP);
+		int32_t ret;
+
+		if (SOCK_SNMP_TRAP != SOCK_SNMP_AGENT)
+			socket(SOCK_SNMP_TRAP, Sn_MR_UDP, PORT_SNMP_TRAP, 0);
+		ret = sendto(SOCK_SNMP_TRAP, packet_trap, packet_index, managerIP, PORT_SNMP_TRAP);
 		
-		close(SOCK_SNMP_TRAP);
-		return 0;
+		if (SOCK_SNMP_TRAP != SOCK_SNMP_AGENT)
+			close(SOCK_SNMP_TRAP);
+		return (ret < 0) ? ret : 0;
 	}
 }
 
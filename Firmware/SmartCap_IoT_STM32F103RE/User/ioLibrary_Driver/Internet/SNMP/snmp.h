@@ -6,7 +6,7 @@ extern "C" {
 #endif
 
 // SNMP Debug Message (dump) Enable
-#define _SNMP_DEBUG_
+//#define _SNMP_DEBUG_
 
 #define PORT_SNMP_AGENT				161
 #define PORT_SNMP_TRAP				162
@@ -14,9 +14,9 @@ extern "C" {
 #define SNMP_V1						0
 
 #define MAX_OID						12
-#define MAX_STRING					64
+#define MAX_STRING					32		// snmpData[] lives in RAM: keep string objects short
 #define MAX_SNMPMSG_LEN				512
-#define MAX_TRAPMSG_LEN				512
+#define MAX_TRAPMSG_LEN				128		// trap PDU lengths are encoded in short form (< 128)
 
 // SNMP Error code
 #define SNMP_SUCCESS				0
@@ -25,7 +25,9 @@ extern "C" {
 #define ILLEGAL_LENGTH				-3
 #define INVALID_ENTRY_ID			-4
 #define INVALID_DATA_TYPE			-5
+#define RESPONSE_TOO_BIG			-6
 
+#define TOO_BIG						1
 #define NO_SUCH_NAME				2
 #define BAD_VALUE					3
 
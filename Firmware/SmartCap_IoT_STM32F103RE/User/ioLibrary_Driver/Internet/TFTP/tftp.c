@@ -34,16 +34,34 @@ static uint16_t g_local_port = 0;
 static uint32_t g_tftp_state = STATE_NONE;
 static uint16_t g_block_num = 0;
 
-static uint32_t g_timeout = 5;
+static uint32_t g_timeout = TFTP_RTO_INIT_MS / TFTP_TICK_MS;	/* current RTO in ticks */
 static uint32_t g_resend_flag = 0;
 static uint32_t tftp_time_cnt = 0;
 static uint32_t tftp_retry_cnt = 0;
 
+/* RTT estimator in ticks, scaled as in TCP: g_srtt = 8 * SRTT, g_rttvar = 4 * RTTVAR */
+static uint32_t g_srtt = 0;
+static uint32_t g_rttvar = 0;
+static uint8_t g_rtt_on = 0;
+static uint32_t g_rtt_cnt = 0;
+
+/* negotiated transfer parameters, RFC 1350 values until an OACK says otherwise */
+static uint16_t g_blk_size = TFTP_BLK_SIZE;
+static uint16_t g_window = 1;
+static uint16_t g_window_cnt = 0;		/* in-order blocks since the last ACK */
+static uint8_t g_gap_acked = 0;			/* ACK already sent for the current gap */
+static uint16_t g_req_blk_size = TFTP_BLK_SIZE;
+static uint16_t g_req_window = 1;
+
 static uint8_t *g_tftp_rcv_buf = NULL;
 
-static TFTP_OPTION default_tftp_opt = {
-	.code = (uint8_t *)"timeout",
-	.value = (uint8_t *)"5"
+static uint8_t g_opt_blk_size[6];
+static uint8_t g_opt_window[4];
+
+static TFTP_OPTION default_tftp_opt[3] = {
+	{ (uint8_t *)"timeout", (uint8_t *)"5" },
+	{ (uint8_t *)"blksize", g_opt_blk_size },
+	{ (uint8_t *)"windowsize", g_opt_window }
 };
 
 uint8_t g_progress_state = TFTP_PROGRESS;
@@ -124,6 +142,54 @@ static inline uint16_t get_block_number()
 	return g_block_num;
 }
 
+static void tftp_utoa(uint8_t *buf, uint16_t val)
+{
+	uint8_t tmp[5];
+	uint8_t i = 0;
+
+	do {
+		tmp[i++] = '0' + val % 10;
+		val /= 10;
+	} while(val);
+
+	while(i)
+		*buf++ = tmp[--i];
+	*buf = 0;
+}
+
+static int tftp_option_match(const uint8_t *code, const char *name)
+{
+	while(*name) {
+		if((*code | 0x20) != *name)
+			return 0;
+		code++;
+		name++;
+	}
+	return *code == 0;
+}
+
+/* Request the largest blksize/windowsize whose window still fits the socket RX buffer */
+static void set_tftp_option(void)
+{
+	uint16_t rx_max = getSn_RxMAX(g_tftp_socket);
+	uint16_t blk_size = TFTP_BLK_SIZE_MAX;
+	uint16_t window;
+
+	if(rx_max < (4 + TFTP_BLK_SIZE_MAX + TFTP_UDP_HDR_SIZE))
+		blk_size = TFTP_BLK_SIZE;
+
+	window = rx_max / (4 + blk_size + TFTP_UDP_HDR_SIZE);
+	if(window < 1)
+		window = 1;
+	if(window > TFTP_WINDOW_MAX)
+		window = TFTP_WINDOW_MAX;
+
+	g_req_blk_size = blk_size;
+	g_req_window = window;
+	tftp_utoa(g_opt_blk_size, blk_size);
+	tftp_utoa(g_opt_window, window);
+}
+
 static int open_tftp_socket(uint8_t sock)
 {
 	uint8_t sd, sck_state;
@@ -160,7 +226,7 @@ static int recv_udp_packet(int socket, uint8_t *packet, uint32_t len, uint32_t *
 {
 	int ret;
 	uint8_t sck_state;
-	uint16_t recv_len;
+	int32_t recv_len;
 
 	/* Receive Packet Process */
 	ret = getsockopt(socket, SO_STATUS, &sck_state);
@@ -170,15 +236,17 @@ static int recv_udp_packet(int socket, uint8_t *packet, uint32_t len, uint32_t *
 	}
 
 	if(sck_state == SOCK_UDP) {
-		ret = getsockopt(socket, SO_RECVBUF, &recv_len);
+		uint16_t rx_size;
+
+		ret = getsockopt(socket, SO_RECVBUF, &rx_size);
 		if(ret != SOCK_OK) {
 			//DBG_PRINT(ERROR_DBG, "[%s] getsockopt SO_RECVBUF error\r\n", __func__);
 			return -1;
 		}
 
-		if(recv_len) {
+		if(rx_size) {
 			recv_len = recvfrom(socket, packet, len, (uint8_t *)ip, port);
-			if(recv_len < 0) {
+			if(recv_len <= 0) {
 				//DBG_PRINT(ERROR_DBG, "[%s] recvfrom error\r\n", __func__);
 				return -1;
 			}
@@ -208,10 +276,19 @@ static void init_tftp(void)
 	set_tftp_state(STATE_NONE);
 	set_block_number(0);
 
+	g_blk_size = TFTP_BLK_SIZE;
+	g_window = 1;
+	g_window_cnt = 0;
+	g_gap_acked = 0;
+
 	/* timeout flag */
 	g_resend_flag = 0;
 	tftp_retry_cnt = tftp_time_cnt = 0;
 
+	set_tftp_timeout(TFTP_RTO_INIT_MS / TFTP_TICK_MS);
+	g_srtt = g_rttvar = 0;
+	g_rtt_on = 0;
+
 	g_progress_state = TFTP_PROGRESS;
 }
 
@@ -231,14 +308,98 @@ static void tftp_reg_timeout()
 	}
 }
 
-static void process_tftp_option(uint8_t *msg, uint32_t msg_len)
+/* Restart the wait for the next packet after progress */
+static void tftp_restart_timeout(void)
+{
+	tftp_cancel_timeout();
+	tftp_reg_timeout();
+}
+
+static void tftp_rtt_start(void)
 {
-	/* TODO Option Process */
+	g_rtt_on = 1;
+	g_rtt_cnt = 0;
+}
+
+/* Take an RTT sample when the packet answering tftp_rtt_start() arrives (Karn: none after a resend) */
+static void tftp_rtt_stop(void)
+{
+	uint32_t rtt, rto;
+	int32_t delta;
+
+	if(!g_rtt_on)
+		return;
+	g_rtt_on = 0;
+	rtt = g_rtt_cnt;
+
+	if(g_srtt == 0 && g_rttvar == 0) {
+		g_srtt = rtt << 3;
+		g_rttvar = rtt << 1;
+	}
+	else {
+		delta = (int32_t)rtt - (int32_t)(g_srtt >> 3);
+		g_srtt += delta;
+		if(delta < 0)
+			delta = -delta;
+		g_rttvar += delta - (g_rttvar >> 2);
+	}
+	if(g_rttvar == 0)
+		g_rttvar = 1;
+
+	/* RTO = SRTT + 4 * RTTVAR */
+	rto = (g_srtt >> 3) + g_rttvar;
+	if(rto < TFTP_RTO_MIN_MS / TFTP_TICK_MS)
+		rto = TFTP_RTO_MIN_MS / TFTP_TICK_MS;
+	if(rto > TFTP_RTO_MAX_MS / TFTP_TICK_MS)
+		rto = TFTP_RTO_MAX_MS / TFTP_TICK_MS;
+	set_tftp_timeout(rto);
+}
+
+static int process_tftp_option(uint8_t *msg, uint32_t msg_len)
+{
+	uint8_t *pkt = msg + 2;
+	uint8_t *end = msg + msg_len;
+	uint8_t *code, *value;
+	uint32_t val;
+
+	while(pkt < end) {
+		code = pkt;
+		pkt = memchr(pkt, 0, end - pkt);
+		if(pkt == NULL)
+			return -1;
+		value = ++pkt;
+		pkt = memchr(pkt, 0, end - pkt);
+		if(pkt == NULL)
+			return -1;
+		pkt++;
+
+		for(val = 0 ; *value >= '0' && *value <= '9' && val < 100000 ; value++)
+			val = val * 10 + (*value - '0');
+		if(*value != 0)
+			return -1;
+
+		/* The server may only lower what was requested (RFC 2348, RFC 7440) */
+		if(tftp_option_match(code, "blksize")) {
+			if(val < 8 || val > g_req_blk_size)
+				return -1;
+			g_blk_size = (uint16_t)val;
+		}
+		else if(tftp_option_match(code, "windowsize")) {
+			if(val < 1 || val > g_req_window)
+				return -1;
+			g_window = (uint16_t)val;
+		}
+#ifdef __TFTP_DEBUG__
+		DBG_PRINT(INFO_DBG, "[%s] %s = %lu\r\n", __func__, code, val);
+#endif
+	}
+
+	return 0;
 }
 
 static void send_tftp_rrq(uint8_t *filename, uint8_t *mode, TFTP_OPTION *opt, uint8_t opt_len)
 {
-	uint8_t snd_buf[MAX_MTU_SIZE];
+	uint8_t snd_buf[TFTP_RRQ_SIZE];
 	uint8_t *pkt = snd_buf;
 	uint32_t i, len;
 
@@ -368,10 +529,9 @@ static void send_tftp_oack(TFTP_OPTION *opt, uint8_t opt_len)
 }
 #endif
 
-#if 0	// 2014.07.01 sskim
 static void send_tftp_error(uint16_t error_number, uint8_t *error_message)
 {
-	uint8_t snd_buf[MAX_MTU_SIZE];
+	uint8_t snd_buf[4 + 32];
 	uint8_t *pkt = snd_buf;
 	uint32_t len;
 
@@ -385,12 +545,10 @@ static void send_tftp_error(uint16_t error_number, uint8_t *error_message)
 	len = pkt - snd_buf;
 
 	send_udp_packet(g_tftp_socket , snd_buf, len, get_server_ip(), get_server_port());
-	tftp_reg_timeout();
 #ifdef __TFTP_DEBUG__
 	DBG_PRINT(IPC_DBG, ">> TFTP ERROR : Error Number(%d)\r\n", error_number);
 #endif
 }
-#endif
 
 static void recv_tftp_rrq(uint8_t *msg, uint32_t msg_len)
 {
@@ -405,9 +563,14 @@ static void recv_tftp_wrq(uint8_t *msg, uint32_t msg_len)
 static void recv_tftp_data(uint8_t *msg, uint32_t msg_len)
 {
 	TFTP_DATA_T *data = (TFTP_DATA_T *)msg;
+	uint32_t data_len;
+
+	if(msg_len < 4)
+		return;
 
 	data->opcode = ntohs(data->opcode);
 	data->block_num = ntohs(data->block_num);
+	data_len = msg_len - 4;
 #ifdef __TFTP_DEBUG__
 	DBG_PRINT(IPC_DBG, "<< TFTP_DATA : opcode(%d), block_num(%d)\r\n", data->opcode, data->block_num);
 #endif
@@ -415,39 +578,50 @@ static void recv_tftp_data(uint8_t *msg, uint32_t msg_len)
 	switch(get_tftp_state())
 	{
 		case STATE_RRQ :
+			/* No OACK: the server ignored the options, lock-step with 512-byte blocks */
+			g_blk_size = TFTP_BLK_SIZE;
+			g_window = 1;
+			set_block_number(0);
+			/* fall through */
 		case STATE_OACK :
-			if(data->block_num == 1) {
-				set_tftp_state(STATE_DATA);
-				set_block_number(data->block_num);
-#ifdef F_STORAGE
-				save_data(data->data, msg_len - 4, data->block_num);
-#endif
-				tftp_cancel_timeout();
-			}
-			send_tftp_ack(data->block_num);
+		case STATE_DATA :
+			if(data_len > g_blk_size)
+				break;
 
-			if((msg_len - 4) < TFTP_BLK_SIZE) {
-				init_tftp();
-				g_progress_state = TFTP_SUCCESS;
+			if(data->block_num != (uint16_t)(get_block_number() + 1)) {
+				/* Lost, reordered or repeated block: ACK the last in-order block once so the
+				 * server restarts the window from there (RFC 7440) */
+				if(!g_gap_acked) {
+					g_gap_acked = 1;
+					g_rtt_on = 0;
+					g_window_cnt = 0;
+					send_tftp_ack(get_block_number());
+				}
+				break;
 			}
 
-			break;
-			
-		case STATE_DATA :
-			if(data->block_num == (get_block_number() + 1)) {
-				set_block_number(data->block_num);
+			set_tftp_state(STATE_DATA);
+			set_block_number(data->block_num);
+			tftp_rtt_stop();
+			g_gap_acked = 0;
 #ifdef F_STORAGE
-				save_data(data->data, msg_len - 4, data->block_num);
+			save_data(data->data, data_len, data->block_num);
 #endif
-				tftp_cancel_timeout();
-			}
-			send_tftp_ack(data->block_num);
 
-			if((msg_len - 4) < TFTP_BLK_SIZE) {
+			if(data_len < g_blk_size) {
+				send_tftp_ack(data->block_num);
 				init_tftp();
 				g_progress_state = TFTP_SUCCESS;
 			}
-
+			else if(++g_window_cnt >= g_window) {
+				g_window_cnt = 0;
+				tftp_cancel_timeout();
+				send_tftp_ack(data->block_num);
+				tftp_rtt_start();
+			}
+			else {
+				tftp_restart_timeout();
+			}
 			break;
 
 		default :
@@ -485,14 +659,26 @@ static void recv_tftp_oack(uint8_t *msg, uint32_t msg_len)
 	switch(get_tftp_state())
 	{
 		case STATE_RRQ :
-			process_tftp_option(msg, msg_len);	
-			set_tftp_state(STATE_OACK);
+			tftp_rtt_stop();
 			tftp_cancel_timeout();
+			if(process_tftp_option(msg, msg_len) != 0) {
+				send_tftp_error(8, (uint8_t *)"bad option");
+				init_tftp();
+				g_progress_state = TFTP_FAIL;
+				break;
+			}
+			set_tftp_state(STATE_OACK);
+			send_tftp_ack(0);
+			tftp_rtt_start();
+			break;
+
+		case STATE_OACK :
+			/* our ACK of the OACK was lost: the next block answers a resent ACK, no RTT sample */
+			g_rtt_on = 0;
 			send_tftp_ack(0);
 			break;
 
 		case STATE_WRQ :
-			process_tftp_option(msg, msg_len);	
 			set_tftp_state(STATE_ACK);
 			tftp_cancel_timeout();
 
@@ -592,22 +778,31 @@ void TFTP_exit(void)
 
 int TFTP_run(void)
 {
-	uint16_t len, from_port;
+	int len;
+	uint16_t from_port;
 	uint32_t from_ip;
 
 	/* Timeout Process */
 	if(g_resend_flag) {
-		if(tftp_time_cnt >= g_timeout) {
+		if(tftp_time_cnt >= g_timeout && tftp_retry_cnt >= TFTP_MAX_RETRY) {
+			/* the last retransmission went unanswered too */
+			init_tftp();
+			g_progress_state = TFTP_FAIL;
+		}
+		else if(tftp_time_cnt >= g_timeout) {
 			switch(get_tftp_state()) {
 			case STATE_WRQ:						// Ù»©ÛÁ¼Ýÿä
 				break;
 
 			case STATE_RRQ:
-				send_tftp_rrq(g_filename, (uint8_t *)TRANS_BINARY, &default_tftp_opt, 1);
+				send_tftp_rrq(g_filename, (uint8_t *)TRANS_BINARY, default_tftp_opt, 3);
 				break;
 
 			case STATE_OACK:
 			case STATE_DATA:
+				/* the server restarts the window after the last block we ACK */
+				g_window_cnt = 0;
+				g_gap_acked = 0;
 				send_tftp_ack(get_block_number());
 				break;
 
@@ -618,19 +813,20 @@ int TFTP_run(void)
 				break;
 			}
 
+			/* exponential backoff, no RTT sample from a resent packet */
+			g_rtt_on = 0;
+			set_tftp_timeout(get_tftp_timeout() * 2);
+			if(get_tftp_timeout() > TFTP_RTO_MAX_MS / TFTP_TICK_MS)
+				set_tftp_timeout(TFTP_RTO_MAX_MS / TFTP_TICK_MS);
+
 			tftp_time_cnt = 0;
 			tftp_retry_cnt++;
-
-			if(tftp_retry_cnt >= 5) {
-				init_tftp();
-				g_progress_state = TFTP_FAIL;
-			}
 		}
 	}
 
 	/* Receive Packet Process */
-	len = recv_udp_packet(g_tftp_socket, g_tftp_rcv_buf, MAX_MTU_SIZE, &from_ip, &from_port);
-	if(len < 0) {
+	len = recv_udp_packet(g_tftp_socket, g_tftp_rcv_buf, TFTP_RCV_BUF_SIZE, &from_ip, &from_port);
+	if(len < 2) {
 #ifdef __TFTP_DEBUG__
 		DBG_PRINT(ERROR_DBG, "[%s] recv_udp_packet error\r\n", __func__);
 #endif
@@ -644,17 +840,33 @@ int TFTP_run(void)
 
 void TFTP_read_request(uint32_t server_ip, uint8_t *filename)
 {
+	if(strlen((char *)filename) >= FILE_NAME_SIZE) {
+		g_progress_state = TFTP_FAIL;
+		return;
+	}
+
 	set_server_ip(server_ip);
 #ifdef __TFTP_DEBUG__
 	DBG_PRINT(INFO_DBG, "[%s] Set Tftp Server : %x\r\n", __func__, server_ip);
 #endif
 
 	g_progress_state = TFTP_PROGRESS;
-	send_tftp_rrq(filename, (uint8_t *)TRANS_BINARY, &default_tftp_opt, 1);
+	set_tftp_option();
+	send_tftp_rrq(filename, (uint8_t *)TRANS_BINARY, default_tftp_opt, 3);
+	tftp_rtt_start();
 }
 
 void tftp_timeout_handler(void)
 {
 	if(g_resend_flag) 
 		tftp_time_cnt++;
+	if(g_rtt_on)
+		g_rtt_cnt++;
+}
+
+void TFTP_get_transfer_info(uint16_t *blk_size, uint16_t *window, uint16_t *rto_ms)
+{
+	*blk_size = g_blk_size;
+	*window = g_window;
+	*rto_ms = (uint16_t)(get_tftp_timeout() * TFTP_TICK_MS);
 }
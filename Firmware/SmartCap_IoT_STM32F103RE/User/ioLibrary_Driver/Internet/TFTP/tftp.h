@@ -14,7 +14,7 @@ extern "C" {
 #include <stdint.h>
 
 #define F_APP_TFTP
-#define __TFTP_DEBUG__
+//#define __TFTP_DEBUG__
 
 #define F_STORAGE // If your target support a storage, you have to activate this feature and implement.
 
@@ -25,9 +25,9 @@ extern "C" {
 #define DEBUG_DBG		0x04
 #define IPC_DBG			0x08
 
-#define DBG_PRINT(level, format, args...)		{ \
+#define DBG_PRINT(level, ...)		{ \
 											if(dbg_level & level) \
-												printf(format, ##args); \
+												printf(__VA_ARGS__); \
 										}
 
 #define NORMAL_MODE		0
@@ -63,9 +63,21 @@ extern int dbg_level;
 /* define */
 #define TFTP_SERVER_PORT		69
 #define TFTP_TEMP_PORT			51000
-#define TFTP_BLK_SIZE			512
+#define TFTP_BLK_SIZE			512		/* RFC 1350 block size, used when the server ignores options */
+#define TFTP_BLK_SIZE_MAX		1024	/* blksize option (RFC 2348), must fit one Ethernet frame */
+#define TFTP_WINDOW_MAX			8		/* windowsize option (RFC 7440), also bounded by the socket RX buffer */
+#define TFTP_UDP_HDR_SIZE		8		/* per-packet header W5500 stores in the UDP RX buffer */
 #define MAX_MTU_SIZE			1514
-#define FILE_NAME_SIZE			20
+#define FILE_NAME_SIZE			48
+#define TFTP_RRQ_SIZE			(2 + FILE_NAME_SIZE + 64)	/* opcode, file name, mode and options */
+#define TFTP_RCV_BUF_SIZE		(4 + TFTP_BLK_SIZE_MAX)		/* size of the buffer passed to TFTP_init */
+
+/* retransmission timeout, adapted to the measured RTT (RFC 6298) */
+#define TFTP_TICK_MS			10		/* tftp_timeout_handler() must be called at this period */
+#define TFTP_RTO_INIT_MS		1000
+#define TFTP_RTO_MIN_MS			100
+#define TFTP_RTO_MAX_MS			5000
+#define TFTP_MAX_RETRY			5
 
 //#define __TFTP_DEBUG__
 
@@ -73,13 +85,13 @@ extern int dbg_level;
 typedef struct tftp_data {
 	uint16_t opcode;
 	uint16_t block_num;
-	uint8_t data[0];
+	uint8_t data[];
 } TFTP_DATA_T;
 
 typedef struct tftp_error {
 	uint16_t opcode;
 	uint16_t error_code;
-	uint8_t error_msg[0];
+	uint8_t error_msg[];
 } TFTP_ERROR_T;
 
 typedef struct tftp_option {
@@ -93,6 +105,7 @@ void TFTP_exit(void);
 int TFTP_run(void);
 void TFTP_read_request(uint32_t server_ip, uint8_t *filename);
 void tftp_timeout_handler(void);
+void TFTP_get_transfer_info(uint16_t *blk_size, uint16_t *window, uint16_t *rto_ms);
 
 #ifdef __cplusplus
 }
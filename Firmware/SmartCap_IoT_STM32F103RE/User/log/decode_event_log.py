@@ -0,0 +1,139 @@
+#!/usr/bin/env python3
+"""
+事件日志解码: 按 event_log_ids.h 中的格式把二进制记录 (event_log.h) 还原为文本。
+
+用法: python decode_event_log.py <日志文件 | 设备IP> [--ids event_log_ids.h] [--save raw.bin]
+                                 [--level 0~3]
+
+- 日志文件: GET /api/log 保存的内容, 或 /fs/event0.log、/fs/event1.log
+- 设备IP: 经 HTTP GET /api/log 读取 (设备先把 RAM 缓冲中的事件写入 Flash)
+- --level: 先设置设备记录的最低级别 (0=DEBUG 1=INFO 2=WARN 3=ERROR, 重启后恢复默认)
+收到 TIME_STEP 之后的时间戳换算为 UTC 时间, 之前的显示为上电后的秒数。
+"""
+import argparse
+import datetime
+import http.client
+import os
+import re
+import struct
+import sys
+
+FORMAT = 1
+LEVELS = ('DEBUG', 'INFO', 'WARN', 'ERROR')
+
+# RG200U AT+QIOPEN 错误码 (Quectel TCP/IP AT Commands Manual)
+QIOPEN_ERRORS = {
+    550: 'Unknown error', 551: 'Operation blocked', 552: 'Invalid parameters',
+    553: 'Memory not enough', 554: 'Socket creation failed', 555: 'Operation not supported',
+    556: 'Socket bind failed', 557: 'Socket listen failed', 558: 'Socket write failed',
+    559: 'Socket read failed', 560: 'Socket accept failed', 561: 'PDP context opening failed',
+    562: 'PDP context closure failed', 563: 'Socket identity has been used', 564: 'DNS busy',
+    565: 'DNS parse failed', 566: 'Socket connect failed', 567: 'Socket has been closed',
+    568: 'Operation busy', 569: 'Operation timeout', 570: 'PDP context broken down',
+    571: 'Cancel sending', 572: 'Operation not allowed', 573: 'APN not configured',
+    574: 'Port busy',
+}
+
+DEF_RE = re.compile(r'^\s*EVENT_LOG_DEF\(\s*(\w+)\s*,\s*(\w+)\s*,\s*"((?:[^"\\]|\\.)*)"\s*\)', re.M)
+CONV_RE = re.compile(r'%([-0 #+]*\d*)([udxXIS%])')
+
+
+def load_ids(path):
+    events = []
+    for name, level, fmt in DEF_RE.findall(open(path, encoding='utf-8').read()):
+        events.append((name, LEVELS.index(level), fmt.encode().decode('unicode_escape')))
+    return events
+
+
+def format_args(fmt, args):
+    args = list(args)
+
+    def conv(m):
+        flags, kind = m.group(1), m.group(2)
+        if kind == '%':
+            return '%'
+        v = args.pop(0) if args else 0
+        if kind == 'I':
+            return '%d.%d.%d.%d' % (v >> 24, (v >> 16) & 0xFF, (v >> 8) & 0xFF, v & 0xFF)
+        if kind == 'S':
+            return struct.pack('<I', v).rstrip(b'\0').decode('ascii', 'replace')
+        if kind == 'd' and v >= 0x80000000:
+            v -= 1 << 32
+        return ('%' + flags + kind) % v
+
+    return CONV_RE.sub(conv, fmt)
+
+
+def decode(data, events, out=sys.stdout):
+    pos = 0
+    wall = None             # TIME_STEP 之后: 时间戳为 0 时的 Unix 秒
+    names = [e[0] for e in events]
+    while pos + 6 <= len(data):
+        head, tick = struct.unpack_from('<HI', data, pos)
+        event, argc = head & 0xFFF, head >> 12
+        if pos + 6 + 4 * argc > len(data):
+            break
+        args = struct.unpack_from('<%dI' % argc, data, pos + 6)
+        pos += 6 + 4 * argc
+
+        if event < len(events):
+            name, level, fmt = events[event]
+            text = format_args(fmt, args)
+        else:
+            name, level, text = 'EVENT_%d' % event, 3, 'unknown event, args %s' % (args,)
+
+        if name == 'BOOT':
+            wall = None
+        elif name == 'TIME_STEP':
+            wall = args[0] - tick / 1000.0
+        elif name == 'LOG_FILE' and len(args) > 1 and args[1] != FORMAT:
+            print('warning: log format %d, decoder supports %d' % (args[1], FORMAT), file=sys.stderr)
+        elif name == 'MODEM_CONNECT_FAIL' and args and args[0] in QIOPEN_ERRORS:
+            text += ' (%s)' % QIOPEN_ERRORS[args[0]]
+
+        if wall is not None:
+            stamp = datetime.datetime.utcfromtimestamp(wall + tick / 1000.0).strftime('%Y-%m-%d %H:%M:%S.%f')[:-3]
+        else:
+            stamp = '%19.3f' % (tick / 1000.0)
+        print('%s  %-5s %-20s %s' % (stamp, LEVELS[level], name, text), file=out)
+
+    if pos != len(data):
+        print('warning: %d trailing bytes (incomplete record)' % (len(data) - pos), file=sys.stderr)
+
+
+def fetch(host, level=None):
+    conn = http.client.HTTPConnection(host, 80, timeout=10)
+    if level is not None:
+        conn.request('POST', '/api/log?level=%d' % level)
+        resp = conn.getresponse()
+        resp.read()
+        if resp.status != 200:
+            sys.exit('设置级别失败: %d' % resp.status)
+    conn.request('GET', '/api/log')
+    resp = conn.getresponse()
+    data = resp.read()
+    if resp.status != 200:
+        sys.exit('读取失败: %d' % resp.status)
+    return data
+
+
+def main():
+    ap = argparse.ArgumentParser()
+    ap.add_argument('source', help='日志文件或设备 IP')
+    ap.add_argument('--ids', default=os.path.join(os.path.dirname(os.path.abspath(__file__)), 'event_log_ids.h'))
+    ap.add_argument('--save', metavar='FILE', help='同时保存原始记录')
+    ap.add_argument('--level', type=int, choices=range(4))
+    args = ap.parse_args()
+
+    events = load_ids(args.ids)
+    if os.path.exists(args.source):
+        data = open(args.source, 'rb').read()
+    else:
+        data = fetch(args.source, args.level)
+    if args.save:
+        open(args.save, 'wb').write(data)
+    decode(data, events)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,452 @@
+/**
+  ******************************************************************************
+  * @file    event_log.c
+  * @brief   Deferred Binary Event Log
+  ******************************************************************************
+  * @description
+  * RAM 环形缓冲按 32 位字存放: 头字 (有效位 | 参数个数 << 12 | 事件号), 时间戳, 参数。
+  * 写者先用 LDREX/STREX 推进 log_head 预留空间, 填好时间戳和参数后最后写头字;
+  * 读者 (默认任务) 遇到头字无效 (预留后尚未写完) 就停下, 下次再读。读过的字清零,
+  * 之后写入的事件不会把旧内容误认为头字。
+  *
+  * 只写整条记录, 所以文件中的有效长度总在记录边界上; 断电 (页写满时自动提交了半条) 或
+  * 空间不足留下的半条记录不再追加, 改用另一个文件, 读取时只输出到最后一条完整的记录。
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "event_log.h"
+#include "flash_fs.h"
+#include "metrics.h"
+#include "cmsis_os.h"
+#include <string.h>
+
+#if EVENT_LOG_ENABLE
+
+/* Private defines -----------------------------------------------------------*/
+#define LOG_MASK                (EVENT_LOG_RING_WORDS - 1)
+#define LOG_VALID               0x80000000UL
+#define LOG_ARGC(w)             (((w) >> 12) & 0x7)
+#define LOG_ID(w)               ((w) & 0xFFF)
+#define LOG_RESET_FLAGS         (RCC->CSR >> 24)    /* PINRST/PORRST/SFTRST/IWDGRST/WWDGRST/LPWRRST */
+
+/* Private variables ---------------------------------------------------------*/
+static const uint8_t log_levels[EV_COUNT] = {
+#define EVENT_LOG_DEF(name, level, fmt) EVENT_LOG_##level,
+#include "event_log_ids.h"
+#undef EVENT_LOG_DEF
+};
+
+static volatile uint32_t log_ring[EVENT_LOG_RING_WORDS];
+static volatile uint32_t log_head = 0;          /* 写者预留到的位置 (不回绕的计数) */
+static volatile uint32_t log_tail = 0;          /* 读者读到的位置 */
+static volatile uint8_t log_level = EVENT_LOG_LEVEL_DEFAULT;
+static uint32_t log_drops_seen = 0;
+
+#if FS_ENABLE
+static const char *const log_names[2] = { "event0.log", "event1.log" };
+static int8_t log_fd = -1;
+static uint32_t log_gen = 0;                    /* 当前文件序号, 文件为 log_names[log_gen & 1] */
+static uint32_t log_size = 0;                   /* 当前文件已写入的字节数 */
+static uint32_t log_synced = 0;                 /* 当前文件已提交的字节数 */
+static uint32_t log_prev_valid = 0;             /* 上一个文件中完整记录的长度, 0 为没有 */
+static uint32_t log_pending_tick = 0;
+static uint8_t log_urgent = 0;
+#endif
+
+static osMutexId log_mutex = NULL;
+static osStaticMutexDef_t log_mutex_cb;
+
+/* Private functions ---------------------------------------------------------*/
+
+static uint8_t *EventLog_Put32(uint8_t *out, uint32_t v)
+{
+    out[0] = (uint8_t)v;
+    out[1] = (uint8_t)(v >> 8);
+    out[2] = (uint8_t)(v >> 16);
+    out[3] = (uint8_t)(v >> 24);
+    return out + 4;
+}
+
+/**
+ * @brief  记录编码为文件格式
+ * @retval 长度
+ */
+static uint8_t EventLog_Encode(uint8_t *out, uint16_t id, uint8_t argc, uint32_t tick, const uint32_t *args)
+{
+    uint8_t *p = out;
+    uint16_t head = (uint16_t)(id | ((uint16_t)argc << 12));
+    uint8_t i;
+
+    *p++ = (uint8_t)head;
+    *p++ = (uint8_t)(head >> 8);
+    p = EventLog_Put32(p, tick);
+    for (i = 0; i < argc; i++)
+        p = EventLog_Put32(p, args[i]);
+    return (uint8_t)(p - out);
+}
+
+#if FS_ENABLE
+/**
+ * @brief  读取日志文件, 求出完整记录的长度和文件序号
+ * @retval 文件序号, 文件不存在或不是日志文件时为 0
+ */
+static uint32_t EventLog_Scan(const char *name, uint32_t *valid, uint32_t *size)
+{
+    uint8_t rec[EVENT_LOG_RECORD_MAX];
+    uint32_t gen = 0, pos = 0;
+    uint16_t head;
+    uint8_t len;
+    FS_Stat_t st;
+    int8_t fd;
+
+    *valid = 0;
+    *size = 0;
+    if (FS_Stat(name, &st) != FS_OK)
+        return 0;
+    *size = st.size;
+    fd = FS_Open(name, FS_O_READ);
+    if (fd < 0)
+        return 0;
+
+    while (FS_Read(fd, rec, 2) == 2)
+    {
+        head = (uint16_t)(rec[0] | (rec[1] << 8));
+        len = (uint8_t)(4 + 4 * LOG_ARGC(head));
+        if (LOG_ARGC(head) > EVENT_LOG_ARGS_MAX || FS_Read(fd, rec + 2, len) != len)
+            break;
+        if (pos == 0)
+        {
+            if (LOG_ID(head) != EV_LOG_FILE || LOG_ARGC(head) != 2)
+                break;
+            memcpy(&gen, rec + 6, 4);
+        }
+        pos += 2 + len;
+    }
+    FS_Close(fd);
+
+    *valid = gen ? pos : 0;
+    return gen;
+}
+
+/**
+ * @brief  换到另一个文件 (删除其中更旧的日志), 以 LOG_FILE 事件开头
+ */
+static void EventLog_Rotate(void)
+{
+    uint8_t rec[EVENT_LOG_RECORD_MAX];
+    uint32_t args[2];
+    uint8_t len;
+
+    if (log_fd >= 0)
+    {
+        FS_Close(log_fd);               /* 提交到 log_size (之后若有半条记录, 读取时不输出) */
+        log_prev_valid = log_size;
+    }
+    log_gen++;
+    log_size = log_synced = 0;
+    log_urgent = 0;
+    FS_Remove(log_names[log_gen & 1]);
+    log_fd = FS_Open(log_names[log_gen & 1], FS_O_APPEND);
+    if (log_fd < 0)
+        return;
+
+    args[0] = log_gen;
+    args[1] = EVENT_LOG_FORMAT;
+    len = EventLog_Encode(rec, EV_LOG_FILE, 2, osKernelSysTick(), args);
+    if (FS_Write(log_fd, rec, len) == len && FS_Sync(log_fd) == FS_OK)
+        log_size = log_synced = len;
+    else
+    {
+        FS_Close(log_fd);
+        log_fd = -1;
+    }
+}
+
+/**
+ * @brief  追加一条记录; 只写入一部分时 (空间不足) 放弃该文件的剩余部分, 换文件重写,
+ *         新文件也放不下时停止写入 Flash 直到复位
+ */
+static void EventLog_Store(const uint8_t *rec, uint8_t len, uint8_t level)
+{
+    int32_t written;
+
+    if (log_fd < 0)
+        return;
+    if (log_size + len > EVENT_LOG_FILE_MAX)
+        EventLog_Rotate();
+    if (log_fd < 0)
+        return;
+
+    written = FS_Write(log_fd, rec, len);
+    if (written != len)
+    {
+        if (written > 0 || written == FS_ERR_FULL)
+        {
+            EventLog_Rotate();
+            if (log_fd < 0)
+                return;
+            if (FS_Write(log_fd, rec, len) != len)
+            {
+                FS_Close(log_fd);
+                log_fd = -1;
+                return;
+            }
+            log_size += len;
+            log_urgent = 1;
+        }
+        return;
+    }
+    if (log_size == log_synced)
+        log_pending_tick = osKernelSysTick();
+    log_size += len;
+    if (level >= EVENT_LOG_WARN)
+        log_urgent = 1;
+}
+
+/**
+ * @brief  提交已写入的记录
+ */
+static void EventLog_Sync(uint8_t force)
+{
+    if (log_fd < 0 || log_size == log_synced)
+        return;
+    if (force || log_urgent || log_size - log_synced >= EVENT_LOG_SYNC_BYTES ||
+        (osKernelSysTick() - log_pending_tick) >= EVENT_LOG_SYNC_MS)
+    {
+        if (FS_Sync(log_fd) == FS_OK)
+            log_synced = log_size;
+        log_urgent = 0;
+    }
+}
+#endif
+
+/**
+ * @brief  取出 RAM 缓冲中所有写完的事件并写入文件 (调用者持有 log_mutex)
+ */
+static void EventLog_Drain(void)
+{
+    uint8_t rec[EVENT_LOG_RECORD_MAX];
+    uint32_t args[EVENT_LOG_ARGS_MAX];
+    uint32_t head, tail = log_tail, tick, drops;
+    uint8_t argc, i, len;
+    uint16_t id;
+
+    while (tail != log_head)
+    {
+        head = log_ring[tail & LOG_MASK];
+        if (!(head & LOG_VALID))
+            break;                      /* 写者被抢占, 尚未写完 */
+        __DMB();
+        argc = LOG_ARGC(head);
+        id = LOG_ID(head);
+        tick = log_ring[(tail + 1) & LOG_MASK];
+        for (i = 0; i < argc; i++)
+            args[i] = log_ring[(tail + 2 + i) & LOG_MASK];
+        for (i = 0; i < argc + 2; i++)
+            log_ring[(tail + i) & LOG_MASK] = 0;
+        tail += argc + 2;
+        __DMB();
+        log_tail = tail;
+
+        len = EventLog_Encode(rec, id, argc, tick, args);
+#if FS_ENABLE
+        EventLog_Store(rec, len, id < EV_COUNT ? log_levels[id] : EVENT_LOG_ERROR);
+#else
+        (void)len;
+#endif
+    }
+
+    drops = Metrics_Slots[METRIC_EVENT_LOG_DROPS];
+    if (drops != log_drops_seen)
+    {
+        args[0] = drops - log_drops_seen;
+        log_drops_seen = drops;
+        len = EventLog_Encode(rec, EV_LOG_DROPPED, 1, osKernelSysTick(), args);
+#if FS_ENABLE
+        EventLog_Store(rec, len, EVENT_LOG_WARN);
+#endif
+    }
+}
+
+/* Exported functions --------------------------------------------------------*/
+
+void EventLog_Record(EventLog_ID_t id, uint8_t argc, uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3)
+{
+    uint32_t head, words = (uint32_t)argc + 2;
+    volatile uint32_t *slot;
+
+    if (log_levels[id] < log_level)
+        return;
+
+    /* 预留 words 个字 */
+    do {
+        head = __LDREXW(&log_head);
+        if (head + words - log_tail > EVENT_LOG_RING_WORDS)
+        {
+            __CLREX();
+            Metrics_Inc(METRIC_EVENT_LOG_DROPS);
+            return;
+        }
+    } while (__STREXW(head + words, &log_head));
+
+    log_ring[(head + 1) & LOG_MASK] = osKernelSysTick();
+    switch (argc)
+    {
+    case 4: log_ring[(head + 5) & LOG_MASK] = a3;   /* fall through */
+    case 3: log_ring[(head + 4) & LOG_MASK] = a2;   /* fall through */
+    case 2: log_ring[(head + 3) & LOG_MASK] = a1;   /* fall through */
+    case 1: log_ring[(head + 2) & LOG_MASK] = a0;   /* fall through */
+    default: break;
+    }
+    __DMB();
+    slot = &log_ring[head & LOG_MASK];
+    *slot = LOG_VALID | ((uint32_t)argc << 12) | (uint32_t)id;
+}
+
+uint32_t EventLog_Tag(const char *str)
+{
+    uint32_t tag = 0;
+    uint8_t i;
+
+    for (i = 0; i < 4 && str != NULL && str[i] != '\0'; i++)
+        tag |= (uint32_t)(uint8_t)str[i] << (8 * i);
+    return tag;
+}
+
+void EventLog_Init(void)
+{
+#if FS_ENABLE
+    uint32_t gen[2], valid[2], size[2];
+    uint8_t cur;
+#endif
+
+    if (log_mutex == NULL)
+    {
+        osMutexStaticDef(EventLog, &log_mutex_cb);
+        log_mutex = osMutexCreate(osMutex(EventLog));
+    }
+
+#if FS_ENABLE
+    gen[0] = EventLog_Scan(log_names[0], &valid[0], &size[0]);
+    gen[1] = EventLog_Scan(log_names[1], &valid[1], &size[1]);
+    cur = gen[1] > gen[0];
+    log_gen = gen[cur];
+
+    /* 最新的文件完整时继续追加, 否则 (末尾有半条记录) 换文件 */
+    if (log_gen != 0 && valid[cur] == size[cur] && valid[cur] < EVENT_LOG_FILE_MAX)
+    {
+        log_fd = FS_Open(log_names[cur], FS_O_APPEND);
+        log_size = log_synced = valid[cur];
+        log_prev_valid = (gen[!cur] + 1 == log_gen) ? valid[!cur] : 0;
+    }
+    if (log_fd < 0)
+    {
+        log_prev_valid = valid[cur];
+        EventLog_Rotate();
+    }
+#endif
+
+    EVENT_LOG1(BOOT, LOG_RESET_FLAGS);
+    __HAL_RCC_CLEAR_RESET_FLAGS();
+}
+
+void EventLog_Poll(void)
+{
+    if (log_tail == log_head && log_drops_seen == Metrics_Slots[METRIC_EVENT_LOG_DROPS])
+    {
+#if FS_ENABLE
+        if (log_fd >= 0 && log_size != log_synced && osMutexWait(log_mutex, 0) == osOK)
+        {
+            EventLog_Sync(0);
+            osMutexRelease(log_mutex);
+        }
+#endif
+        return;
+    }
+    if (osMutexWait(log_mutex, 0) != osOK)
+        return;
+    EventLog_Drain();
+#if FS_ENABLE
+    EventLog_Sync(0);
+#endif
+    osMutexRelease(log_mutex);
+}
+
+void EventLog_Flush(void)
+{
+    if (osMutexWait(log_mutex, osWaitForever) != osOK)
+        return;
+    EventLog_Drain();
+#if FS_ENABLE
+    EventLog_Sync(1);
+#endif
+    osMutexRelease(log_mutex);
+}
+
+void EventLog_SetLevel(uint8_t level)
+{
+    log_level = level;
+    EVENT_LOG1(LOG_LEVEL, level);
+}
+
+uint8_t EventLog_GetLevel(void)
+{
+    return log_level;
+}
+
+int32_t EventLog_Read(EventLog_Cursor_t *cursor, uint8_t *buf, uint16_t size)
+{
+    int32_t n = 0;
+#if FS_ENABLE
+    uint32_t limit, len;
+    int8_t fd;
+
+    if (osMutexWait(log_mutex, osWaitForever) != osOK)
+        return 0;
+
+    /* 从还存在的最早的文件开始; 读取期间换过文件时跳到仍存在的文件 */
+    if (cursor->gen + 1 < log_gen || cursor->gen == 0)
+    {
+        cursor->gen = (log_prev_valid != 0 && log_gen > 1) ? log_gen - 1 : log_gen;
+        cursor->pos = 0;
+    }
+    for (;;)
+    {
+        limit = (cursor->gen == log_gen) ? log_synced : log_prev_valid;
+        if (cursor->pos < limit || cursor->gen >= log_gen)
+            break;
+        cursor->gen++;
+        cursor->pos = 0;
+    }
+
+    if (cursor->pos < limit)
+    {
+        if (size > limit - cursor->pos)
+            size = (uint16_t)(limit - cursor->pos);
+        fd = FS_Open(log_names[cursor->gen & 1], FS_O_READ);
+        if (fd >= 0)
+        {
+            if (FS_Seek(fd, cursor->pos) == FS_OK)
+                n = FS_Read(fd, buf, size);
+            FS_Close(fd);
+        }
+        /* 只返回完整的记录: 下次读取前文件可能已被删除, 读取从另一个文件的开头继续 */
+        for (len = 0; n > 0 && len + 2 <= (uint32_t)n; len += 6 + 4 * LOG_ARGC(buf[len] | (buf[len + 1] << 8)))
+        {
+            if (len + 6 + 4 * LOG_ARGC(buf[len] | (buf[len + 1] << 8)) > (uint32_t)n)
+                break;
+        }
+        n = (n > 0) ? (int32_t)len : 0;
+        cursor->pos += (uint32_t)n;
+    }
+    osMutexRelease(log_mutex);
+#else
+    (void)cursor;
+    (void)buf;
+    (void)size;
+#endif
+    return n;
+}
+
+#endif /* EVENT_LOG_ENABLE */
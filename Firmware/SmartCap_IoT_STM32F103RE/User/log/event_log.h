@@ -0,0 +1,126 @@
+/**
+  ******************************************************************************
+  * @file    event_log.h
+  * @brief   Deferred Binary Event Log Header
+  ******************************************************************************
+  * @description
+  * 记录事件号 (event_log_ids.h) 和至多 4 个 32 位参数, 不在设备上格式化文本:
+  * - EVENT_LOGn 只把事件写入 RAM 环形缓冲 (LDREX/STREX 预留空间, 不关中断, 不加锁),
+  *   任务和中断中均可调用; 缓冲满时丢弃并计入 METRIC_EVENT_LOG_DROPS
+  * - 默认任务调用 EventLog_Poll 把缓冲中的事件追加到文件系统的 event0.log / event1.log,
+  *   写满 EVENT_LOG_FILE_MAX 后换另一个文件 (先删除其中更旧的日志)
+  * - HTTP GET /api/log 按时间顺序输出两个文件, 由 decode_event_log.py 还原文本
+  * 级别低于 EventLog_SetLevel 设定值的事件在记录时直接丢弃 (一次比较), 调试事件可以常驻代码。
+  *
+  * 文件和 /api/log 中的记录 (小端):
+  *   事件号 (低 12 位) | 参数个数 << 12 (16 位) | 时间戳 ms (osKernelSysTick, 32 位) | 参数 x n
+  * 每个文件以 LOG_FILE 事件开头 (文件序号, EVENT_LOG_FORMAT); 复位后时间戳从 0 开始,
+  * 以 BOOT 事件分隔。
+  ******************************************************************************
+  */
+
+#ifndef __EVENT_LOG_H__
+#define __EVENT_LOG_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported defines ----------------------------------------------------------*/
+#define EVENT_LOG_ENABLE        1       /* 1=启用事件日志 (需要 FS_ENABLE 才能保存到 Flash) */
+
+#define EVENT_LOG_RING_WORDS    256     /* RAM 环形缓冲 (32 位字, 2 的幂), 每个事件 2~6 个字 */
+#define EVENT_LOG_ARGS_MAX      4
+#define EVENT_LOG_FILE_MAX      4096    /* 单个日志文件大小, 两个文件轮换 */
+#define EVENT_LOG_SYNC_BYTES    128     /* 积累这么多字节或 EVENT_LOG_SYNC_MS 后提交, WARN 以上立即提交 */
+#define EVENT_LOG_SYNC_MS       10000
+#define EVENT_LOG_FORMAT        1       /* 记录格式版本 */
+#define EVENT_LOG_RECORD_MAX    (6 + 4 * EVENT_LOG_ARGS_MAX)
+
+/* 级别 */
+#define EVENT_LOG_DEBUG         0
+#define EVENT_LOG_INFO          1
+#define EVENT_LOG_WARN          2
+#define EVENT_LOG_ERROR         3
+#define EVENT_LOG_LEVEL_DEFAULT EVENT_LOG_INFO
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum {
+#define EVENT_LOG_DEF(name, level, fmt) EV_##name,
+#include "event_log_ids.h"
+#undef EVENT_LOG_DEF
+    EV_COUNT
+} EventLog_ID_t;
+
+/* /api/log 读取位置 */
+typedef struct {
+    uint32_t gen;                       /* 文件序号, 0 为从最早的文件开始 */
+    uint32_t pos;
+} EventLog_Cursor_t;
+
+/* Exported macros -----------------------------------------------------------*/
+#if EVENT_LOG_ENABLE
+#define EVENT_LOG0(id)                  EventLog_Record(EV_##id, 0, 0, 0, 0, 0)
+#define EVENT_LOG1(id, a)               EventLog_Record(EV_##id, 1, (uint32_t)(a), 0, 0, 0)
+#define EVENT_LOG2(id, a, b)            EventLog_Record(EV_##id, 2, (uint32_t)(a), (uint32_t)(b), 0, 0)
+#define EVENT_LOG3(id, a, b, c)         EventLog_Record(EV_##id, 3, (uint32_t)(a), (uint32_t)(b), (uint32_t)(c), 0)
+#define EVENT_LOG4(id, a, b, c, d)      EventLog_Record(EV_##id, 4, (uint32_t)(a), (uint32_t)(b), (uint32_t)(c), (uint32_t)(d))
+#else
+#define EVENT_LOG0(id)                  ((void)0)
+#define EVENT_LOG1(id, a)               ((void)0)
+#define EVENT_LOG2(id, a, b)            ((void)0)
+#define EVENT_LOG3(id, a, b, c)         ((void)0)
+#define EVENT_LOG4(id, a, b, c, d)      ((void)0)
+#endif
+
+/* IPv4 地址 (uint8_t[4]) 转 %I 参数 */
+#define EVENT_LOG_IP(ip)                (((uint32_t)(ip)[0] << 24) | ((uint32_t)(ip)[1] << 16) | \
+                                         ((uint32_t)(ip)[2] << 8) | (ip)[3])
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief  记录事件 (通过 EVENT_LOGn 调用), 任务和中断中均可调用
+ * @param  argc: 参数个数, 必须与 event_log_ids.h 中的格式一致
+ */
+void EventLog_Record(EventLog_ID_t id, uint8_t argc, uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3);
+
+/**
+ * @brief  字符串的前 4 个字符转 %S 参数
+ */
+uint32_t EventLog_Tag(const char *str);
+
+/**
+ * @brief  找到最新的日志文件并记录 BOOT 事件, 在 FS_Init 之后调用一次
+ */
+void EventLog_Init(void);
+
+/**
+ * @brief  把 RAM 缓冲中的事件写入文件, 由默认任务周期调用
+ */
+void EventLog_Poll(void);
+
+/**
+ * @brief  写入并提交所有缓冲中的事件 (读取日志之前调用)
+ */
+void EventLog_Flush(void);
+
+void EventLog_SetLevel(uint8_t level);
+uint8_t EventLog_GetLevel(void);
+
+/**
+ * @brief  按时间顺序读取已提交的日志, 每次只返回完整的记录
+ * @param  cursor: 第一次调用前清零
+ * @param  size: 不小于 EVENT_LOG_RECORD_MAX
+ * @retval 读到的字节数, 0 为没有更多数据
+ */
+int32_t EventLog_Read(EventLog_Cursor_t *cursor, uint8_t *buf, uint16_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __EVENT_LOG_H__ */
@@ -0,0 +1,53 @@
+/**
+  ******************************************************************************
+  * @file    event_log_ids.h
+  * @brief   Event Log Format Table
+  ******************************************************************************
+  * @description
+  * 每行一个事件: EVENT_LOG_DEF(名称, 级别, 格式)。事件号即行号 (从 0 开始), 只在末尾追加,
+  * 已发布的行不改格式和参数个数 (旧的日志文件用新的表解码)。
+  * 格式在固件中不占空间, 由 decode_event_log.py 读取本文件还原文本, 参数都是 32 位整数:
+  *   %u %d %x %X %08X 等 printf 整数转换, %I 为 IPv4 地址 (第一个字节在最高位),
+  *   %S 为最多 4 个 ASCII 字符 (第一个字符在最低字节, 见 EVENT_LOG_TAG)
+  * 最多 EVENT_LOG_ARGS_MAX 个参数。
+  ******************************************************************************
+  */
+
+/* 不加包含保护: 由 event_log.h 和 event_log.c 按不同的 EVENT_LOG_DEF 展开 */
+
+/* 日志本身 */
+EVENT_LOG_DEF(LOG_FILE,             INFO,  "log file %u (format %u)")
+EVENT_LOG_DEF(LOG_DROPPED,          WARN,  "%u events dropped, RAM ring full")
+EVENT_LOG_DEF(BOOT,                 INFO,  "boot, RCC_CSR reset flags 0x%02X")
+EVENT_LOG_DEF(LOG_LEVEL,            INFO,  "log level set to %u")
+/* 时间: 解码器用 TIME_STEP 的第一个参数把之后的时间戳换算成日期 */
+EVENT_LOG_DEF(TIME_STEP,            INFO,  "clock stepped to unix %u, offset %d ms, source %u")
+/* 以太网 */
+EVENT_LOG_DEF(ETH_STATE,            INFO,  "W5500 supervisor state %u")
+EVENT_LOG_DEF(ETH_ADDRESS,          INFO,  "IP %I gateway %I")
+EVENT_LOG_DEF(UPLINK_SWITCH,        INFO,  "uplink switched from %u to %u")
+/* RG200U 蜂窝模块 */
+EVENT_LOG_DEF(MODEM_QIOPEN,         DEBUG, "AT+QIOPEN socket %u")
+EVENT_LOG_DEF(MODEM_QIOPEN_NO_OK,   WARN,  "AT+QIOPEN answered without OK, %u bytes")
+EVENT_LOG_DEF(MODEM_QIOPEN_NO_RSP,  WARN,  "AT+QIOPEN no response")
+EVENT_LOG_DEF(MODEM_QIOPEN_TIMEOUT, WARN,  "no +QIOPEN within 30 s")
+EVENT_LOG_DEF(MODEM_CONNECTED,      INFO,  "cellular TCP connected")
+EVENT_LOG_DEF(MODEM_CONNECT_FAIL,   ERROR, "cellular TCP connect failed, +QIOPEN error %u")
+EVENT_LOG_DEF(MODEM_CLOSED,         WARN,  "cellular TCP closed by network")
+EVENT_LOG_DEF(MODEM_URC_RECV,       DEBUG, "+QIURC recv")
+EVENT_LOG_DEF(MODEM_READ,           DEBUG, "AT+QIRD read %u bytes")
+EVENT_LOG_DEF(MODEM_URC_OVERFLOW,   WARN,  "URC buffer full, %u bytes discarded")
+/* MQTT */
+EVENT_LOG_DEF(MQTT_CONNECT,         INFO,  "MQTT CONNECT on uplink %u")
+EVENT_LOG_DEF(MQTT_SESSION_DROP,    WARN,  "MQTT session dropped")
+/* 固件升级 */
+EVENT_LOG_DEF(OTA_BEGIN,            INFO,  "OTA receiving version %u, %u bytes, resume at %u")
+EVENT_LOG_DEF(OTA_READY,            INFO,  "OTA version %u verified, installing")
+EVENT_LOG_DEF(OTA_FAILED,           ERROR, "OTA failed (%S), %u bytes received")
+/* RTOS */
+EVENT_LOG_DEF(STACK_OVERFLOW,       ERROR, "stack overflow in task %S, reset")
+EVENT_LOG_DEF(TASK_CREATE_FAILED,   ERROR, "task %S could not be created")
+EVENT_LOG_DEF(TASK_STALLED,         ERROR, "task %S stalled for %u ms, watchdog not fed")
+/* 固件升级: 试运行 */
+EVENT_LOG_DEF(OTA_CONFIRMED,        INFO,  "OTA trial image confirmed after %u s")
+EVENT_LOG_DEF(OTA_TRIAL_FAILED,     ERROR, "OTA trial image unhealthy after %u s (uplink %u, tasks %u), rolling back")
@@ -0,0 +1,343 @@
+/**
+  ******************************************************************************
+  * @file    mb_cache.c
+  * @brief   Modbus RTU Register Cache
+  ******************************************************************************
+  * @description
+  * 缓存由网关任务更新和查询, 上报记录放在单生产者/单消费者环形缓冲中,
+  * 由上行发送任务整条取出发送, 不会与透传数据交错。
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "mb_cache.h"
+#include "mb_crc.h"
+#include "cmsis_os.h"
+#include <string.h>
+
+/* Private types -------------------------------------------------------------*/
+typedef struct {
+    MB_Cache_Range_t cfg;
+    uint16_t offset;                    /* 在寄存器池中的起始下标 */
+    uint32_t updated_tick;              /* 最近一次成功读取的时刻 */
+    uint32_t due_tick;                  /* 下一次轮询时刻 */
+    uint8_t valid;                      /* 缓存数据可用于应答 */
+    uint8_t reported;                   /* 已完成首次全量上报 */
+} MB_Cache_Entry_t;
+
+/* Private variables ---------------------------------------------------------*/
+static MB_Cache_Entry_t entries[MB_CACHE_RANGE_MAX];
+static uint8_t entry_num = 0;
+static uint8_t poll_next = 0;
+static uint16_t regs[MB_CACHE_REGS_MAX];
+static uint16_t last_reported[MB_CACHE_REGS_MAX];
+static uint32_t max_age_ms = MB_CACHE_MAX_AGE_MS;
+
+static uint8_t report_ring[MB_REPORT_RING_SIZE];
+static volatile uint16_t report_head = 0;   /* 网关任务写 */
+static volatile uint16_t report_tail = 0;   /* 上行发送任务读 */
+
+static MB_Cache_Stats_t stats;
+
+/* Private functions ---------------------------------------------------------*/
+
+static uint16_t MB_Cache_Rd16(const uint8_t *p)
+{
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+/**
+ * @brief  按请求 PDU 查找完全一致的区间
+ */
+static MB_Cache_Entry_t *MB_Cache_Find(uint8_t unit, const uint8_t *req)
+{
+    uint16_t start = MB_Cache_Rd16(&req[1]);
+    uint16_t count = MB_Cache_Rd16(&req[3]);
+    uint8_t i;
+
+    for (i = 0; i < entry_num; i++)
+    {
+        if (entries[i].cfg.unit == unit && entries[i].cfg.func == req[0] &&
+            entries[i].cfg.start == start && entries[i].cfg.count == count)
+            return &entries[i];
+    }
+    return NULL;
+}
+
+/**
+ * @brief  上报缓冲剩余空间
+ */
+static uint16_t MB_Report_Free(void)
+{
+    uint16_t head = report_head;
+    uint16_t tail = report_tail;
+    uint16_t used = (head >= tail) ? (head - tail) : (MB_REPORT_RING_SIZE - tail + head);
+    return MB_REPORT_RING_SIZE - 1 - used;
+}
+
+/**
+ * @brief  写入一条上报记录 (整条写入或丢弃)
+ */
+static void MB_Report_Put(const MB_Cache_Entry_t *e, uint16_t first, uint8_t n)
+{
+    uint8_t rec[MB_REPORT_LEN_MAX];
+    uint16_t len = 0, crc, head, i;
+    uint16_t addr = e->cfg.start + first;
+
+    rec[len++] = MB_REPORT_SYNC;
+    rec[len++] = MB_REPORT_HDR_LEN + n * 2 + 2;
+    rec[len++] = e->cfg.unit;
+    rec[len++] = e->cfg.func;
+    rec[len++] = (uint8_t)(addr >> 8);
+    rec[len++] = (uint8_t)addr;
+    rec[len++] = n;
+    for (i = 0; i < n; i++)
+    {
+        rec[len++] = (uint8_t)(regs[e->offset + first + i] >> 8);
+        rec[len++] = (uint8_t)regs[e->offset + first + i];
+    }
+    crc = MB_CRC16(rec, len);
+    rec[len++] = (uint8_t)crc;
+    rec[len++] = (uint8_t)(crc >> 8);
+
+    if (MB_Report_Free() < len)
+    {
+        stats.report_dropped++;
+        return;
+    }
+
+    head = report_head;
+    for (i = 0; i < len; i++)
+    {
+        report_ring[head] = rec[i];
+        head = (head + 1) % MB_REPORT_RING_SIZE;
+    }
+    report_head = head;
+
+    stats.changes += n;
+    stats.uplink_bytes_sent += len;
+}
+
+/**
+ * @brief  比较变化并生成上报记录, 只上报超过死区的寄存器
+ */
+static void MB_Cache_Report(MB_Cache_Entry_t *e)
+{
+    uint16_t i, run, count = e->cfg.count;
+    uint16_t cur, old, diff;
+
+    /* 按每次全量上报计算的字节数, 用于统计节省量 */
+    stats.uplink_bytes_full += ((count + MB_REPORT_REGS_MAX - 1) / MB_REPORT_REGS_MAX) *
+                               (MB_REPORT_HDR_LEN + 2) + count * 2;
+
+    i = 0;
+    while (i < count)
+    {
+        run = 0;
+        while (i + run < count && run < MB_REPORT_REGS_MAX)
+        {
+            cur = regs[e->offset + i + run];
+            old = last_reported[e->offset + i + run];
+            diff = (cur >= old) ? (cur - old) : (old - cur);
+            if (e->reported && diff <= e->cfg.deadband)
+                break;
+            last_reported[e->offset + i + run] = cur;
+            run++;
+        }
+
+        if (run > 0)
+        {
+            MB_Report_Put(e, i, (uint8_t)run);
+            i += run;
+        }
+        else
+        {
+            i++;
+        }
+    }
+    e->reported = 1;
+}
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief  加载区间配置
+ */
+uint8_t MB_Cache_Init(const MB_Cache_Range_t *table, uint8_t num)
+{
+    uint16_t offset = 0;
+    uint8_t i;
+    uint32_t now = osKernelSysTick();
+
+    entry_num = 0;
+    for (i = 0; i < num && entry_num < MB_CACHE_RANGE_MAX; i++)
+    {
+        if (table[i].count == 0 || table[i].count > 125 ||
+            (table[i].func != 0x03 && table[i].func != 0x04) ||
+            offset + table[i].count > MB_CACHE_REGS_MAX)
+            continue;
+
+        memset(&entries[entry_num], 0, sizeof(entries[entry_num]));
+        entries[entry_num].cfg = table[i];
+        entries[entry_num].offset = offset;
+        entries[entry_num].due_tick = now;
+        offset += table[i].count;
+        entry_num++;
+    }
+    return entry_num;
+}
+
+/**
+ * @brief  设置允许用缓存应答的最大数据年龄
+ */
+void MB_Cache_SetMaxAge(uint32_t max_age)
+{
+    max_age_ms = max_age;
+}
+
+/**
+ * @brief  用缓存应答读请求
+ */
+uint8_t MB_Cache_Lookup(uint8_t unit, const uint8_t *pdu, uint8_t pdu_len, uint8_t *resp)
+{
+    uint16_t start, count, i, idx;
+    uint32_t now = osKernelSysTick();
+    MB_Cache_Entry_t *e;
+    uint8_t n;
+
+    if (pdu_len != 5 || (pdu[0] != 0x03 && pdu[0] != 0x04))
+        return 0;
+    start = MB_Cache_Rd16(&pdu[1]);
+    count = MB_Cache_Rd16(&pdu[3]);
+    if (count == 0 || count > 125)
+        return 0;
+
+    for (n = 0; n < entry_num; n++)
+    {
+        e = &entries[n];
+        if (e->cfg.unit != unit || e->cfg.func != pdu[0] || !e->valid)
+            continue;
+        if (start < e->cfg.start || start + count > e->cfg.start + e->cfg.count)
+            continue;
+        if ((now - e->updated_tick) > max_age_ms)
+            continue;
+
+        resp[0] = pdu[0];
+        resp[1] = (uint8_t)(count * 2);
+        idx = e->offset + (start - e->cfg.start);
+        for (i = 0; i < count; i++)
+        {
+            resp[2 + i * 2] = (uint8_t)(regs[idx + i] >> 8);
+            resp[3 + i * 2] = (uint8_t)regs[idx + i];
+        }
+        stats.hits++;
+        /* RTU 请求 8 字节 + 应答 5+2n 字节 */
+        stats.bus_bytes_saved += 8 + 5 + count * 2;
+        return (uint8_t)(2 + count * 2);
+    }
+
+    stats.misses++;
+    return 0;
+}
+
+/**
+ * @brief  获取下一个到期的轮询请求
+ */
+uint8_t MB_Cache_NextPoll(uint8_t *unit, uint8_t *pdu)
+{
+    uint32_t now = osKernelSysTick();
+    uint8_t i, n;
+    MB_Cache_Entry_t *e;
+
+    for (n = 0; n < entry_num; n++)
+    {
+        i = (poll_next + n) % entry_num;
+        e = &entries[i];
+        if ((int32_t)(now - e->due_tick) < 0)
+            continue;
+
+        e->due_tick = now + e->cfg.period_ms;
+        poll_next = (i + 1) % entry_num;
+
+        *unit = e->cfg.unit;
+        pdu[0] = e->cfg.func;
+        pdu[1] = (uint8_t)(e->cfg.start >> 8);
+        pdu[2] = (uint8_t)e->cfg.start;
+        pdu[3] = (uint8_t)(e->cfg.count >> 8);
+        pdu[4] = (uint8_t)e->cfg.count;
+        stats.polls++;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief  从站应答更新缓存
+ */
+void MB_Cache_Update(uint8_t unit, const uint8_t *req, const uint8_t *resp, uint8_t resp_len)
+{
+    MB_Cache_Entry_t *e;
+    uint16_t i;
+
+    if (req[0] != 0x03 && req[0] != 0x04)
+        return;
+    e = MB_Cache_Find(unit, req);
+    if (e == NULL)
+        return;
+
+    /* 异常应答或长度不符 */
+    if (resp_len != 2 + e->cfg.count * 2 || resp[0] != e->cfg.func || resp[1] != e->cfg.count * 2)
+    {
+        e->valid = 0;
+        stats.poll_errors++;
+        return;
+    }
+
+    for (i = 0; i < e->cfg.count; i++)
+        regs[e->offset + i] = MB_Cache_Rd16(&resp[2 + i * 2]);
+    e->updated_tick = osKernelSysTick();
+    e->valid = 1;
+
+    MB_Cache_Report(e);
+}
+
+/**
+ * @brief  轮询失败, 缓存保持旧值但不再用于应答
+ */
+void MB_Cache_PollFailed(uint8_t unit, const uint8_t *req)
+{
+    MB_Cache_Entry_t *e = MB_Cache_Find(unit, req);
+
+    if (e != NULL)
+        e->valid = 0;
+    stats.poll_errors++;
+}
+
+/**
+ * @brief  取出一条完整上报记录
+ */
+uint16_t MB_Cache_TakeReport(uint8_t *buf)
+{
+    uint16_t tail = report_tail;
+    uint16_t len, i;
+
+    if (tail == report_head)
+        return 0;
+
+    len = report_ring[(tail + 1) % MB_REPORT_RING_SIZE];
+    for (i = 0; i < len; i++)
+    {
+        buf[i] = report_ring[tail];
+        tail = (tail + 1) % MB_REPORT_RING_SIZE;
+    }
+    report_tail = tail;
+    return len;
+}
+
+/**
+ * @brief  获取缓存统计
+ */
+void MB_Cache_GetStats(MB_Cache_Stats_t *out)
+{
+    *out = stats;
+}
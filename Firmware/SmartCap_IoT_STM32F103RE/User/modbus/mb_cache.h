@@ -0,0 +1,128 @@
+/**
+  ******************************************************************************
+  * @file    mb_cache.h
+  * @brief   Modbus RTU Register Cache Header
+  ******************************************************************************
+  * @description
+  * 可选的寄存器轮询缓存:
+  * - 网关空闲时按配置的周期轮询从站寄存器区间, 结果带时间戳保存在 RAM 中
+  * - 上游 03/04 读请求完全落在某个区间内且数据未超过 MB_CACHE_MAX_AGE_MS 时,
+  *   直接用缓存应答, 不占用 RS485 总线
+  * - 寄存器变化超过死区时, 只把变化的寄存器打包成上报记录经上行链路发送
+  *
+  * 上报记录格式 (大端):
+  *   0xA5 | 记录长度 | 从站 | 功能码 | 起始地址(2) | 数量 n | 数据(2n) | CRC16(低字节在前)
+  ******************************************************************************
+  */
+
+#ifndef __MB_CACHE_H__
+#define __MB_CACHE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported defines ----------------------------------------------------------*/
+#define MB_CACHE_ENABLE         0       /* 1=启用轮询缓存 (需 MB_GATEWAY_ENABLE) */
+
+#define MB_CACHE_RANGE_MAX      8       /* 最多配置的区间数 */
+#define MB_CACHE_REGS_MAX       128     /* 所有区间寄存器总数 */
+#define MB_CACHE_MAX_AGE_MS     2000    /* 默认允许用缓存应答的最大数据年龄 */
+
+#define MB_REPORT_SYNC          0xA5
+#define MB_REPORT_REGS_MAX      24      /* 单条上报记录最多寄存器数, 超过时拆分 */
+#define MB_REPORT_HDR_LEN       7
+#define MB_REPORT_LEN_MAX       (MB_REPORT_HDR_LEN + MB_REPORT_REGS_MAX * 2 + 2)
+#define MB_REPORT_RING_SIZE     512
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct {
+    uint8_t unit;                       /* 从站地址 */
+    uint8_t func;                       /* 0x03 保持寄存器 / 0x04 输入寄存器 */
+    uint16_t start;                     /* 起始地址 */
+    uint16_t count;                     /* 寄存器数量, 不超过 125 */
+    uint16_t period_ms;                 /* 轮询周期 */
+    uint16_t deadband;                  /* 变化量超过该值才上报, 0 表示任何变化都上报 */
+} MB_Cache_Range_t;
+
+typedef struct {
+    uint32_t hits;                      /* 用缓存应答的上游读请求 */
+    uint32_t misses;                    /* 未命中或数据过期, 转发给从站 */
+    uint32_t polls;                     /* 轮询请求次数 */
+    uint32_t poll_errors;               /* 轮询超时/错误 */
+    uint32_t changes;                   /* 上报的寄存器数 */
+    uint32_t report_dropped;            /* 上报缓冲满丢弃的记录数 */
+    uint32_t bus_bytes_saved;           /* 缓存命中节省的 RS485 字节数 (请求+应答) */
+    uint32_t uplink_bytes_sent;         /* 实际上报字节数 */
+    uint32_t uplink_bytes_full;         /* 每次轮询都上报整个区间时的字节数 */
+} MB_Cache_Stats_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief  加载区间配置
+ * @param  table: 区间表
+ * @param  num: 区间数
+ * @retval 成功加载的区间数 (寄存器总数超过 MB_CACHE_REGS_MAX 的区间被忽略)
+ */
+uint8_t MB_Cache_Init(const MB_Cache_Range_t *table, uint8_t num);
+
+/**
+ * @brief  设置允许用缓存应答的最大数据年龄
+ */
+void MB_Cache_SetMaxAge(uint32_t max_age_ms);
+
+/**
+ * @brief  用缓存应答读请求
+ * @param  unit: 从站地址
+ * @param  pdu: 请求 PDU (功能码 + 起始地址 + 数量)
+ * @param  pdu_len: 请求 PDU 长度
+ * @param  resp: 输出应答 PDU (功能码 + 字节数 + 数据)
+ * @retval 应答 PDU 长度, 0 表示未命中
+ */
+uint8_t MB_Cache_Lookup(uint8_t unit, const uint8_t *pdu, uint8_t pdu_len, uint8_t *resp);
+
+/**
+ * @brief  获取下一个到期的轮询请求
+ * @param  unit: 输出从站地址
+ * @param  pdu: 输出请求 PDU (5 字节)
+ * @retval 1:有到期区间  0:无
+ */
+uint8_t MB_Cache_NextPoll(uint8_t *unit, uint8_t *pdu);
+
+/**
+ * @brief  从站应答更新缓存 (轮询或上游请求的应答都可以)
+ * @param  unit: 从站地址
+ * @param  req: 请求 PDU
+ * @param  resp: 应答 PDU
+ * @param  resp_len: 应答 PDU 长度
+ * @note   请求与某个区间完全一致时才更新
+ */
+void MB_Cache_Update(uint8_t unit, const uint8_t *req, const uint8_t *resp, uint8_t resp_len);
+
+/**
+ * @brief  轮询失败, 缓存保持旧值但不再用于应答
+ */
+void MB_Cache_PollFailed(uint8_t unit, const uint8_t *req);
+
+/**
+ * @brief  取出一条完整上报记录
+ * @param  buf: 输出缓冲, 至少 MB_REPORT_LEN_MAX 字节
+ * @retval 记录长度, 0 表示无记录
+ * @note   由上行发送任务调用
+ */
+uint16_t MB_Cache_TakeReport(uint8_t *buf);
+
+/**
+ * @brief  获取缓存统计
+ */
+void MB_Cache_GetStats(MB_Cache_Stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MB_CACHE_H__ */
@@ -0,0 +1,40 @@
+/**
+  ******************************************************************************
+  * @file    mb_crc.h
+  * @brief   Modbus RTU CRC16 Header
+  ******************************************************************************
+  */
+
+#ifndef __MB_CRC_H__
+#define __MB_CRC_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief  计算 Modbus CRC16 (多项式 0xA001, 初值 0xFFFF)
+ * @param  data: 数据
+ * @param  len: 长度
+ * @retval CRC 值, 帧中按低字节在前发送
+ */
+uint16_t MB_CRC16(const uint8_t *data, uint16_t len);
+
+/**
+ * @brief  校验 RTU 帧 (最后两个字节为 CRC)
+ * @param  frame: 帧数据
+ * @param  len: 帧长度(含 CRC)
+ * @retval 1:校验通过  0:失败
+ */
+uint8_t MB_CRC16_Check(const uint8_t *frame, uint16_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MB_CRC_H__ */
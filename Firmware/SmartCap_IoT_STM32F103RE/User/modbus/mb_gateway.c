@@ -0,0 +1,565 @@
+/**
+  ******************************************************************************
+  * @file    mb_gateway.c
+  * @brief   Modbus TCP <-> RTU Gateway
+  ******************************************************************************
+  * @description
+  * 数据流:
+  * - TCP 连接收到 MBAP 请求 -> 按从站地址放入对应队列 (请求池 + 链表)
+  * - RTU 主站每次从下一个有请求的从站队列取一个请求 (轮询), 组 RTU 帧发送
+  * - RS485 接收任务把应答字节交给网关, 帧间静默判定帧结束, 校验 CRC
+  * - 应答按请求记录的连接和事务号 (事务映射) 写回对应客户端
+  *
+  * 连接断开后连接代号 (gen) 递增, 该连接尚未处理的请求在出队时直接丢弃。
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "mb_gateway.h"
+#include "mb_crc.h"
+#include "mb_cache.h"
+#include "rs485.h"
+#include "metrics.h"
+#include "wiz_supervisor.h"
+#include "wiz_txq.h"
+#include "socket.h"
+#include "cmsis_os.h"
+#include "event_log.h"
+#include "console.h"
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define MB_CONN_TXQ_SIZE        256
+#define MB_RTU_BUF_SIZE         256
+#define MB_REQ_POLL             MB_REQ_MAX  /* 请求池最后一个位置留给缓存轮询 */
+#define MB_CONN_POLL            0xFF        /* 轮询请求的来源连接 */
+
+/* Private types -------------------------------------------------------------*/
+typedef struct {
+    uint8_t buf[MB_ADU_MAX];            /* 未处理完的 TCP 数据 */
+    uint16_t len;
+    uint8_t gen;                        /* 连接代号 */
+    uint8_t open;                       /* 连接已建立, 发送队列已打开 */
+    uint8_t txq_buf[MB_CONN_TXQ_SIZE];
+} MB_Conn_t;
+
+typedef struct {
+    uint8_t used;
+    uint8_t conn;                       /* 来源连接 */
+    uint8_t gen;                        /* 入队时的连接代号 */
+    uint8_t unit;
+    uint16_t tid;                       /* MBAP 事务号 */
+    uint8_t pdu_len;
+    uint8_t pdu[MB_PDU_MAX];
+    uint32_t enq_tick;
+    int8_t next;                        /* 同一从站队列中的下一个请求, -1 表示队尾 */
+} MB_Req_t;
+
+typedef struct {
+    uint8_t unit;
+    uint8_t count;
+    int8_t head;
+    int8_t tail;
+} MB_SlaveQ_t;
+
+typedef enum {
+    RTU_IDLE = 0,
+    RTU_WAIT,                           /* 等待从站应答 */
+    RTU_BCAST                           /* 广播后等待总线转换 */
+} MB_RTU_State_t;
+
+/* Private variables ---------------------------------------------------------*/
+static MB_Conn_t conns[MB_TCP_SOCK_NUM];
+static MB_Req_t reqs[MB_REQ_MAX + 1];
+static MB_SlaveQ_t slave_q[MB_SLAVE_QUEUE_MAX];
+static uint8_t rr_next = 0;
+
+static MB_RTU_State_t rtu_state = RTU_IDLE;
+static int8_t rtu_req = -1;
+static uint8_t rtu_retry = 0;
+static uint32_t rtu_tx_tick = 0;
+static uint8_t rtu_tx[MB_RTU_BUF_SIZE];
+static uint8_t rtu_rx[MB_RTU_BUF_SIZE];
+static volatile uint16_t rtu_rx_len = 0;
+static volatile uint32_t rtu_rx_tick = 0;
+static volatile uint8_t rtu_listening = 0;
+
+static osThreadId mb_task_handle = NULL;
+static osStaticThreadDef_t mb_task_cb;
+static uint32_t mb_task_stack[MB_GATEWAY_TASK_STACK];
+static MB_Gateway_Stats_t stats;
+
+/* Private functions ---------------------------------------------------------*/
+
+static uint16_t MB_Rd16(const uint8_t *p)
+{
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+/**
+ * @brief  向客户端发送一帧 MBAP 应答
+ */
+static void MB_Reply(uint8_t conn, uint8_t gen, uint16_t tid, uint8_t unit,
+                     const uint8_t *pdu, uint8_t pdu_len)
+{
+    static uint8_t frame[MB_ADU_MAX];
+    uint16_t len = MB_MBAP_LEN + pdu_len;
+    MB_Conn_t *c = &conns[conn];
+
+    if (!c->open || c->gen != gen)
+    {
+        stats.tx_dropped++;
+        return;
+    }
+
+    frame[0] = (uint8_t)(tid >> 8);
+    frame[1] = (uint8_t)tid;
+    frame[2] = 0;
+    frame[3] = 0;
+    frame[4] = 0;
+    frame[5] = pdu_len + 1;
+    frame[6] = unit;
+    memcpy(&frame[MB_MBAP_LEN], pdu, pdu_len);
+
+    if (wiz_txq_write(MB_TCP_SOCK_FIRST + conn, frame, len, 0) != len)
+        stats.tx_dropped++;
+}
+
+/**
+ * @brief  发送异常应答
+ */
+static void MB_ReplyException(uint8_t conn, uint8_t gen, uint16_t tid, uint8_t unit,
+                              uint8_t func, uint8_t code)
+{
+    uint8_t pdu[2];
+
+    pdu[0] = func | 0x80;
+    pdu[1] = code;
+    stats.exceptions++;
+    MB_Reply(conn, gen, tid, unit, pdu, sizeof(pdu));
+}
+
+/**
+ * @brief  请求放入对应从站的队列
+ */
+static void MB_Enqueue(uint8_t conn, uint16_t tid, uint8_t unit, const uint8_t *pdu, uint8_t pdu_len)
+{
+    MB_SlaveQ_t *q = NULL;
+    uint8_t i;
+    int8_t slot = -1;
+
+    for (i = 0; i < MB_SLAVE_QUEUE_MAX; i++)
+    {
+        if (slave_q[i].count > 0 && slave_q[i].unit == unit)
+        {
+            q = &slave_q[i];
+            break;
+        }
+        if (q == NULL && slave_q[i].count == 0)
+            q = &slave_q[i];
+    }
+    for (i = 0; i < MB_REQ_MAX; i++)
+    {
+        if (!reqs[i].used)
+        {
+            slot = (int8_t)i;
+            break;
+        }
+    }
+    if (q == NULL || slot < 0)
+    {
+        stats.queue_full++;
+        MB_ReplyException(conn, conns[conn].gen, tid, unit, pdu[0], MB_EX_SLAVE_BUSY);
+        return;
+    }
+
+    reqs[slot].used = 1;
+    reqs[slot].conn = conn;
+    reqs[slot].gen = conns[conn].gen;
+    reqs[slot].unit = unit;
+    reqs[slot].tid = tid;
+    reqs[slot].pdu_len = pdu_len;
+    memcpy(reqs[slot].pdu, pdu, pdu_len);
+    reqs[slot].enq_tick = osKernelSysTick();
+    reqs[slot].next = -1;
+
+    if (q->count == 0)
+    {
+        q->unit = unit;
+        q->head = slot;
+    }
+    else
+    {
+        reqs[q->tail].next = slot;
+    }
+    q->tail = slot;
+    q->count++;
+}
+
+/**
+ * @brief  轮询各从站队列, 取出下一个请求
+ * @retval 请求池下标, -1 表示无请求
+ */
+static int8_t MB_Dequeue(void)
+{
+    uint8_t i, n;
+    int8_t slot;
+    MB_SlaveQ_t *q;
+
+    for (n = 0; n < MB_SLAVE_QUEUE_MAX; n++)
+    {
+        i = (rr_next + n) % MB_SLAVE_QUEUE_MAX;
+        q = &slave_q[i];
+        if (q->count == 0)
+            continue;
+        slot = q->head;
+        q->head = reqs[slot].next;
+        q->count--;
+        rr_next = (i + 1) % MB_SLAVE_QUEUE_MAX;
+        return slot;
+    }
+    return -1;
+}
+
+/**
+ * @brief  连接断开, 使该连接的未处理请求失效
+ */
+static void MB_ConnReset(uint8_t idx)
+{
+    MB_Conn_t *c = &conns[idx];
+
+    if (c->open)
+        wiz_txq_close(MB_TCP_SOCK_FIRST + idx);
+    c->open = 0;
+    c->len = 0;
+    c->gen++;
+}
+
+/**
+ * @brief  读取 TCP 数据并拆分 MBAP 帧
+ */
+static void MB_ConnRecv(uint8_t idx)
+{
+    MB_Conn_t *c = &conns[idx];
+    uint8_t sn = MB_TCP_SOCK_FIRST + idx;
+    uint16_t rsr, space, plen, flen;
+    int32_t n;
+
+    rsr = getSn_RX_RSR(sn);
+    space = MB_ADU_MAX - c->len;
+    if (rsr > 0 && space > 0)
+    {
+        n = recv(sn, &c->buf[c->len], (rsr < space) ? rsr : space);
+        if (n > 0)
+            c->len += (uint16_t)n;
+    }
+
+    while (c->len >= MB_MBAP_LEN)
+    {
+        plen = MB_Rd16(&c->buf[4]);
+        /* 协议号必须为 0, 长度字段含单元号和至少 1 字节功能码 */
+        if (MB_Rd16(&c->buf[2]) != 0 || plen < 2 || plen > MB_PDU_MAX + 1)
+        {
+            MB_ConnReset(idx);
+            close(sn);
+            return;
+        }
+        flen = 6 + plen;
+        if (c->len < flen)
+            break;
+
+        stats.requests++;
+#if MB_CACHE_ENABLE
+        /* 缓存命中时直接应答, 不占用总线 */
+        {
+            static uint8_t resp[MB_PDU_MAX];
+            uint8_t resp_len = MB_Cache_Lookup(c->buf[6], &c->buf[MB_MBAP_LEN], (uint8_t)(plen - 1), resp);
+            if (resp_len > 0)
+            {
+                MB_Reply(idx, c->gen, MB_Rd16(&c->buf[0]), c->buf[6], resp, resp_len);
+                stats.responses++;
+                c->len -= flen;
+                memmove(c->buf, &c->buf[flen], c->len);
+                continue;
+            }
+        }
+#endif
+        MB_Enqueue(idx, MB_Rd16(&c->buf[0]), c->buf[6], &c->buf[MB_MBAP_LEN], (uint8_t)(plen - 1));
+
+        c->len -= flen;
+        memmove(c->buf, &c->buf[flen], c->len);
+    }
+}
+
+/**
+ * @brief  维护 Modbus TCP 监听 socket
+ */
+static void MB_TCP_Poll(void)
+{
+    uint8_t i, sn;
+
+    for (i = 0; i < MB_TCP_SOCK_NUM; i++)
+    {
+        sn = MB_TCP_SOCK_FIRST + i;
+        switch (getSn_SR(sn))
+        {
+        case SOCK_CLOSED:
+            if (conns[i].open)
+                MB_ConnReset(i);
+            if (socket(sn, Sn_MR_TCP, MB_TCP_PORT, SF_IO_NONBLOCK) == sn)
+                listen(sn);
+            break;
+
+        case SOCK_INIT:
+            listen(sn);
+            break;
+
+        case SOCK_ESTABLISHED:
+            if (!conns[i].open)
+            {
+                conns[i].len = 0;
+                if (wiz_txq_open(sn, conns[i].txq_buf, sizeof(conns[i].txq_buf)) == 0)
+                    conns[i].open = 1;
+            }
+            MB_ConnRecv(i);
+            wiz_txq_poll_socket(sn);
+            break;
+
+        case SOCK_CLOSE_WAIT:
+            MB_ConnReset(i);
+            close(sn);
+            break;
+
+        default:
+            break;
+        }
+    }
+}
+
+/**
+ * @brief  发送 RTU 请求帧
+ */
+static void MB_RTU_Send(const MB_Req_t *req)
+{
+    uint16_t len = 0, crc, i;
+
+    rtu_tx[len++] = req->unit;
+    memcpy(&rtu_tx[len], req->pdu, req->pdu_len);
+    len += req->pdu_len;
+    crc = MB_CRC16(rtu_tx, len);
+    rtu_tx[len++] = (uint8_t)crc;
+    rtu_tx[len++] = (uint8_t)(crc >> 8);
+
+    rtu_listening = 0;
+    rtu_rx_len = 0;
+
+    RS485_SetTransmitMode();
+    osDelay(1);  // 等待收发器切换
+    for (i = 0; i < len; i++)
+        RS485_SendByte(rtu_tx[i]);
+    RS485_SetReceiveMode();
+
+    rtu_tx_tick = osKernelSysTick();
+    rtu_listening = (req->unit != 0);
+}
+
+/**
+ * @brief  结束当前请求, 释放总线
+ */
+static void MB_RTU_Finish(void)
+{
+    rtu_listening = 0;
+    RS485_ReleaseBus();
+    reqs[rtu_req].used = 0;
+    rtu_req = -1;
+    rtu_state = RTU_IDLE;
+}
+
+/**
+ * @brief  超时或应答错误: 重发或返回异常
+ */
+static void MB_RTU_Fail(void)
+{
+    MB_Req_t *req = &reqs[rtu_req];
+
+    if (rtu_retry < MB_RTU_RETRY)
+    {
+        rtu_retry++;
+        MB_RTU_Send(req);
+        return;
+    }
+#if MB_CACHE_ENABLE
+    if (req->conn == MB_CONN_POLL)
+        MB_Cache_PollFailed(req->unit, req->pdu);
+    else
+#endif
+        MB_ReplyException(req->conn, req->gen, req->tid, req->unit, req->pdu[0], MB_EX_GW_TARGET_FAILED);
+    MB_RTU_Finish();
+}
+
+/**
+ * @brief  收到完整应答帧
+ */
+static void MB_RTU_Complete(void)
+{
+    MB_Req_t *req = &reqs[rtu_req];
+    uint16_t len = rtu_rx_len;
+    uint32_t latency;
+
+    rtu_listening = 0;
+    /* 最短应答: 地址 + 功能码 + 1 字节 + CRC */
+    if (len < 5 || rtu_rx[0] != req->unit || !MB_CRC16_Check(rtu_rx, len))
+    {
+        stats.crc_errors++;
+        MB_RTU_Fail();
+        return;
+    }
+
+#if MB_CACHE_ENABLE
+    /* 轮询应答和与缓存区间一致的上游读应答都用于更新缓存 */
+    MB_Cache_Update(req->unit, req->pdu, &rtu_rx[1], (uint8_t)(len - 3));
+    if (req->conn == MB_CONN_POLL)
+    {
+        MB_RTU_Finish();
+        return;
+    }
+#endif
+    MB_Reply(req->conn, req->gen, req->tid, req->unit, &rtu_rx[1], (uint8_t)(len - 3));
+    stats.responses++;
+    latency = osKernelSysTick() - req->enq_tick;
+    stats.latency_last_ms = latency;
+    Metrics_Observe(METRIC_HIST_MB_LATENCY, latency);
+    if (latency > stats.latency_max_ms)
+        stats.latency_max_ms = latency;
+    MB_RTU_Finish();
+}
+
+/**
+ * @brief  RTU 主站状态机
+ */
+static void MB_RTU_Poll(void)
+{
+    uint32_t now = osKernelSysTick();
+    MB_Req_t *req;
+
+    switch (rtu_state)
+    {
+    case RTU_IDLE:
+        if (rtu_req < 0)
+        {
+            rtu_req = MB_Dequeue();
+#if MB_CACHE_ENABLE
+            /* 没有上游请求时执行缓存轮询 */
+            if (rtu_req < 0 && MB_Cache_NextPoll(&reqs[MB_REQ_POLL].unit, reqs[MB_REQ_POLL].pdu))
+            {
+                reqs[MB_REQ_POLL].used = 1;
+                reqs[MB_REQ_POLL].conn = MB_CONN_POLL;
+                reqs[MB_REQ_POLL].pdu_len = 5;
+                reqs[MB_REQ_POLL].enq_tick = now;
+                rtu_req = MB_REQ_POLL;
+            }
+#endif
+            if (rtu_req < 0)
+                return;
+            rtu_retry = 0;
+        }
+        req = &reqs[rtu_req];
+
+        /* 客户端已断开, 不再发送 */
+        if (req->conn != MB_CONN_POLL &&
+            (!conns[req->conn].open || conns[req->conn].gen != req->gen))
+        {
+            req->used = 0;
+            rtu_req = -1;
+            return;
+        }
+
+        /* 透传正在使用总线, 下次再试 */
+        if (!RS485_AcquireBus(0))
+            return;
+
+        MB_RTU_Send(req);
+        rtu_state = (req->unit == 0) ? RTU_BCAST : RTU_WAIT;
+        break;
+
+    case RTU_WAIT:
+        if (rtu_rx_len > 0)
+        {
+            if ((now - rtu_rx_tick) >= MB_RTU_FRAME_GAP_MS)
+                MB_RTU_Complete();
+        }
+        else if ((now - rtu_tx_tick) >= MB_RTU_TIMEOUT_MS)
+        {
+            stats.timeouts++;
+            MB_RTU_Fail();
+        }
+        break;
+
+    case RTU_BCAST:
+        /* 广播无应答 */
+        if ((now - rtu_tx_tick) >= MB_RTU_BCAST_DELAY_MS)
+            MB_RTU_Finish();
+        break;
+    }
+}
+
+/**
+ * @brief  网关任务
+ */
+static void MB_Gateway_Task(void const *argument)
+{
+    for (;;)
+    {
+        if (wiz_supervisor_get_state() == WIZ_SUP_STATE_UP)
+            MB_TCP_Poll();
+        MB_RTU_Poll();
+        osDelay(1);
+    }
+}
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief  创建网关任务, 在以太网初始化之后调用一次
+ */
+void MB_Gateway_Init(void)
+{
+    if (mb_task_handle != NULL)
+        return;
+    osThreadStaticDef(mbGatewayTask, MB_Gateway_Task, osPriorityNormal, 0, MB_GATEWAY_TASK_STACK,
+                      mb_task_stack, &mb_task_cb);
+    mb_task_handle = osThreadCreate(osThread(mbGatewayTask), NULL);
+    if (mb_task_handle == NULL)
+    {
+        Console_Puts("Modbus: gateway task create failed\r\n");
+        EVENT_LOG1(TASK_CREATE_FAILED, EventLog_Tag("mbgw"));
+    }
+}
+
+/**
+ * @brief  RS485 接收字节分流
+ */
+uint8_t MB_Gateway_RxByte(uint8_t byte)
+{
+    uint16_t len;
+
+    if (!rtu_listening)
+        return 0;
+    /* 先更新时间再更新长度, 网关任务看到新长度时时间已是最新 */
+    rtu_rx_tick = osKernelSysTick();
+    len = rtu_rx_len;
+    if (len < MB_RTU_BUF_SIZE)
+    {
+        rtu_rx[len] = byte;
+        rtu_rx_len = len + 1;
+    }
+    return 1;
+}
+
+/**
+ * @brief  获取网关统计
+ */
+void MB_Gateway_GetStats(MB_Gateway_Stats_t *out)
+{
+    *out = stats;
+}
@@ -0,0 +1,87 @@
+/**
+  ******************************************************************************
+  * @file    mb_gateway.h
+  * @brief   Modbus TCP <-> RTU Gateway Header
+  ******************************************************************************
+  * @description
+  * W5500 上的 Modbus TCP 服务器 (端口 502, 多连接), 请求转换为 RTU 帧
+  * 经 RS485 (USART1) 发给从站, 应答按原 MBAP 事务号返回给对应客户端。
+  *
+  * - 每个客户端可以连续发送多个请求 (流水线), 网关按从站分别排队
+  * - 多个从站之间轮询调度, 一个从站超时不会阻塞其他从站的请求
+  * - 从站无应答时返回异常码 0x0B, 队列满时返回 0x06
+  ******************************************************************************
+  */
+
+#ifndef __MB_GATEWAY_H__
+#define __MB_GATEWAY_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported defines ----------------------------------------------------------*/
+#define MB_GATEWAY_ENABLE       1       /* 1=启用Modbus TCP网关, 0=只保留透传 */
+
+#define MB_TCP_PORT             502
+#define MB_TCP_SOCK_FIRST       2       /* 使用 socket 2 ~ 2+MB_TCP_SOCK_NUM-1 */
+#define MB_TCP_SOCK_NUM         2       /* 同时连接的客户端数 (socket 4 为 SNMP_AGENT_SOCK) */
+
+#define MB_REQ_MAX              8       /* 请求池大小 (所有从站共享) */
+#define MB_SLAVE_QUEUE_MAX      4       /* 同时有请求排队的从站数 */
+
+#define MB_RTU_TIMEOUT_MS       200     /* 从站应答超时 */
+#define MB_RTU_FRAME_GAP_MS     3       /* 帧间静默超过该时间判定帧结束 */
+#define MB_RTU_RETRY            1       /* 超时/CRC错误重发次数 */
+#define MB_RTU_BCAST_DELAY_MS   50      /* 广播后的总线转换延时 */
+#define MB_GATEWAY_TASK_STACK   256     /* 网关任务栈 (字, 静态分配) */
+
+#define MB_PDU_MAX              253
+#define MB_MBAP_LEN             7
+#define MB_ADU_MAX              (MB_MBAP_LEN + MB_PDU_MAX)
+
+/* 异常码 */
+#define MB_EX_SLAVE_BUSY        0x06
+#define MB_EX_GW_TARGET_FAILED  0x0B
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct {
+    uint32_t requests;          /* 收到的 TCP 请求 */
+    uint32_t responses;         /* 从站正常应答 */
+    uint32_t exceptions;        /* 网关生成的异常应答 */
+    uint32_t timeouts;          /* 从站应答超时次数 (含重发) */
+    uint32_t crc_errors;        /* 应答 CRC 错误次数 */
+    uint32_t queue_full;        /* 请求池/从站队列满 */
+    uint32_t tx_dropped;        /* 客户端已断开或发送队列满, 应答被丢弃 */
+    uint32_t latency_last_ms;   /* 最近一次请求从入队到应答的时间 */
+    uint32_t latency_max_ms;
+} MB_Gateway_Stats_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief  创建网关任务, 在以太网初始化之后调用一次
+ */
+void MB_Gateway_Init(void);
+
+/**
+ * @brief  RS485 接收字节分流
+ * @param  byte: 从 RS485 收到的字节
+ * @retval 1:网关正在等待从站应答,字节已被网关接收  0:不是网关的数据,按透传处理
+ * @note   由 RS485 接收任务调用
+ */
+uint8_t MB_Gateway_RxByte(uint8_t byte);
+
+/**
+ * @brief  获取网关统计
+ */
+void MB_Gateway_GetStats(MB_Gateway_Stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MB_GATEWAY_H__ */
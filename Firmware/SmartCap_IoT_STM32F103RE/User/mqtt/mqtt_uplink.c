@@ -0,0 +1,414 @@
+/**
+  ******************************************************************************
+  * @file    mqtt_uplink.c
+  * @brief   MQTT Uplink over Ethernet/Cellular Transports
+  ******************************************************************************
+  * @description
+  * Paho MQTTClient 的 Network 接在 Uplink_Transport_t 上 (ctx 指向会话所在链路的 transport):
+  * - 读: transport recv 只返回已到达的数据, 没有数据时返回 0, 报文由 MQTTClient 跨次拼接;
+  *   超过 MQTT_BUF_SIZE 的 PUBLISH 按块交给处理函数 (MessageData offset/total)
+  * - 写: transport 发送队列满时让出 1 个节拍并推进路由器 (以太网发送队列在 poll 中写入 W5500)
+  * 会话状态机在上行发送任务中运行, CONNECT/SUBSCRIBE 都不等待应答。
+  * QoS1 发布复制到 MQTTClient 的发送窗口 (inflight_store), PUBACK 在 MQTTPoll 中按报文标识
+  * 释放窗口, 超时和重连后的重发也在 MQTTPoll 中进行; 窗口不随会话清除。
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "mqtt_uplink.h"
+#include "MQTTClient.h"
+#include "uplink.h"
+#include "rg200u.h"
+#include "metrics.h"
+#include "event_log.h"
+#include "ota.h"
+#include "cmsis_os.h"
+#include <stdio.h>
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define MQTT_TOPIC_LEN          40
+#define MQTT_STATUS_ONLINE      "online"
+#define MQTT_STATUS_OFFLINE     "offline"
+#define MQTT_OTA_PREFIX         5       /* 'D' + 4 字节偏移 */
+
+/* Private types -------------------------------------------------------------*/
+typedef enum {
+    MQTT_SESSION_DOWN = 0,      /* 等待可用链路 */
+    MQTT_SESSION_CONNECTING,    /* 已发 CONNECT, 等待 CONNACK */
+    MQTT_SESSION_UP,
+    MQTT_SESSION_BACKOFF        /* 出错后等待 MQTT_RETRY_MS */
+} MQTT_Session_State_t;
+
+/* Private variables ---------------------------------------------------------*/
+static MQTTClient client;
+static Network network;
+static unsigned char send_buf[MQTT_BUF_SIZE];
+static unsigned char read_buf[MQTT_BUF_SIZE];
+static unsigned char inflight_store[MQTT_INFLIGHT_WINDOW][MQTT_BUF_SIZE];
+
+static MQTT_Session_State_t session_state = MQTT_SESSION_DOWN;
+static Uplink_ID_t session_link = UPLINK_NONE;
+static uint32_t session_tick = 0;
+
+static char client_id[24];
+static char topics[MQTT_TOPIC_COUNT][MQTT_TOPIC_LEN];
+static char topic_status[MQTT_TOPIC_LEN];
+static char topic_down[MQTT_TOPIC_LEN];
+static char topic_cmd[MQTT_TOPIC_LEN];
+static MQTT_Uplink_RxFn_t down_fn = NULL;
+
+#if OTA_ENABLE
+static char topic_ota[MQTT_TOPIC_LEN];
+static char topic_ota_status[MQTT_TOPIC_LEN];
+static char ota_json[MQTT_PAYLOAD_MAX];
+static uint8_t ota_prefix[MQTT_OTA_PREFIX];     /* 当前消息的类型和偏移 (分块到达时跨块保存) */
+static uint8_t ota_prefix_len = 0;
+static uint8_t ota_report = 0;                  /* 收到命令, 需要发布状态 */
+static uint16_t ota_seq = 0;                    /* 上一次发布的状态序号 */
+#endif
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief  Network 读: 不阻塞
+ */
+static int MQTT_Uplink_NetRead(Network *n, unsigned char *buf, int len, long timeout_ms)
+{
+    const Uplink_Transport_t *t = (const Uplink_Transport_t *)n->ctx;
+
+    if (t->recv == NULL)
+        return 0;
+    return (int)t->recv(buf, (uint16_t)len);
+}
+
+/**
+ * @brief  Network 写: 发送队列满时等待 1 个节拍, 由 sendPacket 重试直到超时
+ */
+static int MQTT_Uplink_NetWrite(Network *n, unsigned char *buf, int len, long timeout_ms)
+{
+    const Uplink_Transport_t *t = (const Uplink_Transport_t *)n->ctx;
+    int32_t ret;
+
+    if (!t->ready())
+        return -1;
+    ret = t->send(buf, (uint16_t)len);
+    if (ret == 0)
+    {
+        osDelay(1);
+        Uplink_Router_Poll();
+    }
+    return (int)ret;
+}
+
+/**
+ * @brief  Network 断开
+ */
+static void MQTT_Uplink_NetDisconnect(Network *n)
+{
+    const Uplink_Transport_t *t = (const Uplink_Transport_t *)n->ctx;
+
+    if (t->reset != NULL)
+        t->reset();
+}
+
+/**
+ * @brief  rs485/down 主题, 超过接收缓冲的消息分块到达, 逐块转发
+ */
+static void MQTT_Uplink_OnDown(MessageData *md)
+{
+    if (md->offset == 0)
+        Metrics_Inc(METRIC_MQTT_RX_MSGS);
+    if (down_fn != NULL && md->message->payloadlen > 0)
+        down_fn((const uint8_t *)md->message->payload, (uint16_t)md->message->payloadlen);
+}
+
+/**
+ * @brief  cmd 主题, 只处理完整到达的命令 (分块的长消息丢弃)
+ */
+static void MQTT_Uplink_OnCmd(MessageData *md)
+{
+    if (md->offset == 0)
+        Metrics_Inc(METRIC_MQTT_RX_MSGS);
+    if (md->total != md->message->payloadlen)
+        return;
+    RG200U_ProcessCommand((const char *)md->message->payload, (uint16_t)md->message->payloadlen);
+}
+
+/**
+ * @brief  结束会话并断开 TCP 连接
+ * @param  backoff: 1=会话出错, 等待 MQTT_RETRY_MS 再重连  0=链路切换, 立即在新链路上重连
+ */
+static void MQTT_Uplink_Drop(uint8_t backoff)
+{
+    if (session_link != UPLINK_NONE)
+    {
+        network.disconnect(&network);
+        Metrics_Inc(METRIC_MQTT_SESSION_DROPS);
+        EVENT_LOG0(MQTT_SESSION_DROP);
+    }
+    MQTTCloseSession(&client);
+    session_link = UPLINK_NONE;
+    session_state = backoff ? MQTT_SESSION_BACKOFF : MQTT_SESSION_DOWN;
+    session_tick = osKernelSysTick();
+}
+
+#if OTA_ENABLE
+/**
+ * @brief  ota 主题: 'B'+文件头 开始, 'D'+偏移(4 字节大端)+数据 写入, 'A' 放弃;
+ *         长的 'D' 消息分块到达, 每块按其在消息中的位置写入
+ */
+static void MQTT_Uplink_OnOta(MessageData *md)
+{
+    const uint8_t *p = (const uint8_t *)md->message->payload;
+    uint32_t len = (uint32_t)md->message->payloadlen;
+    uint32_t pos = (uint32_t)md->offset;
+    uint32_t base;
+
+    if (pos == 0)
+    {
+        Metrics_Inc(METRIC_MQTT_RX_MSGS);
+        ota_prefix_len = 0;
+    }
+    while (len > 0 && ota_prefix_len < MQTT_OTA_PREFIX)
+    {
+        ota_prefix[ota_prefix_len++] = *p;
+        if (ota_prefix[0] != 'D')
+            break;
+        p++;
+        len--;
+        pos++;
+    }
+    if (ota_prefix_len == 0)
+        return;
+
+    switch (ota_prefix[0])
+    {
+    case 'B':
+        if (md->total == md->message->payloadlen)
+            OTA_Begin(p + 1, (uint16_t)(len - 1));
+        ota_report = 1;
+        break;
+
+    case 'A':
+        OTA_Abort();
+        ota_report = 1;
+        break;
+
+    case 'D':
+        if (ota_prefix_len < MQTT_OTA_PREFIX || len == 0)
+            break;
+        base = ((uint32_t)ota_prefix[1] << 24) | ((uint32_t)ota_prefix[2] << 16) |
+               ((uint32_t)ota_prefix[3] << 8) | ota_prefix[4];
+        /* 偏移不对 (重复/丢失的消息) 时上报状态, 发送方从 received 继续 */
+        if (OTA_Write(base + pos - MQTT_OTA_PREFIX, p, (uint16_t)len) != OTA_OK)
+            ota_report = 1;
+        break;
+
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief  收到命令或下载进度变化 (每页) 时发布 ota/status
+ */
+static void MQTT_Uplink_OtaReport(void)
+{
+    OTA_Status_t st;
+    MQTTMessage msg;
+
+    OTA_GetStatus(&st);
+    if (!ota_report && st.seq == ota_seq)
+        return;
+
+    msg.qos = QOS0;
+    msg.retained = 0;
+    msg.dup = 0;
+    msg.id = 0;
+    msg.payload = ota_json;
+    msg.payloadlen = OTA_StatusJson(ota_json, sizeof(ota_json));
+    if (MQTTPublish(&client, topic_ota_status, &msg) != SUCCESSS)
+    {
+        MQTT_Uplink_Drop(1);
+        return;
+    }
+    ota_report = 0;
+    ota_seq = st.seq;
+}
+#endif
+
+/**
+ * @brief  在当前链路上发送 CONNECT
+ */
+static void MQTT_Uplink_Connect(Uplink_ID_t link)
+{
+    MQTTPacket_connectData data = MQTTPacket_connectData_initializer;
+
+    session_link = link;
+    network.ctx = Uplink_Router_GetTransport(link);
+    MQTTCloseSession(&client);
+
+    data.MQTTVersion = 4;
+    data.clientID.cstring = client_id;
+    data.username.cstring = MQTT_USERNAME;
+    data.password.cstring = MQTT_PASSWORD;
+    data.keepAliveInterval = MQTT_KEEPALIVE_S;
+    data.cleansession = 1;
+    data.willFlag = 1;
+    data.will.topicName.cstring = topic_status;
+    data.will.message.cstring = MQTT_STATUS_OFFLINE;
+    data.will.retained = 1;
+    data.will.qos = QOS0;
+
+    Metrics_Inc(METRIC_MQTT_CONNECTS);
+    EVENT_LOG1(MQTT_CONNECT, link);
+    if (MQTTConnectAsync(&client, &data) != SUCCESSS)
+    {
+        MQTT_Uplink_Drop(1);
+        return;
+    }
+    session_state = MQTT_SESSION_CONNECTING;
+    session_tick = osKernelSysTick();
+}
+
+/**
+ * @brief  CONNACK 之后: 订阅下行主题, 发布在线状态
+ */
+static void MQTT_Uplink_Established(void)
+{
+    MQTTMessage msg = {QOS0, 1, 0, 0, MQTT_STATUS_ONLINE, sizeof(MQTT_STATUS_ONLINE) - 1};
+
+    if (MQTTSubscribeAsync(&client, topic_down, QOS1, MQTT_Uplink_OnDown) != SUCCESSS ||
+        MQTTSubscribeAsync(&client, topic_cmd, QOS1, MQTT_Uplink_OnCmd) != SUCCESSS ||
+#if OTA_ENABLE
+        MQTTSubscribeAsync(&client, topic_ota, QOS1, MQTT_Uplink_OnOta) != SUCCESSS ||
+#endif
+        MQTTPublish(&client, topic_status, &msg) != SUCCESSS)
+    {
+        MQTT_Uplink_Drop(1);
+        return;
+    }
+    session_state = MQTT_SESSION_UP;
+}
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief  初始化客户端和主题
+ */
+void MQTT_Uplink_Init(MQTT_Uplink_RxFn_t rs485_down)
+{
+    static const char *const topic_names[MQTT_TOPIC_COUNT] = {"rs485/up", "modbus", "metrics"};
+    uint32_t uid = HAL_GetUIDw0() ^ HAL_GetUIDw1() ^ HAL_GetUIDw2();
+    uint8_t i;
+
+    down_fn = rs485_down;
+    snprintf(client_id, sizeof(client_id), "%s-%08lx", MQTT_TOPIC_ROOT, (unsigned long)uid);
+    for (i = 0; i < MQTT_TOPIC_COUNT; i++)
+        snprintf(topics[i], MQTT_TOPIC_LEN, "%s/%08lx/%s", MQTT_TOPIC_ROOT, (unsigned long)uid, topic_names[i]);
+    snprintf(topic_status, sizeof(topic_status), "%s/%08lx/status", MQTT_TOPIC_ROOT, (unsigned long)uid);
+    snprintf(topic_down, sizeof(topic_down), "%s/%08lx/rs485/down", MQTT_TOPIC_ROOT, (unsigned long)uid);
+    snprintf(topic_cmd, sizeof(topic_cmd), "%s/%08lx/cmd", MQTT_TOPIC_ROOT, (unsigned long)uid);
+#if OTA_ENABLE
+    snprintf(topic_ota, sizeof(topic_ota), "%s/%08lx/ota", MQTT_TOPIC_ROOT, (unsigned long)uid);
+    snprintf(topic_ota_status, sizeof(topic_ota_status), "%s/%08lx/ota/status", MQTT_TOPIC_ROOT, (unsigned long)uid);
+#endif
+
+    network.my_socket = -1;
+    network.ctx = NULL;
+    network.mqttread = MQTT_Uplink_NetRead;
+    network.mqttwrite = MQTT_Uplink_NetWrite;
+    network.disconnect = MQTT_Uplink_NetDisconnect;
+    MQTTClientInit(&client, &network, MQTT_CMD_TIMEOUT_MS, send_buf, sizeof(send_buf), read_buf, sizeof(read_buf));
+    MQTTSetInflightWindow(&client, inflight_store[0], MQTT_BUF_SIZE, MQTT_INFLIGHT_WINDOW, MQTT_INFLIGHT_RETRY_MS);
+}
+
+/**
+ * @brief  会话维护和接收处理
+ */
+void MQTT_Uplink_Poll(void)
+{
+    Uplink_ID_t active = Uplink_Router_GetActive();
+    const Uplink_Transport_t *t;
+
+    /* 会话所在链路被切换或已断开: 在新链路上重新建立 */
+    if (session_link != UPLINK_NONE)
+    {
+        t = Uplink_Router_GetTransport(session_link);
+        if (session_link != active || !t->ready())
+            MQTT_Uplink_Drop(0);
+    }
+
+    switch (session_state)
+    {
+    case MQTT_SESSION_DOWN:
+        if (active != UPLINK_NONE)
+            MQTT_Uplink_Connect(active);
+        break;
+
+    case MQTT_SESSION_CONNECTING:
+        /* 代理拒绝连接时会关闭 TCP, 由上面的链路检查处理 */
+        if (MQTTPoll(&client) == FAILURE ||
+            (!client.isconnected && (osKernelSysTick() - session_tick) >= MQTT_CMD_TIMEOUT_MS))
+            MQTT_Uplink_Drop(1);
+        else if (client.isconnected)
+            MQTT_Uplink_Established();
+        break;
+
+    case MQTT_SESSION_UP:
+        if (MQTTPoll(&client) == FAILURE)
+            MQTT_Uplink_Drop(1);
+#if OTA_ENABLE
+        else
+            MQTT_Uplink_OtaReport();
+#endif
+        break;
+
+    case MQTT_SESSION_BACKOFF:
+        if ((osKernelSysTick() - session_tick) >= MQTT_RETRY_MS)
+            session_state = MQTT_SESSION_DOWN;
+        break;
+    }
+
+    Metrics_Set(METRIC_MQTT_RETRANSMITS, (uint32_t)client.retransmits);
+    Metrics_Set(METRIC_MQTT_INFLIGHT, client.inflight_count);
+}
+
+/**
+ * @brief  会话已建立
+ */
+uint8_t MQTT_Uplink_Ready(void)
+{
+    return session_state == MQTT_SESSION_UP;
+}
+
+/**
+ * @brief  发布一条消息
+ */
+uint8_t MQTT_Uplink_Publish(MQTT_Uplink_Topic_t topic, const uint8_t *data, uint16_t len)
+{
+    MQTTMessage msg;
+    int rc;
+
+    if (session_state != MQTT_SESSION_UP || topic >= MQTT_TOPIC_COUNT || len > MQTT_PAYLOAD_MAX)
+        return 0;
+
+    msg.qos = (topic == MQTT_TOPIC_METRICS) ? QOS0 : QOS1;
+    msg.retained = 0;
+    msg.dup = 0;
+    msg.id = 0;
+    msg.payload = (void *)data;
+    msg.payloadlen = len;
+    rc = MQTTPublishAsync(&client, topics[topic], &msg);
+    if (rc == WINDOW_FULL)
+        return 0;
+    if (rc != SUCCESSS)
+    {
+        MQTT_Uplink_Drop(1);
+        /* QoS1 写失败时消息已在窗口中 (id 非 0), 重连后重发 */
+        return (msg.id != 0);
+    }
+    Metrics_Inc(METRIC_MQTT_TX_MSGS);
+    return 1;
+}
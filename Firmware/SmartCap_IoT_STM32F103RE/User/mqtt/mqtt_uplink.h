@@ -0,0 +1,102 @@
+/**
+  ******************************************************************************
+  * @file    mqtt_uplink.h
+  * @brief   MQTT Uplink over Ethernet/Cellular Transports Header
+  ******************************************************************************
+  * @description
+  * MQTT 上行模式 (MQTT_UPLINK_ENABLE=1) 取代 TCP 透传, 服务器地址仍为 rg200u.h 中的
+  * TCP_SERVER_IP:TCP_SERVER_PORT (填写 MQTT 代理的地址):
+  * - MQTT 会话建立在路由器当前选择的链路上 (以太网或蜂窝), 收发经该链路的 transport 接口,
+  *   不阻塞读取, 不完整的报文保存在接收缓冲中等下次继续拼接
+  * - 链路切换/失效、协议错误或心跳超时时断开会话并重连 TCP, 在新链路上重新 CONNECT/SUBSCRIBE
+  * - rs485/up 和 modbus 以 QoS1 流水发布: 最多 MQTT_INFLIGHT_WINDOW 条消息同时等待 PUBACK,
+  *   按报文标识匹配应答; 超过 MQTT_INFLIGHT_RETRY_MS 未应答或重连后带 DUP 重发,
+  *   窗口中的消息在会话断开期间保留 (至少一次送达, 代理端可能收到重复消息)
+  * - 全部在上行发送任务中运行, 不需要新任务
+  *
+  * 主题 (<id> 为芯片 UID 的 8 位十六进制):
+  *   smartcap/<id>/rs485/up     RS485 收到的数据, 按批发布 (静默 MQTT_BATCH_IDLE_MS 或满一批)
+  *   smartcap/<id>/modbus       寄存器变化上报记录 (mb_cache.h)
+  *   smartcap/<id>/metrics      指标二进制记录 (metrics.h), 每 MQTT_METRICS_PERIOD_S 一次
+  *   smartcap/<id>/status       "online"/"offline" (保留消息, offline 为遗嘱)
+  *   smartcap/<id>/rs485/down   订阅: 消息内容原样发送到 RS485 (长消息按接收缓冲大小分块转发)
+  *   smartcap/<id>/cmd          订阅: 继电器等命令 (与 TCP 透传模式相同的文本命令)
+  *   smartcap/<id>/ota          订阅: 固件升级 (ota.h), 'B'+64 字节文件头 开始/继续,
+  *                              'D'+偏移(4 字节大端)+数据 写入 (可以超过接收缓冲), 'A' 放弃
+  *   smartcap/<id>/ota/status   升级状态 JSON, 收到 ota 命令、写入失败或每写满一页时发布
+  ******************************************************************************
+  */
+
+#ifndef __MQTT_UPLINK_H__
+#define __MQTT_UPLINK_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported defines ----------------------------------------------------------*/
+#define MQTT_UPLINK_ENABLE      0       /* 1=MQTT 上行, 0=TCP 透传 */
+
+#define MQTT_TOPIC_ROOT         "smartcap"
+#define MQTT_USERNAME           NULL    /* 代理不需要认证时为 NULL */
+#define MQTT_PASSWORD           NULL
+#define MQTT_KEEPALIVE_S        60
+#define MQTT_CMD_TIMEOUT_MS     5000    /* CONNACK 等待时间, 单个报文发送的最长时间 */
+#define MQTT_RETRY_MS           5000    /* 会话出错后重新连接的间隔 */
+
+#define MQTT_BUF_SIZE           256     /* 发送/接收缓冲, 决定报文的最大长度 */
+#define MQTT_PAYLOAD_MAX        (MQTT_BUF_SIZE - 64)    /* 发布内容上限 (留出固定头和主题) */
+
+#define MQTT_INFLIGHT_WINDOW    4       /* 同时等待 PUBACK 的 QoS1 消息, 每条占 MQTT_BUF_SIZE 字节 RAM */
+#define MQTT_INFLIGHT_RETRY_MS  3000    /* 未收到 PUBACK 时重发的间隔 */
+
+#define MQTT_BATCH_IDLE_MS      10      /* RS485 数据静默多久后发布当前一批 */
+#define MQTT_BATCH_MAX_MS       200     /* 一批数据最长等待时间 */
+#define MQTT_METRICS_PERIOD_S   60      /* 指标发布周期, 0=不发布 */
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum {
+    MQTT_TOPIC_RS485_UP = 0,
+    MQTT_TOPIC_MODBUS,
+    MQTT_TOPIC_METRICS,
+    MQTT_TOPIC_COUNT
+} MQTT_Uplink_Topic_t;
+
+/* rs485/down 主题收到的数据 */
+typedef void (*MQTT_Uplink_RxFn_t)(const uint8_t *data, uint16_t len);
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief  初始化客户端和主题, 在上行发送任务开始时调用一次
+ * @param  rs485_down: rs485/down 主题的数据回调 (在上行发送任务中调用)
+ */
+void MQTT_Uplink_Init(MQTT_Uplink_RxFn_t rs485_down);
+
+/**
+ * @brief  会话维护和接收处理, 在 Uplink_Router_Poll 之后周期调用, 不阻塞
+ */
+void MQTT_Uplink_Poll(void);
+
+/**
+ * @brief  会话已建立, 可以发布
+ */
+uint8_t MQTT_Uplink_Ready(void);
+
+/**
+ * @brief  发布一条消息, rs485/up 和 modbus 为 QoS1 (进入发送窗口, 不等待 PUBACK), metrics 为 QoS0
+ * @param  topic: 主题
+ * @param  data:  内容, 不超过 MQTT_PAYLOAD_MAX
+ * @param  len:   长度
+ * @retval 1:已发出/已进入窗口  0:会话未建立、窗口已满或发送失败 (调用者保留数据稍后重试)
+ */
+uint8_t MQTT_Uplink_Publish(MQTT_Uplink_Topic_t topic, const uint8_t *data, uint16_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MQTT_UPLINK_H__ */
@@ -0,0 +1,87 @@
+#!/usr/bin/env python3
+"""
+生成 OTA 固件文件: 64 字节文件头 (OTA_ImageHeader_t, ota_image.h) + 应用的 .bin。
+
+用法: python gen_ota_image.py <app.bin> <版本号> [-o out.ota] [--upload 设备IP]
+
+.bin 由 Keil 编译后的 fromelf 生成 (工程 After Build: fromelf --bin), 必须是为运行区
+(0x08004000) 链接的应用。生成的文件可以:
+- 放到 TFTP 服务器, 通过 POST /api/ota?op=tftp&server=...&file=... 让设备下载
+- 用 --upload 经 HTTP 分块发送 (断线后重新运行即从设备已写入的位置继续)
+- 作为 MQTT smartcap/<id>/ota 主题的内容按 'B'/'D' 消息发送 (见 mqtt_uplink.h)
+"""
+import argparse
+import hashlib
+import http.client
+import json
+import struct
+import sys
+import time
+import zlib
+
+MAGIC = 0x41544F53
+SLOT_SIZE = 0x38000
+APP_ADDR = 0x08004000
+CHUNK = 256     # WIZ_HTTP_BODY_MAX
+
+
+def make_image(app, version):
+    sp, pc = struct.unpack_from('<II', app)
+    if not (0x20000000 < sp <= 0x20010000) or not (APP_ADDR <= pc < APP_ADDR + SLOT_SIZE):
+        sys.exit('向量表不在运行区, 请检查工程的 IROM1 设置 (0x%08X/0x%08X)' % (sp, pc))
+    if len(app) > SLOT_SIZE:
+        sys.exit('固件 %d 字节, 超过运行区 %d 字节' % (len(app), SLOT_SIZE))
+    head = struct.pack('<IIII32s', MAGIC, len(app), zlib.crc32(app) & 0xFFFFFFFF, version,
+                       hashlib.sha256(app).digest())
+    head += struct.pack('<I', zlib.crc32(head) & 0xFFFFFFFF) + b'\xff' * 12
+    return head + app
+
+
+def upload(host, image):
+    conn = http.client.HTTPConnection(host, 80, timeout=10)
+
+    def request(method, query='', body=None):
+        conn.request(method, '/api/ota' + query, body, {'Content-Type': 'application/octet-stream'})
+        resp = conn.getresponse()
+        return resp.status, json.loads(resp.read() or b'{}')
+
+    status, st = request('POST', '?op=begin', image[:64])
+    if status != 200:
+        sys.exit('开始失败: %d %s' % (status, st))
+    data = image[64:]
+    pos = st['received']
+    if pos:
+        print('从 %d 字节继续' % pos)
+    while pos < len(data):
+        status, st = request('POST', '?offset=%d' % pos, data[pos:pos + CHUNK])
+        if status not in (200, 409):
+            sys.exit('写入失败: %d %s' % (status, st))
+        pos = st['received']
+        print('\r%d/%d' % (pos, len(data)), end='')
+    print()
+    while st['phase'] == 'verifying':
+        time.sleep(0.5)
+        status, st = request('GET')
+    print(st)
+    if st['phase'] != 'ready':
+        sys.exit(1)
+
+
+def main():
+    ap = argparse.ArgumentParser()
+    ap.add_argument('bin')
+    ap.add_argument('version', type=int)
+    ap.add_argument('-o', '--output')
+    ap.add_argument('--upload', metavar='HOST')
+    args = ap.parse_args()
+
+    image = make_image(open(args.bin, 'rb').read(), args.version)
+    out = args.output or args.bin.rsplit('.', 1)[0] + '.ota'
+    open(out, 'wb').write(image)
+    print('%s: %d 字节, 版本 %d' % (out, len(image), args.version))
+    if args.upload:
+        upload(args.upload, image)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,563 @@
+/**
+  ******************************************************************************
+  * @file    ota.c
+  * @brief   Over-the-Air Firmware Update (Staging, Verification, Trial Confirm)
+  ******************************************************************************
+  * @description
+  * 暂存区按顺序写入: 每页第一个字节到达时擦除该页, 奇数偏移的字节与前一字节组成半字编程,
+  * 页写满后写状态页的 page_done, 所以断电后已记录的页都是完整的。
+  * Flash 擦写期间 CPU 取指暂停 (单 bank), 每页擦除约 20ms。
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "ota.h"
+#include "sha256.h"
+#include "tftp.h"
+#include "flash_if.h"
+#include "wiz_supervisor.h"
+#include "uplink.h"
+#include "task_wdg.h"
+#include "event_log.h"
+#include "cmsis_os.h"
+#include "stm32f1xx.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define OTA_TFTP_POLLS          10      /* 每次 OTA_Poll 最多处理的 TFTP 报文 (间隔 1ms) */
+
+/* Private variables ---------------------------------------------------------*/
+static const OTA_State_t *const ota_state = (const OTA_State_t *)OTA_STATE_ADDR;
+
+static volatile uint8_t ota_busy = 0;
+static OTA_Phase_t phase = OTA_PHASE_IDLE;
+static OTA_ImageHeader_t image;         /* 正在接收的固件 */
+static uint32_t received = 0;
+static uint8_t carry = 0;               /* 偶数偏移的字节, 等下一字节组成半字 */
+static uint8_t trial = 0;
+static uint8_t reverted = 0;
+static const char *error = NULL;
+static uint16_t seq = 0;
+
+static uint32_t verify_pos = 0;
+static uint32_t verify_crc = 0;
+static SHA256_Ctx_t verify_sha;
+static uint32_t ready_tick = 0;
+static uint32_t trial_fail_tick = 0;    /* 试运行检查超时的时间, 0 表示未超时 */
+
+static volatile uint8_t tftp_request = 0;
+static volatile uint8_t tftp_cancel = 0;
+static uint8_t tftp_active = 0;
+static int8_t tftp_result = OTA_OK;     /* save_data 中写入失败的原因 */
+static uint8_t tftp_server[4];
+static char tftp_file[OTA_TFTP_FILE_MAX];
+static uint8_t tftp_buf[TFTP_RCV_BUF_SIZE];
+static uint8_t tftp_header[sizeof(OTA_ImageHeader_t)];
+static uint16_t tftp_header_len = 0;
+static uint32_t tftp_offset = 0;        /* 已收到的固件字节 (不含文件头) */
+static uint32_t tftp_tick = 0;
+
+static const char *const phase_name[] = {
+    "idle", "receiving", "verifying", "ready", "failed"
+};
+
+/* Private functions ---------------------------------------------------------*/
+
+static uint8_t OTA_Lock(void)
+{
+    uint32_t primask = __get_PRIMASK();
+    uint8_t ok;
+
+    __disable_irq();
+    ok = !ota_busy;
+    ota_busy = 1;
+    if (!primask)
+        __enable_irq();
+    return ok;
+}
+
+static void OTA_Unlock(void)
+{
+    ota_busy = 0;
+}
+
+static uint8_t OTA_SetFlag(const uint16_t *flag)
+{
+    return Flash_Program16((uint32_t)flag, OTA_FLAG_SET);
+}
+
+static uint8_t OTA_HeaderValid(const OTA_ImageHeader_t *hdr)
+{
+    return hdr->magic == OTA_IMAGE_MAGIC && hdr->size >= 8 && hdr->size <= OTA_SLOT_SIZE &&
+           hdr->header_crc == OTA_Crc32(0, (const uint8_t *)hdr, offsetof(OTA_ImageHeader_t, header_crc));
+}
+
+static void OTA_Fail(const char *reason)
+{
+    EVENT_LOG2(OTA_FAILED, EventLog_Tag(reason), received);
+    phase = OTA_PHASE_FAILED;
+    error = reason;
+    seq++;
+}
+
+/* 传输出错, 已写入的部分保留, 可以继续 */
+static void OTA_SetError(const char *reason)
+{
+    error = reason;
+    seq++;
+}
+
+static void OTA_StartVerify(void)
+{
+    phase = OTA_PHASE_VERIFYING;
+    verify_pos = 0;
+    verify_crc = 0;
+    SHA256_Init(&verify_sha);
+    seq++;
+}
+
+/**
+ * @brief  开始接收 (调用者已检查文件头)
+ */
+static int8_t OTA_BeginImage(const OTA_ImageHeader_t *hdr)
+{
+    const uint16_t *src = (const uint16_t *)hdr;
+    uint16_t i;
+    int8_t ret = OTA_OK;
+
+    if (!OTA_Lock())
+        return OTA_ERR_BUSY;
+
+    if (trial)
+        ret = OTA_ERR_STATE;
+    else if (phase != OTA_PHASE_IDLE && phase != OTA_PHASE_FAILED &&
+             memcmp(hdr, &image, sizeof(image)) == 0)
+        ret = OTA_OK;   /* 同一固件: 继续下载 / 已在校验 */
+    else if (phase == OTA_PHASE_VERIFYING || phase == OTA_PHASE_READY)
+        ret = OTA_ERR_STATE;
+    else
+    {
+        Flash_Acquire();
+        if (!Flash_ErasePage(OTA_STATE_ADDR))
+            ret = OTA_ERR_FLASH;
+        for (i = 0; ret == OTA_OK && i < sizeof(*hdr) / 2; i++)
+        {
+            if (!Flash_Program16(OTA_STATE_ADDR + i * 2, src[i]))
+                ret = OTA_ERR_FLASH;
+        }
+        Flash_Release();
+
+        image = *hdr;
+        received = 0;
+        reverted = 0;
+        if (ret == OTA_OK)
+        {
+            phase = OTA_PHASE_RECEIVING;
+            error = NULL;
+            seq++;
+            EVENT_LOG3(OTA_BEGIN, image.version, image.size, 0);
+        }
+        else
+            OTA_Fail("flash");
+    }
+
+    OTA_Unlock();
+    return ret;
+}
+
+/**
+ * @brief  写入固件数据
+ */
+static int8_t OTA_WriteData(uint32_t offset, const uint8_t *data, uint16_t len)
+{
+    uint32_t addr;
+    uint16_t i;
+    int8_t ret = OTA_OK;
+
+    if (!OTA_Lock())
+        return OTA_ERR_BUSY;
+
+    if (phase != OTA_PHASE_RECEIVING)
+        ret = OTA_ERR_STATE;
+    else if (offset != received || len > image.size - received)
+        ret = OTA_ERR_OFFSET;
+    else
+    {
+        Flash_Acquire();
+        for (i = 0; ret == OTA_OK && i < len; i++)
+        {
+            addr = OTA_STAGING_ADDR + received;
+            if ((received % OTA_PAGE_SIZE) == 0 && !Flash_ErasePage(addr))
+                ret = OTA_ERR_FLASH;
+            else if ((received & 1) == 0)
+                carry = data[i];
+            else if (!Flash_Program16(addr - 1, carry | ((uint16_t)data[i] << 8)))
+                ret = OTA_ERR_FLASH;
+
+            if (ret == OTA_OK && (++received % OTA_PAGE_SIZE) == 0)
+            {
+                if (!OTA_SetFlag(&ota_state->page_done[received / OTA_PAGE_SIZE - 1]))
+                    ret = OTA_ERR_FLASH;
+                seq++;
+            }
+        }
+
+        /* 收齐: 补齐最后一个半字, 记录最后一个不满的页 */
+        if (ret == OTA_OK && received == image.size)
+        {
+            if ((received & 1) && !Flash_Program16(OTA_STAGING_ADDR + received - 1, carry | 0xFF00))
+                ret = OTA_ERR_FLASH;
+            else if ((received % OTA_PAGE_SIZE) != 0 &&
+                     !OTA_SetFlag(&ota_state->page_done[received / OTA_PAGE_SIZE]))
+                ret = OTA_ERR_FLASH;
+            else
+                OTA_StartVerify();
+        }
+        Flash_Release();
+
+        if (ret == OTA_ERR_FLASH)
+            OTA_Fail("flash");
+    }
+
+    OTA_Unlock();
+    return ret;
+}
+
+/**
+ * @brief  校验一段暂存区, 全部完成后记录 ready
+ */
+static void OTA_VerifyStep(void)
+{
+    const uint8_t *base = (const uint8_t *)OTA_STAGING_ADDR;
+    const uint32_t *vectors = (const uint32_t *)OTA_STAGING_ADDR;
+    uint8_t digest[SHA256_DIGEST_SIZE];
+    uint32_t n;
+
+    if (!OTA_Lock())
+        return;
+
+    if (phase == OTA_PHASE_VERIFYING)
+    {
+        n = image.size - verify_pos;
+        if (n > OTA_VERIFY_CHUNK)
+            n = OTA_VERIFY_CHUNK;
+        verify_crc = OTA_Crc32(verify_crc, base + verify_pos, n);
+        SHA256_Update(&verify_sha, base + verify_pos, n);
+        verify_pos += n;
+
+        if (verify_pos == image.size)
+        {
+            SHA256_Final(&verify_sha, digest);
+
+            Flash_Acquire();
+            if (verify_crc != image.crc32)
+                OTA_Fail("crc");
+            else if (memcmp(digest, image.sha256, sizeof(digest)) != 0)
+                OTA_Fail("sha256");
+            else if (vectors[0] <= SRAM_BASE || vectors[0] > SRAM_BASE + 0x10000 ||
+                     vectors[1] < OTA_APP_ADDR || vectors[1] >= OTA_APP_ADDR + OTA_SLOT_SIZE)
+                OTA_Fail("vector");     /* 不是为运行区链接的固件 */
+            else if (!OTA_SetFlag(&ota_state->ready))
+                OTA_Fail("flash");
+            else
+            {
+                phase = OTA_PHASE_READY;
+                ready_tick = osKernelSysTick();
+                EVENT_LOG1(OTA_READY, image.version);
+                seq++;
+            }
+            if (phase == OTA_PHASE_FAILED)
+                Flash_ErasePage(OTA_STATE_ADDR);
+            Flash_Release();
+        }
+    }
+
+    OTA_Unlock();
+}
+
+/**
+ * @brief  TFTP 下载: 启动请求、超时计数、接收报文
+ */
+static void OTA_TftpPoll(void)
+{
+    uint32_t now = osKernelSysTick();
+    uint8_t i;
+    int ret = TFTP_PROGRESS;
+
+    if (tftp_request && !tftp_active)
+    {
+        tftp_request = 0;
+        tftp_cancel = 0;
+        if (wiz_supervisor_get_state() != WIZ_SUP_STATE_UP)
+        {
+            OTA_SetError("tftp: no link");
+            return;
+        }
+        error = NULL;
+        tftp_active = 1;
+        tftp_result = OTA_OK;
+        tftp_header_len = 0;
+        tftp_offset = 0;
+        tftp_tick = now;
+        seq++;
+        TFTP_init(OTA_TFTP_SOCK, tftp_buf);
+        TFTP_read_request(((uint32_t)tftp_server[0] << 24) | ((uint32_t)tftp_server[1] << 16) |
+                          ((uint32_t)tftp_server[2] << 8) | tftp_server[3], (uint8_t *)tftp_file);
+    }
+    if (!tftp_active)
+        return;
+
+    /* 重传超时按实测 RTT 调整, 以 TFTP_TICK_MS 为单位计时 */
+    while ((now - tftp_tick) >= TFTP_TICK_MS)
+    {
+        tftp_tick += TFTP_TICK_MS;
+        tftp_timeout_handler();
+    }
+    for (i = 0; i < OTA_TFTP_POLLS && ret == TFTP_PROGRESS && tftp_result == OTA_OK && !tftp_cancel; i++)
+    {
+        if (i > 0)
+            osDelay(1);
+        ret = TFTP_run();
+    }
+    if (ret == TFTP_PROGRESS && tftp_result == OTA_OK && !tftp_cancel)
+        return;
+
+    TFTP_exit();
+    tftp_active = 0;
+    seq++;
+    if (tftp_cancel)
+        return;
+    if (tftp_result == OTA_ERR_HEADER)
+        OTA_SetError("tftp: bad header");
+    else if (tftp_result != OTA_OK)
+    {
+        if (phase != OTA_PHASE_FAILED)
+            OTA_SetError("tftp: write");
+    }
+    else if (ret == TFTP_FAIL)
+        OTA_SetError("tftp");
+    else if (phase == OTA_PHASE_RECEIVING || tftp_header_len < sizeof(tftp_header))
+        OTA_SetError("tftp: short file");
+}
+
+/**
+ * @brief  试运行检查: 运行满 OTA_CONFIRM_S 秒、有可用的上行链路且任务都按时报到时确认,
+ *         OTA_TRIAL_MAX_S 秒内未通过时记录原因并准备复位
+ */
+static void OTA_TrialCheck(void)
+{
+    uint32_t uptime_s = osKernelSysTick() / 1000;
+    uint8_t uplink, tasks;
+
+    if (uptime_s < OTA_CONFIRM_S)
+        return;
+
+    uplink = wiz_supervisor_get_state() == WIZ_SUP_STATE_UP || Uplink_Router_GetActive() != UPLINK_NONE;
+    tasks = TaskWdg_AllAlive();
+    if (uplink && tasks)
+    {
+        if (!OTA_Lock())
+            return;
+        Flash_Acquire();
+        if (OTA_SetFlag(&ota_state->confirmed))
+        {
+            trial = 0;
+            seq++;
+            EVENT_LOG1(OTA_CONFIRMED, uptime_s);
+        }
+        Flash_Release();
+        OTA_Unlock();
+    }
+    else if (uptime_s >= OTA_TRIAL_MAX_S)
+    {
+        EVENT_LOG3(OTA_TRIAL_FAILED, uptime_s, uplink, tasks);
+        /* 非 0 且不晚于当前时刻, 否则 OTA_Poll 的差值回绕会立即复位 */
+        trial_fail_tick = (osKernelSysTick() - 1) | 1;
+    }
+}
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief  TFTP 数据块回调 (tftp.c F_STORAGE): 前 64 字节为文件头, 之后为固件;
+ *         继续上次的下载时跳过已写入的部分
+ */
+void save_data(uint8_t *data, uint32_t data_len, uint16_t block_number)
+{
+    OTA_ImageHeader_t hdr;
+    uint32_t n, skip;
+
+    (void)block_number;
+    if (!tftp_active || tftp_result != OTA_OK)
+        return;
+
+    if (tftp_header_len < sizeof(tftp_header))
+    {
+        n = sizeof(tftp_header) - tftp_header_len;
+        if (n > data_len)
+            n = data_len;
+        memcpy(tftp_header + tftp_header_len, data, n);
+        tftp_header_len += (uint16_t)n;
+        data += n;
+        data_len -= n;
+        if (tftp_header_len < sizeof(tftp_header))
+            return;
+        memcpy(&hdr, tftp_header, sizeof(hdr));
+        tftp_result = OTA_HeaderValid(&hdr) ? OTA_BeginImage(&hdr) : OTA_ERR_HEADER;
+        if (tftp_result != OTA_OK)
+            return;
+    }
+
+    /* 文件中多余的部分忽略 */
+    if (tftp_offset >= image.size)
+        return;
+    if (data_len > image.size - tftp_offset)
+        data_len = image.size - tftp_offset;
+
+    skip = (received > tftp_offset) ? received - tftp_offset : 0;
+    if (skip < data_len && phase == OTA_PHASE_RECEIVING)
+        tftp_result = OTA_WriteData(received, data + skip, (uint16_t)(data_len - skip));
+    tftp_offset += data_len;
+}
+
+void OTA_Init(void)
+{
+    uint16_t pages = 0;
+
+    if (!OTA_HeaderValid(&ota_state->image))
+        return;
+
+    trial = ota_state->trial == OTA_FLAG_SET && ota_state->confirmed != OTA_FLAG_SET &&
+            ota_state->reverted != OTA_FLAG_SET;
+    reverted = ota_state->reverted == OTA_FLAG_SET;
+    if (ota_state->ready == OTA_FLAG_SET)
+        return;
+
+    /* 断电前未完成的下载, 从最后一个完整的页之后继续 */
+    image = ota_state->image;
+    while (pages < OTA_SLOT_PAGES && ota_state->page_done[pages] == OTA_FLAG_SET)
+        pages++;
+    received = (uint32_t)pages * OTA_PAGE_SIZE;
+    if (received >= image.size)
+    {
+        received = image.size;
+        OTA_StartVerify();
+    }
+    else
+        phase = OTA_PHASE_RECEIVING;
+    EVENT_LOG3(OTA_BEGIN, image.version, image.size, received);
+}
+
+void OTA_Poll(void)
+{
+    if (trial && trial_fail_tick == 0)
+        OTA_TrialCheck();
+
+    /* 留出时间把事件写入日志再复位 */
+    if (trial_fail_tick != 0 && (osKernelSysTick() - trial_fail_tick) >= OTA_RESET_DELAY_MS)
+        NVIC_SystemReset();
+
+    if (phase == OTA_PHASE_VERIFYING)
+        OTA_VerifyStep();
+    else if (phase == OTA_PHASE_READY && (osKernelSysTick() - ready_tick) >= OTA_RESET_DELAY_MS)
+        NVIC_SystemReset();
+
+    OTA_TftpPoll();
+}
+
+int8_t OTA_Begin(const uint8_t *header, uint16_t len)
+{
+    OTA_ImageHeader_t hdr;
+
+    if (len < sizeof(hdr))
+        return OTA_ERR_HEADER;
+    memcpy(&hdr, header, sizeof(hdr));
+    if (!OTA_HeaderValid(&hdr))
+        return OTA_ERR_HEADER;
+    if (tftp_request || tftp_active)
+        return OTA_ERR_BUSY;
+    return OTA_BeginImage(&hdr);
+}
+
+int8_t OTA_Write(uint32_t offset, const uint8_t *data, uint16_t len)
+{
+    if (tftp_request || tftp_active)
+        return OTA_ERR_BUSY;
+    return OTA_WriteData(offset, data, len);
+}
+
+int8_t OTA_Abort(void)
+{
+    tftp_request = 0;
+    tftp_cancel = 1;
+
+    if (!OTA_Lock())
+        return OTA_ERR_BUSY;
+    if (phase != OTA_PHASE_IDLE)
+    {
+        Flash_Acquire();
+        Flash_ErasePage(OTA_STATE_ADDR);
+        Flash_Release();
+        phase = OTA_PHASE_IDLE;
+        error = NULL;
+        seq++;
+    }
+    OTA_Unlock();
+    return OTA_OK;
+}
+
+int8_t OTA_TftpStart(const uint8_t server[4], const char *file)
+{
+    if (strlen(file) >= sizeof(tftp_file))
+        return OTA_ERR_HEADER;
+    if (tftp_request || tftp_active)
+        return OTA_ERR_BUSY;
+    if (trial || phase == OTA_PHASE_VERIFYING || phase == OTA_PHASE_READY)
+        return OTA_ERR_STATE;
+
+    memcpy(tftp_server, server, sizeof(tftp_server));
+    strcpy(tftp_file, file);
+    tftp_request = 1;
+    return OTA_OK;
+}
+
+uint8_t OTA_TftpActive(void)
+{
+    return tftp_request || tftp_active;
+}
+
+void OTA_GetStatus(OTA_Status_t *status)
+{
+    status->phase = phase;
+    status->version = image.version;
+    status->size = image.size;
+    status->received = received;
+    status->trial = trial;
+    status->reverted = reverted;
+    status->tftp = OTA_TftpActive();
+    TFTP_get_transfer_info(&status->tftp_blksize, &status->tftp_window, &status->tftp_rto_ms);
+    status->error = error;
+    status->seq = seq;
+}
+
+uint16_t OTA_StatusJson(char *buf, uint16_t size)
+{
+    OTA_Status_t st;
+    int n;
+
+    OTA_GetStatus(&st);
+    n = snprintf(buf, size,
+                 "{\"phase\":\"%s\",\"version\":%lu,\"size\":%lu,\"received\":%lu,"
+                 "\"trial\":%u,\"reverted\":%u,\"tftp\":%u,\"blksize\":%u,\"window\":%u,\"rto\":%u,"
+                 "\"error\":%s%s%s}\n",
+                 phase_name[st.phase], (unsigned long)st.version, (unsigned long)st.size,
+                 (unsigned long)st.received, (unsigned)st.trial, (unsigned)st.reverted,
+                 (unsigned)st.tftp, (unsigned)st.tftp_blksize, (unsigned)st.tftp_window,
+                 (unsigned)st.tftp_rto_ms, st.error ? "\"" : "", st.error ? st.error : "null",
+                 st.error ? "\"" : "");
+    if (n < 0 || n >= size)
+        return 0;
+    return (uint16_t)n;
+}
@@ -0,0 +1,133 @@
+/**
+  ******************************************************************************
+  * @file    ota.h
+  * @brief   Over-the-Air Firmware Update (Staging, Verification, Trial Confirm) Header
+  ******************************************************************************
+  * @description
+  * 新固件 (gen_ota_image.py 生成: 64 字节文件头 + .bin) 按顺序写入暂存区 (ota_image.h):
+  * - 下载来源: HTTP POST /api/ota, MQTT smartcap/<id>/ota 主题, 或由设备发起的 TFTP 读请求
+  *   (请求 blksize/windowsize 选项, 服务器支持时按窗口连续传输, 重传超时按实测 RTT 调整)
+  * - 数据直接按半字写入 Flash, 每写满一页在状态页记录一次; 断电/断线后用同一文件头重新开始,
+  *   从已记录的最后一页之后继续 (OTA_GetStatus 的 received 为下一次应写的偏移)
+  * - 写完后在默认任务中分段计算 CRC-32 和 SHA-256, 与文件头比较, 通过后记录 ready 并复位,
+  *   由引导程序交换运行区和暂存区
+  * - 新固件首次运行为试运行, 运行 OTA_CONFIRM_S 秒后检查: 以太网已连通或上行路由有可用链路,
+  *   并且透传任务都按时报到 (task_wdg.h), 通过后确认; OTA_TRIAL_MAX_S 秒内始终未通过时复位。
+  *   确认前复位 (包括看门狗复位) 时引导程序换回旧固件。试运行时引导程序在跳转前就启动了独立看门狗,
+  *   应用初始化期间同样由 TaskWdg_Poll 在所有任务正常时喂狗
+  * 写入来自 HTTP/MQTT/默认任务, 同一时刻只允许一个调用者操作 Flash, 其它调用返回 OTA_ERR_BUSY。
+  ******************************************************************************
+  */
+
+#ifndef __OTA_H__
+#define __OTA_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include "ota_image.h"
+
+/* Exported defines ----------------------------------------------------------*/
+#define OTA_ENABLE              1       /* 1=启用固件升级 */
+
+#define OTA_VERIFY_CHUNK        4096    /* 每次 OTA_Poll 校验的字节数 */
+#define OTA_RESET_DELAY_MS      2000    /* 校验通过后等待状态应答发出再复位 */
+#define OTA_CONFIRM_S           60      /* 新固件至少运行该时间, 检查通过后确认 */
+#define OTA_TRIAL_MAX_S         600     /* 该时间内检查始终未通过时复位, 换回旧固件 */
+
+#define OTA_TFTP_SOCK           5       /* 与 SNTP (TIME_SYNC_SNTP_SOCK) 共用, 下载期间暂停校时 */
+#define OTA_TFTP_FILE_MAX       48      /* 文件名长度上限 (含结束符, 同 tftp.h FILE_NAME_SIZE) */
+
+/* 返回值 */
+#define OTA_OK                  0
+#define OTA_ERR_BUSY            (-1)    /* 另一个来源正在写入 / TFTP 下载中 */
+#define OTA_ERR_HEADER          (-2)    /* 文件头无效或固件太大 */
+#define OTA_ERR_OFFSET          (-3)    /* 偏移不等于 received */
+#define OTA_ERR_STATE           (-4)    /* 当前阶段不允许该操作 (未开始/校验中/试运行未确认) */
+#define OTA_ERR_FLASH           (-5)    /* Flash 擦写失败 */
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum {
+    OTA_PHASE_IDLE = 0,
+    OTA_PHASE_RECEIVING,                /* 等待数据 */
+    OTA_PHASE_VERIFYING,                /* 已收齐, 校验中 */
+    OTA_PHASE_READY,                    /* 校验通过, 即将复位安装 */
+    OTA_PHASE_FAILED                    /* 校验或擦写失败, 需重新开始 */
+} OTA_Phase_t;
+
+typedef struct {
+    OTA_Phase_t phase;
+    uint32_t version;                   /* 正在接收的固件版本 */
+    uint32_t size;
+    uint32_t received;                  /* 已写入的字节数, 即下一次写入的偏移 */
+    uint8_t trial;                      /* 1: 正在试运行新固件, 尚未确认 */
+    uint8_t reverted;                   /* 1: 上一次升级已回滚 */
+    uint8_t tftp;                       /* 1: TFTP 下载中 */
+    uint16_t tftp_blksize;              /* TFTP 协商结果: 块大小, 窗口 (块数), 当前重传超时 (ms) */
+    uint16_t tftp_window;
+    uint16_t tftp_rto_ms;
+    const char *error;                  /* 最近一次失败的原因, 没有时为 NULL */
+    uint16_t seq;                       /* 阶段变化或提交一页时加 1, 用于判断是否需要上报 */
+} OTA_Status_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief  读取状态页, 恢复未完成的下载和试运行状态, 在调度器启动后调用一次
+ */
+void OTA_Init(void);
+
+/**
+ * @brief  校验、TFTP 下载、试运行确认, 由默认任务周期调用
+ */
+void OTA_Poll(void);
+
+/**
+ * @brief  开始接收固件, 与状态页中的文件头相同时继续上次的下载
+ * @param  header: 文件头 (OTA_ImageHeader_t, 64 字节)
+ * @param  len:    长度
+ * @retval OTA_OK 或 OTA_ERR_*, 成功后从 OTA_GetStatus 的 received 开始发送
+ */
+int8_t OTA_Begin(const uint8_t *header, uint16_t len);
+
+/**
+ * @brief  写入固件数据, 收齐后自动开始校验
+ * @param  offset: 在固件中的偏移 (不含文件头), 必须等于 received
+ */
+int8_t OTA_Write(uint32_t offset, const uint8_t *data, uint16_t len);
+
+/**
+ * @brief  放弃当前下载或 TFTP 下载 (试运行状态不受影响)
+ * @retval OTA_OK 或 OTA_ERR_BUSY (正在写入, 稍后重试)
+ */
+int8_t OTA_Abort(void);
+
+/**
+ * @brief  由默认任务通过 TFTP 下载固件 (文件内容为 gen_ota_image.py 的输出)
+ * @param  server: TFTP 服务器地址
+ * @param  file:   文件名
+ * @retval OTA_OK 或 OTA_ERR_*
+ */
+int8_t OTA_TftpStart(const uint8_t server[4], const char *file);
+
+/**
+ * @brief  TFTP 下载中 (此时 SNTP socket 被占用)
+ */
+uint8_t OTA_TftpActive(void);
+
+void OTA_GetStatus(OTA_Status_t *status);
+
+/**
+ * @brief  生成状态 JSON (HTTP 应答和 MQTT ota/status 共用)
+ * @retval JSON 长度, 缓冲区不足时为 0
+ */
+uint16_t OTA_StatusJson(char *buf, uint16_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __OTA_H__ */
@@ -0,0 +1,97 @@
+/**
+  ******************************************************************************
+  * @file    ota_image.h
+  * @brief   OTA Flash Layout, Image Header and State Page (shared with Bootloader)
+  ******************************************************************************
+  * @description
+  * 片内 Flash 512KB (256 页 x 2KB) 划分:
+  *   0x08000000  16KB   引导程序 (Bootloader/boot_main.c)
+  *   0x08004000  224KB  运行区 A: 应用在此运行, 工程 IROM1 起始地址
+  *   0x0803C000  224KB  暂存区 B: 下载的新固件
+  *   0x08074000  2KB    交换用临时页
+  *   0x08074800  2KB    OTA 状态页 (OTA_State_t)
+  *   0x08075000  42KB   文件系统 (fs/flash_fs.h)
+  *   0x0807F800  2KB    DHCP 租约 (wiz_platform.h)
+  *
+  * 状态页的每个标志/进度项是一个半字, 擦除后为 0xFFFF, 完成时写 0x0000,
+  * 每项只写一次, 断电后按已写的项继续。引导程序按页交换 A/B (A->临时页, B->A, 临时页->B),
+  * 交换后 B 中是旧固件, 回滚即再交换一次。
+  ******************************************************************************
+  */
+
+#ifndef __OTA_IMAGE_H__
+#define __OTA_IMAGE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported defines ----------------------------------------------------------*/
+#define OTA_PAGE_SIZE           2048
+#define OTA_BOOT_ADDR           0x08000000UL
+#define OTA_BOOT_SIZE           0x4000UL
+#define OTA_APP_ADDR            (OTA_BOOT_ADDR + OTA_BOOT_SIZE)         /* 运行区 A */
+#define OTA_SLOT_SIZE           0x38000UL
+#define OTA_SLOT_PAGES          (OTA_SLOT_SIZE / OTA_PAGE_SIZE)         /* 112 */
+#define OTA_STAGING_ADDR        (OTA_APP_ADDR + OTA_SLOT_SIZE)          /* 暂存区 B */
+#define OTA_SCRATCH_ADDR        (OTA_STAGING_ADDR + OTA_SLOT_SIZE)
+#define OTA_STATE_ADDR          (OTA_SCRATCH_ADDR + OTA_PAGE_SIZE)
+
+#define OTA_IMAGE_MAGIC         0x41544F53UL    /* "SOTA" */
+#define OTA_FLAG_SET            0x0000          /* 已写的标志/进度项 */
+#define OTA_FLAG_CLEAR          0xFFFF
+
+/* Exported types ------------------------------------------------------------*/
+
+/* 固件文件头 (64 字节, gen_ota_image.py 加在 .bin 之前), 所有字段小端 */
+typedef struct {
+    uint32_t magic;                     /* OTA_IMAGE_MAGIC */
+    uint32_t size;                      /* 固件字节数 (不含文件头) */
+    uint32_t crc32;                     /* 固件的 CRC-32 (IEEE 802.3) */
+    uint32_t version;
+    uint8_t  sha256[32];                /* 固件的 SHA-256 */
+    uint32_t header_crc;                /* 以上字段的 CRC-32 */
+    uint8_t  reserved[12];              /* 0xFF */
+} OTA_ImageHeader_t;
+
+/* 状态页, 新的下载开始时擦除 */
+typedef struct {
+    OTA_ImageHeader_t image;                        /* 暂存区中的固件 */
+    uint16_t page_done[OTA_SLOT_PAGES];             /* 暂存区第 i 页已写完 (按顺序) */
+    uint16_t ready;                                 /* 校验通过, 请求引导程序安装 */
+    uint16_t swap_pages;                            /* 交换的页数 (引导程序开始交换前写入, 非标志) */
+    uint16_t install_step[OTA_SLOT_PAGES * 3];      /* 安装交换进度: 第 i 页的 3 步 */
+    uint16_t trial;                                 /* 新固件已试运行 (引导程序跳转前写) */
+    uint16_t confirmed;                             /* 新固件运行正常 (应用写) */
+    uint16_t revert_step[OTA_SLOT_PAGES * 3];       /* 回滚交换进度 */
+    uint16_t reverted;                              /* 已回滚到旧固件 */
+} OTA_State_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief  CRC-32 (IEEE 802.3, 反射, 初值/结果异或 0xFFFFFFFF), 按字节计算, 分段调用时传入上次结果
+ * @param  crc:  上次结果, 第一段为 0
+ */
+static __inline uint32_t OTA_Crc32(uint32_t crc, const uint8_t *data, uint32_t len)
+{
+    uint8_t bit;
+
+    crc = ~crc;
+    while (len--)
+    {
+        crc ^= *data++;
+        for (bit = 0; bit < 8; bit++)
+            crc = (crc >> 1) ^ (0xEDB88320UL & (0UL - (crc & 1)));
+    }
+    return ~crc;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __OTA_IMAGE_H__ */
@@ -0,0 +1,121 @@
+/**
+  ******************************************************************************
+  * @file    sha256.c
+  * @brief   SHA-256 Message Digest (FIPS 180-4)
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "sha256.h"
+#include <string.h>
+
+/* Private macros ------------------------------------------------------------*/
+#define ROR(x, n)   (((x) >> (n)) | ((x) << (32 - (n))))
+
+/* Private variables ---------------------------------------------------------*/
+static const uint32_t k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+/* Private functions ---------------------------------------------------------*/
+
+/* 处理一个 64 字节块, 消息扩展用 16 字的循环缓冲 */
+static void sha256_block(uint32_t *state, const uint8_t *p)
+{
+    uint32_t w[16];
+    uint32_t a, b, c, d, e, f, g, h, t1, t2;
+    uint8_t i;
+
+    for (i = 0; i < 16; i++)
+        w[i] = ((uint32_t)p[i * 4] << 24) | ((uint32_t)p[i * 4 + 1] << 16) |
+               ((uint32_t)p[i * 4 + 2] << 8) | p[i * 4 + 3];
+
+    a = state[0]; b = state[1]; c = state[2]; d = state[3];
+    e = state[4]; f = state[5]; g = state[6]; h = state[7];
+
+    for (i = 0; i < 64; i++)
+    {
+        if (i >= 16)
+        {
+            uint32_t w15 = w[(i + 1) & 15], w2 = w[(i + 14) & 15];
+            w[i & 15] += (ROR(w15, 7) ^ ROR(w15, 18) ^ (w15 >> 3)) + w[(i + 9) & 15] +
+                         (ROR(w2, 17) ^ ROR(w2, 19) ^ (w2 >> 10));
+        }
+        t1 = h + (ROR(e, 6) ^ ROR(e, 11) ^ ROR(e, 25)) + ((e & f) ^ (~e & g)) + k[i] + w[i & 15];
+        t2 = (ROR(a, 2) ^ ROR(a, 13) ^ ROR(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+
+    state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+    state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+/* Exported functions --------------------------------------------------------*/
+
+void SHA256_Init(SHA256_Ctx_t *ctx)
+{
+    ctx->state[0] = 0x6a09e667; ctx->state[1] = 0xbb67ae85;
+    ctx->state[2] = 0x3c6ef372; ctx->state[3] = 0xa54ff53a;
+    ctx->state[4] = 0x510e527f; ctx->state[5] = 0x9b05688c;
+    ctx->state[6] = 0x1f83d9ab; ctx->state[7] = 0x5be0cd19;
+    ctx->count = 0;
+}
+
+void SHA256_Update(SHA256_Ctx_t *ctx, const uint8_t *data, uint32_t len)
+{
+    uint32_t used = ctx->count & 63;
+
+    ctx->count += len;
+    if (used)
+    {
+        uint32_t n = 64 - used;
+        if (n > len)
+            n = len;
+        memcpy(ctx->block + used, data, n);
+        data += n;
+        len -= n;
+        if (used + n < 64)
+            return;
+        sha256_block(ctx->state, ctx->block);
+    }
+    while (len >= 64)
+    {
+        sha256_block(ctx->state, data);
+        data += 64;
+        len -= 64;
+    }
+    memcpy(ctx->block, data, len);
+}
+
+void SHA256_Final(SHA256_Ctx_t *ctx, uint8_t digest[SHA256_DIGEST_SIZE])
+{
+    uint32_t used = ctx->count & 63;
+    uint32_t bits_hi = ctx->count >> 29, bits_lo = ctx->count << 3;
+    uint8_t i;
+
+    ctx->block[used++] = 0x80;
+    if (used > 56)
+    {
+        memset(ctx->block + used, 0, 64 - used);
+        sha256_block(ctx->state, ctx->block);
+        used = 0;
+    }
+    memset(ctx->block + used, 0, 56 - used);
+    for (i = 0; i < 4; i++)
+    {
+        ctx->block[56 + i] = (uint8_t)(bits_hi >> (24 - i * 8));
+        ctx->block[60 + i] = (uint8_t)(bits_lo >> (24 - i * 8));
+    }
+    sha256_block(ctx->state, ctx->block);
+
+    for (i = 0; i < 32; i++)
+        digest[i] = (uint8_t)(ctx->state[i >> 2] >> (24 - (i & 3) * 8));
+}
@@ -0,0 +1,40 @@
+/**
+  ******************************************************************************
+  * @file    sha256.h
+  * @brief   SHA-256 Message Digest (FIPS 180-4) Header
+  ******************************************************************************
+  * @description
+  * 用于 OTA 固件校验, 可分段输入, 上下文约 108 字节 (不使用堆)
+  ******************************************************************************
+  */
+
+#ifndef __SHA256_H__
+#define __SHA256_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported defines ----------------------------------------------------------*/
+#define SHA256_DIGEST_SIZE  32
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct {
+    uint32_t state[8];
+    uint32_t count;             /* 已输入的字节数 (固件不超过 4GB) */
+    uint8_t  block[64];         /* 未满一块的输入 */
+} SHA256_Ctx_t;
+
+/* Exported functions --------------------------------------------------------*/
+void SHA256_Init(SHA256_Ctx_t *ctx);
+void SHA256_Update(SHA256_Ctx_t *ctx, const uint8_t *data, uint32_t len);
+void SHA256_Final(SHA256_Ctx_t *ctx, uint8_t digest[SHA256_DIGEST_SIZE]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SHA256_H__ */
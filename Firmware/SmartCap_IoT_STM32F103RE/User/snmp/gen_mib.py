@@ -0,0 +1,176 @@
+#!/usr/bin/env python3
+"""
+生成 snmp_mib.c / snmp_mib.h: 把 mib.def 中声明的对象按 OID 排序后生成 snmpData[] 表。
+
+用法: python gen_mib.py           修改 mib.def 后运行, 生成结果提交到仓库
+      python gen_mib.py --check   只比较, 生成结果与仓库中的文件不同时返回 1 (主机测试使用)
+
+snmp.c 中的 findEntry/findNextEntry 对该表做二分查找, 表必须按 OID (逐个子标识符) 升序排列。
+"""
+import os
+import re
+import sys
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+SRC = os.path.join(HERE, 'mib.def')
+OUT_C = os.path.join(HERE, 'snmp_mib.c')
+OUT_H = os.path.join(HERE, 'snmp_mib.h')
+
+MAX_OID = 12        # snmp.h
+MAX_STRING = 32     # snmp.h, 含结尾 '\0'
+
+TYPES = {
+    'integer': 'SNMPDTYPE_INTEGER',
+    'string': 'SNMPDTYPE_OCTET_STRING',
+    'oid': 'SNMPDTYPE_OBJ_ID',
+    'counter': 'SNMPDTYPE_COUNTER',
+    'gauge': 'SNMPDTYPE_GAUGE',
+    'timeticks': 'SNMPDTYPE_TIME_TICKS',
+}
+
+
+def fail(lineno, msg):
+    sys.exit('mib.def:%d: %s' % (lineno, msg))
+
+
+def parse_oid(text, defines, lineno):
+    parts = text.split('.')
+    if parts[0] in defines:
+        arcs = defines[parts[0]] + [int(p) for p in parts[1:]]
+    else:
+        try:
+            arcs = [int(p) for p in parts]
+        except ValueError:
+            fail(lineno, 'unknown OID prefix "%s"' % parts[0])
+    if len(arcs) < 2 or arcs[0] > 2 or arcs[1] > 39:
+        fail(lineno, 'invalid OID %s' % text)
+    return arcs
+
+
+def encode_oid(arcs):
+    """BER 编码 (首字节为 40*X+Y)"""
+    out = []
+    for arc in [40 * arcs[0] + arcs[1]] + arcs[2:]:
+        enc = [arc & 0x7f]
+        arc >>= 7
+        while arc:
+            enc.insert(0, 0x80 | (arc & 0x7f))
+            arc >>= 7
+        out += enc
+    return out
+
+
+def c_bytes(data):
+    return ', '.join('0x%02x' % b for b in data)
+
+
+def main():
+    defines = {}
+    objects = []
+    for lineno, line in enumerate(open(SRC, encoding='utf-8'), 1):
+        line = line.strip()
+        if not line or line.startswith('#'):
+            continue
+        m = re.match(r'define\s+(\w+)\s+(\S+)$', line)
+        if m:
+            defines[m.group(1)] = parse_oid(m.group(2), defines, lineno)
+            continue
+        m = re.match(r'(\S+)\s+(\S+)\s+(\w+)\s+(.+)$', line)
+        if not m:
+            fail(lineno, 'syntax error')
+        name, oid, typ, value = m.groups()
+        if typ not in TYPES:
+            fail(lineno, 'unknown type "%s"' % typ)
+        arcs = parse_oid(oid, defines, lineno)
+        enc = encode_oid(arcs)
+        if len(enc) > MAX_OID:
+            fail(lineno, '%s is %d bytes encoded (MAX_OID %d)' % (oid, len(enc), MAX_OID))
+        objects.append((arcs, enc, name, typ, value.strip(), lineno))
+
+    objects.sort(key=lambda o: o[0])
+    for a, b in zip(objects, objects[1:]):
+        if b[0][:len(a[0])] == a[0]:
+            fail(b[5], '%s is equal to or below leaf %s' % (b[2], a[2]))
+
+    getters = []
+    entries = []
+    sys_object_id = None
+    for arcs, enc, name, typ, value, lineno in objects:
+        length, init, getter = 0, '""', 'NULL'
+        if value.startswith('"'):
+            if typ != 'string':
+                fail(lineno, 'string value for %s object' % typ)
+            text = value[1:-1]
+            if len(text.encode('utf-8')) >= MAX_STRING:
+                fail(lineno, 'string longer than %d bytes' % (MAX_STRING - 1))
+            length, init = len(text.encode('utf-8')), value
+        elif typ == 'oid':
+            val = encode_oid(parse_oid(value, defines, lineno))
+            if len(val) >= MAX_STRING:
+                fail(lineno, 'OID value too long')
+            length, init = len(val), '"' + ''.join('\\x%02x' % b for b in val) + '"'
+            if name == 'sysObjectID':
+                sys_object_id = val
+        elif re.match(r'-?\d+$', value):
+            length, init = 4, '.intval = %s' % value
+        else:
+            m = re.match(r'metric\((\w+)\)$', value)
+            if m:
+                getter = 'mib_%s' % re.sub(r'\W', '_', name)
+                getters.append('static void %s(void *ptr, uint8_t *len)\n{\n'
+                               '    *(uint32_t *)ptr = Metrics_GetSlot(%s);\n'
+                               '    *len = 4;\n}\n' % (getter, m.group(1)))
+            elif re.match(r'\w+$', value):
+                getter = value
+            else:
+                fail(lineno, 'bad value "%s"' % value)
+            length = 0 if typ in ('string', 'oid') else 4
+        entries.append('    /* %s (%s) */\n    {%d, {%s}, %s, %d, {%s}, %s, NULL},'
+                       % (name, '.'.join(str(a) for a in arcs), len(enc), c_bytes(enc),
+                          TYPES[typ], length, init, getter))
+
+    if sys_object_id is None:
+        sys.exit('mib.def: sysObjectID is required (trap enterprise)')
+
+    out = ['/* 由 gen_mib.py 根据 mib.def 生成, 不要手工修改 */',
+           '#include "snmp_mib.h"',
+           '#include "snmp_custom.h"',
+           '#include "snmp_agent.h"',
+           '#include "metrics.h"',
+           '']
+    out += getters
+    out.append('/* 按 OID 升序排列 */')
+    out.append('dataEntryType snmpData[] = {')
+    out += entries
+    out.append('};')
+    out.append('')
+    out.append('const int32_t maxData = sizeof(snmpData) / sizeof(snmpData[0]);')
+    out.append('')
+
+    hdr = ['/* 由 gen_mib.py 根据 mib.def 生成, 不要手工修改 */',
+           '#ifndef __SNMP_MIB_H__',
+           '#define __SNMP_MIB_H__',
+           '',
+           '#define SNMP_MIB_COUNT              %d' % len(entries),
+           '',
+           '/* sysObjectID, 也是 trap 的 enterprise 字段 (BER 编码) */',
+           '#define SNMP_MIB_SYSOBJECTID_LEN    %d' % len(sys_object_id),
+           '#define SNMP_MIB_SYSOBJECTID        %s' % c_bytes(sys_object_id),
+           '',
+           '#endif /* __SNMP_MIB_H__ */',
+           '']
+
+    for path, text in ((OUT_C, '\n'.join(out)), (OUT_H, '\n'.join(hdr))):
+        if '--check' in sys.argv[1:]:
+            try:
+                old = open(path, encoding='utf-8', newline='').read()
+            except OSError:
+                old = None
+            if old != text:
+                sys.exit('%s is out of date, run gen_mib.py' % os.path.basename(path))
+        else:
+            open(path, 'w', encoding='utf-8', newline='\n').write(text)
+
+
+if __name__ == '__main__':
+    main()
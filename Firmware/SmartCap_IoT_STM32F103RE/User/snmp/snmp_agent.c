@@ -0,0 +1,233 @@
+/**
+  ******************************************************************************
+  * @file    snmp_agent.c
+  * @brief   SNMP Agent for Gateway Statistics
+  ******************************************************************************
+  * @description
+  * 请求解析和应答由 ioLibrary snmp.c 完成 (snmpd_run 每次处理一个报文),
+  * 本文件提供 MIB 取值函数、链路状态跟踪和 trap 队列。
+  * 取值函数在默认任务中执行, 只读取各模块的状态/统计, 不阻塞。
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "snmp_agent.h"
+#include "snmp_mib.h"
+#include "snmp.h"
+#include "snmp_custom.h"
+#include "wiz_supervisor.h"
+#include "wiz_sockbuf.h"
+#include "wizchip_conf.h"
+#include "socket.h"
+#include "uplink.h"
+#include "rg200u.h"
+#include "time_sync.h"
+#include "mb_gateway.h"
+#include "metrics.h"
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define SNMP_IF_COUNT           2
+#define SNMP_IF_UP              1       /* ifOperStatus */
+#define SNMP_IF_DOWN            2
+
+/* Private types -------------------------------------------------------------*/
+typedef struct {
+    uint8_t generic;
+    uint8_t if_index;
+} SNMP_Trap_t;
+
+/* Private variables ---------------------------------------------------------*/
+static uint8_t trap_manager[4] = SNMP_TRAP_MANAGER_IP;
+static SNMP_Trap_t trap_queue[SNMP_TRAP_QUEUE_MAX];
+static uint8_t trap_head = 0;
+static uint8_t trap_count = 0;
+static uint8_t link_up[SNMP_IF_COUNT];      /* 按 ifIndex-1 */
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief  返回 32 位取值 (getEntry 按类型做 BER 编码)
+ */
+static void SNMP_Agent_Put(void *ptr, uint8_t *len, uint32_t value)
+{
+    *(uint32_t *)ptr = value;
+    *len = 4;
+}
+
+/**
+ * @brief  链路状态变化时产生 linkUp/linkDown trap
+ */
+static void SNMP_Agent_CheckLink(uint8_t if_index, uint8_t up)
+{
+    if (link_up[if_index - 1] == up)
+        return;
+    link_up[if_index - 1] = up;
+    SNMP_Agent_QueueTrap(up ? SNMPTRAP_LINKUP : SNMPTRAP_LINKDOWN, if_index);
+}
+
+/**
+ * @brief  发送队列中最早的一个 trap (sendto 等待发送完成, 最长为 ARP 超时)
+ */
+static void SNMP_Agent_SendTrap(void)
+{
+    static const uint8_t no_manager[4] = {0, 0, 0, 0};
+    dataEntryType enterprise = {SNMP_MIB_SYSOBJECTID_LEN, {SNMP_MIB_SYSOBJECTID},
+                                SNMPDTYPE_OBJ_ID, 0, {""}, NULL, NULL};
+    /* ifIndex.N (1.3.6.1.2.1.2.2.1.1.N) */
+    dataEntryType if_index = {10, {0x2b, 0x06, 0x01, 0x02, 0x01, 0x02, 0x02, 0x01, 0x01, 0x00},
+                              SNMPDTYPE_INTEGER, 4, {""}, NULL, NULL};
+    const SNMP_Trap_t *t;
+    wiz_NetInfo info;
+
+    if (trap_count == 0)
+        return;
+    if (memcmp(trap_manager, no_manager, 4) == 0)
+    {
+        trap_count = 0;
+        return;
+    }
+    if (getSn_SR(SNMP_AGENT_SOCK) != SOCK_UDP)
+        return;
+
+    wizchip_getnetinfo(&info);
+    t = &trap_queue[trap_head];
+    if (t->if_index)
+    {
+        if_index.oid[9] = t->if_index;
+        if_index.u.intval = t->if_index;
+        snmp_sendTrap(trap_manager, info.ip, (int8_t *)COMMUNITY, enterprise, t->generic, 0, 1, &if_index);
+    }
+    else
+    {
+        snmp_sendTrap(trap_manager, info.ip, (int8_t *)COMMUNITY, enterprise, t->generic, 0, 0);
+    }
+
+    /* 发送失败 (ARP 超时等) 也出队, 不反复阻塞默认任务 */
+    trap_head = (uint8_t)((trap_head + 1) % SNMP_TRAP_QUEUE_MAX);
+    trap_count--;
+}
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief  初始化代理
+ */
+void SNMP_Agent_Init(void)
+{
+    static uint8_t agent_ip[4] = {0, 0, 0, 0};     /* snmpd_init 不使用, trap 中填写当前地址 */
+
+    wiz_sockbuf_set_role(SNMP_AGENT_SOCK, WIZ_SOCK_ROLE_CONTROL);
+    snmpd_init(trap_manager, agent_ip, SNMP_AGENT_SOCK, SNMP_AGENT_SOCK);
+}
+
+/**
+ * @brief  处理请求, 检查链路状态并发送 trap
+ */
+void SNMP_Agent_Poll(void)
+{
+    SNMP_Agent_CheckLink(SNMP_IF_ETH, Uplink_EthTransport.ready());
+    SNMP_Agent_CheckLink(SNMP_IF_CELL, Uplink_CellTransport.ready());
+
+    /* 芯片恢复/等待地址期间不访问 socket */
+    if (wiz_supervisor_get_state() != WIZ_SUP_STATE_UP)
+        return;
+
+    snmpd_run();
+    SNMP_Agent_SendTrap();
+}
+
+/**
+ * @brief  把 trap 放入发送队列
+ */
+void SNMP_Agent_QueueTrap(uint8_t generic, uint8_t if_index)
+{
+    if (trap_count >= SNMP_TRAP_QUEUE_MAX)
+        return;
+    trap_queue[(trap_head + trap_count) % SNMP_TRAP_QUEUE_MAX].generic = generic;
+    trap_queue[(trap_head + trap_count) % SNMP_TRAP_QUEUE_MAX].if_index = if_index;
+    trap_count++;
+}
+
+/**
+ * @brief  sysUpTime (0.01 秒)
+ */
+void SNMP_Agent_GetUptime(void *ptr, uint8_t *len)
+{
+    SNMP_Agent_Put(ptr, len, (uint32_t)(TimeSync_MonotonicMs() / 10));
+}
+
+/**
+ * @brief  ifOperStatus.1: 以太网上行 TCP 连接
+ */
+void SNMP_Agent_GetEthOperStatus(void *ptr, uint8_t *len)
+{
+    SNMP_Agent_Put(ptr, len, link_up[SNMP_IF_ETH - 1] ? SNMP_IF_UP : SNMP_IF_DOWN);
+}
+
+/**
+ * @brief  ifOperStatus.2: 蜂窝 TCP 连接
+ */
+void SNMP_Agent_GetCellOperStatus(void *ptr, uint8_t *len)
+{
+    SNMP_Agent_Put(ptr, len, link_up[SNMP_IF_CELL - 1] ? SNMP_IF_UP : SNMP_IF_DOWN);
+}
+
+/**
+ * @brief  模块信号强度 (dBm), 未知时为 0
+ */
+void SNMP_Agent_GetModemRssi(void *ptr, uint8_t *len)
+{
+    uint32_t csq = Metrics_GetSlot(METRIC_MODEM_CSQ);
+
+    SNMP_Agent_Put(ptr, len, (csq <= 31) ? (uint32_t)(-113 + 2 * (int32_t)csq) : 0);
+}
+
+/**
+ * @brief  蜂窝 TCP 状态 (TCP_State_t)
+ */
+void SNMP_Agent_GetCellTcpState(void *ptr, uint8_t *len)
+{
+    SNMP_Agent_Put(ptr, len, RG200U_GetTCPState());
+}
+
+/**
+ * @brief  W5500 状态 (wiz_sup_state_t)
+ */
+void SNMP_Agent_GetEthState(void *ptr, uint8_t *len)
+{
+    SNMP_Agent_Put(ptr, len, wiz_supervisor_get_state());
+}
+
+/**
+ * @brief  切换到备用链路次数
+ */
+void SNMP_Agent_GetFailovers(void *ptr, uint8_t *len)
+{
+    Uplink_Stats_t up;
+
+    Uplink_Router_GetStats(&up);
+    SNMP_Agent_Put(ptr, len, up.failovers);
+}
+
+/**
+ * @brief  Modbus TCP 请求数
+ */
+void SNMP_Agent_GetMbRequests(void *ptr, uint8_t *len)
+{
+    MB_Gateway_Stats_t mb;
+
+    MB_Gateway_GetStats(&mb);
+    SNMP_Agent_Put(ptr, len, mb.requests);
+}
+
+/**
+ * @brief  Modbus 从站应答超时次数
+ */
+void SNMP_Agent_GetMbTimeouts(void *ptr, uint8_t *len)
+{
+    MB_Gateway_Stats_t mb;
+
+    MB_Gateway_GetStats(&mb);
+    SNMP_Agent_Put(ptr, len, mb.timeouts);
+}
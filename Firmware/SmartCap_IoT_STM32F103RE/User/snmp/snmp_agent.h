@@ -0,0 +1,72 @@
+/**
+  ******************************************************************************
+  * @file    snmp_agent.h
+  * @brief   SNMP Agent for Gateway Statistics Header
+  ******************************************************************************
+  * @description
+  * 基于 ioLibrary SNMP (v1, 团体名见 snmp_custom.h) 的代理:
+  * - MIB 在 mib.def 中声明, gen_mib.py 生成按 OID 排序的 snmp_mib.c,
+  *   GET/GETNEXT 在表中二分查找, snmpwalk 可从任意前缀开始遍历
+  * - 以太网/蜂窝上行链路 (ifIndex 1/2) 连接状态变化时发送 linkUp/linkDown trap,
+  *   启动后发送 coldStart trap; trap 在以太网可用时才发送, 之前的变化在队列中等待
+  * - 代理和 trap 共用一个 UDP socket (W5500 只有 8 个 socket), 由默认任务轮询
+  ******************************************************************************
+  */
+
+#ifndef __SNMP_AGENT_H__
+#define __SNMP_AGENT_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported defines ----------------------------------------------------------*/
+#define SNMP_AGENT_ENABLE       1       /* 1=启用 SNMP 代理 */
+
+#define SNMP_AGENT_SOCK         4       /* W5500 socket, Modbus TCP 因此只用 socket 2~3 */
+#define SNMP_AGENT_POLL_MS      20      /* 默认任务轮询间隔 */
+#define SNMP_TRAP_MANAGER_IP    {192, 168, 1, 100}  /* trap 接收端, 全 0 时不发送 trap */
+#define SNMP_TRAP_QUEUE_MAX     8       /* 等待发送的 trap, 满时丢弃新的 */
+
+/* trap 中的 ifIndex, 与 mib.def 中的 ifTable 一致 */
+#define SNMP_IF_ETH             1
+#define SNMP_IF_CELL            2
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief  初始化代理, 在 W5500 初始化之前调用 (登记 socket 用途)
+ */
+void SNMP_Agent_Init(void);
+
+/**
+ * @brief  处理请求, 检查链路状态并发送 trap, 每 SNMP_AGENT_POLL_MS 调用一次
+ */
+void SNMP_Agent_Poll(void);
+
+/**
+ * @brief  把 trap 放入发送队列
+ * @param  generic:  SNMPTRAP_xxx
+ * @param  if_index: linkUp/linkDown 的接口号, 其它 trap 为 0 (不带变量绑定)
+ */
+void SNMP_Agent_QueueTrap(uint8_t generic, uint8_t if_index);
+
+/* MIB 取值函数 (在 mib.def 中引用, 由 snmp.c 的 getEntry 调用) */
+void SNMP_Agent_GetUptime(void *ptr, uint8_t *len);
+void SNMP_Agent_GetEthOperStatus(void *ptr, uint8_t *len);
+void SNMP_Agent_GetCellOperStatus(void *ptr, uint8_t *len);
+void SNMP_Agent_GetModemRssi(void *ptr, uint8_t *len);
+void SNMP_Agent_GetCellTcpState(void *ptr, uint8_t *len);
+void SNMP_Agent_GetEthState(void *ptr, uint8_t *len);
+void SNMP_Agent_GetFailovers(void *ptr, uint8_t *len);
+void SNMP_Agent_GetMbRequests(void *ptr, uint8_t *len);
+void SNMP_Agent_GetMbTimeouts(void *ptr, uint8_t *len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SNMP_AGENT_H__ */
@@ -0,0 +1,215 @@
+/* 由 gen_mib.py 根据 mib.def 生成, 不要手工修改 */
+#include "snmp_mib.h"
+#include "snmp_custom.h"
+#include "snmp_agent.h"
+#include "metrics.h"
+
+static void mib_scRs485RxBytes(void *ptr, uint8_t *len)
+{
+    *(uint32_t *)ptr = Metrics_GetSlot(METRIC_RS485_RX_BYTES);
+    *len = 4;
+}
+
+static void mib_scRs485TxBytes(void *ptr, uint8_t *len)
+{
+    *(uint32_t *)ptr = Metrics_GetSlot(METRIC_RS485_TX_BYTES);
+    *len = 4;
+}
+
+static void mib_scRs485RxFrames(void *ptr, uint8_t *len)
+{
+    *(uint32_t *)ptr = Metrics_GetSlot(METRIC_RS485_RX_FRAMES);
+    *len = 4;
+}
+
+static void mib_scRs485TxFrames(void *ptr, uint8_t *len)
+{
+    *(uint32_t *)ptr = Metrics_GetSlot(METRIC_RS485_TX_FRAMES);
+    *len = 4;
+}
+
+static void mib_scRs485RxOverflow(void *ptr, uint8_t *len)
+{
+    *(uint32_t *)ptr = Metrics_GetSlot(METRIC_RS485_RX_OVERFLOW);
+    *len = 4;
+}
+
+static void mib_scModemCsq(void *ptr, uint8_t *len)
+{
+    *(uint32_t *)ptr = Metrics_GetSlot(METRIC_MODEM_CSQ);
+    *len = 4;
+}
+
+static void mib_scCellConnects(void *ptr, uint8_t *len)
+{
+    *(uint32_t *)ptr = Metrics_GetSlot(METRIC_CELL_CONNECTS);
+    *len = 4;
+}
+
+static void mib_scCellConnectFails(void *ptr, uint8_t *len)
+{
+    *(uint32_t *)ptr = Metrics_GetSlot(METRIC_CELL_CONNECT_FAILS);
+    *len = 4;
+}
+
+static void mib_scCellDisconnects(void *ptr, uint8_t *len)
+{
+    *(uint32_t *)ptr = Metrics_GetSlot(METRIC_CELL_DISCONNECTS);
+    *len = 4;
+}
+
+static void mib_scAtCommands(void *ptr, uint8_t *len)
+{
+    *(uint32_t *)ptr = Metrics_GetSlot(METRIC_AT_COMMANDS);
+    *len = 4;
+}
+
+static void mib_scAtTimeouts(void *ptr, uint8_t *len)
+{
+    *(uint32_t *)ptr = Metrics_GetSlot(METRIC_AT_TIMEOUTS);
+    *len = 4;
+}
+
+static void mib_scUplinkActive(void *ptr, uint8_t *len)
+{
+    *(uint32_t *)ptr = Metrics_GetSlot(METRIC_UPLINK_ACTIVE);
+    *len = 4;
+}
+
+static void mib_scEthConnects(void *ptr, uint8_t *len)
+{
+    *(uint32_t *)ptr = Metrics_GetSlot(METRIC_ETH_CONNECTS);
+    *len = 4;
+}
+
+static void mib_scEthDisconnects(void *ptr, uint8_t *len)
+{
+    *(uint32_t *)ptr = Metrics_GetSlot(METRIC_ETH_DISCONNECTS);
+    *len = 4;
+}
+
+static void mib_scUpqDepth(void *ptr, uint8_t *len)
+{
+    *(uint32_t *)ptr = Metrics_GetSlot(METRIC_UPQ_DEPTH);
+    *len = 4;
+}
+
+static void mib_scUpqPeak(void *ptr, uint8_t *len)
+{
+    *(uint32_t *)ptr = Metrics_GetSlot(METRIC_UPQ_PEAK);
+    *len = 4;
+}
+
+static void mib_scUpqDrops(void *ptr, uint8_t *len)
+{
+    *(uint32_t *)ptr = Metrics_GetSlot(METRIC_UPQ_DROPS);
+    *len = 4;
+}
+
+static void mib_scDownqDepth(void *ptr, uint8_t *len)
+{
+    *(uint32_t *)ptr = Metrics_GetSlot(METRIC_DOWNQ_DEPTH);
+    *len = 4;
+}
+
+static void mib_scDownqPeak(void *ptr, uint8_t *len)
+{
+    *(uint32_t *)ptr = Metrics_GetSlot(METRIC_DOWNQ_PEAK);
+    *len = 4;
+}
+
+static void mib_scDownqDrops(void *ptr, uint8_t *len)
+{
+    *(uint32_t *)ptr = Metrics_GetSlot(METRIC_DOWNQ_DROPS);
+    *len = 4;
+}
+
+static void mib_scHeapFree(void *ptr, uint8_t *len)
+{
+    *(uint32_t *)ptr = Metrics_GetSlot(METRIC_HEAP_FREE);
+    *len = 4;
+}
+
+/* 按 OID 升序排列 */
+dataEntryType snmpData[] = {
+    /* sysDescr (1.3.6.1.2.1.1.1.0) */
+    {8, {0x2b, 0x06, 0x01, 0x02, 0x01, 0x01, 0x01, 0x00}, SNMPDTYPE_OCTET_STRING, 26, {"SmartCap RS485 IoT Gateway"}, NULL, NULL},
+    /* sysObjectID (1.3.6.1.2.1.1.2.0) */
+    {8, {0x2b, 0x06, 0x01, 0x02, 0x01, 0x01, 0x02, 0x00}, SNMPDTYPE_OBJ_ID, 10, {"\x2b\x06\x01\x04\x01\x86\x8d\x1f\x01\x01"}, NULL, NULL},
+    /* sysUpTime (1.3.6.1.2.1.1.3.0) */
+    {8, {0x2b, 0x06, 0x01, 0x02, 0x01, 0x01, 0x03, 0x00}, SNMPDTYPE_TIME_TICKS, 4, {""}, SNMP_Agent_GetUptime, NULL},
+    /* sysName (1.3.6.1.2.1.1.5.0) */
+    {8, {0x2b, 0x06, 0x01, 0x02, 0x01, 0x01, 0x05, 0x00}, SNMPDTYPE_OCTET_STRING, 8, {"smartcap"}, NULL, NULL},
+    /* sysServices (1.3.6.1.2.1.1.7.0) */
+    {8, {0x2b, 0x06, 0x01, 0x02, 0x01, 0x01, 0x07, 0x00}, SNMPDTYPE_INTEGER, 4, {.intval = 72}, NULL, NULL},
+    /* ifNumber (1.3.6.1.2.1.2.1.0) */
+    {8, {0x2b, 0x06, 0x01, 0x02, 0x01, 0x02, 0x01, 0x00}, SNMPDTYPE_INTEGER, 4, {.intval = 2}, NULL, NULL},
+    /* ifIndex.1 (1.3.6.1.2.1.2.2.1.1.1) */
+    {10, {0x2b, 0x06, 0x01, 0x02, 0x01, 0x02, 0x02, 0x01, 0x01, 0x01}, SNMPDTYPE_INTEGER, 4, {.intval = 1}, NULL, NULL},
+    /* ifIndex.2 (1.3.6.1.2.1.2.2.1.1.2) */
+    {10, {0x2b, 0x06, 0x01, 0x02, 0x01, 0x02, 0x02, 0x01, 0x01, 0x02}, SNMPDTYPE_INTEGER, 4, {.intval = 2}, NULL, NULL},
+    /* ifDescr.1 (1.3.6.1.2.1.2.2.1.2.1) */
+    {10, {0x2b, 0x06, 0x01, 0x02, 0x01, 0x02, 0x02, 0x01, 0x02, 0x01}, SNMPDTYPE_OCTET_STRING, 10, {"eth-uplink"}, NULL, NULL},
+    /* ifDescr.2 (1.3.6.1.2.1.2.2.1.2.2) */
+    {10, {0x2b, 0x06, 0x01, 0x02, 0x01, 0x02, 0x02, 0x01, 0x02, 0x02}, SNMPDTYPE_OCTET_STRING, 11, {"cell-uplink"}, NULL, NULL},
+    /* ifOperStatus.1 (1.3.6.1.2.1.2.2.1.8.1) */
+    {10, {0x2b, 0x06, 0x01, 0x02, 0x01, 0x02, 0x02, 0x01, 0x08, 0x01}, SNMPDTYPE_INTEGER, 4, {""}, SNMP_Agent_GetEthOperStatus, NULL},
+    /* ifOperStatus.2 (1.3.6.1.2.1.2.2.1.8.2) */
+    {10, {0x2b, 0x06, 0x01, 0x02, 0x01, 0x02, 0x02, 0x01, 0x08, 0x02}, SNMPDTYPE_INTEGER, 4, {""}, SNMP_Agent_GetCellOperStatus, NULL},
+    /* scRs485RxBytes (1.3.6.1.4.1.99999.2.1.1.0) */
+    {12, {0x2b, 0x06, 0x01, 0x04, 0x01, 0x86, 0x8d, 0x1f, 0x02, 0x01, 0x01, 0x00}, SNMPDTYPE_COUNTER, 4, {""}, mib_scRs485RxBytes, NULL},
+    /* scRs485TxBytes (1.3.6.1.4.1.99999.2.1.2.0) */
+    {12, {0x2b, 0x06, 0x01, 0x04, 0x01, 0x86, 0x8d, 0x1f, 0x02, 0x01, 0x02, 0x00}, SNMPDTYPE_COUNTER, 4, {""}, mib_scRs485TxBytes, NULL},
+    /* scRs485RxFrames (1.3.6.1.4.1.99999.2.1.3.0) */
+    {12, {0x2b, 0x06, 0x01, 0x04, 0x01, 0x86, 0x8d, 0x1f, 0x02, 0x01, 0x03, 0x00}, SNMPDTYPE_COUNTER, 4, {""}, mib_scRs485RxFrames, NULL},
+    /* scRs485TxFrames (1.3.6.1.4.1.99999.2.1.4.0) */
+    {12, {0x2b, 0x06, 0x01, 0x04, 0x01, 0x86, 0x8d, 0x1f, 0x02, 0x01, 0x04, 0x00}, SNMPDTYPE_COUNTER, 4, {""}, mib_scRs485TxFrames, NULL},
+    /* scRs485RxOverflow (1.3.6.1.4.1.99999.2.1.5.0) */
+    {12, {0x2b, 0x06, 0x01, 0x04, 0x01, 0x86, 0x8d, 0x1f, 0x02, 0x01, 0x05, 0x00}, SNMPDTYPE_COUNTER, 4, {""}, mib_scRs485RxOverflow, NULL},
+    /* scModemCsq (1.3.6.1.4.1.99999.2.2.1.0) */
+    {12, {0x2b, 0x06, 0x01, 0x04, 0x01, 0x86, 0x8d, 0x1f, 0x02, 0x02, 0x01, 0x00}, SNMPDTYPE_INTEGER, 4, {""}, mib_scModemCsq, NULL},
+    /* scModemRssi (1.3.6.1.4.1.99999.2.2.2.0) */
+    {12, {0x2b, 0x06, 0x01, 0x04, 0x01, 0x86, 0x8d, 0x1f, 0x02, 0x02, 0x02, 0x00}, SNMPDTYPE_INTEGER, 4, {""}, SNMP_Agent_GetModemRssi, NULL},
+    /* scCellTcpState (1.3.6.1.4.1.99999.2.2.3.0) */
+    {12, {0x2b, 0x06, 0x01, 0x04, 0x01, 0x86, 0x8d, 0x1f, 0x02, 0x02, 0x03, 0x00}, SNMPDTYPE_INTEGER, 4, {""}, SNMP_Agent_GetCellTcpState, NULL},
+    /* scCellConnects (1.3.6.1.4.1.99999.2.2.4.0) */
+    {12, {0x2b, 0x06, 0x01, 0x04, 0x01, 0x86, 0x8d, 0x1f, 0x02, 0x02, 0x04, 0x00}, SNMPDTYPE_COUNTER, 4, {""}, mib_scCellConnects, NULL},
+    /* scCellConnectFails (1.3.6.1.4.1.99999.2.2.5.0) */
+    {12, {0x2b, 0x06, 0x01, 0x04, 0x01, 0x86, 0x8d, 0x1f, 0x02, 0x02, 0x05, 0x00}, SNMPDTYPE_COUNTER, 4, {""}, mib_scCellConnectFails, NULL},
+    /* scCellDisconnects (1.3.6.1.4.1.99999.2.2.6.0) */
+    {12, {0x2b, 0x06, 0x01, 0x04, 0x01, 0x86, 0x8d, 0x1f, 0x02, 0x02, 0x06, 0x00}, SNMPDTYPE_COUNTER, 4, {""}, mib_scCellDisconnects, NULL},
+    /* scAtCommands (1.3.6.1.4.1.99999.2.2.7.0) */
+    {12, {0x2b, 0x06, 0x01, 0x04, 0x01, 0x86, 0x8d, 0x1f, 0x02, 0x02, 0x07, 0x00}, SNMPDTYPE_COUNTER, 4, {""}, mib_scAtCommands, NULL},
+    /* scAtTimeouts (1.3.6.1.4.1.99999.2.2.8.0) */
+    {12, {0x2b, 0x06, 0x01, 0x04, 0x01, 0x86, 0x8d, 0x1f, 0x02, 0x02, 0x08, 0x00}, SNMPDTYPE_COUNTER, 4, {""}, mib_scAtTimeouts, NULL},
+    /* scUplinkActive (1.3.6.1.4.1.99999.2.3.1.0) */
+    {12, {0x2b, 0x06, 0x01, 0x04, 0x01, 0x86, 0x8d, 0x1f, 0x02, 0x03, 0x01, 0x00}, SNMPDTYPE_INTEGER, 4, {""}, mib_scUplinkActive, NULL},
+    /* scEthState (1.3.6.1.4.1.99999.2.3.2.0) */
+    {12, {0x2b, 0x06, 0x01, 0x04, 0x01, 0x86, 0x8d, 0x1f, 0x02, 0x03, 0x02, 0x00}, SNMPDTYPE_INTEGER, 4, {""}, SNMP_Agent_GetEthState, NULL},
+    /* scEthConnects (1.3.6.1.4.1.99999.2.3.3.0) */
+    {12, {0x2b, 0x06, 0x01, 0x04, 0x01, 0x86, 0x8d, 0x1f, 0x02, 0x03, 0x03, 0x00}, SNMPDTYPE_COUNTER, 4, {""}, mib_scEthConnects, NULL},
+    /* scEthDisconnects (1.3.6.1.4.1.99999.2.3.4.0) */
+    {12, {0x2b, 0x06, 0x01, 0x04, 0x01, 0x86, 0x8d, 0x1f, 0x02, 0x03, 0x04, 0x00}, SNMPDTYPE_COUNTER, 4, {""}, mib_scEthDisconnects, NULL},
+    /* scFailovers (1.3.6.1.4.1.99999.2.3.5.0) */
+    {12, {0x2b, 0x06, 0x01, 0x04, 0x01, 0x86, 0x8d, 0x1f, 0x02, 0x03, 0x05, 0x00}, SNMPDTYPE_COUNTER, 4, {""}, SNMP_Agent_GetFailovers, NULL},
+    /* scUpqDepth (1.3.6.1.4.1.99999.2.4.1.0) */
+    {12, {0x2b, 0x06, 0x01, 0x04, 0x01, 0x86, 0x8d, 0x1f, 0x02, 0x04, 0x01, 0x00}, SNMPDTYPE_GAUGE, 4, {""}, mib_scUpqDepth, NULL},
+    /* scUpqPeak (1.3.6.1.4.1.99999.2.4.2.0) */
+    {12, {0x2b, 0x06, 0x01, 0x04, 0x01, 0x86, 0x8d, 0x1f, 0x02, 0x04, 0x02, 0x00}, SNMPDTYPE_GAUGE, 4, {""}, mib_scUpqPeak, NULL},
+    /* scUpqDrops (1.3.6.1.4.1.99999.2.4.3.0) */
+    {12, {0x2b, 0x06, 0x01, 0x04, 0x01, 0x86, 0x8d, 0x1f, 0x02, 0x04, 0x03, 0x00}, SNMPDTYPE_COUNTER, 4, {""}, mib_scUpqDrops, NULL},
+    /* scDownqDepth (1.3.6.1.4.1.99999.2.4.4.0) */
+    {12, {0x2b, 0x06, 0x01, 0x04, 0x01, 0x86, 0x8d, 0x1f, 0x02, 0x04, 0x04, 0x00}, SNMPDTYPE_GAUGE, 4, {""}, mib_scDownqDepth, NULL},
+    /* scDownqPeak (1.3.6.1.4.1.99999.2.4.5.0) */
+    {12, {0x2b, 0x06, 0x01, 0x04, 0x01, 0x86, 0x8d, 0x1f, 0x02, 0x04, 0x05, 0x00}, SNMPDTYPE_GAUGE, 4, {""}, mib_scDownqPeak, NULL},
+    /* scDownqDrops (1.3.6.1.4.1.99999.2.4.6.0) */
+    {12, {0x2b, 0x06, 0x01, 0x04, 0x01, 0x86, 0x8d, 0x1f, 0x02, 0x04, 0x06, 0x00}, SNMPDTYPE_COUNTER, 4, {""}, mib_scDownqDrops, NULL},
+    /* scMbRequests (1.3.6.1.4.1.99999.2.5.1.0) */
+    {12, {0x2b, 0x06, 0x01, 0x04, 0x01, 0x86, 0x8d, 0x1f, 0x02, 0x05, 0x01, 0x00}, SNMPDTYPE_COUNTER, 4, {""}, SNMP_Agent_GetMbRequests, NULL},
+    /* scMbTimeouts (1.3.6.1.4.1.99999.2.5.2.0) */
+    {12, {0x2b, 0x06, 0x01, 0x04, 0x01, 0x86, 0x8d, 0x1f, 0x02, 0x05, 0x02, 0x00}, SNMPDTYPE_COUNTER, 4, {""}, SNMP_Agent_GetMbTimeouts, NULL},
+    /* scHeapFree (1.3.6.1.4.1.99999.2.6.1.0) */
+    {12, {0x2b, 0x06, 0x01, 0x04, 0x01, 0x86, 0x8d, 0x1f, 0x02, 0x06, 0x01, 0x00}, SNMPDTYPE_GAUGE, 4, {""}, mib_scHeapFree, NULL},
+};
+
+const int32_t maxData = sizeof(snmpData) / sizeof(snmpData[0]);
@@ -0,0 +1,11 @@
+/* 由 gen_mib.py 根据 mib.def 生成, 不要手工修改 */
+#ifndef __SNMP_MIB_H__
+#define __SNMP_MIB_H__
+
+#define SNMP_MIB_COUNT              39
+
+/* sysObjectID, 也是 trap 的 enterprise 字段 (BER 编码) */
+#define SNMP_MIB_SYSOBJECTID_LEN    10
+#define SNMP_MIB_SYSOBJECTID        0x2b, 0x06, 0x01, 0x04, 0x01, 0x86, 0x8d, 0x1f, 0x01, 0x01
+
+#endif /* __SNMP_MIB_H__ */
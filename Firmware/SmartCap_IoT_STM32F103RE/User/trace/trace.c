@@ -0,0 +1,141 @@
+/**
+  ******************************************************************************
+  * @file    trace.c
+  * @brief   Scheduler Timeline Recorder
+  ******************************************************************************
+  * @description
+  * 内核的 trace 宏在调度器临界区或 PendSV 中调用 Trace_Record, 中断中也会调用,
+  * 所以写入缓冲时只关中断 (PRIMASK), 不使用任何内核接口。
+  * 时间戳使用 rtos_stats.c 开启的 DWT->CYCCNT, 调度器启动前记录的事件时间戳为 0。
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "trace.h"
+#include "FreeRTOS.h"
+#include "queue.h"
+#include "main.h"
+#include <stddef.h>
+
+#if TRACE_ENABLE
+
+/* Private defines -----------------------------------------------------------*/
+#define TRACE_BENCH_EVENTS      64
+
+/* Private variables ---------------------------------------------------------*/
+static Trace_Event_t trace_buf[TRACE_BUF_EVENTS];
+static uint32_t trace_head = 0;                 /* 已记录的事件总数 */
+static volatile uint8_t trace_mask = TRACE_MASK_DEFAULT;
+
+static const char *trace_queue_names[TRACE_QUEUES_MAX];
+static uint8_t trace_queue_count = 0;
+
+static const char *const trace_isr_names[TRACE_ISR_COUNT] = {
+    "USART1 RS485", "UART5 modem", "USART2 console", "TIM2 wiz",
+};
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief  记录一个事件
+ */
+void Trace_Record(uint8_t type, uint8_t id, uint16_t arg)
+{
+    Trace_Event_t *e;
+    uint32_t primask;
+    uint8_t bit;
+
+    if (type >= TRACE_EV_ISR_ENTER)
+        bit = (uint8_t)TRACE_MASK_ISR(id);
+    else if (type == TRACE_EV_TASK_IN)
+        bit = TRACE_MASK_TASK;
+    else
+        bit = TRACE_MASK_QUEUE;
+    if ((trace_mask & bit) == 0)
+        return;
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    e = &trace_buf[trace_head & (TRACE_BUF_EVENTS - 1)];
+    trace_head++;
+    e->cycles = DWT->CYCCNT;
+    e->type = type;
+    e->id = id;
+    e->arg = arg;
+    __set_PRIMASK(primask);
+}
+
+/**
+ * @brief  给队列编号并命名
+ */
+void Trace_NameQueue(void *queue, const char *name)
+{
+    if (queue == NULL || trace_queue_count >= TRACE_QUEUES_MAX)
+        return;
+
+    trace_queue_names[trace_queue_count++] = name;
+    vQueueSetQueueNumber((QueueHandle_t)queue, trace_queue_count);
+}
+
+void Trace_SetMask(uint8_t mask)
+{
+    trace_mask = mask;
+}
+
+uint8_t Trace_GetMask(void)
+{
+    return trace_mask;
+}
+
+/**
+ * @brief  按时间顺序读取缓冲中的事件
+ */
+uint8_t Trace_Get(uint16_t *cursor, Trace_Event_t *event)
+{
+    uint32_t count = (trace_head < TRACE_BUF_EVENTS) ? trace_head : TRACE_BUF_EVENTS;
+
+    if (*cursor >= count)
+        return 0;
+
+    *event = trace_buf[(trace_head - count + *cursor) & (TRACE_BUF_EVENTS - 1)];
+    (*cursor)++;
+    return 1;
+}
+
+const char *Trace_QueueName(uint8_t id)
+{
+    if (id == 0 || id > trace_queue_count)
+        return NULL;
+    return trace_queue_names[id - 1];
+}
+
+const char *Trace_IsrName(uint8_t id)
+{
+    return (id < TRACE_ISR_COUNT) ? trace_isr_names[id] : "?";
+}
+
+/**
+ * @brief  关中断连续记录 TRACE_BENCH_EVENTS 个事件, 返回每个事件的周期数 (含循环开销)
+ */
+uint32_t Trace_Bench(void)
+{
+    uint8_t mask = trace_mask;
+    uint32_t primask;
+    uint32_t start, cycles;
+    uint16_t i;
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    trace_mask = TRACE_MASK_QUEUE;
+    start = DWT->CYCCNT;
+    for (i = 0; i < TRACE_BENCH_EVENTS; i++)
+        Trace_Record(TRACE_EV_QUEUE_SEND, 0, i);
+    cycles = DWT->CYCCNT - start;
+    trace_head = 0;
+    trace_mask = mask;
+    __set_PRIMASK(primask);
+
+    return cycles / TRACE_BENCH_EVENTS;
+}
+
+#endif /* TRACE_ENABLE */
@@ -0,0 +1,127 @@
+/**
+  ******************************************************************************
+  * @file    trace.h
+  * @brief   Scheduler Timeline Recorder Header
+  ******************************************************************************
+  * @description
+  * 记录任务切换、队列发送/阻塞和串口/定时器中断进出, 用于查找 RS485 收发切换、
+  * +QIURC 漏收之类的时序问题:
+  * - FreeRTOSConfig.h 中的 trace 宏和 stm32f1xx_it.c 中的 TRACE_ISR_ENTER/EXIT 调用
+  *   Trace_Record, 每个事件 8 字节 (DWT->CYCCNT 时间戳), 写入 RAM 环形缓冲, 满后覆盖最旧的
+  * - 调试串口 trace 命令暂停记录, 按文本输出缓冲中的事件后继续记录;
+  *   保存的输出由 trace_to_perfetto.py 转换为 Chrome trace JSON (ui.perfetto.dev 打开)
+  * - 记录的事件类别由掩码选择 (trace on <掩码>), 调试串口自身的中断默认不记录
+  * 时间戳约 60 秒回绕一次, 相邻两个事件的间隔须小于这个时间。
+  ******************************************************************************
+  */
+
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported defines ----------------------------------------------------------*/
+#define TRACE_ENABLE            1       /* 需要 configUSE_TRACE_FACILITY 和 DWT 计数器 (rtos_stats.c) */
+
+#define TRACE_BUF_EVENTS        256     /* 环形缓冲事件数 (2 的幂), 每个 8 字节 */
+#define TRACE_QUEUES_MAX        4       /* 可命名的队列数, 队列号 1~TRACE_QUEUES_MAX */
+
+/* 事件类型 */
+#define TRACE_EV_TASK_IN        0       /* id=任务号 (xTaskNumber) */
+#define TRACE_EV_QUEUE_SEND     1       /* id=队列号, arg=发送前队列中的消息数 */
+#define TRACE_EV_QUEUE_RX_BLOCK 2       /* 队列空, 接收任务进入阻塞 (含信号量/互斥量, 队列号 0) */
+#define TRACE_EV_QUEUE_TX_BLOCK 3       /* 队列满, 发送任务进入阻塞 */
+#define TRACE_EV_ISR_ENTER      4       /* id=TRACE_ISR_xxx */
+#define TRACE_EV_ISR_EXIT       5
+
+/* 中断号 */
+#define TRACE_ISR_RS485         0       /* USART1 */
+#define TRACE_ISR_MODEM         1       /* UART5 */
+#define TRACE_ISR_CONSOLE       2       /* USART2 */
+#define TRACE_ISR_WIZ_TIM       3       /* TIM2, 1ms */
+#define TRACE_ISR_COUNT         4
+
+/* 记录掩码 */
+#define TRACE_MASK_TASK         0x01
+#define TRACE_MASK_QUEUE        0x02
+#define TRACE_MASK_ISR(isr)     (0x04 << (isr))
+#define TRACE_MASK_DEFAULT      (TRACE_MASK_TASK | TRACE_MASK_QUEUE | \
+                                 TRACE_MASK_ISR(TRACE_ISR_RS485) | TRACE_MASK_ISR(TRACE_ISR_MODEM))
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct {
+    uint32_t cycles;                    /* DWT->CYCCNT */
+    uint8_t type;                       /* TRACE_EV_xxx */
+    uint8_t id;
+    uint16_t arg;
+} Trace_Event_t;
+
+/* Exported macros -----------------------------------------------------------*/
+#if TRACE_ENABLE
+#define TRACE_ISR_ENTER(isr)            Trace_Record(TRACE_EV_ISR_ENTER, (isr), 0)
+#define TRACE_ISR_EXIT(isr)             Trace_Record(TRACE_EV_ISR_EXIT, (isr), 0)
+#else
+#define TRACE_ISR_ENTER(isr)            ((void)0)
+#define TRACE_ISR_EXIT(isr)             ((void)0)
+#endif
+
+/* Exported functions --------------------------------------------------------*/
+#if TRACE_ENABLE
+
+/**
+ * @brief  记录一个事件, 掩码未选中的直接返回; 任务、中断和内核临界区中均可调用
+ */
+void Trace_Record(uint8_t type, uint8_t id, uint16_t arg);
+
+/**
+ * @brief  给队列编号并命名, 之后该队列的事件带队列号 (在 MX_FREERTOS_Init 中创建队列后调用)
+ * @param  queue: osMessageQId / QueueHandle_t
+ * @param  name:  常量字符串, 只保存指针
+ */
+void Trace_NameQueue(void *queue, const char *name);
+
+/**
+ * @brief  设置记录掩码, 0 为停止记录
+ */
+void Trace_SetMask(uint8_t mask);
+uint8_t Trace_GetMask(void);
+
+/**
+ * @brief  按时间顺序读取缓冲中的事件, 读取前先 Trace_SetMask(0) 暂停记录
+ * @param  cursor: 从 0 开始, 每次调用后递增
+ * @retval 1:读到一个事件  0:没有更多事件
+ */
+uint8_t Trace_Get(uint16_t *cursor, Trace_Event_t *event);
+
+/**
+ * @brief  队列号对应的名称, 未命名时返回 NULL
+ */
+const char *Trace_QueueName(uint8_t id);
+
+/**
+ * @brief  中断号对应的名称
+ */
+const char *Trace_IsrName(uint8_t id);
+
+/**
+ * @brief  测量 Trace_Record 每个事件的 CPU 周期数 (会清空缓冲)
+ */
+uint32_t Trace_Bench(void);
+
+#else
+
+#define Trace_Record(type, id, arg)     ((void)0)
+#define Trace_NameQueue(queue, name)    ((void)0)
+
+#endif /* TRACE_ENABLE */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TRACE_H__ */
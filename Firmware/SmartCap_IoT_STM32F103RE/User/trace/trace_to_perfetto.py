@@ -0,0 +1,136 @@
+#!/usr/bin/env python3
+"""
+时间线转换: 把调试串口 trace 命令的输出 (trace.h) 转换为 Chrome trace JSON,
+用 ui.perfetto.dev 或 chrome://tracing 打开。
+
+用法: python trace_to_perfetto.py <串口记录文件 | -> [-o trace.json]
+
+- 输入为终端软件保存的串口文本, 只处理 "trace begin" 到 "trace end" 之间的行,
+  有多段时取最后一段
+- 任务: 每个任务一行, 显示运行区间 (从切换进入到下一次切换)
+- 中断: 每个中断一行, 显示进入到退出的区间
+- 队列: 深度曲线; 发送和阻塞显示为所在任务行上的标记
+时间戳为 DWT 周期计数, 回绕 (约 60 秒) 按相邻事件间隔小于一个周期展开。
+"""
+import argparse
+import json
+import sys
+
+EV_TASK_IN, EV_QUEUE_SEND, EV_QUEUE_RX_BLOCK, EV_QUEUE_TX_BLOCK, EV_ISR_ENTER, EV_ISR_EXIT = range(6)
+
+PID_TASKS, PID_ISRS, PID_QUEUES = 1, 2, 3
+
+
+def parse(lines):
+    """返回 (CPU 频率, 任务名, 队列名, 中断名, 事件列表), 事件为 (周期, 类型, id, arg)"""
+    block = None
+    for line in lines:
+        line = line.strip()
+        idx = line.find('trace begin ')
+        if idx >= 0:
+            block = {'hz': int(line[idx:].split()[2]), 'task': {}, 'queue': {}, 'isr': {}, 'ev': []}
+            continue
+        if block is None or 'done' in block:
+            continue
+        if line.startswith('trace end'):
+            block['done'] = True
+            continue
+        parts = line.split(None, 2)
+        if len(parts) == 3 and parts[0] in ('task', 'queue', 'isr'):
+            block[parts[0]][int(parts[1])] = parts[2]
+        elif parts and parts[0] == 'ev':
+            f = line.split()
+            if len(f) == 5:
+                block['ev'].append((int(f[1], 16), int(f[2]), int(f[3]), int(f[4])))
+    if block is None:
+        sys.exit('没有找到 "trace begin"')
+    if 'done' not in block:
+        print('warning: 没有 "trace end", 输出可能不完整', file=sys.stderr)
+    return block['hz'], block['task'], block['queue'], block['isr'], block['ev']
+
+
+def convert(hz, tasks, queues, isrs, events):
+    out = []
+    per_us = hz / 1e6
+
+    def meta(pid, tid, kind, name):
+        out.append({'ph': 'M', 'pid': pid, 'tid': tid, 'name': kind, 'args': {'name': name}})
+
+    def task_name(n):
+        return tasks.get(n, 'task %d' % n)
+
+    def queue_name(n):
+        return queues.get(n, 'queue %d' % n if n else 'other')
+
+    meta(PID_TASKS, 0, 'process_name', 'Tasks')
+    meta(PID_ISRS, 0, 'process_name', 'Interrupts')
+    meta(PID_QUEUES, 0, 'process_name', 'Queues')
+    for n in sorted(set(tasks) | {e[2] for e in events if e[1] == EV_TASK_IN}):
+        meta(PID_TASKS, n, 'thread_name', task_name(n))
+    for n, name in sorted(isrs.items()):
+        meta(PID_ISRS, n, 'thread_name', name)
+
+    ts = 0.0
+    prev = None
+    running = None          # (任务号, 开始时间)
+    isr_start = {}
+    for cycles, kind, ident, arg in events:
+        if prev is not None:
+            ts += ((cycles - prev) & 0xFFFFFFFF) / per_us
+        prev = cycles
+
+        if kind == EV_TASK_IN:
+            if running is not None:
+                out.append({'ph': 'X', 'pid': PID_TASKS, 'tid': running[0], 'name': task_name(running[0]),
+                            'ts': running[1], 'dur': ts - running[1]})
+            running = (ident, ts)
+        elif kind in (EV_QUEUE_SEND, EV_QUEUE_TX_BLOCK, EV_QUEUE_RX_BLOCK):
+            tid = running[0] if running else 0
+            label = {EV_QUEUE_SEND: 'send', EV_QUEUE_TX_BLOCK: 'block send',
+                     EV_QUEUE_RX_BLOCK: 'block receive'}[kind]
+            out.append({'ph': 'i', 's': 't', 'pid': PID_TASKS, 'tid': tid, 'ts': ts,
+                        'name': '%s %s' % (label, queue_name(ident)), 'args': {'waiting': arg}})
+            if kind == EV_QUEUE_SEND and ident:
+                out.append({'ph': 'C', 'pid': PID_QUEUES, 'ts': ts, 'name': queue_name(ident),
+                            'args': {'depth': arg + 1}})
+        elif kind == EV_ISR_ENTER:
+            isr_start[ident] = ts
+        elif kind == EV_ISR_EXIT:
+            start = isr_start.pop(ident, None)
+            if start is not None:
+                out.append({'ph': 'X', 'pid': PID_ISRS, 'tid': ident, 'name': isrs.get(ident, 'isr %d' % ident),
+                            'ts': start, 'dur': ts - start})
+        else:
+            print('warning: unknown event type %d' % kind, file=sys.stderr)
+
+    if running is not None:
+        out.append({'ph': 'X', 'pid': PID_TASKS, 'tid': running[0], 'name': task_name(running[0]),
+                    'ts': running[1], 'dur': ts - running[1]})
+    return {'traceEvents': out, 'displayTimeUnit': 'ns'}
+
+
+def main():
+    ap = argparse.ArgumentParser()
+    ap.add_argument('source', help='串口记录文件, - 为标准输入')
+    ap.add_argument('-o', '--output', help='输出 JSON 文件, 默认标准输出')
+    args = ap.parse_args()
+
+    if args.source == '-':
+        lines = sys.stdin.readlines()
+    else:
+        lines = open(args.source, encoding='utf-8', errors='replace').readlines()
+    hz, tasks, queues, isrs, events = parse(lines)
+    trace = convert(hz, tasks, queues, isrs, events)
+    if events:
+        span = sum(((b[0] - a[0]) & 0xFFFFFFFF) for a, b in zip(events, events[1:])) / hz
+        print('%d events, %.3f s' % (len(events), span), file=sys.stderr)
+
+    if args.output:
+        with open(args.output, 'w') as f:
+            json.dump(trace, f)
+    else:
+        json.dump(trace, sys.stdout)
+
+
+if __name__ == '__main__':
+    main()
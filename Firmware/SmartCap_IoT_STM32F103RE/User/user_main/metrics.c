@@ -0,0 +1,294 @@
+/**
+  ******************************************************************************
+  * @file    metrics.c
+  * @brief   Runtime Metrics Registry
+  ******************************************************************************
+  * @description
+  * 指标描述 (名称/说明/类型) 是常量表, 值只有一个 uint32_t 数组。
+  * 导出时逐个读取, 各值之间不保证同一时刻 (计数器单调递增, 对监控没有影响)。
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "metrics.h"
+#include "mb_crc.h"
+#include "cmsis_os.h"
+#include <stdio.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define METRICS_PREFIX          "smartcap_"
+#define METRICS_HIST_BASE(h)    (METRIC_SCALAR_COUNT + (h) * METRICS_HIST_SLOTS)
+#define METRICS_HIST_SUM(h)     (METRICS_HIST_BASE(h) + METRICS_HIST_BUCKETS + 1)
+/* Prometheus 输出中每个直方图的段数: HELP/TYPE, 各桶, sum, count */
+#define METRICS_HIST_LINES      (METRICS_HIST_BUCKETS + 4)
+
+/* Private types -------------------------------------------------------------*/
+typedef struct {
+    const char *name;
+    const char *help;
+    uint8_t gauge;                      /* 0=counter 1=gauge */
+} Metrics_Desc_t;
+
+/* Exported variables --------------------------------------------------------*/
+volatile uint32_t Metrics_Slots[METRICS_SLOT_COUNT];
+
+/* Private variables ---------------------------------------------------------*/
+static const Metrics_Desc_t scalar_desc[METRIC_SCALAR_COUNT] = {
+    {"rs485_rx_overflow_total",   "Bytes dropped because the RS485 RX ring was full", 0},
+    {"rg200u_rx_overflow_total",  "Bytes dropped because the RG200U RX ring was full", 0},
+    {"upq_drops_total",           "Bytes dropped because the RS485 to uplink queue was full", 0},
+    {"downq_drops_total",         "Bytes dropped because the downlink to RS485 queue was full", 0},
+    {"at_commands_total",         "AT commands sent to the modem", 0},
+    {"at_timeouts_total",         "AT commands without OK/ERROR response", 0},
+    {"eth_connects_total",        "Ethernet uplink TCP connect attempts", 0},
+    {"eth_disconnects_total",     "Ethernet uplink TCP disconnects and connect failures", 0},
+    {"cell_connects_total",       "Cellular TCP connect attempts", 0},
+    {"cell_connect_fails_total",  "Cellular TCP connect failures", 0},
+    {"cell_disconnects_total",    "Cellular TCP closed by network or server", 0},
+    {"upq_depth",                 "RS485 to uplink queue depth", 1},
+    {"upq_peak",                  "RS485 to uplink queue peak depth", 1},
+    {"downq_depth",               "Downlink to RS485 queue depth", 1},
+    {"downq_peak",                "Downlink to RS485 queue peak depth", 1},
+    {"heap_free_bytes",           "FreeRTOS heap free bytes", 1},
+    {"uplink_active",             "Active uplink (0=ETH 1=CELL 255=NONE)", 1},
+    {"rs485_rx_bytes_total",      "Bytes received on RS485", 0},
+    {"rs485_tx_bytes_total",      "Bytes transmitted on RS485", 0},
+    {"rs485_rx_frames_total",     "RS485 receive frames separated by line idle", 0},
+    {"rs485_tx_frames_total",     "RS485 transmit bursts", 0},
+    {"modem_csq",                 "Modem signal quality from AT+CSQ (99=unknown)", 1},
+    {"mqtt_connects_total",       "MQTT CONNECT packets sent", 0},
+    {"mqtt_session_drops_total",  "MQTT sessions dropped on error, timeout or link loss", 0},
+    {"mqtt_tx_messages_total",    "MQTT PUBLISH packets sent", 0},
+    {"mqtt_rx_messages_total",    "MQTT PUBLISH packets received", 0},
+    {"mqtt_retransmits_total",    "MQTT QoS1 PUBLISH packets resent with DUP", 0},
+    {"mqtt_inflight",             "MQTT QoS1 messages awaiting PUBACK", 1},
+    {"event_log_drops_total",     "Events dropped because the event log RAM ring was full", 0},
+    {"cpu_load_permille",         "CPU load outside the idle task over the last window, 0.1%", 1},
+    {"heap_min_free_bytes",       "FreeRTOS heap minimum ever free bytes", 1},
+    {"stack_min_free_words",      "Smallest task stack high-water mark in words", 1},
+};
+
+static const Metrics_Desc_t hist_desc[METRIC_HIST_COUNT] = {
+    {"at_latency_ms",             "AT command response time", 0},
+    {"mb_latency_ms",             "Modbus request latency from enqueue to slave response", 0},
+};
+
+static const uint32_t hist_bounds[METRICS_HIST_BUCKETS] = {
+    5, 10, 20, 50, 100, 200, 500, 1000, 2000, 5000
+};
+
+static uint16_t report_slot = METRICS_SLOT_COUNT;   /* 正在上报的下一槽号, 等于 METRICS_SLOT_COUNT 表示空闲 */
+static uint8_t report_seq = 0;
+static uint32_t report_tick = 0;
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief  槽值加 n (LDREX/STREX)
+ */
+static void Metrics_SlotAdd(uint16_t slot, uint32_t n)
+{
+    volatile uint32_t *p = &Metrics_Slots[slot];
+    uint32_t v;
+
+    do {
+        v = __LDREXW(p) + n;
+    } while (__STREXW(v, p));
+}
+
+/**
+ * @brief  写入 LEB128 变长整数
+ * @retval 写入的字节数 (1~5)
+ */
+static uint8_t Metrics_PutVarint(uint8_t *p, uint32_t v)
+{
+    uint8_t n = 0;
+
+    while (v >= 0x80)
+    {
+        p[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    p[n++] = (uint8_t)v;
+    return n;
+}
+
+/**
+ * @brief  直方图中一个桶的累计计数 (Prometheus 的桶是累计的)
+ */
+static uint32_t Metrics_HistCumulative(uint8_t hist, uint8_t bucket)
+{
+    uint32_t sum = 0;
+    uint8_t i;
+
+    for (i = 0; i <= bucket; i++)
+        sum += Metrics_Slots[METRICS_HIST_BASE(hist) + i];
+    return sum;
+}
+
+/**
+ * @brief  生成 Prometheus 文本的一段
+ * @retval 需要的长度 (可能大于 size, 此时内容不完整)
+ */
+static int Metrics_PromPiece(uint16_t cursor, char *buf, uint16_t size)
+{
+    const Metrics_Desc_t *d;
+    uint8_t hist, line;
+
+    if (cursor < METRIC_SCALAR_COUNT)
+    {
+        d = &scalar_desc[cursor];
+        return snprintf(buf, size, "# HELP " METRICS_PREFIX "%s %s\n# TYPE " METRICS_PREFIX "%s %s\n"
+                        METRICS_PREFIX "%s %lu\n",
+                        d->name, d->help, d->name, d->gauge ? "gauge" : "counter",
+                        d->name, (unsigned long)Metrics_Slots[cursor]);
+    }
+
+    cursor -= METRIC_SCALAR_COUNT;
+    hist = (uint8_t)(cursor / METRICS_HIST_LINES);
+    line = (uint8_t)(cursor % METRICS_HIST_LINES);
+    d = &hist_desc[hist];
+    if (line == 0)
+        return snprintf(buf, size, "# HELP " METRICS_PREFIX "%s %s\n# TYPE " METRICS_PREFIX "%s histogram\n",
+                        d->name, d->help, d->name);
+    line--;
+    if (line < METRICS_HIST_BUCKETS)
+        return snprintf(buf, size, METRICS_PREFIX "%s_bucket{le=\"%lu\"} %lu\n", d->name,
+                        (unsigned long)hist_bounds[line], (unsigned long)Metrics_HistCumulative(hist, line));
+    if (line == METRICS_HIST_BUCKETS)
+        return snprintf(buf, size, METRICS_PREFIX "%s_bucket{le=\"+Inf\"} %lu\n", d->name,
+                        (unsigned long)Metrics_HistCumulative(hist, METRICS_HIST_BUCKETS));
+    if (line == METRICS_HIST_BUCKETS + 1)
+        return snprintf(buf, size, METRICS_PREFIX "%s_sum %lu\n", d->name,
+                        (unsigned long)Metrics_Slots[METRICS_HIST_SUM(hist)]);
+    return snprintf(buf, size, METRICS_PREFIX "%s_count %lu\n", d->name,
+                    (unsigned long)Metrics_HistCumulative(hist, METRICS_HIST_BUCKETS));
+}
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief  记录直方图观测值
+ */
+void Metrics_Observe(Metrics_Hist_t hist, uint32_t value)
+{
+    uint8_t i = 0;
+
+    while (i < METRICS_HIST_BUCKETS && value > hist_bounds[i])
+        i++;
+    Metrics_SlotAdd(METRICS_HIST_BASE(hist) + i, 1);
+    Metrics_SlotAdd(METRICS_HIST_SUM(hist), value);
+}
+
+/**
+ * @brief  设置仪表值并更新对应的峰值仪表
+ */
+void Metrics_SetWithPeak(Metrics_ID_t id, Metrics_ID_t peak, uint32_t value)
+{
+    volatile uint32_t *p = &Metrics_Slots[peak];
+
+    Metrics_Slots[id] = value;
+    do {
+        if (__LDREXW(p) >= value)
+        {
+            __CLREX();
+            return;
+        }
+    } while (__STREXW(value, p));
+}
+
+/**
+ * @brief  按槽号读取
+ */
+uint32_t Metrics_GetSlot(uint16_t slot)
+{
+    if (slot >= METRICS_SLOT_COUNT)
+        return 0;
+    return Metrics_Slots[slot];
+}
+
+/**
+ * @brief  生成一条二进制记录
+ */
+uint16_t Metrics_EncodeRecord(uint16_t *slot, uint8_t seq, uint8_t *buf, uint16_t size)
+{
+    uint16_t len = METRICS_REPORT_HDR_LEN, crc;
+    uint16_t first = *slot, s = *slot;
+
+    if (size > 255)
+        size = 255;
+    if (s >= METRICS_SLOT_COUNT || size < METRICS_REPORT_LEN_MIN)
+        return 0;
+
+    /* 每个值最多 5 字节, 末尾留 2 字节 CRC */
+    while (s < METRICS_SLOT_COUNT && s - first < 255 && len + 5 + 2 <= size)
+        len += Metrics_PutVarint(&buf[len], Metrics_Slots[s++]);
+
+    buf[0] = METRICS_REPORT_SYNC;
+    buf[1] = (uint8_t)(len + 2);
+    buf[2] = METRICS_SCHEMA_VER;
+    buf[3] = seq;
+    buf[4] = (uint8_t)first;
+    buf[5] = (uint8_t)(s - first);
+    crc = MB_CRC16(buf, len);
+    buf[len++] = (uint8_t)crc;
+    buf[len++] = (uint8_t)(crc >> 8);
+    *slot = s;
+    return len;
+}
+
+/**
+ * @brief  取下一条周期上报记录
+ */
+uint16_t Metrics_TakeReport(uint8_t *buf, uint16_t size)
+{
+#if METRICS_REPORT_PERIOD_S
+    uint32_t now = osKernelSysTick();
+
+    if (report_slot >= METRICS_SLOT_COUNT)
+    {
+        if ((now - report_tick) < (uint32_t)METRICS_REPORT_PERIOD_S * 1000)
+            return 0;
+        report_tick = now;
+        report_slot = 0;
+        report_seq++;
+    }
+    return Metrics_EncodeRecord(&report_slot, report_seq, buf, size);
+#else
+    (void)report_slot;
+    (void)report_seq;
+    (void)report_tick;
+    return 0;
+#endif
+}
+
+/**
+ * @brief  生成 Prometheus 文本格式的下一段
+ */
+uint16_t Metrics_FormatPrometheus(uint16_t *cursor, char *buf, uint16_t size)
+{
+    uint16_t total = METRIC_SCALAR_COUNT + METRIC_HIST_COUNT * METRICS_HIST_LINES;
+    uint16_t len = 0;
+    int n;
+
+    /* 尽量多放几段, 放不下的一段留到下一次 */
+    while (*cursor < total)
+    {
+        n = Metrics_PromPiece(*cursor, &buf[len], size - len);
+        if (n < 0)
+            break;
+        if (len + n >= size)
+        {
+            /* 单独一段也放不下时跳过, 避免卡住 */
+            if (len == 0)
+            {
+                (*cursor)++;
+                continue;
+            }
+            break;
+        }
+        len += (uint16_t)n;
+        (*cursor)++;
+    }
+    return len;
+}
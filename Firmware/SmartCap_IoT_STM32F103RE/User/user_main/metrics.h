@@ -0,0 +1,179 @@
+/**
+  ******************************************************************************
+  * @file    metrics.h
+  * @brief   Runtime Metrics Registry Header
+  ******************************************************************************
+  * @description
+  * 计数器、仪表和固定分桶直方图, 可在任务和中断中直接更新:
+  * - 更新使用 LDREX/STREX, 不关中断, 不加锁, 多个写者也不会丢失计数
+  * - 所有值按"槽"顺序存放, 槽号即导出顺序, 只在末尾追加新指标 (改变时加 METRICS_SCHEMA_VER)
+  *
+  * 导出方式:
+  * - Prometheus 文本: HTTP GET /metrics
+  * - 二进制记录: HTTP GET /metrics.bin, 以及 (METRICS_REPORT_PERIOD_S 非 0 时) 周期性经上行链路发送
+  * - SNMP: Metrics_GetSlot 按槽号读取
+  *
+  * 二进制记录格式 (与寄存器上报记录同样的帧结构):
+  *   0xA6 | 记录长度 | 版本 | 序号 | 首槽号 | 槽数 n | n 个值 (LEB128 变长) | CRC16(低字节在前)
+  * 一次导出拆成多条记录, 序号相同; 直方图占 METRICS_HIST_SLOTS 个槽:
+  * 各桶计数 (非累计, 最后一个为 +Inf) 和观测值总和。
+  ******************************************************************************
+  */
+
+#ifndef __METRICS_H__
+#define __METRICS_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include <stdint.h>
+
+/* Exported defines ----------------------------------------------------------*/
+#define METRICS_SCHEMA_VER      6
+#define METRICS_REPORT_PERIOD_S 0       /* 经上行链路上报的周期, 0=不上报 (上报记录会插入透传数据流) */
+
+#define METRICS_REPORT_SYNC     0xA6
+#define METRICS_REPORT_HDR_LEN  6
+#define METRICS_REPORT_LEN_MIN  (METRICS_REPORT_HDR_LEN + 5 + 2)   /* 至少能放下一个值 */
+
+#define METRICS_PROM_PIECE_MAX  256     /* Prometheus 文本最长一段 (一个指标的 HELP/TYPE/值) 的上限 */
+
+#define METRICS_HIST_BUCKETS    10      /* 有上限的桶数, 另有一个 +Inf 桶 */
+#define METRICS_HIST_SLOTS      (METRICS_HIST_BUCKETS + 2)
+
+/* Exported types ------------------------------------------------------------*/
+
+/* 计数器和仪表, 每个占一个槽 */
+typedef enum {
+    METRIC_RS485_RX_OVERFLOW = 0,       /* RS485 接收环形缓冲满, 中断中丢弃的字节 */
+    METRIC_RG200U_RX_OVERFLOW,          /* RG200U 接收环形缓冲满丢弃的字节 */
+    METRIC_UPQ_DROPS,                   /* RS485->上行队列满丢弃的字节 */
+    METRIC_DOWNQ_DROPS,                 /* 下行->RS485 队列满丢弃的字节 */
+    METRIC_AT_COMMANDS,                 /* 发送的 AT 指令 */
+    METRIC_AT_TIMEOUTS,                 /* AT 指令无 OK/ERROR 应答 */
+    METRIC_ETH_CONNECTS,                /* 以太网上行 TCP 连接尝试 */
+    METRIC_ETH_DISCONNECTS,             /* 以太网上行 TCP 断开/连接失败 */
+    METRIC_CELL_CONNECTS,               /* 蜂窝 TCP 连接尝试 (AT+QIOPEN) */
+    METRIC_CELL_CONNECT_FAILS,
+    METRIC_CELL_DISCONNECTS,            /* +QIURC closed/pdpdeact */
+    /* 仪表, 由默认任务周期采样 */
+    METRIC_UPQ_DEPTH,                   /* RS485->上行队列当前深度 */
+    METRIC_UPQ_PEAK,                    /* 入队时更新的历史最大深度 */
+    METRIC_DOWNQ_DEPTH,                 /* 下行->RS485 队列当前深度 */
+    METRIC_DOWNQ_PEAK,
+    METRIC_HEAP_FREE,                   /* FreeRTOS 堆剩余字节 */
+    METRIC_UPLINK_ACTIVE,               /* 当前上行链路 (Uplink_ID_t) */
+    /* 版本 2 */
+    METRIC_RS485_RX_BYTES,              /* RS485 收到的字节 (含溢出丢弃的) */
+    METRIC_RS485_TX_BYTES,
+    METRIC_RS485_RX_FRAMES,             /* 以 RS485_FRAME_GAP_MS 静默分隔的接收帧 */
+    METRIC_RS485_TX_FRAMES,             /* 切换到发送方向的次数 */
+    METRIC_MODEM_CSQ,                   /* AT+CSQ 信号强度 0~31, 99=未知 */
+    /* 版本 3 */
+    METRIC_MQTT_CONNECTS,               /* MQTT CONNECT 次数 */
+    METRIC_MQTT_SESSION_DROPS,          /* MQTT 会话因协议错误/超时/链路失效断开 */
+    METRIC_MQTT_TX_MSGS,                /* 发出的 PUBLISH */
+    METRIC_MQTT_RX_MSGS,                /* 收到的 PUBLISH */
+    /* 版本 4 */
+    METRIC_MQTT_RETRANSMITS,            /* QoS1 未及时收到 PUBACK 或重连后带 DUP 重发 */
+    METRIC_MQTT_INFLIGHT,               /* 等待 PUBACK 的 QoS1 消息 (仪表) */
+    /* 版本 5 */
+    METRIC_EVENT_LOG_DROPS,             /* 事件日志 RAM 缓冲满丢弃的事件 */
+    /* 版本 6 */
+    METRIC_CPU_LOAD,                    /* 空闲任务以外的 CPU 占用, 0.1% (rtos_stats.c) */
+    METRIC_HEAP_MIN_FREE,               /* FreeRTOS 堆历史最小剩余字节 */
+    METRIC_STACK_MIN_FREE,              /* 各任务栈历史最小剩余中的最小值, 字 */
+    METRIC_SCALAR_COUNT
+} Metrics_ID_t;
+
+/* 直方图 (毫秒) */
+typedef enum {
+    METRIC_HIST_AT_LATENCY = 0,         /* AT 指令应答时间 (超时不计入) */
+    METRIC_HIST_MB_LATENCY,             /* Modbus 请求入队到从站应答的时间 */
+    METRIC_HIST_COUNT
+} Metrics_Hist_t;
+
+#define METRICS_SLOT_COUNT      (METRIC_SCALAR_COUNT + METRIC_HIST_COUNT * METRICS_HIST_SLOTS)
+
+/* Exported variables --------------------------------------------------------*/
+extern volatile uint32_t Metrics_Slots[METRICS_SLOT_COUNT];
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief  计数器加 n, 任务和中断中均可调用
+ */
+static __INLINE void Metrics_Add(Metrics_ID_t id, uint32_t n)
+{
+    volatile uint32_t *p = &Metrics_Slots[id];
+    uint32_t v;
+
+    do {
+        v = __LDREXW(p) + n;
+    } while (__STREXW(v, p));
+}
+
+/**
+ * @brief  计数器加 1
+ */
+static __INLINE void Metrics_Inc(Metrics_ID_t id)
+{
+    Metrics_Add(id, 1);
+}
+
+/**
+ * @brief  设置仪表值 (单次 32 位写, 本身是原子的)
+ */
+static __INLINE void Metrics_Set(Metrics_ID_t id, uint32_t value)
+{
+    Metrics_Slots[id] = value;
+}
+
+/**
+ * @brief  记录直方图观测值
+ * @param  value: 观测值 (毫秒)
+ */
+void Metrics_Observe(Metrics_Hist_t hist, uint32_t value);
+
+/**
+ * @brief  设置仪表值并更新对应的峰值仪表
+ */
+void Metrics_SetWithPeak(Metrics_ID_t id, Metrics_ID_t peak, uint32_t value);
+
+/**
+ * @brief  按槽号读取 (SNMP 使用)
+ * @retval 槽号超出范围时为 0
+ */
+uint32_t Metrics_GetSlot(uint16_t slot);
+
+/**
+ * @brief  生成一条二进制记录
+ * @param  slot: 输入为本条记录的首槽号, 输出为下一条记录的首槽号 (等于 METRICS_SLOT_COUNT 表示结束)
+ * @param  seq:  导出序号, 同一次导出的记录相同
+ * @param  buf:  输出缓冲, 不小于 METRICS_REPORT_LEN_MIN, 记录长度不超过 255
+ * @retval 记录长度, 0 表示已结束或缓冲区太小
+ */
+uint16_t Metrics_EncodeRecord(uint16_t *slot, uint8_t seq, uint8_t *buf, uint16_t size);
+
+/**
+ * @brief  取下一条周期上报记录, 由上行发送任务调用
+ * @retval 记录长度, 0 表示没有需要发送的记录
+ */
+uint16_t Metrics_TakeReport(uint8_t *buf, uint16_t size);
+
+/**
+ * @brief  生成 Prometheus 文本格式的下一段 (一个指标的若干行)
+ * @param  cursor: 从 0 开始, 每次调用后前进, 由调用者保存
+ * @param  size:   不小于 METRICS_PROM_PIECE_MAX, 否则放不下的指标会被跳过
+ * @retval 写入的长度, 0 表示全部输出完毕
+ */
+uint16_t Metrics_FormatPrometheus(uint16_t *cursor, char *buf, uint16_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __METRICS_H__ */
@@ -9,7 +9,13 @@
 /* Includes ------------------------------------------------------------------*/
 #include "rg200u.h"
 #include "rs485.h"
+#include "metrics.h"
+#include "uplink.h"
+#include "event_log.h"
+#include "console.h"
+#include "task_wdg.h"
 #include "usart.h"
+#include "cmsis_os.h"
 #include "main.h"    /* 包含继电器GPIO定义 */
 #include <string.h>
 #include <stdio.h>
@@ -18,20 +24,6 @@
 #define AT_RESPONSE_TIMEOUT    5000   /* AT指令响应超时(ms) */
 #define AT_RESPONSE_BUF_SIZE   512    /* AT响应缓冲区大小 */
 
-/* DEBUG宏定义 - 根据RG200U_DEBUG_ENABLE控制调试信息输出 */
-#if RG200U_DEBUG_ENABLE
-    #define DEBUG_PRINT(msg) \
-        do { \
-            RS485_SetTransmitMode(); \
-            HAL_Delay(1); \
-            RS485_SendString_NoDirChange(msg); \
-            RS485_SetReceiveMode(); \
-            HAL_Delay(10); \
-        } while(0)
-#else
-    #define DEBUG_PRINT(msg)  /* 调试关闭时为空 */
-#endif
-
 /* Private variables ---------------------------------------------------------*/
 static uint8_t rg200u_rx_buffer[RG200U_RX_BUFFER_SIZE];  /* 接收环形缓冲区 */
 static volatile uint16_t rx_write_index = 0;             /* 写指针 */
@@ -45,7 +37,17 @@ static TCP_State_t tcp_state = TCP_STATE_DISCONNECTED;
 /* Private function prototypes -----------------------------------------------*/
 static uint8_t RG200U_SendATCommand(const char *cmd, char *response, uint16_t timeout);
 static void RG200U_ExtractString(const char *src, const char *start_tag, const char *end_tag, char *dest, uint16_t max_len);
-static void RG200U_ProcessCommand(const char *cmd_data, uint16_t len);
+
+/**
+ * @brief  等待并报到 (task_wdg.h)
+ * @note   本文件的阻塞操作都在 RG200U 接收任务中执行 (初始化、重连、读取数据);
+ *         HAL_Delay 忙等时这个高优先级任务不让出 CPU, 默认任务无法喂狗
+ */
+static void RG200U_Wait(uint32_t ms)
+{
+    osDelay(ms);
+    TaskWdg_CheckIn(TASK_WDG_RG200U_RX);
+}
 
 /* Exported functions --------------------------------------------------------*/
 
@@ -69,6 +71,7 @@ static uint8_t RG200U_SendATCommand(const char *cmd, char *response, uint16_t ti
     
     /* 发送AT指令 */
     HAL_UART_Transmit(&huart5, (uint8_t *)cmd, strlen(cmd), 1000);
+    Metrics_Inc(METRIC_AT_COMMANDS);
     
     /* 等待响应 */
     while ((HAL_GetTick() - start_tick) < timeout)
@@ -84,13 +87,15 @@ static uint8_t RG200U_SendATCommand(const char *cmd, char *response, uint16_t ti
                 /* 检查是否收到完整响应 */
                 if (strstr(response, "OK\r\n") || strstr(response, "ERROR\r\n"))
                 {
+                    Metrics_Observe(METRIC_HIST_AT_LATENCY, HAL_GetTick() - start_tick);
                     return 1;
                 }
             }
         }
-        HAL_Delay(1);
+        RG200U_Wait(1);
     }
     
+    Metrics_Inc(METRIC_AT_TIMEOUTS);
     return 0;  /* 超时 */
 }
 
@@ -136,7 +141,7 @@ static uint8_t RG200U_WaitForResponse(const char *expected, char *response, uint
             return 1;
         }
         
-        HAL_Delay(1);
+        RG200U_Wait(1);
     }
     
     return 0;
@@ -169,6 +174,7 @@ static void RG200U_ExtractString(const char *src, const char *start_tag, const c
 
 /**
  * @brief  RG200U模块初始化及自检
+ * @note   在 RG200U 接收任务开始时调用, 最长约 2 分钟, 期间每次等待都报到
  */
 void RG200U_Init(void)
 {
@@ -183,38 +189,32 @@ void RG200U_Init(void)
     memset((void *)rg200u_rx_buffer, 0, RG200U_RX_BUFFER_SIZE);
     rx_write_index = 0;
     rx_read_index = 0;
+    Metrics_Set(METRIC_MODEM_CSQ, RG200U_CSQ_UNKNOWN);
     
     /* ========== 关键修复: 先禁用UART5,等待RG200U启动 ========== */
     /* 禁用UART5,避免干扰RG200U启动 */
     HAL_UART_DeInit(&huart5);
     
-    /* 切换到RS485发送模式,显示等待信息 */
-    RS485_SetTransmitMode();
-    HAL_Delay(2);
-    
-    RS485_SendString_NoDirChange("\r\n");
-    RS485_SendString_NoDirChange("==================================\r\n");
-    RS485_SendString_NoDirChange("  RG200U 4G Gateway Starting...\r\n");
-    RS485_SendString_NoDirChange("==================================\r\n");
-    RS485_SendString_NoDirChange("Hardware boot: [");
+    /* 调试串口显示等待信息 */
+    Console_Puts("\r\n");
+    Console_Puts("==================================\r\n");
+    Console_Puts("  RG200U 4G Gateway Starting...\r\n");
+    Console_Puts("==================================\r\n");
+    Console_Puts("Hardware boot: [");
     
     /* 15秒进度条,每秒显示一个进度块 */
     for (uint8_t i = 0; i < 15; i++)
     {
-        HAL_Delay(1000);
-        RS485_SendString_NoDirChange("=");
+        RG200U_Wait(1000);
+        Console_Puts("=");
     }
     
-    RS485_SendString_NoDirChange("] Done\r\n\r\n");
-    
-    /* 切回RS485接收模式 */
-    RS485_SetReceiveMode();
-    HAL_Delay(2);
+    Console_Puts("] Done\r\n\r\n");
     
     /* ========== 重新初始化UART5 ========== */
     /* RG200U已完全启动,现在重新初始化UART5 */
     MX_UART5_Init();
-    HAL_Delay(100);  /* 等待UART稳定 */
+    RG200U_Wait(100);  /* 等待UART稳定 */
     
     /* 清空UART5接收缓冲 */
     __HAL_UART_FLUSH_DRREGISTER(&huart5);
@@ -222,14 +222,10 @@ void RG200U_Init(void)
     /* 启动UART5接收中断 */
     HAL_UART_Receive_IT(&huart5, &uart_rx_byte, 1);
     
-    /* 切换到RS485发送模式 */
-    RS485_SetTransmitMode();
-    HAL_Delay(2);
-    
-    RS485_SendString_NoDirChange("=== RG200U 4G Module Self-Test ===\r\n\r\n");
+    Console_Puts("=== RG200U 4G Module Self-Test ===\r\n\r\n");
     
     /* 步骤1: 测试AT指令 */
-    RS485_SendString_NoDirChange("[1/5] Testing AT command...");
+    Console_Puts("[1/5] Testing AT command...");
     for (retry = 0; retry < 3; retry++)
     {
         if (RG200U_SendATCommand("AT\r\n", response, 2000))
@@ -237,21 +233,21 @@ void RG200U_Init(void)
             if (strstr(response, "OK"))
             {
                 test_ok = 1;
-                RS485_SendString_NoDirChange(" OK\r\n");
+                Console_Puts(" OK\r\n");
                 break;
             }
         }
-        HAL_Delay(500);
+        RG200U_Wait(500);
     }
     if (!test_ok)
     {
-        RS485_SendString_NoDirChange(" FAILED\r\n");
-        RS485_SendString_NoDirChange("\r\nError: RG200U not responding!\r\n");
+        Console_Puts(" FAILED\r\n");
+        Console_Puts("\r\nError: RG200U not responding!\r\n");
         goto show_result;
     }
     
     /* 步骤2: 检查网络注册 (优先5G,兼容4G) */
-    RS485_SendString_NoDirChange("[2/5] Checking network registration...");
+    Console_Puts("[2/5] Checking network registration...");
     test_ok = 0;
     for (retry = 0; retry < 20; retry++)  /* 最多等待40秒 */
     {
@@ -263,7 +259,7 @@ void RG200U_Init(void)
             if (strstr(response, "+C5GREG: 0,1") || strstr(response, "+C5GREG: 0,5"))
             {
                 test_ok = 1;
-                RS485_SendString_NoDirChange(" Registered (5G)\r\n");
+                Console_Puts(" Registered (5G)\r\n");
                 break;
             }
         }
@@ -276,62 +272,62 @@ void RG200U_Init(void)
             if (strstr(response, "+CEREG: 0,1") || strstr(response, "+CEREG: 0,5"))
             {
                 test_ok = 1;
-                RS485_SendString_NoDirChange(" Registered (4G)\r\n");
+                Console_Puts(" Registered (4G)\r\n");
                 break;
             }
         }
         
-        RS485_SendString_NoDirChange(".");
-        HAL_Delay(2000);
+        Console_Puts(".");
+        RG200U_Wait(2000);
     }
     if (!test_ok)
     {
-        RS485_SendString_NoDirChange(" FAILED (not registered)\r\n");
+        Console_Puts(" FAILED (not registered)\r\n");
     }
     
     /* 步骤3: 查询运营商信息 */
-    RS485_SendString_NoDirChange("[3/5] Querying operator...");
+    Console_Puts("[3/5] Querying operator...");
     if (RG200U_SendATCommand("AT+COPS?\r\n", response, 3000))
     {
         /* 提取运营商名称: +COPS: 0,0,"CHN-UNICOM",13 */
         RG200U_ExtractString(response, "\"", "\"", operator_name, sizeof(operator_name));
         
         /* 显示运营商 */
-        RS485_SendString_NoDirChange(" ");
-        RS485_SendString_NoDirChange(operator_name);
-        RS485_SendString_NoDirChange("\r\n");
+        Console_Puts(" ");
+        Console_Puts(operator_name);
+        Console_Puts("\r\n");
     }
     else
     {
-        RS485_SendString_NoDirChange(" Timeout\r\n");
+        Console_Puts(" Timeout\r\n");
     }
     
     /* 步骤4: 执行拨号上网 */
-    RS485_SendString_NoDirChange("[4/5] Activating data connection...");
+    Console_Puts("[4/5] Activating data connection...");
     if (RG200U_SendATCommand("AT+QNETDEVCTL=1,1,1\r\n", response, 15000))  /* 拨号可能需要较长时间 */
     {
         if (strstr(response, "OK"))
         {
-            RS485_SendString_NoDirChange(" OK\r\n");
+            Console_Puts(" OK\r\n");
         }
         else if (strstr(response, "ERROR"))
         {
             /* 可能已经激活,继续 */
-            RS485_SendString_NoDirChange(" Already active\r\n");
+            Console_Puts(" Already active\r\n");
         }
     }
     else
     {
-        RS485_SendString_NoDirChange(" Timeout\r\n");
+        Console_Puts(" Timeout\r\n");
     }
     
     /* 步骤5: 查询IP地址 */
-    RS485_SendString_NoDirChange("[5/5] Querying IP address...");
+    Console_Puts("[5/5] Querying IP address...");
     
     /* 等待IP地址分配完成(静默延时10秒) */
     for (uint8_t i = 0; i < 10; i++)
     {
-        HAL_Delay(1000);
+        RG200U_Wait(1000);
     }
     
     if (RG200U_SendATCommand("AT+CGPADDR\r\n", response, 3000))
@@ -375,63 +371,49 @@ void RG200U_Init(void)
             }
         }
         
-        RS485_SendString_NoDirChange(" OK\r\n");
+        Console_Puts(" OK\r\n");
     }
     else
     {
-        RS485_SendString_NoDirChange(" Timeout\r\n");
+        Console_Puts(" Timeout\r\n");
     }
     
 show_result:
     /* 显示欢迎信息 */
-    RS485_SendString_NoDirChange("\r\n");
-    RS485_SendString_NoDirChange("==================================\r\n");
-    RS485_SendString_NoDirChange("  RG200U 4G Gateway Ready\r\n");
-    RS485_SendString_NoDirChange("==================================\r\n");
-    RS485_SendString_NoDirChange("Operator : ");
-    RS485_SendString_NoDirChange(operator_name);
-    RS485_SendString_NoDirChange("\r\n");
-    RS485_SendString_NoDirChange("IPv4     : ");
-    RS485_SendString_NoDirChange(ipv4);
-    RS485_SendString_NoDirChange("\r\n");
-    RS485_SendString_NoDirChange("IPv6     : ");
-    RS485_SendString_NoDirChange(ipv6);
-    RS485_SendString_NoDirChange("\r\n");
-    RS485_SendString_NoDirChange("==================================\r\n");
-    RS485_SendString_NoDirChange("Transparent mode enabled.\r\n\r\n");
-    
-    /* 等待发送完成 */
-    HAL_Delay(10);
+    Console_Puts("\r\n");
+    Console_Puts("==================================\r\n");
+    Console_Puts("  RG200U 4G Gateway Ready\r\n");
+    Console_Puts("==================================\r\n");
+    Console_Puts("Operator : ");
+    Console_Puts(operator_name);
+    Console_Puts("\r\n");
+    Console_Puts("IPv4     : ");
+    Console_Puts(ipv4);
+    Console_Puts("\r\n");
+    Console_Puts("IPv6     : ");
+    Console_Puts(ipv6);
+    Console_Puts("\r\n");
+    Console_Puts("==================================\r\n");
+    Console_Puts("Transparent mode enabled.\r\n\r\n");
     
     /* ========== 关键: 清空接收缓冲区,避免残留AT响应被转发 ========== */
     rx_read_index = rx_write_index;  /* 丢弃所有缓冲数据 */
     
     /* ========== 连接TCP服务器 ========== */
-    RS485_SendString_NoDirChange("\r\n");
-    RS485_SendString_NoDirChange("[TCP] Connecting to server...\r\n");
+    Console_Puts("\r\n");
+    Console_Puts("[TCP] Connecting to server...\r\n");
     
     if (RG200U_ConnectTCPServer())
     {
-        RS485_SendString_NoDirChange("[TCP] Connected to ");
-        RS485_SendString_NoDirChange(TCP_SERVER_IP);
-        RS485_SendString_NoDirChange(":");
-        RS485_SendString_NoDirChange(TCP_SERVER_PORT);
-        RS485_SendString_NoDirChange("\r\n");
-        RS485_SendString_NoDirChange("[TCP] TCP transparent mode enabled.\r\n");
+        Console_Puts("[TCP] Connected to " TCP_SERVER_IP ":" TCP_SERVER_PORT "\r\n");
+        Console_Puts("[TCP] TCP transparent mode enabled.\r\n");
     }
     else
     {
-        RS485_SendString_NoDirChange("[TCP] Connection failed!\r\n");
+        Console_Puts("[TCP] Connection failed!\r\n");
     }
     
-    RS485_SendString_NoDirChange("\r\n");
-    
-    /* 等待发送完成 */
-    HAL_Delay(10);
-    
-    /* 切回RS485接收模式 */
-    RS485_SetReceiveMode();
-    HAL_Delay(2);
+    Console_Puts("\r\n");
 }
 
 /**
@@ -484,6 +466,10 @@ void RG200U_UART_RxCallback(void)
         rg200u_rx_buffer[rx_write_index] = uart_rx_byte;
         rx_write_index = next_write_index;
     }
+    else
+    {
+        Metrics_Inc(METRIC_RG200U_RX_OVERFLOW);
+    }
     
     HAL_UART_Receive_IT(&huart5, &uart_rx_byte, 1);
 }
@@ -510,120 +496,38 @@ uint8_t RG200U_ConnectTCPServer(void)
     snprintf(cmd, sizeof(cmd), "AT+QIOPEN=1,%d,\"TCP\",\"%s\",%s,0,0\r\n", 
              TCP_SOCKET_ID, TCP_SERVER_IP, TCP_SERVER_PORT);
     
-    /* 切换到RS485发送模式显示调试信息 */
-#if RG200U_DEBUG_ENABLE
-    RS485_SetTransmitMode();
-    HAL_Delay(1);
-    RS485_SendString_NoDirChange("[DEBUG] Send: ");
-    RS485_SendString_NoDirChange(cmd);
-    RS485_SetReceiveMode();
-    HAL_Delay(10);
-#endif
+    EVENT_LOG1(MODEM_QIOPEN, TCP_SOCKET_ID);
     
     /* 发送连接命令 */
     tcp_state = TCP_STATE_CONNECTING;
     
     if (RG200U_SendATCommand(cmd, response, 5000))  /* 先等5秒获取OK */
     {
-        /* 显示第一次响应 */
-#if RG200U_DEBUG_ENABLE
-        RS485_SetTransmitMode();
-        HAL_Delay(1);
-        RS485_SendString_NoDirChange("[DEBUG] Response 1: ");
-        RS485_SendString_NoDirChange(response);
-        RS485_SendString_NoDirChange("\r\n");
-        RS485_SetReceiveMode();
-        HAL_Delay(10);
-#endif
-        
         /* 检查是否收到OK */
         if (strstr(response, "OK"))
         {
             /* OK收到，现在等待+QIOPEN通知（可能需要几秒） */
             /* 使用一次性长时间等待，而不是多次短时间等待 */
             memset(response, 0, sizeof(response));
-#if RG200U_DEBUG_ENABLE
-            RS485_SetTransmitMode();
-            HAL_Delay(1);
-            RS485_SendString_NoDirChange("[DEBUG] Waiting for +QIOPEN (up to 30s)...\r\n");
-            RS485_SetReceiveMode();
-            HAL_Delay(10);
-#endif
             
             if (RG200U_WaitForResponse("+QIOPEN:", response, sizeof(response), 30000))  /* 等待30秒 */
             {
-                /* 显示+QIOPEN响应 */
-#if RG200U_DEBUG_ENABLE
-                RS485_SetTransmitMode();
-                HAL_Delay(1);
-                RS485_SendString_NoDirChange("[DEBUG] QIOPEN: ");
-                RS485_SendString_NoDirChange(response);
-                RS485_SendString_NoDirChange("\r\n");
-                RS485_SetReceiveMode();
-                HAL_Delay(10);
-#endif
-                
                 /* 解析连接结果: +QIOPEN: <connectID>,<err> */
                 /* 如果err=0表示成功，err!=0表示失败 */
                 if (strstr(response, "+QIOPEN: 0,0") || strstr(response, "+QIOPEN: 0, 0"))
                 {
                     tcp_state = TCP_STATE_CONNECTED;
                     rx_read_index = rx_write_index;  /* 清空缓冲 */
+                    EVENT_LOG0(MODEM_CONNECTED);
                     return 1;
                 }
                 else
                 {
-                    /* 连接失败，解析并显示错误码 */
+                    /* 连接失败, 记录错误码 (含义见 decode_event_log.py) */
                     const char *qiopen = strstr(response, "+QIOPEN:");
-                    if (qiopen)
-                    {
-                        /* 提取错误码 */
-                        int conn_id, err_code;
-                        if (sscanf(qiopen, "+QIOPEN: %d,%d", &conn_id, &err_code) == 2)
-                        {
-                            char err_msg[100];
-                            RS485_SetTransmitMode();
-                            HAL_Delay(1);
-                            RS485_SendString_NoDirChange("[ERROR] Connection failed with code ");
-                            snprintf(err_msg, sizeof(err_msg), "%d", err_code);
-                            RS485_SendString_NoDirChange(err_msg);
-                            
-                            /* 显示错误码含义 */
-                            RS485_SendString_NoDirChange(" (");
-                            switch(err_code)
-                            {
-                                case 0:   RS485_SendString_NoDirChange("Operation success"); break;
-                                case 550: RS485_SendString_NoDirChange("Unknown error"); break;
-                                case 551: RS485_SendString_NoDirChange("Operation blocked"); break;
-                                case 552: RS485_SendString_NoDirChange("Invalid parameters"); break;
-                                case 553: RS485_SendString_NoDirChange("Memory not enough"); break;
-                                case 554: RS485_SendString_NoDirChange("Socket creation failed"); break;
-                                case 555: RS485_SendString_NoDirChange("Operation not supported"); break;
-                                case 556: RS485_SendString_NoDirChange("Socket bind failed"); break;
-                                case 557: RS485_SendString_NoDirChange("Socket listen failed"); break;
-                                case 558: RS485_SendString_NoDirChange("Socket write failed"); break;
-                                case 559: RS485_SendString_NoDirChange("Socket read failed"); break;
-                                case 560: RS485_SendString_NoDirChange("Socket accept failed"); break;
-                                case 561: RS485_SendString_NoDirChange("PDP context opening failed"); break;
-                                case 562: RS485_SendString_NoDirChange("PDP context closure failed"); break;
-                                case 563: RS485_SendString_NoDirChange("Socket identity has been used"); break;
-                                case 564: RS485_SendString_NoDirChange("DNS busy"); break;
-                                case 565: RS485_SendString_NoDirChange("DNS parse failed"); break;
-                                case 566: RS485_SendString_NoDirChange("Socket connect failed"); break;
-                                case 567: RS485_SendString_NoDirChange("Socket has been closed"); break;
-                                case 568: RS485_SendString_NoDirChange("Operation busy"); break;
-                                case 569: RS485_SendString_NoDirChange("Operation timeout"); break;
-                                case 570: RS485_SendString_NoDirChange("PDP context broken down"); break;
-                                case 571: RS485_SendString_NoDirChange("Cancel sending"); break;
-                                case 572: RS485_SendString_NoDirChange("Operation not allowed"); break;
-                                case 573: RS485_SendString_NoDirChange("APN not configured"); break;
-                                case 574: RS485_SendString_NoDirChange("Port busy"); break;
-                                default:  RS485_SendString_NoDirChange("Unknown"); break;
-                            }
-                            RS485_SendString_NoDirChange(")\r\n");
-                            RS485_SetReceiveMode();
-                        }
-                    }
+                    int conn_id, err_code;
+                    if (qiopen && sscanf(qiopen, "+QIOPEN: %d,%d", &conn_id, &err_code) == 2)
+                        EVENT_LOG1(MODEM_CONNECT_FAIL, err_code);
                     
                     tcp_state = TCP_STATE_ERROR;
                     return 0;
@@ -631,33 +535,18 @@ uint8_t RG200U_ConnectTCPServer(void)
             }
             
             /* 超时未收到+QIOPEN */
-#if RG200U_DEBUG_ENABLE
-            RS485_SetTransmitMode();
-            HAL_Delay(1);
-            RS485_SendString_NoDirChange("[DEBUG] Timeout waiting for +QIOPEN\r\n");
-            RS485_SetReceiveMode();
-#endif
+            EVENT_LOG0(MODEM_QIOPEN_TIMEOUT);
         }
         else
         {
             /* 未收到OK */
-#if RG200U_DEBUG_ENABLE
-            RS485_SetTransmitMode();
-            HAL_Delay(1);
-            RS485_SendString_NoDirChange("[DEBUG] No OK received\r\n");
-            RS485_SetReceiveMode();
-#endif
+            EVENT_LOG1(MODEM_QIOPEN_NO_OK, strlen(response));
         }
     }
     else
     {
         /* 命令发送失败 */
-#if RG200U_DEBUG_ENABLE
-        RS485_SetTransmitMode();
-        HAL_Delay(1);
-        RS485_SendString_NoDirChange("[DEBUG] AT command failed\r\n");
-        RS485_SetReceiveMode();
-#endif
+        EVENT_LOG0(MODEM_QIOPEN_NO_RSP);
     }
     
     tcp_state = TCP_STATE_ERROR;
@@ -673,22 +562,111 @@ TCP_State_t RG200U_GetTCPState(void)
     return tcp_state;
 }
 
+/**
+ * @brief  查询网络时间 (AT+QLTS=1, 由最近一次网络同步推算的 UTC 时间)
+ * @param  dt: 输出日期时间 (秒级精度)
+ * @retval 1:成功  0:模块尚未从网络获得时间/超时/接收缓冲区有未处理数据
+ * @note   AT 指令会清空接收缓冲区, 缓冲区中有数据或 URC 时不执行, 由调用者下次再试
+ */
+uint8_t RG200U_GetNetworkTime(TimeSync_DateTime_t *dt)
+{
+    char response[AT_RESPONSE_BUF_SIZE];
+    unsigned int year, month, day, hour, minute, second;
+    const char *p;
+
+    if (rx_read_index != rx_write_index)
+        return 0;
+
+    /* +QLTS: "2026/02/05,08:30:15+32,0" (时区以 15 分钟为单位, UTC 模式下忽略) */
+    if (!RG200U_SendATCommand("AT+QLTS=1\r\n", response, 1000))
+        return 0;
+    p = strstr(response, "+QLTS: \"");
+    if (p == NULL ||
+        sscanf(p + 8, "%u/%u/%u,%u:%u:%u", &year, &month, &day, &hour, &minute, &second) != 6)
+        return 0;
+    if (year < 2020 || month < 1 || month > 12 || day < 1 || day > 31 ||
+        hour > 23 || minute > 59 || second > 59)
+        return 0;
+
+    dt->year = (uint16_t)year;
+    dt->month = (uint8_t)month;
+    dt->day = (uint8_t)day;
+    dt->hour = (uint8_t)hour;
+    dt->minute = (uint8_t)minute;
+    dt->second = (uint8_t)second;
+    dt->ms = 0;
+    return 1;
+}
+
+/**
+ * @brief  查询信号强度 (AT+CSQ)
+ * @param  csq: 输出 0~31 (-113dBm + 2dBm*csq), 99 表示未知
+ * @retval 1:成功  0:超时/接收缓冲区有未处理数据
+ * @note   与 RG200U_GetNetworkTime 相同, 缓冲区中有数据或 URC 时不执行
+ */
+uint8_t RG200U_GetSignalQuality(uint8_t *csq)
+{
+    char response[AT_RESPONSE_BUF_SIZE];
+    unsigned int rssi, ber;
+    const char *p;
+
+    if (rx_read_index != rx_write_index)
+        return 0;
+
+    /* +CSQ: 24,99 */
+    if (!RG200U_SendATCommand("AT+CSQ\r\n", response, 1000))
+        return 0;
+    p = strstr(response, "+CSQ: ");
+    if (p == NULL || sscanf(p + 6, "%u,%u", &rssi, &ber) != 2)
+        return 0;
+
+    *csq = (rssi <= 31) ? (uint8_t)rssi : RG200U_CSQ_UNKNOWN;
+    return 1;
+}
+
+/**
+ * @brief  关闭TCP连接 (AT+QICLOSE)
+ * @note   由RG200U接收任务调用, 之后由 Uplink_Cell_Maintain 按重连间隔重新连接
+ */
+void RG200U_CloseTCPServer(void)
+{
+    char response[AT_RESPONSE_BUF_SIZE];
+    char cmd[32];
+
+    snprintf(cmd, sizeof(cmd), "AT+QICLOSE=%d\r\n", TCP_SOCKET_ID);
+    RG200U_SendATCommand(cmd, response, 2000);
+    tcp_state = TCP_STATE_DISCONNECTED;
+    Metrics_Inc(METRIC_CELL_DISCONNECTS);
+}
+
 /**
  * @brief  读取TCP数据
  * @param  buffer: 数据缓冲区
- * @param  max_len: 最大长度
+ * @param  max_len: 缓冲区大小, 最多读取 max_len-1 字节, 数据后补 '\0'
  * @retval 实际读取的字节数
+ * @note   响应格式 +QIRD: <length>\r\n<data>\r\n\r\nOK, 数据按长度截取,
+ *         可以包含 0 字节和 "OK" (MQTT 等二进制协议)
  */
-uint8_t RG200U_ReadTCPData(char *buffer, uint16_t max_len)
+uint16_t RG200U_ReadTCPData(char *buffer, uint16_t max_len)
 {
     char response[512];
     char cmd[32];
     uint16_t index = 0;
+    uint16_t data_off = 0;      /* 数据在 response 中的起始位置, 0 表示还没收到 +QIRD 行 */
     uint32_t start_tick;
     uint8_t data;
     int data_len = 0;
+    const char *qird;
+    const char *line_end;
+    
+    /* 留出结尾 '\0'; 响应中除数据外还有约 24 字节的 +QIRD 行和 OK */
+    if (max_len < 2)
+        return 0;
+    max_len--;
+    if (max_len > sizeof(response) - 32)
+        max_len = sizeof(response) - 32;
     
-    /* 构造读取命令: AT+QIRD=0,1500 */
+    /* 构造读取命令: AT+QIRD=0,<max_len> */
     snprintf(cmd, sizeof(cmd), "AT+QIRD=%d,%d\r\n", TCP_SOCKET_ID, max_len);
     
     /* 清空响应缓冲 */
@@ -699,7 +677,7 @@ uint8_t RG200U_ReadTCPData(char *buffer, uint16_t max_len)
     
     /* 发送读取命令 */
     HAL_UART_Transmit(&huart5, (uint8_t *)cmd, strlen(cmd), 1000);
-    HAL_Delay(100);  /* 等待模块处理 */
+    RG200U_Wait(100);  /* 等待模块处理 */
     
     /* 接收响应 */
     start_tick = HAL_GetTick();
@@ -710,49 +688,34 @@ uint8_t RG200U_ReadTCPData(char *buffer, uint16_t max_len)
             response[index++] = data;
             response[index] = '\0';
             
-            /* 如果收到OK,说明响应完整 */
-            if (strstr(response, "OK\r\n"))
-            {
-                break;
-            }
-        }
-        HAL_Delay(1);
-    }
-    
-    /* 解析响应: +QIRD: <length>\r\n<data>\r\nOK */
-    const char *qird = strstr(response, "+QIRD:");
-    if (qird)
-    {
-        /* 提取数据长度 */
-        if (sscanf(qird + 7, "%d", &data_len) == 1 && data_len > 0)
-        {
-            /* 查找数据起始位置（+QIRD行之后的\n） */
-            const char *line_end = strchr(qird, '\n');
-            if (line_end)
+            if (data_off == 0)
             {
-                const char *data_start = line_end + 1;  /* 跳过\n */
-                
-                /* 查找数据结束位置（OK之前） */
-                const char *ok_pos = strstr(data_start, "\r\nOK");
-                if (ok_pos)
+                /* +QIRD 行收完后记录数据长度和起始位置 (该行之前没有数据, 可以按字符串查找) */
+                qird = strstr(response, "+QIRD:");
+                if (qird && data == '\n' && sscanf(qird + 6, "%d", &data_len) == 1)
                 {
-                    /* 计算实际数据长度 */
-                    int actual_len = ok_pos - data_start;
-                    
-                    /* 复制数据到缓冲区 */
-                    int copy_len = (actual_len < max_len) ? actual_len : max_len;
-                    if (copy_len < data_len)
-                    {
-                        copy_len = (data_len < max_len) ? data_len : max_len;
-                    }
-                    
-                    memcpy(buffer, data_start, copy_len);
-                    buffer[copy_len] = '\0';
-                    
-                    return copy_len;
+                    line_end = strchr(qird, '\n');
+                    data_off = (uint16_t)(line_end + 1 - response);
+                    if (data_len <= 0)
+                        return 0;
+                    if (data_len > max_len)
+                        data_len = max_len;
+                }
+                else if (strstr(response, "ERROR\r\n"))
+                {
+                    return 0;
                 }
             }
+            else if (index >= data_off + data_len + 6 &&
+                     strstr(&response[data_off + data_len], "OK\r\n"))
+            {
+                /* 数据之后收到 OK, 响应完整 */
+                memcpy(buffer, &response[data_off], data_len);
+                buffer[data_len] = '\0';
+                return (uint16_t)data_len;
+            }
         }
+        RG200U_Wait(1);
     }
     
     return 0;
@@ -767,9 +730,6 @@ void RG200U_ProcessTCPMessage(void)
     static char buffer[RG200U_RX_BUFFER_SIZE];  /* 改为静态，保留上次的数据 */
     static uint16_t index = 0;
     uint8_t data;
-#if RG200U_DEBUG_ENABLE
-    static uint32_t last_debug_time = 0;
-#endif
     
     /* 检查是否有未处理的数据 */
     while (RG200U_ReceiveByte(&data))
@@ -779,88 +739,61 @@ void RG200U_ProcessTCPMessage(void)
             buffer[index++] = data;
             buffer[index] = '\0';
             
-            /* 每5秒打印一次缓冲区内容用于调试 */
-#if RG200U_DEBUG_ENABLE
-            if ((HAL_GetTick() - last_debug_time) > 5000 && index > 0)
-            {
-                RS485_SetTransmitMode();
-                HAL_Delay(1);
-                RS485_SendString_NoDirChange("\r\n[DEBUG] Buffer: ");
-                RS485_SendString_NoDirChange(buffer);
-                RS485_SendString_NoDirChange("\r\n");
-                RS485_SetReceiveMode();
-                HAL_Delay(10);
-                last_debug_time = HAL_GetTick();
-            }
-#endif
-            
             /* 检查是否收到TCP数据通知: +QIURC: "recv",0 */
             if (strstr(buffer, "+QIURC: \"recv\""))
             {
-                char tcp_data[512];
-                uint8_t len;
+                char tcp_data[480];
+                uint16_t len;
+                uint8_t reads = 0;
                 
-                /* 显示检测到通知 */
-#if RG200U_DEBUG_ENABLE
-                RS485_SetTransmitMode();
-                HAL_Delay(1);
-                RS485_SendString_NoDirChange("\r\n[DEBUG] Detected +QIURC recv notification\r\n");
-                RS485_SetReceiveMode();
-                HAL_Delay(10);
-#endif
+                EVENT_LOG0(MODEM_URC_RECV);
                 
                 /* 收到TCP数据通知，读取数据 */
-                HAL_Delay(50);  /* 短暂延时，等待数据准备好 */
+                RG200U_Wait(50);  /* 短暂延时，等待数据准备好 */
                 
-                len = RG200U_ReadTCPData(tcp_data, sizeof(tcp_data) - 1);
-                
-                /* 显示读取结果 */
-#if RG200U_DEBUG_ENABLE
-                RS485_SetTransmitMode();
-                HAL_Delay(1);
-                RS485_SendString_NoDirChange("[DEBUG] Read length: ");
+                /* 模块缓冲读空后才会再次通知, 读满一次说明可能还有数据 */
+                do
                 {
-                    char len_str[16];
-                    snprintf(len_str, sizeof(len_str), "%d", len);
-                    RS485_SendString_NoDirChange(len_str);
-                }
-                RS485_SendString_NoDirChange("\r\n");
-                RS485_SetReceiveMode();
-                HAL_Delay(10);
-#endif
+                    len = RG200U_ReadTCPData(tcp_data, sizeof(tcp_data));
                 
-                if (len > 0)
-                {
-                    /* 将TCP数据通过RS485发送到上位机 */
-                    RS485_SetTransmitMode();
-                    HAL_Delay(1);
-                    
-                    RS485_SendString_NoDirChange("\r\n[TCP RX] ");
-                    RS485_SendBuffer((uint8_t *)tcp_data, len);
-                    RS485_SendString_NoDirChange("\r\n");
-                    
-                    HAL_Delay(2);
-                    RS485_SetReceiveMode();
+                    EVENT_LOG1(MODEM_READ, len);
+                
+                    /* MQTT 上行模式: 数据交给上行发送任务 */
+                    if (len > 0 && Uplink_Cell_Deliver((const uint8_t *)tcp_data, len))
+                        continue;
+                
+                    if (len > 0)
+                    {
+                        /* 将TCP数据原样通过RS485发送到上位机 (占用总线,Modbus网关请求进行中时等待其完成);
+                         * 总线上只有数据, 提示信息输出到调试串口 */
+                        Console_Printf("[TCP RX] %u bytes -> RS485\r\n", len);
+                        RS485_AcquireBus(osWaitForever);
+                        RS485_SendBuffer((uint8_t *)tcp_data, len);
+                        RS485_ReleaseBus();
                     
-                    /* 处理接收到的命令 */
-                    RG200U_ProcessCommand(tcp_data, len);
-                }
+                        /* 处理接收到的命令 */
+                        RG200U_ProcessCommand(tcp_data, len);
+                    }
+                } while (len == sizeof(tcp_data) - 1 && ++reads < 8);
                 
                 /* 清空缓冲，准备下一次检测 */
                 index = 0;
                 memset(buffer, 0, sizeof(buffer));
             }
+            /* 服务器断开或PDP去激活: +QIURC: "closed",0 / +QIURC: "pdpdeact",1 */
+            else if (strstr(buffer, "+QIURC: \"closed\"") || strstr(buffer, "+QIURC: \"pdpdeact\""))
+            {
+                tcp_state = TCP_STATE_DISCONNECTED;
+                Metrics_Inc(METRIC_CELL_DISCONNECTS);
+                EVENT_LOG0(MODEM_CLOSED);
+                index = 0;
+                memset(buffer, 0, sizeof(buffer));
+            }
         }
         else
         {
             /* 缓冲区满，清空 */
-#if RG200U_DEBUG_ENABLE
-            RS485_SetTransmitMode();
-            HAL_Delay(1);
-            RS485_SendString_NoDirChange("\r\n[DEBUG] Buffer overflow, clearing\r\n");
-            RS485_SetReceiveMode();
-            HAL_Delay(10);
-#endif
+            EVENT_LOG1(MODEM_URC_OVERFLOW, index);
             
             index = 0;
             memset(buffer, 0, sizeof(buffer));
@@ -872,8 +805,9 @@ void RG200U_ProcessTCPMessage(void)
  * @brief  处理TCP接收到的命令
  * @param  cmd_data: 命令数据
  * @param  len: 数据长度
+ * @note   MQTT 上行模式下由命令主题的消息调用
  */
-static void RG200U_ProcessCommand(const char *cmd_data, uint16_t len)
+void RG200U_ProcessCommand(const char *cmd_data, uint16_t len)
 {
     /* 确保数据以null结尾 */
     char cmd[128];
@@ -889,43 +823,35 @@ static void RG200U_ProcessCommand(const char *cmd_data, uint16_t len)
     newline = strchr(cmd, '\n');
     if (newline) *newline = '\0';
     
-    /* 命令处理 */
-    RS485_SetTransmitMode();
-    HAL_Delay(1);
-    
+    /* 命令处理, 结果输出到调试串口 */
     if (strcmp(cmd, "RELAY1_ON") == 0)
     {
         /* 继电器1打开 */
         HAL_GPIO_WritePin(RELAY_K1_GPIO_Port, RELAY_K1_Pin, GPIO_PIN_SET);
-        RS485_SendString_NoDirChange("[CMD] RELAY1 ON\r\n");
+        Console_Puts("[CMD] RELAY1 ON\r\n");
     }
     else if (strcmp(cmd, "RELAY1_OFF") == 0)
     {
         /* 继电器1关闭 */
         HAL_GPIO_WritePin(RELAY_K1_GPIO_Port, RELAY_K1_Pin, GPIO_PIN_RESET);
-        RS485_SendString_NoDirChange("[CMD] RELAY1 OFF\r\n");
+        Console_Puts("[CMD] RELAY1 OFF\r\n");
     }
     else if (strcmp(cmd, "RELAY2_ON") == 0)
     {
         /* 继电器2打开 */
         HAL_GPIO_WritePin(RELAY_K2_GPIO_Port, RELAY_K2_Pin, GPIO_PIN_SET);
-        RS485_SendString_NoDirChange("[CMD] RELAY2 ON\r\n");
+        Console_Puts("[CMD] RELAY2 ON\r\n");
     }
     else if (strcmp(cmd, "RELAY2_OFF") == 0)
     {
         /* 继电器2关闭 */
         HAL_GPIO_WritePin(RELAY_K2_GPIO_Port, RELAY_K2_Pin, GPIO_PIN_RESET);
-        RS485_SendString_NoDirChange("[CMD] RELAY2 OFF\r\n");
+        Console_Puts("[CMD] RELAY2 OFF\r\n");
     }
     else
     {
         /* 未知命令 */
-        RS485_SendString_NoDirChange("[CMD] Unknown: ");
-        RS485_SendString_NoDirChange(cmd);
-        RS485_SendString_NoDirChange("\r\n");
+        Console_Printf("[CMD] Unknown: %s\r\n", cmd);
     }
-    
-    HAL_Delay(2);
-    RS485_SetReceiveMode();
 }
 
@@ -16,12 +16,11 @@ extern "C" {
 #include "stm32f1xx_hal.h"
 #include <stdint.h>
 #include <stdbool.h>
+#include "time_sync.h"
 
 /* Exported defines ----------------------------------------------------------*/
 #define RG200U_RX_BUFFER_SIZE   256
-
-/* 调试开关 - 设置为1启用调试信息,设置为0禁用所有调试信息 */
-#define RG200U_DEBUG_ENABLE     0    /* 1=显示调试信息, 0=隐藏调试信息 */
+#define RG200U_CSQ_UNKNOWN      99      /* AT+CSQ 信号强度未知 */
 
 /* TCP服务器配置 */
 #define TCP_SERVER_IP    "8.135.10.183"              /* 服务器IPv4地址 */
@@ -48,8 +47,16 @@ void RG200U_UART_RxCallback(void);
 /* TCP服务器连接相关函数 */
 uint8_t RG200U_ConnectTCPServer(void);
 TCP_State_t RG200U_GetTCPState(void);
-uint8_t RG200U_ReadTCPData(char *buffer, uint16_t max_len);
+void RG200U_CloseTCPServer(void);
+uint16_t RG200U_ReadTCPData(char *buffer, uint16_t max_len);
 void RG200U_ProcessTCPMessage(void);
+void RG200U_ProcessCommand(const char *cmd_data, uint16_t len);
+
+/* 网络时间 */
+uint8_t RG200U_GetNetworkTime(TimeSync_DateTime_t *dt);
+
+/* 信号强度 */
+uint8_t RG200U_GetSignalQuality(uint8_t *csq);
 
 
 #ifdef __cplusplus
@@ -20,11 +20,14 @@
 #include "usart.h"
 #include "gpio.h"
 #include "stm32f1xx.h"
+#include "cmsis_os.h"
+#include "metrics.h"
 
 /* Private typedef -----------------------------------------------------------*/
 
 /* Private define ------------------------------------------------------------*/
 #define RS485_RX_BUFFER_SIZE  256
+#define RS485_FRAME_GAP_MS    3       /* 接收静默超过该时间后的字节计为新的一帧 (统计用) */
 
 /* Private macro -------------------------------------------------------------*/
 
@@ -33,6 +36,11 @@ static uint8_t rs485_rx_buffer[RS485_RX_BUFFER_SIZE];
 static volatile uint16_t rs485_rx_write_index = 0;
 static volatile uint16_t rs485_rx_read_index = 0;
 static uint8_t rs485_uart_rx_byte;
+static uint32_t rs485_rx_last_tick = 0;
+
+/* 总线占用锁: 透传发送与 Modbus 网关主站共用同一条总线 */
+static osMutexId rs485_bus_mutex = NULL;
+static osStaticMutexDef_t rs485_bus_mutex_cb;
 
 /* Private function prototypes -----------------------------------------------*/
 
@@ -56,6 +64,7 @@ void RS485_SetTransmitMode(void)
     /* MAX13487发送模式: RE#=1(接收禁止), SHDN#=1(芯片工作) */
     HAL_GPIO_WritePin(RS485_RE_GPIO_Port, RS485_RE_Pin, GPIO_PIN_SET);     // RE# = 1
     HAL_GPIO_WritePin(RS485_DE_GPIO_Port, RS485_DE_Pin, GPIO_PIN_SET);     // SHDN# = 1
+    Metrics_Inc(METRIC_RS485_TX_FRAMES);
 }
 
 /**
@@ -70,6 +79,32 @@ void RS485_Init(void)
     
     /* 启动UART中断接收 */
     HAL_UART_Receive_IT(&huart1, &rs485_uart_rx_byte, 1);
+    
+    /* 创建总线锁(调度器启动前创建) */
+    if (rs485_bus_mutex == NULL)
+    {
+        osMutexStaticDef(RS485_Bus, &rs485_bus_mutex_cb);
+        rs485_bus_mutex = osMutexCreate(osMutex(RS485_Bus));
+    }
+}
+
+/**
+ * @brief  占用RS485总线
+ */
+uint8_t RS485_AcquireBus(uint32_t timeout_ms)
+{
+    if (rs485_bus_mutex == NULL)
+        return 1;
+    return osMutexWait(rs485_bus_mutex, timeout_ms) == osOK;
+}
+
+/**
+ * @brief  释放RS485总线
+ */
+void RS485_ReleaseBus(void)
+{
+    if (rs485_bus_mutex != NULL)
+        osMutexRelease(rs485_bus_mutex);
 }
 
 /**
@@ -80,6 +115,7 @@ void RS485_SendByte(uint8_t data)
     /* 等待发送数据寄存器空 */
     while(!(USART1->SR & USART_SR_TXE));
     USART1->DR = data;
+    Metrics_Inc(METRIC_RS485_TX_BYTES);
     
     /* 等待发送完成 */
     while(!(USART1->SR & USART_SR_TC));
@@ -154,12 +190,22 @@ uint8_t RS485_ReceiveByte(uint8_t *data)
 void RS485_UART_RxCallback(void)
 {
     uint16_t next_write_index = (rs485_rx_write_index + 1) % RS485_RX_BUFFER_SIZE;
+    uint32_t now = HAL_GetTick();
+    
+    Metrics_Inc(METRIC_RS485_RX_BYTES);
+    if ((now - rs485_rx_last_tick) > RS485_FRAME_GAP_MS)
+        Metrics_Inc(METRIC_RS485_RX_FRAMES);
+    rs485_rx_last_tick = now;
     
     if (next_write_index != rs485_rx_read_index)
     {
         rs485_rx_buffer[rs485_rx_write_index] = rs485_uart_rx_byte;
         rs485_rx_write_index = next_write_index;
     }
+    else
+    {
+        Metrics_Inc(METRIC_RS485_RX_OVERFLOW);
+    }
     
     HAL_UART_Receive_IT(&huart1, &rs485_uart_rx_byte, 1);
 }
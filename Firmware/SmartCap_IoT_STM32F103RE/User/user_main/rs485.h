@@ -78,6 +78,19 @@ void RS485_SendString_NoDirChange(const char *str);
  */
 void RS485_SendBuffer(uint8_t *buf, uint16_t len);
 
+/**
+ * @brief  占用RS485总线
+ * @param  timeout_ms: 最长等待时间
+ * @retval 1:成功  0:超时
+ * @note   一次完整的发送(或Modbus请求+应答)期间持有,避免多个任务同时驱动总线
+ */
+uint8_t RS485_AcquireBus(uint32_t timeout_ms);
+
+/**
+ * @brief  释放RS485总线
+ */
+void RS485_ReleaseBus(void);
+
 /**
  * @brief  接收一个字节(非阻塞)
  * @param  data: 接收数据存储指针
@@ -0,0 +1,194 @@
+/**
+  ******************************************************************************
+  * @file    rtos_stats.c
+  * @brief   FreeRTOS Run-Time Statistics
+  ******************************************************************************
+  * @description
+  * 每个任务的运行时间计数 (ulRunTimeCounter) 由内核在切换任务时累加 CYCCNT 的增量,
+  * 本模块保存上一次快照的计数, 两次快照之差除以同期的总计数即为窗口内的 CPU 占用。
+  * 任务按 xTaskNumber 对应, 窗口内新建的任务从下一个窗口开始统计。
+  * 快照和结果只在默认任务中访问, 不加锁。
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "rtos_stats.h"
+#include "metrics.h"
+#include "event_log.h"
+#include "cmsis_os.h"
+#include "main.h"
+#include <string.h>
+
+#if RTOS_STATS_ENABLE
+
+/* Private defines -----------------------------------------------------------*/
+#define RTOS_STATS_IDLE_NAME    "IDLE"          /* tasks.c 中空闲任务的默认名称 */
+#define RTOS_STATS_BKP_MAGIC    0x5354          /* BKP->DR1: 上次复位前发生了栈溢出 */
+
+/* Private variables ---------------------------------------------------------*/
+static TaskStatus_t rtos_status[RTOS_STATS_TASKS_MAX];
+static RtosStats_Task_t rtos_tasks[RTOS_STATS_TASKS_MAX];
+static uint8_t rtos_task_count = 0;
+static uint16_t rtos_cpu_load = 0;
+
+static UBaseType_t prev_number[RTOS_STATS_TASKS_MAX];
+static uint32_t prev_counter[RTOS_STATS_TASKS_MAX];
+static uint8_t prev_count = 0;
+static uint32_t prev_total = 0;
+static uint8_t prev_valid = 0;
+
+static uint32_t rtos_tick = 0;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief  记录上次复位前的栈溢出
+ */
+void RtosStats_Init(void)
+{
+    __HAL_RCC_PWR_CLK_ENABLE();
+    __HAL_RCC_BKP_CLK_ENABLE();
+
+    if ((BKP->DR1 & 0xFFFF) == RTOS_STATS_BKP_MAGIC)
+    {
+        EVENT_LOG1(STACK_OVERFLOW, (BKP->DR2 & 0xFFFF) | ((BKP->DR3 & 0xFFFF) << 16));
+        HAL_PWR_EnableBkUpAccess();
+        BKP->DR1 = 0;
+        HAL_PWR_DisableBkUpAccess();
+    }
+    rtos_tick = osKernelSysTick();
+}
+
+/**
+ * @brief  窗口结束时取快照并更新仪表
+ */
+void RtosStats_Poll(void)
+{
+    uint32_t total;
+    UBaseType_t count;
+
+    if ((osKernelSysTick() - rtos_tick) < RTOS_STATS_WINDOW_MS)
+        return;
+    rtos_tick = osKernelSysTick();
+
+    count = uxTaskGetSystemState(rtos_status, RTOS_STATS_TASKS_MAX, &total);
+    RtosStats_Update(rtos_status, (uint8_t)count, total);
+    Metrics_Set(METRIC_HEAP_MIN_FREE, xPortGetMinimumEverFreeHeapSize());
+}
+
+/**
+ * @brief  由快照计算各任务 CPU 占用和栈余量
+ */
+void RtosStats_Update(const TaskStatus_t *status, uint8_t count, uint32_t total)
+{
+    uint32_t span = total - prev_total;         /* 回绕后无符号相减仍正确 */
+    uint32_t delta;
+    uint32_t stack_min = 0xFFFFFFFFUL;
+    uint16_t idle = 10000;
+    uint8_t i, j;
+
+    if (count > RTOS_STATS_TASKS_MAX)
+        count = RTOS_STATS_TASKS_MAX;
+
+    for (i = 0; i < count; i++)
+    {
+        RtosStats_Task_t *t = &rtos_tasks[i];
+
+        delta = 0;
+        for (j = 0; j < prev_count; j++)
+        {
+            if (prev_number[j] == status[i].xTaskNumber)
+            {
+                delta = status[i].ulRunTimeCounter - prev_counter[j];
+                break;
+            }
+        }
+
+        strncpy(t->name, status[i].pcTaskName, sizeof(t->name) - 1);
+        t->name[sizeof(t->name) - 1] = '\0';
+        t->priority = (uint8_t)status[i].uxCurrentPriority;
+        t->state = (uint8_t)status[i].eCurrentState;
+        t->number = (uint8_t)status[i].xTaskNumber;
+        t->cpu = (prev_valid && span) ? (uint16_t)(((uint64_t)delta * 10000U) / span) : 0;
+        if (t->cpu > 10000)
+            t->cpu = 10000;
+        t->stack_free = (uint16_t)status[i].usStackHighWaterMark;
+
+        if (t->stack_free < stack_min)
+            stack_min = t->stack_free;
+        if (strcmp(t->name, RTOS_STATS_IDLE_NAME) == 0)
+            idle = t->cpu;
+    }
+
+    /* 全部对应完再更新基准, 任务顺序变化时不会覆盖后面还要查的旧值 */
+    for (i = 0; i < count; i++)
+    {
+        prev_number[i] = status[i].xTaskNumber;
+        prev_counter[i] = status[i].ulRunTimeCounter;
+    }
+
+    rtos_task_count = count;
+    rtos_cpu_load = prev_valid ? (uint16_t)((10000 - idle) / 10) : 0;
+    prev_count = count;
+    prev_total = total;
+    prev_valid = 1;
+
+    Metrics_Set(METRIC_CPU_LOAD, rtos_cpu_load);
+    if (count > 0)
+        Metrics_Set(METRIC_STACK_MIN_FREE, stack_min);
+}
+
+/**
+ * @brief  复制上一个窗口的结果
+ */
+uint8_t RtosStats_GetTasks(RtosStats_Task_t *tasks, uint8_t max)
+{
+    uint8_t n = (rtos_task_count < max) ? rtos_task_count : max;
+
+    memcpy(tasks, rtos_tasks, n * sizeof(RtosStats_Task_t));
+    return n;
+}
+
+uint16_t RtosStats_CpuLoad(void)
+{
+    return rtos_cpu_load;
+}
+
+/* FreeRTOS hooks ------------------------------------------------------------*/
+
+/**
+ * @brief  运行时间计数使用 DWT 周期计数器 (portCONFIGURE_TIMER_FOR_RUN_TIME_STATS)
+ */
+void configureTimerForRunTimeStats(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+unsigned long getRunTimeCounterValue(void)
+{
+    return DWT->CYCCNT;
+}
+
+/**
+ * @brief  栈溢出: 任务名按 %S 格式保存到备份寄存器后复位 (栈已损坏, 不再调用其它模块)
+ */
+void vApplicationStackOverflowHook(TaskHandle_t xTask, char *pcTaskName)
+{
+    uint32_t tag = 0;
+    uint8_t i;
+
+    for (i = 0; i < 4 && pcTaskName[i]; i++)
+        tag |= (uint32_t)(uint8_t)pcTaskName[i] << (8 * i);
+
+    __HAL_RCC_PWR_CLK_ENABLE();
+    __HAL_RCC_BKP_CLK_ENABLE();
+    HAL_PWR_EnableBkUpAccess();
+    BKP->DR2 = tag & 0xFFFF;
+    BKP->DR3 = tag >> 16;
+    BKP->DR1 = RTOS_STATS_BKP_MAGIC;
+    NVIC_SystemReset();
+}
+
+#endif /* RTOS_STATS_ENABLE */
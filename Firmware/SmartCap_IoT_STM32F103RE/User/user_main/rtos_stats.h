@@ -0,0 +1,79 @@
+/**
+  ******************************************************************************
+  * @file    rtos_stats.h
+  * @brief   FreeRTOS Run-Time Statistics Header
+  ******************************************************************************
+  * @description
+  * 任务 CPU 占用、栈余量和堆最小剩余:
+  * - 运行时间计数使用 DWT->CYCCNT (72MHz, 约 60 秒回绕一次), 只统计 RTOS_STATS_WINDOW_MS
+  *   窗口内的增量, 窗口远小于回绕周期, 回绕不影响结果
+  * - 默认任务调用 RtosStats_Poll, 每个窗口结束时用 uxTaskGetSystemState 取一次快照,
+  *   结果由调试串口 tasks 命令显示, 汇总值写入仪表 (METRIC_CPU_LOAD 等)
+  * - 栈溢出 (configCHECK_FOR_STACK_OVERFLOW=2) 时把任务名前 4 个字符写入备份寄存器并复位,
+  *   下次启动由 RtosStats_Init 记录 STACK_OVERFLOW 事件
+  ******************************************************************************
+  */
+
+#ifndef __RTOS_STATS_H__
+#define __RTOS_STATS_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "FreeRTOS.h"
+#include "task.h"
+#include <stdint.h>
+
+/* Exported defines ----------------------------------------------------------*/
+#define RTOS_STATS_ENABLE       1       /* 需要 configGENERATE_RUN_TIME_STATS 和 configUSE_TRACE_FACILITY */
+
+#define RTOS_STATS_TASKS_MAX    12      /* 快照中的任务数, 多出的任务不统计 */
+#define RTOS_STATS_WINDOW_MS    5000    /* CPU 占用的统计窗口, 须小于 CYCCNT 回绕周期 */
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct {
+    char name[configMAX_TASK_NAME_LEN];
+    uint8_t priority;
+    uint8_t state;                      /* eTaskState */
+    uint8_t number;                     /* xTaskNumber, 时间线记录 (trace.h) 中的任务号 */
+    uint16_t cpu;                       /* 上一个窗口的 CPU 占用, 0.01% */
+    uint16_t stack_free;                /* 栈的历史最小剩余, 字 (4 字节) */
+} RtosStats_Task_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief  记录上次复位前的栈溢出, 在 EventLog_Init 之后调用一次
+ */
+void RtosStats_Init(void);
+
+/**
+ * @brief  窗口结束时取快照并更新仪表, 由默认任务周期调用
+ */
+void RtosStats_Poll(void);
+
+/**
+ * @brief  由快照计算各任务 CPU 占用和栈余量 (不访问硬件, RtosStats_Poll 调用)
+ * @param  status: uxTaskGetSystemState 的结果
+ * @param  total:  取快照时的运行时间计数
+ */
+void RtosStats_Update(const TaskStatus_t *status, uint8_t count, uint32_t total);
+
+/**
+ * @brief  复制上一个窗口的结果
+ * @retval 任务数
+ */
+uint8_t RtosStats_GetTasks(RtosStats_Task_t *tasks, uint8_t max);
+
+/**
+ * @brief  上一个窗口的 CPU 占用 (空闲任务以外), 0.1%
+ */
+uint16_t RtosStats_CpuLoad(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __RTOS_STATS_H__ */
@@ -0,0 +1,96 @@
+/**
+  ******************************************************************************
+  * @file    task_wdg.c
+  * @brief   Task Liveness Check and Independent Watchdog Feed
+  ******************************************************************************
+  * @description
+  * 报到时间只由对应的任务写 (32 位写入是原子的), 默认任务只读, 不加锁。
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "task_wdg.h"
+#include "event_log.h"
+#include "console.h"
+#include "cmsis_os.h"
+#include "stm32f1xx_hal.h"
+
+/* Private defines -----------------------------------------------------------*/
+#define TASK_WDG_RELOAD_KEY     0xAAAA
+#define TASK_WDG_START_KEY      0xCCCC
+#define TASK_WDG_ACCESS_KEY     0x5555
+#define TASK_WDG_PRESCALER      6           /* LSI 40kHz / 256, 与引导程序相同 */
+#define TASK_WDG_RELOAD         4095        /* 约 26 秒 */
+
+/* Private variables ---------------------------------------------------------*/
+static volatile uint32_t wdg_tick[TASK_WDG_COUNT];     /* 最后一次报到的时间, 启动时为 0 */
+static uint8_t wdg_stalled = 0;                         /* 已记录超时, 不再重复记录 */
+
+/* 报到期限 (ms) 和事件日志中的名称 */
+static const uint32_t wdg_limit_ms[TASK_WDG_COUNT] = {
+    2000,       /* RS485 接收: 每 1ms 循环一次 */
+    20000,      /* RG200U 接收: AT 指令等待期间每毫秒报到, 留出等待 RS485 总线的时间 */
+    5000,       /* RS485 发送: 等待 Modbus 网关释放总线 */
+    20000,      /* RG200U 发送: 上行路由和 MQTT 会话维护 */
+};
+static const char *const wdg_name[TASK_WDG_COUNT] = {
+    "485r", "celr", "485t", "celt",
+};
+
+/* Exported functions --------------------------------------------------------*/
+
+void TaskWdg_Start(void)
+{
+    /* 调试器暂停内核时看门狗也停止计数 */
+    __HAL_DBGMCU_FREEZE_IWDG();
+
+    /* 试运行时引导程序已启动, 重新写入相同的配置 */
+    IWDG->KR = TASK_WDG_START_KEY;
+    IWDG->KR = TASK_WDG_ACCESS_KEY;
+    IWDG->PR = TASK_WDG_PRESCALER;
+    IWDG->RLR = TASK_WDG_RELOAD;
+    while (IWDG->SR != 0)
+        ;
+    IWDG->KR = TASK_WDG_RELOAD_KEY;
+}
+
+void TaskWdg_CheckIn(TaskWdg_ID_t id)
+{
+    wdg_tick[id] = osKernelSysTick();
+}
+
+uint8_t TaskWdg_AllAlive(void)
+{
+    uint32_t now = osKernelSysTick();
+    uint8_t i;
+
+    for (i = 0; i < TASK_WDG_COUNT; i++)
+    {
+        if ((now - wdg_tick[i]) > wdg_limit_ms[i])
+            return 0;
+    }
+    return 1;
+}
+
+void TaskWdg_Poll(void)
+{
+    uint32_t now = osKernelSysTick();
+    uint8_t i;
+
+    for (i = 0; i < TASK_WDG_COUNT; i++)
+    {
+        if ((now - wdg_tick[i]) > wdg_limit_ms[i])
+        {
+            if (!wdg_stalled)
+            {
+                wdg_stalled = 1;
+                Console_Printf("WDG: task %s stalled for %lu ms\r\n", wdg_name[i], (unsigned long)(now - wdg_tick[i]));
+                EVENT_LOG2(TASK_STALLED, EventLog_Tag(wdg_name[i]), now - wdg_tick[i]);
+            }
+            return;
+        }
+    }
+
+    wdg_stalled = 0;
+    IWDG->KR = TASK_WDG_RELOAD_KEY;
+}
@@ -0,0 +1,66 @@
+/**
+  ******************************************************************************
+  * @file    task_wdg.h
+  * @brief   Task Liveness Check and Independent Watchdog Feed Header
+  ******************************************************************************
+  * @description
+  * 独立看门狗 (IWDG) 在 User_main 中启动 (试运行新固件时引导程序已提前启动), 约 26 秒超时,
+  * 启动后不能停止:
+  * - 透传的 4 个任务每次循环调用 TaskWdg_CheckIn 报到
+  * - 默认任务调用 TaskWdg_Poll, 所有任务都在各自的期限内报到过时才喂狗;
+  *   某个任务超过期限未报到时记录 TASK_STALLED 并停止喂狗, 由看门狗复位
+  * - 默认任务自己卡住时也不再喂狗, 所以不需要单独报到
+  * 各任务的期限 (task_wdg.c) 按该任务最长的正常阻塞时间设置。蜂窝模块初始化和连接
+  * 需要数十秒, 在 RG200U 接收任务中进行, 每次等待都报到 (rg200u.c); 默认任务在
+  * 初始化各步骤之间喂狗。
+  ******************************************************************************
+  */
+
+#ifndef __TASK_WDG_H__
+#define __TASK_WDG_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum {
+    TASK_WDG_RS485_RX = 0,
+    TASK_WDG_RG200U_RX,
+    TASK_WDG_RS485_TX,
+    TASK_WDG_RG200U_TX,
+    TASK_WDG_COUNT
+} TaskWdg_ID_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief  启动独立看门狗, 在调度器启动前调用一次 (User_main)
+ * @note   之后的约 26 秒内默认任务必须开始调用 TaskWdg_Poll
+ */
+void TaskWdg_Start(void);
+
+/**
+ * @brief  任务报到, 在任务主循环中调用
+ */
+void TaskWdg_CheckIn(TaskWdg_ID_t id);
+
+/**
+ * @brief  所有任务都在期限内报到过
+ * @retval 1:是  0:有任务超时
+ */
+uint8_t TaskWdg_AllAlive(void);
+
+/**
+ * @brief  检查任务报到, 正常时喂狗, 由默认任务周期调用
+ */
+void TaskWdg_Poll(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TASK_WDG_H__ */
@@ -0,0 +1,564 @@
+/**
+  ******************************************************************************
+  * @file    time_sync.c
+  * @brief   System Clock Discipline (SNTP / Cellular Network Time)
+  ******************************************************************************
+  * @description
+  * 墙上时钟模型 (d = 单调时钟 - 参考点):
+  *   UTC = anchor_unix + d + (d * freq_ppb + min(d, slew_ms) * slew_ppb) / 1e9
+  * 每次校正先把参考点移到当前时刻 (已执行的渐进调整并入 anchor_unix), 再修改
+  * 偏移/速率, 所以换算结果连续; 频偏和调整速率之和远小于 1, 渐进调整期间
+  * 墙上时钟单调不减。
+  *
+  * 时钟状态由默认任务 (SNTP) 和 RG200U 接收任务 (网络时间) 修改, 由任意任务
+  * 读取, 读写都在关中断的短临界区内完成 (与 wiz_timer 相同, 调度器启动前也可用)。
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "time_sync.h"
+#include "wiz_supervisor.h"
+#include "wiz_sockbuf.h"
+#include "wiz_dns.h"
+#include "wiz_txq.h"
+#include "event_log.h"
+#include "socket.h"
+#include "cmsis_os.h"
+#include "stm32f1xx.h"
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define SNTP_SERVER_PORT        123
+#define SNTP_LOCAL_PORT         50123
+#define SNTP_MSG_LEN            48
+#define SNTP_MODE_CLIENT        3
+#define SNTP_MODE_SERVER        4
+#define SNTP_VERSION            4
+#define SNTP_LI_ALARM           3       /* 服务器未同步 */
+#define SNTP_NTP_UNIX_DELTA     2208988800LL    /* 1900-01-01 到 1970-01-01 的秒数 */
+
+#define PPB                     1000000000LL
+#define SECS_PER_DAY            86400L
+#define DAYS_0000_TO_1970       719468L /* 0000-03-01 到 1970-01-01 的天数 (以 3 月为年首) */
+#define DAYS_PER_ERA            146097L /* 400 年 */
+
+/* Private types -------------------------------------------------------------*/
+typedef struct {
+    uint64_t anchor_mono;               /* 参考点 (单调时钟, ms) */
+    int64_t anchor_unix;                /* 参考点对应的 UTC (Unix ms) */
+    int32_t freq_ppb;                   /* 频偏补偿 */
+    int32_t slew_ppb;                   /* 渐进调整速率 */
+    uint32_t slew_ms;                   /* 从参考点起渐进调整的持续时间 */
+} TimeSync_Clock_t;
+
+/* Private variables ---------------------------------------------------------*/
+static TimeSync_Clock_t clk;
+static volatile uint8_t synced = 0;
+
+static uint32_t mono_last = 0;          /* 上一次读到的 tick */
+static uint32_t mono_high = 0;          /* tick 回绕次数 */
+
+static uint64_t freq_base_ms = 0;       /* 上一次 SNTP 校正时刻, 频偏估计的起点 */
+static uint8_t freq_base_valid = 0;
+
+static uint64_t sntp_next_ms = 0;
+static uint32_t sntp_poll_s = TIME_SYNC_POLL_MIN_S;
+static volatile uint32_t sntp_last_s = 0;
+static volatile uint8_t sntp_ever = 0;
+static uint8_t sntp_nonce[8];
+static uint32_t sntp_seed = 0;
+
+static uint32_t modem_last_s = 0;
+static uint8_t modem_queried = 0;
+
+static TimeSync_Stats_t stats;
+
+static const uint8_t sntp_fallback_ip[4] = TIME_SYNC_SNTP_FALLBACK_IP;
+
+/* Private functions ---------------------------------------------------------*/
+
+static uint32_t TimeSync_Lock(void)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    return primask;
+}
+
+static void TimeSync_Unlock(uint32_t primask)
+{
+    if (!primask)
+        __enable_irq();
+}
+
+static uint32_t TimeSync_Rd32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static int64_t TimeSync_Abs(int64_t v)
+{
+    return (v < 0) ? -v : v;
+}
+
+/**
+ * @brief  按时钟模型换算 UTC
+ */
+static int64_t TimeSync_ClockAt(const TimeSync_Clock_t *c, uint64_t mono)
+{
+    int64_t d = (int64_t)(mono - c->anchor_mono);
+    int64_t s = d;
+
+    if (s < 0)
+        s = 0;
+    else if (s > (int64_t)c->slew_ms)
+        s = c->slew_ms;
+    return c->anchor_unix + d + (d * c->freq_ppb + s * c->slew_ppb) / PPB;
+}
+
+/**
+ * @brief  读取时钟状态的一致副本
+ */
+static void TimeSync_Snapshot(TimeSync_Clock_t *c)
+{
+    uint32_t primask = TimeSync_Lock();
+    *c = clk;
+    TimeSync_Unlock(primask);
+}
+
+/**
+ * @brief  天数 (相对 1970-01-01) 转公历日期 (H. Hinnant, civil_from_days)
+ */
+static void TimeSync_CivilFromDays(int32_t z, uint16_t *y, uint8_t *m, uint8_t *d)
+{
+    int32_t era, doe, yoe, doy, mp, year;
+
+    z += DAYS_0000_TO_1970;
+    era = (z >= 0 ? z : z - (DAYS_PER_ERA - 1)) / DAYS_PER_ERA;
+    doe = z - era * DAYS_PER_ERA;
+    yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    mp = (5 * doy + 2) / 153;
+    *d = (uint8_t)(doy - (153 * mp + 2) / 5 + 1);
+    *m = (uint8_t)(mp < 10 ? mp + 3 : mp - 9);
+    year = yoe + era * 400 + (*m <= 2);
+    *y = (uint16_t)year;
+}
+
+/**
+ * @brief  公历日期转天数 (相对 1970-01-01) (H. Hinnant, days_from_civil)
+ */
+static int32_t TimeSync_DaysFromCivil(int32_t y, uint32_t m, uint32_t d)
+{
+    int32_t era, yoe, doy, doe;
+
+    y -= (m <= 2);
+    era = (y >= 0 ? y : y - 399) / 400;
+    yoe = y - era * 400;
+    doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * DAYS_PER_ERA + doe - DAYS_0000_TO_1970;
+}
+
+/**
+ * @brief  校正时钟
+ * @param  offset_ms: 时间源 - 本机
+ * @param  src: 时间源
+ * @retval 1:跳变  0:渐进调整或未采用
+ */
+static uint8_t TimeSync_Correct(int64_t offset_ms, TimeSync_Source_t src)
+{
+    uint64_t now = TimeSync_MonotonicMs();
+    int64_t elapsed, pending, err_ppb;
+    int64_t freq;
+    uint8_t stepped = 0;
+    uint32_t primask;
+
+    primask = TimeSync_Lock();
+
+    /* 网络时间只有秒级精度, 已同步时只用来纠正大的偏差 */
+    if (src == TIME_SRC_MODEM && synced && TimeSync_Abs(offset_ms) <= TIME_SYNC_MODEM_STEP_MS)
+    {
+        TimeSync_Unlock(primask);
+        return 0;
+    }
+
+    /* 参考点移到当前时刻, 记下尚未执行的调整量 */
+    elapsed = (int64_t)(now - clk.anchor_mono);
+    if (elapsed > (int64_t)clk.slew_ms)
+        elapsed = clk.slew_ms;
+    pending = ((int64_t)clk.slew_ms - elapsed) * clk.slew_ppb / PPB;
+    clk.anchor_unix = TimeSync_ClockAt(&clk, now);
+    clk.anchor_mono = now;
+    clk.slew_ms = 0;
+    clk.slew_ppb = 0;
+
+    if (!synced || src == TIME_SRC_MODEM || TimeSync_Abs(offset_ms) > TIME_SYNC_STEP_MS)
+    {
+        clk.anchor_unix += offset_ms;
+        stepped = 1;
+        stats.steps++;
+    }
+    else
+    {
+        /*
+         * 两次校正之间的残余偏移 (去掉未执行完的调整量) 来自晶振频偏; 折算后超出晶振范围的
+         * 是服务器时间或路径的变化, 只做渐进调整, 否则会被当成频偏持续累积
+         */
+        if (freq_base_valid && now - freq_base_ms >= TIME_SYNC_FREQ_MIN_S * 1000UL)
+        {
+            err_ppb = (offset_ms - pending) * PPB / (int64_t)(now - freq_base_ms);
+            if (TimeSync_Abs(err_ppb) <= TIME_SYNC_FREQ_MAX_PPM * 1000L)
+            {
+                freq = clk.freq_ppb + err_ppb / TIME_SYNC_FREQ_GAIN;
+                if (freq > TIME_SYNC_FREQ_MAX_PPM * 1000L)
+                    freq = TIME_SYNC_FREQ_MAX_PPM * 1000L;
+                else if (freq < -TIME_SYNC_FREQ_MAX_PPM * 1000L)
+                    freq = -TIME_SYNC_FREQ_MAX_PPM * 1000L;
+                clk.freq_ppb = (int32_t)freq;
+                stats.freq_updates++;
+            }
+        }
+        if (offset_ms != 0)
+        {
+            clk.slew_ppb = (offset_ms > 0) ? TIME_SYNC_SLEW_PPM * 1000L : -TIME_SYNC_SLEW_PPM * 1000L;
+            clk.slew_ms = (uint32_t)(TimeSync_Abs(offset_ms) * 1000000L / TIME_SYNC_SLEW_PPM);
+            stats.slews++;
+        }
+    }
+
+    if (src == TIME_SRC_SNTP)
+    {
+        freq_base_ms = now;
+        freq_base_valid = 1;
+        sntp_last_s = (uint32_t)(now / 1000);
+        sntp_ever = 1;
+        stats.sntp_replies++;
+    }
+    else
+    {
+        stats.modem_samples++;
+    }
+    synced = 1;
+    stats.source = src;
+    stats.freq_ppb = clk.freq_ppb;
+    stats.last_sync_s = (uint32_t)(now / 1000);
+    stats.last_offset_ms = (offset_ms > INT32_MAX) ? INT32_MAX : (offset_ms < INT32_MIN) ? INT32_MIN : (int32_t)offset_ms;
+
+    TimeSync_Unlock(primask);
+    if (stepped)
+        EVENT_LOG3(TIME_STEP, (uint32_t)(TimeSync_GetUnixMs() / 1000), stats.last_offset_ms, src);
+    return stepped;
+}
+
+/**
+ * @brief  NTP 时间戳 (64 位定点) 转 Unix 毫秒, 按 RFC 4330 3 处理 2036 年回绕
+ */
+static int64_t TimeSync_NtpToUnixMs(const uint8_t *p)
+{
+    uint32_t sec = TimeSync_Rd32(p);
+    uint32_t frac = TimeSync_Rd32(p + 4);
+    int64_t s = (int64_t)sec - SNTP_NTP_UNIX_DELTA;
+
+    if (!(sec & 0x80000000UL))
+        s += 0x100000000LL;         /* 最高位为 0: 2036-02-07 之后 */
+    return s * 1000 + (int64_t)(((uint64_t)frac * 1000) >> 32);
+}
+
+/**
+ * @brief  检查 SNTP 应答
+ * @retval 1:有效
+ */
+static uint8_t TimeSync_SntpCheck(const uint8_t *msg, int32_t len, const uint8_t *from, uint16_t port,
+                                  const uint8_t *server)
+{
+    uint8_t li = msg[0] >> 6;
+    uint8_t vn = (msg[0] >> 3) & 0x07;
+    uint8_t mode = msg[0] & 0x07;
+    uint8_t stratum = msg[1];
+
+    if (len < SNTP_MSG_LEN || port != SNTP_SERVER_PORT || memcmp(from, server, 4) != 0)
+        return 0;
+    if (mode != SNTP_MODE_SERVER || vn < 3 || vn > 4 || li == SNTP_LI_ALARM)
+        return 0;
+    /* stratum 0 为 kiss-o'-death */
+    if (stratum == 0 || stratum > 15)
+        return 0;
+    /* originate 必须是本次请求的 transmit (随机数), 防止旧应答和伪造 */
+    if (memcmp(&msg[24], sntp_nonce, sizeof(sntp_nonce)) != 0)
+        return 0;
+    if (TimeSync_Rd32(&msg[40]) == 0)
+        return 0;
+    return 1;
+}
+
+/**
+ * @brief  与服务器进行一次 SNTP 交换并校正时钟
+ * @retval 1:采用  0:超时或样本无效
+ * @note   t1/t4 在发送前和检测到应答时读取单调时钟, 检查间隔 1ms
+ */
+static uint8_t TimeSync_SntpExchange(const uint8_t *server, uint8_t *stepped)
+{
+    uint8_t msg[SNTP_MSG_LEN];
+    uint8_t from[4];
+    uint16_t port;
+    int32_t len;
+    uint64_t t1, t4;
+    int64_t t1u, t2, t3, t4u, offset, delay;
+    TimeSync_Clock_t c;
+    uint8_t i, ok = 0;
+
+    if (socket(TIME_SYNC_SNTP_SOCK, Sn_MR_UDP, SNTP_LOCAL_PORT, SF_IO_NONBLOCK) != TIME_SYNC_SNTP_SOCK)
+        return 0;
+    wiz_udp_send_reset(TIME_SYNC_SNTP_SOCK);
+
+    memset(msg, 0, sizeof(msg));
+    msg[0] = (SNTP_VERSION << 3) | SNTP_MODE_CLIENT;
+    /* transmit 字段放随机数 (服务器原样放入 originate), 不泄露本机时间 */
+    for (i = 0; i < sizeof(sntp_nonce); i++)
+    {
+        sntp_seed = sntp_seed * 1103515245UL + 12345UL + SysTick->VAL;
+        sntp_nonce[i] = (uint8_t)(sntp_seed >> 24);
+    }
+    memcpy(&msg[40], sntp_nonce, sizeof(sntp_nonce));
+
+    stats.sntp_requests++;
+    t1 = TimeSync_MonotonicMs();
+    t4 = t1;
+    if (wiz_udp_send_nowait(TIME_SYNC_SNTP_SOCK, msg, SNTP_MSG_LEN, server, SNTP_SERVER_PORT) == 0)
+    {
+        for (;;)
+        {
+            if (getSn_RX_RSR(TIME_SYNC_SNTP_SOCK) > 0)
+            {
+                t4 = TimeSync_MonotonicMs();
+                len = recvfrom(TIME_SYNC_SNTP_SOCK, msg, sizeof(msg), from, &port);
+                if (len > 0 && TimeSync_SntpCheck(msg, len, from, port, server))
+                {
+                    ok = 1;
+                    break;
+                }
+                stats.sntp_rejected++;
+                continue;
+            }
+            /* ARP 无应答或等待超时 */
+            if (wiz_udp_send_status(TIME_SYNC_SNTP_SOCK) == WIZ_UDP_SEND_TIMEOUT ||
+                TimeSync_MonotonicMs() - t1 >= TIME_SYNC_SNTP_TIMEOUT_MS)
+                break;
+            osDelay(1);
+        }
+    }
+    close(TIME_SYNC_SNTP_SOCK);
+    wiz_udp_send_reset(TIME_SYNC_SNTP_SOCK);
+
+    if (!ok)
+    {
+        stats.sntp_timeouts++;
+        return 0;
+    }
+
+    /* 偏移 = ((t2 - t1) + (t3 - t4)) / 2, 延时 = (t4 - t1) - (t3 - t2) */
+    t2 = TimeSync_NtpToUnixMs(&msg[32]);
+    t3 = TimeSync_NtpToUnixMs(&msg[40]);
+    TimeSync_Snapshot(&c);
+    t1u = TimeSync_ClockAt(&c, t1);
+    t4u = TimeSync_ClockAt(&c, t4);
+    offset = ((t2 - t1u) + (t3 - t4u)) / 2;
+    delay = (t4u - t1u) - (t3 - t2);
+    if (delay < 0)
+        delay = 0;
+
+    stats.last_delay_ms = (uint32_t)delay;
+    if (delay > TIME_SYNC_MAX_DELAY_MS)
+    {
+        stats.sntp_rejected++;
+        return 0;
+    }
+
+    *stepped = TimeSync_Correct(offset, TIME_SRC_SNTP);
+    return 1;
+}
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief  初始化
+ */
+void TimeSync_Init(void)
+{
+    sntp_seed ^= HAL_GetUIDw0() ^ HAL_GetUIDw1() ^ HAL_GetUIDw2();
+    /* OTA 的 TFTP 下载借用该 socket (OTA_TFTP_SOCK), 窗口传输需要能放下一整个窗口的接收缓冲区 */
+    wiz_sockbuf_set_role(TIME_SYNC_SNTP_SOCK, WIZ_SOCK_ROLE_BULK_RX);
+}
+
+/**
+ * @brief  时间同步处理, 由默认任务周期调用
+ */
+void TimeSync_Poll(void)
+{
+    uint64_t now = TimeSync_MonotonicMs();
+    uint8_t server[4];
+    uint8_t stepped = 0;
+    int8_t ret;
+
+    if (now < sntp_next_ms || wiz_supervisor_get_state() != WIZ_SUP_STATE_UP)
+        return;
+
+    ret = wiz_dns_resolve(TIME_SYNC_SNTP_SERVER, WIZ_DNS_TYPE_A, server, NULL, NULL);
+    if (ret == WIZ_DNS_PENDING)
+        return;                         /* 下一周期再取结果 */
+    if (ret != WIZ_DNS_OK)
+        memcpy(server, sntp_fallback_ip, 4);
+
+    if (!TimeSync_SntpExchange(server, &stepped))
+    {
+        sntp_poll_s = TIME_SYNC_POLL_MIN_S;
+        sntp_next_ms = now + TIME_SYNC_RETRY_S * 1000UL;
+        return;
+    }
+
+    /* 偏移小时逐步延长轮询间隔, 跳变后从最短间隔重新开始 */
+    if (stepped)
+        sntp_poll_s = TIME_SYNC_POLL_MIN_S;
+    else if (TimeSync_Abs(stats.last_offset_ms) <= TIME_SYNC_STEP_MS / 4 && sntp_poll_s < TIME_SYNC_POLL_MAX_S)
+        sntp_poll_s *= 2;
+    sntp_next_ms = now + sntp_poll_s * 1000UL;
+}
+
+/**
+ * @brief  单调时钟 (毫秒)
+ */
+uint64_t TimeSync_MonotonicMs(void)
+{
+    uint32_t primask = TimeSync_Lock();
+    uint32_t tick = osKernelSysTick();
+    uint64_t ms;
+
+    if (tick < mono_last)
+        mono_high++;
+    mono_last = tick;
+    ms = ((uint64_t)mono_high << 32) | tick;
+    TimeSync_Unlock(primask);
+    return ms;
+}
+
+/**
+ * @brief  是否已同步
+ */
+uint8_t TimeSync_IsSynced(void)
+{
+    return synced;
+}
+
+/**
+ * @brief  当前 UTC 时间 (Unix 毫秒)
+ */
+int64_t TimeSync_GetUnixMs(void)
+{
+    return TimeSync_MonoToUnixMs(TimeSync_MonotonicMs());
+}
+
+/**
+ * @brief  单调时钟时刻换算为 UTC
+ */
+int64_t TimeSync_MonoToUnixMs(uint64_t mono_ms)
+{
+    TimeSync_Clock_t c;
+
+    if (!synced)
+        return 0;
+    TimeSync_Snapshot(&c);
+    return TimeSync_ClockAt(&c, mono_ms);
+}
+
+/**
+ * @brief  当前 UTC 日期时间
+ */
+uint8_t TimeSync_GetDateTime(TimeSync_DateTime_t *dt)
+{
+    int64_t ms = TimeSync_GetUnixMs();
+    int64_t s;
+
+    if (!synced)
+        return 0;
+    s = ms / 1000;
+    if (ms % 1000 < 0)
+        s--;
+    TimeSync_EpochToCalendar(s, dt);
+    dt->ms = (uint16_t)(ms - s * 1000);
+    return 1;
+}
+
+/**
+ * @brief  是否需要查询蜂窝网络时间
+ */
+uint8_t TimeSync_ModemDue(void)
+{
+    uint32_t now_s = (uint32_t)(TimeSync_MonotonicMs() / 1000);
+    uint32_t period = TIME_SYNC_MODEM_RETRY_S;
+
+    if (synced)
+    {
+        /* SNTP 正常时不需要 */
+        if (sntp_ever && now_s - sntp_last_s < TIME_SYNC_MODEM_AFTER_S)
+            return 0;
+        period = TIME_SYNC_MODEM_AFTER_S;
+    }
+    if (modem_queried && now_s - modem_last_s < period)
+        return 0;
+    modem_queried = 1;
+    modem_last_s = now_s;
+    return 1;
+}
+
+/**
+ * @brief  提交蜂窝网络时间样本
+ */
+void TimeSync_FeedModem(int64_t unix_ms, uint64_t mono_ms)
+{
+    TimeSync_Clock_t c;
+
+    /* 未同步时时钟模型为单调时钟本身, 偏移即为跳变量 */
+    TimeSync_Snapshot(&c);
+    TimeSync_Correct(unix_ms - TimeSync_ClockAt(&c, mono_ms), TIME_SRC_MODEM);
+}
+
+/**
+ * @brief  Unix 时间 (秒) 转日期时间
+ */
+void TimeSync_EpochToCalendar(int64_t epoch_s, TimeSync_DateTime_t *dt)
+{
+    int64_t days = epoch_s / SECS_PER_DAY;
+    int32_t sod = (int32_t)(epoch_s - days * SECS_PER_DAY);
+
+    if (sod < 0)
+    {
+        sod += SECS_PER_DAY;
+        days--;
+    }
+    TimeSync_CivilFromDays((int32_t)days, &dt->year, &dt->month, &dt->day);
+    dt->hour = (uint8_t)(sod / 3600);
+    dt->minute = (uint8_t)(sod / 60 % 60);
+    dt->second = (uint8_t)(sod % 60);
+    /* 1970-01-01 为周四 */
+    dt->weekday = (uint8_t)((days % 7 + 11) % 7);
+    dt->ms = 0;
+}
+
+/**
+ * @brief  日期时间转 Unix 时间 (秒)
+ */
+int64_t TimeSync_CalendarToEpoch(const TimeSync_DateTime_t *dt)
+{
+    int64_t days = TimeSync_DaysFromCivil(dt->year, dt->month, dt->day);
+    return days * SECS_PER_DAY + dt->hour * 3600L + dt->minute * 60L + dt->second;
+}
+
+/**
+ * @brief  获取时间同步统计
+ */
+void TimeSync_GetStats(TimeSync_Stats_t *out)
+{
+    uint32_t primask = TimeSync_Lock();
+    *out = stats;
+    TimeSync_Unlock(primask);
+}
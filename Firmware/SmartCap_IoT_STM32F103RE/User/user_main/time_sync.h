@@ -0,0 +1,161 @@
+/**
+  ******************************************************************************
+  * @file    time_sync.h
+  * @brief   System Clock Discipline (SNTP / Cellular Network Time) Header
+  ******************************************************************************
+  * @description
+  * 系统时间由两部分组成:
+  * - 单调时钟: FreeRTOS tick 扩展为 64 位毫秒计数, 从上电开始, 不回绕不跳变
+  * - 墙上时钟: 单调时钟经偏移和频率校正得到的 UTC 时间 (Unix 毫秒)
+  *
+  * 时间源:
+  * - SNTP (W5500, 以太网可用时优先), 每次交换计算偏移和往返延时
+  * - RG200U AT+QLTS 网络时间 (秒级精度), 只在 SNTP 长时间不可用时使用
+  *
+  * 校正方式:
+  * - 偏移超过 TIME_SYNC_STEP_MS 或首次同步时直接跳变
+  * - 否则以不超过 TIME_SYNC_SLEW_PPM 的速率渐进调整, 墙上时钟不会倒退
+  * - 相邻两次 SNTP 样本的残余偏移用于估计晶振频偏, 之后按估计值持续补偿
+  ******************************************************************************
+  */
+
+#ifndef __TIME_SYNC_H__
+#define __TIME_SYNC_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported defines ----------------------------------------------------------*/
+#define TIME_SYNC_SNTP_SOCK         5                   /* W5500 socket */
+#define TIME_SYNC_SNTP_SERVER       "ntp.aliyun.com"    /* 先用 DNS 解析 */
+#define TIME_SYNC_SNTP_FALLBACK_IP  {203, 107, 6, 88}   /* DNS 失败时使用 */
+#define TIME_SYNC_SNTP_TIMEOUT_MS   1000                /* 单次交换等待应答的时间 */
+#define TIME_SYNC_MAX_DELAY_MS      500                 /* 往返延时超过该值的样本丢弃 */
+
+#define TIME_SYNC_POLL_MIN_S        64                  /* SNTP 轮询间隔, 稳定后逐步加倍 */
+#define TIME_SYNC_POLL_MAX_S        1024
+#define TIME_SYNC_RETRY_S           16                  /* 交换失败后的重试间隔 */
+
+#define TIME_SYNC_STEP_MS           500                 /* 偏移超过该值时跳变 */
+#define TIME_SYNC_SLEW_PPM          500                 /* 渐进调整的最大速率 */
+#define TIME_SYNC_FREQ_MAX_PPM      500                 /* 频偏估计范围 */
+#define TIME_SYNC_FREQ_MIN_S        60                  /* 估计频偏所需的最短样本间隔 */
+#define TIME_SYNC_FREQ_GAIN         4                   /* 每次只修正估计误差的 1/4, 抑制网络抖动 */
+
+#define TIME_SYNC_MODEM_AFTER_S     3600                /* SNTP 超过该时间无样本时查询网络时间 */
+#define TIME_SYNC_MODEM_RETRY_S     60                  /* 网络时间查询间隔 (未同步时) */
+#define TIME_SYNC_MODEM_STEP_MS     2000                /* 网络时间只有秒级精度, 偏移超过该值才采用 */
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum {
+    TIME_SRC_NONE = 0,
+    TIME_SRC_SNTP,
+    TIME_SRC_MODEM
+} TimeSync_Source_t;
+
+typedef struct {
+    uint16_t year;                      /* 1970 ~ */
+    uint8_t month;                      /* 1 ~ 12 */
+    uint8_t day;                        /* 1 ~ 31 */
+    uint8_t hour;
+    uint8_t minute;
+    uint8_t second;
+    uint8_t weekday;                    /* 0=周日 */
+    uint16_t ms;
+} TimeSync_DateTime_t;
+
+typedef struct {
+    uint32_t sntp_requests;
+    uint32_t sntp_replies;              /* 采用的 SNTP 样本 */
+    uint32_t sntp_rejected;             /* 格式错误/非本次请求/延时过大/服务器未同步 */
+    uint32_t sntp_timeouts;
+    uint32_t modem_samples;             /* 采用的网络时间样本 */
+    uint32_t steps;                     /* 跳变次数 */
+    uint32_t slews;                     /* 渐进调整次数 */
+    uint32_t freq_updates;              /* 频偏估计更新次数 */
+    int32_t last_offset_ms;             /* 最近一次样本的偏移 (时间源 - 本机) */
+    uint32_t last_delay_ms;             /* 最近一次 SNTP 往返延时 */
+    int32_t freq_ppb;                   /* 当前频偏补偿 (正值表示本机晶振偏慢) */
+    uint32_t last_sync_s;               /* 最近一次同步时的单调时钟 (秒) */
+    TimeSync_Source_t source;           /* 最近一次同步使用的时间源 */
+} TimeSync_Stats_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief  初始化, 在 Uplink_Eth_Init 之前调用 (登记 SNTP socket 的缓冲区用途)
+ */
+void TimeSync_Init(void);
+
+/**
+ * @brief  时间同步处理, 由默认任务周期调用
+ * @note   SNTP 交换时最多阻塞 TIME_SYNC_SNTP_TIMEOUT_MS (以 1ms 间隔检查应答, 保证延时测量精度)
+ */
+void TimeSync_Poll(void);
+
+/**
+ * @brief  单调时钟 (毫秒, 从上电开始)
+ * @note   任务和调度器启动前均可调用, 至少每 49 天调用一次以识别 tick 回绕 (TimeSync_Poll 保证)
+ */
+uint64_t TimeSync_MonotonicMs(void);
+
+/**
+ * @brief  是否已同步
+ */
+uint8_t TimeSync_IsSynced(void);
+
+/**
+ * @brief  当前 UTC 时间
+ * @retval Unix 毫秒, 未同步时为 0
+ */
+int64_t TimeSync_GetUnixMs(void);
+
+/**
+ * @brief  把单调时钟时刻换算为 UTC 时间 (用于给之前采集的数据打时间戳)
+ * @retval Unix 毫秒, 未同步时为 0
+ */
+int64_t TimeSync_MonoToUnixMs(uint64_t mono_ms);
+
+/**
+ * @brief  当前 UTC 日期时间
+ * @retval 1:已同步  0:未同步 (dt 不变)
+ */
+uint8_t TimeSync_GetDateTime(TimeSync_DateTime_t *dt);
+
+/**
+ * @brief  是否需要查询蜂窝网络时间, 返回 1 时同时记录本次查询时刻
+ * @note   由 RG200U 接收任务调用
+ */
+uint8_t TimeSync_ModemDue(void);
+
+/**
+ * @brief  提交蜂窝网络时间样本
+ * @param  unix_ms: 网络时间
+ * @param  mono_ms: 收到应答时的单调时钟
+ */
+void TimeSync_FeedModem(int64_t unix_ms, uint64_t mono_ms);
+
+/**
+ * @brief  Unix 时间 (秒) 转日期时间, 常数时间 (无逐年/逐月循环)
+ */
+void TimeSync_EpochToCalendar(int64_t epoch_s, TimeSync_DateTime_t *dt);
+
+/**
+ * @brief  日期时间转 Unix 时间 (秒), 常数时间, 不检查字段范围
+ */
+int64_t TimeSync_CalendarToEpoch(const TimeSync_DateTime_t *dt);
+
+/**
+ * @brief  获取时间同步统计
+ */
+void TimeSync_GetStats(TimeSync_Stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TIME_SYNC_H__ */
@@ -0,0 +1,265 @@
+/**
+  ******************************************************************************
+  * @file    uplink.c
+  * @brief   Uplink Router
+  ******************************************************************************
+  * @description
+  * 路由规则:
+  * - 以太网可用时始终优先使用以太网
+  * - 当前链路持续 UPLINK_FAILOVER_MS 不可用, 切换到另一条可用链路
+  * - 使用蜂窝网络期间, 以太网持续 UPLINK_FAILBACK_MS 可用才切回
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "uplink.h"
+#include "event_log.h"
+#include "cmsis_os.h"
+#include <string.h>
+
+/* Private variables ---------------------------------------------------------*/
+static const Uplink_Transport_t *const transports[UPLINK_COUNT] = {
+    &Uplink_EthTransport,
+    &Uplink_CellTransport,
+};
+
+static Uplink_ID_t active = UPLINK_NONE;
+static uint32_t up_since[UPLINK_COUNT];      /* 开始连续可用的时刻, 0 表示当前不可用 */
+static uint32_t down_since[UPLINK_COUNT];    /* 开始连续不可用的时刻, 0 表示当前可用 */
+static uint32_t outage_start = 0;
+static uint32_t last_poll_tick = 0;
+static Uplink_Stats_t stats;
+static uint8_t reclaim_buf[UPLINK_RECLAIM_SIZE];   /* 从断开的链路取回、尚未重发的数据 */
+static uint16_t reclaim_len = 0;
+static uint16_t reclaim_off = 0;
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief  记录时刻, 避开 0 (0 表示未记录)
+ */
+static uint32_t Uplink_Stamp(uint32_t now)
+{
+    return now ? now : 1;
+}
+
+/**
+ * @brief  切换当前链路
+ */
+static void Uplink_Switch(Uplink_ID_t id, uint32_t now)
+{
+    uint32_t elapsed;
+
+    if (active == id)
+        return;
+
+    if (id == UPLINK_NONE)
+    {
+        outage_start = Uplink_Stamp(now);
+    }
+    else if (active == UPLINK_ETH && id == UPLINK_CELL)
+    {
+        /* 主链路失效到备用链路接管 */
+        elapsed = now - down_since[UPLINK_ETH];
+        stats.failovers++;
+        stats.last_failover_ms = elapsed;
+        if (elapsed > stats.max_failover_ms)
+            stats.max_failover_ms = elapsed;
+    }
+    else if (active == UPLINK_CELL && id == UPLINK_ETH)
+    {
+        stats.failbacks++;
+    }
+
+    if (active == UPLINK_NONE && outage_start != 0)
+    {
+        stats.outage_ms += now - outage_start;
+        outage_start = 0;
+    }
+    EVENT_LOG2(UPLINK_SWITCH, active, id);
+    active = id;
+}
+
+/**
+ * @brief  选择第一条可用链路 (按优先级)
+ */
+static Uplink_ID_t Uplink_FirstReady(void)
+{
+    uint8_t i;
+    for (i = 0; i < UPLINK_COUNT; i++)
+    {
+        if (up_since[i] != 0)
+            return (Uplink_ID_t)i;
+    }
+    return UPLINK_NONE;
+}
+
+/**
+ * @brief  路由器周期处理, 由上行发送任务调用
+ * @note   调用各链路的 poll, 更新可用状态并决定当前链路
+ */
+void Uplink_Router_Poll(void)
+{
+    uint32_t now = osKernelSysTick();
+    uint8_t i;
+
+    if (now == last_poll_tick)
+        return;
+    last_poll_tick = now;
+
+    for (i = 0; i < UPLINK_COUNT; i++)
+    {
+        if (transports[i]->poll != NULL)
+            transports[i]->poll();
+
+        if (transports[i]->ready())
+        {
+            if (up_since[i] == 0)
+                up_since[i] = Uplink_Stamp(now);
+            down_since[i] = 0;
+        }
+        else
+        {
+            if (down_since[i] == 0)
+                down_since[i] = Uplink_Stamp(now);
+            up_since[i] = 0;
+        }
+    }
+
+    switch (active)
+    {
+    case UPLINK_NONE:
+        Uplink_Switch(Uplink_FirstReady(), now);
+        break;
+
+    case UPLINK_ETH:
+        if (down_since[UPLINK_ETH] != 0 && (now - down_since[UPLINK_ETH]) >= UPLINK_FAILOVER_MS)
+            Uplink_Switch(Uplink_FirstReady(), now);
+        break;
+
+    case UPLINK_CELL:
+        if (up_since[UPLINK_ETH] != 0 && (now - up_since[UPLINK_ETH]) >= UPLINK_FAILBACK_MS)
+            Uplink_Switch(UPLINK_ETH, now);
+        else if (down_since[UPLINK_CELL] != 0 && (now - down_since[UPLINK_CELL]) >= UPLINK_FAILOVER_MS)
+            Uplink_Switch(Uplink_FirstReady(), now);
+        break;
+
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief  经当前链路发送, 链路失效时标记为不可用
+ * @retval 链路接收的字节数, 失效时为 0
+ */
+static uint16_t Uplink_SendActive(const uint8_t *data, uint16_t len)
+{
+    int32_t ret;
+
+    ret = transports[active]->send(data, len);
+    if (ret < 0)
+    {
+        /* 链路失效, 下一次 poll 时重新选择 (重试发送不推迟切换时刻) */
+        if (down_since[active] == 0)
+            down_since[active] = Uplink_Stamp(osKernelSysTick());
+        up_since[active] = 0;
+        return 0;
+    }
+    stats.tx_bytes[active] += ret;
+    return (uint16_t)ret;
+}
+
+/**
+ * @brief  取回断开链路上未确认的数据并先行重发
+ * @retval 1 已全部重发, 0 仍有取回的数据等待发送
+ */
+static uint8_t Uplink_FlushReclaimed(void)
+{
+    uint8_t i;
+    int32_t ret;
+
+    for (i = 0; i < UPLINK_COUNT && reclaim_off == reclaim_len; i++)
+    {
+        if (transports[i]->reclaim == NULL)
+            continue;
+        ret = transports[i]->reclaim(reclaim_buf, sizeof(reclaim_buf));
+        if (ret > 0)
+        {
+            reclaim_len = (uint16_t)ret;
+            reclaim_off = 0;
+            stats.reclaimed_bytes += ret;
+        }
+    }
+
+    if (reclaim_off < reclaim_len)
+        reclaim_off += Uplink_SendActive(&reclaim_buf[reclaim_off], reclaim_len - reclaim_off);
+    return reclaim_off == reclaim_len;
+}
+
+/**
+ * @brief  通过当前链路发送
+ * @note   断开链路上取回的数据比 data 早, 重发完之前不接收新数据
+ * @param  data: 数据
+ * @param  len: 长度
+ * @retval 实际接收的字节数, 没有可用链路时返回 0 (调用者保留数据稍后重试)
+ */
+int32_t Uplink_Router_Send(const uint8_t *data, uint16_t len)
+{
+    if (active == UPLINK_NONE)
+        return 0;
+    if (!Uplink_FlushReclaimed() || active == UPLINK_NONE)
+        return 0;
+    return Uplink_SendActive(data, len);
+}
+
+/**
+ * @brief  从所有已连接链路读取下行数据
+ * @note   切换期间旧链路上仍在途的数据也会被读出
+ * @param  buf: 接收缓冲
+ * @param  len: 缓冲大小
+ * @retval 读到的字节数
+ */
+uint16_t Uplink_Router_Recv(uint8_t *buf, uint16_t len)
+{
+    uint8_t i;
+    int32_t ret;
+
+    for (i = 0; i < UPLINK_COUNT; i++)
+    {
+        if (transports[i]->recv == NULL || up_since[i] == 0)
+            continue;
+        ret = transports[i]->recv(buf, len);
+        if (ret > 0)
+        {
+            stats.rx_bytes[i] += ret;
+            return (uint16_t)ret;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief  获取当前链路
+ */
+Uplink_ID_t Uplink_Router_GetActive(void)
+{
+    return active;
+}
+
+/**
+ * @brief  获取链路的 transport 接口 (MQTT 会话绑定在一条链路上收发)
+ * @retval UPLINK_NONE 或编号非法时为 NULL
+ */
+const Uplink_Transport_t *Uplink_Router_GetTransport(Uplink_ID_t id)
+{
+    return (id < UPLINK_COUNT) ? transports[id] : NULL;
+}
+
+/**
+ * @brief  获取路由统计
+ */
+void Uplink_Router_GetStats(Uplink_Stats_t *out)
+{
+    *out = stats;
+}
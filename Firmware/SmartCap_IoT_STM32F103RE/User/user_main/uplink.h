@@ -0,0 +1,89 @@
+/**
+  ******************************************************************************
+  * @file    uplink.h
+  * @brief   Uplink Transport Abstraction and Router Header
+  ******************************************************************************
+  * @description
+  * 上行链路抽象: W5500 以太网和 RG200U 蜂窝网络实现同一个 transport 接口,
+  * 路由器优先使用以太网, 以太网不可用时切换到蜂窝网络, 以太网恢复并稳定
+  * 一段时间后再切回 (迟滞, 避免链路抖动时来回切换)。
+  *
+  * RS485 -> 服务器 的数据在 Queue_RS485_To_RG200U 中排队, 没有可用链路时
+  * 不会从队列取出, 切换过程中队列内容保持不变。链路断开时已交给该链路但未被
+  * 对端确认的数据由路由器经 reclaim 取回, 先于新数据从当前链路重发
+  * (断开前最后一次发出的数据可能重复, 不会丢失或乱序)。
+  ******************************************************************************
+  */
+
+#ifndef __UPLINK_H__
+#define __UPLINK_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported defines ----------------------------------------------------------*/
+#define UPLINK_FAILOVER_MS      1000    /* 主链路持续不可用多久后切换 */
+#define UPLINK_FAILBACK_MS      30000   /* 主链路持续可用多久后切回 */
+#define UPLINK_RECLAIM_SIZE     512     /* 取回缓冲, 不小于各链路未确认数据的上限 */
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum {
+    UPLINK_ETH = 0,     /* W5500 以太网 (优先) */
+    UPLINK_CELL,        /* RG200U 蜂窝网络 */
+    UPLINK_COUNT,
+    UPLINK_NONE = 0xFF
+} Uplink_ID_t;
+
+/**
+ * @brief 上行链路接口, 所有函数都不能阻塞
+ */
+typedef struct {
+    const char *name;
+    uint8_t (*ready)(void);                                 /* 已连接服务器, 可收发数据 */
+    int32_t (*send)(const uint8_t *data, uint16_t len);     /* 返回接收的字节数, <0 链路失效 */
+    int32_t (*recv)(uint8_t *buf, uint16_t len);            /* 返回读到的字节数 */
+    void (*poll)(void);                                     /* 连接维护, 由路由器周期调用, 可为 NULL */
+    void (*reset)(void);                                    /* 断开当前连接, 之后由 poll/维护任务重连, 可为 NULL */
+    int32_t (*reclaim)(uint8_t *buf, uint16_t len);         /* 断开后取回未确认的数据 (一次取完), 可为 NULL */
+} Uplink_Transport_t;
+
+typedef struct {
+    uint32_t failovers;                 /* 切换到备用链路次数 */
+    uint32_t failbacks;                 /* 切回主链路次数 */
+    uint32_t last_failover_ms;          /* 最近一次: 主链路失效到备用链路接管的时间 */
+    uint32_t max_failover_ms;
+    uint32_t outage_ms;                 /* 无可用链路的累计时间 */
+    uint32_t reclaimed_bytes;           /* 链路断开后取回重发的字节数 */
+    uint32_t tx_bytes[UPLINK_COUNT];
+    uint32_t rx_bytes[UPLINK_COUNT];
+} Uplink_Stats_t;
+
+extern const Uplink_Transport_t Uplink_EthTransport;
+extern const Uplink_Transport_t Uplink_CellTransport;
+
+/* Exported functions --------------------------------------------------------*/
+
+void Uplink_Router_Poll(void);
+int32_t Uplink_Router_Send(const uint8_t *data, uint16_t len);
+uint16_t Uplink_Router_Recv(uint8_t *buf, uint16_t len);
+Uplink_ID_t Uplink_Router_GetActive(void);
+const Uplink_Transport_t *Uplink_Router_GetTransport(Uplink_ID_t id);
+void Uplink_Router_GetStats(Uplink_Stats_t *stats);
+
+/* 以太网链路 (uplink_eth.c) */
+void Uplink_Eth_Init(void);
+void Uplink_Eth_Monitor(void);
+
+/* 蜂窝链路 (uplink_cell.c) */
+void Uplink_Cell_Maintain(void);
+uint8_t Uplink_Cell_Deliver(const uint8_t *data, uint16_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __UPLINK_H__ */
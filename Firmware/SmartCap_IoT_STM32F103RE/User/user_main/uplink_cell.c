@@ -0,0 +1,188 @@
+/**
+  ******************************************************************************
+  * @file    uplink_cell.c
+  * @brief   RG200U Cellular Uplink Transport
+  ******************************************************************************
+  * @description
+  * RG200U 的 UART 由 RG200U 接收任务独占:
+  * - TCP 透传模式下下行数据由 RG200U_ProcessTCPMessage 直接转发到 RS485, recv 不返回数据;
+  *   MQTT 上行模式下 AT+QIRD 读到的数据经 Uplink_Cell_Deliver 放入接收环形缓冲,
+  *   由上行发送任务通过 recv 读取 (单生产者/单消费者, 不加锁)
+  * - 断线重连 (AT+QIOPEN 最长阻塞约35秒) 在 RG200U 接收任务中执行,
+  *   不影响路由器和以太网链路; reset 只设置标志, 由接收任务关闭连接
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "uplink.h"
+#include "rg200u.h"
+#include "time_sync.h"
+#include "metrics.h"
+#include "mqtt_uplink.h"
+#include "cmsis_os.h"
+#include <stddef.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define CELL_RETRY_MS           30000   /* 重连间隔 */
+#define CELL_CSQ_PERIOD_MS      60000   /* 信号强度查询间隔 */
+#define CELL_RX_RING_SIZE       512     /* MQTT 模式下行接收缓冲 */
+#define CELL_RX_WAIT_MS         200     /* 接收缓冲满时等待上行发送任务读取的最长时间 */
+
+/* Private variables ---------------------------------------------------------*/
+static uint32_t last_attempt_tick = 0;
+static uint32_t last_csq_tick = 0;
+static uint8_t csq_queried = 0;
+#if MQTT_UPLINK_ENABLE
+static uint8_t cell_rx_ring[CELL_RX_RING_SIZE];
+static volatile uint16_t cell_rx_head = 0;  /* 接收任务写 */
+static volatile uint16_t cell_rx_tail = 0;  /* 上行发送任务读 */
+#endif
+static volatile uint8_t reset_pending = 0;
+
+/* Private functions ---------------------------------------------------------*/
+
+static uint8_t Cell_Ready(void)
+{
+    return !reset_pending && RG200U_GetTCPState() == TCP_STATE_CONNECTED;
+}
+
+static int32_t Cell_Send(const uint8_t *data, uint16_t len)
+{
+    if (RG200U_GetTCPState() != TCP_STATE_CONNECTED)
+        return -1;
+    RG200U_SendBuffer(data, len);
+    return len;
+}
+
+/**
+ * @brief  读取下行数据 (MQTT 模式), 不阻塞
+ */
+static int32_t Cell_Recv(uint8_t *buf, uint16_t len)
+{
+#if MQTT_UPLINK_ENABLE
+    uint16_t n = 0;
+    uint16_t tail = cell_rx_tail;
+
+    while (n < len && tail != cell_rx_head)
+    {
+        buf[n++] = cell_rx_ring[tail];
+        tail = (uint16_t)((tail + 1) % CELL_RX_RING_SIZE);
+    }
+    cell_rx_tail = tail;
+    return n;
+#else
+    (void)buf;
+    (void)len;
+    return 0;
+#endif
+}
+
+/**
+ * @brief  断开连接: 丢弃已收到的数据, 由接收任务关闭 TCP 后按重连间隔重连
+ */
+static void Cell_Reset(void)
+{
+    reset_pending = 1;
+#if MQTT_UPLINK_ENABLE
+    cell_rx_tail = cell_rx_head;
+#endif
+}
+
+const Uplink_Transport_t Uplink_CellTransport = {
+    "CELL",
+    Cell_Ready,
+    Cell_Send,
+    Cell_Recv,
+    NULL,
+    Cell_Reset,
+    NULL,
+};
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief  蜂窝链路维护, 由 RG200U 接收任务周期调用
+ * @note   TCP 断开 (+QIURC "closed"/"pdpdeact" 或连接失败) 后按 CELL_RETRY_MS 间隔重连;
+ *         时间同步需要时查询网络时间 (AT+QLTS), 每 CELL_CSQ_PERIOD_MS 查询信号强度 (AT+CSQ)
+ */
+void Uplink_Cell_Maintain(void)
+{
+    TCP_State_t state = RG200U_GetTCPState();
+    TimeSync_DateTime_t dt;
+    uint8_t csq;
+
+    /* SNTP 长时间不可用时用网络时间校正 */
+    if (TimeSync_ModemDue() && RG200U_GetNetworkTime(&dt))
+        TimeSync_FeedModem(TimeSync_CalendarToEpoch(&dt) * 1000, TimeSync_MonotonicMs());
+
+    /* 信号强度 (SNMP/metrics), 失败时保留上次的值 */
+    if (!csq_queried || (osKernelSysTick() - last_csq_tick) >= CELL_CSQ_PERIOD_MS)
+    {
+        csq_queried = 1;
+        last_csq_tick = osKernelSysTick();
+        if (RG200U_GetSignalQuality(&csq))
+            Metrics_Set(METRIC_MODEM_CSQ, csq);
+    }
+
+    /* reset 请求: 关闭当前连接, 之后按正常流程重连 */
+    if (reset_pending)
+    {
+        if (state == TCP_STATE_CONNECTED)
+            RG200U_CloseTCPServer();
+        reset_pending = 0;
+        state = RG200U_GetTCPState();
+    }
+
+    if (state == TCP_STATE_CONNECTED || state == TCP_STATE_CONNECTING)
+        return;
+    if ((osKernelSysTick() - last_attempt_tick) < CELL_RETRY_MS)
+        return;
+
+    last_attempt_tick = osKernelSysTick();
+    Metrics_Inc(METRIC_CELL_CONNECTS);
+    if (!RG200U_ConnectTCPServer())
+        Metrics_Inc(METRIC_CELL_CONNECT_FAILS);
+}
+
+/**
+ * @brief  AT+QIRD 读到的下行数据交给上行发送任务 (MQTT 模式), 由 RG200U 接收任务调用
+ * @retval 1:已接收 (reset 期间旧连接的数据直接丢弃)  0:TCP 透传模式, 由调用者转发到 RS485
+ * @note   缓冲区满时最多等待 CELL_RX_WAIT_MS; 仍放不下时丢弃并断开连接,
+ *         避免 MQTT 字节流缺失后错位
+ */
+uint8_t Uplink_Cell_Deliver(const uint8_t *data, uint16_t len)
+{
+#if MQTT_UPLINK_ENABLE
+    uint32_t start = osKernelSysTick();
+    uint16_t head = cell_rx_head;
+    uint16_t next;
+    uint16_t i = 0;
+
+    while (i < len && !reset_pending)
+    {
+        next = (uint16_t)((head + 1) % CELL_RX_RING_SIZE);
+        if (next == cell_rx_tail)
+        {
+            /* 先公开已写入的部分, 让上行发送任务读走 */
+            cell_rx_head = head;
+            if ((osKernelSysTick() - start) >= CELL_RX_WAIT_MS)
+            {
+                Metrics_Add(METRIC_RG200U_RX_OVERFLOW, len - i);
+                reset_pending = 1;      /* 缓冲由上行发送任务在 reset 时清空 */
+                break;
+            }
+            osDelay(1);
+            continue;
+        }
+        cell_rx_ring[head] = data[i++];
+        head = next;
+    }
+    if (!reset_pending)
+        cell_rx_head = head;
+    return 1;
+#else
+    (void)data;
+    (void)len;
+    return 0;
+#endif
+}
@@ -0,0 +1,310 @@
+/**
+  ******************************************************************************
+  * @file    uplink_eth.c
+  * @brief   W5500 Ethernet Uplink Transport
+  ******************************************************************************
+  * @description
+  * - Uplink_Eth_Init: 在默认任务中调用, 执行 network_init (DHCP 在后台任务中进行) 并启动链路监控
+  * - Uplink_Eth_Monitor: 默认任务周期调用, 检测网线/芯片状态并自动恢复, 推进 DNS 查询
+  * - transport 接口: 非阻塞 TCP 客户端, 连接 TCP_SERVER_IP:TCP_SERVER_PORT,
+  *   发送经 wiz_txq 队列, 不等待 SEND_OK
+  * - 透传模式下队列数据收到 SEND_OK 才释放, 断线后由路由器经 reclaim 取回,
+  *   或重连后在新连接上继续发送; MQTT 模式重连后丢弃 (会话重新开始)
+  * - poll/recv 在上行发送任务中访问 W5500, 与默认任务的链路监控共用 W5500 锁,
+  *   监控正在复位芯片或重开 socket 时本次跳过
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "uplink.h"
+#include "rg200u.h"
+#include "wiz_interface.h"
+#include "wiz_supervisor.h"
+#include "wiz_dhcp.h"
+#include "wiz_dns.h"
+#include "wiz_http.h"
+#include "wiz_sockbuf.h"
+#include "wiz_txq.h"
+#include "wiz_platform.h"
+#include "mqtt_uplink.h"
+#include "metrics.h"
+#include "socket.h"
+#include "cmsis_os.h"
+#include <stdlib.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define ETH_UPLINK_SOCK         1       /* socket 0 为 HTTP/抓包, DHCP 使用 WIZ_DHCP_SOCK */
+#define ETH_UPLINK_LOCAL_PORT   50000
+#define ETH_CONNECT_TIMEOUT_MS  5000
+#define ETH_RETRY_MS            2000
+#define ETH_TXQ_SIZE            UPLINK_RECLAIM_SIZE     /* 未确认的数据能被路由器一次取回 */
+
+/* Private types -------------------------------------------------------------*/
+typedef enum {
+    ETH_CONN_IDLE = 0,
+    ETH_CONN_CONNECTING,
+    ETH_CONN_ESTABLISHED,
+    ETH_CONN_BACKOFF
+} Eth_Conn_State_t;
+
+/* Private variables ---------------------------------------------------------*/
+static uint8_t ethernet_buf[1024];      /* DHCP 报文缓冲 */
+static uint8_t eth_txq_buf[ETH_TXQ_SIZE];
+static wiz_NetInfo eth_netinfo = {
+    .mac = {0x00, 0x08, 0xdc, 0x00, 0x00, 0x00},
+    .dhcp = NETINFO_DHCP
+};
+static volatile uint8_t eth_started = 0;
+static Eth_Conn_State_t conn_state = ETH_CONN_IDLE;
+static uint32_t conn_tick = 0;
+static uint8_t server_ip[4];
+static uint16_t server_port;
+static volatile uint8_t reset_pending = 0;
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief  解析点分十进制 IPv4 地址
+ */
+static void Eth_ParseIP(const char *str, uint8_t ip[4])
+{
+    uint8_t i;
+    for (i = 0; i < 4; i++)
+    {
+        ip[i] = (uint8_t)strtoul(str, (char **)&str, 10);
+        if (*str == '.')
+            str++;
+    }
+}
+
+/**
+ * @brief  关闭连接并进入重试等待
+ */
+static void Eth_Disconnect(void)
+{
+    wiz_txq_close(ETH_UPLINK_SOCK);
+    close(ETH_UPLINK_SOCK);
+    Metrics_Inc(METRIC_ETH_DISCONNECTS);
+    conn_state = ETH_CONN_BACKOFF;
+    conn_tick = osKernelSysTick();
+}
+
+/**
+ * @brief  连接建立后打开发送队列
+ */
+static void Eth_OpenQueue(void)
+{
+#if MQTT_UPLINK_ENABLE
+    /* 新的 MQTT 会话, 上一个连接中未发完的报文作废 */
+    wiz_txq_open(ETH_UPLINK_SOCK, eth_txq_buf, sizeof(eth_txq_buf));
+#else
+    /* 继续发送断线前未确认且未被路由器取回的数据 */
+    if (wiz_txq_resume(ETH_UPLINK_SOCK) != 0)
+        wiz_txq_open_retain(ETH_UPLINK_SOCK, eth_txq_buf, sizeof(eth_txq_buf));
+#endif
+}
+
+/**
+ * @brief  连接维护, 在 W5500 锁内执行
+ */
+static void Eth_PollLocked(void)
+{
+    uint8_t sr;
+
+    if (reset_pending)
+    {
+        reset_pending = 0;
+        if (conn_state == ETH_CONN_CONNECTING || conn_state == ETH_CONN_ESTABLISHED)
+            Eth_Disconnect();
+    }
+
+    if (wiz_supervisor_get_state() != WIZ_SUP_STATE_UP)
+    {
+        if (conn_state == ETH_CONN_CONNECTING || conn_state == ETH_CONN_ESTABLISHED)
+            Eth_Disconnect();
+        return;
+    }
+
+    sr = getSn_SR(ETH_UPLINK_SOCK);
+    switch (conn_state)
+    {
+    case ETH_CONN_IDLE:
+        Metrics_Inc(METRIC_ETH_CONNECTS);
+        if (socket(ETH_UPLINK_SOCK, Sn_MR_TCP, ETH_UPLINK_LOCAL_PORT, SF_IO_NONBLOCK) != ETH_UPLINK_SOCK)
+        {
+            Eth_Disconnect();
+            break;
+        }
+        /* 非阻塞模式下 connect 发出命令后立即返回 SOCK_BUSY */
+        if (connect(ETH_UPLINK_SOCK, server_ip, server_port) < 0)
+        {
+            Eth_Disconnect();
+            break;
+        }
+        conn_state = ETH_CONN_CONNECTING;
+        conn_tick = osKernelSysTick();
+        break;
+
+    case ETH_CONN_CONNECTING:
+        if (sr == SOCK_ESTABLISHED)
+        {
+            Eth_OpenQueue();
+            conn_state = ETH_CONN_ESTABLISHED;
+        }
+        else if (sr == SOCK_CLOSED || (osKernelSysTick() - conn_tick) >= ETH_CONNECT_TIMEOUT_MS)
+        {
+            Eth_Disconnect();
+        }
+        break;
+
+    case ETH_CONN_ESTABLISHED:
+        if (sr != SOCK_ESTABLISHED)
+        {
+            Eth_Disconnect();
+            break;
+        }
+        wiz_txq_poll_socket(ETH_UPLINK_SOCK);
+        break;
+
+    case ETH_CONN_BACKOFF:
+        if ((osKernelSysTick() - conn_tick) >= ETH_RETRY_MS)
+            conn_state = ETH_CONN_IDLE;
+        break;
+    }
+}
+
+/**
+ * @brief  连接维护, 由路由器周期调用
+ */
+static void Eth_Poll(void)
+{
+    if (!eth_started || !wizchip_acquire(0))
+        return;
+    Eth_PollLocked();
+    wizchip_release();
+}
+
+/**
+ * @brief  是否已连接服务器
+ */
+static uint8_t Eth_Ready(void)
+{
+    return eth_started && !reset_pending && conn_state == ETH_CONN_ESTABLISHED &&
+           wiz_supervisor_get_state() == WIZ_SUP_STATE_UP;
+}
+
+/**
+ * @brief  写入发送队列, 不阻塞
+ */
+static int32_t Eth_Send(const uint8_t *data, uint16_t len)
+{
+    int32_t ret;
+
+    if (reset_pending || conn_state != ETH_CONN_ESTABLISHED)
+        return -1;
+    ret = wiz_txq_write(ETH_UPLINK_SOCK, data, len, 0);
+    if (ret == WIZ_TXQ_ERR_TIMEOUT)
+        return 0;
+    return ret;
+}
+
+/**
+ * @brief  断开连接 (MQTT 会话出错时), 由下一次 poll 关闭, ETH_RETRY_MS 后重连
+ */
+static void Eth_Reset(void)
+{
+    reset_pending = 1;
+}
+
+/**
+ * @brief  读取下行数据, 不阻塞
+ */
+static int32_t Eth_Recv(uint8_t *buf, uint16_t len)
+{
+    uint16_t rsr;
+    int32_t ret = 0;
+
+    if (conn_state != ETH_CONN_ESTABLISHED || !wizchip_acquire(0))
+        return 0;
+    rsr = getSn_RX_RSR(ETH_UPLINK_SOCK);
+    if (rsr != 0)
+    {
+        if (len > rsr)
+            len = rsr;
+        ret = recv(ETH_UPLINK_SOCK, buf, len);
+    }
+    wizchip_release();
+    return ret;
+}
+
+/**
+ * @brief  断线后取回未确认的数据, 连接正常时返回 0
+ */
+static int32_t Eth_Reclaim(uint8_t *buf, uint16_t len)
+{
+    if (conn_state == ETH_CONN_ESTABLISHED)
+        return 0;
+    return wiz_txq_reclaim(ETH_UPLINK_SOCK, buf, len);
+}
+
+const Uplink_Transport_t Uplink_EthTransport = {
+    "ETH",
+    Eth_Ready,
+    Eth_Send,
+    Eth_Recv,
+    Eth_Poll,
+    Eth_Reset,
+    Eth_Reclaim,
+};
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief  以太网初始化, 在默认任务中调用 (芯片检查和等待网线最多阻塞数秒, DHCP 不阻塞)
+ * @note   wizchip_initialize 失败 (未焊接 W5500 或 SPI 故障) 时以太网保持不可用
+ */
+void Uplink_Eth_Init(void)
+{
+    uint32_t uid = HAL_GetUIDw0() ^ HAL_GetUIDw1() ^ HAL_GetUIDw2();
+
+    Eth_ParseIP(TCP_SERVER_IP, server_ip);
+    server_port = (uint16_t)atoi(TCP_SERVER_PORT);
+
+    /* WIZnet OUI + 芯片 UID, 保证每台设备 MAC 不同 */
+    eth_netinfo.mac[3] = (uint8_t)(uid >> 16);
+    eth_netinfo.mac[4] = (uint8_t)(uid >> 8);
+    eth_netinfo.mac[5] = (uint8_t)uid;
+
+    wiz_sockbuf_set_role(ETH_UPLINK_SOCK, WIZ_SOCK_ROLE_INTERACTIVE);
+    wiz_sockbuf_set_role(WIZ_DHCP_SOCK, WIZ_SOCK_ROLE_CONTROL);
+    wiz_sockbuf_set_role(WIZ_DNS_SOCK, WIZ_SOCK_ROLE_CONTROL);
+    wiz_sockbuf_set_role(WIZ_HTTP_SOCK, WIZ_SOCK_ROLE_BULK_TX);
+    if (wizchip_initialize() != 0)
+        return;
+
+    wiz_dns_init(eth_netinfo.mac);
+
+    network_init(ethernet_buf, &eth_netinfo);
+    wiz_supervisor_init(ethernet_buf, &eth_netinfo);
+    eth_started = 1;
+}
+
+/**
+ * @brief  以太网链路监控, 由默认任务周期调用
+ * @note   等待 DHCP 地址期间监控状态不是 UP, 路由器已切换到蜂窝网络;
+ *         链路正常时顺带采样片内 socket 缓冲区占用 (console "net" 显示)
+ */
+void Uplink_Eth_Monitor(void)
+{
+    if (eth_started)
+    {
+        wiz_supervisor_poll();
+        wiz_dns_poll();
+        if (wiz_supervisor_get_state() == WIZ_SUP_STATE_UP)
+        {
+            wizchip_acquire(osWaitForever);
+            wiz_sockbuf_poll();
+            wizchip_release();
+        }
+    }
+}
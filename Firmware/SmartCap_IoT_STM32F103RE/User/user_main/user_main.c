@@ -1,7 +1,9 @@
 /* Includes ------------------------------------------------------------------*/
 #include "User_main.h"
 #include "rs485.h"
-#include "rg200u.h"
+#include "console.h"
+#include "flash_if.h"
+#include "task_wdg.h"
 
 /* Private functions ---------------------------------------------------------*/
 
@@ -10,8 +12,11 @@
  */
 void User_main(void)
 {
+    Console_Init();     /* 调试串口, 之后的状态信息都从这里输出 */
+    Flash_Init();       /* OTA/文件系统/DHCP 租约共用的 Flash 锁 */
     RS485_Init();
-    RG200U_Init();
+    TaskWdg_Start();    /* 默认任务检查各任务报到后喂狗 */
+    /* RG200U 初始化要等模块启动和注册网络, 在接收任务中进行, 不阻塞调度器启动和喂狗 */
 }
 
 
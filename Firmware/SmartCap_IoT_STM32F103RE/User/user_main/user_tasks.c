@@ -9,9 +9,13 @@
   * 
   * 架构设计:
   * - RS485_RxTask: 从RS485接收 -> 写入Queue_RS485_To_RG200U
-  * - RG200U_TxTask: 从Queue_RS485_To_RG200U读取 -> 发送到RG200U
-  * - RG200U_RxTask: 从RG200U接收 -> 写入Queue_RG200U_To_RS485
+  * - RG200U_TxTask: 从Queue_RS485_To_RG200U读取 -> 经上行路由器发送 (以太网优先, 蜂窝备用)
+  *                  同时把以太网下行数据写入Queue_RG200U_To_RS485
+  *                  MQTT上行模式下按批发布到MQTT主题, 订阅的下行数据写入Queue_RG200U_To_RS485
+  * - RG200U_RxTask: 启动时初始化模块并连接TCP, 之后从RG200U接收 -> 写入Queue_RG200U_To_RS485, 维护蜂窝TCP连接
   * - RS485_TxTask: 从Queue_RG200U_To_RS485读取 -> 发送到RS485
+  * - DefaultTask: W5500初始化 (DHCP) 和以太网链路监控, SNMP代理, 固件升级校验/TFTP下载, 调试串口命令行, 任务运行统计,
+  *                检查其它任务报到并喂狗 (task_wdg.h)
   * 
   * 优点:
   * - 接收任务高优先级,不丢数据
@@ -25,8 +29,33 @@
 #include "User_main.h"
 #include "rs485.h"
 #include "rg200u.h"
+#include "uplink.h"
+#include "time_sync.h"
+#include "mb_gateway.h"
+#include "mb_cache.h"
+#include "web_server.h"
+#include "metrics.h"
+#include "snmp_agent.h"
+#include "mqtt_uplink.h"
+#include "ota.h"
+#include "flash_fs.h"
+#include "event_log.h"
+#include "console.h"
+#include "rtos_stats.h"
+#include "task_wdg.h"
+
+/* Private defines -----------------------------------------------------------*/
+#define UPLINK_CHUNK_SIZE   64      /* 上行发送/下行接收的批量大小, 不小于 MB_REPORT_LEN_MAX */
+#define MONITOR_PERIOD_MS   500     /* 默认任务中链路监控/校时/仪表采样的周期 */
 
 /* Private variables ---------------------------------------------------------*/
+#if MB_CACHE_ENABLE
+/* Modbus轮询缓存配置: 从站, 功能码, 起始地址, 数量, 轮询周期(ms), 死区 */
+static const MB_Cache_Range_t mb_cache_ranges[] = {
+    {1, 0x03, 0x0000, 16, 1000, 0},
+};
+#endif
+
 /* 队列句柄(在freertos.c中定义,这里声明为外部变量) */
 extern osMessageQId Queue_RS485_To_RG200UHandle;
 extern osMessageQId Queue_RG200U_To_RS485Handle;
@@ -38,23 +67,258 @@ static uint32_t rs485_last_tx_tick = 0;  // 最后一次发送时间
 /* Private functions ---------------------------------------------------------*/
 
 /**
- * @brief  默认任务实现 - 空闲任务
+ * @brief  一个字节写入队列, 更新队列深度/峰值, 队列满时计入丢弃
+ * @note   峰值在每次入队后更新, 默认任务周期采样之间的短时堆积也能记录到
+ */
+static void UserTask_QueuePut(osMessageQId queue, uint8_t data,
+                              Metrics_ID_t depth, Metrics_ID_t peak, Metrics_ID_t drops)
+{
+    if (osMessagePut(queue, data, 10) != osOK)
+    {
+        /* 队列满,数据丢失 */
+        Metrics_Inc(drops);
+        return;
+    }
+    Metrics_SetWithPeak(depth, peak, osMessageWaiting(queue));
+}
+
+/* 下行->RS485 / RS485->上行 */
+#define DOWNQ_PUT(data)     UserTask_QueuePut(Queue_RG200U_To_RS485Handle, (data), \
+                                              METRIC_DOWNQ_DEPTH, METRIC_DOWNQ_PEAK, METRIC_DOWNQ_DROPS)
+#define UPQ_PUT(data)       UserTask_QueuePut(Queue_RS485_To_RG200UHandle, (data), \
+                                              METRIC_UPQ_DEPTH, METRIC_UPQ_PEAK, METRIC_UPQ_DROPS)
+
+#if MQTT_UPLINK_ENABLE
+/**
+ * @brief  MQTT下行数据写入队列,发送给RS485
+ */
+static void UserTask_MqttDown(const uint8_t *data, uint16_t len)
+{
+    uint16_t i;
+    
+    for (i = 0; i < len; i++)
+        DOWNQ_PUT(data[i]);
+}
+
+/**
+ * @brief  MQTT上行 - 在RG200U发送任务中运行,不返回
+ * @note   一次只准备一条消息,发布失败(会话断开)时保留,会话恢复后重发;
+ *         RS485数据静默MQTT_BATCH_IDLE_MS、攒满MQTT_PAYLOAD_MAX或等待MQTT_BATCH_MAX_MS后发布一批
+ */
+static void UserTask_MqttUplink(void)
+{
+    static uint8_t msg[MQTT_PAYLOAD_MAX];
+    uint16_t msg_len = 0;
+    uint8_t msg_ready = 0;
+    MQTT_Uplink_Topic_t msg_topic = MQTT_TOPIC_RS485_UP;
+    uint32_t batch_tick = 0;
+    uint8_t got;
+    osEvent event;
+#if MQTT_METRICS_PERIOD_S
+    uint16_t metrics_slot = METRICS_SLOT_COUNT;     /* 正在发布的下一槽号, 等于 METRICS_SLOT_COUNT 表示空闲 */
+    uint8_t metrics_seq = 0;
+    uint32_t metrics_tick = osKernelSysTick();
+    uint16_t n;
+#endif
+    
+    MQTT_Uplink_Init(UserTask_MqttDown);
+    
+    for(;;)
+    {
+        TaskWdg_CheckIn(TASK_WDG_RG200U_TX);
+        
+        /* 链路维护和选路, MQTT会话维护和下行接收 */
+        Uplink_Router_Poll();
+        MQTT_Uplink_Poll();
+        
+        if (!MQTT_Uplink_Ready())
+        {
+            osDelay(10);
+            continue;
+        }
+        
+        /* 已准备好的消息 */
+        if (msg_ready)
+        {
+            if (!MQTT_Uplink_Publish(msg_topic, msg, msg_len))
+            {
+                osDelay(10);
+                continue;
+            }
+            msg_len = 0;
+            msg_ready = 0;
+        }
+        
+        /* 没有正在攒的RS485数据时,发送寄存器上报和指标 */
+        if (msg_len == 0)
+        {
+#if MB_CACHE_ENABLE
+            msg_len = MB_Cache_TakeReport(msg);
+            if (msg_len > 0)
+            {
+                msg_topic = MQTT_TOPIC_MODBUS;
+                msg_ready = 1;
+                continue;
+            }
+#endif
+#if MQTT_METRICS_PERIOD_S
+            if (metrics_slot >= METRICS_SLOT_COUNT &&
+                (osKernelSysTick() - metrics_tick) >= (uint32_t)MQTT_METRICS_PERIOD_S * 1000)
+            {
+                metrics_tick = osKernelSysTick();
+                metrics_slot = 0;
+                metrics_seq++;
+            }
+            /* 一条消息放尽量多的记录, 放不下的下一条继续 */
+            while (metrics_slot < METRICS_SLOT_COUNT &&
+                   (n = Metrics_EncodeRecord(&metrics_slot, metrics_seq, &msg[msg_len], sizeof(msg) - msg_len)) > 0)
+                msg_len += n;
+            if (msg_len > 0)
+            {
+                msg_topic = MQTT_TOPIC_METRICS;
+                msg_ready = 1;
+                continue;
+            }
+#endif
+        }
+        
+        /* 攒RS485数据: 等待第一个字节(超时MQTT_BATCH_IDLE_MS),之后把队列中已有的数据取完 */
+        got = 0;
+        event = osMessageGet(Queue_RS485_To_RG200UHandle, MQTT_BATCH_IDLE_MS);
+        while (event.status == osEventMessage)
+        {
+            if (msg_len == 0)
+                batch_tick = osKernelSysTick();
+            msg[msg_len++] = (uint8_t)event.value.v;
+            got = 1;
+            if (msg_len >= sizeof(msg))
+                break;
+            event = osMessageGet(Queue_RS485_To_RG200UHandle, 0);
+        }
+        if (msg_len > 0 &&
+            (!got || msg_len >= sizeof(msg) || (osKernelSysTick() - batch_tick) >= MQTT_BATCH_MAX_MS))
+        {
+            msg_topic = MQTT_TOPIC_RS485_UP;
+            msg_ready = 1;
+        }
+    }
+}
+#endif
+
+/**
+ * @brief  默认任务实现 - 系统监控任务
  * @param  argument: 任务参数(未使用)
- * @note   优先级最低,只用于LED指示或监控
- *         主要业务逻辑已经拆分到4个专用任务中
+ * @note   优先级最低,负责以太网初始化和链路监控
+ *         W5500初始化可能阻塞数秒,放在最低优先级任务中不影响透传;DHCP在后台任务中进行
  */
 void UserTask_Default(void const * argument)
 {
+    uint32_t monitor_tick = osKernelSysTick() - MONITOR_PERIOD_MS;
+    
+#if OTA_ENABLE
+    /* 恢复未完成的固件下载/试运行状态 */
+    OTA_Init();
+#endif
+    
+#if FS_ENABLE
+    /* 挂载文件系统 */
+    FS_Init();
+#endif
+    
+#if EVENT_LOG_ENABLE
+    /* 事件日志 (保存在文件系统中) */
+    EventLog_Init();
+#endif
+    
+#if RTOS_STATS_ENABLE
+    /* 任务CPU占用/栈余量统计, 记录上次复位前的栈溢出 */
+    RtosStats_Init();
+#endif
+    
+    /* 初始化各步骤之间喂狗, 挂载和 W5500 初始化各需数秒 */
+    TaskWdg_Poll();
+    
+    /* 时间同步(须在W5500初始化前登记SNTP socket) */
+    TimeSync_Init();
+    
+#if SNMP_AGENT_ENABLE
+    /* SNMP代理(同样须在W5500初始化前登记socket) */
+    SNMP_Agent_Init();
+#endif
+    
+    /* W5500初始化, 启动DHCP (芯片检查和等待链路最长约 11 秒) */
+    Uplink_Eth_Init();
+    TaskWdg_Poll();
+    
+#if MB_GATEWAY_ENABLE
+#if MB_CACHE_ENABLE
+    /* 寄存器轮询缓存 */
+    MB_Cache_Init(mb_cache_ranges, sizeof(mb_cache_ranges) / sizeof(mb_cache_ranges[0]));
+#endif
+    /* Modbus TCP网关(端口502) */
+    MB_Gateway_Init();
+#endif
+    
+#if WEB_SERVER_ENABLE
+    /* 状态/配置网页(端口80) */
+    Web_Server_Init();
+#endif
+    
     /* 无限循环 */
     for(;;)
     {
-        /* LED闪烁或系统监控任务
-         * 例如: 监控堆栈使用率、任务运行状态等
-         */
+        if ((osKernelSysTick() - monitor_tick) >= MONITOR_PERIOD_MS)
+        {
+            monitor_tick = osKernelSysTick();
+            
+            /* 检测网线/芯片状态,异常时自动恢复 */
+            Uplink_Eth_Monitor();
+            
+            /* SNTP校时 (TFTP下载占用SNTP socket时暂停) */
+#if OTA_ENABLE
+            if (!OTA_TftpActive())
+#endif
+                TimeSync_Poll();
+            
+            /* 队列深度/堆剩余等仪表采样 (峰值在入队时更新) */
+            Metrics_SetWithPeak(METRIC_UPQ_DEPTH, METRIC_UPQ_PEAK, osMessageWaiting(Queue_RS485_To_RG200UHandle));
+            Metrics_SetWithPeak(METRIC_DOWNQ_DEPTH, METRIC_DOWNQ_PEAK, osMessageWaiting(Queue_RG200U_To_RS485Handle));
+            Metrics_Set(METRIC_HEAP_FREE, xPortGetFreeHeapSize());
+            Metrics_Set(METRIC_UPLINK_ACTIVE, Uplink_Router_GetActive());
+            
+            // 预留:添加LED指示等
+        }
+        
+#if OTA_ENABLE
+        /* 固件校验/TFTP下载/试运行确认 */
+        OTA_Poll();
+#endif
+        
+        /* 透传任务都按时报到时喂狗 */
+        TaskWdg_Poll();
         
-        // 预留:添加LED指示、看门狗喂狗等
+#if EVENT_LOG_ENABLE
+        /* 缓冲中的事件写入Flash */
+        EventLog_Poll();
+#endif
         
-        osDelay(500);  // 500ms周期,节省CPU资源
+#if CONSOLE_ENABLE
+        /* 调试串口命令行 */
+        Console_Poll();
+#endif
+        
+#if RTOS_STATS_ENABLE
+        /* 任务CPU占用/栈余量/堆最小剩余 */
+        RtosStats_Poll();
+#endif
+        
+#if SNMP_AGENT_ENABLE
+        /* SNMP请求/trap */
+        SNMP_Agent_Poll();
+        osDelay(SNMP_AGENT_POLL_MS);
+#else
+        osDelay(MONITOR_PERIOD_MS);  // 500ms周期,节省CPU资源
+#endif
     }
 }
 
@@ -68,21 +332,23 @@ void UserTask_Default(void const * argument)
 void UserTask_RS485_RxHandler(void const * argument)
 {
     uint8_t recv_byte;
-    osStatus status;
     
     /* 无限循环 */
     for(;;)
     {
-        /* 从RS485接收一个字节(非阻塞) */
-        if (RS485_ReceiveByte(&recv_byte))
+        TaskWdg_CheckIn(TASK_WDG_RS485_RX);
+        
+        /* 从RS485接收数据(非阻塞),一次取完缓冲区中的所有字节 */
+        while (RS485_ReceiveByte(&recv_byte))
         {
-            /* 将数据写入队列,发送给RG200U */
-            status = osMessagePut(Queue_RS485_To_RG200UHandle, (uint32_t)recv_byte, 10);
+#if MB_GATEWAY_ENABLE
+            /* Modbus网关正在等待从站应答,字节交给网关 */
+            if (MB_Gateway_RxByte(recv_byte))
+                continue;
+#endif
             
-            if (status != osOK)
-            {
-                /* 队列满,数据丢失 */
-            }
+            /* 将数据写入队列,发送给RG200U */
+            UPQ_PUT(recv_byte);
         }
         
         /* 短延时,避免CPU占用过高 */
@@ -100,11 +366,18 @@ void UserTask_RS485_RxHandler(void const * argument)
 void UserTask_RG200U_RxHandler(void const * argument)
 {
     uint8_t recv_byte;
-    osStatus status;
+    
+    /* 模块自检, 注册网络, 连接TCP服务器 (每次等待都报到) */
+    RG200U_Init();
     
     /* 无限循环 */
     for(;;)
     {
+        TaskWdg_CheckIn(TASK_WDG_RG200U_RX);
+        
+        /* 蜂窝TCP断开后定时重连 */
+        Uplink_Cell_Maintain();
+        
         /* 处理TCP服务器消息（检测+QIURC通知） */
         RG200U_ProcessTCPMessage();
         
@@ -112,12 +385,7 @@ void UserTask_RG200U_RxHandler(void const * argument)
         if (RG200U_ReceiveByte(&recv_byte))
         {
             /* 将数据写入队列,发送给RS485 */
-            status = osMessagePut(Queue_RG200U_To_RS485Handle, (uint32_t)recv_byte, 10);
-            
-            if (status != osOK)
-            {
-                /* 队列满,数据丢失 */
-            }
+            DOWNQ_PUT(recv_byte);
         }
         
         /* 短延时,避免CPU占用过高 */
@@ -140,6 +408,8 @@ void UserTask_RS485_TxHandler(void const * argument)
     /* 无限循环 */
     for(;;)
     {
+        TaskWdg_CheckIn(TASK_WDG_RS485_TX);
+        
         /* 从队列读取数据 (阻塞等待,超时10ms) */
         event = osMessageGet(Queue_RG200U_To_RS485Handle, 10);
         
@@ -151,6 +421,8 @@ void UserTask_RS485_TxHandler(void const * argument)
             /* 如果是第一个字节,切换到发送模式 */
             if (!rs485_tx_active)
             {
+                /* 占用总线,Modbus网关请求进行中时等待其完成 */
+                RS485_AcquireBus(osWaitForever);
                 RS485_SetTransmitMode();
                 osDelay(1);  // 等待收发器切换
                 rs485_tx_active = 1;
@@ -175,6 +447,7 @@ void UserTask_RS485_TxHandler(void const * argument)
                     osDelay(2);  // 等待最后的数据发送完成
                     RS485_SetReceiveMode();
                     rs485_tx_active = 0;
+                    RS485_ReleaseBus();
                 }
             }
         }
@@ -182,31 +455,84 @@ void UserTask_RS485_TxHandler(void const * argument)
 }
 
 /**
- * @brief  RG200U发送任务实现
+ * @brief  RG200U发送任务实现 - 上行路由
  * @param  argument: 任务参数(未使用)
  * @note   优先级: Normal (普通优先级)
- *         功能: 从Queue_RS485_To_RG200U队列读取数据,发送到RG200U
- *         特点: 简单的队列到串口转发
+ *         功能: 从Queue_RS485_To_RG200U队列读取数据,经上行路由器发送
+ *         特点: 没有可用链路时不从队列取数据,链路切换期间数据保留在队列中
  */
 void UserTask_RG200U_TxHandler(void const * argument)
 {
+    static uint8_t tx_chunk[UPLINK_CHUNK_SIZE];
+    static uint8_t rx_chunk[UPLINK_CHUNK_SIZE];
+    uint16_t tx_len = 0;
+    uint16_t tx_off = 0;
+    uint16_t rx_len, i;
+    int32_t sent;
     osEvent event;
-    uint8_t tx_byte;
+    
+#if MQTT_UPLINK_ENABLE
+    /* MQTT上行模式 */
+    UserTask_MqttUplink();
+#endif
     
     /* 无限循环 */
     for(;;)
     {
-        /* 从队列读取数据 (阻塞等待,超时100ms) */
-        event = osMessageGet(Queue_RS485_To_RG200UHandle, 100);
+        TaskWdg_CheckIn(TASK_WDG_RG200U_TX);
         
-        if (event.status == osEventMessage)
+        /* 链路维护和选路 */
+        Uplink_Router_Poll();
+        
+        /* 以太网下行数据写入队列,发送给RS485 */
+        rx_len = Uplink_Router_Recv(rx_chunk, sizeof(rx_chunk));
+        for (i = 0; i < rx_len; i++)
+            DOWNQ_PUT(rx_chunk[i]);
+        
+        /* 上一批数据已发完,从队列取新数据 */
+        if (tx_off == tx_len)
         {
-            /* 获取数据 */
-            tx_byte = (uint8_t)event.value.v;
+            tx_len = 0;
+            tx_off = 0;
+            
+            if (Uplink_Router_GetActive() == UPLINK_NONE)
+            {
+                osDelay(10);
+                continue;
+            }
+            
+#if MB_CACHE_ENABLE
+            /* 优先发送寄存器变化上报(整条记录,不与透传数据交错) */
+            tx_len = MB_Cache_TakeReport(tx_chunk);
+            if (tx_len > 0)
+                continue;
+#endif
+#if METRICS_REPORT_PERIOD_S
+            /* 周期指标上报 */
+            tx_len = Metrics_TakeReport(tx_chunk, sizeof(tx_chunk));
+            if (tx_len > 0)
+                continue;
+#endif
+            
+            /* 阻塞等待第一个字节(超时10ms),之后把队列中已有的数据一次取完 */
+            event = osMessageGet(Queue_RS485_To_RG200UHandle, 10);
+            while (event.status == osEventMessage)
+            {
+                tx_chunk[tx_len++] = (uint8_t)event.value.v;
+                if (tx_len >= sizeof(tx_chunk))
+                    break;
+                event = osMessageGet(Queue_RS485_To_RG200UHandle, 0);
+            }
+        }
+        
+        if (tx_off < tx_len)
+        {
+            sent = Uplink_Router_Send(&tx_chunk[tx_off], tx_len - tx_off);
+            tx_off += (uint16_t)sent;
             
-            /* 发送到RG200U */
-            RG200U_SendByte(tx_byte);
+            /* 链路繁忙或正在切换,稍后重试 */
+            if (sent == 0)
+                osDelay(10);
         }
-        /* 如果超时,继续等待下一个数据 */
     }
 }
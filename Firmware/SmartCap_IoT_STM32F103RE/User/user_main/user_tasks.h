@@ -31,8 +31,11 @@ extern "C" {
  * @brief  默认任务实现
  * @param  argument: 任务参数(未使用)
  * @note   优先级: Low
- *         堆栈: 128 words
- *         功能: 调用 User_Process() 处理透传业务
+ *         堆栈: 384 words, 暂定值: 按 x86-64 主机编译的调用链估算约 1KB (SNMP 解析、
+ *               SNTP 的 DNS 查询、命令行输出), 尚未在板上测量。在板上跑满 SNMP walk、
+ *               TFTP 升级和 status 命令后, 按 tasks 命令的 stack free
+ *               (uxTaskGetStackHighWaterMark) 重新确定, 保留约 25% 余量
+ *         功能: W5500初始化和以太网链路监控
  */
 void UserTask_Default(void const * argument);
 
@@ -68,7 +71,7 @@ void UserTask_RS485_TxHandler(void const * argument);
  * @param  argument: 任务参数(未使用)
  * @note   优先级: Normal
  *         堆栈: 512 words
- *         功能: 预留,当前未使用(透传逻辑在DefaultTask中)
+ *         功能: 上行路由,RS485数据经以太网或蜂窝网络发送
  */
 void UserTask_RG200U_TxHandler(void const * argument);
 
@@ -0,0 +1,56 @@
+#!/usr/bin/env python3
+"""
+生成 web_assets.c: 把 www 目录下的文件 gzip 压缩后转为 C 数组 (存放在 flash)。
+
+用法: python gen_assets.py   (修改 www 下的文件后运行, 生成结果提交到仓库)
+
+ETag 为压缩后内容的 CRC32, 内容不变时 ETag 不变, 浏览器重新验证得到 304。
+"""
+import gzip
+import os
+import zlib
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+WWW = os.path.join(HERE, 'www')
+OUT = os.path.join(HERE, 'web_assets.c')
+
+TYPES = {
+    '.html': 'text/html; charset=utf-8',
+    '.css': 'text/css',
+    '.js': 'application/javascript',
+    '.json': 'application/json',
+    '.svg': 'image/svg+xml',
+    '.ico': 'image/x-icon',
+    '.png': 'image/png',
+}
+
+
+def main():
+    names = sorted(n for n in os.listdir(WWW) if os.path.isfile(os.path.join(WWW, n)))
+    out = ['/* 由 gen_assets.py 生成, 不要手工修改 */',
+           '#include "web_assets.h"', '']
+    table = []
+    for i, name in enumerate(names):
+        raw = open(os.path.join(WWW, name), 'rb').read()
+        # mtime=0: 内容不变时压缩结果和 ETag 不变
+        data = gzip.compress(raw, compresslevel=9, mtime=0)
+        etag = '\\"%08x\\"' % (zlib.crc32(data) & 0xFFFFFFFF)
+        ctype = TYPES.get(os.path.splitext(name)[1], 'application/octet-stream')
+        out.append('/* %s: %d -> %d 字节 */' % (name, len(raw), len(data)))
+        out.append('static const uint8_t asset_%d[%d] = {' % (i, len(data)))
+        for j in range(0, len(data), 16):
+            out.append('    ' + ', '.join('0x%02x' % b for b in data[j:j + 16]) + ',')
+        out.append('};')
+        out.append('')
+        table.append('    {"/%s", "%s", "%s", asset_%d, sizeof(asset_%d), 1},' % (name, ctype, etag, i, i))
+    out.append('const wiz_http_asset_t Web_Assets[] = {')
+    out.extend(table)
+    out.append('};')
+    out.append('')
+    out.append('const uint8_t Web_AssetCount = sizeof(Web_Assets) / sizeof(Web_Assets[0]);')
+    out.append('')
+    open(OUT, 'w', encoding='utf-8', newline='\n').write('\n'.join(out))
+
+
+if __name__ == '__main__':
+    main()
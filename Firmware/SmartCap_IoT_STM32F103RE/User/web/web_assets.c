@@ -0,0 +1,64 @@
+/* 由 gen_assets.py 生成, 不要手工修改 */
+#include "web_assets.h"
+
+/* index.html: 1417 -> 826 字节 */
+static const uint8_t asset_0[826] = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x9d, 0x54, 0xcb, 0x8a, 0xdc, 0x46,
+    0x14, 0xdd, 0xeb, 0x2b, 0xca, 0xf2, 0x42, 0x12, 0xd3, 0x8f, 0x51, 0xe3, 0x0c, 0x46, 0x8f, 0x0e,
+    0x64, 0xc6, 0xc6, 0x36, 0x8e, 0x67, 0x48, 0x8f, 0x17, 0xc1, 0x64, 0x51, 0xad, 0x2a, 0xb5, 0xca,
+    0x2d, 0x55, 0x89, 0xaa, 0x2b, 0xcd, 0x74, 0x44, 0x83, 0xbd, 0x08, 0x01, 0x43, 0x16, 0x01, 0x6f,
+    0x02, 0xd9, 0x04, 0xb2, 0xc8, 0x3e, 0x60, 0x42, 0x82, 0xff, 0x26, 0xed, 0xf9, 0x8d, 0xdc, 0xea,
+    0x56, 0x4f, 0x86, 0xf8, 0xb1, 0x08, 0xa2, 0x55, 0xba, 0xd5, 0xa7, 0xee, 0x3d, 0xe7, 0x54, 0xdd,
+    0x4a, 0x6e, 0x9d, 0x9c, 0x1e, 0x9f, 0x7f, 0x7d, 0x76, 0x8f, 0x14, 0x50, 0x95, 0x53, 0x27, 0xd9,
+    0x0f, 0x9c, 0x32, 0x1c, 0x2a, 0x0e, 0x94, 0x64, 0x05, 0xd5, 0x86, 0x43, 0xea, 0x36, 0x90, 0x0f,
+    0xef, 0xba, 0xfb, 0x69, 0x49, 0x2b, 0x9e, 0xba, 0xad, 0xe0, 0x17, 0xb5, 0xd2, 0xe0, 0x92, 0x4c,
+    0x49, 0xe0, 0x12, 0x61, 0x17, 0x82, 0x41, 0x91, 0x32, 0xde, 0x8a, 0x8c, 0x0f, 0xb7, 0xc1, 0x40,
+    0x48, 0x01, 0x82, 0x96, 0x43, 0x93, 0xd1, 0x92, 0xa7, 0xa1, 0xcd, 0x01, 0x02, 0x4a, 0x3e, 0x9d,
+    0x55, 0x54, 0xc3, 0x31, 0xad, 0x93, 0xf1, 0x2e, 0x76, 0x12, 0x03, 0x2b, 0x3b, 0xce, 0x15, 0x5b,
+    0x75, 0x39, 0xa6, 0x8c, 0xc2, 0x3b, 0xf5, 0x25, 0x31, 0x54, 0x9a, 0xa1, 0xe1, 0x5a, 0xe4, 0x31,
+    0xae, 0x58, 0x08, 0x19, 0x85, 0x47, 0xf5, 0x65, 0x9c, 0xa9, 0x52, 0xe9, 0xe8, 0xf6, 0x64, 0x32,
+    0x59, 0x3b, 0x45, 0xb8, 0xc5, 0x0f, 0x8d, 0xf8, 0x96, 0x47, 0xe1, 0xdd, 0xfa, 0x72, 0xed, 0x00,
+    0x9d, 0x97, 0xbc, 0x9b, 0x2b, 0xcd, 0xb8, 0x1e, 0x22, 0xb6, 0xa4, 0xb5, 0xe1, 0xd1, 0xfe, 0x03,
+    0xff, 0x67, 0x5d, 0x4d, 0x19, 0x13, 0x72, 0x11, 0x4d, 0xb0, 0x48, 0x68, 0x5f, 0xf6, 0x77, 0x18,
+    0xb7, 0x5c, 0x83, 0x40, 0xb2, 0x43, 0x5a, 0x8a, 0x85, 0x8c, 0x40, 0xd5, 0x16, 0x1d, 0xe5, 0x42,
+    0x1b, 0x18, 0x66, 0x85, 0x28, 0x59, 0xd7, 0xd7, 0x3e, 0x3a, 0x3a, 0x5a, 0x3b, 0xb5, 0xc6, 0x32,
+    0x34, 0x5b, 0x2e, 0xb4, 0x6a, 0x24, 0x8b, 0x6e, 0xe7, 0x77, 0xec, 0x13, 0xef, 0x93, 0x6f, 0xc9,
+    0x24, 0xe3, 0x5e, 0x5a, 0x32, 0xee, 0xdd, 0xb5, 0x1a, 0xad, 0xd7, 0xe1, 0xb5, 0x0d, 0xe4, 0xea,
+    0xed, 0x8f, 0x9b, 0xef, 0x7e, 0xbf, 0x7a, 0xf5, 0xe6, 0xdd, 0x8b, 0x97, 0x88, 0x0b, 0xad, 0x51,
+    0x56, 0x04, 0x11, 0x2c, 0x75, 0x0d, 0xb8, 0x53, 0x34, 0xca, 0xc6, 0xbb, 0x65, 0x27, 0x4f, 0x66,
+    0xe4, 0xdd, 0xcf, 0x3f, 0x6c, 0x5e, 0xfd, 0xb2, 0xf9, 0xe9, 0xb7, 0x1e, 0x9e, 0x2b, 0x5d, 0x6d,
+    0xd1, 0x59, 0xbe, 0x40, 0x9f, 0xff, 0xfe, 0xe3, 0xaf, 0x88, 0x24, 0x42, 0xd6, 0x0d, 0xf4, 0x3b,
+    0xc6, 0xa4, 0x09, 0x5d, 0x62, 0x5d, 0x4a, 0xdd, 0xf0, 0x33, 0x77, 0x4a, 0x36, 0xbf, 0x7e, 0xff,
+    0x3e, 0x64, 0x72, 0x13, 0x82, 0x54, 0x1b, 0x00, 0x25, 0xa7, 0x9b, 0x3f, 0x5f, 0x5f, 0xbd, 0xc6,
+    0x4a, 0x7d, 0x48, 0x12, 0x53, 0x53, 0xb9, 0xad, 0x56, 0x99, 0x85, 0x25, 0x67, 0x63, 0xab, 0xd0,
+    0xb2, 0xb0, 0x9b, 0x99, 0x69, 0x51, 0xc3, 0xd4, 0xc9, 0x1b, 0x99, 0x81, 0x50, 0x92, 0x68, 0x75,
+    0xe1, 0x2f, 0x07, 0x6d, 0xd0, 0x69, 0x0e, 0x8d, 0x96, 0xc4, 0x4b, 0x40, 0x4f, 0x13, 0x60, 0x53,
+    0xef, 0x60, 0x79, 0xe0, 0xa1, 0x38, 0xd6, 0x47, 0x3e, 0xac, 0x6a, 0xae, 0x72, 0xd2, 0xa6, 0xa9,
+    0xa7, 0xe6, 0xcf, 0x79, 0x06, 0xde, 0xe7, 0x8f, 0x66, 0xa7, 0x4f, 0x46, 0x06, 0x34, 0x5a, 0x2a,
+    0xf2, 0x95, 0xdf, 0x06, 0x51, 0x1b, 0xec, 0x17, 0x8d, 0x31, 0x8f, 0xb7, 0xfe, 0xb7, 0x50, 0xa9,
+    0x28, 0xf3, 0x83, 0xce, 0x21, 0x39, 0x87, 0xac, 0xf0, 0xbd, 0x31, 0xad, 0x05, 0x6e, 0x00, 0x85,
+    0xc6, 0x78, 0xc1, 0x08, 0x0a, 0x2e, 0xfd, 0x3d, 0xd6, 0xd7, 0xd7, 0x74, 0xf4, 0xe8, 0xb9, 0xc1,
+    0x89, 0x60, 0xfd, 0x5f, 0x88, 0xb1, 0xa9, 0x48, 0x4b, 0x35, 0x29, 0x52, 0xcf, 0x8b, 0x51, 0x9e,
+    0x6f, 0x83, 0x25, 0x11, 0x92, 0x98, 0xa0, 0x38, 0x48, 0x77, 0xc2, 0xcc, 0xb3, 0xe5, 0x37, 0x41,
+    0xcc, 0x54, 0xd6, 0x54, 0xd8, 0x0a, 0xa3, 0x05, 0x87, 0x7b, 0x25, 0xb7, 0x9f, 0x5f, 0xac, 0x1e,
+    0x32, 0xdf, 0x33, 0x80, 0xb5, 0x85, 0x94, 0x5c, 0x3f, 0x38, 0xff, 0xf2, 0x71, 0x5a, 0xc4, 0x0e,
+    0xc1, 0x4a, 0x19, 0xb5, 0x0c, 0xaf, 0x4b, 0x05, 0xdd, 0x7b, 0xd5, 0x83, 0x0e, 0xfb, 0xef, 0x5c,
+    0x54, 0x5c, 0x35, 0xe0, 0x5b, 0x65, 0x83, 0xc9, 0xe1, 0xe1, 0x21, 0xb2, 0x8c, 0x1d, 0x94, 0x7c,
+    0x43, 0x20, 0xf6, 0x60, 0x2e, 0x16, 0xff, 0x47, 0x60, 0x66, 0x05, 0x5a, 0x49, 0x79, 0xfa, 0x51,
+    0xfa, 0x78, 0xa2, 0xbc, 0x20, 0xce, 0x47, 0xf6, 0x04, 0x8d, 0x5a, 0x5a, 0x36, 0x3c, 0xcd, 0xb6,
+    0xc1, 0x6e, 0x6e, 0x72, 0x73, 0x6e, 0x82, 0xd4, 0x90, 0xde, 0xa7, 0x73, 0x8d, 0x94, 0x34, 0xcd,
+    0xbc, 0x12, 0x90, 0x5e, 0xf3, 0xe0, 0x96, 0x07, 0x1f, 0x61, 0x43, 0xb5, 0x88, 0x3d, 0xe1, 0x39,
+    0x6d, 0x4a, 0xf0, 0x31, 0x13, 0xf9, 0x80, 0xce, 0x41, 0x87, 0x37, 0x51, 0xa1, 0x58, 0xe4, 0x9d,
+    0x9d, 0xce, 0xce, 0xbd, 0x81, 0x6d, 0xa8, 0x48, 0xf2, 0x0b, 0xf2, 0xf4, 0xab, 0xc7, 0x33, 0x4e,
+    0x75, 0x56, 0x9c, 0x51, 0x4d, 0x2b, 0xe3, 0xdb, 0xb9, 0xfb, 0x78, 0x24, 0x4f, 0x28, 0x50, 0x1f,
+    0x0a, 0x61, 0x02, 0x74, 0x00, 0x37, 0xf4, 0x13, 0x3e, 0x01, 0xbf, 0x84, 0x0f, 0xf8, 0x04, 0x41,
+    0xf7, 0x51, 0x4d, 0xd8, 0x03, 0xd6, 0x7a, 0x5c, 0x78, 0xdc, 0xdf, 0x85, 0xb0, 0xdd, 0xa2, 0xd8,
+    0xd9, 0x9d, 0xc6, 0xd8, 0xde, 0x01, 0x7d, 0x47, 0x60, 0x0f, 0xed, 0xba, 0x7f, 0xbc, 0xbb, 0x71,
+    0xff, 0x01, 0xea, 0xb0, 0x03, 0x23, 0x89, 0x05, 0x00, 0x00,
+};
+
+const wiz_http_asset_t Web_Assets[] = {
+    {"/index.html", "text/html; charset=utf-8", "\"4f748db6\"", asset_0, sizeof(asset_0), 1},
+};
+
+const uint8_t Web_AssetCount = sizeof(Web_Assets) / sizeof(Web_Assets[0]);
@@ -0,0 +1,30 @@
+/**
+  ******************************************************************************
+  * @file    web_assets.h
+  * @brief   Embedded Web Assets (gzip, stored in flash)
+  ******************************************************************************
+  * @description
+  * web_assets.c 由 gen_assets.py 根据 www 目录生成, 修改页面后重新运行脚本
+  ******************************************************************************
+  */
+
+#ifndef __WEB_ASSETS_H__
+#define __WEB_ASSETS_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include "wiz_http.h"
+
+/* Exported variables --------------------------------------------------------*/
+extern const wiz_http_asset_t Web_Assets[];
+extern const uint8_t Web_AssetCount;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __WEB_ASSETS_H__ */
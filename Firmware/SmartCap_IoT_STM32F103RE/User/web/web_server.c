@@ -0,0 +1,551 @@
+/**
+  ******************************************************************************
+  * @file    web_server.c
+  * @brief   Status and Configuration Web Server
+  ******************************************************************************
+  * @description
+  * 处理函数都在 HTTP 任务中执行, 共用一个 JSON 缓冲区。
+  * /api/live 的数据回调在两次输出之间返回 WIZ_HTTP_CHUNK_WAIT, 连接保持打开。
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "web_server.h"
+#include "web_assets.h"
+#include "wiz_http.h"
+#include "wiz_dns.h"
+#include "wiz_supervisor.h"
+#include "uplink.h"
+#include "rg200u.h"
+#include "time_sync.h"
+#include "mb_gateway.h"
+#include "metrics.h"
+#include "ota.h"
+#include "flash_fs.h"
+#include "event_log.h"
+#include "cmsis_os.h"
+#include <stdio.h>
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define WEB_JSON_MAX            WIZ_HTTP_CHUNK_MAX
+
+#if WIZ_HTTP_CHUNK_MAX < METRICS_PROM_PIECE_MAX
+#error "WIZ_HTTP_CHUNK_MAX must hold the longest Prometheus piece"
+#endif
+
+/* Private variables ---------------------------------------------------------*/
+static char json_buf[WEB_JSON_MAX];
+static uint32_t live_tick = 0;
+static uint8_t live_first = 0;
+static uint16_t metrics_cursor = 0;
+static uint8_t metrics_seq = 0;
+#if EVENT_LOG_ENABLE
+static EventLog_Cursor_t log_cursor;
+#endif
+#if FS_ENABLE
+static uint8_t fs_list_cursor = 0;
+static uint8_t fs_list_state = 0;                /* 0=头部, 1=文件, 2=结尾, 3=结束 */
+static uint8_t fs_list_count = 0;
+static char fs_get_name[FS_NAME_MAX];
+static uint32_t fs_get_pos = 0;
+static int8_t fs_upload_fd = -1;                /* 正在上传的文件, 下一次 op=create 时放弃未关闭的上传 */
+static char fs_upload_name[FS_NAME_MAX];
+static uint32_t fs_upload_pos = 0;
+#endif
+
+static const char *const eth_state_name[] = {
+    "INIT", "UP", "LINK_DOWN", "CHIP_LOST", "ADDR_WAIT"
+};
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief  解析点分十进制 IPv4 地址
+ * @retval 1:成功  0:格式错误
+ */
+static uint8_t Web_ParseIP(const char *str, uint8_t ip[4])
+{
+    uint8_t i;
+    uint16_t v;
+
+    for (i = 0; i < 4; i++)
+    {
+        if (*str < '0' || *str > '9')
+            return 0;
+        v = 0;
+        while (*str >= '0' && *str <= '9')
+        {
+            v = v * 10 + (uint16_t)(*str++ - '0');
+            if (v > 255)
+                return 0;
+        }
+        ip[i] = (uint8_t)v;
+        if (i < 3 && *str++ != '.')
+            return 0;
+    }
+    return *str == '\0';
+}
+
+/**
+ * @brief  生成状态 JSON
+ * @retval JSON 长度
+ */
+static uint16_t Web_StatusJson(char *buf, uint16_t size)
+{
+    Uplink_Stats_t up;
+    MB_Gateway_Stats_t mb;
+    wiz_http_stats_t http;
+    wiz_sup_state_t eth = wiz_supervisor_get_state();
+    Uplink_ID_t active = Uplink_Router_GetActive();
+    int64_t unix_ms = TimeSync_GetUnixMs();
+    int n;
+
+    Uplink_Router_GetStats(&up);
+    MB_Gateway_GetStats(&mb);
+    wiz_http_get_stats(&http);
+
+    n = snprintf(buf, size,
+                 "{\"uptime_s\":%lu,\"time\":%lu,\"uplink\":\"%s\",\"failovers\":%lu,"
+                 "\"eth\":\"%s\",\"cell_tcp\":%u,\"mb_req\":%lu,\"mb_timeouts\":%lu,"
+                 "\"http_req\":%lu,\"http_reused\":%lu}\n",
+                 (unsigned long)(TimeSync_MonotonicMs() / 1000),
+                 (unsigned long)(unix_ms / 1000),
+                 (active == UPLINK_ETH) ? "ETH" : (active == UPLINK_CELL) ? "CELL" : "NONE",
+                 (unsigned long)up.failovers,
+                 (eth <= WIZ_SUP_STATE_ADDR_WAIT) ? eth_state_name[eth] : "?",
+                 (unsigned)RG200U_GetTCPState(),
+                 (unsigned long)mb.requests, (unsigned long)mb.timeouts,
+                 (unsigned long)http.requests, (unsigned long)http.reused);
+    if (n < 0 || n >= size)
+        return 0;
+    return (uint16_t)n;
+}
+
+/**
+ * @brief  GET /api/status
+ */
+static void Web_Status(const wiz_http_req_t *req)
+{
+    wiz_http_reply(200, "application/json", json_buf, Web_StatusJson(json_buf, sizeof(json_buf)));
+}
+
+/**
+ * @brief  /api/live 数据回调: 每 WEB_LIVE_PERIOD_MS 输出一行状态
+ */
+static int32_t Web_LiveChunk(uint8_t *buf, uint16_t size, void *arg)
+{
+    uint32_t now = osKernelSysTick();
+
+    if (!live_first && (now - live_tick) < WEB_LIVE_PERIOD_MS)
+        return WIZ_HTTP_CHUNK_WAIT;
+    live_first = 0;
+    live_tick = now;
+    return Web_StatusJson((char *)buf, size);
+}
+
+/**
+ * @brief  GET /api/live
+ */
+static void Web_Live(const wiz_http_req_t *req)
+{
+    live_first = 1;
+    wiz_http_reply_chunked("application/x-ndjson", Web_LiveChunk, NULL);
+}
+
+/**
+ * @brief  /metrics 数据回调: 每次输出若干个指标
+ */
+static int32_t Web_MetricsChunk(uint8_t *buf, uint16_t size, void *arg)
+{
+    /* 发送队列剩余空间小时给出的缓冲可能放不下一个指标, 等空间够了再取, 否则该指标被跳过 */
+    if (size < METRICS_PROM_PIECE_MAX)
+        return WIZ_HTTP_CHUNK_WAIT;
+    return Metrics_FormatPrometheus(&metrics_cursor, (char *)buf, size);
+}
+
+/**
+ * @brief  GET /metrics (Prometheus 文本格式)
+ */
+static void Web_Metrics(const wiz_http_req_t *req)
+{
+    metrics_cursor = 0;
+    wiz_http_reply_chunked("text/plain; version=0.0.4", Web_MetricsChunk, NULL);
+}
+
+/**
+ * @brief  /metrics.bin 数据回调: 每块一条二进制记录
+ */
+static int32_t Web_MetricsBinChunk(uint8_t *buf, uint16_t size, void *arg)
+{
+    return Metrics_EncodeRecord(&metrics_cursor, metrics_seq, buf, size);
+}
+
+/**
+ * @brief  GET /metrics.bin (与上行链路上报相同的二进制记录)
+ */
+static void Web_MetricsBin(const wiz_http_req_t *req)
+{
+    metrics_cursor = 0;
+    metrics_seq++;
+    wiz_http_reply_chunked("application/octet-stream", Web_MetricsBinChunk, NULL);
+}
+
+/**
+ * @brief  GET/POST /api/config
+ */
+static void Web_Config(const wiz_http_req_t *req)
+{
+    wiz_NetInfo info;
+    char value[16];
+    uint8_t dns1[4], dns2[4];
+    uint8_t has1, has2;
+    int n;
+
+    if (req->method == WIZ_HTTP_POST)
+    {
+        has1 = wiz_http_param((const char *)req->body, req->body_len, "dns1", value, sizeof(value)) > 0 &&
+               Web_ParseIP(value, dns1);
+        has2 = wiz_http_param((const char *)req->body, req->body_len, "dns2", value, sizeof(value)) > 0 &&
+               Web_ParseIP(value, dns2);
+        if (!has1 && !has2)
+        {
+            wiz_http_reply(400, "text/plain", "invalid dns1/dns2", 17);
+            return;
+        }
+        wiz_dns_set_servers(has1 ? dns1 : NULL, has2 ? dns2 : NULL);
+        wiz_dns_flush();
+        wiz_http_reply(200, "text/plain", "OK", 2);
+        return;
+    }
+    if (req->method != WIZ_HTTP_GET && req->method != WIZ_HTTP_HEAD)
+    {
+        wiz_http_reply(405, "text/plain", "Method Not Allowed", 18);
+        return;
+    }
+
+    wizchip_getnetinfo(&info);
+    n = snprintf(json_buf, sizeof(json_buf),
+                 "{\"mac\":\"%02X:%02X:%02X:%02X:%02X:%02X\",\"ip\":\"%u.%u.%u.%u\","
+                 "\"mask\":\"%u.%u.%u.%u\",\"gw\":\"%u.%u.%u.%u\",\"dns1\":\"%u.%u.%u.%u\","
+                 "\"dns2\":\"\",\"dhcp\":%u}",
+                 info.mac[0], info.mac[1], info.mac[2], info.mac[3], info.mac[4], info.mac[5],
+                 info.ip[0], info.ip[1], info.ip[2], info.ip[3],
+                 info.sn[0], info.sn[1], info.sn[2], info.sn[3],
+                 info.gw[0], info.gw[1], info.gw[2], info.gw[3],
+                 info.dns[0], info.dns[1], info.dns[2], info.dns[3],
+                 (unsigned)(info.dhcp == NETINFO_DHCP));
+    if (n < 0 || n >= (int)sizeof(json_buf))
+        n = 0;
+    wiz_http_reply(200, "application/json", json_buf, (uint16_t)n);
+}
+
+#if OTA_ENABLE
+/**
+ * @brief  GET/POST /api/ota, 应答都是 OTA 状态 JSON
+ *         POST ?op=begin 请求体为文件头; POST ?offset=N 请求体为固件数据;
+ *         POST ?op=abort; POST ?op=tftp&server=a.b.c.d&file=name
+ */
+static void Web_Ota(const wiz_http_req_t *req)
+{
+    char op[8], value[OTA_TFTP_FILE_MAX];
+    uint8_t server[4];
+    uint32_t offset = 0;
+    uint16_t status = 200;
+    int8_t ret = OTA_OK;
+    const char *p;
+
+    if (req->method == WIZ_HTTP_POST)
+    {
+        if (wiz_http_param(req->query, req->query_len, "offset", value, sizeof(value)) > 0)
+        {
+            for (p = value; *p >= '0' && *p <= '9'; p++)
+                offset = offset * 10 + (uint32_t)(*p - '0');
+            ret = OTA_Write(offset, req->body, req->body_len);
+        }
+        else if (wiz_http_param(req->query, req->query_len, "op", op, sizeof(op)) <= 0)
+            ret = OTA_ERR_STATE;
+        else if (strcmp(op, "begin") == 0)
+            ret = OTA_Begin(req->body, req->body_len);
+        else if (strcmp(op, "abort") == 0)
+            ret = OTA_Abort();
+        else if (strcmp(op, "tftp") == 0)
+        {
+            if (wiz_http_param(req->query, req->query_len, "server", value, sizeof(value)) <= 0 ||
+                !Web_ParseIP(value, server) ||
+                wiz_http_param(req->query, req->query_len, "file", value, sizeof(value)) <= 0)
+                ret = OTA_ERR_HEADER;
+            else
+                ret = OTA_TftpStart(server, value);
+        }
+        else
+            ret = OTA_ERR_STATE;
+
+        /* 偏移不对时应答中的 received 告诉客户端从哪里继续 */
+        status = (ret == OTA_OK) ? 200 : (ret == OTA_ERR_OFFSET || ret == OTA_ERR_STATE) ? 409 :
+                 (ret == OTA_ERR_BUSY) ? 503 : (ret == OTA_ERR_FLASH) ? 500 : 400;
+    }
+    else if (req->method != WIZ_HTTP_GET && req->method != WIZ_HTTP_HEAD)
+    {
+        wiz_http_reply(405, "text/plain", "Method Not Allowed", 18);
+        return;
+    }
+
+    wiz_http_reply(status, "application/json", json_buf, OTA_StatusJson(json_buf, sizeof(json_buf)));
+}
+#endif
+
+#if EVENT_LOG_ENABLE
+/**
+ * @brief  /api/log 数据回调
+ */
+static int32_t Web_LogChunk(uint8_t *buf, uint16_t size, void *arg)
+{
+    return EventLog_Read(&log_cursor, buf, size);
+}
+
+/**
+ * @brief  GET /api/log (二进制事件记录, decode_event_log.py 解码); POST ?level=N 设置记录级别
+ */
+static void Web_Log(const wiz_http_req_t *req)
+{
+    char value[4];
+    int n;
+
+    if (req->method == WIZ_HTTP_POST)
+    {
+        if (wiz_http_param(req->query, req->query_len, "level", value, sizeof(value)) <= 0 ||
+            value[0] < '0' || value[0] > '0' + EVENT_LOG_ERROR || value[1] != '\0')
+        {
+            wiz_http_reply(400, "text/plain", "invalid level", 13);
+            return;
+        }
+        EventLog_SetLevel((uint8_t)(value[0] - '0'));
+        n = snprintf(json_buf, sizeof(json_buf), "{\"level\":%u}", EventLog_GetLevel());
+        wiz_http_reply(200, "application/json", json_buf, (uint16_t)n);
+        return;
+    }
+    if (req->method != WIZ_HTTP_GET && req->method != WIZ_HTTP_HEAD)
+    {
+        wiz_http_reply(405, "text/plain", "Method Not Allowed", 18);
+        return;
+    }
+
+    EventLog_Flush();
+    memset(&log_cursor, 0, sizeof(log_cursor));
+    wiz_http_reply_chunked("application/octet-stream", Web_LogChunk, NULL);
+}
+#endif
+
+#if FS_ENABLE
+/**
+ * @brief  /fs/ 数据回调: 容量信息, 然后每块一个文件
+ */
+static int32_t Web_FsListChunk(uint8_t *buf, uint16_t size, void *arg)
+{
+    FS_Info_t info;
+    FS_Stat_t st;
+    int n = 0;
+
+    switch (fs_list_state)
+    {
+    case 0:
+        FS_GetInfo(&info);
+        n = snprintf((char *)buf, size,
+                     "{\"pages\":%u,\"free\":%u,\"page_size\":%u,\"erase_min\":%lu,\"erase_max\":%lu,"
+                     "\"relocations\":%lu,\"mount_ms\":%lu,\"files\":[",
+                     info.pages, info.free_pages, FS_PAGE_SIZE, (unsigned long)info.erase_min,
+                     (unsigned long)info.erase_max, (unsigned long)info.relocations,
+                     (unsigned long)info.mount_ms);
+        fs_list_state = 1;
+        break;
+    case 1:
+        if (FS_List(&fs_list_cursor, &st) == FS_OK)
+        {
+            n = snprintf((char *)buf, size, "%s{\"name\":\"%s\",\"size\":%lu}",
+                         fs_list_count++ ? "," : "", st.name, (unsigned long)st.size);
+            break;
+        }
+        fs_list_state = 2;
+        /* fall through */
+    case 2:
+        n = snprintf((char *)buf, size, "]}");
+        fs_list_state = 3;
+        break;
+    default:
+        return 0;
+    }
+    return (n > 0 && n < (int)size) ? n : 0;
+}
+
+/**
+ * @brief  /fs/<名称> 数据回调: 每块打开一次文件, 客户端中途断开时不占用句柄
+ */
+static int32_t Web_FsReadChunk(uint8_t *buf, uint16_t size, void *arg)
+{
+    int8_t fd;
+    int32_t n = 0;
+
+    fd = FS_Open(fs_get_name, FS_O_READ);
+    if (fd < 0)
+        return 0;
+    if (FS_Seek(fd, fs_get_pos) == FS_OK)
+        n = FS_Read(fd, buf, size);
+    FS_Close(fd);
+    if (n <= 0)
+        return 0;
+    fs_get_pos += (uint32_t)n;
+    return n;
+}
+
+/**
+ * @brief  按扩展名选择 Content-Type
+ */
+static const char *Web_FsContentType(const char *name)
+{
+    const char *ext = strrchr(name, '.');
+
+    if (ext == NULL)
+        return "application/octet-stream";
+    if (strcmp(ext, ".json") == 0)
+        return "application/json";
+    if (strcmp(ext, ".htm") == 0 || strcmp(ext, ".html") == 0)
+        return "text/html";
+    if (strcmp(ext, ".txt") == 0 || strcmp(ext, ".csv") == 0 || strcmp(ext, ".log") == 0)
+        return "text/plain";
+    return "application/octet-stream";
+}
+
+/**
+ * @brief  GET/POST /fs/<名称>
+ *         GET /fs/ 为文件列表; GET /fs/<名称> 为文件内容;
+ *         POST ?op=create 开始上传 (替换同名文件), ?offset=N 追加请求体, ?op=close 上传完成后生效,
+ *         ?op=delete 删除; POST 的应答为 {"name":..,"received":N}
+ */
+static void Web_Fs(const wiz_http_req_t *req)
+{
+    char name[FS_NAME_MAX], op[8], value[12];
+    uint16_t len = req->path_len - 4;           /* 去掉 "/fs/" */
+    uint32_t offset = 0;
+    int32_t written;
+    uint16_t status = 200;
+    int8_t ret = FS_OK;
+    FS_Stat_t st;
+    const char *p;
+    int n;
+
+    if (len >= FS_NAME_MAX)
+    {
+        wiz_http_reply(404, "text/plain", "Not Found", 9);
+        return;
+    }
+    memcpy(name, req->path + 4, len);
+    name[len] = '\0';
+
+    if (req->method == WIZ_HTTP_GET || req->method == WIZ_HTTP_HEAD)
+    {
+        if (len == 0)
+        {
+            fs_list_cursor = 0;
+            fs_list_state = 0;
+            fs_list_count = 0;
+            wiz_http_reply_chunked("application/json", Web_FsListChunk, NULL);
+        }
+        else if (FS_Stat(name, &st) != FS_OK)
+            wiz_http_reply(404, "text/plain", "Not Found", 9);
+        else
+        {
+            memcpy(fs_get_name, name, sizeof(fs_get_name));
+            fs_get_pos = 0;
+            wiz_http_reply_chunked(Web_FsContentType(name), Web_FsReadChunk, NULL);
+        }
+        return;
+    }
+    if (req->method != WIZ_HTTP_POST)
+    {
+        wiz_http_reply(405, "text/plain", "Method Not Allowed", 18);
+        return;
+    }
+
+    if (wiz_http_param(req->query, req->query_len, "offset", value, sizeof(value)) > 0)
+    {
+        for (p = value; *p >= '0' && *p <= '9'; p++)
+            offset = offset * 10 + (uint32_t)(*p - '0');
+        if (fs_upload_fd < 0 || strcmp(name, fs_upload_name) != 0)
+            ret = FS_ERR_PARAM;
+        else if (offset != fs_upload_pos)
+            status = 409;                       /* 从 received 继续 */
+        else
+        {
+            written = FS_Write(fs_upload_fd, req->body, req->body_len);
+            if (written < 0)
+                ret = (int8_t)written;
+            else
+            {
+                fs_upload_pos += (uint32_t)written;
+                if (written < req->body_len)
+                    ret = FS_ERR_FULL;
+            }
+        }
+    }
+    else if (wiz_http_param(req->query, req->query_len, "op", op, sizeof(op)) <= 0)
+        ret = FS_ERR_PARAM;
+    else if (strcmp(op, "create") == 0)
+    {
+        if (fs_upload_fd >= 0)
+            FS_Discard(fs_upload_fd);
+        fs_upload_pos = 0;
+        fs_upload_fd = FS_Open(name, FS_O_TRUNC);
+        if (fs_upload_fd < 0)
+            ret = fs_upload_fd;
+        else
+            memcpy(fs_upload_name, name, sizeof(fs_upload_name));
+    }
+    else if (strcmp(op, "close") == 0)
+    {
+        if (fs_upload_fd < 0 || strcmp(name, fs_upload_name) != 0)
+            ret = FS_ERR_PARAM;
+        else
+        {
+            ret = FS_Close(fs_upload_fd);
+            fs_upload_fd = -1;
+        }
+    }
+    else if (strcmp(op, "delete") == 0)
+        ret = FS_Remove(name);
+    else
+        ret = FS_ERR_PARAM;
+
+    if (ret != FS_OK)
+        status = (ret == FS_ERR_NOENT) ? 404 : (ret == FS_ERR_FULL || ret == FS_ERR_FILES) ? 507 :
+                 (ret == FS_ERR_BUSY) ? 503 : (ret == FS_ERR_FLASH) ? 500 : 400;
+    n = snprintf(json_buf, sizeof(json_buf), "{\"name\":\"%s\",\"received\":%lu,\"error\":%d}",
+                 name, (unsigned long)fs_upload_pos, ret);
+    wiz_http_reply(status, "application/json", json_buf, (n > 0 && n < (int)sizeof(json_buf)) ? (uint16_t)n : 0);
+}
+#endif
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief  登记路由和静态资源并启动 HTTP 任务, 在以太网初始化之后调用一次
+ */
+void Web_Server_Init(void)
+{
+    wiz_http_route("/api/status", Web_Status);
+    wiz_http_route("/api/live", Web_Live);
+    wiz_http_route("/api/config", Web_Config);
+    wiz_http_route("/metrics", Web_Metrics);
+    wiz_http_route("/metrics.bin", Web_MetricsBin);
+#if OTA_ENABLE
+    wiz_http_route("/api/ota", Web_Ota);
+#endif
+#if FS_ENABLE
+    wiz_http_route("/fs/*", Web_Fs);
+#endif
+#if EVENT_LOG_ENABLE
+    wiz_http_route("/api/log", Web_Log);
+#endif
+    wiz_http_set_assets(Web_Assets, Web_AssetCount);
+    wiz_http_start();
+}
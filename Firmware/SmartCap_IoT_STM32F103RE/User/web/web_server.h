@@ -0,0 +1,53 @@
+/**
+  ******************************************************************************
+  * @file    web_server.h
+  * @brief   Status and Configuration Web Server Header
+  ******************************************************************************
+  * @description
+  * W5500 上的 HTTP/1.1 服务器 (wiz_http, 端口 80):
+  * - GET  /             状态页面 (gzip 压缩存放在 flash, ETag/304)
+  * - GET  /api/status   状态 JSON
+  * - GET  /api/live     状态 JSON 流, 每 WEB_LIVE_PERIOD_MS 一行 (分块传输, 直到客户端断开)
+  * - GET  /api/config   网络配置 JSON
+  * - POST /api/config   设置 DNS 服务器 (dns1=a.b.c.d&dns2=a.b.c.d, 重启后恢复默认)
+  * - GET  /metrics      运行指标 (Prometheus 文本格式)
+  * - GET  /metrics.bin  运行指标 (二进制记录, 格式见 metrics.h)
+  * - GET  /api/ota      固件升级状态 JSON (ota.h)
+  * - POST /api/ota      ?op=begin (请求体为 64 字节文件头) / ?offset=N (请求体为固件数据, 最多
+  *                      WIZ_HTTP_BODY_MAX 字节) / ?op=abort / ?op=tftp&server=a.b.c.d&file=名称,
+  *                      应答为状态 JSON, 偏移不对时为 409 (从 received 继续), 见 ota/gen_ota_image.py
+  * - GET  /fs/          文件系统容量和文件列表 JSON (fs/flash_fs.h)
+  * - GET  /fs/名称      文件内容
+  * - POST /fs/名称      ?op=create / ?offset=N (请求体追加到文件) / ?op=close (替换同名文件) /
+  *                      ?op=delete, 偏移不对时为 409, 空间不足时为 507
+  * - GET  /api/log      事件日志 (二进制记录, 见 log/event_log.h, 用 log/decode_event_log.py 解码)
+  * - POST /api/log      ?level=0~3 设置记录的最低级别 (DEBUG/INFO/WARN/ERROR, 重启后恢复默认)
+  ******************************************************************************
+  */
+
+#ifndef __WEB_SERVER_H__
+#define __WEB_SERVER_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported defines ----------------------------------------------------------*/
+#define WEB_SERVER_ENABLE       1       /* 1=启用状态/配置网页 */
+#define WEB_LIVE_PERIOD_MS      1000    /* /api/live 的输出间隔 */
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief  登记路由和静态资源并启动 HTTP 任务, 在以太网初始化之后调用一次
+ */
+void Web_Server_Init(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __WEB_SERVER_H__ */
@@ -0,0 +1,227 @@
+#include "net_pcap.h"
+#include <stddef.h>
+#include <string.h>
+
+#define ETH_HDR_LEN 14
+#define VLAN_TAG_LEN 4
+#define IPV6_HDR_LEN 40
+
+static uint16_t rd16(const uint8_t *p)
+{
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static void wr16le(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void wr32le(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+/**
+ * @brief 解析以太网帧头部 (可处理一层 VLAN, IPv4 选项, IPv6 基本头)
+ * @param frame :帧数据 (从目的 MAC 开始, 可以是截断后的数据)
+ * @param len   :可用字节数
+ * @param info  :输出解析结果
+ * @return 0 成功, -1 长度不足以太网头
+ */
+int8_t net_frame_parse(const uint8_t *frame, uint16_t len, net_frame_info_t *info)
+{
+    uint16_t off = ETH_HDR_LEN;
+    uint16_t l4 = 0;
+
+    memset(info, 0, sizeof(*info));
+    if (len < ETH_HDR_LEN)
+        return -1;
+
+    info->ethertype = rd16(&frame[12]);
+    if (info->ethertype == NET_ETHERTYPE_VLAN)
+    {
+        if (len < ETH_HDR_LEN + VLAN_TAG_LEN)
+            return 0;
+        info->vlan = rd16(&frame[14]) & 0x0FFF;
+        info->ethertype = rd16(&frame[16]);
+        off += VLAN_TAG_LEN;
+    }
+
+    if (info->ethertype == NET_ETHERTYPE_IPV4)
+    {
+        uint16_t ihl;
+
+        if (len < off + 20 || (frame[off] >> 4) != 4)
+            return 0;
+        ihl = (uint16_t)(frame[off] & 0x0F) * 4;
+        if (ihl < 20)
+            return 0;
+        info->ip_proto = frame[off + 9];
+        /* 非首片不含传输层头 */
+        if ((rd16(&frame[off + 6]) & 0x1FFF) != 0)
+            return 0;
+        l4 = off + ihl;
+    }
+    else if (info->ethertype == NET_ETHERTYPE_IPV6)
+    {
+        /* 不展开扩展头, Next Header 直接为 TCP/UDP 时才取端口 */
+        if (len < off + IPV6_HDR_LEN || (frame[off] >> 4) != 6)
+            return 0;
+        info->ip_proto = frame[off + 6];
+        l4 = off + IPV6_HDR_LEN;
+    }
+    else
+    {
+        return 0;
+    }
+
+    if ((info->ip_proto == NET_IPPROTO_TCP || info->ip_proto == NET_IPPROTO_UDP) && len >= l4 + 4)
+    {
+        info->src_port = rd16(&frame[l4]);
+        info->dst_port = rd16(&frame[l4 + 2]);
+    }
+    return 0;
+}
+
+/**
+ * @brief 判断帧是否满足过滤条件
+ * @param filter :过滤条件, NULL 表示全部接收
+ * @param info   :net_frame_parse 的结果
+ * @return 1 匹配, 0 不匹配
+ */
+uint8_t net_frame_match(const net_frame_filter_t *filter, const net_frame_info_t *info)
+{
+    if (filter == NULL)
+        return 1;
+    if (filter->ethertype != 0 && filter->ethertype != info->ethertype)
+        return 0;
+    if (filter->ip_proto != 0 && filter->ip_proto != info->ip_proto)
+        return 0;
+    if (filter->port != 0 && filter->port != info->src_port && filter->port != info->dst_port)
+        return 0;
+    return 1;
+}
+
+/**
+ * @brief 生成 pcap 文件头 (小端, 微秒时间戳)
+ * @param out     :输出缓冲区, 至少 PCAP_GLOBAL_HDR_LEN 字节
+ * @param snaplen :最大抓取长度
+ * @return 写入的字节数
+ */
+uint16_t pcap_write_global_header(uint8_t *out, uint32_t snaplen)
+{
+    wr32le(&out[0], 0xA1B2C3D4);  // magic
+    wr16le(&out[4], 2);           // version major
+    wr16le(&out[6], 4);           // version minor
+    wr32le(&out[8], 0);           // thiszone
+    wr32le(&out[12], 0);          // sigfigs
+    wr32le(&out[16], snaplen);
+    wr32le(&out[20], PCAP_LINKTYPE_ETHERNET);
+    return PCAP_GLOBAL_HDR_LEN;
+}
+
+/**
+ * @brief 初始化记录环
+ */
+void pcap_ring_init(pcap_ring_t *ring, uint8_t *buf, uint16_t size)
+{
+    ring->buf = buf;
+    ring->size = size;
+    ring->dropped = 0;
+    pcap_ring_reset(ring);
+}
+
+/**
+ * @brief 清空记录环 (丢弃未读出的记录)
+ */
+void pcap_ring_reset(pcap_ring_t *ring)
+{
+    ring->head = 0;
+    ring->tail = 0;
+}
+
+/**
+ * @brief 待读出字节数
+ */
+uint16_t pcap_ring_used(const pcap_ring_t *ring)
+{
+    return (ring->head >= ring->tail) ? (ring->head - ring->tail) : (ring->size - ring->tail + ring->head);
+}
+
+/**
+ * @brief 向环中拷贝数据, 调用者已确认空间足够
+ */
+static void ring_copy_in(pcap_ring_t *ring, const uint8_t *data, uint16_t len)
+{
+    uint16_t first = ring->size - ring->head;
+
+    if (first > len)
+        first = len;
+    memcpy(&ring->buf[ring->head], data, first);
+    if (len > first)
+        memcpy(ring->buf, &data[first], len - first);
+    ring->head += len;
+    if (ring->head >= ring->size)
+        ring->head -= ring->size;
+}
+
+/**
+ * @brief 写入一条记录
+ * @param ring    :环形缓冲区
+ * @param ts_ms   :时间戳 (ms)
+ * @param data    :抓取的数据
+ * @param caplen  :抓取长度
+ * @param origlen :帧原始长度
+ * @return 0 成功, -1 空间不足 (记录被丢弃)
+ */
+int8_t pcap_ring_put(pcap_ring_t *ring, uint32_t ts_ms, const uint8_t *data, uint16_t caplen,
+                     uint16_t origlen)
+{
+    uint8_t hdr[PCAP_RECORD_HDR_LEN];
+    uint32_t need = (uint32_t)PCAP_RECORD_HDR_LEN + caplen;
+
+    /* 保留一个空字节区分空/满 */
+    if (need > (uint32_t)(ring->size - 1 - pcap_ring_used(ring)))
+    {
+        ring->dropped++;
+        return -1;
+    }
+
+    wr32le(&hdr[0], ts_ms / 1000);
+    wr32le(&hdr[4], (ts_ms % 1000) * 1000);
+    wr32le(&hdr[8], caplen);
+    wr32le(&hdr[12], origlen);
+    ring_copy_in(ring, hdr, sizeof(hdr));
+    ring_copy_in(ring, data, caplen);
+    return 0;
+}
+
+/**
+ * @brief 获取可连续读出的数据
+ * @param ring :环形缓冲区
+ * @param data :输出数据指针
+ * @return 连续可读字节数
+ */
+uint16_t pcap_ring_peek(const pcap_ring_t *ring, const uint8_t **data)
+{
+    *data = &ring->buf[ring->tail];
+    return (ring->head >= ring->tail) ? (ring->head - ring->tail) : (ring->size - ring->tail);
+}
+
+/**
+ * @brief 标记已读出的字节
+ * @param ring :环形缓冲区
+ * @param len  :字节数, 不超过 pcap_ring_used
+ */
+void pcap_ring_consume(pcap_ring_t *ring, uint16_t len)
+{
+    uint16_t tail = ring->tail + len;
+
+    if (tail >= ring->size)
+        tail -= ring->size;
+    ring->tail = tail;
+}
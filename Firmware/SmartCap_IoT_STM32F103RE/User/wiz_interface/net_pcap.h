@@ -0,0 +1,126 @@
+#ifndef __NET_PCAP_H__
+#define __NET_PCAP_H__
+
+#include <stdint.h>
+
+/* 本文件不依赖 HAL/RTOS/W5500, 可直接在主机上编译测试 */
+
+#define PCAP_GLOBAL_HDR_LEN 24
+#define PCAP_RECORD_HDR_LEN 16
+#define PCAP_LINKTYPE_ETHERNET 1
+
+#define NET_ETHERTYPE_IPV4 0x0800
+#define NET_ETHERTYPE_ARP 0x0806
+#define NET_ETHERTYPE_VLAN 0x8100
+#define NET_ETHERTYPE_IPV6 0x86DD
+
+#define NET_IPPROTO_ICMP 1
+#define NET_IPPROTO_TCP 6
+#define NET_IPPROTO_UDP 17
+
+/**
+ * @brief 以太网帧解析结果
+ */
+typedef struct
+{
+    uint16_t ethertype;  // 去掉 VLAN 标签后的类型
+    uint16_t vlan;       // VLAN ID, 无标签时为 0
+    uint8_t ip_proto;    // IPv4 协议号 / IPv6 Next Header, 非 IP 报文为 0
+    uint16_t src_port;   // TCP/UDP 源端口, 无法解析时为 0
+    uint16_t dst_port;   // TCP/UDP 目的端口
+} net_frame_info_t;
+
+/**
+ * @brief 抓包过滤条件, 字段为 0 表示不限
+ */
+typedef struct
+{
+    uint16_t ethertype;
+    uint8_t ip_proto;
+    uint16_t port;       // 匹配源端口或目的端口
+} net_frame_filter_t;
+
+/**
+ * @brief pcap 记录环形缓冲区
+ *
+ * 记录整条写入或整条丢弃, 读出的字节流始终是合法的 pcap 记录序列。
+ */
+typedef struct
+{
+    uint8_t *buf;
+    uint16_t size;
+    uint16_t head;       // 写指针
+    uint16_t tail;       // 读指针
+    uint32_t dropped;    // 空间不足丢弃的记录数
+} pcap_ring_t;
+
+/**
+ * @brief 解析以太网帧头部 (可处理一层 VLAN, IPv4 选项, IPv6 基本头)
+ * @param frame :帧数据 (从目的 MAC 开始, 可以是截断后的数据)
+ * @param len   :可用字节数
+ * @param info  :输出解析结果
+ * @return 0 成功, -1 长度不足以太网头
+ */
+int8_t net_frame_parse(const uint8_t *frame, uint16_t len, net_frame_info_t *info);
+
+/**
+ * @brief 判断帧是否满足过滤条件
+ * @param filter :过滤条件, NULL 表示全部接收
+ * @param info   :net_frame_parse 的结果
+ * @return 1 匹配, 0 不匹配
+ */
+uint8_t net_frame_match(const net_frame_filter_t *filter, const net_frame_info_t *info);
+
+/**
+ * @brief 生成 pcap 文件头 (小端, 微秒时间戳)
+ * @param out     :输出缓冲区, 至少 PCAP_GLOBAL_HDR_LEN 字节
+ * @param snaplen :最大抓取长度
+ * @return 写入的字节数
+ */
+uint16_t pcap_write_global_header(uint8_t *out, uint32_t snaplen);
+
+/**
+ * @brief 初始化记录环
+ * @param ring :环形缓冲区
+ * @param buf  :存储区
+ * @param size :存储区大小
+ */
+void pcap_ring_init(pcap_ring_t *ring, uint8_t *buf, uint16_t size);
+
+/**
+ * @brief 清空记录环 (丢弃未读出的记录)
+ */
+void pcap_ring_reset(pcap_ring_t *ring);
+
+/**
+ * @brief 写入一条记录
+ * @param ring    :环形缓冲区
+ * @param ts_ms   :时间戳 (ms)
+ * @param data    :抓取的数据
+ * @param caplen  :抓取长度
+ * @param origlen :帧原始长度
+ * @return 0 成功, -1 空间不足 (记录被丢弃)
+ */
+int8_t pcap_ring_put(pcap_ring_t *ring, uint32_t ts_ms, const uint8_t *data, uint16_t caplen,
+                     uint16_t origlen);
+
+/**
+ * @brief 待读出字节数
+ */
+uint16_t pcap_ring_used(const pcap_ring_t *ring);
+
+/**
+ * @brief 获取可连续读出的数据
+ * @param ring :环形缓冲区
+ * @param data :输出数据指针
+ * @return 连续可读字节数
+ */
+uint16_t pcap_ring_peek(const pcap_ring_t *ring, const uint8_t **data);
+
+/**
+ * @brief 标记已读出的字节
+ * @param ring :环形缓冲区
+ * @param len  :字节数, 不超过 pcap_ring_used
+ */
+void pcap_ring_consume(pcap_ring_t *ring, uint16_t len);
+#endif
@@ -0,0 +1,287 @@
+#include "wiz_capture.h"
+#include "wiz_timer.h"
+#include "wiz_txq.h"
+#include "wizchip_conf.h"
+#include "socket.h"
+#include <string.h>
+
+static uint8_t capture_ring_buf[WIZ_CAPTURE_RING_SIZE];
+static uint8_t capture_frame[WIZ_CAPTURE_SNAPLEN];
+static pcap_ring_t capture_ring;
+
+static uint8_t capture_running = 0;
+static uint8_t capture_flag = 0;
+static uint8_t capture_use_filter = 0;
+static net_frame_filter_t capture_filter;
+
+static wiz_capture_sink_t capture_sink = NULL;
+static uint8_t capture_hdr[PCAP_GLOBAL_HDR_LEN];
+static uint8_t capture_hdr_sent = PCAP_GLOBAL_HDR_LEN;   // 文件头已发送的字节数
+static uint8_t capture_stream_sn = 0;
+
+/* 令牌桶限速 */
+static uint32_t capture_rate = WIZ_CAPTURE_RATE_BPS;
+static uint32_t capture_burst = WIZ_CAPTURE_BURST;
+static uint32_t capture_tokens = WIZ_CAPTURE_BURST;
+static uint32_t capture_refill_ms = 0;
+
+static wiz_capture_stats_t capture_stats;
+
+/**
+ * @brief 打开 MACRAW socket
+ */
+static int8_t capture_open(void)
+{
+    close(WIZ_CAPTURE_SOCK);
+    if (socket(WIZ_CAPTURE_SOCK, Sn_MR_MACRAW, 0, capture_flag) != WIZ_CAPTURE_SOCK)
+        return -1;
+    return 0;
+}
+
+/**
+ * @brief 按经过的时间补充令牌
+ */
+static void capture_refill(void)
+{
+    uint32_t now = wiz_timer_get_ms();
+    uint32_t elapsed = now - capture_refill_ms;
+    uint32_t add;
+
+    if (elapsed == 0)
+        return;
+    capture_refill_ms = now;
+    /* 长时间未调用时直接补满, 避免乘法溢出 */
+    if (elapsed >= 1000)
+    {
+        capture_tokens = capture_burst;
+        return;
+    }
+    add = capture_rate * elapsed / 1000;
+    capture_tokens = (capture_tokens + add > capture_burst) ? capture_burst : capture_tokens + add;
+}
+
+/**
+ * @brief 从芯片取出若干帧写入记录环
+ *
+ * 连续读取多帧后只发一次 RECV 命令, Sn_RX_RSR 在命令前不会更新, 剩余量在本地计算。
+ */
+static void capture_rx(void)
+{
+    uint8_t head[2];
+    uint16_t rsr, pkt_len, cap;
+    uint16_t consumed = 0;
+    uint8_t frames = 0;
+    net_frame_info_t info;
+
+    rsr = getSn_RX_RSR(WIZ_CAPTURE_SOCK);
+    while (frames < WIZ_CAPTURE_FRAMES_PER_POLL && rsr - consumed >= 2)
+    {
+        wiz_recv_data(WIZ_CAPTURE_SOCK, head, 2);
+        pkt_len = (uint16_t)((head[0] << 8) | head[1]);
+        if (pkt_len < 2 || pkt_len > rsr - consumed)
+        {
+            /* 长度头异常, 缓冲区已不同步, 重开 socket 丢弃全部数据 */
+            capture_open();
+            return;
+        }
+        consumed += pkt_len;
+        pkt_len -= 2;
+        frames++;
+        capture_stats.frames_seen++;
+
+        cap = (pkt_len < WIZ_CAPTURE_SNAPLEN) ? pkt_len : WIZ_CAPTURE_SNAPLEN;
+        if (capture_tokens < (uint32_t)PCAP_RECORD_HDR_LEN + cap)
+        {
+            wiz_recv_ignore(WIZ_CAPTURE_SOCK, pkt_len);
+            capture_stats.rate_dropped++;
+            continue;
+        }
+
+        wiz_recv_data(WIZ_CAPTURE_SOCK, capture_frame, cap);
+        if (pkt_len > cap)
+            wiz_recv_ignore(WIZ_CAPTURE_SOCK, pkt_len - cap);
+
+        if (capture_use_filter)
+        {
+            net_frame_parse(capture_frame, cap, &info);
+            if (!net_frame_match(&capture_filter, &info))
+            {
+                capture_stats.frames_filtered++;
+                continue;
+            }
+        }
+
+        capture_tokens -= PCAP_RECORD_HDR_LEN + cap;
+        if (pcap_ring_put(&capture_ring, wiz_timer_get_ms(), capture_frame, cap, pkt_len) == 0)
+            capture_stats.frames_captured++;
+        else
+            capture_stats.ring_dropped++;
+    }
+
+    if (frames > 0)
+    {
+        setSn_CR(WIZ_CAPTURE_SOCK, Sn_CR_RECV);
+        while (getSn_CR(WIZ_CAPTURE_SOCK))
+            ;
+    }
+}
+
+/**
+ * @brief 把文件头和记录环中的数据交给输出端
+ */
+static void capture_drain(void)
+{
+    const uint8_t *data;
+    uint16_t len;
+    int32_t ret;
+
+    if (capture_sink == NULL)
+        return;
+
+    while (capture_hdr_sent < PCAP_GLOBAL_HDR_LEN)
+    {
+        ret = capture_sink(&capture_hdr[capture_hdr_sent], PCAP_GLOBAL_HDR_LEN - capture_hdr_sent);
+        if (ret <= 0)
+            goto sink_check;
+        capture_hdr_sent += (uint8_t)ret;
+        capture_stats.bytes_streamed += ret;
+    }
+
+    while ((len = pcap_ring_peek(&capture_ring, &data)) > 0)
+    {
+        ret = capture_sink(data, len);
+        if (ret <= 0)
+            goto sink_check;
+        pcap_ring_consume(&capture_ring, (uint16_t)ret);
+        capture_stats.bytes_streamed += ret;
+        if (ret < len)
+            break;
+    }
+    return;
+
+sink_check:
+    /* 输出端失效: 停止输出, 等待重新 set_sink */
+    if (ret < 0)
+        capture_sink = NULL;
+}
+
+/**
+ * @brief wiz_txq 输出端
+ */
+static int32_t capture_txq_sink(const uint8_t *data, uint16_t len)
+{
+    int32_t ret = wiz_txq_write(capture_stream_sn, data, len, 0);
+
+    if (ret == WIZ_TXQ_ERR_TIMEOUT)
+        return 0;
+    return ret;
+}
+
+/**
+ * @brief 开始抓包
+ * @param filter :过滤条件, NULL 表示全部
+ * @param flag   :socket() 的 flag, 0 表示全部
+ * @return 0 成功, -1 socket 打开失败
+ */
+int8_t wiz_capture_start(const net_frame_filter_t *filter, uint8_t flag)
+{
+    capture_use_filter = (filter != NULL);
+    if (filter != NULL)
+        capture_filter = *filter;
+    capture_flag = flag;
+
+    pcap_ring_init(&capture_ring, capture_ring_buf, sizeof(capture_ring_buf));
+    pcap_write_global_header(capture_hdr, WIZ_CAPTURE_SNAPLEN);
+    capture_hdr_sent = 0;
+    capture_tokens = capture_burst;
+    capture_refill_ms = wiz_timer_get_ms();
+    memset(&capture_stats, 0, sizeof(capture_stats));
+
+    if (capture_open() != 0)
+        return -1;
+    capture_running = 1;
+    return 0;
+}
+
+/**
+ * @brief 停止抓包并关闭 socket 0
+ */
+void wiz_capture_stop(void)
+{
+    if (!capture_running)
+        return;
+    capture_running = 0;
+    close(WIZ_CAPTURE_SOCK);
+}
+
+/**
+ * @brief 设置输出端
+ * @param sink :输出函数, NULL 表示只抓不输出
+ */
+void wiz_capture_set_sink(wiz_capture_sink_t sink)
+{
+    capture_sink = sink;
+    pcap_ring_reset(&capture_ring);
+    capture_hdr_sent = 0;
+}
+
+/**
+ * @brief 通过已建立的 TCP socket 输出
+ * @param sn :套接字编号, 需已调用 wiz_txq_open
+ */
+void wiz_capture_stream_to_socket(uint8_t sn)
+{
+    capture_stream_sn = sn;
+    wiz_capture_set_sink(capture_txq_sink);
+}
+
+/**
+ * @brief 设置限速
+ * @param bytes_per_s :每秒写入记录环的字节数
+ * @param burst       :允许的突发字节数
+ */
+void wiz_capture_set_rate(uint32_t bytes_per_s, uint32_t burst)
+{
+    capture_rate = bytes_per_s;
+    capture_burst = burst;
+    if (capture_tokens > burst)
+        capture_tokens = burst;
+}
+
+/**
+ * @brief 抓包处理, 由网络任务周期调用
+ */
+void wiz_capture_poll(void)
+{
+    if (!capture_running)
+        return;
+
+    /* 监控恢复流程 (芯片复位) 会关闭 socket 0 */
+    if (getSn_SR(WIZ_CAPTURE_SOCK) != SOCK_MACRAW)
+    {
+        if (getSn_SR(WIZ_CAPTURE_SOCK) != SOCK_CLOSED || capture_open() != 0)
+            return;
+        capture_stats.reopen++;
+    }
+
+    capture_refill();
+    capture_rx();
+    capture_drain();
+}
+
+/**
+ * @brief 是否正在抓包
+ */
+uint8_t wiz_capture_is_running(void)
+{
+    return capture_running;
+}
+
+/**
+ * @brief 获取抓包统计
+ * @param stats :输出统计信息
+ */
+void wiz_capture_get_stats(wiz_capture_stats_t *stats)
+{
+    *stats = capture_stats;
+}
@@ -0,0 +1,95 @@
+#ifndef __WIZ_CAPTURE_H__
+#define __WIZ_CAPTURE_H__
+
+#include <stdint.h>
+#include "net_pcap.h"
+
+/* W5500 只有 socket 0 支持 MACRAW */
+#define WIZ_CAPTURE_SOCK 0
+/* 每帧最多保存的字节数, 覆盖以太网/IP/TCP 头 */
+#define WIZ_CAPTURE_SNAPLEN 128
+/* pcap 记录环大小 */
+#define WIZ_CAPTURE_RING_SIZE 2048
+/* 默认限速: 每秒写入记录环的字节数和突发量 */
+#define WIZ_CAPTURE_RATE_BPS 4096
+#define WIZ_CAPTURE_BURST 1024
+/* 每次 poll 最多从芯片取出的帧数, 限制 SPI 占用 */
+#define WIZ_CAPTURE_FRAMES_PER_POLL 4
+
+/**
+ * @brief 抓包输出函数
+ * @param data :pcap 字节流
+ * @param len  :长度
+ * @return >=0 实际接收的字节数, <0 输出端已失效
+ */
+typedef int32_t (*wiz_capture_sink_t)(const uint8_t *data, uint16_t len);
+
+/**
+ * @brief 抓包统计
+ */
+typedef struct
+{
+    uint32_t frames_seen;      // 从芯片读到的帧数
+    uint32_t frames_captured;  // 写入记录环的帧数
+    uint32_t frames_filtered;  // 不满足过滤条件的帧数
+    uint32_t rate_dropped;     // 超出限速被跳过的帧数
+    uint32_t ring_dropped;     // 记录环满丢弃的帧数
+    uint32_t bytes_streamed;   // 已输出的字节数
+    uint32_t reopen;           // socket 0 被其他模块占用后重开次数
+} wiz_capture_stats_t;
+
+/**
+ * @brief 开始抓包
+ * @param filter :过滤条件, NULL 表示全部
+ * @param flag   :socket() 的 flag, 如 SF_ETHER_OWN 只收本机/广播/组播, 0 表示全部
+ * @return 0 成功, -1 socket 打开失败
+ *
+ * @note 芯片复位后 socket 0 被关闭, 由 poll 自动重开 (DHCP 使用 WIZ_DHCP_SOCK)
+ */
+int8_t wiz_capture_start(const net_frame_filter_t *filter, uint8_t flag);
+
+/**
+ * @brief 停止抓包并关闭 socket 0
+ */
+void wiz_capture_stop(void);
+
+/**
+ * @brief 设置输出端
+ * @param sink :输出函数, NULL 表示只抓不输出 (记录环满后丢弃新帧)
+ *
+ * 清空记录环并在输出开头重新发送 pcap 文件头, 每次主机重新连接时调用。
+ */
+void wiz_capture_set_sink(wiz_capture_sink_t sink);
+
+/**
+ * @brief 通过已建立的 TCP socket 输出 (经 wiz_txq 发送队列, 不阻塞)
+ * @param sn :套接字编号, 需已调用 wiz_txq_open
+ */
+void wiz_capture_stream_to_socket(uint8_t sn);
+
+/**
+ * @brief 设置限速
+ * @param bytes_per_s :每秒写入记录环的字节数 (含 16 字节记录头)
+ * @param burst       :允许的突发字节数
+ */
+void wiz_capture_set_rate(uint32_t bytes_per_s, uint32_t burst);
+
+/**
+ * @brief 抓包处理, 由网络任务周期调用
+ *
+ * 每次最多处理 WIZ_CAPTURE_FRAMES_PER_POLL 帧, 超出限速的帧只读取 2 字节长度头后跳过,
+ * 然后把记录环中的数据交给输出端。
+ */
+void wiz_capture_poll(void);
+
+/**
+ * @brief 是否正在抓包
+ */
+uint8_t wiz_capture_is_running(void);
+
+/**
+ * @brief 获取抓包统计
+ * @param stats :输出统计信息
+ */
+void wiz_capture_get_stats(wiz_capture_stats_t *stats);
+#endif
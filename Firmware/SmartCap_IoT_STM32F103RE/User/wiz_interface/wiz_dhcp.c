@@ -0,0 +1,975 @@
+#include "wiz_dhcp.h"
+#include "wiz_platform.h"
+#include "wiz_timer.h"
+#include "wiz_txq.h"
+#include "socket.h"
+#include "cmsis_os.h"
+#include "event_log.h"
+#include "console.h"
+#include <stddef.h>
+#include <string.h>
+
+#define WIZ_DHCP_SIGNAL 0x01
+
+#define WIZ_DHCP_SERVER_PORT 67
+#define WIZ_DHCP_CLIENT_PORT 68
+#define WIZ_DHCP_PROBE_PORT 5000
+
+/* 发送后在该时间内按 WIZ_DHCP_EVENT_POLL_MS 检查应答, 之后降为 1s */
+#define WIZ_DHCP_REPLY_WINDOW_MS 2000
+/* ARP 检测的保护超时, 正常情况下 socket 先报告 SENDOK/TIMEOUT */
+#define WIZ_DHCP_PROBE_TIMEOUT_MS 3000
+/* 服务器未给出租期时使用的默认值 (秒) */
+#define WIZ_DHCP_DEFAULT_LEASE_S 3600
+#define WIZ_DHCP_INFINITE 0xFFFFFFFFUL
+
+/* 报文布局: 固定头 236 字节 + magic cookie, 之后为选项 */
+#define WIZ_DHCP_OPT_OFFSET 240
+#define WIZ_DHCP_MSG_MIN 300
+#define WIZ_DHCP_MSG_MAX 576
+#define WIZ_DHCP_MAGIC_COOKIE 0x63825363UL
+
+/* Flash 租约记录标识 "LEAS" */
+#define WIZ_DHCP_LEASE_MAGIC 0x4C454153UL
+
+/* 报文类型 (option 53) */
+#define DHCP_MSG_DISCOVER 1
+#define DHCP_MSG_OFFER 2
+#define DHCP_MSG_REQUEST 3
+#define DHCP_MSG_DECLINE 4
+#define DHCP_MSG_ACK 5
+#define DHCP_MSG_NAK 6
+
+/* 选项编号 (RFC 2132) */
+#define DHCP_OPT_PAD 0
+#define DHCP_OPT_SUBNET 1
+#define DHCP_OPT_ROUTER 3
+#define DHCP_OPT_DNS 6
+#define DHCP_OPT_HOST_NAME 12
+#define DHCP_OPT_REQ_IP 50
+#define DHCP_OPT_LEASE 51
+#define DHCP_OPT_MSG_TYPE 53
+#define DHCP_OPT_SERVER_ID 54
+#define DHCP_OPT_PARAM_REQ 55
+#define DHCP_OPT_T1 58
+#define DHCP_OPT_T2 59
+#define DHCP_OPT_CLIENT_ID 61
+#define DHCP_OPT_END 255
+
+/* 任务命令 */
+#define DHCP_CMD_NONE 0
+#define DHCP_CMD_START 1
+#define DHCP_CMD_STOP 2
+
+/**
+ * @brief Flash 中保存的租约
+ */
+struct wiz_dhcp_record
+{
+    uint32_t magic;
+    uint8_t mac[6];
+    uint8_t reserved[2];
+    wiz_dhcp_lease_t lease;
+    uint32_t crc;
+};
+
+static osThreadId dhcp_task_handle = NULL;
+static osStaticThreadDef_t dhcp_task_cb;
+static uint32_t dhcp_task_stack[WIZ_DHCP_TASK_STACK];
+static volatile uint8_t dhcp_cmd = DHCP_CMD_NONE;
+static volatile uint8_t cmd_seq = 0;        // 每发出一条命令加 1
+static volatile uint8_t cmd_done_seq = 0;   // 任务已处理到的命令序号
+static uint8_t *cmd_buf = NULL;
+static wiz_NetInfo cmd_conf;
+
+static uint8_t *dhcp_buf = NULL;
+static wiz_NetInfo dhcp_conf;               // MAC 和退回用的静态配置
+static volatile wiz_dhcp_state_t dhcp_state = WIZ_DHCP_STATE_STOPPED;
+static wiz_dhcp_lease_t dhcp_lease;         // 当前租约 (REBOOTING 时为待确认的旧租约)
+static wiz_dhcp_lease_t dhcp_offer;         // SELECTING/REQUESTING/PROBING 中的候选租约
+static uint32_t dhcp_xid = 0;
+static uint32_t dhcp_deadline = 0;          // 下一次重传/超时时刻 (ms)
+static uint32_t dhcp_retx_ms = WIZ_DHCP_RETX_MIN_MS;
+static uint8_t dhcp_tries = 0;
+static uint32_t dhcp_sent_ms = 0;
+static uint32_t dhcp_start_ms = 0;
+static uint32_t dhcp_fallback_deadline = 0;
+static uint8_t dhcp_fallback_active = 0;
+static uint8_t dhcp_bound_once = 0;
+static volatile uint8_t dhcp_addr_ok = 0;
+static volatile uint8_t dhcp_change_seq = 0;
+static uint8_t dhcp_change_seen = 0;
+
+/* 租约计时 (秒), 由毫秒计数累加, 不受 32 位毫秒回绕影响 */
+static uint32_t lease_elapsed_s = 0;
+static uint32_t lease_ms_acc = 0;
+static uint32_t lease_last_ms = 0;
+static uint32_t renew_next_s = 0;
+
+static wiz_dhcp_stats_t dhcp_stats;
+
+static const uint8_t ip_broadcast[4] = {255, 255, 255, 255};
+static const uint8_t ip_zero[4] = {0, 0, 0, 0};
+
+/**
+ * @brief 比较两个时刻, 允许计数回绕
+ * @return a 不早于 b 时返回非 0
+ */
+static uint8_t time_reached(uint32_t now, uint32_t t)
+{
+    return (int32_t)(now - t) >= 0;
+}
+
+static uint8_t ip_is_zero(const uint8_t ip[4])
+{
+    return (ip[0] | ip[1] | ip[2] | ip[3]) == 0;
+}
+
+static uint32_t get_be32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static void put_be32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+/**
+ * @brief CRC-32 (IEEE 802.3), 用于校验 Flash 中的租约
+ */
+static uint32_t dhcp_crc32(const uint8_t *data, uint16_t len)
+{
+    uint32_t crc = 0xFFFFFFFFUL;
+    uint8_t bit;
+
+    while (len--)
+    {
+        crc ^= *data++;
+        for (bit = 0; bit < 8; bit++)
+            crc = (crc >> 1) ^ (0xEDB88320UL & (0UL - (crc & 1)));
+    }
+    return ~crc;
+}
+
+/**
+ * @brief 标记地址变化, 由 wiz_dhcp_take_changed 取出
+ */
+static void dhcp_mark_changed(void)
+{
+    dhcp_change_seq++;
+}
+
+/**
+ * @brief 开始新的事务 (DISCOVER/INIT-REBOOT/续租), 重传沿用同一 xid
+ */
+static void dhcp_new_xid(void)
+{
+    dhcp_xid = dhcp_xid * 1103515245UL + 12345UL + wiz_timer_get_ms();
+}
+
+/**
+ * @brief 读取 Flash 中的租约
+ * @return 1 有本机 MAC 对应的有效租约
+ */
+static uint8_t dhcp_load_lease(wiz_dhcp_lease_t *lease)
+{
+    struct wiz_dhcp_record rec;
+
+    wiz_lease_load(&rec, sizeof(rec));
+    if (rec.magic != WIZ_DHCP_LEASE_MAGIC ||
+        rec.crc != dhcp_crc32((const uint8_t *)&rec, (uint16_t)offsetof(struct wiz_dhcp_record, crc)) ||
+        memcmp(rec.mac, dhcp_conf.mac, sizeof(rec.mac)) != 0 || ip_is_zero(rec.lease.ip))
+        return 0;
+    *lease = rec.lease;
+    return 1;
+}
+
+/**
+ * @brief 租约内容变化时写入 Flash
+ *
+ * 只比较地址类字段: 部分服务器续租时返回剩余租期, 每次都不同, 不应因此擦写 Flash
+ */
+static void dhcp_save_lease(void)
+{
+    struct wiz_dhcp_record rec;
+    wiz_dhcp_lease_t old;
+
+    if (dhcp_load_lease(&old) &&
+        memcmp(old.ip, dhcp_lease.ip, 4) == 0 && memcmp(old.sn, dhcp_lease.sn, 4) == 0 &&
+        memcmp(old.gw, dhcp_lease.gw, 4) == 0 && memcmp(old.dns, dhcp_lease.dns, 4) == 0 &&
+        memcmp(old.server, dhcp_lease.server, 4) == 0)
+        return;
+
+    memset(&rec, 0, sizeof(rec));
+    rec.magic = WIZ_DHCP_LEASE_MAGIC;
+    memcpy(rec.mac, dhcp_conf.mac, sizeof(rec.mac));
+    rec.lease = dhcp_lease;
+    rec.crc = dhcp_crc32((const uint8_t *)&rec, (uint16_t)offsetof(struct wiz_dhcp_record, crc));
+    if (wiz_lease_save(&rec, sizeof(rec)) == 0)
+        dhcp_stats.lease_saves++;
+}
+
+/**
+ * @brief 打开 DHCP socket (非阻塞 UDP)
+ * @return 0 成功, -1 失败
+ */
+static int8_t dhcp_open(void)
+{
+    if (getSn_SR(WIZ_DHCP_SOCK) == SOCK_UDP)
+        return 0;
+    wiz_udp_send_reset(WIZ_DHCP_SOCK);
+    if (socket(WIZ_DHCP_SOCK, Sn_MR_UDP, WIZ_DHCP_CLIENT_PORT, SF_IO_NONBLOCK) != WIZ_DHCP_SOCK)
+        return -1;
+    return 0;
+}
+
+/**
+ * @brief 构造 DHCP 报文
+ * @param type   :报文类型
+ * @param ciaddr :客户端当前地址 (RENEWING/REBINDING), NULL 表示还没有地址, 请求服务器广播应答
+ * @param req_ip :option 50, 可为 NULL
+ * @param server :option 54, 可为 NULL
+ * @return 报文长度
+ */
+static uint16_t dhcp_build(uint8_t type, const uint8_t *ciaddr, const uint8_t *req_ip, const uint8_t *server)
+{
+    static const char hex[] = "0123456789ABCDEF";
+    static const uint8_t params[] = {DHCP_OPT_SUBNET, DHCP_OPT_ROUTER, DHCP_OPT_DNS,
+                                     DHCP_OPT_LEASE, DHCP_OPT_T1, DHCP_OPT_T2};
+    const char *host = WIZ_DHCP_HOST_NAME;
+    uint8_t *m = dhcp_buf;
+    uint16_t k = WIZ_DHCP_OPT_OFFSET;
+    uint8_t i, n;
+
+    memset(m, 0, WIZ_DHCP_OPT_OFFSET);
+    m[0] = 1;   // BOOTREQUEST
+    m[1] = 1;   // 以太网
+    m[2] = 6;
+    put_be32(&m[4], dhcp_xid);
+    if (ciaddr == NULL)
+        m[10] = 0x80;
+    else
+        memcpy(&m[12], ciaddr, 4);
+    memcpy(&m[28], dhcp_conf.mac, 6);
+    put_be32(&m[236], WIZ_DHCP_MAGIC_COOKIE);
+
+    m[k++] = DHCP_OPT_MSG_TYPE;
+    m[k++] = 1;
+    m[k++] = type;
+
+    m[k++] = DHCP_OPT_CLIENT_ID;
+    m[k++] = 7;
+    m[k++] = 1;
+    memcpy(&m[k], dhcp_conf.mac, 6);
+    k += 6;
+
+    if (req_ip != NULL)
+    {
+        m[k++] = DHCP_OPT_REQ_IP;
+        m[k++] = 4;
+        memcpy(&m[k], req_ip, 4);
+        k += 4;
+    }
+    if (server != NULL)
+    {
+        m[k++] = DHCP_OPT_SERVER_ID;
+        m[k++] = 4;
+        memcpy(&m[k], server, 4);
+        k += 4;
+    }
+
+    if (type != DHCP_MSG_DECLINE)
+    {
+        /* 主机名: 前缀 + MAC 后 3 字节 */
+        n = (uint8_t)strlen(host);
+        m[k++] = DHCP_OPT_HOST_NAME;
+        m[k++] = n + 6;
+        memcpy(&m[k], host, n);
+        k += n;
+        for (i = 3; i < 6; i++)
+        {
+            m[k++] = hex[dhcp_conf.mac[i] >> 4];
+            m[k++] = hex[dhcp_conf.mac[i] & 0x0F];
+        }
+
+        m[k++] = DHCP_OPT_PARAM_REQ;
+        m[k++] = sizeof(params);
+        memcpy(&m[k], params, sizeof(params));
+        k += sizeof(params);
+    }
+
+    m[k++] = DHCP_OPT_END;
+    while (k < WIZ_DHCP_MSG_MIN)
+        m[k++] = 0;
+    return k;
+}
+
+/**
+ * @brief 发出 UDP 报文, 不等待 SENDOK (单播 ARP 期间不阻塞 DHCP 任务)
+ * @return 0 已发出, -1 socket 不可用或上一帧尚未完成 (由重传补发)
+ */
+static int8_t dhcp_send(const uint8_t *ip, uint16_t port, uint16_t len)
+{
+    if (dhcp_open() != 0)
+        return -1;
+    if (wiz_udp_send_nowait(WIZ_DHCP_SOCK, dhcp_buf, len, ip, port) != 0)
+        return -1;
+    dhcp_sent_ms = wiz_timer_get_ms();
+    return 0;
+}
+
+static void dhcp_send_discover(void)
+{
+    uint16_t len = dhcp_build(DHCP_MSG_DISCOVER, NULL, NULL, NULL);
+    if (dhcp_send(ip_broadcast, WIZ_DHCP_SERVER_PORT, len) == 0)
+        dhcp_stats.discovers++;
+}
+
+/**
+ * @brief 按当前状态发送 REQUEST
+ *
+ * - REQUESTING: 广播, 带 option 50/54 (选择某个 OFFER)
+ * - REBOOTING : 广播, 只带 option 50 (确认保存的地址, RFC 2131 4.3.2)
+ * - RENEWING  : 单播给原服务器, ciaddr 为当前地址
+ * - REBINDING : 广播, ciaddr 为当前地址
+ */
+static void dhcp_send_request(void)
+{
+    uint16_t len;
+    const uint8_t *dst = ip_broadcast;
+
+    switch (dhcp_state)
+    {
+    case WIZ_DHCP_STATE_REQUESTING:
+        len = dhcp_build(DHCP_MSG_REQUEST, NULL, dhcp_offer.ip, dhcp_offer.server);
+        break;
+    case WIZ_DHCP_STATE_REBOOTING:
+        len = dhcp_build(DHCP_MSG_REQUEST, NULL, dhcp_lease.ip, NULL);
+        break;
+    case WIZ_DHCP_STATE_RENEWING:
+        len = dhcp_build(DHCP_MSG_REQUEST, dhcp_lease.ip, NULL, NULL);
+        dst = dhcp_lease.server;
+        break;
+    case WIZ_DHCP_STATE_REBINDING:
+        len = dhcp_build(DHCP_MSG_REQUEST, dhcp_lease.ip, NULL, NULL);
+        break;
+    default:
+        return;
+    }
+    if (dhcp_send(dst, WIZ_DHCP_SERVER_PORT, len) == 0)
+        dhcp_stats.requests++;
+}
+
+/**
+ * @brief 清除芯片上的 IP/网关, 之后的报文以 0.0.0.0 为源地址
+ */
+static void dhcp_clear_address(void)
+{
+    setSIPR((uint8_t *)ip_zero);
+    setGAR((uint8_t *)ip_zero);
+}
+
+/**
+ * @brief 放弃当前租约并重新 DISCOVER
+ * @param delay_ms :开始 DISCOVER 前的等待
+ */
+static void dhcp_restart(uint32_t delay_ms)
+{
+    if (dhcp_addr_ok && !dhcp_fallback_active)
+    {
+        dhcp_clear_address();
+        dhcp_addr_ok = 0;
+        dhcp_mark_changed();
+    }
+    memset(&dhcp_lease, 0, sizeof(dhcp_lease));
+    dhcp_state = WIZ_DHCP_STATE_INIT;
+    dhcp_deadline = wiz_timer_get_ms() + delay_ms;
+}
+
+/**
+ * @brief 应用租约, 进入 BOUND
+ * @param lease :服务器 ACK 中的租约
+ */
+static void dhcp_bind(const wiz_dhcp_lease_t *lease)
+{
+    wiz_dhcp_lease_t l = *lease;
+    wiz_NetInfo info;
+    uint32_t now = wiz_timer_get_ms();
+    uint8_t changed;
+
+    if (ip_is_zero(l.server))
+        memcpy(l.server, ip_is_zero(dhcp_offer.server) ? dhcp_lease.server : dhcp_offer.server, 4);
+    if (l.lease_s == 0)
+        l.lease_s = WIZ_DHCP_DEFAULT_LEASE_S;
+    if (l.lease_s == WIZ_DHCP_INFINITE)
+    {
+        l.t1_s = WIZ_DHCP_INFINITE;
+        l.t2_s = WIZ_DHCP_INFINITE;
+    }
+    else
+    {
+        if (l.t1_s == 0 || l.t1_s >= l.lease_s)
+            l.t1_s = l.lease_s / 2;
+        if (l.t2_s == 0 || l.t2_s >= l.lease_s || l.t2_s < l.t1_s)
+            l.t2_s = l.lease_s / 8 * 7;
+    }
+
+    changed = dhcp_addr_ok && (dhcp_fallback_active || memcmp(dhcp_lease.ip, l.ip, 4) != 0);
+    if (!dhcp_addr_ok || dhcp_fallback_active ||
+        memcmp(dhcp_lease.ip, l.ip, 4) != 0 || memcmp(dhcp_lease.sn, l.sn, 4) != 0 ||
+        memcmp(dhcp_lease.gw, l.gw, 4) != 0 || memcmp(dhcp_lease.dns, l.dns, 4) != 0)
+    {
+        /* 续租得到相同参数时不重写寄存器, 已建立的连接不受影响 */
+        memcpy(info.mac, dhcp_conf.mac, 6);
+        memcpy(info.ip, l.ip, 4);
+        memcpy(info.sn, l.sn, 4);
+        memcpy(info.gw, l.gw, 4);
+        memcpy(info.dns, l.dns, 4);
+        info.dhcp = NETINFO_DHCP;
+        wizchip_setnetinfo(&info);
+    }
+
+    if (!dhcp_bound_once)
+    {
+        if (dhcp_state == WIZ_DHCP_STATE_REBOOTING)
+            dhcp_stats.warm_bind_ms = now - dhcp_start_ms;
+        else
+            dhcp_stats.cold_bind_ms = now - dhcp_start_ms;
+        dhcp_bound_once = 1;
+    }
+
+    dhcp_lease = l;
+    dhcp_fallback_active = 0;
+    dhcp_addr_ok = 1;
+    if (changed)
+        dhcp_mark_changed();
+
+    dhcp_state = WIZ_DHCP_STATE_BOUND;
+    lease_elapsed_s = 0;
+    lease_ms_acc = 0;
+    lease_last_ms = now;
+
+    dhcp_save_lease();
+}
+
+/**
+ * @brief 解析服务器应答 (所有选项都做长度检查, 越界的报文整体丢弃)
+ * @param len :报文长度
+ * @param out :输出租约信息
+ * @return 报文类型, 0 表示不是发给本机当前事务的有效应答
+ */
+static uint8_t dhcp_parse(uint16_t len, wiz_dhcp_lease_t *out)
+{
+    const uint8_t *m = dhcp_buf;
+    uint16_t i = WIZ_DHCP_OPT_OFFSET;
+    uint8_t code, olen, type = 0;
+
+    if (len < WIZ_DHCP_OPT_OFFSET || m[0] != 2 || get_be32(&m[4]) != dhcp_xid ||
+        memcmp(&m[28], dhcp_conf.mac, 6) != 0)
+        return 0;
+    if (get_be32(&m[236]) != WIZ_DHCP_MAGIC_COOKIE)
+    {
+        dhcp_stats.bad_replies++;
+        return 0;
+    }
+
+    memset(out, 0, sizeof(*out));
+    memcpy(out->ip, &m[16], 4);
+
+    while (i < len)
+    {
+        code = m[i++];
+        if (code == DHCP_OPT_PAD)
+            continue;
+        if (code == DHCP_OPT_END)
+            break;
+        if (i >= len || m[i] > len - i - 1)
+        {
+            dhcp_stats.bad_replies++;
+            return 0;
+        }
+        olen = m[i++];
+        switch (code)
+        {
+        case DHCP_OPT_MSG_TYPE:
+            if (olen >= 1)
+                type = m[i];
+            break;
+        case DHCP_OPT_SUBNET:
+            if (olen >= 4)
+                memcpy(out->sn, &m[i], 4);
+            break;
+        case DHCP_OPT_ROUTER:       // 多个地址时取第一个
+            if (olen >= 4)
+                memcpy(out->gw, &m[i], 4);
+            break;
+        case DHCP_OPT_DNS:
+            if (olen >= 4)
+                memcpy(out->dns, &m[i], 4);
+            break;
+        case DHCP_OPT_SERVER_ID:
+            if (olen >= 4)
+                memcpy(out->server, &m[i], 4);
+            break;
+        case DHCP_OPT_LEASE:
+            if (olen >= 4)
+                out->lease_s = get_be32(&m[i]);
+            break;
+        case DHCP_OPT_T1:
+            if (olen >= 4)
+                out->t1_s = get_be32(&m[i]);
+            break;
+        case DHCP_OPT_T2:
+            if (olen >= 4)
+                out->t2_s = get_be32(&m[i]);
+            break;
+        default:
+            break;
+        }
+        i += olen;
+    }
+    return type;
+}
+
+/**
+ * @brief 处理一条应答
+ */
+static void dhcp_on_reply(uint8_t type, const wiz_dhcp_lease_t *rx)
+{
+    uint32_t now = wiz_timer_get_ms();
+
+    if (type == DHCP_MSG_ACK)
+        dhcp_stats.acks++;
+    else if (type == DHCP_MSG_NAK)
+        dhcp_stats.naks++;
+
+    switch (dhcp_state)
+    {
+    case WIZ_DHCP_STATE_SELECTING:
+        if (type != DHCP_MSG_OFFER || ip_is_zero(rx->ip) || ip_is_zero(rx->server))
+            break;
+        dhcp_offer = *rx;
+        dhcp_state = WIZ_DHCP_STATE_REQUESTING;
+        dhcp_tries = 0;
+        dhcp_retx_ms = WIZ_DHCP_RETX_MIN_MS;
+        dhcp_deadline = now + dhcp_retx_ms;
+        dhcp_send_request();
+        break;
+
+    case WIZ_DHCP_STATE_REQUESTING:
+        if (type == DHCP_MSG_ACK)
+        {
+            if (ip_is_zero(rx->server))
+            {
+                wiz_dhcp_lease_t l = *rx;
+                memcpy(l.server, dhcp_offer.server, 4);
+                dhcp_offer = l;
+            }
+            else
+            {
+                dhcp_offer = *rx;
+            }
+#if WIZ_DHCP_PROBE
+            /* 以 0.0.0.0 (或退回的静态地址) 为源对新地址做 ARP: 有应答说明地址已被占用 */
+            dhcp_buf[0] = 0;
+            dhcp_state = WIZ_DHCP_STATE_PROBING;
+            dhcp_deadline = now + WIZ_DHCP_PROBE_TIMEOUT_MS;
+            if (dhcp_send(dhcp_offer.ip, WIZ_DHCP_PROBE_PORT, 1) != 0)
+                dhcp_bind(&dhcp_offer);
+#else
+            dhcp_bind(&dhcp_offer);
+#endif
+        }
+        else if (type == DHCP_MSG_NAK)
+        {
+            dhcp_restart(0);
+        }
+        break;
+
+    case WIZ_DHCP_STATE_REBOOTING:
+    case WIZ_DHCP_STATE_RENEWING:
+    case WIZ_DHCP_STATE_REBINDING:
+        if (type == DHCP_MSG_ACK && !ip_is_zero(rx->ip))
+        {
+            if (dhcp_state != WIZ_DHCP_STATE_REBOOTING)
+                dhcp_stats.renewals++;
+            dhcp_bind(rx);
+        }
+        else if (type == DHCP_MSG_NAK)
+        {
+            /* 地址已不属于本机 (换了网络或服务器回收), 立即停止使用 */
+            dhcp_restart(0);
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief 取出 socket 中的所有报文
+ */
+static void dhcp_receive(void)
+{
+    wiz_dhcp_lease_t rx;
+    uint8_t addr[4];
+    uint16_t port;
+    int32_t len;
+    uint8_t type;
+
+    if (getSn_SR(WIZ_DHCP_SOCK) != SOCK_UDP)
+        return;
+    while (getSn_RX_RSR(WIZ_DHCP_SOCK) > 0)
+    {
+        len = recvfrom(WIZ_DHCP_SOCK, dhcp_buf, WIZ_DHCP_MSG_MAX, addr, &port);
+        if (len <= 0)
+            break;
+        if (port != WIZ_DHCP_SERVER_PORT)
+            continue;
+        type = dhcp_parse((uint16_t)len, &rx);
+        if (type != 0)
+            dhcp_on_reply(type, &rx);
+    }
+}
+
+/**
+ * @brief 计算续租/重绑定的下一次重传时刻: 剩余时间的一半, 不小于 60s (RFC 2131 4.4.5)
+ */
+static uint32_t dhcp_renew_next(uint32_t until_s)
+{
+    uint32_t half = (until_s > lease_elapsed_s) ? (until_s - lease_elapsed_s) / 2 : 0;
+    if (half < WIZ_DHCP_RENEW_RETX_MIN_S)
+        half = WIZ_DHCP_RENEW_RETX_MIN_S;
+    return lease_elapsed_s + half;
+}
+
+/**
+ * @brief 处理启动命令
+ */
+static void dhcp_do_start(void)
+{
+    uint32_t now = wiz_timer_get_ms();
+
+    dhcp_buf = cmd_buf;
+    dhcp_conf = cmd_conf;
+
+    close(WIZ_DHCP_SOCK);
+    wiz_udp_send_reset(WIZ_DHCP_SOCK);
+    dhcp_open();
+    dhcp_clear_address();
+
+    dhcp_addr_ok = 0;
+    dhcp_fallback_active = 0;
+    dhcp_bound_once = 0;
+    dhcp_start_ms = now;
+    dhcp_fallback_deadline = now + WIZ_DHCP_FALLBACK_MS;
+    dhcp_xid ^= ((uint32_t)dhcp_conf.mac[3] << 16) | ((uint32_t)dhcp_conf.mac[4] << 8) | dhcp_conf.mac[5];
+    dhcp_new_xid();
+    memset(&dhcp_offer, 0, sizeof(dhcp_offer));
+
+    /* 链路恢复时沿用内存中的租约, 上电时从 Flash 读取 */
+    if (ip_is_zero(dhcp_lease.ip) && !dhcp_load_lease(&dhcp_lease))
+        memset(&dhcp_lease, 0, sizeof(dhcp_lease));
+
+    if (!ip_is_zero(dhcp_lease.ip))
+    {
+        dhcp_state = WIZ_DHCP_STATE_REBOOTING;
+        dhcp_tries = 0;
+        dhcp_retx_ms = WIZ_DHCP_RETX_MIN_MS;
+        dhcp_deadline = now + dhcp_retx_ms;
+        dhcp_send_request();
+    }
+    else
+    {
+        dhcp_state = WIZ_DHCP_STATE_INIT;
+        dhcp_deadline = now;
+    }
+}
+
+/**
+ * @brief 处理停止命令
+ */
+static void dhcp_do_stop(void)
+{
+    close(WIZ_DHCP_SOCK);
+    wiz_udp_send_reset(WIZ_DHCP_SOCK);
+    dhcp_addr_ok = 0;
+    dhcp_state = WIZ_DHCP_STATE_STOPPED;
+}
+
+/**
+ * @brief 状态机处理一次
+ * @return 下一次需要处理的最长等待时间 (ms)
+ */
+static uint32_t dhcp_process(void)
+{
+    uint32_t now;
+    uint32_t wait;
+    uint8_t seq = cmd_seq;
+    uint8_t result;
+
+    if (seq != cmd_done_seq)
+    {
+        /* 处理完成后才更新序号, 期间 wiz_dhcp_has_address 返回 0 */
+        if (dhcp_cmd == DHCP_CMD_START)
+            dhcp_do_start();
+        else
+            dhcp_do_stop();
+        cmd_done_seq = seq;
+    }
+    if (dhcp_state == WIZ_DHCP_STATE_STOPPED)
+        return osWaitForever;
+
+    dhcp_open();
+    dhcp_receive();
+    result = wiz_udp_send_status(WIZ_DHCP_SOCK);
+    now = wiz_timer_get_ms();
+
+    if (dhcp_state == WIZ_DHCP_STATE_BOUND || dhcp_state == WIZ_DHCP_STATE_RENEWING ||
+        dhcp_state == WIZ_DHCP_STATE_REBINDING)
+    {
+        lease_ms_acc += now - lease_last_ms;
+        lease_last_ms = now;
+        while (lease_ms_acc >= 1000)
+        {
+            lease_ms_acc -= 1000;
+            lease_elapsed_s++;
+        }
+    }
+
+    switch (dhcp_state)
+    {
+    case WIZ_DHCP_STATE_INIT:
+        if (!time_reached(now, dhcp_deadline))
+            break;
+        dhcp_new_xid();
+        dhcp_state = WIZ_DHCP_STATE_SELECTING;
+        dhcp_retx_ms = WIZ_DHCP_RETX_MIN_MS;
+        dhcp_deadline = now + dhcp_retx_ms;
+        dhcp_send_discover();
+        break;
+
+    case WIZ_DHCP_STATE_SELECTING:
+        if (!time_reached(now, dhcp_deadline))
+            break;
+        if (dhcp_retx_ms < WIZ_DHCP_RETX_MAX_MS)
+            dhcp_retx_ms *= 2;
+        dhcp_deadline = now + dhcp_retx_ms;
+        dhcp_send_discover();
+        break;
+
+    case WIZ_DHCP_STATE_REQUESTING:
+        if (!time_reached(now, dhcp_deadline))
+            break;
+        if (++dhcp_tries >= WIZ_DHCP_REQUEST_TRIES)
+        {
+            dhcp_restart(0);
+            break;
+        }
+        dhcp_retx_ms *= 2;
+        dhcp_deadline = now + dhcp_retx_ms;
+        dhcp_send_request();
+        break;
+
+    case WIZ_DHCP_STATE_REBOOTING:
+        if (!time_reached(now, dhcp_deadline))
+            break;
+        if (++dhcp_tries >= WIZ_DHCP_REBOOT_TRIES)
+        {
+            /* 服务器不确认保存的地址, 按冷启动重新获取 */
+            dhcp_restart(0);
+            break;
+        }
+        dhcp_deadline = now + dhcp_retx_ms;
+        dhcp_send_request();
+        break;
+
+    case WIZ_DHCP_STATE_PROBING:
+        if (result == WIZ_UDP_SEND_OK)
+        {
+            /* ARP 有应答: 地址冲突 */
+            dhcp_stats.declines++;
+            dhcp_send(ip_broadcast, WIZ_DHCP_SERVER_PORT,
+                      dhcp_build(DHCP_MSG_DECLINE, NULL, dhcp_offer.ip, dhcp_offer.server));
+            dhcp_restart(WIZ_DHCP_DECLINE_WAIT_MS);
+        }
+        else if (result == WIZ_UDP_SEND_TIMEOUT || time_reached(now, dhcp_deadline))
+        {
+            wiz_udp_send_reset(WIZ_DHCP_SOCK);
+            dhcp_bind(&dhcp_offer);
+        }
+        break;
+
+    case WIZ_DHCP_STATE_BOUND:
+        if (dhcp_lease.lease_s == WIZ_DHCP_INFINITE || lease_elapsed_s < dhcp_lease.t1_s)
+            break;
+        dhcp_new_xid();
+        dhcp_state = WIZ_DHCP_STATE_RENEWING;
+        renew_next_s = dhcp_renew_next(dhcp_lease.t2_s);
+        dhcp_send_request();
+        break;
+
+    case WIZ_DHCP_STATE_RENEWING:
+        if (lease_elapsed_s >= dhcp_lease.t2_s)
+        {
+            dhcp_state = WIZ_DHCP_STATE_REBINDING;
+            renew_next_s = dhcp_renew_next(dhcp_lease.lease_s);
+            dhcp_send_request();
+        }
+        else if (lease_elapsed_s >= renew_next_s)
+        {
+            renew_next_s = dhcp_renew_next(dhcp_lease.t2_s);
+            dhcp_send_request();
+        }
+        break;
+
+    case WIZ_DHCP_STATE_REBINDING:
+        if (lease_elapsed_s >= dhcp_lease.lease_s)
+        {
+            dhcp_stats.expirations++;
+            dhcp_restart(0);
+        }
+        else if (lease_elapsed_s >= renew_next_s)
+        {
+            renew_next_s = dhcp_renew_next(dhcp_lease.lease_s);
+            dhcp_send_request();
+        }
+        break;
+
+    default:
+        break;
+    }
+
+    /* 长时间没有地址时先用静态配置, 获得租约后再切换 (由 wiz_dhcp_take_changed 通知) */
+    if (!dhcp_addr_ok && !dhcp_fallback_active && !ip_is_zero(dhcp_conf.ip) &&
+        time_reached(now, dhcp_fallback_deadline))
+    {
+        wiz_NetInfo info = dhcp_conf;
+        info.dhcp = NETINFO_STATIC;
+        wizchip_setnetinfo(&info);
+        dhcp_fallback_active = 1;
+        dhcp_addr_ok = 1;
+        dhcp_stats.fallbacks++;
+    }
+
+    /* 刚发出报文时快速检查应答, 其余时间按 1s 推进租约计时和重传 */
+    if (wiz_udp_send_busy(WIZ_DHCP_SOCK) || (now - dhcp_sent_ms) < WIZ_DHCP_REPLY_WINDOW_MS)
+        return WIZ_DHCP_EVENT_POLL_MS;
+    wait = 1000;
+    if (dhcp_state == WIZ_DHCP_STATE_INIT || dhcp_state == WIZ_DHCP_STATE_SELECTING ||
+        dhcp_state == WIZ_DHCP_STATE_REQUESTING || dhcp_state == WIZ_DHCP_STATE_REBOOTING)
+    {
+        if (time_reached(now, dhcp_deadline))
+            wait = 1;
+        else if (dhcp_deadline - now < wait)
+            wait = dhcp_deadline - now;
+    }
+    return wait;
+}
+
+/**
+ * @brief DHCP 任务: 等待命令或下一个事件时刻
+ */
+static void wiz_dhcp_task(void const *argument)
+{
+    uint32_t wait;
+    for (;;)
+    {
+        wait = dhcp_process();
+        osSignalWait(WIZ_DHCP_SIGNAL, wait);
+    }
+}
+
+/**
+ * @brief 向 DHCP 任务发送命令, 首次调用时创建任务
+ */
+static void dhcp_post(uint8_t cmd)
+{
+    if (dhcp_task_handle == NULL)
+    {
+        osThreadStaticDef(wizDhcpTask, wiz_dhcp_task, osPriorityBelowNormal, 0, WIZ_DHCP_TASK_STACK,
+                          dhcp_task_stack, &dhcp_task_cb);
+        dhcp_task_handle = osThreadCreate(osThread(wizDhcpTask), NULL);
+        if (dhcp_task_handle == NULL)
+        {
+            Console_Puts("DHCP: task create failed\r\n");
+            EVENT_LOG1(TASK_CREATE_FAILED, EventLog_Tag("dhcp"));
+            return;
+        }
+    }
+    dhcp_cmd = cmd;
+    cmd_seq++;
+    osSignalSet(dhcp_task_handle, WIZ_DHCP_SIGNAL);
+}
+
+/**
+ * @brief 启动 DHCP (非阻塞)
+ * @param buf      :报文缓冲区
+ * @param fallback :MAC 和 DHCP 失败时使用的静态配置
+ */
+void wiz_dhcp_start(uint8_t *buf, const wiz_NetInfo *fallback)
+{
+    cmd_buf = buf;
+    cmd_conf = *fallback;
+    dhcp_post(DHCP_CMD_START);
+}
+
+/**
+ * @brief 停止 DHCP 并关闭 socket
+ */
+void wiz_dhcp_stop(void)
+{
+    if (dhcp_task_handle != NULL)
+        dhcp_post(DHCP_CMD_STOP);
+}
+
+/**
+ * @brief 当前是否有可用地址
+ */
+uint8_t wiz_dhcp_has_address(void)
+{
+    return cmd_seq == cmd_done_seq && dhcp_addr_ok;
+}
+
+/**
+ * @brief 取出并清除 "地址已变化" 标志 (只允许一个调用者)
+ */
+uint8_t wiz_dhcp_take_changed(void)
+{
+    uint8_t seq = dhcp_change_seq;
+    if (seq == dhcp_change_seen)
+        return 0;
+    dhcp_change_seen = seq;
+    return 1;
+}
+
+/**
+ * @brief 获取当前状态
+ */
+wiz_dhcp_state_t wiz_dhcp_get_state(void)
+{
+    return dhcp_state;
+}
+
+/**
+ * @brief 获取当前租约
+ * @param lease :输出租约信息
+ */
+void wiz_dhcp_get_lease(wiz_dhcp_lease_t *lease)
+{
+    *lease = dhcp_lease;
+}
+
+/**
+ * @brief 获取 DHCP 统计
+ * @param stats :输出统计信息
+ */
+void wiz_dhcp_get_stats(wiz_dhcp_stats_t *stats)
+{
+    *stats = dhcp_stats;
+}
@@ -0,0 +1,125 @@
+#ifndef __WIZ_DHCP_H__
+#define __WIZ_DHCP_H__
+
+#include <stdint.h>
+#include "wizchip_conf.h"
+
+/* DHCP 使用的 socket (socket 0 留给 MACRAW 抓包) */
+#define WIZ_DHCP_SOCK 7
+
+/* 首次重传间隔, 之后每次加倍直到上限 (RFC 2131 4.1) */
+#define WIZ_DHCP_RETX_MIN_MS 2000
+#define WIZ_DHCP_RETX_MAX_MS 64000
+/* REQUESTING 状态最多重传次数, 超过后重新 DISCOVER */
+#define WIZ_DHCP_REQUEST_TRIES 4
+/* INIT-REBOOT 发送次数, 无应答后退回 DISCOVER */
+#define WIZ_DHCP_REBOOT_TRIES 2
+/* 启动后多长时间仍未获得地址则先使用静态配置, DHCP 在后台继续 */
+#define WIZ_DHCP_FALLBACK_MS 20000
+/* 冲突检测后重新 DISCOVER 前的等待 (RFC 2131 3.1.5) */
+#define WIZ_DHCP_DECLINE_WAIT_MS 10000
+/* 等待应答期间检查 socket 的间隔 (W5500 INTn 未接入 MCU) */
+#define WIZ_DHCP_EVENT_POLL_MS 20
+/* 续租/重绑定的最小重传间隔 (秒) */
+#define WIZ_DHCP_RENEW_RETX_MIN_S 60
+/* 获得新地址时用 ARP 检测冲突 (约 RTR*(RCR+1) = 1.8s), INIT-REBOOT 确认的旧地址不检测 */
+#define WIZ_DHCP_PROBE 1
+
+#define WIZ_DHCP_HOST_NAME "SmartCap-"
+/* DHCP 任务栈 (字, 静态分配), 估算峰值约 800 字节 (socket 打开时的 SPI 调用链),
+ * 暂定值, 待板上按 tasks 命令的 stack free 确认 */
+#define WIZ_DHCP_TASK_STACK 256
+
+/**
+ * @brief DHCP 客户端状态
+ */
+typedef enum
+{
+    WIZ_DHCP_STATE_STOPPED = 0, // 未启动 (静态配置)
+    WIZ_DHCP_STATE_INIT,        // 等待发送 DISCOVER
+    WIZ_DHCP_STATE_REBOOTING,   // INIT-REBOOT: 用保存的地址发送 REQUEST
+    WIZ_DHCP_STATE_SELECTING,   // 已发送 DISCOVER, 等待 OFFER
+    WIZ_DHCP_STATE_REQUESTING,  // 已发送 REQUEST, 等待 ACK
+    WIZ_DHCP_STATE_PROBING,     // ARP 检测地址冲突
+    WIZ_DHCP_STATE_BOUND,       // 地址已生效
+    WIZ_DHCP_STATE_RENEWING,    // T1 后向原服务器单播续租, 地址继续使用
+    WIZ_DHCP_STATE_REBINDING    // T2 后广播续租, 地址继续使用
+} wiz_dhcp_state_t;
+
+/**
+ * @brief 租约信息
+ */
+typedef struct
+{
+    uint8_t ip[4];
+    uint8_t sn[4];
+    uint8_t gw[4];
+    uint8_t dns[4];
+    uint8_t server[4];      // DHCP 服务器标识
+    uint32_t lease_s;       // 租期 (秒), 0xFFFFFFFF 表示永久
+    uint32_t t1_s;          // 续租时刻
+    uint32_t t2_s;          // 重绑定时刻
+} wiz_dhcp_lease_t;
+
+/**
+ * @brief DHCP 统计
+ */
+typedef struct
+{
+    uint32_t discovers;         // 发送 DISCOVER 次数 (含重传)
+    uint32_t requests;          // 发送 REQUEST 次数 (含重传)
+    uint32_t acks;
+    uint32_t naks;
+    uint32_t declines;          // 地址冲突, 发送 DECLINE 次数
+    uint32_t renewals;          // 续租/重绑定成功次数
+    uint32_t expirations;       // 租约到期仍未续上的次数
+    uint32_t fallbacks;         // 退回静态配置次数
+    uint32_t bad_replies;       // 格式错误或不属于本机的应答
+    uint32_t lease_saves;       // 写 Flash 次数
+    uint32_t cold_bind_ms;      // 最近一次 DISCOVER 流程从启动到获得地址的耗时
+    uint32_t warm_bind_ms;      // 最近一次 INIT-REBOOT 流程从启动到获得地址的耗时
+} wiz_dhcp_stats_t;
+
+/**
+ * @brief 启动 DHCP (非阻塞), 首次调用时创建 DHCP 任务
+ * @param buf      :报文缓冲区, 至少 576 字节
+ * @param fallback :MAC 和 DHCP 失败时使用的静态配置
+ *
+ * Flash 中有本机 MAC 对应的租约时执行 INIT-REBOOT (只需一次 REQUEST/ACK),
+ * 否则从 DISCOVER 开始。获得地址前 SIPR 清零。
+ */
+void wiz_dhcp_start(uint8_t *buf, const wiz_NetInfo *fallback);
+
+/**
+ * @brief 停止 DHCP 并关闭 socket, 当前地址保持不变
+ */
+void wiz_dhcp_stop(void);
+
+/**
+ * @brief 当前是否有可用地址 (租约有效或已退回静态配置)
+ */
+uint8_t wiz_dhcp_has_address(void);
+
+/**
+ * @brief 取出并清除 "地址已变化" 标志
+ * @return 1 自上次调用以来地址变化过 (静态->DHCP, 续租得到新地址, 租约到期), 需要重开 socket
+ */
+uint8_t wiz_dhcp_take_changed(void);
+
+/**
+ * @brief 获取当前状态
+ */
+wiz_dhcp_state_t wiz_dhcp_get_state(void);
+
+/**
+ * @brief 获取当前租约
+ * @param lease :输出租约信息
+ */
+void wiz_dhcp_get_lease(wiz_dhcp_lease_t *lease);
+
+/**
+ * @brief 获取 DHCP 统计
+ * @param stats :输出统计信息
+ */
+void wiz_dhcp_get_stats(wiz_dhcp_stats_t *stats);
+#endif
@@ -0,0 +1,995 @@
+#include "wiz_dns.h"
+#include "wiz_timer.h"
+#include "wiz_txq.h"
+#include "socket.h"
+#include "cmsis_os.h"
+#include <string.h>
+
+#define WIZ_DNS_SERVER_PORT 53
+/* 本地端口在该范围内随机选择, 每次重开 socket 更换 */
+#define WIZ_DNS_PORT_BASE 49152
+#define WIZ_DNS_PORT_RANGE 16384
+/* 报文头长度 */
+#define WIZ_DNS_HDR_LEN 12
+/* 一个域名中最多跟随的压缩指针数 */
+#define WIZ_DNS_PTR_MAX 16
+/* CNAME 链最大长度 */
+#define WIZ_DNS_CNAME_MAX 8
+/* 取 resolver 锁的最长等待 */
+#define WIZ_DNS_LOCK_MS 1000
+
+/* 记录类型/类 */
+#define DNS_RR_CNAME 5
+#define DNS_RR_SOA 6
+#define DNS_CLASS_IN 1
+
+/* 头部标志 */
+#define DNS_FLAG_QR 0x8000
+#define DNS_FLAG_OPCODE 0x7800
+#define DNS_FLAG_TC 0x0200
+#define DNS_FLAG_RD 0x0100
+#define DNS_RCODE_MASK 0x000F
+#define DNS_RCODE_NOERROR 0
+#define DNS_RCODE_NXDOMAIN 3
+
+/* 查询槽状态 */
+#define DNS_Q_FREE 0
+#define DNS_Q_WAIT 1    // 等待发送 (新建/重传/切换服务器)
+#define DNS_Q_SENT 2    // 已发送, 等待应答或超时
+#define DNS_Q_DONE 3    // 已有结果, 等待回调
+#define DNS_Q_DELIVER 4 // 回调执行中 (在锁外), 槽不能复用
+
+/**
+ * @brief 进行中的查询
+ */
+struct wiz_dns_query
+{
+    uint8_t state;
+    uint8_t srv;        // 当前服务器 (0 主, 1 备)
+    uint8_t sent_mask;  // 已向哪些服务器发送过, 接受其中任一台的应答
+    uint8_t tries;
+    int8_t status;
+    uint16_t id;
+    wiz_dns_type_t type;
+    uint32_t deadline;
+    wiz_dns_cb_t cb;
+    void *arg;
+    uint8_t addr[16];
+    char name[WIZ_DNS_NAME_MAX];
+};
+
+/**
+ * @brief 缓存条目, name[0] 为 0 表示空闲
+ */
+struct wiz_dns_entry
+{
+    char name[WIZ_DNS_NAME_MAX];
+    wiz_dns_type_t type;
+    int8_t status;
+    uint8_t addr[16];
+    uint32_t expire_ms;
+    uint32_t used_ms;
+};
+
+static osMutexId dns_mutex = NULL;
+static osStaticMutexDef_t dns_mutex_cb;
+
+static struct wiz_dns_query dns_queries[WIZ_DNS_QUERY_MAX];
+static struct wiz_dns_entry dns_cache[WIZ_DNS_CACHE_MAX];
+static uint8_t dns_msg[WIZ_DNS_MSG_MAX];
+/* 解析应答时使用的域名缓冲, 只在持有锁时使用, 不占任务栈 */
+static char dns_owner[WIZ_DNS_NAME_MAX];
+static char dns_target[WIZ_DNS_NAME_MAX];
+
+static uint8_t dns_server_set[2][4];
+static uint8_t dns_server_fixed[2] = {0, 0};
+static uint8_t dns_pref = 0;            // 最近一次有应答的服务器, 新查询先发给它
+static uint8_t dns_local_ip[4];         // 本机地址变化时清空缓存
+static uint32_t dns_seed = 0;
+
+static wiz_dns_stats_t dns_stats;
+
+static const uint8_t dns_backup_default[4] = WIZ_DNS_BACKUP_SERVER;
+
+static uint8_t time_reached(uint32_t now, uint32_t t)
+{
+    return (int32_t)(now - t) >= 0;
+}
+
+static uint8_t ip_is_zero(const uint8_t ip[4])
+{
+    return (ip[0] | ip[1] | ip[2] | ip[3]) == 0;
+}
+
+static uint16_t get_be16(const uint8_t *p)
+{
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static uint32_t get_be32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static void put_be16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)(v >> 8);
+    p[1] = (uint8_t)v;
+}
+
+static uint16_t dns_rand(void)
+{
+    dns_seed = dns_seed * 1103515245UL + 12345UL + wiz_timer_get_ms();
+    return (uint16_t)(dns_seed >> 16);
+}
+
+static uint8_t dns_addr_len(wiz_dns_type_t type)
+{
+    return (type == WIZ_DNS_TYPE_AAAA) ? 16 : 4;
+}
+
+static uint8_t dns_lock(void)
+{
+    if (dns_mutex == NULL)
+        return 0;
+    return osMutexWait(dns_mutex, WIZ_DNS_LOCK_MS) == osOK;
+}
+
+static void dns_unlock(void)
+{
+    osMutexRelease(dns_mutex);
+}
+
+/**
+ * @brief 域名比较, 忽略 ASCII 大小写 (RFC 4343)
+ */
+static uint8_t dns_name_eq(const char *a, const char *b)
+{
+    char ca, cb;
+
+    do
+    {
+        ca = *a++;
+        cb = *b++;
+        if (ca >= 'A' && ca <= 'Z')
+            ca += 'a' - 'A';
+        if (cb >= 'A' && cb <= 'Z')
+            cb += 'a' - 'A';
+        if (ca != cb)
+            return 0;
+    } while (ca != '\0');
+    return 1;
+}
+
+/**
+ * @brief 检查并规范化域名 (去掉结尾的 '.')
+ * @return 0 合法, -1 非法
+ */
+static int8_t dns_check_name(const char *name, char out[WIZ_DNS_NAME_MAX])
+{
+    uint16_t len, i, label = 0;
+
+    if (name == NULL)
+        return -1;
+    len = (uint16_t)strlen(name);
+    if (len > 0 && name[len - 1] == '.')
+        len--;
+    if (len == 0 || len >= WIZ_DNS_NAME_MAX)
+        return -1;
+
+    for (i = 0; i < len; i++)
+    {
+        if (name[i] == '.')
+        {
+            if (label == 0)
+                return -1;
+            label = 0;
+        }
+        else if (++label > 63)
+        {
+            return -1;
+        }
+    }
+    if (label == 0)
+        return -1;
+
+    memcpy(out, name, len);
+    out[len] = '\0';
+    return 0;
+}
+
+/**
+ * @brief 读取报文中的域名 (RFC 1035 4.1.4)
+ * @param len  :报文长度
+ * @param off  :域名在报文中的偏移
+ * @param out  :输出点分格式, 可为 NULL (只跳过)
+ * @param size :out 大小, 放不下或标签中含 '.'/'\0' 时输出空串 (不会与任何域名相等)
+ * @return 域名之后的偏移, -1 表示越界、非法标签或指针循环
+ *
+ * 压缩指针只能指向当前位置之前, 并且最多跟随 WIZ_DNS_PTR_MAX 次
+ */
+static int32_t dns_read_name(const uint8_t *m, uint16_t len, uint16_t off, char *out, uint16_t size)
+{
+    int32_t next = -1;
+    uint16_t pos = off;
+    uint16_t limit = off;
+    uint16_t k = 0;
+    uint16_t ptr;
+    uint8_t lab, jumps = 0, bad = 0;
+
+    for (;;)
+    {
+        if (pos >= len)
+            return -1;
+        lab = m[pos];
+        if (lab == 0)
+        {
+            pos++;
+            break;
+        }
+        if ((lab & 0xC0) == 0xC0)
+        {
+            if (pos + 1 >= len)
+                return -1;
+            ptr = (uint16_t)(((lab & 0x3F) << 8) | m[pos + 1]);
+            if (ptr >= limit || ++jumps > WIZ_DNS_PTR_MAX)
+                return -1;
+            if (next < 0)
+                next = pos + 2;
+            limit = ptr;
+            pos = ptr;
+            continue;
+        }
+        if (lab & 0xC0)
+            return -1;      // 0x40/0x80 扩展标签未定义
+        if (lab > len - pos - 1)
+            return -1;
+
+        if (out != NULL && !bad)
+        {
+            if ((k ? k + 1 : 0) + lab + 1 > size ||
+                memchr(&m[pos + 1], '.', lab) != NULL || memchr(&m[pos + 1], '\0', lab) != NULL)
+            {
+                bad = 1;
+            }
+            else
+            {
+                if (k)
+                    out[k++] = '.';
+                memcpy(&out[k], &m[pos + 1], lab);
+                k += lab;
+            }
+        }
+        pos += 1 + lab;
+    }
+
+    if (out != NULL)
+        out[bad ? 0 : k] = '\0';
+    return (next >= 0) ? next : pos;
+}
+
+/**
+ * @brief 当前服务器地址
+ * @param idx :0 主, 1 备
+ * @param ip  :输出地址
+ */
+static void dns_server(uint8_t idx, uint8_t ip[4])
+{
+    wiz_NetInfo info;
+
+    if (dns_server_fixed[idx])
+    {
+        memcpy(ip, dns_server_set[idx], 4);
+    }
+    else if (idx == 0)
+    {
+        wizchip_getnetinfo(&info);
+        memcpy(ip, info.dns, 4);
+    }
+    else
+    {
+        memcpy(ip, dns_backup_default, 4);
+    }
+}
+
+/**
+ * @brief 切换到另一台服务器 (另一台未配置或地址相同时不切换)
+ */
+static void dns_failover(struct wiz_dns_query *q)
+{
+    uint8_t cur[4], other[4];
+
+    dns_server(q->srv, cur);
+    dns_server(q->srv ^ 1, other);
+    if (ip_is_zero(other) || memcmp(cur, other, 4) == 0)
+        return;
+    q->srv ^= 1;
+    dns_stats.failovers++;
+}
+
+/**
+ * @brief 打开 DNS socket, 每次重开使用新的随机本地端口
+ * @return 0 成功, -1 失败
+ */
+static int8_t dns_open(void)
+{
+    uint16_t port;
+
+    if (getSn_SR(WIZ_DNS_SOCK) == SOCK_UDP)
+        return 0;
+    wiz_udp_send_reset(WIZ_DNS_SOCK);
+    port = WIZ_DNS_PORT_BASE + dns_rand() % WIZ_DNS_PORT_RANGE;
+    if (socket(WIZ_DNS_SOCK, Sn_MR_UDP, port, SF_IO_NONBLOCK) != WIZ_DNS_SOCK)
+        return -1;
+    return 0;
+}
+
+/**
+ * @brief 构造查询报文
+ * @return 报文长度
+ */
+static uint16_t dns_build(const struct wiz_dns_query *q)
+{
+    uint8_t *m = dns_msg;
+    uint16_t k = WIZ_DNS_HDR_LEN;
+    const char *p = q->name;
+    const char *dot;
+    uint8_t n;
+
+    memset(m, 0, WIZ_DNS_HDR_LEN);
+    put_be16(&m[0], q->id);
+    put_be16(&m[2], DNS_FLAG_RD);
+    put_be16(&m[4], 1);
+
+    for (;;)
+    {
+        dot = strchr(p, '.');
+        n = (uint8_t)(dot != NULL ? (size_t)(dot - p) : strlen(p));
+        m[k++] = n;
+        memcpy(&m[k], p, n);
+        k += n;
+        if (dot == NULL)
+            break;
+        p = dot + 1;
+    }
+    m[k++] = 0;
+    put_be16(&m[k], (uint16_t)q->type);
+    put_be16(&m[k + 2], DNS_CLASS_IN);
+    return k + 4;
+}
+
+/**
+ * @brief 查询结束, 写入缓存
+ * @param status :WIZ_DNS_OK 或 WIZ_DNS_ERR_xxx
+ * @param ttl_s  :缓存时间
+ */
+static void dns_complete(struct wiz_dns_query *q, int8_t status, uint32_t ttl_s)
+{
+    struct wiz_dns_entry *e = NULL;
+    uint32_t now = wiz_timer_get_ms();
+    uint8_t i;
+
+    q->status = status;
+    q->state = DNS_Q_DONE;
+
+    switch (status)
+    {
+    case WIZ_DNS_OK:
+        dns_stats.answers++;
+        break;
+    case WIZ_DNS_ERR_NOTFOUND:
+        dns_stats.not_found++;
+        break;
+    case WIZ_DNS_ERR_TIMEOUT:
+        dns_stats.timeouts++;
+        break;
+    default:
+        dns_stats.server_errors++;
+        break;
+    }
+
+    /* 同名条目直接覆盖, 否则用空闲/过期条目, 都没有时淘汰最久未使用的 */
+    for (i = 0; i < WIZ_DNS_CACHE_MAX; i++)
+    {
+        if (dns_cache[i].name[0] != '\0' && dns_cache[i].type == q->type && dns_name_eq(dns_cache[i].name, q->name))
+        {
+            e = &dns_cache[i];
+            break;
+        }
+    }
+    for (i = 0; e == NULL && i < WIZ_DNS_CACHE_MAX; i++)
+    {
+        if (dns_cache[i].name[0] == '\0' || time_reached(now, dns_cache[i].expire_ms))
+            e = &dns_cache[i];
+    }
+    if (e == NULL)
+    {
+        e = &dns_cache[0];
+        for (i = 1; i < WIZ_DNS_CACHE_MAX; i++)
+        {
+            if ((int32_t)(dns_cache[i].used_ms - e->used_ms) < 0)
+                e = &dns_cache[i];
+        }
+        dns_stats.cache_evictions++;
+    }
+
+    strcpy(e->name, q->name);
+    e->type = q->type;
+    e->status = status;
+    memcpy(e->addr, q->addr, sizeof(e->addr));
+    e->expire_ms = now + ttl_s * 1000;
+    e->used_ms = now;
+}
+
+/**
+ * @brief 服务器错误或超时后重试, 次数用完时结束查询
+ * @param status :次数用完时的结果
+ */
+static void dns_retry(struct wiz_dns_query *q, int8_t status)
+{
+    if (q->tries >= WIZ_DNS_TRIES)
+    {
+        dns_complete(q, status, WIZ_DNS_FAIL_TTL_S);
+        return;
+    }
+    dns_failover(q);
+    q->state = DNS_Q_WAIT;
+}
+
+/**
+ * @brief 发送查询
+ * @return 0 已发送 (或没有地址/服务器, 按丢包计入重试), -1 socket 上一帧未完成, 稍后再发
+ *
+ * 同一 socket 只能有一帧在发送, 多个查询依次发出, ARP 已缓存时同一轮即可全部发出
+ */
+static int8_t dns_transmit(struct wiz_dns_query *q, uint32_t now)
+{
+    uint8_t server[4], local[4];
+    uint16_t len;
+
+    if (wiz_udp_send_busy(WIZ_DNS_SOCK) && wiz_udp_send_status(WIZ_DNS_SOCK) == WIZ_UDP_SEND_PENDING)
+        return -1;
+
+    dns_server(q->srv, server);
+    if (ip_is_zero(server))
+    {
+        q->srv ^= 1;
+        dns_server(q->srv, server);
+    }
+    getSIPR(local);
+
+    if (!ip_is_zero(server) && !ip_is_zero(local) && dns_open() == 0)
+    {
+        len = dns_build(q);
+        if (wiz_udp_send_nowait(WIZ_DNS_SOCK, dns_msg, len, server, WIZ_DNS_SERVER_PORT) == 0)
+        {
+            dns_stats.sent++;
+            if (q->tries > 0)
+                dns_stats.retransmits++;
+            q->sent_mask |= 1 << q->srv;
+        }
+    }
+
+    q->deadline = now + ((uint32_t)WIZ_DNS_RETX_MS << q->tries);
+    q->tries++;
+    q->state = DNS_Q_SENT;
+    return 0;
+}
+
+/**
+ * @brief 解析 answer 段, 跟随 CNAME 链查找请求类型的地址
+ * @param off  :answer 段起始偏移, 输出 authority 段起始偏移
+ * @param ttl  :输出地址及其 CNAME 链中最小的 TTL
+ * @return 1 找到地址 (写入 q->addr), 0 没有, -1 报文格式错误
+ *
+ * 服务器按链的顺序给出 CNAME 和地址记录, 只扫描一遍
+ */
+static int8_t dns_parse_answer(const uint8_t *m, uint16_t len, int32_t *off, uint16_t count,
+                               struct wiz_dns_query *q, uint32_t *ttl)
+{
+    uint16_t type, cls, rdlen;
+    uint32_t rttl;
+    uint8_t found = 0, hops = 0;
+    uint8_t alen = dns_addr_len(q->type);
+
+    strcpy(dns_target, q->name);
+    *ttl = 0xFFFFFFFFUL;
+
+    while (count--)
+    {
+        *off = dns_read_name(m, len, (uint16_t)*off, dns_owner, sizeof(dns_owner));
+        if (*off < 0 || *off + 10 > len)
+            return -1;
+        type = get_be16(&m[*off]);
+        cls = get_be16(&m[*off + 2]);
+        rttl = get_be32(&m[*off + 4]);
+        rdlen = get_be16(&m[*off + 8]);
+        *off += 10;
+        if (rdlen > len - *off)
+            return -1;
+        if (rttl & 0x80000000UL)
+            rttl = 0;   // RFC 2181 8: 最高位置位的 TTL 按 0 处理
+
+        if (!found && cls == DNS_CLASS_IN && dns_name_eq(dns_owner, dns_target))
+        {
+            if (type == DNS_RR_CNAME && hops < WIZ_DNS_CNAME_MAX)
+            {
+                if (dns_read_name(m, len, (uint16_t)*off, dns_target, sizeof(dns_target)) < 0)
+                    return -1;
+                hops++;
+                if (rttl < *ttl)
+                    *ttl = rttl;
+            }
+            else if (type == (uint16_t)q->type && rdlen == alen)
+            {
+                memcpy(q->addr, &m[*off], alen);
+                found = 1;
+                if (rttl < *ttl)
+                    *ttl = rttl;
+            }
+        }
+        *off += rdlen;
+    }
+    return found;
+}
+
+/**
+ * @brief 从 authority 段的 SOA 计算否定缓存时间 (RFC 2308 5)
+ * @return 秒, 没有 SOA 或格式错误时为 WIZ_DNS_TTL_MIN_S
+ */
+static uint32_t dns_negative_ttl(const uint8_t *m, uint16_t len, int32_t off, uint16_t count)
+{
+    uint16_t type, rdlen;
+    uint32_t rttl, minimum;
+    int32_t p;
+
+    while (count--)
+    {
+        off = dns_read_name(m, len, (uint16_t)off, NULL, 0);
+        if (off < 0 || off + 10 > len)
+            break;
+        type = get_be16(&m[off]);
+        rttl = get_be32(&m[off + 4]);
+        rdlen = get_be16(&m[off + 8]);
+        off += 10;
+        if (rdlen > len - off)
+            break;
+        if (type == DNS_RR_SOA)
+        {
+            /* MNAME, RNAME, 然后 SERIAL/REFRESH/RETRY/EXPIRE/MINIMUM */
+            p = dns_read_name(m, len, (uint16_t)off, NULL, 0);
+            if (p >= 0)
+                p = dns_read_name(m, len, (uint16_t)p, NULL, 0);
+            if (p < 0 || p + 20 > off + rdlen)
+                break;
+            minimum = get_be32(&m[p + 16]);
+            if (rttl & 0x80000000UL)
+                rttl = 0;
+            if (minimum < rttl)
+                rttl = minimum;
+            return (rttl > WIZ_DNS_NEG_TTL_MAX_S) ? WIZ_DNS_NEG_TTL_MAX_S : rttl;
+        }
+        off += rdlen;
+    }
+    return WIZ_DNS_TTL_MIN_S;
+}
+
+/**
+ * @brief 处理一个应答报文
+ * @param len      :报文长度
+ * @param from     :来源地址
+ * @param oversize :报文超过缓冲区, 只读到前 WIZ_DNS_MSG_MAX 字节
+ */
+static void dns_handle(uint16_t len, const uint8_t from[4], uint8_t oversize)
+{
+    const uint8_t *m = dns_msg;
+    struct wiz_dns_query *q = NULL;
+    uint8_t server[4];
+    uint16_t id, flags, qd, an, ns, rcode;
+    uint32_t ttl;
+    int32_t off;
+    int8_t found;
+    uint8_t i, s, from_srv = 0;
+
+    if (len < WIZ_DNS_HDR_LEN)
+    {
+        dns_stats.bad_replies++;
+        return;
+    }
+    id = get_be16(&m[0]);
+    for (i = 0; i < WIZ_DNS_QUERY_MAX && q == NULL; i++)
+    {
+        if ((dns_queries[i].state != DNS_Q_SENT && dns_queries[i].state != DNS_Q_WAIT) ||
+            dns_queries[i].id != id)
+            continue;
+        /* 只接受发送过的服务器的应答, 防止伪造 */
+        for (s = 0; s < 2; s++)
+        {
+            dns_server(s, server);
+            if ((dns_queries[i].sent_mask & (1 << s)) && memcmp(server, from, 4) == 0)
+            {
+                q = &dns_queries[i];
+                from_srv = s;
+                break;
+            }
+        }
+    }
+    if (q == NULL)
+    {
+        dns_stats.bad_replies++;
+        return;
+    }
+
+    flags = get_be16(&m[2]);
+    qd = get_be16(&m[4]);
+    an = get_be16(&m[6]);
+    ns = get_be16(&m[8]);
+    if (!(flags & DNS_FLAG_QR) || (flags & DNS_FLAG_OPCODE) || qd != 1)
+    {
+        dns_stats.bad_replies++;
+        return;
+    }
+
+    /* 问题段必须与查询一致 */
+    off = dns_read_name(m, len, WIZ_DNS_HDR_LEN, dns_owner, sizeof(dns_owner));
+    if (off < 0 || off + 4 > len || !dns_name_eq(dns_owner, q->name) ||
+        get_be16(&m[off]) != (uint16_t)q->type || get_be16(&m[off + 2]) != DNS_CLASS_IN)
+    {
+        dns_stats.bad_replies++;
+        return;
+    }
+    off += 4;
+
+    dns_pref = from_srv;
+    rcode = flags & DNS_RCODE_MASK;
+    if ((flags & DNS_FLAG_TC) || oversize || (rcode != DNS_RCODE_NOERROR && rcode != DNS_RCODE_NXDOMAIN))
+    {
+        /* 截断 (不支持 TCP) 或 SERVFAIL/REFUSED: 换一台服务器 */
+        dns_retry(q, WIZ_DNS_ERR_SERVER);
+        return;
+    }
+
+    /* NXDOMAIN 的 answer 段可能带有 CNAME, 同样跳过后再读 authority 段 */
+    found = dns_parse_answer(m, len, &off, an, q, &ttl);
+    if (found < 0)
+    {
+        dns_stats.bad_replies++;
+        return;
+    }
+
+    if (found && rcode == DNS_RCODE_NOERROR)
+    {
+        if (ttl < WIZ_DNS_TTL_MIN_S)
+            ttl = WIZ_DNS_TTL_MIN_S;
+        else if (ttl > WIZ_DNS_TTL_MAX_S)
+            ttl = WIZ_DNS_TTL_MAX_S;
+        dns_complete(q, WIZ_DNS_OK, ttl);
+    }
+    else
+    {
+        dns_complete(q, WIZ_DNS_ERR_NOTFOUND, dns_negative_ttl(m, len, off, ns));
+    }
+}
+
+/**
+ * @brief 取出 socket 中的所有应答
+ */
+static void dns_receive(void)
+{
+    uint8_t from[4];
+    uint8_t drain[32];
+    uint8_t info = 0;
+    uint8_t oversize;
+    uint16_t port;
+    int32_t len;
+
+    if (getSn_SR(WIZ_DNS_SOCK) != SOCK_UDP)
+        return;
+    while (getSn_RX_RSR(WIZ_DNS_SOCK) > 0)
+    {
+        len = recvfrom(WIZ_DNS_SOCK, dns_msg, WIZ_DNS_MSG_MAX, from, &port);
+        if (len <= 0)
+            break;
+
+        /* 超长报文的剩余部分丢弃, 否则下一次 recvfrom 会读到它 */
+        oversize = 0;
+        getsockopt(WIZ_DNS_SOCK, SO_PACKINFO, &info);
+        while (info & PACK_REMAINED)
+        {
+            oversize = 1;
+            if (recvfrom(WIZ_DNS_SOCK, drain, sizeof(drain), from, &port) <= 0)
+                break;
+            getsockopt(WIZ_DNS_SOCK, SO_PACKINFO, &info);
+        }
+
+        if (port != WIZ_DNS_SERVER_PORT)
+        {
+            dns_stats.bad_replies++;
+            continue;
+        }
+        dns_handle((uint16_t)len, from, oversize);
+    }
+}
+
+/**
+ * @brief 接收应答, 处理超时, 发出等待中的查询 (持有锁时调用)
+ */
+static void dns_service(void)
+{
+    struct wiz_dns_query *q;
+    uint32_t now;
+    uint8_t local[4];
+    uint8_t i;
+
+    getSIPR(local);
+    if (memcmp(local, dns_local_ip, 4) != 0)
+    {
+        /* 换了网络, 旧结果可能不再适用 */
+        memcpy(dns_local_ip, local, 4);
+        memset(dns_cache, 0, sizeof(dns_cache));
+    }
+
+    /* 读出上一帧的发送结果; ARP 超时的查询由重传处理 */
+    wiz_udp_send_status(WIZ_DNS_SOCK);
+    dns_receive();
+    now = wiz_timer_get_ms();
+
+    for (i = 0; i < WIZ_DNS_QUERY_MAX; i++)
+    {
+        q = &dns_queries[i];
+        if (q->state == DNS_Q_SENT && time_reached(now, q->deadline))
+        {
+            dns_retry(q, WIZ_DNS_ERR_TIMEOUT);
+        }
+    }
+    for (i = 0; i < WIZ_DNS_QUERY_MAX; i++)
+    {
+        q = &dns_queries[i];
+        if (q->state == DNS_Q_WAIT && dns_transmit(q, now) != 0)
+            break;
+    }
+}
+
+/**
+ * @brief 取出已完成的查询: 有回调的标记为 DELIVER 交给调用者, 没有回调的直接释放
+ * @return 需要在锁外执行回调的查询位图
+ */
+static uint8_t dns_take_done(void)
+{
+    uint8_t mask = 0;
+    uint8_t i;
+
+    for (i = 0; i < WIZ_DNS_QUERY_MAX; i++)
+    {
+        if (dns_queries[i].state != DNS_Q_DONE)
+            continue;
+        if (dns_queries[i].cb != NULL)
+        {
+            dns_queries[i].state = DNS_Q_DELIVER;
+            mask |= 1 << i;
+        }
+        else
+        {
+            dns_queries[i].state = DNS_Q_FREE;
+        }
+    }
+    return mask;
+}
+
+/**
+ * @brief 在锁外执行回调, 回调中可以再次调用 wiz_dns_resolve
+ */
+static void dns_deliver(uint8_t mask)
+{
+    struct wiz_dns_query *q;
+    uint8_t i;
+
+    for (i = 0; i < WIZ_DNS_QUERY_MAX; i++)
+    {
+        if (!(mask & (1 << i)))
+            continue;
+        q = &dns_queries[i];
+        q->cb(q->name, q->type, q->status, (q->status == WIZ_DNS_OK) ? q->addr : NULL, q->arg);
+        if (dns_lock())
+        {
+            q->state = DNS_Q_FREE;
+            dns_unlock();
+        }
+    }
+}
+
+/**
+ * @brief 查缓存
+ * @return WIZ_DNS_PENDING 未命中, 否则为缓存的结果
+ */
+static int8_t dns_cache_lookup(const char *name, wiz_dns_type_t type, uint8_t *addr)
+{
+    struct wiz_dns_entry *e;
+    uint32_t now = wiz_timer_get_ms();
+    uint8_t i;
+
+    for (i = 0; i < WIZ_DNS_CACHE_MAX; i++)
+    {
+        e = &dns_cache[i];
+        if (e->name[0] == '\0' || e->type != type || !dns_name_eq(e->name, name))
+            continue;
+        if (time_reached(now, e->expire_ms))
+        {
+            e->name[0] = '\0';
+            break;
+        }
+        e->used_ms = now;
+        dns_stats.cache_hits++;
+        if (e->status == WIZ_DNS_OK && addr != NULL)
+            memcpy(addr, e->addr, dns_addr_len(type));
+        return e->status;
+    }
+    dns_stats.cache_misses++;
+    return WIZ_DNS_PENDING;
+}
+
+/**
+ * @brief 新建查询
+ * @return WIZ_DNS_PENDING 或 WIZ_DNS_ERR_FULL
+ */
+static int8_t dns_start_query(const char *name, wiz_dns_type_t type, wiz_dns_cb_t cb, void *arg)
+{
+    struct wiz_dns_query *q = NULL;
+    uint8_t i, j;
+    uint16_t id;
+
+    /* 同名同类型的查询正在进行时合并 (各自有不同回调时另开一个) */
+    for (i = 0; i < WIZ_DNS_QUERY_MAX; i++)
+    {
+        q = &dns_queries[i];
+        if ((q->state == DNS_Q_WAIT || q->state == DNS_Q_SENT) && q->type == type && dns_name_eq(q->name, name) &&
+            (cb == NULL || q->cb == NULL || (q->cb == cb && q->arg == arg)))
+        {
+            if (cb != NULL)
+            {
+                q->cb = cb;
+                q->arg = arg;
+            }
+            return WIZ_DNS_PENDING;
+        }
+    }
+
+    q = NULL;
+    for (i = 0; i < WIZ_DNS_QUERY_MAX && q == NULL; i++)
+    {
+        if (dns_queries[i].state == DNS_Q_FREE)
+            q = &dns_queries[i];
+    }
+    if (q == NULL)
+        return WIZ_DNS_ERR_FULL;
+
+    /* 事务 ID 随机且不与进行中的查询重复 */
+    do
+    {
+        id = dns_rand();
+        for (j = 0; j < WIZ_DNS_QUERY_MAX; j++)
+        {
+            if (dns_queries[j].state != DNS_Q_FREE && dns_queries[j].id == id)
+                break;
+        }
+    } while (j < WIZ_DNS_QUERY_MAX);
+
+    memset(q, 0, sizeof(*q));
+    strcpy(q->name, name);
+    q->type = type;
+    q->id = id;
+    q->srv = dns_pref;
+    q->cb = cb;
+    q->arg = arg;
+    q->state = DNS_Q_WAIT;
+    dns_stats.queries++;
+    return WIZ_DNS_PENDING;
+}
+
+/**
+ * @brief 初始化 resolver
+ * @param mac :本机 MAC, 参与事务 ID 和本地端口的随机化
+ */
+void wiz_dns_init(const uint8_t *mac)
+{
+    if (dns_mutex == NULL)
+    {
+        osMutexStaticDef(WizDns, &dns_mutex_cb);
+        dns_mutex = osMutexCreate(osMutex(WizDns));
+    }
+    dns_seed ^= ((uint32_t)mac[2] << 24) | ((uint32_t)mac[3] << 16) | ((uint32_t)mac[4] << 8) | mac[5];
+    dns_seed ^= wiz_timer_get_ms();
+}
+
+/**
+ * @brief 解析域名 (非阻塞)
+ * @param name :域名
+ * @param type :查询类型
+ * @param addr :输出地址
+ * @param cb   :查询完成回调, 可为 NULL
+ * @param arg  :回调参数
+ * @return WIZ_DNS_OK/WIZ_DNS_PENDING/WIZ_DNS_ERR_xxx
+ */
+int8_t wiz_dns_resolve(const char *name, wiz_dns_type_t type, uint8_t *addr, wiz_dns_cb_t cb, void *arg)
+{
+    char norm[WIZ_DNS_NAME_MAX];
+    int8_t ret;
+    uint8_t mask;
+
+    if ((type != WIZ_DNS_TYPE_A && type != WIZ_DNS_TYPE_AAAA) || dns_check_name(name, norm) != 0)
+        return WIZ_DNS_ERR_PARAM;
+    if (!dns_lock())
+        return WIZ_DNS_ERR_SERVER;
+
+    dns_service();
+    ret = dns_cache_lookup(norm, type, addr);
+    if (ret == WIZ_DNS_PENDING)
+    {
+        ret = dns_start_query(norm, type, cb, arg);
+        if (ret == WIZ_DNS_PENDING)
+            dns_service();
+    }
+    mask = dns_take_done();
+    dns_unlock();
+    dns_deliver(mask);
+    return ret;
+}
+
+/**
+ * @brief 接收应答、处理重传和超时
+ */
+void wiz_dns_poll(void)
+{
+    uint8_t mask;
+
+    if (!dns_lock())
+        return;
+    dns_service();
+    mask = dns_take_done();
+    dns_unlock();
+    dns_deliver(mask);
+}
+
+/**
+ * @brief 指定 DNS 服务器
+ * @param primary :主服务器, NULL 表示使用网络配置中的 DNS
+ * @param backup  :备用服务器, NULL 表示使用默认备用服务器
+ */
+void wiz_dns_set_servers(const uint8_t *primary, const uint8_t *backup)
+{
+    const uint8_t *ip[2];
+    uint8_t i;
+
+    ip[0] = primary;
+    ip[1] = backup;
+    if (!dns_lock())
+        return;
+    for (i = 0; i < 2; i++)
+    {
+        dns_server_fixed[i] = (ip[i] != NULL);
+        if (ip[i] != NULL)
+            memcpy(dns_server_set[i], ip[i], 4);
+    }
+    dns_pref = 0;
+    dns_unlock();
+}
+
+/**
+ * @brief 清空缓存
+ */
+void wiz_dns_flush(void)
+{
+    if (!dns_lock())
+        return;
+    memset(dns_cache, 0, sizeof(dns_cache));
+    dns_unlock();
+}
+
+/**
+ * @brief 获取 DNS 统计
+ * @param stats :输出统计信息
+ */
+void wiz_dns_get_stats(wiz_dns_stats_t *stats)
+{
+    *stats = dns_stats;
+}
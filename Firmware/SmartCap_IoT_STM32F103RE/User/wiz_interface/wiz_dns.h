@@ -0,0 +1,123 @@
+#ifndef __WIZ_DNS_H__
+#define __WIZ_DNS_H__
+
+#include <stdint.h>
+#include "wizchip_conf.h"
+
+/* DNS 使用的 socket */
+#define WIZ_DNS_SOCK 6
+
+/* 同时进行的查询数, 各查询用事务 ID 区分 */
+#define WIZ_DNS_QUERY_MAX 4
+/* 缓存条目数 (成功和失败结果都缓存) */
+#define WIZ_DNS_CACHE_MAX 8
+/* 域名最大长度 (含结尾 '\0') */
+#define WIZ_DNS_NAME_MAX 64
+/* 报文缓冲区, 不使用 EDNS 时 UDP 应答不超过 512 字节 */
+#define WIZ_DNS_MSG_MAX 512
+
+/* 首次重传间隔, 之后每次加倍 */
+#define WIZ_DNS_RETX_MS 1000
+/* 每个查询最多发送次数, 超时或 SERVFAIL 时轮换服务器 */
+#define WIZ_DNS_TRIES 4
+/* 备用服务器, 主服务器为 DHCP/静态配置中的 DNS */
+#define WIZ_DNS_BACKUP_SERVER {114, 114, 114, 114}
+
+/* 成功结果按应答 TTL 缓存, 并限制在该范围内 (秒) */
+#define WIZ_DNS_TTL_MIN_S 10
+#define WIZ_DNS_TTL_MAX_S 86400
+/* NXDOMAIN/无记录: 按 SOA minimum 缓存, 不超过该值 (秒, RFC 2308) */
+#define WIZ_DNS_NEG_TTL_MAX_S 60
+/* 超时/服务器错误的缓存时间, 避免短时间内重复等待 (秒) */
+#define WIZ_DNS_FAIL_TTL_S 5
+
+/* 解析结果 */
+#define WIZ_DNS_OK 0
+#define WIZ_DNS_PENDING 1
+#define WIZ_DNS_ERR_NOTFOUND (-1)  // NXDOMAIN 或没有该类型的记录
+#define WIZ_DNS_ERR_TIMEOUT (-2)   // 所有服务器都无应答
+#define WIZ_DNS_ERR_FULL (-3)      // 同时进行的查询已满
+#define WIZ_DNS_ERR_PARAM (-4)     // 域名非法
+#define WIZ_DNS_ERR_SERVER (-5)    // 服务器拒绝或失败 (SERVFAIL/REFUSED)
+
+/**
+ * @brief 查询类型
+ */
+typedef enum
+{
+    WIZ_DNS_TYPE_A = 1,     // IPv4, 地址 4 字节
+    WIZ_DNS_TYPE_AAAA = 28  // IPv6, 地址 16 字节
+} wiz_dns_type_t;
+
+/**
+ * @brief 查询完成回调, 在调用 wiz_dns_poll/wiz_dns_resolve 的任务中执行, 不持有内部锁
+ * @param name   :域名
+ * @param type   :查询类型
+ * @param status :WIZ_DNS_OK 或 WIZ_DNS_ERR_xxx
+ * @param addr   :status 为 WIZ_DNS_OK 时的地址, 否则为 NULL
+ * @param arg    :wiz_dns_resolve 传入的参数
+ */
+typedef void (*wiz_dns_cb_t)(const char *name, wiz_dns_type_t type, int8_t status, const uint8_t *addr, void *arg);
+
+/**
+ * @brief DNS 统计
+ */
+typedef struct
+{
+    uint32_t queries;       // 新建查询次数
+    uint32_t sent;          // 发送报文次数 (含重传)
+    uint32_t retransmits;
+    uint32_t failovers;     // 切换到另一台服务器的次数
+    uint32_t answers;       // 得到地址的查询
+    uint32_t not_found;     // NXDOMAIN/无记录
+    uint32_t timeouts;
+    uint32_t server_errors; // SERVFAIL/REFUSED/截断且重试用尽
+    uint32_t bad_replies;   // 格式错误, 或 ID/来源/问题不匹配的应答
+    uint32_t cache_hits;
+    uint32_t cache_misses;
+    uint32_t cache_evictions;
+} wiz_dns_stats_t;
+
+/**
+ * @brief 初始化 resolver, 在 W5500 初始化成功后调用一次
+ * @param mac :本机 MAC, 参与事务 ID 和本地端口的随机化
+ */
+void wiz_dns_init(const uint8_t *mac);
+
+/**
+ * @brief 解析域名 (非阻塞)
+ * @param name :域名, 不超过 WIZ_DNS_NAME_MAX - 1 个字符
+ * @param type :查询类型
+ * @param addr :输出地址 (A 为 4 字节, AAAA 为 16 字节), 仅在返回 WIZ_DNS_OK 时写入
+ * @param cb   :查询完成回调, 为 NULL 时由调用者再次调用本函数取结果 (结果至少缓存 WIZ_DNS_FAIL_TTL_S 秒)
+ * @param arg  :回调参数
+ * @return WIZ_DNS_OK 缓存命中, 不调用回调
+ *         WIZ_DNS_PENDING 已发出或合并到进行中的查询
+ *         WIZ_DNS_ERR_xxx 缓存中的失败结果或参数错误, 不调用回调;
+ *                         未初始化 (以太网不可用) 时返回 WIZ_DNS_ERR_SERVER
+ */
+int8_t wiz_dns_resolve(const char *name, wiz_dns_type_t type, uint8_t *addr, wiz_dns_cb_t cb, void *arg);
+
+/**
+ * @brief 接收应答、处理重传和超时, 由网络任务周期调用 (resolve 时也会处理一次)
+ */
+void wiz_dns_poll(void);
+
+/**
+ * @brief 指定 DNS 服务器
+ * @param primary :主服务器, NULL 表示使用网络配置中的 DNS
+ * @param backup  :备用服务器, NULL 表示使用 WIZ_DNS_BACKUP_SERVER
+ */
+void wiz_dns_set_servers(const uint8_t *primary, const uint8_t *backup);
+
+/**
+ * @brief 清空缓存 (地址变化或切换网络后调用)
+ */
+void wiz_dns_flush(void);
+
+/**
+ * @brief 获取 DNS 统计
+ * @param stats :输出统计信息
+ */
+void wiz_dns_get_stats(wiz_dns_stats_t *stats);
+#endif
@@ -0,0 +1,1020 @@
+#include "wiz_http.h"
+#include "wiz_capture.h"
+#include "wiz_supervisor.h"
+#include "wiz_txq.h"
+#include "socket.h"
+#include "cmsis_os.h"
+#include "event_log.h"
+#include "console.h"
+#include <stdio.h>
+#include <string.h>
+
+/* 应答头部缓冲区 */
+#define WIZ_HTTP_HDR_MAX 256
+/* 分块头 "XXX\r\n" + 块尾 "\r\n" */
+#define WIZ_HTTP_CHUNK_OVERHEAD 7
+/* 发送队列剩余空间小于该值时不取分块数据, 避免产生大量小块 */
+#define WIZ_HTTP_CHUNK_MIN 64
+/* disconnect 后等待对端确认 FIN 的最长时间 */
+#define WIZ_HTTP_FIN_MS 1000
+/* 有连接/无连接时的轮询间隔 */
+#define WIZ_HTTP_POLL_MS 2
+#define WIZ_HTTP_IDLE_POLL_MS 20
+
+/* 请求解析状态 */
+#define HTTP_PARSE_LINE 0   // 等待请求行
+#define HTTP_PARSE_HEADER 1 // 等待头部行
+#define HTTP_PARSE_BODY 2   // 等待请求体
+#define HTTP_PARSE_DONE 3   // 请求完整, 等待处理
+
+/* 应答发送状态 */
+#define HTTP_TX_NONE 0      // 没有未发完的应答
+#define HTTP_TX_ASSET 1     // 正在从 flash 发送静态资源
+#define HTTP_TX_CHUNKED 2   // 正在发送分块应答
+#define HTTP_TX_STREAM 3    // HTTP/1.0 客户端: 不分块, 以关闭连接结束内容
+
+/**
+ * @brief 连接状态
+ *
+ * 请求解析只读 buf: 各行用 [line, scan) 偏移定位, 解析结果指向 buf 内部,
+ * 处理完一个请求后才把流水线中的后续数据移到 buf 开头。
+ */
+struct http_conn
+{
+    uint8_t open;               // 连接已建立, 发送队列已打开
+    uint8_t closing;            // 已发出 disconnect, 等待连接关闭
+    uint8_t close_pending;      // 应答还在发送队列中, 发完后关闭
+    char buf[WIZ_HTTP_REQ_MAX];
+    uint16_t len;               // buf 中的数据长度
+    uint16_t scan;              // 已检查到的位置
+    uint16_t line;              // 当前行起点
+    uint8_t parse;
+    uint16_t error;             // 解析错误对应的状态码, 0 表示无错误
+    uint16_t body_start;
+    uint16_t content_length;
+    uint16_t req_end;           // 当前请求 (含请求体) 的结束位置
+    uint8_t http10;             // HTTP/1.0 请求
+    uint8_t hdr_close;          // Connection: close
+    uint8_t hdr_keepalive;      // Connection: keep-alive
+    wiz_http_req_t req;
+    uint16_t requests;          // 本连接已处理的请求数
+    uint32_t active_tick;       // 最近一次收发数据的时刻
+    uint32_t req_tick;          // 当前请求第一个字节到达的时刻
+    uint32_t close_tick;        // 发出 disconnect 的时刻
+    /* 应答 */
+    uint8_t replied;
+    uint8_t keep_alive;         // 本次应答后保持连接
+    uint8_t head_only;          // HEAD 请求, 只发头部
+    uint8_t tx;
+    const uint8_t *tx_ptr;
+    uint32_t tx_left;
+    wiz_http_chunk_cb_t chunk_cb;
+    void *chunk_arg;
+    uint8_t txq_buf[WIZ_HTTP_TXQ_SIZE];
+};
+
+/**
+ * @brief 路由表项
+ */
+struct http_route
+{
+    const char *path;
+    uint8_t prefix;             // path 以 '*' 结尾, 按前缀匹配
+    uint16_t len;               // 不含 '*' 的长度
+    wiz_http_handler_t handler;
+};
+
+static struct http_conn conn;
+static struct http_conn *cur = NULL;   // 正在处理请求的连接, 只在处理函数执行期间有效
+static struct http_route routes[WIZ_HTTP_ROUTE_MAX];
+static uint8_t route_count = 0;
+static const wiz_http_asset_t *asset_table = NULL;
+static uint8_t asset_count = 0;
+static char hdr_buf[WIZ_HTTP_HDR_MAX];
+static uint8_t chunk_buf[WIZ_HTTP_CHUNK_MAX + WIZ_HTTP_CHUNK_OVERHEAD];
+static osThreadId http_task_handle = NULL;
+static osStaticThreadDef_t http_task_cb;
+static uint32_t http_task_stack[WIZ_HTTP_TASK_STACK];
+static wiz_http_stats_t http_stats;
+
+/**
+ * @brief 状态码说明
+ */
+static const char *http_reason(uint16_t status)
+{
+    switch (status)
+    {
+    case 200: return "OK";
+    case 204: return "No Content";
+    case 304: return "Not Modified";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 406: return "Not Acceptable";
+    case 408: return "Request Timeout";
+    case 409: return "Conflict";
+    case 413: return "Payload Too Large";
+    case 414: return "URI Too Long";
+    case 431: return "Request Header Fields Too Large";
+    case 501: return "Not Implemented";
+    case 503: return "Service Unavailable";
+    case 505: return "HTTP Version Not Supported";
+    case 507: return "Insufficient Storage";
+    default:  return "Internal Server Error";
+    }
+}
+
+/**
+ * @brief 不区分大小写比较 ASCII 字符串
+ */
+static uint8_t http_ieq(const char *a, uint16_t len, const char *b)
+{
+    uint16_t i;
+    char x, y;
+
+    for (i = 0; i < len; i++)
+    {
+        x = a[i];
+        y = b[i];
+        if (y == '\0')
+            return 0;
+        if (x >= 'A' && x <= 'Z')
+            x += 'a' - 'A';
+        if (y >= 'A' && y <= 'Z')
+            y += 'a' - 'A';
+        if (x != y)
+            return 0;
+    }
+    return b[len] == '\0';
+}
+
+/**
+ * @brief 在逗号分隔的头部值中查找 token (不区分大小写, 忽略 ";q=" 等参数)
+ */
+static uint8_t http_has_token(const char *v, uint16_t len, const char *token)
+{
+    uint16_t i = 0, start, end;
+
+    while (i < len)
+    {
+        while (i < len && (v[i] == ' ' || v[i] == '\t' || v[i] == ','))
+            i++;
+        start = i;
+        while (i < len && v[i] != ',' && v[i] != ';' && v[i] != ' ' && v[i] != '\t')
+            i++;
+        end = i;
+        if (end > start && http_ieq(&v[start], end - start, token))
+            return 1;
+        while (i < len && v[i] != ',')
+            i++;
+    }
+    return 0;
+}
+
+/**
+ * @brief 写入发送队列并计数, 调用前已确认空间足够
+ */
+static void http_write(const void *data, uint16_t len)
+{
+    int32_t n;
+
+    if (len == 0)
+        return;
+    n = wiz_txq_write(WIZ_HTTP_SOCK, (const uint8_t *)data, len, 0);
+    if (n > 0)
+        http_stats.bytes_sent += (uint32_t)n;
+}
+
+/**
+ * @brief 生成应答头部
+ * @param length :内容长度, <0 表示不带 Content-Length (分块或以关闭连接结束)
+ * @return 头部长度, 0 表示缓冲区不足
+ */
+static uint16_t http_header(struct http_conn *c, uint16_t status, const char *content_type,
+                            int32_t length, const wiz_http_asset_t *asset)
+{
+    int n;
+
+    if (status >= 400 && status < 500)
+        http_stats.bad_requests++;
+    if (c->requests + 1 >= WIZ_HTTP_KEEPALIVE_MAX)
+        c->keep_alive = 0;
+
+    n = snprintf(hdr_buf, sizeof(hdr_buf), "HTTP/1.1 %u %s\r\nServer: SmartCap\r\n",
+                 (unsigned)status, http_reason(status));
+    if (content_type != NULL && status != 304)
+        n += snprintf(&hdr_buf[n], sizeof(hdr_buf) - n, "Content-Type: %s\r\n", content_type);
+    if (asset != NULL)
+    {
+        n += snprintf(&hdr_buf[n], sizeof(hdr_buf) - n, "ETag: %s\r\nCache-Control: no-cache\r\n", asset->etag);
+        if (asset->gzip)
+            n += snprintf(&hdr_buf[n], sizeof(hdr_buf) - n, "%sVary: Accept-Encoding\r\n",
+                          (status == 304) ? "" : "Content-Encoding: gzip\r\n");
+    }
+    if (length >= 0 && status != 304)
+        n += snprintf(&hdr_buf[n], sizeof(hdr_buf) - n, "Content-Length: %lu\r\n", (unsigned long)length);
+    else if (length < 0 && status != 304 && !c->http10)
+        n += snprintf(&hdr_buf[n], sizeof(hdr_buf) - n, "Transfer-Encoding: chunked\r\n");
+    if (c->keep_alive)
+        n += snprintf(&hdr_buf[n], sizeof(hdr_buf) - n, "Connection: keep-alive\r\nKeep-Alive: timeout=%u\r\n\r\n",
+                      (unsigned)(WIZ_HTTP_IDLE_MS / 1000));
+    else
+        n += snprintf(&hdr_buf[n], sizeof(hdr_buf) - n, "Connection: close\r\n\r\n");
+
+    if (n <= 0 || n >= (int)sizeof(hdr_buf))
+        return 0;
+    return (uint16_t)n;
+}
+
+/**
+ * @brief 发送错误应答, 内容为状态码说明
+ */
+static void http_send_error(struct http_conn *c, uint16_t status)
+{
+    const char *reason = http_reason(status);
+    uint16_t body_len = (uint16_t)strlen(reason);
+    uint16_t n = http_header(c, status, "text/plain", body_len, NULL);
+
+    c->replied = 1;
+    if (n == 0 || n + body_len > wiz_txq_free(WIZ_HTTP_SOCK))
+        return;
+    http_write(hdr_buf, n);
+    if (!c->head_only)
+        http_write(reason, body_len);
+}
+
+/**
+ * @brief 解析请求行 "METHOD SP target SP HTTP/1.x"
+ * @return 0 成功, >0 错误状态码
+ */
+static uint16_t http_parse_request_line(struct http_conn *c, const char *p, uint16_t len)
+{
+    uint16_t i = 0, m_end, t_start, t_end, q;
+
+    while (i < len && p[i] != ' ')
+        i++;
+    m_end = i;
+    if (m_end == 0 || i >= len)
+        return 400;
+    t_start = ++i;
+    while (i < len && p[i] != ' ')
+        i++;
+    t_end = i;
+    if (t_end == t_start || i >= len || p[t_start] != '/')
+        return 400;
+    i++;
+    if (len - i != 8 || memcmp(&p[i], "HTTP/1.", 7) != 0)
+        return (len - i >= 5 && memcmp(&p[i], "HTTP/", 5) == 0) ? 505 : 400;
+    if (p[i + 7] == '0')
+        c->http10 = 1;
+    else if (p[i + 7] != '1')
+        return 505;
+
+    if (m_end == 3 && memcmp(p, "GET", 3) == 0)
+        c->req.method = WIZ_HTTP_GET;
+    else if (m_end == 4 && memcmp(p, "HEAD", 4) == 0)
+        c->req.method = WIZ_HTTP_HEAD;
+    else if (m_end == 4 && memcmp(p, "POST", 4) == 0)
+        c->req.method = WIZ_HTTP_POST;
+    else
+        c->req.method = WIZ_HTTP_OTHER;
+
+    c->req.path = &p[t_start];
+    c->req.path_len = t_end - t_start;
+    for (q = t_start; q < t_end; q++)
+    {
+        if (p[q] == '?')
+        {
+            c->req.path_len = q - t_start;
+            c->req.query = &p[q + 1];
+            c->req.query_len = t_end - q - 1;
+            break;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief 解析一个头部行, 只记录服务器关心的字段
+ * @return 0 成功, >0 错误状态码
+ */
+static uint16_t http_parse_header(struct http_conn *c, const char *p, uint16_t len)
+{
+    uint16_t colon = 0, v, v_end, i;
+    uint32_t value;
+
+    /* 不支持已废弃的折行头部 */
+    if (p[0] == ' ' || p[0] == '\t')
+        return 400;
+    while (colon < len && p[colon] != ':')
+        colon++;
+    if (colon == 0 || colon >= len)
+        return 400;
+    v = colon + 1;
+    while (v < len && (p[v] == ' ' || p[v] == '\t'))
+        v++;
+    v_end = len;
+    while (v_end > v && (p[v_end - 1] == ' ' || p[v_end - 1] == '\t'))
+        v_end--;
+
+    if (http_ieq(p, colon, "connection"))
+    {
+        if (http_has_token(&p[v], v_end - v, "close"))
+            c->hdr_close = 1;
+        if (http_has_token(&p[v], v_end - v, "keep-alive"))
+            c->hdr_keepalive = 1;
+    }
+    else if (http_ieq(p, colon, "content-length"))
+    {
+        value = 0;
+        if (v == v_end)
+            return 400;
+        for (i = v; i < v_end; i++)
+        {
+            if (p[i] < '0' || p[i] > '9')
+                return 400;
+            value = value * 10 + (uint32_t)(p[i] - '0');
+            if (value > WIZ_HTTP_BODY_MAX)
+                return 413;
+        }
+        c->content_length = (uint16_t)value;
+    }
+    else if (http_ieq(p, colon, "transfer-encoding"))
+    {
+        /* 不接受分块编码的请求体 */
+        return 501;
+    }
+    else if (http_ieq(p, colon, "if-none-match"))
+    {
+        c->req.if_none_match = &p[v];
+        c->req.if_none_match_len = v_end - v;
+    }
+    else if (http_ieq(p, colon, "accept-encoding"))
+    {
+        c->req.accept_gzip = http_has_token(&p[v], v_end - v, "gzip");
+    }
+    return 0;
+}
+
+/**
+ * @brief 增量解析: 从上次停下的位置继续, 只扫描新到达的数据
+ *
+ * 每次只处理完整的行, 行尾的 "\r\n" 或单独的 "\n" 都接受;
+ * 请求完整时进入 HTTP_PARSE_DONE, 出错时记录状态码。
+ */
+static void http_parse(struct http_conn *c)
+{
+    const char *p;
+    uint16_t len;
+
+    while (c->parse == HTTP_PARSE_LINE || c->parse == HTTP_PARSE_HEADER)
+    {
+        while (c->scan < c->len && c->buf[c->scan] != '\n')
+            c->scan++;
+        if (c->scan >= c->len)
+        {
+            /* 缓冲区已满仍没有完整的行 */
+            if (c->len >= WIZ_HTTP_REQ_MAX)
+                c->error = (c->parse == HTTP_PARSE_LINE) ? 414 : 431;
+            return;
+        }
+
+        p = &c->buf[c->line];
+        len = c->scan - c->line;
+        if (len > 0 && p[len - 1] == '\r')
+            len--;
+        c->scan++;
+        c->line = c->scan;
+
+        if (c->parse == HTTP_PARSE_LINE)
+        {
+            /* 请求之间多余的空行 (RFC 7230 3.5) */
+            if (len == 0)
+                continue;
+            c->error = http_parse_request_line(c, p, len);
+            if (c->error)
+                return;
+            c->parse = HTTP_PARSE_HEADER;
+        }
+        else if (len > 0)
+        {
+            c->error = http_parse_header(c, p, len);
+            if (c->error)
+                return;
+        }
+        else
+        {
+            c->body_start = c->scan;
+            c->parse = HTTP_PARSE_BODY;
+        }
+    }
+
+    if (c->parse == HTTP_PARSE_BODY)
+    {
+        if ((uint32_t)c->body_start + c->content_length > WIZ_HTTP_REQ_MAX)
+        {
+            c->error = 413;
+            return;
+        }
+        if (c->len - c->body_start < c->content_length)
+            return;
+        if (c->content_length > 0)
+        {
+            c->req.body = (const uint8_t *)&c->buf[c->body_start];
+            c->req.body_len = c->content_length;
+        }
+        c->req_end = c->body_start + c->content_length;
+        c->parse = HTTP_PARSE_DONE;
+    }
+}
+
+/**
+ * @brief 清除解析状态, 准备解析下一个请求
+ */
+static void http_parse_reset(struct http_conn *c)
+{
+    c->scan = 0;
+    c->line = 0;
+    c->parse = HTTP_PARSE_LINE;
+    c->error = 0;
+    c->body_start = 0;
+    c->content_length = 0;
+    c->req_end = 0;
+    c->http10 = 0;
+    c->hdr_close = 0;
+    c->hdr_keepalive = 0;
+    memset(&c->req, 0, sizeof(c->req));
+    c->req.accept_gzip = 1;
+}
+
+/**
+ * @brief If-None-Match 是否包含资源当前的 ETag
+ */
+static uint8_t http_etag_match(const wiz_http_req_t *req, const char *etag)
+{
+    uint16_t elen = (uint16_t)strlen(etag), i;
+    const char *v = req->if_none_match;
+
+    if (v == NULL)
+        return 0;
+    if (req->if_none_match_len == 1 && v[0] == '*')
+        return 1;
+    for (i = 0; i + elen <= req->if_none_match_len; i++)
+    {
+        if (memcmp(&v[i], etag, elen) == 0)
+            return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief 查找静态资源, "/" 对应 "/index.html"
+ */
+static const wiz_http_asset_t *http_find_asset(const char *path, uint16_t len)
+{
+    uint8_t i;
+
+    if (len == 1)
+    {
+        path = "/index.html";
+        len = 11;
+    }
+    for (i = 0; i < asset_count; i++)
+    {
+        if (strlen(asset_table[i].path) == len && memcmp(asset_table[i].path, path, len) == 0)
+            return &asset_table[i];
+    }
+    return NULL;
+}
+
+/**
+ * @brief 处理一个完整的请求
+ */
+static void http_dispatch(struct http_conn *c)
+{
+    const wiz_http_asset_t *asset;
+    uint8_t i;
+
+    c->keep_alive = c->http10 ? c->hdr_keepalive : !c->hdr_close;
+    c->head_only = (c->req.method == WIZ_HTTP_HEAD);
+    c->replied = 0;
+    http_stats.requests++;
+    if (c->requests > 0)
+        http_stats.reused++;
+
+    cur = c;
+    for (i = 0; i < route_count; i++)
+    {
+        if (routes[i].prefix ? (c->req.path_len >= routes[i].len &&
+                                memcmp(c->req.path, routes[i].path, routes[i].len) == 0)
+                             : (c->req.path_len == routes[i].len &&
+                                memcmp(c->req.path, routes[i].path, routes[i].len) == 0))
+        {
+            routes[i].handler(&c->req);
+            if (!c->replied)
+                http_send_error(c, 500);
+            cur = NULL;
+            return;
+        }
+    }
+
+    asset = http_find_asset(c->req.path, c->req.path_len);
+    if (asset == NULL)
+        http_send_error(c, 404);
+    else if (c->req.method != WIZ_HTTP_GET && c->req.method != WIZ_HTTP_HEAD)
+        http_send_error(c, 405);
+    else
+        wiz_http_reply_asset(asset);
+    cur = NULL;
+}
+
+/**
+ * @brief 连接断开或被抓包占用, 丢弃未完成的请求和应答
+ */
+static void http_conn_reset(struct http_conn *c)
+{
+    if (c->open)
+        wiz_txq_close(WIZ_HTTP_SOCK);
+    c->open = 0;
+    c->closing = 0;
+    c->close_pending = 0;
+    c->len = 0;
+    c->tx = HTTP_TX_NONE;
+    c->chunk_cb = NULL;
+    c->requests = 0;
+    http_parse_reset(c);
+}
+
+/**
+ * @brief 应答发完后关闭连接 (先发 FIN, 对端确认后 socket 变为 CLOSED)
+ *
+ * 发送队列还有数据时只做标记, 由 http_conn_poll 在队列发完后再次调用。
+ */
+static void http_conn_close(struct http_conn *c)
+{
+    c->close_pending = 1;
+    if (!wiz_txq_idle(WIZ_HTTP_SOCK))
+        return;
+    disconnect(WIZ_HTTP_SOCK);
+    c->close_pending = 0;
+    c->closing = 1;
+    c->close_tick = osKernelSysTick();
+}
+
+/**
+ * @brief 推进静态资源或分块应答的发送
+ */
+static void http_tx_poll(struct http_conn *c)
+{
+    uint16_t free, n;
+    int32_t got;
+    uint8_t hlen, i;
+    static const char hex[] = "0123456789ABCDEF";
+
+    free = wiz_txq_free(WIZ_HTTP_SOCK);
+    switch (c->tx)
+    {
+    case HTTP_TX_ASSET:
+        n = (c->tx_left < free) ? (uint16_t)c->tx_left : free;
+        if (n > 0)
+        {
+            http_write(c->tx_ptr, n);
+            c->tx_ptr += n;
+            c->tx_left -= n;
+            c->active_tick = osKernelSysTick();
+        }
+        if (c->tx_left == 0)
+            c->tx = HTTP_TX_NONE;
+        break;
+
+    case HTTP_TX_CHUNKED:
+    case HTTP_TX_STREAM:
+        if (free < WIZ_HTTP_CHUNK_MIN + WIZ_HTTP_CHUNK_OVERHEAD)
+            break;
+        n = free - WIZ_HTTP_CHUNK_OVERHEAD;
+        if (n > WIZ_HTTP_CHUNK_MAX)
+            n = WIZ_HTTP_CHUNK_MAX;
+
+        /* 数据放在块头之后, 块头长度固定为 3 位十六进制 + CRLF */
+        got = c->chunk_cb(&chunk_buf[5], n, c->chunk_arg);
+        c->active_tick = osKernelSysTick();
+        if (got == WIZ_HTTP_CHUNK_WAIT)
+            break;
+        if (got <= 0)
+        {
+            if (c->tx == HTTP_TX_CHUNKED)
+                http_write("0\r\n\r\n", 5);
+            c->tx = HTTP_TX_NONE;
+            c->chunk_cb = NULL;
+            break;
+        }
+        if ((uint32_t)got > n)
+            got = n;
+        http_stats.chunks++;
+        if (c->tx == HTTP_TX_STREAM)
+        {
+            http_write(&chunk_buf[5], (uint16_t)got);
+            break;
+        }
+        hlen = 0;
+        for (i = 0; i < 3; i++)
+            chunk_buf[hlen++] = (uint8_t)hex[(got >> (4 * (2 - i))) & 0x0F];
+        chunk_buf[hlen++] = '\r';
+        chunk_buf[hlen++] = '\n';
+        chunk_buf[5 + got] = '\r';
+        chunk_buf[6 + got] = '\n';
+        http_write(chunk_buf, (uint16_t)(got + WIZ_HTTP_CHUNK_OVERHEAD));
+        break;
+
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief 处理已建立的连接: 接收, 解析, 处理请求, 发送
+ * @param peer_closed :对端已关闭发送方向 (CLOSE_WAIT), 处理完已收到的请求后关闭
+ */
+static void http_conn_poll(struct http_conn *c, uint8_t peer_closed)
+{
+    uint16_t rsr, space;
+    int32_t n;
+    uint32_t now = osKernelSysTick();
+
+    wiz_txq_poll_socket(WIZ_HTTP_SOCK);
+    if (c->closing)
+        return;
+    if (c->close_pending)
+    {
+        http_conn_close(c);
+        return;
+    }
+
+    /* 接收: 正在发送应答时也继续读取流水线请求, 缓冲区满后由 TCP 窗口限流 */
+    rsr = getSn_RX_RSR(WIZ_HTTP_SOCK);
+    space = WIZ_HTTP_REQ_MAX - c->len;
+    if (rsr > 0 && space > 0)
+    {
+        n = recv(WIZ_HTTP_SOCK, (uint8_t *)&c->buf[c->len], (rsr < space) ? rsr : space);
+        if (n > 0)
+        {
+            if (c->len == 0)
+                c->req_tick = now;
+            c->len += (uint16_t)n;
+            c->active_tick = now;
+        }
+    }
+
+    if (c->tx != HTTP_TX_NONE)
+        http_tx_poll(c);
+
+    /* 上一个应答的内容全部进入发送队列后才处理下一个请求 */
+    if (c->tx == HTTP_TX_NONE && c->replied)
+    {
+        c->replied = 0;
+        c->requests++;
+        if (!c->keep_alive)
+        {
+            http_conn_close(c);
+            c->len = 0;
+            return;
+        }
+        /* 流水线中已到达的下一个请求移到缓冲区开头 */
+        c->len -= c->req_end;
+        memmove(c->buf, &c->buf[c->req_end], c->len);
+        http_parse_reset(c);
+        c->req_tick = now;
+    }
+
+    if (c->tx == HTTP_TX_NONE && !c->replied && c->len > 0)
+    {
+        http_parse(c);
+        if (c->error)
+        {
+            /* 解析出错后无法确定下一个请求的起点, 应答后关闭 */
+            c->keep_alive = 0;
+            c->head_only = 0;
+            http_send_error(c, c->error);
+            c->req_end = c->len;
+        }
+        else if (c->parse == HTTP_PARSE_DONE)
+        {
+            http_dispatch(c);
+        }
+        else if ((now - c->req_tick) >= WIZ_HTTP_REQ_TIMEOUT_MS)
+        {
+            c->keep_alive = 0;
+            c->head_only = 0;
+            http_send_error(c, 408);
+            c->req_end = c->len;
+            http_stats.timeouts++;
+        }
+        return;
+    }
+
+    if (c->tx == HTTP_TX_NONE && !c->replied && c->len == 0)
+    {
+        if (peer_closed)
+        {
+            http_conn_close(c);
+        }
+        else if ((now - c->active_tick) >= WIZ_HTTP_IDLE_MS)
+        {
+            http_stats.timeouts++;
+            http_conn_close(c);
+        }
+    }
+}
+
+/**
+ * @brief 维护 HTTP 监听 socket
+ */
+static void http_poll(void)
+{
+    struct http_conn *c = &conn;
+    uint8_t sn = WIZ_HTTP_SOCK;
+
+    /* 抓包时 socket 0 为 MACRAW 模式, 停止后抓包模块会关闭 socket */
+    if (wiz_capture_is_running())
+    {
+        if (c->open)
+        {
+            http_stats.preempted++;
+            http_conn_reset(c);
+        }
+        return;
+    }
+
+    switch (getSn_SR(sn))
+    {
+    case SOCK_CLOSED:
+        if (c->open)
+            http_conn_reset(c);
+        if (socket(sn, Sn_MR_TCP, WIZ_HTTP_PORT, SF_IO_NONBLOCK) == sn)
+            listen(sn);
+        break;
+
+    case SOCK_INIT:
+        listen(sn);
+        break;
+
+    case SOCK_ESTABLISHED:
+    case SOCK_CLOSE_WAIT:
+        if (!c->open)
+        {
+            http_conn_reset(c);
+            if (wiz_txq_open(sn, c->txq_buf, sizeof(c->txq_buf)) != 0)
+                break;
+            c->open = 1;
+            c->active_tick = osKernelSysTick();
+            http_stats.connections++;
+        }
+        http_conn_poll(c, getSn_SR(sn) == SOCK_CLOSE_WAIT);
+        break;
+
+    default:
+        break;
+    }
+
+    /* 对端不确认 FIN 时强制关闭 */
+    if (c->closing && (osKernelSysTick() - c->close_tick) >= WIZ_HTTP_FIN_MS)
+    {
+        http_conn_reset(c);
+        close(sn);
+    }
+}
+
+/**
+ * @brief HTTP 任务
+ */
+static void http_task(void const *argument)
+{
+    for (;;)
+    {
+        if (wiz_supervisor_get_state() == WIZ_SUP_STATE_UP)
+        {
+            http_poll();
+        }
+        else if (conn.open)
+        {
+            /* 链路恢复时芯片会被重新初始化, 只丢弃本地状态 */
+            http_conn_reset(&conn);
+        }
+        osDelay(conn.open ? WIZ_HTTP_POLL_MS : WIZ_HTTP_IDLE_POLL_MS);
+    }
+}
+
+/**
+ * @brief 登记请求处理函数, 在 wiz_http_start 之前调用
+ * @param path    :路径, 以 '*' 结尾时匹配该前缀
+ * @param handler :处理函数
+ * @return 0 成功, -1 路由表已满
+ */
+int8_t wiz_http_route(const char *path, wiz_http_handler_t handler)
+{
+    uint16_t len = (uint16_t)strlen(path);
+
+    if (route_count >= WIZ_HTTP_ROUTE_MAX || handler == NULL || len == 0)
+        return -1;
+    routes[route_count].path = path;
+    routes[route_count].prefix = (path[len - 1] == '*');
+    routes[route_count].len = routes[route_count].prefix ? len - 1 : len;
+    routes[route_count].handler = handler;
+    route_count++;
+    return 0;
+}
+
+/**
+ * @brief 登记静态资源表
+ * @param assets :资源表
+ * @param count  :资源个数
+ */
+void wiz_http_set_assets(const wiz_http_asset_t *assets, uint8_t count)
+{
+    asset_table = assets;
+    asset_count = count;
+}
+
+/**
+ * @brief 创建 HTTP 任务, 在以太网初始化之后调用一次
+ */
+void wiz_http_start(void)
+{
+    if (http_task_handle != NULL)
+        return;
+    http_conn_reset(&conn);
+    osThreadStaticDef(httpTask, http_task, osPriorityBelowNormal, 0, WIZ_HTTP_TASK_STACK,
+                      http_task_stack, &http_task_cb);
+    http_task_handle = osThreadCreate(osThread(httpTask), NULL);
+    if (http_task_handle == NULL)
+    {
+        Console_Puts("HTTP: task create failed\r\n");
+        EVENT_LOG1(TASK_CREATE_FAILED, EventLog_Tag("http"));
+    }
+}
+
+/**
+ * @brief 发送完整应答
+ * @return 0 成功, -1 已应答过或内容过长 (改为返回 500)
+ */
+int8_t wiz_http_reply(uint16_t status, const char *content_type, const void *body, uint16_t body_len)
+{
+    uint16_t n;
+
+    if (cur == NULL || cur->replied)
+        return -1;
+    n = http_header(cur, status, content_type, body_len, NULL);
+    if (n == 0 || (uint32_t)n + body_len > wiz_txq_free(WIZ_HTTP_SOCK))
+    {
+        cur->keep_alive = 0;
+        http_send_error(cur, 500);
+        return -1;
+    }
+    cur->replied = 1;
+    http_write(hdr_buf, n);
+    if (!cur->head_only)
+        http_write(body, body_len);
+    return 0;
+}
+
+/**
+ * @brief 发送静态资源, 处理 If-None-Match (304) 和 Accept-Encoding
+ * @return 0 成功, -1 已应答过
+ */
+int8_t wiz_http_reply_asset(const wiz_http_asset_t *asset)
+{
+    uint16_t n;
+
+    if (cur == NULL || cur->replied)
+        return -1;
+    if (asset->gzip && !cur->req.accept_gzip)
+    {
+        http_send_error(cur, 406);
+        return 0;
+    }
+    if (http_etag_match(&cur->req, asset->etag))
+    {
+        http_stats.not_modified++;
+        n = http_header(cur, 304, NULL, -1, asset);
+        cur->replied = 1;
+        if (n > 0)
+            http_write(hdr_buf, n);
+        return 0;
+    }
+
+    n = http_header(cur, 200, asset->content_type, (int32_t)asset->len, asset);
+    cur->replied = 1;
+    if (n == 0)
+        return 0;
+    http_write(hdr_buf, n);
+    if (!cur->head_only && asset->len > 0)
+    {
+        /* 内容直接从 flash 分段写入发送队列, 不占用 RAM */
+        cur->tx_ptr = asset->data;
+        cur->tx_left = asset->len;
+        cur->tx = HTTP_TX_ASSET;
+        http_tx_poll(cur);
+    }
+    return 0;
+}
+
+/**
+ * @brief 以分块传输发送应答
+ * @return 0 成功, -1 已应答过
+ */
+int8_t wiz_http_reply_chunked(const char *content_type, wiz_http_chunk_cb_t cb, void *arg)
+{
+    uint16_t n;
+
+    if (cur == NULL || cur->replied || cb == NULL)
+        return -1;
+    /* HTTP/1.0 不支持分块, 直接发送内容并以关闭连接结束 */
+    if (cur->http10)
+        cur->keep_alive = 0;
+    n = http_header(cur, 200, content_type, -1, NULL);
+    cur->replied = 1;
+    if (n == 0)
+        return 0;
+    http_write(hdr_buf, n);
+    if (!cur->head_only)
+    {
+        cur->chunk_cb = cb;
+        cur->chunk_arg = arg;
+        cur->tx = cur->http10 ? HTTP_TX_STREAM : HTTP_TX_CHUNKED;
+    }
+    return 0;
+}
+
+/**
+ * @brief 十六进制字符转数值, 非法字符返回 -1
+ */
+static int8_t http_hex(char ch)
+{
+    if (ch >= '0' && ch <= '9')
+        return ch - '0';
+    if (ch >= 'a' && ch <= 'f')
+        return ch - 'a' + 10;
+    if (ch >= 'A' && ch <= 'F')
+        return ch - 'A' + 10;
+    return -1;
+}
+
+/**
+ * @brief 在查询串或表单中查找参数
+ * @return 值的长度, -1 没有该参数或值过长
+ */
+int16_t wiz_http_param(const char *data, uint16_t len, const char *name, char *value, uint16_t size)
+{
+    uint16_t i = 0, start, nlen = (uint16_t)strlen(name), out;
+    int8_t hi, lo;
+
+    if (data == NULL || size == 0)
+        return -1;
+    while (i < len)
+    {
+        start = i;
+        while (i < len && data[i] != '=' && data[i] != '&')
+            i++;
+        if (i - start == nlen && memcmp(&data[start], name, nlen) == 0)
+        {
+            out = 0;
+            if (i < len && data[i] == '=')
+                i++;
+            while (i < len && data[i] != '&')
+            {
+                if (out + 1 >= size)
+                    return -1;
+                if (data[i] == '+')
+                {
+                    value[out++] = ' ';
+                    i++;
+                }
+                else if (data[i] == '%' && i + 2 < len &&
+                         (hi = http_hex(data[i + 1])) >= 0 && (lo = http_hex(data[i + 2])) >= 0)
+                {
+                    value[out++] = (char)((hi << 4) | lo);
+                    i += 3;
+                }
+                else
+                {
+                    value[out++] = data[i++];
+                }
+            }
+            value[out] = '\0';
+            return (int16_t)out;
+        }
+        while (i < len && data[i] != '&')
+            i++;
+        i++;
+    }
+    return -1;
+}
+
+/**
+ * @brief 获取 HTTP 统计
+ * @param stats :输出统计信息
+ */
+void wiz_http_get_stats(wiz_http_stats_t *stats)
+{
+    *stats = http_stats;
+}
@@ -0,0 +1,174 @@
+#ifndef __WIZ_HTTP_H__
+#define __WIZ_HTTP_H__
+
+#include <stdint.h>
+#include "wizchip_conf.h"
+
+/* HTTP 使用的 socket, 与抓包 (WIZ_CAPTURE_SOCK) 共用, 抓包期间服务暂停 */
+#define WIZ_HTTP_SOCK 0
+#define WIZ_HTTP_PORT 80
+
+/* 请求缓冲区: 请求行 + 头部 + 请求体, 同时保存流水线中下一个请求已到达的部分 */
+#define WIZ_HTTP_REQ_MAX 768
+/* 请求体最大长度 (Content-Length), 超过返回 413 */
+#define WIZ_HTTP_BODY_MAX 256
+/* 发送队列, 也是 wiz_http_reply 能发送的头部 + 内容上限 */
+#define WIZ_HTTP_TXQ_SIZE 1024
+/* 分块传输时每块的最大数据长度 */
+#define WIZ_HTTP_CHUNK_MAX 256
+/* 路由表大小 */
+#define WIZ_HTTP_ROUTE_MAX 8
+/* HTTP 任务栈 (字, 静态分配) */
+#define WIZ_HTTP_TASK_STACK 320
+
+/* 持久连接空闲超时 (没有未完成的请求/应答) */
+#define WIZ_HTTP_IDLE_MS 15000
+/* 请求头部必须在该时间内收齐 */
+#define WIZ_HTTP_REQ_TIMEOUT_MS 5000
+/* 每个连接最多处理的请求数, 之后应答带 Connection: close */
+#define WIZ_HTTP_KEEPALIVE_MAX 100
+
+/* 分块回调返回值: 暂时没有数据, 稍后再调用 */
+#define WIZ_HTTP_CHUNK_WAIT (-1)
+
+/**
+ * @brief 请求方法
+ */
+typedef enum
+{
+    WIZ_HTTP_GET = 0,
+    WIZ_HTTP_HEAD,
+    WIZ_HTTP_POST,
+    WIZ_HTTP_OTHER
+} wiz_http_method_t;
+
+/**
+ * @brief 解析后的请求, 各字段指向连接的请求缓冲区 (不以 '\0' 结尾), 只在处理函数中有效
+ */
+typedef struct
+{
+    wiz_http_method_t method;
+    const char *path;           // 不含查询串
+    uint16_t path_len;
+    const char *query;          // '?' 之后的部分, 没有时为 NULL
+    uint16_t query_len;
+    const uint8_t *body;        // 请求体, 没有时为 NULL
+    uint16_t body_len;
+    const char *if_none_match;  // If-None-Match 的值, 没有时为 NULL
+    uint16_t if_none_match_len;
+    uint8_t accept_gzip;        // 1: 客户端接受 gzip (没有 Accept-Encoding 时也视为接受)
+} wiz_http_req_t;
+
+/**
+ * @brief 压缩存放在 flash 中的静态资源 (由 web 目录下的生成脚本产生)
+ */
+typedef struct
+{
+    const char *path;
+    const char *content_type;
+    const char *etag;           // 带引号的强 ETag, 由压缩后内容的 CRC32 生成
+    const uint8_t *data;
+    uint32_t len;
+    uint8_t gzip;               // 1: data 为 gzip 压缩内容
+} wiz_http_asset_t;
+
+/**
+ * @brief 请求处理函数, 在 HTTP 任务中执行
+ *
+ * 必须调用且只调用一次 wiz_http_reply / wiz_http_reply_asset / wiz_http_reply_chunked,
+ * 没有调用时服务器返回 500。
+ *
+ * @param req :请求
+ */
+typedef void (*wiz_http_handler_t)(const wiz_http_req_t *req);
+
+/**
+ * @brief 分块应答数据回调, 发送队列有空间时调用
+ * @param buf  :输出缓冲区
+ * @param size :缓冲区大小 (不超过 WIZ_HTTP_CHUNK_MAX)
+ * @param arg  :wiz_http_reply_chunked 传入的参数
+ * @return >0 写入的字节数, 0 数据结束 (发送结束块), WIZ_HTTP_CHUNK_WAIT 暂时没有数据
+ */
+typedef int32_t (*wiz_http_chunk_cb_t)(uint8_t *buf, uint16_t size, void *arg);
+
+/**
+ * @brief HTTP 统计
+ */
+typedef struct
+{
+    uint32_t connections;     // 建立的连接数
+    uint32_t requests;        // 处理的请求数
+    uint32_t reused;          // 在已有连接上处理的请求 (持久连接节省的握手)
+    uint32_t not_modified;    // 304 应答
+    uint32_t bad_requests;    // 4xx 应答 (格式错误/过长/未找到)
+    uint32_t timeouts;        // 空闲或请求超时关闭的连接
+    uint32_t bytes_sent;      // 写入发送队列的字节数 (头部 + 内容)
+    uint32_t chunks;          // 发送的数据块
+    uint32_t preempted;       // 被抓包中断的连接
+} wiz_http_stats_t;
+
+/**
+ * @brief 登记请求处理函数, 在 wiz_http_start 之前调用
+ * @param path    :路径, 以 '*' 结尾时匹配该前缀
+ * @param handler :处理函数
+ * @return 0 成功, -1 路由表已满
+ */
+int8_t wiz_http_route(const char *path, wiz_http_handler_t handler);
+
+/**
+ * @brief 登记静态资源表, 路由表未匹配的 GET/HEAD 请求在该表中查找
+ * @param assets :资源表
+ * @param count  :资源个数
+ */
+void wiz_http_set_assets(const wiz_http_asset_t *assets, uint8_t count);
+
+/**
+ * @brief 创建 HTTP 任务, 在以太网初始化之后调用一次
+ */
+void wiz_http_start(void);
+
+/**
+ * @brief 发送完整应答 (内容连同头部一次写入发送队列)
+ * @param status       :状态码
+ * @param content_type :内容类型, body_len 为 0 时可为 NULL
+ * @param body         :内容, 调用返回后即可释放
+ * @param body_len     :内容长度, 头部 + 内容不能超过 WIZ_HTTP_TXQ_SIZE
+ * @return 0 成功, -1 已应答过或内容过长 (改为返回 500)
+ */
+int8_t wiz_http_reply(uint16_t status, const char *content_type, const void *body, uint16_t body_len);
+
+/**
+ * @brief 发送静态资源, 处理 If-None-Match (304) 和 Accept-Encoding
+ * @param asset :资源, 内容直接从 flash 分段写入发送队列, 必须长期有效
+ * @return 0 成功, -1 已应答过
+ */
+int8_t wiz_http_reply_asset(const wiz_http_asset_t *asset);
+
+/**
+ * @brief 以分块传输 (Transfer-Encoding: chunked) 发送应答, 用于长度未知或持续产生的数据
+ * @param content_type :内容类型
+ * @param cb           :数据回调, 返回 0 前会被反复调用; 客户端断开时不再调用
+ * @param arg          :回调参数
+ * @return 0 成功, -1 已应答过, 或请求为 HTTP/1.0 (改为返回 505)
+ *
+ * @note 数据回调持续返回 WIZ_HTTP_CHUNK_WAIT 时连接不会因空闲而关闭
+ */
+int8_t wiz_http_reply_chunked(const char *content_type, wiz_http_chunk_cb_t cb, void *arg);
+
+/**
+ * @brief 在请求中查找查询串或表单参数
+ * @param data  :查询串或 application/x-www-form-urlencoded 请求体
+ * @param len   :长度
+ * @param name  :参数名
+ * @param value :输出值 (已做 %xx 和 '+' 解码, 以 '\0' 结尾)
+ * @param size  :value 缓冲区大小
+ * @return 值的长度, -1 没有该参数或值过长
+ */
+int16_t wiz_http_param(const char *data, uint16_t len, const char *name, char *value, uint16_t size);
+
+/**
+ * @brief 获取 HTTP 统计
+ * @param stats :输出统计信息
+ */
+void wiz_http_get_stats(wiz_http_stats_t *stats);
+#endif
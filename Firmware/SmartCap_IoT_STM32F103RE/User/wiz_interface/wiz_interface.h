@@ -2,41 +2,20 @@
 #define __WIZ_INTERFACE_H__
 
 #include "wizchip_conf.h"
+#include "wiz_timer.h"
 
-/**
- * @brief 将新的定时器节点添加到定时器链表
- * @param func 回调函数指针，在定时器时间到达时调用
- * @param time 触发时间 (ms)
- */
-void wiz_add_timer(void (*func)(void), uint32_t time);
-
-/**
- * @brief 删除指定回调函数的定时器
- * @param func 回调函数指针
- * @return 无
- */
-void wiz_delete_timer(void (*func)(void));
-
-/**
- * @brief wiz 定时器事件处理器
- *
- * 你必须将此函数添加到你的 1ms 定时器中断中
- *
- */
-void wiz_timer_handler(void);
+/* VERSIONR 的固定值 */
+#define W5500_VERSION 0x04
 
-/**
- * @brief 毫秒延迟函数
- * @param nms :延迟时间
- */
-void wiz_user_delay_ms(uint32_t nms);
+/* 初始化时等待网线连接的最长时间 (秒) */
+#define WIZ_PHY_LINK_WAIT_S 5
 
 /**
  * @brief   wizchip 初始化函数
  * @param   无
- * @return  无
+ * @return  0 成功, -1 芯片版本检查失败
  */
-void wizchip_initialize(void);
+int8_t wizchip_initialize(void);
 
 /**
  * @brief   打印网络信息
@@ -47,22 +26,26 @@ void print_network_information(void);
 
 /**
  * @brief   设置网络信息
- * @param   sn: 套接字ID
- * @param   ethernet_buff:
- * @param   net_info: 网络信息结构体
+ * @param   ethernet_buff: DHCP 报文缓冲区, 至少 576 字节, DHCP 运行期间一直使用
+ * @param   conf_info: 网络信息结构体
  * @return  无
+ *
+ * @note    DHCP 模式下立即返回, 地址由后台 DHCP 任务获取 (见 wiz_dhcp.h)
  */
 void network_init(uint8_t *ethernet_buff, wiz_NetInfo *conf_info);
 
 /**
  * @brief 检查 WIZCHIP 版本
+ * @return 0 版本正确, -1 连续多次读取错误
  */
-void wizchip_version_check(void);
+int8_t wizchip_version_check(void);
 
 /**
  * @brief 以太网链路检测
+ * @param wait_s :最长等待秒数, 0 表示一直等待
+ * @return PHY_LINK_ON 或 PHY_LINK_OFF
  */
-void wiz_phy_link_check(void);
+uint8_t wiz_phy_link_check(uint16_t wait_s);
 
 /**
  * @brief 打印 PHY 信息
@@ -0,0 +1,221 @@
+#include "wiz_sockbuf.h"
+#include "wizchip_conf.h"
+#include <string.h>
+
+/**
+ * @brief 各用途的缓冲区下限 (KB) 与增长权重
+ *
+ * 先给每个 socket 分配下限, 再把剩余空间按 权重/当前大小 最大者优先翻倍,
+ * 直到 16KB 分完。权重为 0 的用途不参与增长。
+ */
+typedef struct
+{
+    uint8_t min_tx;
+    uint8_t min_rx;
+    uint8_t weight_tx;
+    uint8_t weight_rx;
+} wiz_sockbuf_rule_t;
+
+static const wiz_sockbuf_rule_t sockbuf_rules[WIZ_SOCK_ROLE_MAX] = {
+    /* UNUSED      */ {0, 0, 0, 0},
+    /* CONTROL     */ {1, 1, 0, 0},
+    /* INTERACTIVE */ {2, 2, 1, 1},
+    /* BULK_TX     */ {4, 1, 4, 0},
+    /* BULK_RX     */ {1, 4, 0, 4},
+    /* BULK        */ {4, 4, 4, 4},
+};
+
+/* 默认全部为 INTERACTIVE, 即 8 x 2KB, 与 wizchip 复位后的布局一致 */
+static wiz_sock_role_t sock_roles[_WIZCHIP_SOCK_NUM_] = {
+    WIZ_SOCK_ROLE_INTERACTIVE, WIZ_SOCK_ROLE_INTERACTIVE, WIZ_SOCK_ROLE_INTERACTIVE, WIZ_SOCK_ROLE_INTERACTIVE,
+    WIZ_SOCK_ROLE_INTERACTIVE, WIZ_SOCK_ROLE_INTERACTIVE, WIZ_SOCK_ROLE_INTERACTIVE, WIZ_SOCK_ROLE_INTERACTIVE};
+
+static wiz_sockbuf_stats_t sock_stats[_WIZCHIP_SOCK_NUM_];
+
+/**
+ * @brief 计算数组元素之和
+ */
+static uint8_t sockbuf_sum(const uint8_t size[_WIZCHIP_SOCK_NUM_])
+{
+    uint8_t i, total = 0;
+    for (i = 0; i < _WIZCHIP_SOCK_NUM_; i++)
+    {
+        total += size[i];
+    }
+    return total;
+}
+
+/**
+ * @brief 对单个方向 (TX 或 RX) 做分配
+ * @param size   :输入为下限, 输出为最终大小
+ * @param weight :每个 socket 的增长权重
+ */
+static void sockbuf_distribute(uint8_t size[_WIZCHIP_SOCK_NUM_], const uint8_t weight[_WIZCHIP_SOCK_NUM_])
+{
+    uint8_t i, best;
+    uint8_t total = sockbuf_sum(size);
+
+    /* 下限之和超出 16KB 时, 从低权重的最大块开始减半 */
+    while (total > WIZ_SOCKBUF_TOTAL_KB)
+    {
+        best = 0xFF;
+        for (i = 0; i < _WIZCHIP_SOCK_NUM_; i++)
+        {
+            if (size[i] <= 1)
+                continue;
+            if (best == 0xFF || weight[i] < weight[best] ||
+                (weight[i] == weight[best] && size[i] > size[best]))
+            {
+                best = i;
+            }
+        }
+        if (best == 0xFF)
+            break;
+        total -= size[best] / 2;
+        size[best] /= 2;
+    }
+
+    /* 把剩余空间按 weight/size 从大到小翻倍分配 */
+    while (1)
+    {
+        best = 0xFF;
+        for (i = 0; i < _WIZCHIP_SOCK_NUM_; i++)
+        {
+            if (weight[i] == 0 || size[i] == 0 || size[i] >= 16)
+                continue;
+            if (total + size[i] > WIZ_SOCKBUF_TOTAL_KB)
+                continue;
+            if (best == 0xFF || (uint16_t)weight[i] * size[best] > (uint16_t)weight[best] * size[i])
+            {
+                best = i;
+            }
+        }
+        if (best == 0xFF)
+            break;
+        total += size[best];
+        size[best] *= 2;
+    }
+}
+
+/**
+ * @brief 声明 socket 用途, 在下一次 wiz_sockbuf_apply 时生效
+ * @param sn   :套接字编号
+ * @param role :用途
+ */
+void wiz_sockbuf_set_role(uint8_t sn, wiz_sock_role_t role)
+{
+    if (sn >= _WIZCHIP_SOCK_NUM_ || role >= WIZ_SOCK_ROLE_MAX)
+        return;
+    sock_roles[sn] = role;
+}
+
+/**
+ * @brief 根据已声明的用途计算缓冲区布局
+ * @param txsize :输出, 每个 socket 的 TX 大小 (KB)
+ * @param rxsize :输出, 每个 socket 的 RX 大小 (KB)
+ */
+void wiz_sockbuf_plan(uint8_t txsize[_WIZCHIP_SOCK_NUM_], uint8_t rxsize[_WIZCHIP_SOCK_NUM_])
+{
+    uint8_t tx_weight[_WIZCHIP_SOCK_NUM_];
+    uint8_t rx_weight[_WIZCHIP_SOCK_NUM_];
+    uint8_t i;
+
+    for (i = 0; i < _WIZCHIP_SOCK_NUM_; i++)
+    {
+        const wiz_sockbuf_rule_t *rule = &sockbuf_rules[sock_roles[i]];
+        txsize[i] = rule->min_tx;
+        rxsize[i] = rule->min_rx;
+        tx_weight[i] = rule->weight_tx;
+        rx_weight[i] = rule->weight_rx;
+    }
+    sockbuf_distribute(txsize, tx_weight);
+    sockbuf_distribute(rxsize, rx_weight);
+}
+
+/**
+ * @brief 初始化时应用布局 (会软复位 W5500, 须在 network_init 之前调用)
+ * @return 0 成功, -1 布局非法
+ */
+int8_t wiz_sockbuf_apply(void)
+{
+    uint8_t memsize[2][_WIZCHIP_SOCK_NUM_];
+    uint8_t i;
+
+    wiz_sockbuf_plan(memsize[0], memsize[1]);
+    if (ctlwizchip(CW_INIT_WIZCHIP, (void *)memsize) != 0)
+        return -1;
+
+    for (i = 0; i < _WIZCHIP_SOCK_NUM_; i++)
+    {
+        sock_stats[i].tx_kb = memsize[0][i];
+        sock_stats[i].rx_kb = memsize[1][i];
+    }
+    return 0;
+}
+
+/**
+ * @brief 采样各 socket 缓冲区占用, 由默认任务在链路监控后调用 (会访问 SPI, 须持有 W5500 锁)
+ */
+void wiz_sockbuf_poll(void)
+{
+    uint8_t sn;
+    uint16_t tx_max, rx_max, tx_used, rx_used;
+
+    for (sn = 0; sn < _WIZCHIP_SOCK_NUM_; sn++)
+    {
+        wiz_sockbuf_stats_t *st = &sock_stats[sn];
+
+        if (getSn_SR(sn) == SOCK_CLOSED)
+            continue;
+
+        tx_max = getSn_TxMAX(sn);
+        rx_max = getSn_RxMAX(sn);
+        st->tx_kb = tx_max >> 10;
+        st->rx_kb = rx_max >> 10;
+        if (tx_max == 0 || rx_max == 0)
+            continue;
+
+        tx_used = tx_max - getSn_TX_FSR(sn);
+        rx_used = getSn_RX_RSR(sn);
+
+        if (tx_used > st->tx_peak)
+            st->tx_peak = tx_used;
+        if (rx_used > st->rx_peak)
+            st->rx_peak = rx_used;
+        st->tx_util = (uint8_t)(((uint32_t)tx_used * 100) / tx_max);
+        st->rx_util = (uint8_t)(((uint32_t)rx_used * 100) / rx_max);
+
+        /* RX 缓冲区满: TCP 对端被零窗口阻塞, UDP/MACRAW 后续报文被芯片丢弃 */
+        if (rx_used >= rx_max)
+            st->rx_overflow++;
+        st->samples++;
+    }
+}
+
+/**
+ * @brief 获取 socket 缓冲区统计
+ * @param sn    :套接字编号
+ * @param stats :输出统计信息
+ */
+void wiz_sockbuf_get_stats(uint8_t sn, wiz_sockbuf_stats_t *stats)
+{
+    if (sn >= _WIZCHIP_SOCK_NUM_ || stats == NULL)
+        return;
+    *stats = sock_stats[sn];
+}
+
+/**
+ * @brief 清零统计信息
+ */
+void wiz_sockbuf_reset_stats(void)
+{
+    uint8_t sn;
+    for (sn = 0; sn < _WIZCHIP_SOCK_NUM_; sn++)
+    {
+        uint8_t tx_kb = sock_stats[sn].tx_kb;
+        uint8_t rx_kb = sock_stats[sn].rx_kb;
+        memset(&sock_stats[sn], 0, sizeof(sock_stats[sn]));
+        sock_stats[sn].tx_kb = tx_kb;
+        sock_stats[sn].rx_kb = rx_kb;
+    }
+}
@@ -0,0 +1,77 @@
+#ifndef __WIZ_SOCKBUF_H__
+#define __WIZ_SOCKBUF_H__
+
+#include <stdint.h>
+#include "wizchip_conf.h"
+
+/* W5500 片内 TX/RX 各 16KB, 每个 socket 可配置 0/1/2/4/8/16 KB */
+#define WIZ_SOCKBUF_TOTAL_KB 16
+
+/**
+ * @brief socket 用途, 决定缓冲区分配的下限和权重
+ */
+typedef enum
+{
+    WIZ_SOCK_ROLE_UNUSED = 0, // 不使用, 不分配缓冲区
+    WIZ_SOCK_ROLE_CONTROL,    // DHCP/DNS/SNTP 等小包控制协议
+    WIZ_SOCK_ROLE_INTERACTIVE,// 普通交互式 TCP/UDP (默认)
+    WIZ_SOCK_ROLE_BULK_TX,    // 大量上行 (HTTP 响应, 日志推送)
+    WIZ_SOCK_ROLE_BULK_RX,    // 大量下行 (TFTP/OTA 下载)
+    WIZ_SOCK_ROLE_BULK,       // 双向大流量
+    WIZ_SOCK_ROLE_MAX
+} wiz_sock_role_t;
+
+/**
+ * @brief 单个 socket 的缓冲区统计
+ */
+typedef struct
+{
+    uint8_t tx_kb;          // 当前 TX 缓冲区大小 (KB)
+    uint8_t rx_kb;          // 当前 RX 缓冲区大小 (KB)
+    uint16_t tx_peak;       // TX 缓冲区最大占用 (字节)
+    uint16_t rx_peak;       // RX 缓冲区最大占用 (字节)
+    uint8_t tx_util;        // 最近一次采样的 TX 占用率 (%)
+    uint8_t rx_util;        // 最近一次采样的 RX 占用率 (%)
+    uint32_t rx_overflow;   // 采样时 RX 缓冲区已满的次数
+    uint32_t samples;       // 采样次数
+} wiz_sockbuf_stats_t;
+
+/**
+ * @brief 声明 socket 用途, 在下一次 wiz_sockbuf_apply 时生效
+ * @param sn   :套接字编号
+ * @param role :用途
+ *
+ * @note 各模块须在 W5500 初始化前登记; 芯片复位后监控按同一布局重新 apply
+ */
+void wiz_sockbuf_set_role(uint8_t sn, wiz_sock_role_t role);
+
+/**
+ * @brief 根据已声明的用途计算缓冲区布局
+ * @param txsize :输出, 每个 socket 的 TX 大小 (KB)
+ * @param rxsize :输出, 每个 socket 的 RX 大小 (KB)
+ */
+void wiz_sockbuf_plan(uint8_t txsize[_WIZCHIP_SOCK_NUM_], uint8_t rxsize[_WIZCHIP_SOCK_NUM_]);
+
+/**
+ * @brief 初始化时应用布局 (会软复位 W5500, 须在 network_init 之前调用)
+ * @return 0 成功, -1 布局非法
+ */
+int8_t wiz_sockbuf_apply(void);
+
+/**
+ * @brief 采样各 socket 缓冲区占用, 由默认任务在链路监控后调用 (会访问 SPI, 须持有 W5500 锁)
+ */
+void wiz_sockbuf_poll(void);
+
+/**
+ * @brief 获取 socket 缓冲区统计
+ * @param sn    :套接字编号
+ * @param stats :输出统计信息
+ */
+void wiz_sockbuf_get_stats(uint8_t sn, wiz_sockbuf_stats_t *stats);
+
+/**
+ * @brief 清零统计信息
+ */
+void wiz_sockbuf_reset_stats(void);
+#endif
@@ -0,0 +1,362 @@
+#include "wiz_supervisor.h"
+#include "wiz_interface.h"
+#include "wiz_dhcp.h"
+#include "wiz_platform.h"
+#include "wiz_sockbuf.h"
+#include "wiz_timer.h"
+#include "wiz_txq.h"
+#include "event_log.h"
+#include "socket.h"
+#include "cmsis_os.h"
+#include <string.h>
+
+/**
+ * @brief 登记的 socket 信息
+ */
+struct wiz_sup_sock
+{
+    uint8_t used;
+    uint8_t protocol;
+    uint16_t port;
+    uint8_t flag;
+    void (*on_reopen)(uint8_t sn);
+    volatile uint8_t reopen;  // 监控请求重开, 由拥有者任务在 wiz_supervisor_service_socket 中清除
+};
+
+static struct wiz_sup_sock sup_socks[WIZ_SUP_SOCK_MAX];
+static wiz_NetInfo sup_conf;
+static uint8_t *sup_buff = NULL;
+static wiz_sup_state_t sup_state = WIZ_SUP_STATE_INIT;
+static void (*sup_state_cb)(wiz_sup_state_t state) = NULL;
+static uint8_t sup_glitch_count = 0;
+static uint8_t sup_need_network = 0;
+static uint32_t sup_fault_start = 0;
+static uint32_t sup_phy_reset_at = 0;
+static wiz_sup_stats_t sup_stats;
+
+/**
+ * @brief 切换状态并通知
+ */
+static void sup_set_state(wiz_sup_state_t state)
+{
+    if (sup_state == state)
+        return;
+    sup_state = state;
+    EVENT_LOG1(ETH_STATE, state);
+    if (sup_state_cb != NULL)
+        sup_state_cb(state);
+}
+
+/**
+ * @brief 记录故障开始时刻 (只记录从正常状态进入故障的那一次)
+ */
+static void sup_mark_fault(void)
+{
+    if (sup_state == WIZ_SUP_STATE_UP)
+        sup_fault_start = wiz_timer_get_ms();
+}
+
+/**
+ * @brief 请求重开所有已登记的 socket
+ * @note  socket 和发送队列属于其它任务 (HTTP、网关、DNS、SNTP), 在这里 close 会与
+ *        拥有者的收发交错, 只做标记, 由拥有者调用 wiz_supervisor_service_socket 重开
+ */
+static void sup_reopen_sockets(void)
+{
+    uint8_t sn;
+    for (sn = 0; sn < WIZ_SUP_SOCK_MAX; sn++)
+    {
+        if (sup_socks[sn].used)
+            sup_socks[sn].reopen = 1;
+    }
+}
+
+/**
+ * @brief 芯片复位后恢复缓冲区布局和 MAC/IP 寄存器
+ */
+static void sup_restore_chip(void)
+{
+    wiz_sockbuf_apply();
+    wizchip_setnetinfo(&sup_conf);
+    sup_need_network = 1;
+}
+
+/**
+ * @brief 当前地址写入事件日志
+ */
+static void sup_log_address(void)
+{
+    wiz_NetInfo info;
+
+    wizchip_getnetinfo(&info);
+    EVENT_LOG2(ETH_ADDRESS, EVENT_LOG_IP(info.ip), EVENT_LOG_IP(info.gw));
+}
+
+/**
+ * @brief 网络可用, 记录恢复耗时
+ */
+static void sup_set_up(void)
+{
+    uint32_t elapsed;
+
+    if (sup_state != WIZ_SUP_STATE_INIT)
+    {
+        elapsed = wiz_timer_get_ms() - sup_fault_start;
+        sup_stats.recoveries++;
+        sup_stats.last_recovery_ms = elapsed;
+        if (elapsed > sup_stats.max_recovery_ms)
+            sup_stats.max_recovery_ms = elapsed;
+    }
+    if (sup_conf.dhcp == NETINFO_DHCP)
+        print_network_information();
+    sup_log_address();
+    sup_set_state(WIZ_SUP_STATE_UP);
+}
+
+/**
+ * @brief 重新配置网络 (DHCP 或静态) 并重开 socket
+ */
+static void sup_recover_network(void)
+{
+    wiz_NetInfo conf = sup_conf;
+
+    network_init(sup_buff, &conf);
+    sup_reopen_sockets();
+    sup_need_network = 0;
+
+    /* DHCP 在后台进行, 获得地址后由 wiz_supervisor_poll 切换到 UP */
+    if (sup_conf.dhcp == NETINFO_DHCP && !wiz_dhcp_has_address())
+    {
+        sup_set_state(WIZ_SUP_STATE_ADDR_WAIT);
+        return;
+    }
+    sup_set_up();
+}
+
+/**
+ * @brief 跟踪 DHCP 地址变化
+ */
+static void sup_check_address(void)
+{
+    if (sup_conf.dhcp != NETINFO_DHCP)
+        return;
+
+    /* 地址变化后原有连接失效 (静态退回->DHCP, 续租得到新地址, 租约到期) */
+    if (wiz_dhcp_take_changed())
+    {
+        sup_reopen_sockets();
+        if (sup_state == WIZ_SUP_STATE_UP && wiz_dhcp_has_address())
+        {
+            print_network_information();
+            sup_log_address();
+        }
+    }
+
+    if (sup_state == WIZ_SUP_STATE_ADDR_WAIT && wiz_dhcp_has_address())
+    {
+        sup_set_up();
+    }
+    else if (sup_state == WIZ_SUP_STATE_UP && !wiz_dhcp_has_address())
+    {
+        sup_mark_fault();
+        sup_set_state(WIZ_SUP_STATE_ADDR_WAIT);
+    }
+}
+
+/**
+ * @brief 初始化监控, 在 wizchip_initialize/network_init 之后调用
+ * @param ethernet_buff :DHCP 使用的缓冲区
+ * @param conf_info     :期望的网络配置, 恢复时据此重新执行 network_init
+ */
+void wiz_supervisor_init(uint8_t *ethernet_buff, wiz_NetInfo *conf_info)
+{
+    uint8_t link;
+
+    sup_buff = ethernet_buff;
+    sup_conf = *conf_info;
+    sup_glitch_count = 0;
+    sup_fault_start = wiz_timer_get_ms();
+    sup_phy_reset_at = sup_fault_start + WIZ_SUP_PHY_RESET_MS;
+    memset(&sup_stats, 0, sizeof(sup_stats));
+
+    ctlwizchip(CW_GET_PHYLINK, (void *)&link);
+    if (link == PHY_LINK_ON)
+    {
+        sup_need_network = 0;
+        if (sup_conf.dhcp == NETINFO_DHCP && !wiz_dhcp_has_address())
+            sup_set_state(WIZ_SUP_STATE_ADDR_WAIT);
+        else
+            sup_set_state(WIZ_SUP_STATE_UP);
+    }
+    else
+    {
+        /* 启动时未接网线, 接上后重新执行 network_init (DHCP 从 INIT-REBOOT 开始) */
+        sup_need_network = 1;
+        sup_set_state(WIZ_SUP_STATE_LINK_DOWN);
+    }
+}
+
+/**
+ * @brief 登记需要在恢复后自动重开的 socket
+ */
+int8_t wiz_supervisor_register_socket(uint8_t sn, uint8_t protocol, uint16_t port, uint8_t flag,
+                                      void (*on_reopen)(uint8_t sn))
+{
+    if (sn >= WIZ_SUP_SOCK_MAX)
+        return -1;
+    sup_socks[sn].protocol = protocol;
+    sup_socks[sn].port = port;
+    sup_socks[sn].flag = flag;
+    sup_socks[sn].on_reopen = on_reopen;
+    sup_socks[sn].reopen = 0;
+    sup_socks[sn].used = 1;
+    return 0;
+}
+
+/**
+ * @brief 取消登记
+ */
+void wiz_supervisor_unregister_socket(uint8_t sn)
+{
+    if (sn < WIZ_SUP_SOCK_MAX)
+        sup_socks[sn].used = 0;
+}
+
+/**
+ * @brief 处理监控的重开请求, 由拥有 socket 的任务调用
+ */
+int8_t wiz_supervisor_service_socket(uint8_t sn)
+{
+    if (sn >= WIZ_SUP_SOCK_MAX || !sup_socks[sn].used)
+        return -1;
+    /* 芯片无响应时 close() 会一直等待 Sn_SR, 复位恢复后会再次请求 */
+    if (!sup_socks[sn].reopen || sup_state == WIZ_SUP_STATE_CHIP_LOST)
+        return 0;
+
+    wizchip_acquire(osWaitForever);
+    sup_socks[sn].reopen = 0;
+    wiz_txq_close(sn);
+    wiz_udp_send_reset(sn);
+    close(sn);
+    if (socket(sn, sup_socks[sn].protocol, sup_socks[sn].port, sup_socks[sn].flag) == sn &&
+        sup_socks[sn].on_reopen != NULL)
+        sup_socks[sn].on_reopen(sn);
+    wizchip_release();
+    return 1;
+}
+
+/**
+ * @brief 设置状态变化通知
+ */
+void wiz_supervisor_set_state_cb(void (*cb)(wiz_sup_state_t state))
+{
+    sup_state_cb = cb;
+}
+
+/**
+ * @brief 检查哨兵寄存器并恢复, 在 W5500 锁内执行
+ *
+ * 哨兵寄存器:
+ * - VERSIONR 固定为 0x04, 读错说明 SPI 异常或芯片掉电
+ * - SHAR 在芯片复位后清零, 与期望 MAC 不符说明芯片被复位过
+ * - PHYCFGR.LNK 反映网线状态
+ */
+static void sup_poll(void)
+{
+    uint8_t mac[6];
+
+    if (sup_state == WIZ_SUP_STATE_CHIP_LOST)
+    {
+        /* 硬件复位后重试, 仍无响应则等待下一次 poll */
+        wizchip_reset();
+        if (getVERSIONR() != W5500_VERSION)
+            return;
+        sup_glitch_count = 0;
+        sup_restore_chip();
+    }
+
+    if (getVERSIONR() != W5500_VERSION)
+    {
+        sup_stats.spi_glitches++;
+        if (++sup_glitch_count >= WIZ_SUP_GLITCH_LIMIT)
+        {
+            sup_mark_fault();
+            if (sup_state != WIZ_SUP_STATE_CHIP_LOST)
+                wiz_dhcp_stop();
+            sup_set_state(WIZ_SUP_STATE_CHIP_LOST);
+        }
+        return;
+    }
+    sup_glitch_count = 0;
+
+    getSHAR(mac);
+    if (memcmp(mac, sup_conf.mac, sizeof(mac)) != 0)
+    {
+        sup_stats.chip_resets++;
+        sup_mark_fault();
+        sup_restore_chip();
+    }
+
+    if ((getPHYCFGR() & PHYCFGR_LNK_ON) == 0)
+    {
+        if (sup_state == WIZ_SUP_STATE_UP)
+        {
+            sup_stats.link_loss++;
+            sup_mark_fault();
+        }
+        /* 断线期间不发 DHCP 报文, 接上后重新执行 network_init */
+        if (sup_state != WIZ_SUP_STATE_LINK_DOWN)
+        {
+            wiz_dhcp_stop();
+            sup_phy_reset_at = wiz_timer_get_ms() + WIZ_SUP_PHY_RESET_MS;
+        }
+        else if ((int32_t)(wiz_timer_get_ms() - sup_phy_reset_at) >= 0)
+        {
+            /* PHY 挂死时接上网线也不会再报告链路, 定期复位 PHY 重新自协商 */
+            wizphy_reset();
+            sup_stats.phy_resets++;
+            sup_phy_reset_at = wiz_timer_get_ms() + WIZ_SUP_PHY_RESET_MS;
+        }
+        sup_need_network = 1;
+        sup_set_state(WIZ_SUP_STATE_LINK_DOWN);
+        return;
+    }
+
+    if ((sup_state != WIZ_SUP_STATE_UP && sup_state != WIZ_SUP_STATE_ADDR_WAIT) || sup_need_network)
+    {
+        sup_recover_network();
+        return;
+    }
+    sup_check_address();
+}
+
+/**
+ * @brief 周期检查, 由网络任务调用 (建议 200~500ms)
+ * @note  复位芯片、重新配置网络期间持有 W5500 锁, 其它任务的多寄存器操作不会插入其中
+ */
+void wiz_supervisor_poll(void)
+{
+    if (sup_state == WIZ_SUP_STATE_INIT)
+        return;
+
+    wizchip_acquire(osWaitForever);
+    sup_poll();
+    wizchip_release();
+}
+
+/**
+ * @brief 获取当前状态
+ */
+wiz_sup_state_t wiz_supervisor_get_state(void)
+{
+    return sup_state;
+}
+
+/**
+ * @brief 获取监控统计
+ * @param stats :输出统计信息
+ */
+void wiz_supervisor_get_stats(wiz_sup_stats_t *stats)
+{
+    *stats = sup_stats;
+}
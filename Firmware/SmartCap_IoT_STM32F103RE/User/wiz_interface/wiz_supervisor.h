@@ -0,0 +1,105 @@
+#ifndef __WIZ_SUPERVISOR_H__
+#define __WIZ_SUPERVISOR_H__
+
+#include <stdint.h>
+#include "wizchip_conf.h"
+
+/* 连续多少次读到错误的 VERSIONR 判定为芯片失联 */
+#define WIZ_SUP_GLITCH_LIMIT 3
+/* 需要自动重开的 socket 最大数量 */
+#define WIZ_SUP_SOCK_MAX _WIZCHIP_SOCK_NUM_
+/* 网线断开持续多久复位一次 PHY (PHY 挂死时链路不会自行恢复) */
+#define WIZ_SUP_PHY_RESET_MS 10000
+
+/**
+ * @brief W5500 运行状态
+ */
+typedef enum
+{
+    WIZ_SUP_STATE_INIT = 0,   // 尚未完成初始化
+    WIZ_SUP_STATE_UP,         // 链路正常, 网络已配置
+    WIZ_SUP_STATE_LINK_DOWN,  // 网线断开
+    WIZ_SUP_STATE_CHIP_LOST,  // 芯片无响应, 等待硬件复位后重试
+    WIZ_SUP_STATE_ADDR_WAIT   // 链路正常, 等待 DHCP 分配地址
+} wiz_sup_state_t;
+
+/**
+ * @brief 监控统计
+ */
+typedef struct
+{
+    uint32_t link_loss;         // 链路断开次数
+    uint32_t chip_resets;       // 检测到芯片被复位 (SHAR 丢失) 次数
+    uint32_t spi_glitches;      // VERSIONR 读取错误次数
+    uint32_t phy_resets;        // 断线期间复位 PHY 次数
+    uint32_t recoveries;        // 成功恢复次数
+    uint32_t last_recovery_ms;  // 最近一次从故障到恢复的耗时
+    uint32_t max_recovery_ms;   // 最大恢复耗时
+} wiz_sup_stats_t;
+
+/**
+ * @brief 初始化监控, 在 wizchip_initialize/network_init 之后调用
+ * @param ethernet_buff :DHCP 使用的缓冲区
+ * @param conf_info     :期望的网络配置, 恢复时据此重新执行 network_init
+ */
+void wiz_supervisor_init(uint8_t *ethernet_buff, wiz_NetInfo *conf_info);
+
+/**
+ * @brief 登记需要在恢复后自动重开的 socket
+ * @param sn        :套接字编号
+ * @param protocol  :Sn_MR_TCP / Sn_MR_UDP / Sn_MR_MACRAW
+ * @param port      :本地端口
+ * @param flag      :socket() 的 flag 参数
+ * @param on_reopen :socket() 成功后调用, 用于 listen/connect 及重新打开发送队列, 可为 NULL
+ * @return 0 成功, -1 参数错误
+ *
+ * @note 监控不操作其它任务的 socket, 恢复后只标记重开请求, 拥有 socket 的任务
+ *       需在自己的循环中调用 wiz_supervisor_service_socket
+ */
+int8_t wiz_supervisor_register_socket(uint8_t sn, uint8_t protocol, uint16_t port, uint8_t flag,
+                                      void (*on_reopen)(uint8_t sn));
+
+/**
+ * @brief 取消登记
+ * @param sn :套接字编号
+ */
+void wiz_supervisor_unregister_socket(uint8_t sn);
+
+/**
+ * @brief 处理监控的重开请求, 由拥有 socket 的任务在自己的循环中调用
+ * @param sn :套接字编号
+ * @return 1 已重开, 0 没有请求 (或芯片仍无响应), -1 未登记
+ *
+ * @note 持有 W5500 锁: 关闭发送队列 (复位未完成的 SEND 状态, 非 retain 队列丢弃未发送数据),
+ *       清除 UDP 发送状态, close/socket 后调用 on_reopen; on_reopen 中不能再调用 wizchip_acquire
+ */
+int8_t wiz_supervisor_service_socket(uint8_t sn);
+
+/**
+ * @brief 设置状态变化通知
+ * @param cb :回调函数, 参数为新状态
+ */
+void wiz_supervisor_set_state_cb(void (*cb)(wiz_sup_state_t state));
+
+/**
+ * @brief 周期检查, 由网络任务调用 (建议 200~500ms)
+ *
+ * 读取 VERSIONR、SHAR 和 PHYCFGR 判断芯片与链路状态, 发现异常时
+ * 复位芯片/重新配置网络并请求重开已登记的 socket; 断线超过 WIZ_SUP_PHY_RESET_MS
+ * 时复位 PHY。DHCP 在后台任务中进行, 获得地址前状态为 WIZ_SUP_STATE_ADDR_WAIT;
+ * 租约变化 (续租得到新地址/到期) 时请求重开 socket。
+ * 检查期间持有 W5500 锁 (wizchip_acquire)。
+ */
+void wiz_supervisor_poll(void);
+
+/**
+ * @brief 获取当前状态
+ */
+wiz_sup_state_t wiz_supervisor_get_state(void);
+
+/**
+ * @brief 获取监控统计
+ * @param stats :输出统计信息
+ */
+void wiz_supervisor_get_stats(wiz_sup_stats_t *stats);
+#endif
@@ -0,0 +1,329 @@
+#include "wiz_timer.h"
+#include "cmsis_os.h"
+#include "event_log.h"
+#include "console.h"
+#include "stm32f1xx.h"
+#include <stddef.h>
+
+#define WIZ_TIMER_SIGNAL 0x01
+
+/**
+ * @brief 定时器节点 (静态池)
+ */
+struct wiz_timer
+{
+    void (*func)(void);     // 定时器触发时执行的回调函数指针, NULL 表示空闲
+    uint32_t period;        // 周期(ms)
+    uint32_t deadline;      // 下一次到期时刻(ms)
+    uint16_t heap_pos;      // 在最小堆中的位置
+};
+
+static struct wiz_timer timer_pool[WIZ_TIMER_MAX];
+static uint16_t timer_heap[WIZ_TIMER_MAX];    // 按 deadline 排序的最小堆, 存放池下标
+static volatile uint16_t timer_heap_len = 0;
+static volatile uint32_t timer_next_deadline = 0;
+
+static volatile uint32_t wiz_ms_ticks = 0;
+static volatile uint8_t timer_signal_pending = 0;
+static osThreadId timer_task_handle = NULL;
+static osStaticThreadDef_t timer_task_cb;
+static uint32_t timer_task_stack[WIZ_TIMER_TASK_STACK];
+static wiz_timer_stats_t timer_stats;
+
+/**
+ * @brief 关中断保护堆操作
+ *
+ * 不使用 taskENTER_CRITICAL: 调度器启动前退出临界区不会恢复中断,
+ * 而 wizchip_initialize 在启动前依赖 1ms 中断计数做延时
+ */
+static uint32_t timer_lock(void)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    return primask;
+}
+
+static void timer_unlock(uint32_t primask)
+{
+    if (!primask)
+        __enable_irq();
+}
+
+/**
+ * @brief 比较两个时刻, 允许计数回绕
+ * @return a 早于 b 时返回非 0
+ */
+static uint8_t time_before(uint32_t a, uint32_t b)
+{
+    return (int32_t)(a - b) < 0;
+}
+
+static void heap_swap(uint16_t i, uint16_t j)
+{
+    uint16_t tmp = timer_heap[i];
+    timer_heap[i] = timer_heap[j];
+    timer_heap[j] = tmp;
+    timer_pool[timer_heap[i]].heap_pos = i;
+    timer_pool[timer_heap[j]].heap_pos = j;
+}
+
+static void heap_sift_up(uint16_t pos)
+{
+    while (pos > 0)
+    {
+        uint16_t parent = (pos - 1) / 2;
+        if (!time_before(timer_pool[timer_heap[pos]].deadline, timer_pool[timer_heap[parent]].deadline))
+            break;
+        heap_swap(pos, parent);
+        pos = parent;
+    }
+}
+
+static void heap_sift_down(uint16_t pos)
+{
+    while (1)
+    {
+        uint16_t left = pos * 2 + 1;
+        uint16_t right = left + 1;
+        uint16_t min = pos;
+
+        if (left < timer_heap_len &&
+            time_before(timer_pool[timer_heap[left]].deadline, timer_pool[timer_heap[min]].deadline))
+            min = left;
+        if (right < timer_heap_len &&
+            time_before(timer_pool[timer_heap[right]].deadline, timer_pool[timer_heap[min]].deadline))
+            min = right;
+        if (min == pos)
+            break;
+        heap_swap(pos, min);
+        pos = min;
+    }
+}
+
+/**
+ * @brief 更新中断中比较用的最近到期时刻, 调用者需持锁
+ */
+static void heap_update_next(void)
+{
+    if (timer_heap_len > 0)
+        timer_next_deadline = timer_pool[timer_heap[0]].deadline;
+}
+
+/**
+ * @brief 定时器回调任务, 平时阻塞, 由中断在最近定时器到期时唤醒
+ */
+static void wiz_timer_task(void const *argument)
+{
+    for (;;)
+    {
+        osSignalWait(WIZ_TIMER_SIGNAL, osWaitForever);
+        timer_signal_pending = 0;
+        wiz_timer_process();
+    }
+}
+
+/**
+ * @brief 创建定时器回调任务, 在调度器启动前调用一次
+ */
+void wiz_timer_init(void)
+{
+    if (timer_task_handle != NULL)
+        return;
+    osThreadStaticDef(wizTimerTask, wiz_timer_task, osPriorityAboveNormal, 0, WIZ_TIMER_TASK_STACK,
+                      timer_task_stack, &timer_task_cb);
+    timer_task_handle = osThreadCreate(osThread(wizTimerTask), NULL);
+    if (timer_task_handle == NULL)
+    {
+        Console_Puts("WIZ: timer task create failed\r\n");
+        EVENT_LOG1(TASK_CREATE_FAILED, EventLog_Tag("wizt"));
+    }
+}
+
+/**
+ * @brief 添加周期定时器
+ * @param func 回调函数指针，在定时器时间到达时调用
+ * @param time 周期 (ms)
+ * @return 0 成功, -1 池已满或参数错误
+ */
+int8_t wiz_add_timer(void (*func)(void), uint32_t time)
+{
+    uint32_t primask;
+    uint16_t i;
+
+    if (func == NULL || time == 0)
+        return -1;
+
+    primask = timer_lock();
+    for (i = 0; i < WIZ_TIMER_MAX; i++)
+    {
+        if (timer_pool[i].func == NULL)
+            break;
+    }
+    if (i == WIZ_TIMER_MAX)
+    {
+        timer_stats.add_failed++;
+        timer_unlock(primask);
+        return -1;
+    }
+
+    timer_pool[i].func = func;
+    timer_pool[i].period = time;
+    timer_pool[i].deadline = wiz_ms_ticks + time;
+    timer_pool[i].heap_pos = timer_heap_len;
+    timer_heap[timer_heap_len] = i;
+    timer_heap_len++;
+    heap_sift_up(timer_pool[i].heap_pos);
+    heap_update_next();
+
+    timer_stats.active = timer_heap_len;
+    if (timer_heap_len > timer_stats.peak)
+        timer_stats.peak = timer_heap_len;
+    timer_unlock(primask);
+    return 0;
+}
+
+/**
+ * @brief 删除指定回调函数的定时器
+ * @param func 回调函数指针
+ */
+void wiz_delete_timer(void (*func)(void))
+{
+    uint32_t primask;
+    uint16_t i, pos;
+
+    primask = timer_lock();
+    for (i = 0; i < WIZ_TIMER_MAX; i++)
+    {
+        if (timer_pool[i].func == func && func != NULL)
+            break;
+    }
+    if (i == WIZ_TIMER_MAX)
+    {
+        timer_unlock(primask);
+        return;
+    }
+
+    pos = timer_pool[i].heap_pos;
+    timer_pool[i].func = NULL;
+    timer_heap_len--;
+    if (pos != timer_heap_len)
+    {
+        /* 用堆尾元素填补空位, 再向上或向下调整 */
+        uint16_t moved = timer_heap[timer_heap_len];
+        heap_swap(pos, timer_heap_len);
+        heap_sift_up(pos);
+        heap_sift_down(timer_pool[moved].heap_pos);
+    }
+    heap_update_next();
+    timer_stats.active = timer_heap_len;
+    timer_unlock(primask);
+}
+
+/**
+ * @brief wiz 定时器事件处理器
+ *
+ * 你必须将此函数添加到你的 1ms 定时器中断中
+ */
+void wiz_timer_handler(void)
+{
+    wiz_ms_ticks++;
+
+    if (timer_heap_len == 0 || time_before(wiz_ms_ticks, timer_next_deadline))
+        return;
+
+    if (timer_task_handle != NULL && osKernelRunning())
+    {
+        if (!timer_signal_pending)
+        {
+            timer_signal_pending = 1;
+            osSignalSet(timer_task_handle, WIZ_TIMER_SIGNAL);
+        }
+    }
+    else
+    {
+        /* 调度器启动前保持原有行为: 在中断中直接执行回调 */
+        wiz_timer_process();
+    }
+}
+
+/**
+ * @brief 执行所有已到期的回调, 由定时器任务调用
+ *
+ * 下一次到期时刻按 deadline += period 累加, 回调执行延迟不会累积为漂移;
+ * 落后超过一个周期时直接对齐到当前时刻。
+ */
+void wiz_timer_process(void)
+{
+    uint32_t primask, now, late;
+    struct wiz_timer *t;
+    void (*func)(void);
+
+    while (1)
+    {
+        primask = timer_lock();
+        now = wiz_ms_ticks;
+        if (timer_heap_len == 0 || time_before(now, timer_pool[timer_heap[0]].deadline))
+        {
+            timer_unlock(primask);
+            break;
+        }
+
+        t = &timer_pool[timer_heap[0]];
+        func = t->func;
+        late = now - t->deadline;
+        t->deadline += t->period;
+        if (!time_before(now, t->deadline))
+            t->deadline = now + t->period;
+        heap_sift_down(0);
+        heap_update_next();
+
+        timer_stats.fired++;
+        if (late > timer_stats.late_max)
+            timer_stats.late_max = late;
+        timer_unlock(primask);
+
+        func();
+    }
+}
+
+/**
+ * @brief 获取毫秒计数
+ * @return 自 wiz 定时器中断启用以来的毫秒数
+ */
+uint32_t wiz_timer_get_ms(void)
+{
+    return wiz_ms_ticks;
+}
+
+/**
+ * @brief 毫秒延迟函数
+ * @param nms :延迟时间
+ *
+ * @note 调度器运行时阻塞当前任务 (osDelay), 启动前忙等 1ms 计数
+ */
+void wiz_user_delay_ms(uint32_t nms)
+{
+    uint32_t start;
+
+    if (osKernelRunning())
+    {
+        osDelay(nms);
+        return;
+    }
+
+    start = wiz_ms_ticks;
+    while ((wiz_ms_ticks - start) < nms)
+    {
+    }
+}
+
+/**
+ * @brief 获取定时器统计
+ * @param stats :输出统计信息
+ */
+void wiz_timer_get_stats(wiz_timer_stats_t *stats)
+{
+    uint32_t primask = timer_lock();
+    *stats = timer_stats;
+    timer_unlock(primask);
+}
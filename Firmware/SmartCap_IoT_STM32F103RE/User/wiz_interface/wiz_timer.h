@@ -0,0 +1,80 @@
+#ifndef __WIZ_TIMER_H__
+#define __WIZ_TIMER_H__
+
+#include <stdint.h>
+
+/* 定时器静态池容量 (可在编译选项中覆盖, 中断开销与容量无关, 到期处理为 O(log n)) */
+#ifndef WIZ_TIMER_MAX
+#define WIZ_TIMER_MAX 16
+#endif
+/* 回调任务栈 (字, 静态分配), 本身约 260 字节, 余量留给 wiz_add_timer 的回调,
+ * 暂定值, 待板上按 tasks 命令的 stack free 确认 */
+#define WIZ_TIMER_TASK_STACK 128
+
+/**
+ * @brief 定时器统计
+ */
+typedef struct
+{
+    uint16_t active;         // 当前注册的定时器数
+    uint16_t peak;           // 同时注册的最大定时器数
+    uint32_t fired;          // 回调累计执行次数
+    uint32_t late_max;       // 回调相对期望时刻的最大延迟 (ms)
+    uint32_t add_failed;     // 池满导致的注册失败次数
+} wiz_timer_stats_t;
+
+/**
+ * @brief 创建定时器回调任务, 在调度器启动前调用一次
+ *
+ * 调度器运行后, 到期回调在该任务中执行; 调度器启动前 (例如 User_main
+ * 中的 wizchip_initialize) 回调仍在 1ms 中断中直接执行。
+ */
+void wiz_timer_init(void);
+
+/**
+ * @brief 添加周期定时器
+ * @param func 回调函数指针，在定时器时间到达时调用
+ * @param time 周期 (ms)
+ * @return 0 成功, -1 池已满或参数错误
+ */
+int8_t wiz_add_timer(void (*func)(void), uint32_t time);
+
+/**
+ * @brief 删除指定回调函数的定时器
+ * @param func 回调函数指针
+ */
+void wiz_delete_timer(void (*func)(void));
+
+/**
+ * @brief wiz 定时器事件处理器
+ *
+ * 你必须将此函数添加到你的 1ms 定时器中断中。
+ * 中断中只递增毫秒计数并与最近到期时刻比较, 开销与定时器数量无关。
+ */
+void wiz_timer_handler(void);
+
+/**
+ * @brief 执行所有已到期的回调, 由定时器任务调用
+ */
+void wiz_timer_process(void);
+
+/**
+ * @brief 获取毫秒计数
+ * @return 自 wiz 定时器中断启用以来的毫秒数
+ */
+uint32_t wiz_timer_get_ms(void);
+
+/**
+ * @brief 毫秒延迟函数
+ * @param nms :延迟时间
+ *
+ * @note 调度器运行时阻塞当前任务 (osDelay), 启动前忙等 1ms 计数
+ */
+void wiz_user_delay_ms(uint32_t nms);
+
+/**
+ * @brief 获取定时器统计
+ * @param stats :输出统计信息
+ */
+void wiz_timer_get_stats(wiz_timer_stats_t *stats);
+#endif
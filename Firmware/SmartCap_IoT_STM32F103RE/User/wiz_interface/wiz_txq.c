@@ -0,0 +1,549 @@
+#include "wiz_txq.h"
+#include "wizchip_conf.h"
+#include "socket.h"
+#include "cmsis_os.h"
+#include <string.h>
+
+/**
+ * @brief 单个 socket 的软件发送队列
+ *
+ * 环形缓冲区: head 只由生产者修改, tail 只由 wiz_txq_poll 修改,
+ * 保留一个空字节区分空/满。数据写入芯片后即释放队列空间; retain 队列
+ * 收到 SEND_OK 后才释放 (tail 前进 inflight), 连接断开时仍可取回或重发。
+ * 非 retain 队列在等待 SEND_OK 期间继续把数据写入芯片 TX 缓冲区 (staged),
+ * SEND_OK 后一次 SEND 发出, 每个往返可发送的数据量由片内 TX 缓冲区大小决定
+ * (与 socket.c 的 send 相同: 先写数据, 再等上一次 SEND_OK)。
+ * wiz_txq_close 可能在 pump 执行期间由其它任务调用: pump 运行时置 pumping,
+ * close 此时只置 close_req, 由 pump 返回前完成关闭, tail 和 SEND 状态始终只有一个任务修改。
+ */
+struct wiz_txq
+{
+    uint8_t *buf;
+    uint16_t size;
+    volatile uint16_t head;   // 写指针 (生产者)
+    volatile uint16_t tail;   // 读指针 (pump)
+    volatile uint8_t opened;  // 队列已打开
+    volatile uint8_t error;   // socket 已关闭或超时
+    uint8_t cmd_pending;      // Sn_CR_SEND 已写入, 等待芯片清零 Sn_CR
+    uint8_t sending;          // 等待 SEND_OK
+    uint8_t retain;           // 收到 SEND_OK 才释放空间 (wiz_txq_open_retain)
+    uint16_t inflight;        // retain 时已写入芯片、等待 SEND_OK 的字节数 (仍在 tail 之后占用队列)
+    uint16_t staged;          // 已写入芯片 TX 缓冲区、尚未发出 SEND 的字节数
+    volatile uint8_t pumping;   // pump 正在推进该队列
+    volatile uint8_t close_req; // wiz_txq_close 已调用, 关闭尚未完成
+    osSemaphoreId space_sem;  // pump 释放空间后通知生产者
+    wiz_txq_stats_t stats;
+};
+
+static struct wiz_txq txq[_WIZCHIP_SOCK_NUM_];
+static osStaticSemaphoreDef_t txq_sem_cb[_WIZCHIP_SOCK_NUM_];
+static volatile uint8_t udp_send_busy[_WIZCHIP_SOCK_NUM_];   // 每个 socket 只由拥有它的任务修改
+static uint8_t udp_cmd_pending[_WIZCHIP_SOCK_NUM_];          // Sn_CR_SEND 已写入, 等待芯片清零 Sn_CR
+
+/**
+ * @brief 队列中待发送字节数
+ */
+static uint16_t txq_used(const struct wiz_txq *q)
+{
+    uint16_t head = q->head;
+    uint16_t tail = q->tail;
+    return (head >= tail) ? (head - tail) : (q->size - tail + head);
+}
+
+/**
+ * @brief 初始化队列
+ */
+static int8_t txq_init(uint8_t sn, uint8_t *buf, uint16_t size, uint8_t retain)
+{
+    struct wiz_txq *q;
+
+    if (sn >= _WIZCHIP_SOCK_NUM_ || buf == NULL || size < 2)
+        return -1;
+
+    q = &txq[sn];
+    q->opened = 0;
+    q->buf = buf;
+    q->size = size;
+    q->head = 0;
+    q->tail = 0;
+    q->error = 0;
+    q->retain = retain;
+    q->cmd_pending = 0;
+    q->sending = 0;
+    q->inflight = 0;
+    q->staged = 0;
+    q->close_req = 0;
+    memset(&q->stats, 0, sizeof(q->stats));
+
+    if (q->space_sem == NULL)
+    {
+        const osSemaphoreDef_t sem_def = {0, &txq_sem_cb[sn]};
+        q->space_sem = osSemaphoreCreate(&sem_def, 1);
+        if (q->space_sem == NULL)
+            return -1;
+    }
+    q->opened = 1;
+    return 0;
+}
+
+/**
+ * @brief 为 TCP socket 打开发送队列
+ * @param sn   :套接字编号, socket 需已由 socket()/connect()/listen() 打开
+ * @param buf  :队列存储区, 由调用者提供 (静态数组)
+ * @param size :存储区大小 (字节)
+ * @return 0 成功, -1 参数错误
+ */
+int8_t wiz_txq_open(uint8_t sn, uint8_t *buf, uint16_t size)
+{
+    return txq_init(sn, buf, size, 0);
+}
+
+/**
+ * @brief 打开发送队列, 数据收到 SEND_OK 后才释放
+ * @param sn   :套接字编号
+ * @param buf  :队列存储区
+ * @param size :存储区大小 (字节)
+ * @return 0 成功, -1 参数错误
+ */
+int8_t wiz_txq_open_retain(uint8_t sn, uint8_t *buf, uint16_t size)
+{
+    return txq_init(sn, buf, size, 1);
+}
+
+/**
+ * @brief 完成关闭: 清除未完成的 SEND 状态, 非 retain 队列丢弃数据
+ */
+static void txq_finish_close(struct wiz_txq *q)
+{
+    q->close_req = 0;
+    /* socket 随后被 close/重开, 上一次 SEND 不会再有 SEND_OK; retain 队列未确认的数据仍在 tail 之后 */
+    q->cmd_pending = 0;
+    q->sending = 0;
+    q->inflight = 0;
+    q->staged = 0;
+    if (!q->retain)
+        q->tail = q->head;
+}
+
+/**
+ * @brief 关闭发送队列, 丢弃未发送数据 (retain 队列保留未确认的数据)
+ * @param sn :套接字编号
+ */
+void wiz_txq_close(uint8_t sn)
+{
+    struct wiz_txq *q;
+
+    if (sn >= _WIZCHIP_SOCK_NUM_)
+        return;
+    q = &txq[sn];
+    q->opened = 0;
+    q->error = 1;
+    q->close_req = 1;
+    /* pump 正在发送时由它返回前完成, 否则在这里完成 */
+    if (!q->pumping)
+        txq_finish_close(q);
+    if (q->space_sem != NULL)
+        osSemaphoreRelease(q->space_sem);
+}
+
+/**
+ * @brief 在新连接上继续发送关闭前未确认的数据
+ * @param sn :套接字编号
+ * @return 0 成功, -1 没有打开过 retain 队列
+ */
+int8_t wiz_txq_resume(uint8_t sn)
+{
+    struct wiz_txq *q;
+
+    if (sn >= _WIZCHIP_SOCK_NUM_ || txq[sn].buf == NULL || !txq[sn].retain)
+        return -1;
+
+    q = &txq[sn];
+    q->opened = 0;
+    q->error = 0;
+    q->cmd_pending = 0;
+    q->sending = 0;
+    q->inflight = 0;
+    q->staged = 0;
+    q->close_req = 0;
+    q->opened = 1;
+    return 0;
+}
+
+/**
+ * @brief 取回已关闭或出错的队列中未确认的数据
+ * @param sn  :套接字编号
+ * @param buf :输出缓冲区
+ * @param len :缓冲区大小
+ * @return 取回的字节数
+ */
+uint16_t wiz_txq_reclaim(uint8_t sn, uint8_t *buf, uint16_t len)
+{
+    struct wiz_txq *q;
+    uint16_t used, first, tail;
+
+    if (sn >= _WIZCHIP_SOCK_NUM_ || txq[sn].buf == NULL)
+        return 0;
+    q = &txq[sn];
+    if ((q->opened && !q->error) || q->close_req)
+        return 0;
+
+    used = txq_used(q);
+    if (len > used)
+        len = used;
+    tail = q->tail;
+    first = q->size - tail;
+    if (first > len)
+        first = len;
+    memcpy(buf, &q->buf[tail], first);
+    if (len > first)
+        memcpy(&buf[first], q->buf, len - first);
+    tail += len;
+    if (tail >= q->size)
+        tail -= q->size;
+    q->tail = tail;
+    q->inflight = 0;
+    return len;
+}
+
+/**
+ * @brief 查询队列剩余空间
+ * @param sn :套接字编号
+ * @return 可立即写入的字节数
+ */
+uint16_t wiz_txq_free(uint8_t sn)
+{
+    if (sn >= _WIZCHIP_SOCK_NUM_ || !txq[sn].opened)
+        return 0;
+    return txq[sn].size - 1 - txq_used(&txq[sn]);
+}
+
+/**
+ * @brief 队列数据是否已全部发出
+ * @param sn :套接字编号
+ * @return 1 队列为空且没有等待 SEND_OK 的发送 (或队列未打开/已出错), 0 仍有数据在发送
+ */
+uint8_t wiz_txq_idle(uint8_t sn)
+{
+    if (sn >= _WIZCHIP_SOCK_NUM_ || !txq[sn].opened || txq[sn].error)
+        return 1;
+    return txq_used(&txq[sn]) == 0 && !txq[sn].sending && txq[sn].staged == 0;
+}
+
+/**
+ * @brief 写入发送队列, 队列满时阻塞等待 (背压)
+ * @param sn         :套接字编号
+ * @param data       :数据
+ * @param len        :长度
+ * @param timeout_ms :最长等待时间, 0 表示不等待
+ * @return >0 实际写入的字节数 (超时时可能小于 len), <0 WIZ_TXQ_ERR_xxx
+ */
+int32_t wiz_txq_write(uint8_t sn, const uint8_t *data, uint16_t len, uint32_t timeout_ms)
+{
+    struct wiz_txq *q;
+    uint32_t start = osKernelSysTick();
+    uint32_t elapsed;
+    uint16_t written = 0;
+    uint16_t chunk, first, head;
+
+    if (sn >= _WIZCHIP_SOCK_NUM_ || !txq[sn].opened)
+        return WIZ_TXQ_ERR_SOCKNUM;
+    q = &txq[sn];
+
+    while (written < len)
+    {
+        if (q->error)
+            return written ? (int32_t)written : WIZ_TXQ_ERR_CLOSED;
+
+        chunk = wiz_txq_free(sn);
+        if (chunk > len - written)
+            chunk = len - written;
+
+        if (chunk > 0)
+        {
+            head = q->head;
+            first = q->size - head;
+            if (first > chunk)
+                first = chunk;
+            memcpy(&q->buf[head], &data[written], first);
+            if (chunk > first)
+                memcpy(q->buf, &data[written + first], chunk - first);
+            head += chunk;
+            if (head >= q->size)
+                head -= q->size;
+            q->head = head;
+
+            written += chunk;
+            q->stats.bytes_queued += chunk;
+            if (txq_used(q) > q->stats.queued_peak)
+                q->stats.queued_peak = txq_used(q);
+            continue;
+        }
+
+        /* 队列已满: 阻塞等待 pump 释放空间 */
+        elapsed = osKernelSysTick() - start;
+        if (elapsed >= timeout_ms)
+            break;
+        q->stats.producer_waits++;
+        osSemaphoreWait(q->space_sem, timeout_ms - elapsed);
+    }
+
+    if (written == 0 && len > 0)
+        return WIZ_TXQ_ERR_TIMEOUT;
+    return (int32_t)written;
+}
+
+/**
+ * @brief 推进单个队列
+ * @return 本次写入 W5500 的字节数
+ */
+static uint16_t txq_pump(uint8_t sn, struct wiz_txq *q)
+{
+    uint8_t sr, ir;
+    uint16_t used, fsr, n, first, tail;
+
+    sr = getSn_SR(sn);
+    if (sr != SOCK_ESTABLISHED && sr != SOCK_CLOSE_WAIT)
+    {
+        q->error = 1;
+        if (!q->retain)
+            q->tail = q->head;
+        osSemaphoreRelease(q->space_sem);
+        return 0;
+    }
+
+    /* 上一条命令尚未被芯片接收 */
+    if (q->cmd_pending)
+    {
+        if (getSn_CR(sn))
+            return 0;
+        q->cmd_pending = 0;
+    }
+
+    /* 上一次 SEND 是否完成 */
+    if (q->sending)
+    {
+        ir = getSn_IR(sn);
+        if (ir & Sn_IR_SENDOK)
+        {
+            setSn_IR(sn, Sn_IR_SENDOK);
+            q->sending = 0;
+            q->stats.send_ok++;
+            if (q->inflight)
+            {
+                /* retain 队列: 对端已确认, 释放队列空间 */
+                tail = q->tail + q->inflight;
+                if (tail >= q->size)
+                    tail -= q->size;
+                q->tail = tail;
+                q->inflight = 0;
+                osSemaphoreRelease(q->space_sem);
+            }
+        }
+        else if (ir & Sn_IR_TIMEOUT)
+        {
+            setSn_IR(sn, Sn_IR_TIMEOUT);
+            q->stats.timeouts++;
+            q->error = 1;
+            q->staged = 0;
+            if (!q->retain)
+                q->tail = q->head;
+            close(sn);
+            osSemaphoreRelease(q->space_sem);
+            return 0;
+        }
+        else if (q->retain)
+        {
+            return 0;
+        }
+    }
+
+    n = 0;
+    used = txq_used(q);
+    if (used != 0)
+    {
+        fsr = getSn_TX_FSR(sn);
+        if (fsr == 0)
+            q->stats.chip_full++;
+        n = (used < fsr) ? used : fsr;
+    }
+    if (n != 0)
+    {
+        tail = q->tail;
+        first = q->size - tail;
+        if (first > n)
+            first = n;
+        wiz_send_data(sn, &q->buf[tail], first);
+        if (n > first)
+            wiz_send_data(sn, q->buf, n - first);
+        q->stats.bytes_sent += n;
+        if (q->retain)
+        {
+            q->inflight = n;
+        }
+        else
+        {
+            tail += n;
+            if (tail >= q->size)
+                tail -= q->size;
+            q->tail = tail;
+            q->staged += n;
+            osSemaphoreRelease(q->space_sem);
+        }
+    }
+
+    /* 上一次 SEND 未完成时只写入数据, SEND_OK 后再发出 */
+    if (q->sending || (n == 0 && q->staged == 0))
+        return n;
+
+    /* 不再自旋等待 Sn_CR 清零, 下一次 poll 时检查 */
+    setSn_CR(sn, Sn_CR_SEND);
+    q->cmd_pending = 1;
+    q->sending = 1;
+    q->staged = 0;
+    q->stats.send_cmds++;
+    return n;
+}
+
+/**
+ * @brief 推进队列, 期间到达的关闭请求在返回前完成
+ * @return 本次写入 W5500 的字节数
+ */
+static uint16_t txq_pump_guarded(uint8_t sn)
+{
+    struct wiz_txq *q = &txq[sn];
+    uint16_t n = 0;
+
+    /* 先置 pumping 再检查 opened: close 要么看到 pumping, 要么 pump 看到队列已关闭 */
+    q->pumping = 1;
+    if (q->opened && !q->error)
+        n = txq_pump(sn, q);
+    q->pumping = 0;
+    if (q->close_req)
+        txq_finish_close(q);
+    return n;
+}
+
+/**
+ * @brief 推进单个 socket 队列的发送, 不阻塞
+ * @param sn :套接字编号
+ * @return 本次写入 W5500 的字节数
+ *
+ * @note 同一队列只能由一个任务推进, 多个任务各自拥有 socket 时使用本函数
+ */
+uint16_t wiz_txq_poll_socket(uint8_t sn)
+{
+    if (sn >= _WIZCHIP_SOCK_NUM_ || !txq[sn].opened || txq[sn].error)
+        return 0;
+    return txq_pump_guarded(sn);
+}
+
+/**
+ * @brief 推进所有已打开队列的发送, 不阻塞
+ * @return 本次写入 W5500 的字节数
+ */
+uint32_t wiz_txq_poll(void)
+{
+    uint8_t sn;
+    uint32_t total = 0;
+
+    for (sn = 0; sn < _WIZCHIP_SOCK_NUM_; sn++)
+    {
+        if (!txq[sn].opened || txq[sn].error)
+            continue;
+        total += txq_pump_guarded(sn);
+    }
+    return total;
+}
+
+/**
+ * @brief 获取发送队列统计
+ * @param sn    :套接字编号
+ * @param stats :输出统计信息
+ */
+void wiz_txq_get_stats(uint8_t sn, wiz_txq_stats_t *stats)
+{
+    if (sn >= _WIZCHIP_SOCK_NUM_ || stats == NULL)
+        return;
+    *stats = txq[sn].stats;
+    stats->queued = txq[sn].opened ? txq_used(&txq[sn]) : 0;
+}
+
+/**
+ * @brief 发出一个 UDP 报文, 不等待 SEND_OK
+ * @return 0 已发出, -1 socket 未打开/上一帧尚未完成/TX 缓冲区不足
+ */
+int8_t wiz_udp_send_nowait(uint8_t sn, const uint8_t *buf, uint16_t len, const uint8_t *ip, uint16_t port)
+{
+    if (sn >= _WIZCHIP_SOCK_NUM_ || getSn_SR(sn) != SOCK_UDP)
+        return -1;
+    if (udp_send_busy[sn] && wiz_udp_send_status(sn) == WIZ_UDP_SEND_PENDING)
+        return -1;
+    if (getSn_TX_FSR(sn) < len)
+        return -1;
+
+    setSn_DIPR(sn, (uint8_t *)ip);
+    setSn_DPORT(sn, port);
+    wiz_send_data(sn, (uint8_t *)buf, len);
+
+    /* 与 TCP 队列相同, 不自旋等待 Sn_CR 清零, 由 wiz_udp_send_status 检查 */
+    setSn_CR(sn, Sn_CR_SEND);
+    udp_cmd_pending[sn] = 1;
+    udp_send_busy[sn] = 1;
+    return 0;
+}
+
+/**
+ * @brief 读取上一帧的发送结果
+ * @return WIZ_UDP_SEND_xxx
+ */
+uint8_t wiz_udp_send_status(uint8_t sn)
+{
+    uint8_t ir;
+
+    if (sn >= _WIZCHIP_SOCK_NUM_ || !udp_send_busy[sn])
+        return WIZ_UDP_SEND_IDLE;
+
+    /* SEND 命令尚未被芯片接收 */
+    if (udp_cmd_pending[sn])
+    {
+        if (getSn_CR(sn))
+            return WIZ_UDP_SEND_PENDING;
+        udp_cmd_pending[sn] = 0;
+    }
+
+    ir = getSn_IR(sn);
+    if (ir & Sn_IR_SENDOK)
+    {
+        setSn_IR(sn, Sn_IR_SENDOK);
+        udp_send_busy[sn] = 0;
+        return WIZ_UDP_SEND_OK;
+    }
+    if (ir & Sn_IR_TIMEOUT)
+    {
+        setSn_IR(sn, Sn_IR_TIMEOUT);
+        udp_send_busy[sn] = 0;
+        return WIZ_UDP_SEND_TIMEOUT;
+    }
+    return WIZ_UDP_SEND_PENDING;
+}
+
+/**
+ * @brief 是否有未完成的发送
+ */
+uint8_t wiz_udp_send_busy(uint8_t sn)
+{
+    return sn < _WIZCHIP_SOCK_NUM_ && udp_send_busy[sn];
+}
+
+/**
+ * @brief 放弃未完成的发送并清除结果标志
+ */
+void wiz_udp_send_reset(uint8_t sn)
+{
+    if (sn >= _WIZCHIP_SOCK_NUM_)
+        return;
+    udp_send_busy[sn] = 0;
+    udp_cmd_pending[sn] = 0;
+    setSn_IR(sn, (Sn_IR_SENDOK | Sn_IR_TIMEOUT));
+}
@@ -0,0 +1,172 @@
+#ifndef __WIZ_TXQ_H__
+#define __WIZ_TXQ_H__
+
+#include <stdint.h>
+#include "wizchip_conf.h"
+
+/* wiz_txq_write 返回值 */
+#define WIZ_TXQ_ERR_SOCKNUM   (-1)  // socket 编号非法或未打开队列
+#define WIZ_TXQ_ERR_CLOSED    (-2)  // socket 已关闭或发送超时
+#define WIZ_TXQ_ERR_TIMEOUT   (-3)  // 等待队列空间超时, 未写入任何数据
+
+/* wiz_udp_send_status 返回值 */
+#define WIZ_UDP_SEND_IDLE     0     // 没有未完成的发送
+#define WIZ_UDP_SEND_PENDING  1     // SEND 执行中 (单播时可能在做 ARP)
+#define WIZ_UDP_SEND_OK       2     // 上一帧已发出
+#define WIZ_UDP_SEND_TIMEOUT  3     // ARP 无应答, 上一帧未发出
+
+/**
+ * @brief socket 发送队列统计
+ */
+typedef struct
+{
+    uint32_t bytes_queued;   // 累计写入队列的字节数
+    uint32_t bytes_sent;     // 累计写入 W5500 TX 缓冲区的字节数
+    uint32_t send_cmds;      // 发出 Sn_CR_SEND 的次数
+    uint32_t send_ok;        // 收到 SEND_OK 的次数
+    uint32_t timeouts;       // Sn_IR_TIMEOUT 次数
+    uint32_t chip_full;      // pump 时 W5500 TX 缓冲区已满的次数
+    uint32_t producer_waits; // 生产者因队列满而阻塞的次数
+    uint16_t queued;         // 当前队列中待发送字节数
+    uint16_t queued_peak;    // 队列最大占用
+} wiz_txq_stats_t;
+
+/**
+ * @brief 为 TCP socket 打开发送队列
+ * @param sn   :套接字编号, socket 需已由 socket()/connect()/listen() 打开
+ * @param buf  :队列存储区, 由调用者提供 (静态数组)
+ * @param size :存储区大小 (字节)
+ * @return 0 成功, -1 参数错误
+ *
+ * @note 打开队列后该 socket 的发送只能经由 wiz_txq_write, 不能再直接调用 send()
+ */
+int8_t wiz_txq_open(uint8_t sn, uint8_t *buf, uint16_t size);
+
+/**
+ * @brief 打开发送队列, 写入芯片的数据收到 SEND_OK 后才释放队列空间
+ * @param sn   :套接字编号
+ * @param buf  :队列存储区, 由调用者提供 (静态数组)
+ * @param size :存储区大小 (字节), 需容纳一次 SEND 的数据和等待期间写入的数据
+ * @return 0 成功, -1 参数错误
+ *
+ * @note 连接断开 (关闭、超时) 时未确认的数据保留在队列中, 由 wiz_txq_reclaim
+ *       取回或由 wiz_txq_resume 在新连接上重发
+ */
+int8_t wiz_txq_open_retain(uint8_t sn, uint8_t *buf, uint16_t size);
+
+/**
+ * @brief 关闭发送队列, 丢弃未发送数据
+ * @param sn :套接字编号
+ *
+ * @note wiz_txq_open_retain 打开的队列保留未确认的数据; 未完成的 SEND 状态一并清除,
+ *       socket 重开后由 wiz_txq_open/wiz_txq_resume 重新开始。
+ *       可以在推进队列的任务以外调用: pump 正在发送时由 pump 返回前完成关闭
+ */
+void wiz_txq_close(uint8_t sn);
+
+/**
+ * @brief 在新连接上继续发送关闭前未确认的数据
+ * @param sn :套接字编号, socket 需已重新连接
+ * @return 0 成功, -1 没有打开过 retain 队列
+ *
+ * @note 最后一次 SEND 的数据可能已到达对端, 会再发一次 (至少一次)
+ */
+int8_t wiz_txq_resume(uint8_t sn);
+
+/**
+ * @brief 取回已关闭或出错的 retain 队列中未确认的数据
+ * @param sn  :套接字编号
+ * @param buf :输出缓冲区
+ * @param len :缓冲区大小
+ * @return 取回的字节数, 队列仍在发送时为 0
+ *
+ * @note 与 wiz_txq_resume 相同, 最后一次 SEND 的数据可能重复
+ */
+uint16_t wiz_txq_reclaim(uint8_t sn, uint8_t *buf, uint16_t len);
+
+/**
+ * @brief 写入发送队列, 队列满时阻塞等待 (背压)
+ * @param sn         :套接字编号
+ * @param data       :数据
+ * @param len        :长度
+ * @param timeout_ms :最长等待时间, 0 表示不等待
+ * @return >0 实际写入的字节数 (超时时可能小于 len), <0 WIZ_TXQ_ERR_xxx
+ *
+ * @note 每个 socket 只允许一个生产者任务
+ */
+int32_t wiz_txq_write(uint8_t sn, const uint8_t *data, uint16_t len, uint32_t timeout_ms);
+
+/**
+ * @brief 查询队列剩余空间
+ * @param sn :套接字编号
+ * @return 可立即写入的字节数
+ */
+uint16_t wiz_txq_free(uint8_t sn);
+
+/**
+ * @brief 队列数据是否已全部发出 (可以 disconnect)
+ * @param sn :套接字编号
+ * @return 1 队列为空且没有等待 SEND_OK 的发送, 0 仍有数据在发送
+ */
+uint8_t wiz_txq_idle(uint8_t sn);
+
+/**
+ * @brief 推进所有已打开队列的发送, 不阻塞
+ *
+ * 检查上一次 SEND 是否完成 (SEND_OK/TIMEOUT), 然后把队列数据尽量写入
+ * W5500 TX 缓冲区并发出 SEND。需由拥有 W5500 SPI 的网络任务周期调用。
+ *
+ * @return 本次写入 W5500 的字节数
+ */
+uint32_t wiz_txq_poll(void);
+
+/**
+ * @brief 推进单个 socket 队列的发送, 不阻塞
+ * @param sn :套接字编号
+ * @return 本次写入 W5500 的字节数
+ *
+ * @note 同一队列只能由一个任务推进; 多个任务各自拥有不同 socket 时,
+ *       各任务只推进自己的 socket, 不要再调用 wiz_txq_poll
+ */
+uint16_t wiz_txq_poll_socket(uint8_t sn);
+
+/**
+ * @brief 获取发送队列统计
+ * @param sn    :套接字编号
+ * @param stats :输出统计信息
+ */
+void wiz_txq_get_stats(uint8_t sn, wiz_txq_stats_t *stats);
+
+/**
+ * @brief 发出一个 UDP 报文, 不等待 SEND_OK
+ * @param sn   :UDP 套接字编号
+ * @param buf  :报文
+ * @param len  :长度
+ * @param ip   :目的地址
+ * @param port :目的端口
+ * @return 0 已发出, -1 socket 未打开/上一帧尚未完成/TX 缓冲区不足
+ *
+ * @note socket.c 的 sendto 会等到 SEND_OK 或 ARP 超时 (单播最长约 1.8s),
+ *       控制协议 (DHCP/DNS/SNTP) 用本函数发送, 结果由 wiz_udp_send_status 读取
+ */
+int8_t wiz_udp_send_nowait(uint8_t sn, const uint8_t *buf, uint16_t len, const uint8_t *ip, uint16_t port);
+
+/**
+ * @brief 读取上一帧的发送结果, OK/TIMEOUT 只返回一次
+ * @param sn :套接字编号
+ * @return WIZ_UDP_SEND_xxx
+ */
+uint8_t wiz_udp_send_status(uint8_t sn);
+
+/**
+ * @brief 是否有未完成的发送 (不读取芯片, 不清除结果)
+ * @param sn :套接字编号
+ */
+uint8_t wiz_udp_send_busy(uint8_t sn);
+
+/**
+ * @brief 放弃未完成的发送并清除结果标志, 在 close/重开 socket 后调用
+ * @param sn :套接字编号
+ */
+void wiz_udp_send_reset(uint8_t sn);
+#endif
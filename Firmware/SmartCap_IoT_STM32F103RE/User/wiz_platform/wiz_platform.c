@@ -3,11 +3,17 @@
 #include "main.h"
 #include "gpio.h"
 #include "wiz_interface.h"
+#include "cmsis_os.h"
+#include "flash_if.h"
 #include <stdint.h>
+#include <string.h>
 
 extern SPI_HandleTypeDef hspi2;
 extern TIM_HandleTypeDef htim2;
 
+static osMutexId wizchip_mutex = NULL;
+static osStaticMutexDef_t wizchip_mutex_cb;
+
 /**
  * @brief   SPI 选择 wizchip
  * @param   无
@@ -87,6 +93,26 @@ void wizchip_reset(void)
     wiz_user_delay_ms(10);
 }
 
+/**
+ * @brief   进入 wizchip 临界区
+ * @note    多个任务访问 W5500 (网络监控、上行链路、抓包), 每次 SPI 帧期间挂起调度器,
+ *          调度器启动前不做处理 (此时退出临界区不会恢复中断)
+ */
+static void wizchip_cris_enter(void)
+{
+    if (osKernelRunning())
+        vTaskSuspendAll();
+}
+
+/**
+ * @brief   退出 wizchip 临界区
+ */
+static void wizchip_cris_exit(void)
+{
+    if (osKernelRunning())
+        xTaskResumeAll();
+}
+
 /**
  * @brief   wizchip spi 回调注册
  * @param   无
@@ -94,9 +120,38 @@ void wizchip_reset(void)
  */
 void wizchip_spi_cb_reg(void)
 {
+    if (wizchip_mutex == NULL)
+    {
+        osMutexStaticDef(WizChip, &wizchip_mutex_cb);
+        wizchip_mutex = osMutexCreate(osMutex(WizChip));
+    }
     reg_wizchip_cs_cbfunc(wizchip_select, wizchip_deselect);
     reg_wizchip_spi_cbfunc(wizchip_read_byte, wizchip_write_byte);
     reg_wizchip_spiburst_cbfunc(wizchip_read_buff, wizchip_write_buff);
+    reg_wizchip_cris_cbfunc(wizchip_cris_enter, wizchip_cris_exit);
+}
+
+/**
+ * @brief   占用 W5500
+ * @param   timeout_ms:最长等待时间
+ * @return  1 成功, 0 超时
+ */
+uint8_t wizchip_acquire(uint32_t timeout_ms)
+{
+    if (!osKernelRunning() || wizchip_mutex == NULL)
+        return 1;
+    return osMutexWait(wizchip_mutex, timeout_ms) == osOK;
+}
+
+/**
+ * @brief   释放 W5500
+ * @param   无
+ * @return  无
+ */
+void wizchip_release(void)
+{
+    if (osKernelRunning() && wizchip_mutex != NULL)
+        osMutexRelease(wizchip_mutex);
 }
 
 /**
@@ -130,3 +185,48 @@ void wiz_tim_irq_disable(void)
 {
     HAL_TIM_Base_Stop_IT(&htim2);
 }
+
+/**
+ * @brief   读取保存的 DHCP 租约
+ * @param   buf:输出缓冲区
+ * @param   len:读取长度
+ * @return  无
+ */
+void wiz_lease_load(void *buf, uint16_t len)
+{
+    if (len > WIZ_LEASE_FLASH_SIZE)
+        len = WIZ_LEASE_FLASH_SIZE;
+    memcpy(buf, (const void *)WIZ_LEASE_FLASH_ADDR, len);
+}
+
+/**
+ * @brief   保存 DHCP 租约
+ * @param   buf:租约数据
+ * @param   len:长度
+ * @return  0 成功, -1 擦除或编程失败
+ */
+int8_t wiz_lease_save(const void *buf, uint16_t len)
+{
+    const uint8_t *p = (const uint8_t *)buf;
+    uint16_t half;
+    uint16_t i;
+    int8_t ret = 0;
+
+    if (len > WIZ_LEASE_FLASH_SIZE)
+        return -1;
+
+    /* 与 OTA、文件系统共用 Flash 锁 */
+    Flash_Acquire();
+    if (!Flash_ErasePage(WIZ_LEASE_FLASH_ADDR))
+        ret = -1;
+    for (i = 0; ret == 0 && i < len; i += 2)
+    {
+        /* 按半字编程, 奇数长度时最后一个字节补 0xFF */
+        half = p[i];
+        half |= (uint16_t)((i + 1 < len) ? p[i + 1] : 0xFF) << 8;
+        if (!Flash_Program16(WIZ_LEASE_FLASH_ADDR + i, half))
+            ret = -1;
+    }
+    Flash_Release();
+    return ret;
+}
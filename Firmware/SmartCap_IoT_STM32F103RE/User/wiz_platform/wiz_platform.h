@@ -3,6 +3,10 @@
 
 #include <stdint.h>
 
+/* DHCP 租约保存在片内 Flash 最后一页 (STM32F103RE 每页 2KB), 工程的 IROM1 已扣除该页 */
+#define WIZ_LEASE_FLASH_ADDR 0x0807F800UL
+#define WIZ_LEASE_FLASH_SIZE 2048
+
 /**
  * @brief   硬件重置 wizchip
  * @param   无
@@ -17,6 +21,24 @@ void wizchip_reset(void);
  */
 void wizchip_spi_cb_reg(void);
 
+/**
+ * @brief   占用 W5500, 其它任务正在进行多寄存器操作时等待
+ * @param   timeout_ms:最长等待时间, 0 表示不等待, osWaitForever 一直等待
+ * @return  1 成功, 0 超时
+ *
+ * @note    单个 SPI 帧已由临界区保护; 打开/关闭 socket、发送、芯片复位等由多个帧组成,
+ *          网络监控 (默认任务) 和上行链路 (上行发送任务) 在此锁内进行, 不可递归获取。
+ *          调度器启动前或 wizchip_spi_cb_reg 之前总是成功
+ */
+uint8_t wizchip_acquire(uint32_t timeout_ms);
+
+/**
+ * @brief   释放 W5500
+ * @param   无
+ * @return  无
+ */
+void wizchip_release(void);
+
 /**
  * @brief   打开 wiz 定时器中断
  * @param   无
@@ -30,4 +52,22 @@ void wiz_tim_irq_enable(void);
  * @return  无
  */
 void wiz_tim_irq_disable(void);
+
+/**
+ * @brief   读取保存的 DHCP 租约
+ * @param   buf:输出缓冲区
+ * @param   len:读取长度
+ * @return  无 (内容由调用者校验)
+ */
+void wiz_lease_load(void *buf, uint16_t len);
+
+/**
+ * @brief   保存 DHCP 租约
+ * @param   buf:租约数据
+ * @param   len:长度, 不超过 WIZ_LEASE_FLASH_SIZE
+ * @return  0 成功, -1 擦除或编程失败
+ *
+ * @note    擦除一页期间 CPU 停顿约 20ms, 调用者应只在租约内容变化时保存
+ */
+int8_t wiz_lease_save(const void *buf, uint16_t len);
 #endif